@@ -27,8 +27,19 @@ limitations under the License.
 
 #include "AtlasBuilderUsingIntensityCLP.h"
 
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 enum { Dimension = 3 };
 
+typedef tube::AtlasSummation                         AtlasSummationType;
+typedef AtlasSummationType::InputImageType           InputImageType;
+typedef AtlasSummationType::TransformType            TransformType;
+typedef itk::tube::ImageDocument                     ImageDocumentType;
+typedef itk::tube::ObjectDocumentToImageFilter< ImageDocumentType,
+  InputImageType >                                   DocumentToImageFilter;
+
 typedef itk::Image< float, Dimension > FloatImageType;
 
 void WriteImage( FloatImageType::Pointer i, const std::string & name )
@@ -55,19 +66,169 @@ void WriteImage( UShortImageType::Pointer i, const std::string & name )
   writer->Update();
 }
 
+/** Read the image of a document and its composed transform, which is
+ *  null if it is the identity */
+void ReadDocumentImage( ImageDocumentType * doc,
+  InputImageType::Pointer & image, TransformType::Pointer & transform )
+{
+  DocumentToImageFilter::Pointer filter = DocumentToImageFilter::New();
+  filter->SetInput( doc );
+  filter->SetApplyTransforms( false );
+  filter->Update();
+  image = filter->GetOutput();
+
+  transform = filter->GetComposedTransform().GetPointer();
+  if( filter->GetComposedTransformIsIdentity() )
+    {
+    tube::DebugMessage( "ComposedTransform is IDENTITY" );
+    transform = nullptr;
+    }
+}
+
+/** Add the images of documents [first, end) to the atlas.  Up to
+ *  numberOfSubjectsInFlight images are read and resampled by as many
+ *  threads while the previous images are added, in order, by this one.
+ *  Requires the output grid of the atlas to be final. */
+bool AddDocumentImagesConcurrently( AtlasSummationType * atlasBuilder,
+  const std::vector< ImageDocumentType::Pointer > & docs,
+  unsigned int first, unsigned int numberOfSubjectsInFlight )
+{
+  const unsigned int end = docs.size();
+  std::vector< InputImageType::Pointer > slots( numberOfSubjectsInFlight );
+  std::vector< bool > ready( end, false );
+  unsigned int nextToRead = first;
+  unsigned int nextToAdd = first;
+  bool failed = false;
+  std::string error;
+
+  std::mutex mutex;
+  std::condition_variable readyCondition;
+  std::condition_variable spaceCondition;
+
+  auto producer = [&]( void )
+    {
+    for( ;; )
+      {
+      unsigned int i;
+        {
+        // Wait for a free slot
+        std::unique_lock< std::mutex > lock( mutex );
+        spaceCondition.wait( lock, [&]( void )
+          {
+          return failed || nextToRead >= end
+            || nextToRead < nextToAdd + numberOfSubjectsInFlight;
+          } );
+        if( failed || nextToRead >= end )
+          {
+          return;
+          }
+        i = nextToRead++;
+        }
+
+      InputImageType::Pointer image;
+      try
+        {
+        TransformType::Pointer transform;
+        ReadDocumentImage( docs[i], image, transform );
+        if( transform.IsNull() )
+          {
+          transform = TransformType::New();
+          transform->SetIdentity();
+          }
+        image = atlasBuilder->ResampleImage( image, transform );
+        }
+      catch( std::exception & e )
+        {
+        std::lock_guard< std::mutex > lock( mutex );
+        failed = true;
+        error = docs[i]->GetObjectName() + ": " + e.what();
+        readyCondition.notify_all();
+        spaceCondition.notify_all();
+        return;
+        }
+
+        {
+        std::lock_guard< std::mutex > lock( mutex );
+        slots[i % numberOfSubjectsInFlight] = image;
+        ready[i] = true;
+        }
+      readyCondition.notify_all();
+      }
+    };
+
+  std::vector< std::thread > producers;
+  producers.reserve( numberOfSubjectsInFlight );
+  try
+    {
+    for( unsigned int t = 0; t < numberOfSubjectsInFlight; ++t )
+      {
+      producers.push_back( std::thread( producer ) );
+      }
+
+    while( nextToAdd < end )
+      {
+      InputImageType::Pointer image;
+        {
+        std::unique_lock< std::mutex > lock( mutex );
+        readyCondition.wait( lock, [&]( void )
+          {
+          return failed || ready[nextToAdd];
+          } );
+        if( failed )
+          {
+          break;
+          }
+        image = slots[nextToAdd % numberOfSubjectsInFlight];
+        slots[nextToAdd % numberOfSubjectsInFlight] = nullptr;
+        }
+
+      tube::FmtInfoMessage( "Adding image: %s",
+        docs[nextToAdd]->GetObjectName().c_str() );
+      atlasBuilder->AddResampledImage( image );
+      image = nullptr;
+
+        {
+        std::lock_guard< std::mutex > lock( mutex );
+        ++nextToAdd;
+        }
+      spaceCondition.notify_all();
+      }
+    }
+  catch( ... )
+    {
+    // Stop the producers before the exception leaves this function, since
+    // destroying a joinable thread terminates the program
+      {
+      std::lock_guard< std::mutex > lock( mutex );
+      failed = true;
+      }
+    spaceCondition.notify_all();
+    for( unsigned int t = 0; t < producers.size(); ++t )
+      {
+      producers[t].join();
+      }
+    throw;
+    }
+
+  for( unsigned int t = 0; t < producers.size(); ++t )
+    {
+    producers[t].join();
+    }
+
+  if( failed )
+    {
+    tube::ErrorMessage( "Could not add image " + error );
+    return false;
+    }
+  return true;
+}
+
 int DoIt( int argc, char * argv[] )
 {
   PARSE_ARGS;
 
-  typedef tube::AtlasSummation                       AtlasSummationType;
-  typedef AtlasSummationType::InputPixelType         InputPixelType;
-  typedef itk::Image< InputPixelType, Dimension >    InputImageType;
   typedef tube::MetaObjectDocument                   DocumentReaderType;
-  typedef itk::tube::ImageDocument                   ImageDocumentType;
   typedef DocumentReaderType::ObjectDocumentListType ImageDocumentListType;
-  typedef
-    itk::tube::ObjectDocumentToImageFilter< ImageDocumentType, InputImageType >
-    DocumentToImageFilter;
 
   // Reads the ObjectDocuments file
   DocumentReaderType::Pointer reader = new DocumentReaderType();
@@ -89,9 +250,9 @@ int DoIt( int argc, char * argv[] )
 
   AtlasSummationType::SizeType size;
 
-  for( unsigned int i = 0; i < outputSpacing.size(); ++i )
+  for( unsigned int i = 0; i < outputSize.size(); ++i )
     {
-    size[i] = outputSpacing[i];
+    size[i] = outputSize[i];
     }
 
   atlasBuilder->SetOutputSize( size );
@@ -111,36 +272,50 @@ int DoIt( int argc, char * argv[] )
   atlasBuilder->SetImageCountThreshold( lowerThreshold );
   atlasBuilder->AdjustResampledImageSize( doImageSizeAdjustment );
   atlasBuilder->AdjustResampledImageOrigin( doImageOriginAdjustment );
+  atlasBuilder->UseFixedOutputGrid( useFixedOutputGrid );
 
+  std::vector< ImageDocumentType::Pointer > docs;
   ImageDocumentListType::const_iterator it_imgDoc = imageObjects.begin();
+  while( it_imgDoc != imageObjects.end() )
+    {
+    docs.push_back(
+      static_cast< ImageDocumentType * >( ( *it_imgDoc ).GetPointer() ) );
+    ++it_imgDoc;
+    }
+
   tube::FmtInfoMessage( "Starting image addition..." );
 
   /* Iteratively add the images to atlas summation method. This is done so that
-     only one image must be held in memory at a time. */
-  DocumentToImageFilter::Pointer filter = DocumentToImageFilter::New();
-
-  while( it_imgDoc != imageObjects.end() )
+     only one image must be held in memory at a time, or at most
+     numberOfSubjectsInFlight once the output grid is final. */
+  unsigned int next = 0;
+  while( next < docs.size() && ( numberOfSubjectsInFlight < 2
+    || !atlasBuilder->GetOutputGridIsFinal() ) )
     {
-    ImageDocumentType::Pointer doc
-      = static_cast< ImageDocumentType * >( ( *it_imgDoc ).GetPointer() );
-    tube::FmtInfoMessage( "Adding image: %s", doc->GetObjectName().c_str() );
-
-    filter->SetInput( doc );
-    filter->SetApplyTransforms( false );
-    filter->Update();
-    filter->GetComposedTransform();
+    tube::FmtInfoMessage( "Adding image: %s",
+      docs[next]->GetObjectName().c_str() );
 
-    if( filter->GetComposedTransformIsIdentity() )
+    InputImageType::Pointer image;
+    AtlasSummationType::TransformType::Pointer transform;
+    ReadDocumentImage( docs[next], image, transform );
+    if( transform.IsNull() )
       {
-      tube::DebugMessage( "ComposedTransform is IDENTITY" );
-      atlasBuilder->AddImage( filter->GetOutput() );
+      atlasBuilder->AddImage( image );
       }
     else
       {
-      atlasBuilder->AddImage( filter->GetOutput(),
-                              filter->GetComposedTransform().GetPointer() );
+      atlasBuilder->AddImage( image, transform );
       }
-    ++it_imgDoc;
+    ++next;
+    }
+
+  if( next < docs.size() && !AddDocumentImagesConcurrently( atlasBuilder,
+    docs, next, numberOfSubjectsInFlight ) )
+    {
+    delete reader;
+    delete atlasBuilder;
+
+    return EXIT_FAILURE;
     }
 
   tube::InfoMessage( "Finalizing the images..." );
@@ -0,0 +1,174 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright 2010 Kitware Inc. 28 Corporate Drive,
+Clifton Park, NY, 12065, USA.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#include "itktubeRobustMeanAndSigmaImageBuilder.h"
+
+#include <itkImageRegionConstIteratorWithIndex.h>
+#include <itkImageRegionIteratorWithIndex.h>
+
+#include <cmath>
+
+enum { Dimension = 2 };
+
+typedef float                                       PixelType;
+typedef itk::Image< PixelType, Dimension >          ImageType;
+typedef itk::tube::RobustMeanAndSigmaImageBuilder< ImageType, ImageType,
+  ImageType >                                       BuilderType;
+
+// Image k holds, at each voxel v, v[0] + values[( k + v[0] + v[1] ) % n],
+//   so every voxel sees the same values in a different order
+ImageType::Pointer CreateImage( unsigned int k, const double * values,
+  unsigned int n )
+{
+  ImageType::RegionType region;
+  ImageType::SizeType size;
+  size.Fill( 8 );
+  region.SetSize( size );
+
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions( region );
+  image->Allocate();
+  itk::ImageRegionIteratorWithIndex< ImageType > it( image, region );
+  while( !it.IsAtEnd() )
+    {
+    const ImageType::IndexType & indx = it.GetIndex();
+    it.Set( indx[0] + values[( k + indx[0] + indx[1] ) % n] );
+    ++it;
+    }
+
+  return image;
+}
+
+// Compare the outputs with the statistics of the values, offset by
+//   the x index, over the 8x8 voxels the images cover; voxels of the
+//   output grid beyond them must be zero
+int CheckOutput( BuilderType * builder, const char * name,
+  double expectedMean, double expectedSigma )
+{
+  int returnStatus = EXIT_SUCCESS;
+
+  ImageType::Pointer mean = builder->GetOutputMeanImage();
+  ImageType::Pointer sigma = builder->GetOutputSigmaImage();
+  itk::ImageRegionConstIteratorWithIndex< ImageType > itMean( mean,
+    mean->GetLargestPossibleRegion() );
+  itk::ImageRegionConstIteratorWithIndex< ImageType > itSigma( sigma,
+    sigma->GetLargestPossibleRegion() );
+  while( !itMean.IsAtEnd() )
+    {
+    const ImageType::IndexType & indx = itMean.GetIndex();
+    double meanValue = 0;
+    double sigmaValue = 0;
+    if( indx[0] < 8 && indx[1] < 8 )
+      {
+      meanValue = indx[0] + expectedMean;
+      sigmaValue = expectedSigma;
+      }
+    if( std::fabs( itMean.Get() - meanValue ) > 1e-3
+      || std::fabs( itSigma.Get() - sigmaValue ) > 1e-3 )
+      {
+      std::cerr << "ERROR: " << name << " at " << indx << " is "
+        << itMean.Get() << " ( " << itSigma.Get() << " ), expected "
+        << meanValue << " ( " << sigmaValue << " )" << std::endl;
+      returnStatus = EXIT_FAILURE;
+      break;
+      }
+    ++itMean;
+    ++itSigma;
+    }
+
+  return returnStatus;
+}
+
+int itktubeRobustMeanAndSigmaImageBuilderTest( int itkNotUsed( argc ),
+  char * itkNotUsed( argv )[] )
+{
+  int returnStatus = EXIT_SUCCESS;
+
+  // Odd median: one outlier is removed from each end before computing
+  //   sigma, leaving 2, 3 and 4
+  const double oddValues[5] = { 4, 1, 100, 3, 2 };
+  BuilderType::Pointer oddBuilder = BuilderType::New();
+  oddBuilder->SetNumberOfOutlierImagesToRemove( 1 );
+  oddBuilder->UseMedianImage( 5 );
+  for( unsigned int k = 0; k < 5; ++k )
+    {
+    oddBuilder->AddImage( CreateImage( k, oddValues, 5 ) );
+    }
+  oddBuilder->FinalizeOutput();
+  if( CheckOutput( oddBuilder, "Odd median", 3, 1 ) != EXIT_SUCCESS )
+    {
+    returnStatus = EXIT_FAILURE;
+    }
+
+  // Even median: the average of 3 and 4; sigma of 2, 3, 4 and 5
+  const double evenValues[6] = { 5, 50, 2, 4, 1, 3 };
+  BuilderType::Pointer evenBuilder = BuilderType::New();
+  evenBuilder->SetNumberOfOutlierImagesToRemove( 1 );
+  evenBuilder->UseMedianImage( 6 );
+  for( unsigned int k = 0; k < 6; ++k )
+    {
+    evenBuilder->AddImage( CreateImage( k, evenValues, 6 ) );
+    }
+  evenBuilder->FinalizeOutput();
+  if( CheckOutput( evenBuilder, "Even median", 3.5,
+    std::sqrt( 5.0 / 3.0 ) ) != EXIT_SUCCESS )
+    {
+    returnStatus = EXIT_FAILURE;
+    }
+
+  // Robust mean on a fixed output grid wider than the images: removing
+  //   two outliers from each end leaves 2, 3 and 4
+  const double meanValues[7] = { 3, -20, 5, 30, 1, 4, 2 };
+  BuilderType::Pointer meanBuilder = BuilderType::New();
+  meanBuilder->SetNumberOfOutlierImagesToRemove( 2 );
+  BuilderType::SizeType gridSize;
+  gridSize[0] = 10;
+  gridSize[1] = 8;
+  BuilderType::SpacingType gridSpacing;
+  gridSpacing.Fill( 1 );
+  BuilderType::PointType gridOrigin;
+  gridOrigin.Fill( 0 );
+  meanBuilder->SetOutputSize( gridSize );
+  meanBuilder->SetOutputSpacing( gridSpacing );
+  meanBuilder->SetOutputOrigin( gridOrigin );
+  meanBuilder->UseFixedOutputGridOn();
+  for( unsigned int k = 0; k < 7; ++k )
+    {
+    meanBuilder->AddImage( CreateImage( k, meanValues, 7 ) );
+    }
+  meanBuilder->FinalizeOutput();
+  if( meanBuilder->GetOutputMeanImage()->GetLargestPossibleRegion().GetSize()
+    != gridSize )
+    {
+    std::cerr << "ERROR: Output does not have the size of the fixed grid"
+      << std::endl;
+    returnStatus = EXIT_FAILURE;
+    }
+  else if( CheckOutput( meanBuilder, "Fixed grid mean", 3, 1 )
+    != EXIT_SUCCESS )
+    {
+    returnStatus = EXIT_FAILURE;
+    }
+
+  return returnStatus;
+}
@@ -26,6 +26,8 @@ limitations under the License.
 
 #include "tubeMessage.h"
 
+#include <itkImageRegionIterator.h>
+#include <itkMultiThreaderBase.h>
 #include <itkObject.h>
 #include <itkResampleImageFilter.h>
 
@@ -48,6 +50,16 @@ namespace tube
  *
  *  NOTE: This is not done for origin or spacing, because those factors
  *  could require interpolation, which would change the maintain base results.
+ *
+ *  Alternatively, UseFixedOutputGrid() makes the output grid the one set
+ *  by SetOutputSize(), SetOutputSpacing() and SetOutputOrigin() before the
+ *  first image is added; images are then accumulated over their overlap
+ *  with that grid and the output is never resampled.
+ *
+ *  The images are accumulated as a running mean and sum of squared
+ *  deviations ( Welford's method ), which, unlike a sum and a sum of
+ *  squares, keeps float precision over hundreds of images.  Each image is
+ *  accumulated in parallel over tiles of the output.
  */
 template< class TInputImageType, class TOutputMeanImageType,
           class TOutputSigmaImageType >
@@ -214,7 +226,17 @@ public:
   /** Set the current size of the output images */
   itkSetMacro( OutputOrigin, PointType );
 
-  itkGetModifiableObjectMacro( SumImage, ProcessImageType );
+  /**
+   * Set/Get whether the output grid is fixed to the output size, spacing
+   * and origin set before the first image is added, instead of being
+   * taken from the first image.  Default is false
+   */
+  itkSetMacro( UseFixedOutputGrid, bool );
+  itkGetConstMacro( UseFixedOutputGrid, bool );
+  itkBooleanMacro( UseFixedOutputGrid );
+
+  /** Get the running mean of the images added so far */
+  itkGetModifiableObjectMacro( RunningMeanImage, ProcessImageType );
 
 protected:
 
@@ -233,10 +255,11 @@ protected:
   typedef ImageRegionIterator< OutputMeanImageType >   OutputMeanIteratorType;
   typedef ImageRegionIterator< OutputSigmaImageType >  OutputSigmaIteratorType;
 
-  itkSetObjectMacro( SumImage, ProcessImageType );
+  itkSetObjectMacro( RunningMeanImage, ProcessImageType );
 
-  itkGetModifiableObjectMacro( SumSquareImage, ProcessImageType );
-  itkSetObjectMacro( SumSquareImage, ProcessImageType );
+  itkGetModifiableObjectMacro( SumOfSquaredDeviationsImage,
+    ProcessImageType );
+  itkSetObjectMacro( SumOfSquaredDeviationsImage, ProcessImageType );
 
   itkSetObjectMacro( ValidCountImage, CountImageType );
 
@@ -260,14 +283,21 @@ protected:
 
   /**
    * Build new processing images, i.e.,
-   * sumImage, sumSquareImage, validCountImage
+   * runningMeanImage, sumOfSquaredDeviationsImage, validCountImage
    */
   virtual void BuildProcessingImages( InputImagePointer i );
 
+  /**
+   * Accumulate the voxels of image within region, a tile of the output.
+   * Called concurrently for disjoint tiles.
+   */
+  virtual void AccumulateRegion( const InputImageType * image,
+    const RegionType & region );
+
 private:
 
-  ProcessImagePointer                     m_SumImage;
-  ProcessImagePointer                     m_SumSquareImage;
+  ProcessImagePointer                     m_RunningMeanImage;
+  ProcessImagePointer                     m_SumOfSquaredDeviationsImage;
   CountImagePointer                       m_ValidCountImage;
 
   OutputMeanImagePointer                  m_OutputMeanImage;
@@ -279,6 +309,7 @@ private:
   bool                                    m_IsProcessing;
   bool                                    m_UseStandardDeviation;
   bool                                    m_DynamicallyAdjustOutputSize;
+  bool                                    m_UseFixedOutputGrid;
 
   SizeType                                m_OutputSize;
   SpacingType                             m_OutputSpacing;
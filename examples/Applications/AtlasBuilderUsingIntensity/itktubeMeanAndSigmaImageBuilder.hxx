@@ -35,7 +35,8 @@ MeanAndSigmaImageBuilder< TInputImageType, TOutputMeanImageType,
   m_ThresholdInputImageBelow( 0 ),
   m_IsProcessing( false ),
   m_UseStandardDeviation( true ),
-  m_DynamicallyAdjustOutputSize( false )
+  m_DynamicallyAdjustOutputSize( false ),
+  m_UseFixedOutputGrid( false )
 {
   m_OutputSize.Fill( 0 );
   m_OutputSpacing.Fill( 0 );
@@ -53,51 +54,60 @@ void MeanAndSigmaImageBuilder< TInputImageType, TOutputMeanImageType,
     BuildProcessingImages( i );
     }
 
-  // Iterate through current_image and copy values into the Sum Image,
-  // Sum Sqared Image, and Valid Count Image
+  // Only the part of the image that overlaps the output is accumulated
   //
-  // Note: Must transform the base image region so that the new added
-  // image has the appropriate region value
-  ProcessImagePointer sumImage = this->GetSumImage();
-  ProcessImagePointer sumSquareImage = this->GetSumSquareImage();
-  CountImagePointer validImage = this->GetValidCountImage();
-
-  typename ProcessImageType::RegionType region;
-  region.SetSize( this->GetOutputSize() );
+  // Note: The image is assumed to be on the grid of the output, so the
+  // overlap is computed in index space
+  RegionType region = m_ValidCountImage->GetLargestPossibleRegion();
+  if( !region.Crop( i->GetLargestPossibleRegion() ) )
+    {
+    ::tube::WarningMessage( "Image does not overlap the output!" );
+    return;
+    }
 
-  InputConstIteratorType it_image( i, region );
-  CountIteratorType it_valid( validImage, region );
-  ProcessIteratorType it_sum( sumImage, region );
-  ProcessIteratorType it_sum_sqre( sumSquareImage, region );
+  const InputImageType * image = i.GetPointer();
+  MultiThreaderBase::Pointer threader = MultiThreaderBase::New();
+  threader->ParallelizeImageRegion< ImageDimension >( region,
+    [this, image]( const RegionType & tile )
+      {
+      this->AccumulateRegion( image, tile );
+      }, nullptr );
+}
 
-  it_image.GoToBegin();
-  it_valid.GoToBegin();
-  it_sum.GoToBegin();
-  it_sum_sqre.GoToBegin();
+template< class TInputImageType, class TOutputMeanImageType,
+  class TOutputSigmaImageType >
+void MeanAndSigmaImageBuilder< TInputImageType, TOutputMeanImageType,
+  TOutputSigmaImageType>
+::AccumulateRegion( const InputImageType * image, const RegionType & region )
+{
+  InputConstIteratorType it_image( image, region );
+  CountIteratorType it_valid( m_ValidCountImage, region );
+  ProcessIteratorType it_mean( m_RunningMeanImage, region );
+  ProcessIteratorType it_ssd( m_SumOfSquaredDeviationsImage, region );
 
-  while( !it_image.IsAtEnd() && !it_sum.IsAtEnd() )
+  while( !it_image.IsAtEnd() )
     {
     InputPixelType p = it_image.Get();
 
     // If requested to be threshold, ensure that the value
     // added has a value above the threshold ( and not out of the
     // image area ), else ignore.
-    if( this->GetThresholdInputImageBelowOn() == false
-        || ( this->GetThresholdInputImageBelowOn() == true
-        && p > this->GetThresholdInputImageBelow() ) )
+    if( !m_ThresholdInputImageBelowOn || p > m_ThresholdInputImageBelow )
       {
-      it_valid.Set( it_valid.Get() + 1 );
-      it_sum.Set( it_sum.Get() + p );
-      it_sum_sqre.Set( it_sum_sqre.Get() + ( p * p ) );
+      // Welford's update of the running mean and of the sum of squared
+      // deviations from it
+      const CountPixelType number = it_valid.Get() + 1;
+      const ProcessPixelType delta = p - it_mean.Get();
+      const ProcessPixelType mean = it_mean.Get() + delta / number;
+      it_valid.Set( number );
+      it_mean.Set( mean );
+      it_ssd.Set( it_ssd.Get() + delta * ( p - mean ) );
       }
     ++it_image;
-    ++it_sum;
-    ++it_sum_sqre;
     ++it_valid;
+    ++it_mean;
+    ++it_ssd;
     }
-  this->SetSumImage( sumImage );
-  this->SetSumSquareImage( sumSquareImage );
-  this->SetValidCountImage( validImage );
 }
 
 template< class TInputImageType, class TOutputMeanImageType,
@@ -112,13 +122,14 @@ void MeanAndSigmaImageBuilder< TInputImageType, TOutputMeanImageType,
     return;
     }
 
-  ProcessImagePointer sumImage        = this->GetSumImage();
-  ProcessImagePointer sumSquareImage  = this->GetSumSquareImage();
+  ProcessImagePointer meanImageIn     = this->GetRunningMeanImage();
+  ProcessImagePointer ssdImage        =
+    this->GetSumOfSquaredDeviationsImage();
   CountImagePointer   validImages     = this->GetValidCountImage();
 
-  RegionType  outputRegion  = sumImage->GetLargestPossibleRegion();
-  SpacingType outputSpacing = sumImage->GetSpacing();
-  PointType   outputOrigin  = sumImage->GetOrigin();
+  RegionType  outputRegion  = meanImageIn->GetLargestPossibleRegion();
+  SpacingType outputSpacing = meanImageIn->GetSpacing();
+  PointType   outputOrigin  = meanImageIn->GetOrigin();
 
   // Build Mean and Variance Images
   OutputMeanImagePointer meanImage = OutputMeanImageType::New();
@@ -134,13 +145,13 @@ void MeanAndSigmaImageBuilder< TInputImageType, TOutputMeanImageType,
   sigmaImage->Allocate();
 
   CountConstIteratorType it_valid( validImages, outputRegion );
-  ProcessConstIteratorType it_sum( sumImage, outputRegion );
-  ProcessConstIteratorType it_sum_sqre( sumSquareImage, outputRegion );
+  ProcessConstIteratorType it_runningMean( meanImageIn, outputRegion );
+  ProcessConstIteratorType it_ssd( ssdImage, outputRegion );
   OutputMeanIteratorType it_mean( meanImage, outputRegion );
   OutputSigmaIteratorType it_dev( sigmaImage, outputRegion );
 
-  it_sum.GoToBegin();
-  it_sum_sqre.GoToBegin();
+  it_runningMean.GoToBegin();
+  it_ssd.GoToBegin();
   it_dev.GoToBegin();
   it_mean.GoToBegin();
   it_valid.GoToBegin();
@@ -152,7 +163,7 @@ void MeanAndSigmaImageBuilder< TInputImageType, TOutputMeanImageType,
   // Calculate standard deviation or varaince
   const bool isStdDeviation = this->GetUseStandardDeviation();
 
-  while( !it_sum.IsAtEnd() )
+  while( !it_runningMean.IsAtEnd() )
     {
     // Ensure that the number of valid images at the point is above
     // the set minimum image threshold
@@ -161,11 +172,8 @@ void MeanAndSigmaImageBuilder< TInputImageType, TOutputMeanImageType,
       {
       if( number > 1 ) // Prevent potential division by zero for variance
         {
-        ProcessPixelType sum = it_sum.Get();
-        ProcessPixelType sumSqr = it_sum_sqre.Get();
-        // Variance Calc. s^2 = ( ( sum( x^2 ) - ( sum( x )^2/n ) )/ ( n-1 ) )
-        ProcessPixelType variance =
-          ( sumSqr - ( ( sum * sum ) / number ) ) / ( number - 1 );
+        // Variance Calc. s^2 = sum( ( x - mean )^2 ) / ( n-1 )
+        ProcessPixelType variance = it_ssd.Get() / ( number - 1 );
 
         // If Standard Deviation Calc. s = std::sqrt( s^2 )
         if( isStdDeviation )
@@ -173,13 +181,12 @@ void MeanAndSigmaImageBuilder< TInputImageType, TOutputMeanImageType,
           variance = std::sqrt( variance );
           }
         it_dev.Set( ( OutputSigmaPixelType ) variance );
-        it_mean.Set( ( OutputMeanPixelType )
-                     ( sum / ( ( ProcessPixelType ) number ) ) );
+        it_mean.Set( ( OutputMeanPixelType ) it_runningMean.Get() );
         }
       else
         {
         it_dev.Set( 0 );
-        it_mean.Set( ( OutputMeanPixelType ) it_sum.Get() );
+        it_mean.Set( ( OutputMeanPixelType ) it_runningMean.Get() );
         }
       }
     else
@@ -191,8 +198,8 @@ void MeanAndSigmaImageBuilder< TInputImageType, TOutputMeanImageType,
     ++it_valid;
     ++it_mean;
     ++it_dev;
-    ++it_sum;
-    ++it_sum_sqre;
+    ++it_runningMean;
+    ++it_ssd;
     }
 
   this->SetOutputMeanImage( meanImage );
@@ -216,6 +223,12 @@ MeanAndSigmaImageBuilder< TInputImageType, TOutputMeanImageType,
   RegionType  region  = i->GetLargestPossibleRegion();
   SpacingType spacing = i->GetSpacing();
   PointType   origin  = i->GetOrigin();
+  if( this->GetUseFixedOutputGrid() )
+    {
+    region = RegionType( this->GetOutputSize() );
+    spacing = this->GetOutputSpacing();
+    origin = this->GetOutputOrigin();
+    }
 
   sumImage->SetRegions( region );
   sumImage->SetSpacing( spacing );
@@ -235,8 +248,8 @@ MeanAndSigmaImageBuilder< TInputImageType, TOutputMeanImageType,
   validCountImage->Allocate();
   validCountImage->FillBuffer( 0 );
 
-  this->SetSumImage( sumImage );
-  this->SetSumSquareImage( sumSquareImage );
+  this->SetRunningMeanImage( sumImage );
+  this->SetSumOfSquaredDeviationsImage( sumSquareImage );
   this->SetValidCountImage( validCountImage );
 
   // Set the new output parameters
@@ -259,9 +272,15 @@ MeanAndSigmaImageBuilder< TInputImageType, TOutputMeanImageType,
     ::tube::ErrorMessage( "Call AddImage() before updating image size!" );
     return;
     }
+  if( this->GetUseFixedOutputGrid() )
+    {
+    ::tube::ErrorMessage( "Cannot update the size of a fixed output grid!" );
+    return;
+    }
 
-  ProcessImagePointer sumImage        = this->GetSumImage();
-  ProcessImagePointer sumSquareImage  = this->GetSumSquareImage();
+  ProcessImagePointer sumImage        = this->GetRunningMeanImage();
+  ProcessImagePointer sumSquareImage  =
+    this->GetSumOfSquaredDeviationsImage();
   CountImagePointer   validImage      = this->GetValidCountImage();
 
   typedef ResampleImageFilter< ProcessImageType, ProcessImageType >
@@ -275,7 +294,7 @@ MeanAndSigmaImageBuilder< TInputImageType, TOutputMeanImageType,
   processFilter->SetOutputOrigin( sumImage->GetOrigin() );
   processFilter->Update();
 
-  this->SetSumImage( processFilter->GetOutput() );
+  this->SetRunningMeanImage( processFilter->GetOutput() );
 
   typename ResampleProcessImageType::Pointer processFilter2 =
     ResampleProcessImageType::New();
@@ -288,7 +307,7 @@ MeanAndSigmaImageBuilder< TInputImageType, TOutputMeanImageType,
   // ( so using only one to declare )
   processFilter2->SetOutputOrigin( sumImage->GetOrigin() );
   processFilter2->Update();
-  this->SetSumSquareImage( processFilter2->GetOutput() );
+  this->SetSumOfSquaredDeviationsImage( processFilter2->GetOutput() );
 
 
   typedef ResampleImageFilter<CountImageType, CountImageType>
@@ -27,6 +27,12 @@ limitations under the License.
 #include "itktubeMeanAndSigmaImageBuilder.h"
 #include "tubeMessage.h"
 
+#include <itkImageRegionConstIteratorWithIndex.h>
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
 namespace itk
 {
 
@@ -41,6 +47,13 @@ namespace tube
  * image addition, as must be the number of outlier images to crop from the
  * ends.
  *
+ * Rather than whole images, only the extreme values of each voxel are
+ * kept: a bounded max-heap of its lowest values ( n/2 + 1 of them for the
+ * median, else the number of outliers ) and a bounded min-heap of its
+ * highest values, stored next to each other in one buffer.  Each added
+ * image costs no allocation, and the values are sorted once, when the
+ * output is finalized.
+ *
  * All Inputed images are assumed to have the same spacing, origin.
  * Optionally, if the tag DynamicallyAdjustOutputSize() is used, then the
  * size many vary and the images will be updated to insure the largest region
@@ -147,84 +160,55 @@ protected:
   typedef typename Superclass::ProcessImagePointer      ProcessImagePointer;
   typedef typename Superclass::CountImagePointer        CountImagePointer;
 
-  typedef ImageRegionIterator<InputImageType>           InputIteratorType;
-
   typedef typename Superclass::InputConstIteratorType
     InputConstIteratorType;
-  typedef typename Superclass::ProcessConstIteratorType
-    ProcessConstIteratorType;
-  typedef typename Superclass::ProcessIteratorType
-    ProcessIteratorType;
   typedef typename Superclass::CountConstIteratorType
     CountConstIteratorType;
-  typedef typename Superclass::CountIteratorType
-    CountIteratorType;
   typedef typename Superclass::OutputMeanIteratorType
     OutputMeanIteratorType;
-  typedef typename Superclass::OutputSigmaIteratorType
-    OutputSigmaIteratorType;
-
-  typedef typename std::vector<InputImagePointer>       InputImageListType;
 
   /**
-   * Build new processing images ( i.e., sumImage, sumSquareImage,
-   * validCountImage )
+   * Build new processing images ( i.e., runningMeanImage,
+   * sumOfSquaredDeviationsImage, validCountImage ) and the buffer of
+   * extreme values
    */
-  void BuildProcessingImages( InputImagePointer i );
+  void BuildProcessingImages( InputImagePointer i ) override;
 
-  /**
-   * Get the ordered image list representing the lower half of voxel values.
-   * Used to determine median.  Order is ascending pixel value
-   */
-  InputImageListType& GetLowerOutlierImages( void )
-    { return m_LowerOutlierImages; }
+  /** Accumulate the tile and insert its values into the heaps */
+  void AccumulateRegion( const InputImageType * image,
+    const RegionType & region ) override;
 
-  /**
-   * Set the ordered image list representing the lower half of voxel values.
-   * Used to determine median.
-   */
-  void  SetLowerOutlierImages( InputImageListType& list )
-    { m_LowerOutlierImages = list; }
+  bool UseMedian( void )
+    { return ( m_TotalNumberOfImages > 0 ); }
 
   /**
-   * Get the ordered image list representing the upper outlier values.
-   * Size is dependent on the number of outliers to remove for robust
-   * standard deviation calculation.  Used to determine sigma calculations.
-   * Order is descending starting from highest intensity
+   * Builds median image from the sorted lowest values. Can only
+   * be ( reasonably ) called after the values have been sorted by
+   * FinalizeOutput()
    */
-  InputImageListType& GetUpperOutlierImages( void )
-    { return m_UpperOutlierImages; }
+  OutputMeanImagePointer  GetMedianImage();
+
+private:
 
   /**
-   * Set the ordered image list representing the upper outlier values.
-   * Size is dependent on the number of outliers to remove for robust
-   * standard deviation calculation. Used to determine sigma calculations.
-   * Order is descending starting from highest intensity
+   * Insert value into a heap of size values and at most capacity values,
+   * which keeps the values first in the order given by compare
    */
-  void SetUpperOutlierImages( InputImageListType& list )
-    { m_UpperOutlierImages = list; }
+  template< class TCompare >
+  static void InsertIntoHeap( InputPixelType * heap, unsigned int size,
+    unsigned int capacity, InputPixelType value, TCompare compare );
 
-  void SetUpperImages( InputImagePointer i );
-  void SetLowerImages( InputImagePointer i );
-  void SetMedianImages( InputImagePointer i );
-
-  InputImagePointer GetImageCopy( InputImagePointer );
-  InputImageListType& AddToUpdateImageList( InputImagePointer input,
-    InputImageListType& list, bool ListIsAscending );
-
-  bool UseMedian( void )
-    { return ( m_TotalNumberOfImages > 0 ); }
+  /** Remove value from the running statistics of a voxel */
+  static void RemoveValue( InputPixelType value, CountPixelType & count,
+    ProcessPixelType & mean, ProcessPixelType & sumOfSquaredDeviations );
 
   /**
-   * Builds median image from the LowerOutlierImages. Can only
-   * be ( reasonably ) called after at least 1 image has been added
+   * Per voxel, NumberOfLowerValues lowest values followed by
+   * NumberOfUpperValues highest values
    */
-  OutputMeanImagePointer  GetMedianImage();
-
-private:
-
-  InputImageListType                      m_LowerOutlierImages;
-  InputImageListType                      m_UpperOutlierImages;
+  std::vector< InputPixelType >           m_ExtremeValues;
+  unsigned int                            m_NumberOfLowerValues;
+  unsigned int                            m_NumberOfUpperValues;
 
   unsigned int                            m_NumberOfOutlierImagesToRemove;
   unsigned int                            m_TotalNumberOfImages;
@@ -30,7 +30,9 @@ template< class TInputImageType, class TOutputMeanImageType,
 RobustMeanAndSigmaImageBuilder< TInputImageType, TOutputMeanImageType,
   TOutputSigmaImageType >
 ::RobustMeanAndSigmaImageBuilder( void )
-: m_NumberOfOutlierImagesToRemove( 0 ),
+: m_NumberOfLowerValues( 0 ),
+  m_NumberOfUpperValues( 0 ),
+  m_NumberOfOutlierImagesToRemove( 0 ),
   m_TotalNumberOfImages( 0 )
 {
 }
@@ -44,88 +46,48 @@ RobustMeanAndSigmaImageBuilder< TInputImageType, TOutputMeanImageType,
 {
   Superclass::BuildProcessingImages( image );
 
-  InputImageListType  lowerImages = this->GetLowerOutlierImages();
-  InputImageListType  upperImages = this->GetUpperOutlierImages();
+  unsigned int nOutliers = this->GetNumberOfOutlierImagesToRemove();
+  m_NumberOfLowerValues = nOutliers;
+  m_NumberOfUpperValues = nOutliers;
 
-  for( unsigned int i = 0; i < this->GetNumberOfOutlierImagesToRemove();
-    i++ )
-    {
-    InputImagePointer lowerImage = InputImageType::New();
-    lowerImage->SetRegions( image->GetLargestPossibleRegion() );
-    lowerImage->SetSpacing( image->GetSpacing() );
-    lowerImage->SetOrigin( image->GetOrigin() );
-    lowerImage->Allocate();
-    lowerImage->FillBuffer( NumericTraits<InputPixelType>::max() );
-
-    InputImagePointer upperImage = InputImageType::New();
-    upperImage->SetRegions( image->GetLargestPossibleRegion() );
-    upperImage->SetSpacing( image->GetSpacing() );
-    upperImage->SetOrigin( image->GetOrigin() );
-    upperImage->Allocate();
-    upperImage->FillBuffer(
-      NumericTraits<InputPixelType>::NonpositiveMin() );
-
-    lowerImages.push_back( lowerImage );
-    upperImages.push_back( upperImage );
-    ::tube::FmtInfoMessage( "Building outlier image %d!", i );
-    }
-
-  // Add additional images to the lower outlier list if the median is used
+  // Keep additional lower values if the median is used to insure that
+  // all possible median values are covered
   if( UseMedian() )
     {
-    // Number of remaining images to add to lower group to insure that
-    // all possible median values are covered
-    unsigned int nTotal = this->GetTotalNumberOfImages();
-    unsigned int nOutliers = this->GetNumberOfOutlierImagesToRemove();
-    unsigned int remaining = ( nTotal / 2 ) + 1 - nOutliers;
-    ::tube::FmtInfoMessage( "Images remaining to build: %d!", remaining );
-
-    for( unsigned int i = 0; i < remaining; i++ )
-      {
-      InputImagePointer lowerImage = InputImageType::New();
-      lowerImage->SetRegions( image->GetLargestPossibleRegion() );
-      lowerImage->SetSpacing( image->GetSpacing() );
-      lowerImage->SetOrigin( image->GetOrigin() );
-      lowerImage->Allocate();
-      lowerImage->FillBuffer( NumericTraits<InputPixelType>::max() );
-
-      lowerImages.push_back( lowerImage );
-      }
+    m_NumberOfLowerValues = std::max( nOutliers,
+      this->GetTotalNumberOfImages() / 2 + 1 );
     }
-  ::tube::FmtInfoMessage( "This is the lower list size: %d",
-    lowerImages.size() );
+  ::tube::FmtInfoMessage( "Keeping %d lower and %d upper values per voxel",
+    m_NumberOfLowerValues, m_NumberOfUpperValues );
 
-  this->SetLowerOutlierImages( lowerImages );
-  this->SetUpperOutlierImages( upperImages );
+  const SizeValueType numberOfPixels =
+    this->GetValidCountImage()->GetBufferedRegion().GetNumberOfPixels();
+  m_ExtremeValues.assign( numberOfPixels
+    * ( m_NumberOfLowerValues + m_NumberOfUpperValues ), 0 );
 }
 
 template< class TInputImageType, class TOutputMeanImageType,
   class TOutputSigmaImageType >
+template< class TCompare >
 void
 RobustMeanAndSigmaImageBuilder< TInputImageType, TOutputMeanImageType,
   TOutputSigmaImageType >
-::AddImage( InputImagePointer i )
+::InsertIntoHeap( InputPixelType * heap, unsigned int size,
+  unsigned int capacity, InputPixelType value, TCompare compare )
 {
-  // Add image to running total for the variance calculation
-  Superclass::AddImage( i );
-
-  InputImagePointer medianCopy  = GetImageCopy( i );
-  InputImagePointer upperCopy   = GetImageCopy( i );
-
-  // Update the median image list
-  if( this->UseMedian() )
+  if( size < capacity )
     {
-    // ** Update the lower half of the images
-    SetMedianImages( i );
+    heap[size] = value;
+    std::push_heap( heap, heap + size + 1, compare );
     }
-  else
+  else if( capacity > 0 && compare( value, heap[0] ) )
     {
-    // Update the lower outlying images
-    SetLowerImages( i );
+    // Replace the value at the top of the heap, i.e., the one that is
+    // last in the kept order
+    std::pop_heap( heap, heap + capacity, compare );
+    heap[capacity - 1] = value;
+    std::push_heap( heap, heap + capacity, compare );
     }
-
-  // Update the upper outlying images
-  SetUpperImages( i );
 }
 
 template< class TInputImageType, class TOutputMeanImageType,
@@ -133,111 +95,83 @@ template< class TInputImageType, class TOutputMeanImageType,
 void
 RobustMeanAndSigmaImageBuilder< TInputImageType, TOutputMeanImageType,
   TOutputSigmaImageType >
-::SetMedianImages( InputImagePointer i )
+::AccumulateRegion( const InputImageType * image,
+  const RegionType & region )
 {
-  // Get image copy, such that input pointer is not changed by fun
-  InputImagePointer image = GetImageCopy( i );
+  Superclass::AccumulateRegion( image, region );
 
-  bool isAscending = true;
-  AddToUpdateImageList( image, this->GetLowerOutlierImages(), isAscending );
+  const unsigned int nLower = m_NumberOfLowerValues;
+  const unsigned int nUpper = m_NumberOfUpperValues;
+  const unsigned int stride = nLower + nUpper;
+  if( stride == 0 )
+    {
+    return;
+    }
 
-}
+  const CountImageType * validImage = this->GetValidCountImage();
+  ImageRegionConstIteratorWithIndex< InputImageType > it_input( image,
+    region );
+  CountConstIteratorType it_valid( validImage, region );
+  while( !it_input.IsAtEnd() )
+    {
+    InputPixelType p = it_input.Get();
 
-template< class TInputImageType, class TOutputMeanImageType,
-  class TOutputSigmaImageType >
-void
-RobustMeanAndSigmaImageBuilder< TInputImageType, TOutputMeanImageType,
-  TOutputSigmaImageType >
-::SetLowerImages( InputImagePointer i )
-{
-  bool isAscending = true;
-  InputImagePointer image = GetImageCopy( i );
-  AddToUpdateImageList( image, this->GetLowerOutlierImages(), isAscending );
+    // Do not count a pixel if user requests to threshold and the pixel
+    // is below the threshold ( same as itkMeanAndSigmaImageBuilder )
+    if( !this->GetThresholdInputImageBelowOn()
+      || p > this->GetThresholdInputImageBelow() )
+      {
+      // The count already includes p
+      const unsigned int count =
+        static_cast< unsigned int >( it_valid.Get() ) - 1;
+      InputPixelType * lower = &m_ExtremeValues[ stride
+        * validImage->ComputeOffset( it_input.GetIndex() ) ];
+      InsertIntoHeap( lower, std::min( count, nLower ), nLower, p,
+        std::less< InputPixelType >() );
+      InsertIntoHeap( lower + nLower, std::min( count, nUpper ), nUpper, p,
+        std::greater< InputPixelType >() );
+      }
+    ++it_input;
+    ++it_valid;
+    }
 }
 
 template< class TInputImageType, class TOutputMeanImageType,
   class TOutputSigmaImageType >
 void
-RobustMeanAndSigmaImageBuilder< TInputImageType, TOutputMeanImageType,
-  TOutputSigmaImageType>
-::SetUpperImages( InputImagePointer i )
-{
-  bool isAscending = false;
-  InputImagePointer image = GetImageCopy( i );
-  AddToUpdateImageList( image, this->GetUpperOutlierImages(), isAscending );
-}
-
-template< class TInputImageType, class TOutputMeanImageType,
-  class TOutputSigmaImageType >
-typename RobustMeanAndSigmaImageBuilder< TInputImageType,
-  TOutputMeanImageType, TOutputSigmaImageType >::InputImageListType&
 RobustMeanAndSigmaImageBuilder< TInputImageType, TOutputMeanImageType,
   TOutputSigmaImageType >
-::AddToUpdateImageList( InputImagePointer input, InputImageListType& list,
-  bool ListIsAscending )
+::RemoveValue( InputPixelType value, CountPixelType & count,
+  ProcessPixelType & mean, ProcessPixelType & sumOfSquaredDeviations )
 {
-  // List is filled from front to back and assumed to be in ascending order
-  InputIteratorType  it_input( input, input->GetLargestPossibleRegion() );
-  for( int i = 0; i < list.size(); i ++ )
+  if( count <= 1 )
     {
-    InputIteratorType  it_list( list[i],
-      list[i]->GetLargestPossibleRegion() );
+    count = 0;
+    mean = 0;
+    sumOfSquaredDeviations = 0;
+    return;
+    }
 
-    it_input.GoToBegin();
-    it_list.GoToBegin();
-    while( !it_list.IsAtEnd() && !it_input.IsAtEnd() )
-      {
-      // Do not count a pixel if user requests to threshold and the pixel
-      // is below the threshold
-      if( this->GetThresholdInputImageBelowOn() &&
-          it_input.Get() <= this->GetThresholdInputImageBelow() )
-        {
-        // Do nothing for this pixel ( should not be included in
-        // calcualations ( same as itkMeanAndSigmaImageBuilder )
-        }
-      /* List is ascending & the input value is less than list swap,
-       * and vice versa */
-      else if( ( ListIsAscending && it_input.Get() < it_list.Get() ) ||
-        ( !ListIsAscending && it_input.Get() > it_list.Get() ) )
-        {
-        // Swap the values and continue
-        InputPixelType tmp = it_list.Get();
-        it_list.Set( it_input.Get() );
-        it_input.Set( tmp );
-        }
-      ++it_input;
-      ++it_list;
-      }
+  // Welford's update, reversed
+  const ProcessPixelType newMean = ( count * mean - value ) / ( count - 1 );
+  sumOfSquaredDeviations -= ( value - mean ) * ( value - newMean );
+  if( sumOfSquaredDeviations < 0 )
+    {
+    sumOfSquaredDeviations = 0;
     }
-  return list;
+  mean = newMean;
+  count -= 1;
 }
 
 template< class TInputImageType, class TOutputMeanImageType,
   class TOutputSigmaImageType >
-typename RobustMeanAndSigmaImageBuilder< TInputImageType,
-  TOutputMeanImageType, TOutputSigmaImageType >::InputImagePointer
+void
 RobustMeanAndSigmaImageBuilder< TInputImageType, TOutputMeanImageType,
   TOutputSigmaImageType >
-::GetImageCopy( InputImagePointer input )
+::AddImage( InputImagePointer i )
 {
-  InputImagePointer copy = InputImageType::New();
-  copy->SetRegions( input->GetLargestPossibleRegion() );
-  copy->SetSpacing( input->GetSpacing() );
-  copy->SetOrigin( input->GetOrigin() );
-  copy->Allocate();
-
-  InputConstIteratorType it_input( input, input->
-    GetLargestPossibleRegion() );
-  InputIteratorType it_copy( copy, copy->GetLargestPossibleRegion() );
-
-  while( !it_input.IsAtEnd() )
-    {
-    it_copy.Set( it_input.Get() );
-
-    ++it_input;
-    ++it_copy;
-    }
-  return copy;
+  // Add image to the running statistics and to the extreme values
+  Superclass::AddImage( i );
 }
 
 template< class TInputImageType, class TOutputMeanImageType,
@@ -253,60 +187,50 @@ RobustMeanAndSigmaImageBuilder< TInputImageType, TOutputMeanImageType,
     return;
     }
 
-  InputImageListType  lowInputs   = this->GetLowerOutlierImages();
-  InputImageListType  highInputs  = this->GetUpperOutlierImages();
-
-  ProcessImagePointer sumImage        = this->GetSumImage();
-  ProcessImagePointer sumSquareImage  = this->GetSumSquareImage();
-  CountImagePointer   validImages     = this->GetValidCountImage();
-
-  // Output region is defined by the size of the images ( i.e., the largest
-  // possible region )
-  ProcessIteratorType it_sum( sumImage, sumImage->
-    GetLargestPossibleRegion() );
-  ProcessIteratorType it_sumSqr( sumSquareImage, sumSquareImage->
-    GetLargestPossibleRegion() );
-  CountIteratorType   it_valid( validImages, validImages->
-    GetLargestPossibleRegion() );
-
-  unsigned int outlierImage = this->GetNumberOfOutlierImagesToRemove();
-  for( unsigned int i = 0; i < outlierImage; i++ )
-    {
-    it_sum.GoToBegin();
-    it_sumSqr.GoToBegin();
-    it_valid.GoToBegin();
-
-    InputConstIteratorType it_lowInput( lowInputs[i],
-      lowInputs[i]->GetLargestPossibleRegion() );
-    InputConstIteratorType it_highInput( highInputs[i],
-      highInputs[i]->GetLargestPossibleRegion() );
-
-    while( !it_lowInput.IsAtEnd() )
+  CountPixelType   * valid = this->GetValidCountImage()->GetBufferPointer();
+  ProcessPixelType * mean = this->GetRunningMeanImage()->GetBufferPointer();
+  ProcessPixelType * ssd =
+    this->GetSumOfSquaredDeviationsImage()->GetBufferPointer();
+  const SizeValueType numberOfPixels =
+    this->GetValidCountImage()->GetBufferedRegion().GetNumberOfPixels();
+
+  const unsigned int nLower = m_NumberOfLowerValues;
+  const unsigned int nUpper = m_NumberOfUpperValues;
+  const unsigned int stride = nLower + nUpper;
+  const unsigned int outlierImage = this->GetNumberOfOutlierImagesToRemove();
+
+  // Sort the extreme values of each voxel, lowest values ascending and
+  // highest values descending, padded as if unset values were outliers,
+  // and remove the outliers from the running statistics
+  MultiThreaderBase::Pointer threader = MultiThreaderBase::New();
+  threader->ParallelizeArray( 0, stride > 0 ? numberOfPixels : 0,
+    [&]( SizeValueType v )
       {
-      if( it_valid.Get() > 2*outlierImage )
+      InputPixelType * lower = &m_ExtremeValues[ stride * v ];
+      InputPixelType * upper = lower + nLower;
+      const unsigned int count = static_cast< unsigned int >( valid[v] );
+      const unsigned int sizeLower = std::min( count, nLower );
+      const unsigned int sizeUpper = std::min( count, nUpper );
+      std::sort( lower, lower + sizeLower );
+      std::fill( lower + sizeLower, lower + nLower,
+        NumericTraits< InputPixelType >::max() );
+      std::sort( upper, upper + sizeUpper,
+        std::greater< InputPixelType >() );
+      std::fill( upper + sizeUpper, upper + nUpper,
+        NumericTraits< InputPixelType >::NonpositiveMin() );
+
+      for( unsigned int i = 0; i < outlierImage; i++ )
         {
-        ProcessPixelType  sumValue    = it_lowInput.Get() +
-          it_highInput.Get();
-        ProcessPixelType  sumSqrValue = it_lowInput.Get() *
-          it_lowInput.Get() + it_highInput.Get() * it_highInput.Get();
-        it_sum.Set( it_sum.Get() - sumValue );
-        it_sumSqr.Set( it_sumSqr.Get() - sumSqrValue );
-        it_valid.Set( it_valid.Get() - 2 );
+        if( valid[v] > 2*outlierImage )
+          {
+          RemoveValue( lower[i], valid[v], mean[v], ssd[v] );
+          RemoveValue( upper[i], valid[v], mean[v], ssd[v] );
+          }
         }
-
-      ++it_lowInput;
-      ++it_highInput;
-      ++it_sum;
-      ++it_sumSqr;
-      ++it_valid;
-      }
-    }
-  SetSumImage( sumImage );
-  SetSumSquareImage( sumSquareImage );
-  SetValidCountImage( validImages );
+      }, nullptr );
 
   // Run the finalization using the superclass ( NOTE: Must occur AFTER the
-  // subtraction of the outlier images from the summed images )
+  // removal of the outliers from the running statistics )
   Superclass::FinalizeOutput();
 
   // NOTE: Must occur after the Superclass call to FinalizeOutput() --
@@ -314,8 +238,11 @@ RobustMeanAndSigmaImageBuilder< TInputImageType, TOutputMeanImageType,
   if( UseMedian() )
     {
     // Build the median image and replace the mean with the median
-    SetOutputMeanImage( this->GetMedianImage() );
+    this->SetOutputMeanImage( this->GetMedianImage() );
     }
+
+  // Release the extreme values
+  std::vector< InputPixelType >().swap( m_ExtremeValues );
 }
 
 template< class TInputImageType, class TOutputMeanImageType,
@@ -327,60 +254,38 @@ RobustMeanAndSigmaImageBuilder< TInputImageType, TOutputMeanImageType,
 ::GetMedianImage( void )
 {
   unsigned int totalNumImages = this->GetTotalNumberOfImages();
-  InputImageListType lowerImages = this->GetLowerOutlierImages();
-
   unsigned int numImages = totalNumImages/2;
-  typename InputImageType::ConstPointer lastLowerImage =
-    lowerImages[numImages];
+  const unsigned int stride = m_NumberOfLowerValues + m_NumberOfUpperValues;
 
-  // Build output median image
+  // Build output median image on the grid of the count image, whose
+  // buffer is laid out as the extreme values
+  const CountImageType * validImage = this->GetValidCountImage();
   OutputMeanImagePointer medianImage = OutputMeanImageType::New();
-  medianImage->SetRegions( lastLowerImage->GetLargestPossibleRegion() );
-  medianImage->SetSpacing( lastLowerImage->GetSpacing() );
-  medianImage->SetOrigin( lastLowerImage->GetOrigin() );
+  medianImage->SetRegions( validImage->GetBufferedRegion() );
+  medianImage->SetSpacing( validImage->GetSpacing() );
+  medianImage->SetOrigin( validImage->GetOrigin() );
   medianImage->Allocate();
 
   OutputMeanIteratorType it_median( medianImage, medianImage->
     GetLargestPossibleRegion() );
-  // Odd number
-  if( ( totalNumImages % 2 ) )
+  const InputPixelType * lower = &m_ExtremeValues[0];
+  while( !it_median.IsAtEnd() )
     {
-    InputConstIteratorType it_middle( lastLowerImage, lastLowerImage->
-      GetLargestPossibleRegion() );
-    it_middle.GoToBegin();
-    it_median.GoToBegin();
-
-    while( !it_middle.IsAtEnd() )
+    // Odd number
+    if( ( totalNumImages % 2 ) )
       {
-      it_median.Set( it_middle.Get() );
-      ++it_middle;
-      ++it_median;
+      it_median.Set( lower[numImages] );
       }
-    }
-  // Even number
-  else
-    {
-    InputConstIteratorType it_middle1( lastLowerImage, lastLowerImage->
-      GetLargestPossibleRegion() );
-    typename InputImageType::ConstPointer prevLowerImage =
-      lowerImages[numImages - 1];
-    InputConstIteratorType it_middle2( prevLowerImage,
-      prevLowerImage->GetLargestPossibleRegion() );
-
-    it_middle1.GoToBegin();
-    it_middle2.GoToBegin();
-    it_median.GoToBegin();
-    while( !it_middle1.IsAtEnd() && !it_middle2.IsAtEnd() )
+    // Even number
+    else
       {
       // Average the values
-      OutputMeanPixelType median =  ( double( it_middle1.Get() ) +
-                                      double( it_middle2.Get() ) ) / 2;
+      OutputMeanPixelType median =  ( double( lower[numImages] ) +
+                                      double( lower[numImages - 1] ) ) / 2;
       it_median.Set( median );
-
-      ++it_middle1;
-      ++it_middle2;
-      ++it_median;
       }
+    lower += stride;
+    ++it_median;
     }
   return medianImage;
 }
@@ -398,42 +303,35 @@ RobustMeanAndSigmaImageBuilder< TInputImageType, TOutputMeanImageType,
     return;
     }
 
-  Superclass::UpdateOutputImageSize( inputSize );
+  CountImagePointer oldValidImage = this->GetValidCountImage();
 
-  typedef ResampleImageFilter<InputImageType, InputImageType>
-    ResampleInputImageType;
-
-  InputImageListType  lowerList = this->GetLowerOutlierImages();
+  Superclass::UpdateOutputImageSize( inputSize );
 
-  typename InputImageListType::const_iterator  it_lower = lowerList.begin();
-  while( it_lower != lowerList.end() )
+  // Move the extreme values of the voxels kept to their new place; the
+  // new voxels have no values yet
+  const CountImageType * validImage = this->GetValidCountImage();
+  if( validImage == oldValidImage.GetPointer() )
     {
-    typename ResampleInputImageType::Pointer filter =
-      ResampleInputImageType::New();
-    filter->SetInput( *it_lower );
-    filter->SetSize( inputSize );
-    filter->SetOutputSpacing( ( *it_lower )->GetSpacing() );
-    filter->SetOutputOrigin( ( *it_lower )->GetOrigin() );
-    filter->Update();
-
-    ++it_lower;
+    return;
     }
-
-  InputImageListType  upperList = this->GetUpperOutlierImages();
-
-  typename InputImageListType::const_iterator  it_upper = upperList.begin();
-  while( it_upper != upperList.end() )
+  const unsigned int stride = m_NumberOfLowerValues + m_NumberOfUpperValues;
+  std::vector< InputPixelType > extremeValues( stride
+    * validImage->GetBufferedRegion().GetNumberOfPixels(), 0 );
+  RegionType region = validImage->GetBufferedRegion();
+  if( stride > 0 && region.Crop( oldValidImage->GetBufferedRegion() ) )
     {
-    typename ResampleInputImageType::Pointer filter =
-      ResampleInputImageType::New();
-    filter->SetInput( *it_upper );
-    filter->SetSize( inputSize );
-    filter->SetOutputSpacing( ( *it_upper )->GetSpacing() );
-    filter->SetOutputOrigin( ( *it_upper )->GetOrigin() );
-    filter->Update();
-
-    ++it_upper;
+    ImageRegionConstIteratorWithIndex< CountImageType > it( validImage,
+      region );
+    while( !it.IsAtEnd() )
+      {
+      const InputPixelType * oldValues = &m_ExtremeValues[ stride
+        * oldValidImage->ComputeOffset( it.GetIndex() ) ];
+      std::copy( oldValues, oldValues + stride, &extremeValues[ stride
+        * validImage->ComputeOffset( it.GetIndex() ) ] );
+      ++it;
+      }
     }
+  m_ExtremeValues.swap( extremeValues );
 }
 
 #endif // End !defined( __itktubeRobustMeanAndSigmaImageBuilder_hxx )
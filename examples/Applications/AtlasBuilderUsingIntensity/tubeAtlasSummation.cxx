@@ -36,6 +36,7 @@ AtlasSummation
 
   m_AdjustResampledImageSize    = false;
   m_AdjustResampledImageOrigin  = false;
+  m_UseFixedOutputGrid          = false;
 
   m_OutputSize.Fill( 256 );
   m_OutputSpacing.Fill( 1 );
@@ -71,7 +72,27 @@ void AtlasSummation
 ::AddImage( InputImageType::Pointer image, TransformType::Pointer t )
 {
   InputImageType::Pointer image2 = image;
-  if( m_AdjustResampledImageSize || m_AdjustResampledImageOrigin )
+  if( m_UseFixedOutputGrid )
+    {
+    if( !m_IsProcessing )
+      {
+      Start( image );
+      m_MeanBuilder->SetOutputSize( m_OutputSizeSet ? m_OutputSize
+        : image->GetLargestPossibleRegion().GetSize() );
+      m_MeanBuilder->SetOutputSpacing( m_OutputSpacingSet ? m_OutputSpacing
+        : image->GetSpacing() );
+      m_MeanBuilder->SetOutputOrigin( m_OutputOriginSet ? m_OutputOrigin
+        : image->GetOrigin() );
+      m_MeanBuilder->UseFixedOutputGridOn();
+      m_IsProcessing = true;
+      }
+
+    image2 = TransformInputImage( image, t,
+      m_MeanBuilder->GetOutputSize(),
+      m_MeanBuilder->GetOutputSpacing(),
+      m_MeanBuilder->GetOutputOrigin() );
+    }
+  else if( m_AdjustResampledImageSize || m_AdjustResampledImageOrigin )
     {
     // Form the clipped image and update the base image if necessary
     image = GetClippedImage( image, t );
@@ -123,9 +144,34 @@ void AtlasSummation
 }
 
 
+AtlasSummation::InputImagePointer AtlasSummation
+::ResampleImage( InputImageType::Pointer image,
+  TransformType::Pointer t ) const
+{
+  if( !this->GetOutputGridIsFinal() )
+    {
+    ::tube::ErrorMessage( "Output grid is not final, use AddImage()!" );
+    return nullptr;
+    }
+
+  return TransformInputImage( image, t,
+    m_MeanBuilder->GetOutputSize(),
+    m_MeanBuilder->GetOutputSpacing(),
+    m_MeanBuilder->GetOutputOrigin() );
+}
+
+
+void AtlasSummation
+::AddResampledImage( InputImageType::Pointer image )
+{
+  m_MeanBuilder->AddImage( image );
+  ++m_ImageNumber;
+}
+
+
 AtlasSummation::InputImagePointer AtlasSummation
 ::TransformInputImage( InputImagePointer image, TransformPointer trans,
-  SizeType size, SpacingType spacing, PointType origin )
+  SizeType size, SpacingType spacing, PointType origin ) const
 {
   // Realign image to the base Image specifications. If no adjustments
   // are done to the image, then add the transform to the filter as well
@@ -106,6 +106,30 @@ public:
    * Transform */
   void AddImage( InputImageType::Pointer, TransformType::Pointer );
 
+  /**
+   * Whether the output grid can no longer change, i.e., the first image
+   * was added and the output size and origin are not adjusted to the
+   * images.  Images can then be resampled with ResampleImage() apart from
+   * their addition.
+   */
+  bool GetOutputGridIsFinal( void ) const
+    {
+    return m_IsProcessing && ( m_UseFixedOutputGrid
+      || ( !m_AdjustResampledImageSize && !m_AdjustResampledImageOrigin ) );
+    }
+
+  /**
+   * Resample image WITH transform -- Receives Moving -> Fixed Image
+   * Transform -- onto the output grid, for AddResampledImage().  Requires
+   * GetOutputGridIsFinal(); can then be called from several threads at
+   * once, including while another image is being added.
+   */
+  InputImagePointer ResampleImage( InputImageType::Pointer,
+    TransformType::Pointer ) const;
+
+  /** Add an image returned by ResampleImage() */
+  void AddResampledImage( InputImageType::Pointer );
+
   /** Build Mean and variance image & end AddImage() addition abilities */
   void Finalize( void );
 
@@ -203,6 +227,21 @@ public:
   void AdjustResampledImageOrigin( bool adjustResampledImageOrigin )
     { m_AdjustResampledImageOrigin = adjustResampledImageOrigin; }
 
+  /**
+   * Resample every image, including the first, onto a fixed output grid
+   * given by the output size, spacing and origin ( those not set are
+   * taken from the first image ).  The accumulated images are then never
+   * resampled as images are added, and the size and origin adjustments
+   * are ignored.
+   *
+   * Note: Needs to be called BEFORE adding the first image!!!
+   */
+  void UseFixedOutputGrid( bool useFixedOutputGrid )
+    { m_UseFixedOutputGrid = useFixedOutputGrid; }
+
+  bool GetUseFixedOutputGrid( void ) const
+    { return m_UseFixedOutputGrid; }
+
 
 private:
   /**
@@ -233,7 +272,7 @@ private:
   /** Resample the given image with transform & parameters */
   InputImagePointer TransformInputImage( InputImagePointer image,
     TransformPointer trans, SizeType size, SpacingType spacing,
-    PointType origin );
+    PointType origin ) const;
 
   void Start( InputImageType::Pointer );
   void SumImage( InputImageType::Pointer );
@@ -271,6 +310,7 @@ private:
   bool                           m_IsProcessing;   // Indicates processing
   bool                           m_AdjustResampledImageSize;
   bool                           m_AdjustResampledImageOrigin;
+  bool                           m_UseFixedOutputGrid;
 
   int                            m_Count;
 
@@ -27,6 +27,7 @@ limitations under the License.
 #include <exception>
 
 #include "tubeMacro.h"
+#include "tubeProfiler.h"
 
 #include <itkImage.h>
 #include <itkImageIOFactory.h>
@@ -156,6 +157,42 @@ int ParseArgsAndCallDoIt( const std::string & inputImage, int argc,
   return EXIT_SUCCESS;
 }
 
+// Call DoIt as above, with the profiler recording if profileOutput is
+// set.  The recorded scopes and counters are written to profileOutput as
+// a Chrome trace if it ends in ".trace" or ".trace.json", and as a JSON
+// report otherwise.
+int ParseArgsAndCallDoIt( const std::string & inputImage,
+                          const std::string & profileOutput, int argc,
+                          char * argv[] )
+{
+  if( profileOutput.empty() )
+    {
+    return ParseArgsAndCallDoIt( inputImage, argc, argv );
+    }
+
+  std::string programName = argv[0];
+  std::string::size_type slash = programName.find_last_of( "/\\" );
+  if( slash != std::string::npos )
+    {
+    programName = programName.substr( slash + 1 );
+    }
+
+  Profiler & profiler = Profiler::GetInstance();
+  profiler.Reset();
+  profiler.SetEnabled( true );
+  profiler.BeginScope( programName );
+  int result = ParseArgsAndCallDoIt( inputImage, argc, argv );
+  profiler.EndScope();
+  profiler.SetEnabled( false );
+
+  if( !profiler.WriteFile( profileOutput ) )
+    {
+    tubeErrorMacro( << "Cannot write profile to " << profileOutput );
+    return EXIT_FAILURE;
+    }
+  return result;
+}
+
 } // End namespace tube
 
 #endif // End !defined( __tubeCLIHelperFunctions_h )
@@ -86,8 +86,43 @@ int DoIt( int argc, char * argv[] )
   similarityCalculator->SetInput2( reader2->GetOutput() );
   similarityCalculator->SetSamplingRate( samplingRate );
   similarityCalculator->SetUseCorrelation( correlation );
+  similarityCalculator->SetNumberOfHistogramBins( histogramBins );
+
+  // read the additional moving images, scored in the same pass
+  for( unsigned int i = 0; i < movingVolumes.size(); ++i )
+    {
+    typename ReaderType::Pointer reader = ReaderType::New();
+    try
+      {
+      reader->SetFileName( movingVolumes[i].c_str() );
+      reader->Update();
+      }
+    catch( itk::ExceptionObject & err )
+      {
+      tube::ErrorMessage( "Error reading moving image " + movingVolumes[i]
+                          + ": " + std::string( err.GetDescription() ) );
+      return EXIT_FAILURE;
+      }
+    similarityCalculator->AddMovingImage( reader->GetOutput() );
+    }
+
+  try
+    {
+    similarityCalculator->Update();
+    }
+  catch( itk::ExceptionObject & err )
+    {
+    tube::ErrorMessage( "Error computing similarity: "
+                        + std::string( err.GetDescription() ) );
+    return EXIT_FAILURE;
+    }
 
   std::cout << similarityCalculator->GetOutput() << std::endl;
+  std::vector< double > outputs = similarityCalculator->GetOutputs();
+  for( unsigned int i = 0; i < outputs.size(); ++i )
+    {
+    std::cout << outputs[i] << std::endl;
+    }
 
   return EXIT_SUCCESS;
 }
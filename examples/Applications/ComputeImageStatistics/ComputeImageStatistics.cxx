@@ -109,6 +109,11 @@ int DoIt( int argc, char * argv[] )
   statisticsCalculator->SetInput( volumeReader->GetOutput() );
   statisticsCalculator->SetInputMask( maskReader->GetOutput() );
   statisticsCalculator->SetQuantiles( quantiles );
+  if( !labels.empty() )
+    {
+    std::vector< TPixel > maskLabels( labels.begin(), labels.end() );
+    statisticsCalculator->SetLabels( maskLabels );
+    }
   statisticsCalculator->Update();
 
   if( ! csvStatisticsFile.empty() )
@@ -59,8 +59,10 @@ int DoIt( int argc, char * argv[] )
   typedef tube::Write4DImageFrom3DImages< InputImageType > FilterType;
 
   typename FilterType::Pointer filter = FilterType::New();
-  unsigned int num3DImages = argc-2;
+  unsigned int num3DImages = inputImageFileNames.size();
   filter->SetNumberOfInputImages( num3DImages );
+  filter->SetFileName( outputImageFileName );
+  filter->SetStreamFrames( streamFrames );
 
   timeCollector.Start( "Load data" );
   double progress = 0.0;
@@ -81,15 +83,34 @@ int DoIt( int argc, char * argv[] )
       timeCollector.Report();
       return EXIT_FAILURE;
       }
-    filter->SetNthInputImage( i, reader->GetOutput() );
+    try
+      {
+      filter->SetNthInputImage( i, reader->GetOutput() );
+      }
+    catch( itk::ExceptionObject & err )
+      {
+      tube::ErrorMessage( "Writing volume: Exception caught: "
+                          + std::string( err.GetDescription() ) );
+      timeCollector.Report();
+      return EXIT_FAILURE;
+      }
 
     progress = i * 0.75/num3DImages;
     progressReporter.Report( progress );
     }
   timeCollector.Stop( "Load data" );
 
-  filter->SetFileName( outputImageFileName );
-  filter->Write();
+  try
+    {
+    filter->Write();
+    }
+  catch( itk::ExceptionObject & err )
+    {
+    tube::ErrorMessage( "Writing volume: Exception caught: "
+                        + std::string( err.GetDescription() ) );
+    timeCollector.Report();
+    return EXIT_FAILURE;
+    }
 
   progress = 1.0;
   progressReporter.Report( progress );
@@ -21,6 +21,7 @@ limitations under the License.
 
 =========================================================================*/
 
+#include <algorithm>
 #include <ios>
 
 #include "tubeMessage.h"
@@ -119,6 +120,34 @@ int DoIt( int argc, char * argv[] )
     ++numImages;
     }
 
+  fileName.push_back( "Class" );
+
+  if( streamOutput || outputFormat == "npy" )
+    {
+    filter->SetInputMask( inputMask );
+    filter->SetStride( stride );
+    filter->SetNumImages( numImages );
+    filter->SetColumnHeaders( fileName );
+    filter->SetChunkSize( std::max( chunkSize, 1 ) );
+    filter->SetOutputFileName( outputCSVFileName );
+    if( outputFormat == "npy" )
+      {
+      filter->SetOutputFileFormat(
+        ConvertImagesToCSVFilterType::FileFormatEnum::NPY_FILE_FORMAT );
+      }
+    try
+      {
+      filter->Update();
+      }
+    catch ( itk::ExceptionObject& exp )
+      {
+      std::cerr << "Exception caught!" << std::endl;
+      std::cerr << exp << std::endl;
+      return EXIT_FAILURE;
+      }
+    return EXIT_SUCCESS;
+    }
+
   typedef vnl_matrix<InputPixelType> MatrixType;
   const unsigned int ARows =
     inputMask->GetLargestPossibleRegion().GetNumberOfPixels() / stride;
@@ -144,7 +173,6 @@ int DoIt( int argc, char * argv[] )
   writer->SetFileName( outputCSVFileName );
   writer->SetInput( &submatrix );
 
-  fileName.push_back( "Class" );
   writer->SetColumnHeaders( fileName );
 
   try
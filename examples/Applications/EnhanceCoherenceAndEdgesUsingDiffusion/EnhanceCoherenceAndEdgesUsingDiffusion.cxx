@@ -126,6 +126,9 @@ int DoIt( int argc, char * argv[] )
     hybridContrastParameter );
   HybridEnhancingFilter->SetTimeStep( timeStep );
   HybridEnhancingFilter->SetNumberOfIterations( numberOfIterations );
+  HybridEnhancingFilter->SetDiffusionTensorUpdateInterval(
+    tensorUpdateInterval );
+  HybridEnhancingFilter->SetUseFusedEigenAnalysis( fusedEigenAnalysis );
 
   double progressFraction = 0.8;
   tube::CLIFilterWatcher watcher( HybridEnhancingFilter,
@@ -219,5 +219,6 @@ int main( int argc, char * argv[] )
 
   // You may need to update this line if, in the project's .xml CLI file,
   //   you change the variable name for the inputVolume.
-  return tube::ParseArgsAndCallDoIt( inputVolumesList[0], argc, argv );
+  return tube::ParseArgsAndCallDoIt( inputVolumesList[0], profileOutput,
+    argc, argv );
 }
@@ -21,7 +21,14 @@ limitations under the License.
 
 #include "tubeImageMath.h"
 
+#include <itkExtractImageFilter.h>
 #include <itkImageFileWriter.h>
+#include <itkImageIORegion.h>
+
+#include <itksys/SystemTools.hxx>
+
+#include <algorithm>
+#include <cmath>
 
 #include <metaCommand.h>
 #include "ImageMathCLP.h"
@@ -123,6 +130,626 @@ ReadImage( std::string filename )
   return output;
 }
 
+/** One parsed option of a streamed run.  Halo is the number of slices of
+ * context the option needs on either side of a slab, and MinimumSize the
+ * fewest slices the padded slab may have; Mean and Sigma hold the
+ * whole-image statistics of global options, found by a pre-pass. */
+struct StreamingStep
+{
+  MetaCommand::Option option;
+  unsigned int        halo;
+  unsigned int        minimumSize;
+  bool                global;
+  double              mean;
+  double              sigma;
+};
+
+template< unsigned int VDimension >
+typename itk::Image< float, VDimension >::Pointer
+ReadImageRegion( const std::string & filename,
+  const itk::ImageRegion< VDimension > & region )
+{
+  typedef itk::Image< float, VDimension >                 ImageType;
+  typedef itk::ImageFileReader< ImageType >               ReaderType;
+  typedef itk::ExtractImageFilter< ImageType, ImageType > ExtractFilterType;
+
+  // Only the requested region is read when the file format supports it
+  typename ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName( filename );
+  typename ExtractFilterType::Pointer extract = ExtractFilterType::New();
+  extract->SetInput( reader->GetOutput() );
+  extract->SetExtractionRegion( region );
+  extract->SetDirectionCollapseToSubmatrix();
+  extract->Update();
+
+  return extract->GetOutput();
+}
+
+template< class TOutputPixel, unsigned int VDimension >
+void
+WriteImageSlab( itk::Image< float, VDimension > * image,
+  const itk::ImageRegion< VDimension > & slab,
+  const itk::ImageRegion< VDimension > & largestRegion,
+  const std::string & filename )
+{
+  typedef itk::Image< float, VDimension >        ImageType;
+  typedef itk::Image< TOutputPixel, VDimension > OutputImageType;
+  typedef itk::ExtractImageFilter< ImageType, OutputImageType >
+                                                 ExtractFilterType;
+
+  typename ExtractFilterType::Pointer extract = ExtractFilterType::New();
+  extract->SetInput( image );
+  extract->SetExtractionRegion( slab );
+  extract->SetDirectionCollapseToSubmatrix();
+  extract->Update();
+
+  // The slab is pasted into the file at its place in the full image
+  itk::ImageIOBase::Pointer imageIO = itk::ImageIOFactory::CreateImageIO(
+    filename.c_str(), itk::IOFileModeEnum::WriteMode );
+  imageIO->SetNumberOfDimensions( VDimension );
+  std::vector< double > axis( VDimension );
+  for( unsigned int d=0; d<VDimension; ++d )
+    {
+    imageIO->SetDimensions( d, largestRegion.GetSize()[d] );
+    imageIO->SetSpacing( d, image->GetSpacing()[d] );
+    imageIO->SetOrigin( d, image->GetOrigin()[d] );
+    for( unsigned int i=0; i<VDimension; ++i )
+      {
+      axis[i] = image->GetDirection()[i][d];
+      }
+    imageIO->SetDirection( d, axis );
+    }
+  imageIO->SetPixelTypeInfo( static_cast< const TOutputPixel * >( nullptr ) );
+  imageIO->SetUseCompression( false );
+  imageIO->SetUseStreamedWriting( true );
+  imageIO->SetFileName( filename.c_str() );
+
+  itk::ImageIORegion ioRegion( VDimension );
+  itk::ImageIORegionAdaptor< VDimension >::Convert( slab, ioRegion,
+    largestRegion.GetIndex() );
+  imageIO->SetIORegion( ioRegion );
+  imageIO->Write( extract->GetOutput()->GetBufferPointer() );
+}
+
+/** Pad a slab by halo slices, within the image.  A padded slab thinner
+ * than minimumSize, e.g. at the ends of the image, grows further until it
+ * has that many slices or spans the image. */
+template< unsigned int VDimension >
+itk::ImageRegion< VDimension >
+PadSlab( const itk::ImageRegion< VDimension > & slab, unsigned int halo,
+  unsigned int minimumSize,
+  const itk::ImageRegion< VDimension > & largestRegion )
+{
+  const unsigned int slabDimension = VDimension - 1;
+
+  itk::ImageRegion< VDimension > region = slab;
+  typename itk::ImageRegion< VDimension >::SizeType radius;
+  radius.Fill( 0 );
+  radius[slabDimension] = halo;
+  region.PadByRadius( radius );
+  region.Crop( largestRegion );
+
+  const itk::IndexValueType imageBegin =
+    largestRegion.GetIndex()[slabDimension];
+  const itk::IndexValueType imageEnd = imageBegin
+    + largestRegion.GetSize()[slabDimension];
+  itk::IndexValueType begin = region.GetIndex()[slabDimension];
+  itk::IndexValueType end = begin + region.GetSize()[slabDimension];
+  while( end - begin < static_cast< itk::IndexValueType >( minimumSize )
+    && ( begin > imageBegin || end < imageEnd ) )
+    {
+    if( begin > imageBegin )
+      {
+      --begin;
+      }
+    if( end - begin < static_cast< itk::IndexValueType >( minimumSize )
+      && end < imageEnd )
+      {
+      ++end;
+      }
+    }
+  region.SetIndex( slabDimension, begin );
+  region.SetSize( slabDimension, end - begin );
+  return region;
+}
+
+/** Run steps [0, numberOfSteps) on a slab padded by the halo those steps
+ * need.  Every halo slice consumed by a stencil step is invalid afterward,
+ * so only the slab itself is exact on return. */
+template< unsigned int VDimension >
+typename itk::Image< float, VDimension >::Pointer
+ProcessSlab( MetaCommand & command, const std::vector< StreamingStep > & steps,
+  unsigned int numberOfSteps, const itk::ImageRegion< VDimension > & slab,
+  const itk::ImageRegion< VDimension > & largestRegion, bool writeOutputs )
+{
+  typedef float                               PixelType;
+  typedef itk::Image< PixelType, VDimension > ImageType;
+
+  unsigned int halo = 0;
+  unsigned int minimumSize = 0;
+  for( unsigned int k=0; k<numberOfSteps; ++k )
+    {
+    halo += steps[k].halo;
+    minimumSize = std::max( minimumSize, steps[k].minimumSize );
+    }
+  const itk::ImageRegion< VDimension > region = PadSlab< VDimension >( slab,
+    halo, minimumSize, largestRegion );
+
+  tube::ImageMathFilters<VDimension> imFilters;
+  imFilters.SetInput( ReadImageRegion< VDimension >(
+    command.GetValueAsString( "infile" ), region ) );
+  imFilters.SetDeferPointwiseOperations( true );
+
+  for( unsigned int k=0; k<numberOfSteps; ++k )
+    {
+    const MetaCommand::Option & option = steps[k].option;
+    if( option.name == "Write" )
+      {
+      if( writeOutputs )
+        {
+        WriteImageSlab< PixelType, VDimension >( imFilters.GetOutput(), slab,
+          largestRegion, command.GetValueAsString( option, "filename" ) );
+        }
+      }
+    else if( option.name == "WriteType" )
+      {
+      if( writeOutputs )
+        {
+        std::string outFilename = command.GetValueAsString( option,
+          "filename" );
+        switch( command.GetValueAsInt( option, "Type" ) )
+          {
+          case 0:
+          case 4:
+            WriteImageSlab< unsigned char, VDimension >(
+              imFilters.GetOutput(), slab, largestRegion, outFilename );
+            break;
+          case 1:
+          case 5:
+            WriteImageSlab< unsigned short, VDimension >(
+              imFilters.GetOutput(), slab, largestRegion, outFilename );
+            break;
+          case 2:
+          case 6:
+            WriteImageSlab< short, VDimension >(
+              imFilters.GetOutput(), slab, largestRegion, outFilename );
+            break;
+          case 7:
+            WriteImageSlab< PixelType, VDimension >(
+              imFilters.GetOutput(), slab, largestRegion, outFilename );
+            break;
+          }
+        }
+      }
+    else if( option.name == "Intensity" )
+      {
+      imFilters.ApplyIntensityWindowing(
+        command.GetValueAsFloat( option, "inValMin" ),
+        command.GetValueAsFloat( option, "inValMax" ),
+        command.GetValueAsFloat( option, "outMin" ),
+        command.GetValueAsFloat( option, "outMax" ) );
+      }
+    else if( option.name == "IntensityMult" )
+      {
+      // The mean of the whole field comes from the pre-pass
+      typename ImageType::Pointer imTmp = ReadImageRegion< VDimension >(
+        command.GetValueAsString( option, "inMeanField" ), region );
+      itk::ImageRegionIterator< ImageType > it1( imFilters.GetOutput(),
+        region );
+      itk::ImageRegionConstIterator< ImageType > it2( imTmp, region );
+      while( !it1.IsAtEnd() )
+        {
+        double tf2 = it2.Get();
+        if( tf2 != 0 )
+          {
+          double alpha = steps[k].mean / tf2;
+          it1.Set( ( PixelType )( it1.Get() * alpha ) );
+          }
+        ++it1;
+        ++it2;
+        }
+      }
+    else if( option.name == "Add" )
+      {
+      typename ImageType::Pointer imTmp = ReadImageRegion< VDimension >(
+        command.GetValueAsString( option, "Infile" ), region );
+      imFilters.AddImages( imTmp,
+        command.GetValueAsFloat( option, "weight1" ),
+        command.GetValueAsFloat( option, "weight2" ) );
+      }
+    else if( option.name == "Normalize" )
+      {
+      // Mean and standard deviation of the whole image come from the
+      //   pre-pass; the arithmetic matches NormalizeImageFilter
+      const double scale = 1.0 / steps[k].sigma;
+      itk::ImageRegionIterator< ImageType > it1( imFilters.GetOutput(),
+        region );
+      while( !it1.IsAtEnd() )
+        {
+        it1.Set( ( PixelType )( ( it1.Get() - steps[k].mean ) * scale ) );
+        ++it1;
+        }
+      }
+    else if( option.name == "Fuse" )
+      {
+      typename ImageType::Pointer imTmp = ReadImageRegion< VDimension >(
+        command.GetValueAsString( option, "Infile2" ), region );
+      imFilters.FuseImages( imTmp,
+        command.GetValueAsFloat( option, "Offset2" ) );
+      }
+    else if( option.name == "Copy" )
+      {
+      typedef itk::ImageFileReader< ImageType > ReaderType;
+      typename ReaderType::Pointer reader = ReaderType::New();
+      reader->SetFileName( command.GetValueAsString( option,
+        "sourceFile" ) );
+      reader->UpdateOutputInformation();
+      imFilters.CopyImageInformation( reader->GetOutput() );
+      }
+    else if( option.name == "Median" )
+      {
+      imFilters.MedianImage( command.GetValueAsInt( option, "Size" ) );
+      }
+    else if( option.name == "Threshold" )
+      {
+      imFilters.ThresholdImage(
+        command.GetValueAsFloat( option, "threshLow" ),
+        command.GetValueAsFloat( option, "threshHigh" ),
+        command.GetValueAsFloat( option, "valTrue" ),
+        command.GetValueAsFloat( option, "valFalse" ) );
+      }
+    else if( option.name == "Process" )
+      {
+      if( command.GetValueAsInt( option, "mode" ) == 0 )
+        {
+        typename ImageType::Pointer imTmp = ReadImageRegion< VDimension >(
+          command.GetValueAsString( option, "file2" ), region );
+        imFilters.MultiplyImages( imTmp );
+        }
+      }
+    else if( option.name == "process" )
+      {
+      if( command.GetValueAsInt( option, "mode" ) == 0 )
+        {
+        imFilters.AbsoluteImage();
+        }
+      }
+    else if( option.name == "Masking" )
+      {
+      typename ImageType::Pointer imTmp = ReadImageRegion< VDimension >(
+        command.GetValueAsString( option, "mask" ), region );
+      imFilters.ReplaceValuesOutsideMaskRange( imTmp,
+        command.GetValueAsFloat( option, "maskThreshLow" ),
+        command.GetValueAsFloat( option, "maskThreshHigh" ),
+        command.GetValueAsFloat( option, "valFalse" ) );
+      }
+    else if( option.name == "Morphology" )
+      {
+      imFilters.MorphImage( command.GetValueAsInt( option, "mode" ),
+        command.GetValueAsInt( option, "radius" ),
+        command.GetValueAsFloat( option, "forgroundValue" ),
+        command.GetValueAsFloat( option, "backgroundValue" ) );
+      }
+    else if( option.name == "overwrite" )
+      {
+      typename ImageType::Pointer imTmp = ReadImageRegion< VDimension >(
+        command.GetValueAsString( option, "mask" ), region );
+      imFilters.ReplaceValueWithinMaskRange( imTmp,
+        command.GetValueAsFloat( option, "maskThreshLow" ),
+        command.GetValueAsFloat( option, "maskThreshHigh" ),
+        command.GetValueAsFloat( option, "imageVal" ),
+        command.GetValueAsFloat( option, "newImageVal" ) );
+      }
+    else if( option.name == "blur" )
+      {
+      imFilters.BlurImage( command.GetValueAsFloat( option, "sigma" ) );
+      }
+    else if( option.name == "blurOrder" )
+      {
+      imFilters.BlurOrderImage(
+        command.GetValueAsFloat( option, "sigma" ),
+        command.GetValueAsInt( option, "order" ),
+        command.GetValueAsInt( option, "direction" ) );
+      }
+    else if( option.name == "offset" )
+      {
+      double offset[VDimension];
+      offset[0] = command.GetValueAsFloat( option, "offsetX" );
+      offset[1] = command.GetValueAsFloat( option, "offsetY" );
+      if( VDimension == 3 )
+        {
+        offset[VDimension-1] = command.GetValueAsFloat( option, "offsetZ" );
+        }
+      imFilters.GetOutput()->SetOrigin( offset );
+      }
+    }
+
+  return imFilters.GetOutput();
+}
+
+template< unsigned int VDimension >
+itk::ImageRegion< VDimension >
+GetSlab( const itk::ImageRegion< VDimension > & largestRegion,
+  unsigned int numberOfSlabs, unsigned int slabNumber )
+{
+  const unsigned int slabDimension = VDimension - 1;
+  const itk::SizeValueType length = largestRegion.GetSize()[slabDimension];
+  const itk::SizeValueType begin = length * slabNumber / numberOfSlabs;
+  const itk::SizeValueType end = length * ( slabNumber + 1 ) / numberOfSlabs;
+
+  itk::ImageRegion< VDimension > slab = largestRegion;
+  slab.SetIndex( slabDimension,
+    largestRegion.GetIndex()[slabDimension] + begin );
+  slab.SetSize( slabDimension, end - begin );
+  return slab;
+}
+
+template< unsigned int VDimension >
+bool
+IsStreamingOperand( const std::string & filename,
+  const itk::ImageRegion< VDimension > & largestRegion )
+{
+  typedef itk::Image< float, VDimension >   ImageType;
+  typedef itk::ImageFileReader< ImageType > ReaderType;
+
+  typename ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName( filename );
+  try
+    {
+    reader->UpdateOutputInformation();
+    }
+  catch( ... )
+    {
+    return false;
+    }
+  return reader->GetOutput()->GetLargestPossibleRegion() == largestRegion;
+}
+
+bool
+IsStreamingOutput( const std::string & filename )
+{
+  itk::ImageIOBase::Pointer imageIO = itk::ImageIOFactory::CreateImageIO(
+    filename.c_str(), itk::IOFileModeEnum::WriteMode );
+  if( !imageIO )
+    {
+    return false;
+    }
+  imageIO->SetFileName( filename.c_str() );
+  imageIO->SetUseCompression( false );
+  imageIO->SetUseStreamedWriting( true );
+  return imageIO->CanStreamWrite();
+}
+
+/** Decide whether every option can run slab by slab.  Point-wise options
+ * need no context, stencil options need a halo of their radius along the
+ * slab axis, and Normalize ( mean/std ) and IntensityMult need a pre-pass
+ * for their whole-image statistics.  Operand images must share the input
+ * grid, and outputs must be of a format that can be written in pieces. */
+template< unsigned int VDimension >
+bool
+PlanStreaming( MetaCommand & command,
+  const itk::ImageRegion< VDimension > & largestRegion,
+  itk::Vector< double, VDimension > spacing,
+  std::vector< StreamingStep > & steps )
+{
+  const unsigned int slabDimension = VDimension - 1;
+
+  MetaCommand::OptionVector parsed = command.GetParsedOptions();
+  MetaCommand::OptionVector::const_iterator it = parsed.begin();
+  while( it != parsed.end() )
+    {
+    const std::string & name = ( *it ).name;
+
+    StreamingStep step;
+    step.option = *it;
+    step.halo = 0;
+    step.minimumSize = 0;
+    step.global = false;
+    step.mean = 0;
+    step.sigma = 1;
+
+    std::string operand;
+    std::string output;
+    bool supported = true;
+    if( name == "Stream" || name == "SetRandom" )
+      {
+      ++it;
+      continue;
+      }
+    else if( name == "Intensity" || name == "Threshold"
+      || name == "process" || name == "offset" )
+      {
+      }
+    else if( name == "Write" )
+      {
+      output = command.GetValueAsString( *it, "filename" );
+      }
+    else if( name == "WriteType" )
+      {
+      output = command.GetValueAsString( *it, "filename" );
+      supported = ( command.GetValueAsInt( *it, "Type" ) != 3 );
+      }
+    else if( name == "IntensityMult" )
+      {
+      operand = command.GetValueAsString( *it, "inMeanField" );
+      step.global = true;
+      }
+    else if( name == "Add" )
+      {
+      operand = command.GetValueAsString( *it, "Infile" );
+      }
+    else if( name == "Fuse" )
+      {
+      operand = command.GetValueAsString( *it, "Infile2" );
+      }
+    else if( name == "Process" )
+      {
+      if( command.GetValueAsInt( *it, "mode" ) == 0 )
+        {
+        operand = command.GetValueAsString( *it, "file2" );
+        }
+      }
+    else if( name == "Masking" || name == "overwrite" )
+      {
+      operand = command.GetValueAsString( *it, "mask" );
+      }
+    else if( name == "Copy" )
+      {
+      typedef itk::Image< float, VDimension >   ImageType;
+      typedef itk::ImageFileReader< ImageType > ReaderType;
+      typename ReaderType::Pointer reader = ReaderType::New();
+      reader->SetFileName( command.GetValueAsString( *it, "sourceFile" ) );
+      try
+        {
+        reader->UpdateOutputInformation();
+        spacing = reader->GetOutput()->GetSpacing();
+        }
+      catch( ... )
+        {
+        // The in-memory path reports the error
+        supported = false;
+        }
+      }
+    else if( name == "Normalize" )
+      {
+      supported = ( command.GetValueAsInt( *it, "type" ) == 0 );
+      step.global = true;
+      }
+    else if( name == "Median" )
+      {
+      step.halo = command.GetValueAsInt( *it, "Size" );
+      }
+    else if( name == "Morphology" )
+      {
+      step.halo = command.GetValueAsInt( *it, "radius" );
+      }
+    else if( name == "blur"
+      || ( name == "blurOrder" && command.GetValueAsInt( *it, "direction" )
+        == static_cast< int >( slabDimension ) ) )
+      {
+      // The recursive Gaussian is truncated at four standard deviations,
+      //   and it needs at least four slices to run
+      step.halo = static_cast< unsigned int >( std::ceil( 4
+        * command.GetValueAsFloat( *it, "sigma" ) / spacing[slabDimension] ) );
+      step.minimumSize = 4;
+      }
+    else if( name == "blurOrder" )
+      {
+      }
+    else
+      {
+      supported = false;
+      }
+
+    if( supported && !operand.empty() )
+      {
+      supported = IsStreamingOperand< VDimension >( operand, largestRegion );
+      }
+    if( supported && !output.empty() )
+      {
+      supported = IsStreamingOutput( output );
+      }
+    if( !supported )
+      {
+      std::cout << "Option " << name << " cannot be streamed;"
+                << " processing the image in memory" << std::endl;
+      return false;
+      }
+
+    steps.push_back( step );
+    ++it;
+    }
+
+  return true;
+}
+
+/** Out-of-core execution: the input is read, processed, and written one
+ * slab at a time along its last axis. */
+template< unsigned int VDimension >
+int DoItStreaming( MetaCommand & command,
+  const itk::ImageRegion< VDimension > & largestRegion,
+  std::vector< StreamingStep > & steps )
+{
+  typedef itk::Image< float, VDimension > ImageType;
+
+  unsigned int numberOfSlabs = static_cast< unsigned int >( std::max( 1,
+    command.GetValueAsInt( "Stream", "numberOfSlabs" ) ) );
+  numberOfSlabs = std::min( numberOfSlabs, static_cast< unsigned int >(
+    largestRegion.GetSize()[VDimension-1] ) );
+
+  // Slabs are pasted into the outputs, so stale files must not remain
+  for( unsigned int k=0; k<steps.size(); ++k )
+    {
+    if( steps[k].option.name == "Write"
+      || steps[k].option.name == "WriteType" )
+      {
+      itksys::SystemTools::RemoveFile( command.GetValueAsString(
+        steps[k].option, "filename" ) );
+      }
+    }
+
+  // Whole-image statistics are gathered in order, each pre-pass running
+  //   the steps before it
+  for( unsigned int k=0; k<steps.size(); ++k )
+    {
+    if( !steps[k].global )
+      {
+      continue;
+      }
+    std::cout << "Statistics pre-pass for " << steps[k].option.name
+              << std::endl;
+    double sum = 0;
+    double sumOfSquares = 0;
+    double count = 0;
+    for( unsigned int i=0; i<numberOfSlabs; ++i )
+      {
+      const itk::ImageRegion< VDimension > slab = GetSlab< VDimension >(
+        largestRegion, numberOfSlabs, i );
+      typename ImageType::Pointer image;
+      if( steps[k].option.name == "IntensityMult" )
+        {
+        image = ReadImageRegion< VDimension >( command.GetValueAsString(
+          steps[k].option, "inMeanField" ), slab );
+        }
+      else
+        {
+        image = ProcessSlab< VDimension >( command, steps, k, slab,
+          largestRegion, false );
+        }
+      itk::ImageRegionConstIterator< ImageType > it( image, slab );
+      while( !it.IsAtEnd() )
+        {
+        double tf = it.Get();
+        sum += tf;
+        sumOfSquares += tf * tf;
+        if( steps[k].option.name != "IntensityMult" || tf != 0 )
+          {
+          ++count;
+          }
+        ++it;
+        }
+      }
+    steps[k].mean = sum / count;
+    if( steps[k].option.name == "Normalize" )
+      {
+      steps[k].sigma = std::sqrt( ( sumOfSquares - sum * sum / count )
+        / ( count - 1 ) );
+      }
+    }
+
+  for( unsigned int i=0; i<numberOfSlabs; ++i )
+    {
+    std::cout << "Processing slab " << i + 1 << " of " << numberOfSlabs
+              << std::endl;
+    ProcessSlab< VDimension >( command, steps,
+      static_cast< unsigned int >( steps.size() ),
+      GetSlab< VDimension >( largestRegion, numberOfSlabs, i ),
+      largestRegion, true );
+    }
+
+  return EXIT_SUCCESS;
+}
+
 /** Main command */
 template< class TPixel, unsigned int VDimension >
 int DoIt( MetaCommand & command )
@@ -133,6 +760,32 @@ int DoIt( MetaCommand & command )
   typedef itk::Image< unsigned short, VDimension > ImageTypeUShort;
   typedef itk::Image< short, VDimension >          ImageTypeShort;
 
+  if( command.GetOptionWasSet( "Stream" ) )
+    {
+    typedef itk::ImageFileReader< ImageType > ReaderType;
+    typename ReaderType::Pointer reader = ReaderType::New();
+    reader->SetFileName( command.GetValueAsString( "infile" ) );
+    bool canStream = true;
+    try
+      {
+      reader->UpdateOutputInformation();
+      }
+    catch( ... )
+      {
+      // The in-memory path reports the error
+      canStream = false;
+      }
+
+    std::vector< StreamingStep > steps;
+    if( canStream && PlanStreaming< VDimension >( command,
+      reader->GetOutput()->GetLargestPossibleRegion(),
+      reader->GetOutput()->GetSpacing(), steps ) )
+      {
+      return DoItStreaming< VDimension >( command,
+        reader->GetOutput()->GetLargestPossibleRegion(), steps );
+      }
+    }
+
   MetaCommand::OptionVector parsed = command.GetParsedOptions();
 
   int CurrentSeed = 42;
@@ -142,6 +795,8 @@ int DoIt( MetaCommand & command )
 
   tube::ImageMathFilters<VDimension> imFilters;
   imFilters.SetInput( imIn );
+  // Consecutive point-wise operations are evaluated in one sweep
+  imFilters.SetDeferPointwiseOperations( true );
 
   MetaCommand::OptionVector::const_iterator it = parsed.begin();
   while( it != parsed.end() )
@@ -887,6 +1542,11 @@ int main( int argc, char * argv[] )
   command.AddOptionField( "Voronoi", "centroidOutFile",
     MetaCommand::STRING, true );
 
+  command.SetOption( "Stream", "X", false,
+    "Process the image slab by slab; outputs are written uncompressed" );
+  command.AddOptionField( "Stream", "numberOfSlabs", MetaCommand::INT,
+    true );
+
   command.AddField( "infile", "infile filename",
     MetaCommand::STRING, MetaCommand::DATA_IN );
 
@@ -135,6 +135,8 @@ int DoIt( int argc, char * argv[] )
     }
   filter->SetBlendUsingAverage( averagePixels );
   filter->SetUseFastBlending( useFastBlending );
+  filter->SetRestrictToOverlap( restrictToOverlap );
+  filter->SetOverlapMargin( overlapMargin );
 
   if( boundary.size() == VDimension )
     {
@@ -98,6 +98,7 @@ int DoIt( int argc, char * argv[] )
     {
     reger->SetUseEvolutionaryOptimization( true );
     }
+  reger->SetEvolutionaryPopulationSize( evolutionaryPopulationSize );
 
   if( fixedLandmarks.size() > 0 || movingLandmarks.size() > 0 )
     {
@@ -651,7 +652,7 @@ int main( int argc, char * argv[] )
     itk::MultiThreaderBase::SetGlobalDefaultNumberOfThreads( numberOfThreads );
     }
 
-  tube::ParseArgsAndCallDoIt( fixedImage, argc, argv );
+  tube::ParseArgsAndCallDoIt( fixedImage, profileOutput, argc, argv );
 
   return EXIT_SUCCESS;
 }
@@ -35,6 +35,7 @@ limitations under the License.
 
 #include "SegmentTubesCLP.h"
 
+#include <fstream>
 #include <sstream>
 
 #define PARSE_ARGS_FLOAT_ONLY
@@ -101,6 +102,7 @@ int DoIt( int argc, char * argv[] )
   typename ImageType::Pointer inputImage = reader->GetOutput();
   typename SegmentTubesFilterType::Pointer segmentTubesFilter
     = SegmentTubesFilterType::New();
+  segmentTubesFilter->SetUseSparseTubeMask( useSparseTubeMask );
   segmentTubesFilter->SetInput( inputImage );
 
   segmentTubesFilter->SetVerbose( verbose );
@@ -292,12 +294,28 @@ int DoIt( int argc, char * argv[] )
 
   segmentTubesFilter->SetBorderInIndexSpace( border );
 
+  if( !seedStatisticsOutput.empty() )
+    {
+    segmentTubesFilter->SetUseEventLog( true );
+    }
+
   timeCollector.Start( "Ridge Extractor" );
 
   segmentTubesFilter->ProcessSeeds();
 
   timeCollector.Stop( "Ridge Extractor" );
 
+  if( !seedStatisticsOutput.empty() )
+    {
+    std::ofstream statisticsFile( seedStatisticsOutput.c_str() );
+    segmentTubesFilter->WriteSeedStatistics( statisticsFile );
+    if( !statisticsFile )
+      {
+      tube::ErrorMessage( "Cannot write seed statistics to "
+        + seedStatisticsOutput );
+      }
+    }
+
   if( segmentTubesFilter->GetTubeGroup()->GetNumberOfChildren() ==
     numberOfPriorChildren )
     {
@@ -350,5 +368,6 @@ int main( int argc, char * argv[] )
 
   // You may need to update this line if, in the project's .xml CLI file,
   //   you change the variable name for the inputVolume.
-  return tube::ParseArgsAndCallDoIt( inputVolume, argc, argv );
+  return tube::ParseArgsAndCallDoIt( inputVolume, profileOutput, argc,
+    argv );
 }
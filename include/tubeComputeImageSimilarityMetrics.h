@@ -70,6 +70,10 @@ public:
   tubeWrapSetMacro( SamplingRate, double, Filter );
   tubeWrapGetMacro( SamplingRate, double, Filter );
 
+  /** Set/Get number of histogram bins per image for mutual information */
+  tubeWrapSetMacro( NumberOfHistogramBins, unsigned int, Filter );
+  tubeWrapGetMacro( NumberOfHistogramBins, unsigned int, Filter );
+
   /** Set/Get input image 1 */
   tubeWrapSetConstObjectMacro( Input1, ImageType, Filter );
   tubeWrapGetConstObjectMacro( Input1, ImageType, Filter );
@@ -78,12 +82,27 @@ public:
   tubeWrapSetConstObjectMacro( Input2, ImageType, Filter );
   tubeWrapGetConstObjectMacro( Input2, ImageType, Filter );
 
+  /** Add an image to score against input image 1 */
+  unsigned int AddMovingImage( const ImageType * image )
+  { return this->m_Filter->AddMovingImage( image ); };
+
+  /** Remove the added moving images */
+  void ClearMovingImages( void )
+  { this->m_Filter->ClearMovingImages(); };
+
+  /** Get number of added moving images */
+  unsigned int GetNumberOfMovingImages( void ) const
+  { return this->m_Filter->GetNumberOfMovingImages(); };
+
   /** Compute image similarity */
   tubeWrapUpdateMacro( Filter );
 
   /** Get image similarity */
   tubeWrapGetMacro( Output, double, Filter );
 
+  /** Get similarity to each added moving image */
+  tubeWrapGetMacro( Outputs, std::vector< double >, Filter );
+
 protected:
   ComputeImageSimilarityMetrics( void );
   ~ComputeImageSimilarityMetrics() {}
@@ -43,6 +43,8 @@ ComputeImageSimilarityMetrics< TInputImage >
   Superclass::PrintSelf( os, indent );
   os << "Use Correlation: " << this->GetUseCorrelation() << std::endl;
   os << "Sampling Rate: " << this->GetSamplingRate() << std::endl;
+  os << "Number Of Histogram Bins: " << this->GetNumberOfHistogramBins()
+    << std::endl;
 }
 
 } // End namespace tubetk
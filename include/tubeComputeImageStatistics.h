@@ -77,6 +77,14 @@ public:
   tubeWrapSetMacro( Quantiles, std::vector<float>, Filter );
   tubeWrapGetMacro( Quantiles, std::vector<float>, Filter );
 
+  /** Set/Get mask values to compute statistics for */
+  tubeWrapSetMacro( Labels, std::vector< TPixel >, Filter );
+  tubeWrapGetMacro( Labels, std::vector< TPixel >, Filter );
+
+  /** Set/Get number of histogram bins used to locate the quantiles */
+  tubeWrapSetMacro( NumberOfHistogramBins, unsigned int, Filter );
+  tubeWrapGetMacro( NumberOfHistogramBins, unsigned int, Filter );
+
   /** Set/Get input mask */
   tubeWrapSetObjectMacro( InputMask, MaskType, Filter );
   tubeWrapGetObjectMacro( InputMask, MaskType, Filter );
@@ -72,6 +72,23 @@ public:
   tubeWrapGetMacro( NumImages, unsigned int, ConvertImagesToCSVFilter );
   tubeWrapSetMacro( NumberRows, unsigned int, ConvertImagesToCSVFilter );
   tubeWrapGetMacro( NumberRows, unsigned int, ConvertImagesToCSVFilter );
+
+  typedef typename ConvertImagesToCSVFilterType::FileFormatEnum
+    FileFormatEnum;
+
+  /** Stream the rows to a CSV or .npy file instead of the output matrix */
+  tubeWrapSetMacro( OutputFileName, std::string, ConvertImagesToCSVFilter );
+  tubeWrapGetMacro( OutputFileName, std::string, ConvertImagesToCSVFilter );
+  tubeWrapSetMacro( OutputFileFormat, FileFormatEnum,
+    ConvertImagesToCSVFilter );
+  tubeWrapGetMacro( OutputFileFormat, FileFormatEnum,
+    ConvertImagesToCSVFilter );
+  tubeWrapSetMacro( ChunkSize, unsigned int, ConvertImagesToCSVFilter );
+  tubeWrapGetMacro( ChunkSize, unsigned int, ConvertImagesToCSVFilter );
+  tubeWrapCallWithConstReferenceArgMacro( SetColumnHeaders,
+    std::vector< std::string >, ConvertImagesToCSVFilter );
+  tubeWrapGetConstReferenceMacro( ColumnHeaders,
+    std::vector< std::string >, ConvertImagesToCSVFilter );
   /** Set the input image and reinitialize the list of images */
   tubeWrapSetObjectMacro( Input, InputImageType, ConvertImagesToCSVFilter );
   tubeWrapGetConstObjectMacro( Input, InputImageType,
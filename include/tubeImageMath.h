@@ -114,6 +114,14 @@ public:
     output->Register();
     return output; }
 
+  /** Record consecutive point-wise operations and evaluate them together
+   * in one threaded sweep. \sa ImageMathFilters */
+  void SetDeferPointwiseOperations( bool defer )
+  { m_Filter.SetDeferPointwiseOperations( defer ); this->Modified(); };
+
+  bool GetDeferPointwiseOperations( void ) const
+  { return m_Filter.GetDeferPointwiseOperations(); };
+
   void IntensityWindow( float inValMin, float inValMax,
     float outMin, float outMax )
   { m_Filter.ApplyIntensityWindowing( inValMin, inValMax, outMin, outMax );
@@ -133,6 +133,18 @@ public:
   /** Get use of experimental method for fast blending */
   tubeWrapGetMacro( UseFastBlending, bool, Filter );
 
+  /** Set if registration and blending are restricted to the overlap */
+  tubeWrapSetMacro( RestrictToOverlap, bool, Filter );
+
+  /** Get if registration and blending are restricted to the overlap */
+  tubeWrapGetMacro( RestrictToOverlap, bool, Filter );
+
+  /** Set margin, in voxels, added around the overlap when restricted */
+  tubeWrapSetMacro( OverlapMargin, unsigned int, Filter );
+
+  /** Get margin, in voxels, added around the overlap when restricted */
+  tubeWrapGetMacro( OverlapMargin, unsigned int, Filter );
+
   /** Set initial transform */
   tubeWrapSetConstObjectMacro( InitialTransform, TransformType, Filter );
   tubeWrapGetConstObjectMacro( InitialTransform, TransformType, Filter );
@@ -110,6 +110,27 @@ public:
 
   tubeWrapCallMacro( Initialize, Filter );
 
+  //
+  // Batch
+  //
+  tubeWrapAddConstObjectMacro( BatchMovingImage, ImageType, Filter );
+  tubeWrapAddConstObjectMacro( BatchInitialTransform, MatrixTransformType,
+    Filter );
+  tubeWrapCallMacro( ClearBatch, Filter );
+
+  tubeWrapSetMacro( BatchNumberOfConcurrentRegistrations, unsigned int,
+    Filter );
+  tubeWrapGetMacro( BatchNumberOfConcurrentRegistrations, unsigned int,
+    Filter );
+
+  tubeWrapCallMacro( UpdateBatch, Filter );
+
+  tubeWrapGetMacro( NumberOfBatchResults, unsigned int, Filter );
+  tubeWrapGetNthConstObjectMacro( BatchMatrixTransform, MatrixTransformType,
+    Filter );
+  tubeWrapGetNthMacro( BatchMetricValue, double, Filter );
+  tubeWrapGetMacro( BatchBestCase, unsigned int, Filter );
+
   //
   // Resample
   //
@@ -178,6 +199,9 @@ public:
   tubeWrapSetMacro( UseEvolutionaryOptimization, bool, Filter );
   tubeWrapGetMacro( UseEvolutionaryOptimization, bool, Filter );
 
+  tubeWrapSetMacro( EvolutionaryPopulationSize, unsigned int, Filter );
+  tubeWrapGetMacro( EvolutionaryPopulationSize, unsigned int, Filter );
+
   tubeWrapSetMacro( ExpectedOffsetMagnitude, double, Filter );
   tubeWrapGetMacro( ExpectedOffsetMagnitude, double, Filter );
 
@@ -312,6 +336,12 @@ public:
   tubeWrapSetMacro( BSplineControlPointPixelSpacing, double, Filter );
   tubeWrapGetMacro( BSplineControlPointPixelSpacing, double, Filter );
 
+  tubeWrapSetMacro( BSplineUseImagePyramid, bool, Filter );
+  tubeWrapGetMacro( BSplineUseImagePyramid, bool, Filter );
+
+  tubeWrapSetMacro( BSplineMaximumMetricCacheSize, double, Filter );
+  tubeWrapGetMacro( BSplineMaximumMetricCacheSize, double, Filter );
+
   void SetBSplineMetricMethodEnum( const std::string & bSplineMetricMethod);
   const std::string GetBSplineMetricMethodEnum(void);
 
@@ -67,6 +67,9 @@ public:
   typedef typename FilterType::PointType               PointType;
   typedef std::vector< PointType >                     PointListType;
 
+  typedef typename FilterType::EventLogType            EventLogType;
+  typedef typename FilterType::SeedStatisticsListType  SeedStatisticsListType;
+
   /** Method for creation through the object factory. */
   itkNewMacro( Self );
 
@@ -90,7 +93,8 @@ public:
 
   /** The image that records extracted vessels */
   tubeWrapSetObjectMacro( TubeMaskImage, TubeMaskImageType, Filter );
-  tubeWrapGetObjectMacro( TubeMaskImage, TubeMaskImageType, Filter );
+  typename TubeMaskImageType::Pointer GetTubeMaskImage( void )
+  { return m_Filter->GetTubeMaskImage(); };
 
   /***/
   /***/
@@ -167,6 +171,21 @@ public:
   void ProcessSeeds( void )
   { this->m_Filter->ProcessSeeds( m_Verbose ); };
 
+  /** Record the steps, recovery attempts, scale changes, failures and
+   * time taken by the extraction from each seed */
+  tubeWrapSetMacro( UseEventLog, bool, Filter );
+  tubeWrapGetMacro( UseEventLog, bool, Filter );
+
+  tubeWrapGetObjectMacro( EventLog, EventLogType, Filter );
+
+  /** Get the statistics of each seed extracted while the log was used */
+  SeedStatisticsListType GetSeedStatistics( void ) const
+  { return this->m_Filter->GetSeedStatistics(); };
+
+  /** Write the per-seed statistics as CSV */
+  void WriteSeedStatistics( std::ostream & os ) const
+  { this->m_Filter->WriteSeedStatistics( os ); };
+
   /** Load parameters of tube extraction from a file */
   void LoadParameterFile( const std::string & filename )
   { ::itk::tube::TubeExtractorIO< ImageType > teReader;
@@ -231,6 +250,11 @@ public:
   tubeWrapSetMacro( DynamicScale, bool, RidgeFilter );
   tubeWrapGetMacro( DynamicScale, bool, RidgeFilter );
 
+  /** Record extracted tubes in a sparse, brick-allocated mask.  Set
+   * before the input image to avoid allocating a full mask image. */
+  tubeWrapSetMacro( UseSparseTubeMask, bool, RidgeFilter );
+  tubeWrapGetMacro( UseSparseTubeMask, bool, RidgeFilter );
+
   double RidgenessInObjectSpace( const PointType & x )
   { m_Ridgeness = m_RidgeFilter->Ridgeness( x, m_Intensity, m_Roundness,
       m_Curvature, m_Levelness );  return m_Ridgeness; };
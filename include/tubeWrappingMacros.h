@@ -32,6 +32,8 @@ limitations under the License.
 #ifndef __tubeWrappingMacros_h
 #define __tubeWrappingMacros_h
 
+#include "tubeProfiler.h"
+
 /** Boolean macro */
 #define tubeWrapBooleanMacro( name, wrap_filter_object_name )   \
   void name##On( void ) const                            \
@@ -256,8 +258,13 @@ limitations under the License.
     this->m_##wrap_filter_object_name->name();               \
     }
 
-/** Redirect call to Update() wrapped filter's Update() */
+/** Redirect call to Update() wrapped filter's Update(), timed as a
+ * profiler scope named after the wrapping class */
 #define tubeWrapUpdateMacro( wrap_filter_object_name )                   \
-  tubeWrapCallOverrideMacro( Update, wrap_filter_object_name )                   \
+  void Update() override                                             \
+    {                                                                \
+    tubeProfileScopeMacro( this->GetNameOfClass() );                 \
+    this->m_##wrap_filter_object_name->Update();                     \
+    }
 
 #endif
@@ -31,9 +31,19 @@ limitations under the License.
 #include "tubeWrappingMacros.h"
 #include <itkImage.h>
 
+#include <fstream>
+#include <vector>
+
 namespace tube
 {
 /** \class Write4DImageFrom3DImages
+ *
+ *  By default the 4D image is assembled in memory and written by Write().
+ *  When StreamFrames is on, the MetaImage header is written with the
+ *  first frame and each frame is then written to the data file as soon
+ *  as it is set, so only one frame is held in memory.  Streaming requires
+ *  a .mha or .mhd file name and a scalar pixel type, and the data is not
+ *  compressed.
  *
  *  \ingroup TubeTK
  */
@@ -70,6 +80,11 @@ public:
 
   itkSetMacro( FileName, std::string );
 
+  /** Write each frame to the file when it is set.  Must be set before the
+   *  first frame. */
+  itkSetMacro( StreamFrames, bool );
+  itkGetMacro( StreamFrames, bool );
+
   void Write( void )
   { this->Update(); };
 
@@ -92,10 +107,26 @@ private:
 
   typedef itk::Image< typename InputImageType::PixelType, 4 >  OutputImageType;
 
+  /** Write the MetaImage header for frames like img and open the data
+   *  file */
+  void StartStreaming( const InputImageType * img );
+
+  /** Write a frame at its place in the data file */
+  void WriteFrame( unsigned int outputIndex, const InputImageType * img );
+
+  /** Fill the frames that were not set with zeros and close the file */
+  void EndStreaming( void );
+
   unsigned int                       m_NumberOfInputImages;
   typename OutputImageType::Pointer  m_OutputImage;
   std::string                        m_FileName;
 
+  bool                               m_StreamFrames;
+  std::ofstream                      m_FrameStream;
+  std::streamoff                     m_FrameDataOffset;
+  typename InputImageType::SizeType  m_FrameSize;
+  std::vector< bool >                m_FramesWritten;
+
 };
 
 } // End namespace tube
@@ -26,6 +26,7 @@ limitations under the License.
 
 #include "tubeMessage.h"
 
+#include <itkByteSwapper.h>
 #include <itkImage.h>
 #include <itkImageFileWriter.h>
 #include <itkImageRegionIterator.h>
@@ -33,6 +34,9 @@ limitations under the License.
 
 #include <itksys/SystemTools.hxx>
 
+#include <iomanip>
+#include <limits>
+
 
 namespace tube
 {
@@ -46,6 +50,10 @@ Write4DImageFrom3DImages()
   m_NumberOfInputImages = 0;
 
   m_FileName = "";
+
+  m_StreamFrames = false;
+  m_FrameDataOffset = 0;
+  m_FrameSize.Fill( 0 );
 }
 
 template< class InputImageT >
@@ -56,6 +64,12 @@ SetNumberOfInputImages( unsigned int numInputs )
   m_NumberOfInputImages = numInputs;
 
   m_OutputImage = nullptr;
+
+  if( m_FrameStream.is_open() )
+    {
+    m_FrameStream.close();
+    }
+  m_FramesWritten.clear();
 }
 
 template< class InputImageT >
@@ -64,6 +78,16 @@ Write4DImageFrom3DImages< InputImageT >::
 SetNthInputImage( unsigned int outputIndex,
   const typename InputImageType::Pointer & img )
 {
+  if( m_StreamFrames )
+    {
+    if( !m_FrameStream.is_open() )
+      {
+      this->StartStreaming( img );
+      }
+    this->WriteFrame( outputIndex, img );
+    return;
+    }
+
   if( m_OutputImage == nullptr )
     {
     m_OutputImage = OutputImageType::New();
@@ -74,6 +98,7 @@ SetNthInputImage( unsigned int outputIndex,
     typename OutputImageType::SizeType outSize;
     typename OutputImageType::SpacingType outSpacing;
     typename OutputImageType::IndexType outIndex;
+    typename OutputImageType::PointType outOrigin;
     typename OutputImageType::DirectionType outDirection;
     outDirection.SetIdentity();
     for( unsigned int i=0; i<3; ++i )
@@ -81,6 +106,7 @@ SetNthInputImage( unsigned int outputIndex,
       outSize[i] = inRegion.GetSize()[i];
       outSpacing[i] = img->GetSpacing()[i];
       outIndex[i] = inRegion.GetIndex()[i];
+      outOrigin[i] = img->GetOrigin()[i];
       for( unsigned int j=0; j<3; ++j )
         {
         outDirection(i, j) = img->GetDirection()(i, j);
@@ -89,12 +115,14 @@ SetNthInputImage( unsigned int outputIndex,
     outSize[3] = m_NumberOfInputImages;
     outSpacing[3] = 1;
     outIndex[3] = 0;
+    outOrigin[3] = 0;
 
     typename OutputImageType::RegionType outRegion;
     outRegion.SetSize( outSize );
     outRegion.SetIndex( outIndex );
     m_OutputImage->SetRegions( outRegion );
     m_OutputImage->SetSpacing( outSpacing );
+    m_OutputImage->SetOrigin( outOrigin );
     m_OutputImage->SetDirection( outDirection );
     m_OutputImage->Allocate(0);
     }
@@ -122,12 +150,231 @@ SetNthInputImage( unsigned int outputIndex,
     }
 }
 
+template< class InputImageT >
+void
+Write4DImageFrom3DImages< InputImageT >::
+StartStreaming( const InputImageType * img )
+{
+  typedef typename InputImageType::PixelType PixelType;
+
+  // The data follows the header in a .mha file, and is in a .raw file
+  //   next to it for a .mhd file
+  std::string extension = itksys::SystemTools::LowerCase(
+    itksys::SystemTools::GetFilenameLastExtension( m_FileName ) );
+  std::string dataFileName;
+  if( extension == ".mha" )
+    {
+    dataFileName = "LOCAL";
+    }
+  else if( extension == ".mhd" )
+    {
+    dataFileName = itksys::SystemTools::GetFilenameWithoutLastExtension(
+      m_FileName ) + ".raw";
+    }
+  else
+    {
+    itkExceptionMacro( << "Streaming frames requires a .mha or .mhd file: "
+      << m_FileName );
+    }
+
+  // Only scalar pixels of the sizes MetaImage knows can be streamed
+  std::string elementType;
+  if( std::numeric_limits< PixelType >::is_specialized
+    && !std::numeric_limits< PixelType >::is_integer )
+    {
+    if( sizeof( PixelType ) == 4 )
+      {
+      elementType = "MET_FLOAT";
+      }
+    else if( sizeof( PixelType ) == 8 )
+      {
+      elementType = "MET_DOUBLE";
+      }
+    }
+  else if( std::numeric_limits< PixelType >::is_specialized )
+    {
+    std::string prefix = std::numeric_limits< PixelType >::is_signed
+      ? "MET_" : "MET_U";
+    switch( sizeof( PixelType ) )
+      {
+      case 1:
+        elementType = prefix + "CHAR";
+        break;
+      case 2:
+        elementType = prefix + "SHORT";
+        break;
+      case 4:
+        elementType = prefix + "INT";
+        break;
+      case 8:
+        elementType = prefix + "LONG_LONG";
+        break;
+      }
+    }
+  if( elementType.empty() )
+    {
+    itkExceptionMacro( << "Streaming frames requires a MetaImage scalar"
+      << " pixel type, not one of " << sizeof( PixelType ) << " bytes: "
+      << m_FileName );
+    }
+
+  const typename InputImageType::RegionType & inRegion =
+    img->GetLargestPossibleRegion();
+  m_FrameSize = inRegion.GetSize();
+  m_FramesWritten.assign( m_NumberOfInputImages, false );
+
+  m_FrameStream.open( m_FileName.c_str(), std::ios::out | std::ios::binary
+    | std::ios::trunc );
+  if( !m_FrameStream.is_open() )
+    {
+    itkExceptionMacro( << "Cannot open " << m_FileName );
+    }
+
+  // Index 0 of the time axis is at time 0, and the origin is that of the
+  //   first voxel of the frames
+  typename InputImageType::PointType origin;
+  img->TransformIndexToPhysicalPoint( inRegion.GetIndex(), origin );
+
+  m_FrameStream << std::setprecision( 17 );
+  m_FrameStream << "ObjectType = Image\n";
+  m_FrameStream << "NDims = 4\n";
+  m_FrameStream << "BinaryData = True\n";
+  m_FrameStream << "BinaryDataByteOrderMSB = "
+    << ( itk::ByteSwapper< PixelType >::SystemIsBigEndian() ? "True"
+      : "False" ) << "\n";
+  m_FrameStream << "CompressedData = False\n";
+  m_FrameStream << "TransformMatrix =";
+  for( unsigned int i=0; i<4; ++i )
+    {
+    for( unsigned int j=0; j<4; ++j )
+      {
+      double value = ( i == j ) ? 1 : 0;
+      if( i < 3 && j < 3 )
+        {
+        value = img->GetDirection()(j, i);
+        }
+      m_FrameStream << " " << value;
+      }
+    }
+  m_FrameStream << "\n";
+  m_FrameStream << "Offset = " << origin[0] << " " << origin[1] << " "
+    << origin[2] << " 0\n";
+  m_FrameStream << "CenterOfRotation = 0 0 0 0\n";
+  m_FrameStream << "ElementSpacing = " << img->GetSpacing()[0] << " "
+    << img->GetSpacing()[1] << " " << img->GetSpacing()[2] << " 1\n";
+  m_FrameStream << "DimSize = " << m_FrameSize[0] << " " << m_FrameSize[1]
+    << " " << m_FrameSize[2] << " " << m_NumberOfInputImages << "\n";
+  m_FrameStream << "ElementType = " << elementType << "\n";
+  m_FrameStream << "ElementDataFile = " << dataFileName << "\n";
+
+  if( dataFileName == "LOCAL" )
+    {
+    m_FrameDataOffset = m_FrameStream.tellp();
+    }
+  else
+    {
+    m_FrameStream.close();
+    std::string dataPath = itksys::SystemTools::GetFilenamePath(
+      m_FileName );
+    if( !dataPath.empty() )
+      {
+      dataPath += "/";
+      }
+    dataPath += dataFileName;
+    m_FrameStream.open( dataPath.c_str(), std::ios::out | std::ios::binary
+      | std::ios::trunc );
+    if( !m_FrameStream.is_open() )
+      {
+      itkExceptionMacro( << "Cannot open " << dataPath );
+      }
+    m_FrameDataOffset = 0;
+    }
+}
+
+template< class InputImageT >
+void
+Write4DImageFrom3DImages< InputImageT >::
+WriteFrame( unsigned int outputIndex, const InputImageType * img )
+{
+  if( outputIndex >= m_NumberOfInputImages )
+    {
+    itkExceptionMacro( << "Frame " << outputIndex << " is beyond the "
+      << m_NumberOfInputImages << " frames of the image" );
+    }
+  if( img->GetLargestPossibleRegion().GetSize() != m_FrameSize )
+    {
+    itkExceptionMacro( << "Frame " << outputIndex << " has size "
+      << img->GetLargestPossibleRegion().GetSize() << " instead of "
+      << m_FrameSize );
+    }
+  if( img->GetBufferedRegion() != img->GetLargestPossibleRegion() )
+    {
+    itkExceptionMacro( << "Frame " << outputIndex
+      << " is not entirely in memory" );
+    }
+
+  const std::streamoff frameBytes = static_cast< std::streamoff >(
+    img->GetLargestPossibleRegion().GetNumberOfPixels() )
+    * sizeof( typename InputImageType::PixelType );
+  m_FrameStream.seekp( m_FrameDataOffset + outputIndex * frameBytes );
+  m_FrameStream.write( reinterpret_cast< const char * >(
+    img->GetBufferPointer() ), frameBytes );
+  if( !m_FrameStream.good() )
+    {
+    itkExceptionMacro( << "Cannot write frame " << outputIndex << " to "
+      << m_FileName );
+    }
+  m_FramesWritten[outputIndex] = true;
+}
+
+template< class InputImageT >
+void
+Write4DImageFrom3DImages< InputImageT >::
+EndStreaming( void )
+{
+  if( !m_FrameStream.is_open() )
+    {
+    itkExceptionMacro( << "No frame was set" );
+    }
+
+  typename InputImageType::Pointer zeros = nullptr;
+  for( unsigned int i=0; i<m_NumberOfInputImages; ++i )
+    {
+    if( !m_FramesWritten[i] )
+      {
+      tube::WarningMessage( "Frame " + std::to_string( i )
+        + " was not set and is written as zeros" );
+      if( zeros.IsNull() )
+        {
+        typename InputImageType::RegionType region;
+        region.SetSize( m_FrameSize );
+        zeros = InputImageType::New();
+        zeros->SetRegions( region );
+        zeros->Allocate( true );
+        }
+      this->WriteFrame( i, zeros );
+      }
+    }
+
+  m_FrameStream.close();
+  if( m_FrameStream.fail() )
+    {
+    itkExceptionMacro( << "Cannot write " << m_FileName );
+    }
+}
+
 /** Main work happens here */
 template< class InputImageT >
 void
 Write4DImageFrom3DImages< InputImageT >::
 Update()
 {
+  if( m_StreamFrames )
+    {
+    this->EndStreaming();
+    return;
+    }
+
   typedef itk::ImageFileWriter< OutputImageType >  WriterType;
   typename WriterType::Pointer writer = WriterType::New();
   writer->SetInput( m_OutputImage );
@@ -145,6 +392,7 @@ PrintSelf( std::ostream & os, itk::Indent indent ) const
 
   os << indent << "Output image = " << m_OutputImage << std::endl;
   os << indent << "File name = " << m_FileName << std::endl;
+  os << indent << "Stream frames = " << m_StreamFrames << std::endl;
 }
 
 }; //namespace
@@ -25,6 +25,7 @@ set( TubeTK_Common_H_Files
   Common/tubeMacro.h
   Common/tubeMessage.h
   Common/tubeObject.h
+  Common/tubeProfiler.h
   Common/tubeStringUtilities.h
   Common/tubeTestMain.h )
 
@@ -32,7 +33,8 @@ set( TubeTK_Common_HXX_Files )
 
 set( TubeTK_Common_CXX_Files
   Common/tubeIndent.cxx
-  Common/tubeObject.cxx )
+  Common/tubeObject.cxx
+  Common/tubeProfiler.cxx )
 
 list( APPEND TubeTK_SRCS
   ${TubeTK_Common_H_Files}
@@ -0,0 +1,377 @@
+/*=========================================================================
+
+Library:   TubeTKLib
+
+Copyright Kitware Inc.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#include "tubeProfiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+#if defined( __unix__ ) || defined( __APPLE__ )
+#include <sys/resource.h>
+#endif
+
+namespace
+{
+
+struct OpenScope
+{
+  std::string  Path;
+  double       StartInMicroseconds;
+};
+
+// Scopes opened, but not yet closed, by the calling thread.
+thread_local std::vector< OpenScope > openScopes;
+
+// Index of the calling thread in the order threads first opened a scope.
+thread_local unsigned int threadIndex = 0;
+thread_local bool threadIndexAssigned = false;
+
+// Write a string as a JSON string literal.
+void WriteJSONString( std::ostream & os, const std::string & str )
+{
+  os << '"';
+  for( std::string::const_iterator it = str.begin(); it != str.end(); ++it )
+    {
+    switch( *it )
+      {
+      case '"':
+        os << "\\\"";
+        break;
+      case '\\':
+        os << "\\\\";
+        break;
+      case '\n':
+        os << "\\n";
+        break;
+      case '\t':
+        os << "\\t";
+        break;
+      default:
+        if( static_cast< unsigned char >( *it ) < 0x20 )
+          {
+          os << ' ';
+          }
+        else
+          {
+          os << *it;
+          }
+      }
+    }
+  os << '"';
+}
+
+} // End namespace
+
+namespace tube
+{
+
+std::atomic< bool > Profiler::s_Enabled( false );
+
+Profiler::Profiler( void )
+{
+  m_Epoch = std::chrono::steady_clock::now();
+  m_NumberOfThreads = 0;
+}
+
+Profiler & Profiler::GetInstance( void )
+{
+  static Profiler instance;
+  return instance;
+}
+
+void Profiler::SetEnabled( bool enabled )
+{
+  s_Enabled.store( enabled, std::memory_order_relaxed );
+}
+
+void Profiler::Reset( void )
+{
+  std::lock_guard< std::mutex > lock( m_Mutex );
+  m_Scopes.clear();
+  // Counters are zeroed rather than erased, since call sites cache them
+  for( std::map< std::string, CounterType >::iterator it =
+    m_Counters.begin(); it != m_Counters.end(); ++it )
+    {
+    it->second.store( 0 );
+    }
+  m_Epoch = std::chrono::steady_clock::now();
+}
+
+double Profiler::GetElapsedMicroseconds( void ) const
+{
+  return std::chrono::duration< double, std::micro >(
+    std::chrono::steady_clock::now() - m_Epoch ).count();
+}
+
+unsigned int Profiler::GetThreadIndex( void )
+{
+  if( !threadIndexAssigned )
+    {
+    std::lock_guard< std::mutex > lock( m_Mutex );
+    threadIndex = m_NumberOfThreads++;
+    threadIndexAssigned = true;
+    }
+  return threadIndex;
+}
+
+void Profiler::BeginScope( const std::string & name )
+{
+  OpenScope scope;
+  if( openScopes.empty() )
+    {
+    scope.Path = name;
+    }
+  else
+    {
+    scope.Path = openScopes.back().Path + "/" + name;
+    }
+  scope.StartInMicroseconds = this->GetElapsedMicroseconds();
+  openScopes.push_back( scope );
+}
+
+void Profiler::EndScope( void )
+{
+  if( openScopes.empty() )
+    {
+    return;
+    }
+
+  ScopeRecord record;
+  record.Path = openScopes.back().Path;
+  record.Depth = static_cast< unsigned int >( openScopes.size() - 1 );
+  record.Thread = this->GetThreadIndex();
+  record.StartInMicroseconds = openScopes.back().StartInMicroseconds;
+  record.DurationInMicroseconds = this->GetElapsedMicroseconds()
+    - record.StartInMicroseconds;
+  record.PeakResidentSetSizeInBytes = GetPeakResidentSetSize();
+  openScopes.pop_back();
+
+  std::lock_guard< std::mutex > lock( m_Mutex );
+  m_Scopes.push_back( record );
+}
+
+Profiler::CounterType * Profiler::GetCounter( const std::string & name )
+{
+  std::lock_guard< std::mutex > lock( m_Mutex );
+  // std::map nodes never move, so the pointer stays valid
+  return &m_Counters[name];
+}
+
+void Profiler::AddToCounter( const std::string & name,
+  unsigned long long value )
+{
+  this->GetCounter( name )->fetch_add( value, std::memory_order_relaxed );
+}
+
+std::vector< Profiler::ScopeRecord > Profiler::GetScopes( void ) const
+{
+  std::lock_guard< std::mutex > lock( m_Mutex );
+  return m_Scopes;
+}
+
+std::map< std::string, unsigned long long > Profiler::GetCounters( void )
+  const
+{
+  std::lock_guard< std::mutex > lock( m_Mutex );
+  std::map< std::string, unsigned long long > counters;
+  for( std::map< std::string, CounterType >::const_iterator it =
+    m_Counters.begin(); it != m_Counters.end(); ++it )
+    {
+    counters[it->first] = it->second.load();
+    }
+  return counters;
+}
+
+unsigned long long Profiler::GetPeakResidentSetSize( void )
+{
+#if defined( __unix__ ) || defined( __APPLE__ )
+  struct rusage usage;
+  if( getrusage( RUSAGE_SELF, &usage ) != 0 )
+    {
+    return 0;
+    }
+#if defined( __APPLE__ )
+  return static_cast< unsigned long long >( usage.ru_maxrss );
+#else
+  return static_cast< unsigned long long >( usage.ru_maxrss ) * 1024;
+#endif
+#else
+  return 0;
+#endif
+}
+
+void Profiler::WriteJSON( std::ostream & os ) const
+{
+  std::vector< ScopeRecord > scopes = this->GetScopes();
+  std::map< std::string, unsigned long long > counters =
+    this->GetCounters();
+
+  // Summary per path, in the order each path first closed
+  std::vector< std::string > paths;
+  std::map< std::string, unsigned long long > calls;
+  std::map< std::string, double > total;
+  std::map< std::string, double > maximum;
+  unsigned long long peakResidentSetSize = GetPeakResidentSetSize();
+  for( std::vector< ScopeRecord >::const_iterator it = scopes.begin();
+    it != scopes.end(); ++it )
+    {
+    if( calls.find( it->Path ) == calls.end() )
+      {
+      paths.push_back( it->Path );
+      total[it->Path] = 0;
+      maximum[it->Path] = 0;
+      }
+    ++calls[it->Path];
+    total[it->Path] += it->DurationInMicroseconds;
+    maximum[it->Path] = std::max( maximum[it->Path],
+      it->DurationInMicroseconds );
+    peakResidentSetSize = std::max( peakResidentSetSize,
+      it->PeakResidentSetSizeInBytes );
+    }
+
+  os << std::setprecision( 12 );
+  os << "{" << std::endl;
+  os << "  \"peakResidentSetSizeInBytes\": " << peakResidentSetSize << ","
+    << std::endl;
+
+  os << "  \"summary\": [";
+  for( unsigned int i = 0; i < paths.size(); ++i )
+    {
+    os << ( i > 0 ? "," : "" ) << std::endl << "    { \"path\": ";
+    WriteJSONString( os, paths[i] );
+    os << ", \"calls\": " << calls[paths[i]]
+      << ", \"totalInMicroseconds\": " << total[paths[i]]
+      << ", \"maximumInMicroseconds\": " << maximum[paths[i]] << " }";
+    }
+  os << std::endl << "  ]," << std::endl;
+
+  os << "  \"counters\": {";
+  bool first = true;
+  for( std::map< std::string, unsigned long long >::const_iterator it =
+    counters.begin(); it != counters.end(); ++it )
+    {
+    os << ( first ? "" : "," ) << std::endl << "    ";
+    WriteJSONString( os, it->first );
+    os << ": " << it->second;
+    first = false;
+    }
+  os << std::endl << "  }," << std::endl;
+
+  os << "  \"scopes\": [";
+  for( unsigned int i = 0; i < scopes.size(); ++i )
+    {
+    os << ( i > 0 ? "," : "" ) << std::endl << "    { \"path\": ";
+    WriteJSONString( os, scopes[i].Path );
+    os << ", \"depth\": " << scopes[i].Depth
+      << ", \"thread\": " << scopes[i].Thread
+      << ", \"startInMicroseconds\": " << scopes[i].StartInMicroseconds
+      << ", \"durationInMicroseconds\": "
+      << scopes[i].DurationInMicroseconds
+      << ", \"peakResidentSetSizeInBytes\": "
+      << scopes[i].PeakResidentSetSizeInBytes << " }";
+    }
+  os << std::endl << "  ]" << std::endl;
+  os << "}" << std::endl;
+}
+
+void Profiler::WriteChromeTrace( std::ostream & os ) const
+{
+  std::vector< ScopeRecord > scopes = this->GetScopes();
+  std::map< std::string, unsigned long long > counters =
+    this->GetCounters();
+
+  os << std::setprecision( 12 );
+  os << "{ \"traceEvents\": [";
+  double endInMicroseconds = 0;
+  bool first = true;
+  for( std::vector< ScopeRecord >::const_iterator it = scopes.begin();
+    it != scopes.end(); ++it )
+    {
+    // Chrome nests complete events by time, so only the leaf name is shown
+    std::string::size_type slash = it->Path.rfind( '/' );
+    std::string name = ( slash == std::string::npos ) ? it->Path
+      : it->Path.substr( slash + 1 );
+    os << ( first ? "" : "," ) << std::endl << "  { \"name\": ";
+    WriteJSONString( os, name );
+    os << ", \"cat\": \"tube\", \"ph\": \"X\", \"pid\": 0"
+      << ", \"tid\": " << it->Thread
+      << ", \"ts\": " << it->StartInMicroseconds
+      << ", \"dur\": " << it->DurationInMicroseconds
+      << ", \"args\": { \"path\": ";
+    WriteJSONString( os, it->Path );
+    os << ", \"peakResidentSetSizeInBytes\": "
+      << it->PeakResidentSetSizeInBytes << " } }";
+    endInMicroseconds = std::max( endInMicroseconds,
+      it->StartInMicroseconds + it->DurationInMicroseconds );
+    first = false;
+    }
+  for( std::map< std::string, unsigned long long >::const_iterator it =
+    counters.begin(); it != counters.end(); ++it )
+    {
+    os << ( first ? "" : "," ) << std::endl << "  { \"name\": ";
+    WriteJSONString( os, it->first );
+    os << ", \"ph\": \"C\", \"pid\": 0, \"tid\": 0"
+      << ", \"ts\": " << endInMicroseconds
+      << ", \"args\": { \"value\": " << it->second << " } }";
+    first = false;
+    }
+  os << std::endl << "] }" << std::endl;
+}
+
+bool Profiler::WriteFile( const std::string & filename ) const
+{
+  std::ofstream file( filename.c_str() );
+  if( !file )
+    {
+    return false;
+    }
+
+  const std::string traceSuffix = ".trace";
+  const std::string traceJSONSuffix = ".trace.json";
+  bool trace = false;
+  if( filename.size() >= traceSuffix.size()
+    && filename.compare( filename.size() - traceSuffix.size(),
+      traceSuffix.size(), traceSuffix ) == 0 )
+    {
+    trace = true;
+    }
+  if( filename.size() >= traceJSONSuffix.size()
+    && filename.compare( filename.size() - traceJSONSuffix.size(),
+      traceJSONSuffix.size(), traceJSONSuffix ) == 0 )
+    {
+    trace = true;
+    }
+
+  if( trace )
+    {
+    this->WriteChromeTrace( file );
+    }
+  else
+    {
+    this->WriteJSON( file );
+    }
+
+  return static_cast< bool >( file );
+}
+
+} // End namespace tube
@@ -0,0 +1,198 @@
+/*=========================================================================
+
+Library:   TubeTKLib
+
+Copyright Kitware Inc.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#ifndef __tubeProfiler_h
+#define __tubeProfiler_h
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace tube
+{
+
+/**
+ * Collects hierarchical stage timings, peak resident set size samples and
+ * named event counters across a process.
+ *
+ * Filters open scopes with tubeProfileScopeMacro and bump counters with
+ * tubeProfileCountMacro.  Both cost a single relaxed atomic load while the
+ * profiler is disabled, which is the default.  Scopes nest per thread, so
+ * a scope opened inside another is recorded as "Outer/Inner".  The
+ * collected data is written either as a JSON report or as a Chrome trace
+ * ( chrome://tracing, Perfetto ).
+ *
+ * \ingroup  Common
+ */
+class Profiler
+{
+public:
+
+  typedef Profiler                          Self;
+  typedef std::atomic< unsigned long long > CounterType;
+
+  /** One closed scope. */
+  struct ScopeRecord
+    {
+    std::string         Path;
+    unsigned int        Depth;
+    unsigned int        Thread;
+    double              StartInMicroseconds;
+    double              DurationInMicroseconds;
+    unsigned long long  PeakResidentSetSizeInBytes;
+    };
+
+  /** Return the process-wide profiler. */
+  static Profiler & GetInstance( void );
+
+  /** Return true if scopes and counters are being recorded. */
+  static bool IsEnabled( void )
+    {
+    return s_Enabled.load( std::memory_order_relaxed );
+    }
+
+  /** Start or stop recording. */
+  void SetEnabled( bool enabled );
+
+  /** Discard the recorded scopes and zero the counters. */
+  void Reset( void );
+
+  /** Open a scope on the calling thread. */
+  void BeginScope( const std::string & name );
+
+  /** Close the innermost scope of the calling thread. */
+  void EndScope( void );
+
+  /** Return the counter with the given name, creating it if needed.  The
+   * returned pointer stays valid for the lifetime of the process. */
+  CounterType * GetCounter( const std::string & name );
+
+  /** Add to the counter with the given name. */
+  void AddToCounter( const std::string & name, unsigned long long value );
+
+  /** Return a copy of the recorded scopes. */
+  std::vector< ScopeRecord > GetScopes( void ) const;
+
+  /** Return the current values of the counters. */
+  std::map< std::string, unsigned long long > GetCounters( void ) const;
+
+  /** Return the peak resident set size of the process in bytes, or 0 if
+   * it cannot be queried on this platform. */
+  static unsigned long long GetPeakResidentSetSize( void );
+
+  /** Write the scopes, a per-path summary and the counters as JSON. */
+  void WriteJSON( std::ostream & os ) const;
+
+  /** Write the scopes and counters in the Chrome trace event format. */
+  void WriteChromeTrace( std::ostream & os ) const;
+
+  /** Write a Chrome trace if the filename ends in ".trace" or
+   * ".trace.json", and a JSON report otherwise.  Return false if the file
+   * cannot be written. */
+  bool WriteFile( const std::string & filename ) const;
+
+private:
+
+  Profiler( void );
+  Profiler( const Self & );
+  void operator=( const Self & );
+
+  double GetElapsedMicroseconds( void ) const;
+
+  unsigned int GetThreadIndex( void );
+
+  static std::atomic< bool >                s_Enabled;
+
+  mutable std::mutex                        m_Mutex;
+  std::chrono::steady_clock::time_point     m_Epoch;
+  std::vector< ScopeRecord >                m_Scopes;
+  std::map< std::string, CounterType >      m_Counters;
+  unsigned int                              m_NumberOfThreads;
+
+}; // End class Profiler
+
+/**
+ * Opens a profiler scope on construction and closes it on destruction.
+ * Nothing is recorded if the profiler was disabled at construction.
+ *
+ * \ingroup  Common
+ */
+class ProfilerScope
+{
+public:
+
+  ProfilerScope( const char * name )
+    {
+    m_Active = Profiler::IsEnabled();
+    if( m_Active )
+      {
+      Profiler::GetInstance().BeginScope( name );
+      }
+    }
+
+  ~ProfilerScope( void )
+    {
+    if( m_Active )
+      {
+      Profiler::GetInstance().EndScope();
+      }
+    }
+
+private:
+
+  ProfilerScope( const ProfilerScope & );
+  void operator=( const ProfilerScope & );
+
+  bool m_Active;
+
+}; // End class ProfilerScope
+
+} // End namespace tube
+
+#define tubeProfileConcatenateMacro2( a, b ) a##b
+#define tubeProfileConcatenateMacro( a, b ) \
+  tubeProfileConcatenateMacro2( a, b )
+
+/** Time the rest of the enclosing block as a profiler scope. */
+#define tubeProfileScopeMacro( name ) \
+  ::tube::ProfilerScope tubeProfileConcatenateMacro( tubeProfileScope, \
+    __LINE__ )( name )
+
+/** Add n to the named profiler counter.  The counter is looked up once per
+ * call site. */
+#define tubeProfileCountMacro( name, n ) \
+  do \
+    { \
+    if( ::tube::Profiler::IsEnabled() ) \
+      { \
+      static ::tube::Profiler::CounterType * tubeProfileCounter = \
+        ::tube::Profiler::GetInstance().GetCounter( name ); \
+      tubeProfileCounter->fetch_add( n, std::memory_order_relaxed ); \
+      } \
+    } \
+  while( 0 )
+
+#endif // End !defined( __tubeProfiler_h )
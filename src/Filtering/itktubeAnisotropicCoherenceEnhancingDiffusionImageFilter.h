@@ -47,6 +47,13 @@ namespace tube
  * \warning Does not handle image directions.  Re-orient images to axial
  * ( direction cosines = identity matrix ) before using this function.
  *
+ * When UseFusedEigenAnalysis is on, the structure tensor filter is kept
+ * across iterations so its buffer is reused, and the eigen-decomposition
+ * and diffusion tensor construction are done together in one threaded
+ * pass, without the intermediate eigenvalue and eigenvector images.  Both
+ * modes use the same eigen solver, eigenvalue ordering and tensor
+ * construction, so they give the same result.
+ *
  * \sa AnisotropicDiffusionTensorImageFilter
  * \sa AnisotropicEdgeEnhancementDiffusionImageFilter
  *
@@ -136,6 +143,11 @@ public:
   itkGetMacro( ContrastParameterLambdaC, double );
   itkGetMacro( Alpha, double );
 
+  /** Compute the diffusion tensor in one fused, threaded pass instead of
+   * with the eigen analysis image filters.  Default is off. */
+  itkSetMacro( UseFusedEigenAnalysis, bool );
+  itkGetConstMacro( UseFusedEigenAnalysis, bool );
+  itkBooleanMacro( UseFusedEigenAnalysis );
 
 protected:
   AnisotropicCoherenceEnhancingDiffusionImageFilter( void );
@@ -145,6 +157,16 @@ protected:
   /** Update diffusion tensor image */
   void virtual UpdateDiffusionTensorImage( void ) override;
 
+  /** Fused, threaded implementation of UpdateDiffusionTensorImage() */
+  void UpdateDiffusionTensorImageFused( void );
+
+  /** Diffusion tensor of one voxel from the structure tensor eigenvalues,
+   * in ascending order, and the matching eigenvectors, one per row.
+   * Shared by both implementations so they give the same result. */
+  void ComputeDiffusionTensor( const EigenValueArrayType & eigenValue,
+    MatrixType eigenVectorMatrix,
+    typename DiffusionTensorImageType::PixelType & tensor ) const;
+
 private:
   //purposely not implemented
   AnisotropicCoherenceEnhancingDiffusionImageFilter( const Self& );
@@ -155,6 +177,10 @@ private:
   double     m_Sigma;
   double     m_SigmaOuter;
 
+  bool       m_UseFusedEigenAnalysis;
+
+  typename StructureTensorFilterType::Pointer m_StructureTensorFilter;
+
 }; // End class AnisotropicCoherenceEnhancingDiffusionImageFilter
 
 } // End namespace tube
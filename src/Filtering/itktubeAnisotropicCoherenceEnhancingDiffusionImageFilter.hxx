@@ -28,10 +28,13 @@ limitations under the License.
 #include <itkImageFileWriter.h>
 #include <itkImageRegionConstIterator.h>
 #include <itkImageRegionIterator.h>
+#include <itkMultiThreaderBase.h>
 #include <itkNeighborhoodAlgorithm.h>
 #include <itkNumericTraits.h>
+#include <itkSymmetricEigenAnalysis.h>
 #include <itkVector.h>
 
+#include <algorithm>
 #include <list>
 
 namespace itk
@@ -51,6 +54,8 @@ AnisotropicCoherenceEnhancingDiffusionImageFilter<TInputImage, TOutputImage>
   m_Alpha = 0.001;
   m_Sigma = 1.0;
   m_SigmaOuter = 1.0;
+
+  m_UseFusedEigenAnalysis = false;
 }
 
 template< class TInputImage, class TOutputImage >
@@ -60,6 +65,12 @@ AnisotropicCoherenceEnhancingDiffusionImageFilter<TInputImage, TOutputImage>
 {
   itkDebugMacro( << "UpdateDiffusionTensorImage() called." );
 
+  if( m_UseFusedEigenAnalysis )
+    {
+    this->UpdateDiffusionTensorImageFused();
+    return;
+    }
+
   std::cerr << "UpdateDiffusionTensorImage()" << std::endl;
 
   /* IN THIS METHOD, the following items will be implemented
@@ -153,141 +164,200 @@ AnisotropicCoherenceEnhancingDiffusionImageFilter<TInputImage, TOutputImage>
   eigenVectorImageIterator.GoToBegin();
   eigenValueImageIterator.GoToBegin();
 
-  MatrixType  eigenValueMatrix;
+  typename DiffusionTensorImageType::PixelType tensor;
   while( !it.IsAtEnd() )
     {
-    // Generate the diagonal matrix with the eigenvalues
-    eigenValueMatrix.SetIdentity();
-
-    //Set the lambda's appropriately. For now, set them to be equal to the
-    //eigenvalues
-    double Lambda1;
-    double Lambda2;
-    double Lambda3;
-
-    // Get the eigenvalue
-    // Make sure they are sorted
-    EigenValueArrayType eigenValue;
-    eigenValue = eigenValueImageIterator.Get();
-
-    /* Assumption is that eigenvalue1 > eigenvalue2 > eigenvalue3 */
-
-    // Find the smallest eigenvalue
-    double smallest = std::fabs( eigenValue[0] );
-    unsigned int smallestEigenValueIndex=0;
-    for( unsigned int i=1; i <=2; i++ )
+    this->ComputeDiffusionTensor( eigenValueImageIterator.Get(),
+      eigenVectorImageIterator.Get(), tensor );
+    it.Set( tensor );
+
+    ++it;
+    ++eigenValueImageIterator;
+    ++eigenVectorImageIterator;
+    }
+}
+
+template< class TInputImage, class TOutputImage >
+void
+AnisotropicCoherenceEnhancingDiffusionImageFilter<TInputImage, TOutputImage>
+::ComputeDiffusionTensor( const EigenValueArrayType & eigenValue,
+  MatrixType eigenVectorMatrix,
+  typename DiffusionTensorImageType::PixelType & tensor ) const
+{
+  // Generate the diagonal matrix with the eigenvalues
+  MatrixType  eigenValueMatrix;
+  eigenValueMatrix.SetIdentity();
+
+  //Set the lambda's appropriately. For now, set them to be equal to the
+  //eigenvalues
+  double Lambda1;
+  double Lambda2;
+  double Lambda3;
+
+  /* Assumption is that eigenvalue1 > eigenvalue2 > eigenvalue3 */
+
+  // Find the smallest eigenvalue
+  double smallest = std::fabs( eigenValue[0] );
+  unsigned int smallestEigenValueIndex=0;
+  for( unsigned int i=1; i <=2; i++ )
+    {
+    if( std::fabs( eigenValue[i] ) < smallest )
       {
-      if( std::fabs( eigenValue[i] ) < smallest )
-        {
-        Lambda1 = eigenValue[i];
-        smallest = std::fabs( eigenValue[i] );
-        smallestEigenValueIndex = i;
-        }
+      smallest = std::fabs( eigenValue[i] );
+      smallestEigenValueIndex = i;
       }
+    }
 
-    // Find the largest eigenvalue
-    double largest = std::fabs( eigenValue[0] );
-    unsigned int largestEigenValueIndex=0;
-    for( unsigned int i=1; i <=2; i++ )
+  // Find the largest eigenvalue
+  double largest = std::fabs( eigenValue[0] );
+  unsigned int largestEigenValueIndex=0;
+  for( unsigned int i=1; i <=2; i++ )
+    {
+    if( std::fabs( eigenValue[i] > largest ) )
       {
-      if( std::fabs( eigenValue[i] > largest ) )
-        {
-        largest = std::fabs( eigenValue[i] );
-        largestEigenValueIndex = i;
-        }
+      largest = std::fabs( eigenValue[i] );
+      largestEigenValueIndex = i;
       }
+    }
 
-    unsigned int middleEigenValueIndex=0;
-    for( unsigned int i=0; i <=2; i++ )
+  unsigned int middleEigenValueIndex=0;
+  for( unsigned int i=0; i <=2; i++ )
+    {
+    if( eigenValue[i] != smallest && eigenValue[i] != largest )
       {
-      if( eigenValue[i] != smallest && eigenValue[i] != largest )
-        {
-        middleEigenValueIndex = i;
-        break;
-        }
+      middleEigenValueIndex = i;
+      break;
       }
+    }
 
-    Lambda1 = m_Alpha;
-    Lambda2 = m_Alpha;
+  Lambda1 = m_Alpha;
+  Lambda2 = m_Alpha;
 
-    double zeroValueTolerance = 1.0e-20;
+  double zeroValueTolerance = 1.0e-20;
 
-    /* largest > middle > smallest */
+  /* largest > middle > smallest */
 
-    if( ( std::fabs( eigenValue[middleEigenValueIndex] ) <
-        zeroValueTolerance )  ||
-       ( std::fabs( eigenValue[smallestEigenValueIndex] ) <
-         zeroValueTolerance ) )
-      {
-      Lambda3 = 1.0;
-      }
-    else
-      {
-      double kappa = std::pow( (float)( eigenValue[middleEigenValueIndex] )
-        / ( m_Alpha + eigenValue[smallestEigenValueIndex] ), 4.0 );
+  if( ( std::fabs( eigenValue[middleEigenValueIndex] ) <
+      zeroValueTolerance )  ||
+     ( std::fabs( eigenValue[smallestEigenValueIndex] ) <
+       zeroValueTolerance ) )
+    {
+    Lambda3 = 1.0;
+    }
+  else
+    {
+    double kappa = std::pow( (float)( eigenValue[middleEigenValueIndex] )
+      / ( m_Alpha + eigenValue[smallestEigenValueIndex] ), 4.0 );
 
-      double contrastParameterLambdaCSquare = m_ContrastParameterLambdaC
-        * m_ContrastParameterLambdaC;
+    double contrastParameterLambdaCSquare = m_ContrastParameterLambdaC
+      * m_ContrastParameterLambdaC;
 
-      double expVal = std::exp( ( -1.0 * ( std::log( 2.0 )
-        * contrastParameterLambdaCSquare )/kappa ) );
-      Lambda3 = m_Alpha + ( 1.0 - m_Alpha )*expVal;
+    double expVal = std::exp( ( -1.0 * ( std::log( 2.0 )
+      * contrastParameterLambdaCSquare )/kappa ) );
+    Lambda3 = m_Alpha + ( 1.0 - m_Alpha )*expVal;
 
-      }
+    }
 
-    eigenValueMatrix( 0, 0 ) = Lambda1;
-    eigenValueMatrix( 1, 1 ) = Lambda2;
-    eigenValueMatrix( 2, 2 ) = Lambda3;
+  eigenValueMatrix( 0, 0 ) = Lambda1;
+  eigenValueMatrix( 1, 1 ) = Lambda2;
+  eigenValueMatrix( 2, 2 ) = Lambda3;
 
-    //Get the eigenVector matrix
-    EigenVectorMatrixType eigenVectorMatrix;
-    unsigned int vectorLength = 3; // Eigenvector length
+  unsigned int vectorLength = 3; // Eigenvector length
 
-    itk::VariableLengthVector<double> firstEigenVector( vectorLength );
-    itk::VariableLengthVector<double> secondEigenVector( vectorLength );
-    itk::VariableLengthVector<double> thirdEigenVector( vectorLength );
+  double firstEigenVector;
+  double secondEigenVector;
+  double thirdEigenVector;
 
-    for( unsigned int i=0; i < vectorLength; i++ ) {
+  for( unsigned int i=0; i < vectorLength; i++ )
+    {
     // Get eigenvectors belonging to eigenvalue order
-      firstEigenVector[i] = eigenVectorMatrix[largestEigenValueIndex][i];
-      secondEigenVector[i] = eigenVectorMatrix[middleEigenValueIndex][i];
-      thirdEigenVector[i] = eigenVectorMatrix[smallestEigenValueIndex][i];
-
-      // Set eigenVectorMatrix in correct order
-      eigenVectorMatrix[0][i] = firstEigenVector[i];
-      eigenVectorMatrix[1][i] = secondEigenVector[i];
-      eigenVectorMatrix[2][i] = thirdEigenVector[i];
-      }
-
-    EigenVectorMatrixType  eigenVectorMatrixTranspose;
-    eigenVectorMatrixTranspose = eigenVectorMatrix.GetTranspose();
+    firstEigenVector = eigenVectorMatrix[largestEigenValueIndex][i];
+    secondEigenVector = eigenVectorMatrix[middleEigenValueIndex][i];
+    thirdEigenVector = eigenVectorMatrix[smallestEigenValueIndex][i];
+
+    // Set eigenVectorMatrix in correct order
+    eigenVectorMatrix[0][i] = firstEigenVector;
+    eigenVectorMatrix[1][i] = secondEigenVector;
+    eigenVectorMatrix[2][i] = thirdEigenVector;
+    }
 
-    // Generate the tensor matrix
-    EigenVectorMatrixType  productMatrix;
-    productMatrix = eigenVectorMatrix * eigenValueMatrix
-      * eigenVectorMatrixTranspose;
+  MatrixType  eigenVectorMatrixTranspose;
+  eigenVectorMatrixTranspose = eigenVectorMatrix.GetTranspose();
 
-    //Copy the ITK::Matrix to the tensor...there should be a better way of
-    //doing this TODO
-    typename DiffusionTensorImageType::PixelType        tensor;
+  // Generate the tensor matrix
+  MatrixType  productMatrix;
+  productMatrix = eigenVectorMatrix * eigenValueMatrix
+    * eigenVectorMatrixTranspose;
 
-    tensor( 0, 0 ) = productMatrix( 0, 0 );
-    tensor( 0, 1 ) = productMatrix( 0, 1 );
-    tensor( 0, 2 ) = productMatrix( 0, 2 );
+  for( unsigned int j=0; j<3; ++j )
+    {
+    for( unsigned int k=j; k<3; ++k )
+      {
+      tensor( j, k ) = productMatrix( j, k );
+      }
+    }
+}
 
-    tensor( 1, 0 ) = productMatrix( 1, 0 );
-    tensor( 1, 1 ) = productMatrix( 1, 1 );
-    tensor( 1, 2 ) = productMatrix( 1, 2 );
+template< class TInputImage, class TOutputImage >
+void
+AnisotropicCoherenceEnhancingDiffusionImageFilter<TInputImage, TOutputImage>
+::UpdateDiffusionTensorImageFused( void )
+{
+  if( m_StructureTensorFilter.IsNull() )
+    {
+    m_StructureTensorFilter = StructureTensorFilterType::New();
+    }
+  m_StructureTensorFilter->SetInput( this->GetOutput() );
+  m_StructureTensorFilter->SetSigma( m_Sigma );
+  m_StructureTensorFilter->SetSigmaOuter( m_SigmaOuter );
+  // The output is updated in place by each iteration
+  m_StructureTensorFilter->Modified();
+  m_StructureTensorFilter->Update();
+
+  typedef typename StructureTensorFilterType::OutputImageType
+    StructureTensorImageType;
+
+  const StructureTensorImageType * structureTensorImage =
+    m_StructureTensorFilter->GetOutput();
+  DiffusionTensorImageType * diffusionTensorImage =
+    this->GetDiffusionTensorImage();
+
+  typedef SymmetricEigenAnalysis< typename
+    StructureTensorImageType::PixelType, EigenValueArrayType, MatrixType >
+    EigenAnalysisType;
+
+  /* Same eigenvalue ordering and tensor construction as the eigen
+     analysis filter path, see ComputeDiffusionTensor() */
+  this->GetMultiThreader()->template ParallelizeImageRegion< 3 >(
+    diffusionTensorImage->GetLargestPossibleRegion(),
+    [&]( const typename DiffusionTensorImageType::RegionType & region )
+      {
+      ImageRegionConstIterator< StructureTensorImageType > tensorIt(
+        structureTensorImage, region );
+      ImageRegionIterator< DiffusionTensorImageType > it(
+        diffusionTensorImage, region );
+
+      // Same calculator and ordering as the eigen analysis image filters
+      EigenAnalysisType eigenAnalysis;
+      eigenAnalysis.SetDimension( 3 );
+      eigenAnalysis.SetOrderEigenValues( true );
+
+      EigenValueArrayType eigenValue;
+      MatrixType eigenVectorMatrix;
+      typename DiffusionTensorImageType::PixelType tensor;
+      while( !it.IsAtEnd() )
+        {
+        eigenAnalysis.ComputeEigenValuesAndVectors( tensorIt.Get(),
+          eigenValue, eigenVectorMatrix );
 
-    tensor( 2, 0 ) = productMatrix( 2, 0 );
-    tensor( 2, 1 ) = productMatrix( 2, 1 );
-    tensor( 2, 2 ) = productMatrix( 2, 2 );
-    it.Set( tensor );
+        this->ComputeDiffusionTensor( eigenValue, eigenVectorMatrix,
+          tensor );
+        it.Set( tensor );
 
-    ++it;
-    ++eigenValueImageIterator;
-    ++eigenVectorImageIterator;
-    }
+        ++it;
+        ++tensorIt;
+        }
+      }, nullptr );
 }
 
 template< class TInputImage, class TOutputImage >
@@ -302,6 +372,8 @@ AnisotropicCoherenceEnhancingDiffusionImageFilter<TInputImage, TOutputImage>
   os << indent << "Sigma: " << m_Sigma << std::endl;
   os << indent << "SigmaOuter : " << m_SigmaOuter << std::endl;
   os << indent << "Alpha: " << m_Alpha << std::endl;
+  os << indent << "UseFusedEigenAnalysis: " << m_UseFusedEigenAnalysis
+    << std::endl;
 }
 
 } // End namespace tube
@@ -104,6 +104,13 @@ public:
   itkSetMacro( TimeStep, double );
   itkGetMacro( TimeStep, double );
 
+  /** Number of iterations between recomputations of the diffusion tensor
+   * image.  The default of 1 recomputes it every iteration; larger values
+   * reuse the tensor field, which changes slowly, across iterations. */
+  itkSetClampMacro( DiffusionTensorUpdateInterval, unsigned int, 1,
+    NumericTraits< unsigned int >::max() );
+  itkGetConstMacro( DiffusionTensorUpdateInterval, unsigned int );
+
 #ifdef ITK_USE_CONCEPT_CHECKING
   /** Begin concept checking */
   itkConceptMacro( OutputTimesDoubleCheck,
@@ -218,6 +225,8 @@ private:
 
   TimeStepType                                          m_TimeStep;
 
+  unsigned int m_DiffusionTensorUpdateInterval;
+
 }; // End class AnisotropicDiffusionTensorImageFilter
 
 } // End namespace tube
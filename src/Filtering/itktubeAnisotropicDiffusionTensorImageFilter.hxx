@@ -53,6 +53,7 @@ AnisotropicDiffusionTensorImageFilter<TInputImage, TOutputImage>
   m_DiffusionTensorImage = DiffusionTensorImageType::New();
   this->SetNumberOfIterations( 1 );
   m_TimeStep = 0.11;
+  m_DiffusionTensorUpdateInterval = 1;
 
   //set the finite difference function object
   typename AnisotropicDiffusionTensorFunction<UpdateBufferType>::Pointer q
@@ -99,8 +100,12 @@ AnisotropicDiffusionTensorImageFilter<TInputImage, TOutputImage>
     }
 
   // Update the diffusion tensor image: implemented in subclasses, for example
-  // to calculate the structure tensor and its eigenvectors and eigenvalues
-  this->UpdateDiffusionTensorImage();
+  // to calculate the structure tensor and its eigenvectors and eigenvalues.
+  // Between updates the previous tensor field is reused.
+  if( this->GetElapsedIterations() % m_DiffusionTensorUpdateInterval == 0 )
+    {
+    this->UpdateDiffusionTensorImage();
+    }
 }
 
 template< class TInputImage, class TOutputImage >
@@ -538,6 +543,8 @@ AnisotropicDiffusionTensorImageFilter<TInputImage, TOutputImage>
   Superclass::PrintSelf( os, indent );
 
   os << indent << "TimeStep: " << m_TimeStep  << std::endl;
+  os << indent << "DiffusionTensorUpdateInterval: "
+     << m_DiffusionTensorUpdateInterval << std::endl;
 }
 
 } // End namespace tube
@@ -29,6 +29,7 @@ limitations under the License.
 #include "itktubeSymmetricEigenVectorAnalysisImageFilter.h"
 
 #include <itkDiffusionTensor3D.h>
+#include <itkGradientMagnitudeRecursiveGaussianImageFilter.h>
 #include <itkSymmetricEigenAnalysisImageFilter.h>
 
 namespace itk
@@ -46,6 +47,14 @@ namespace tube
  * \warning Does not handle image directions.  Re-orient images to axial
  * ( direction cosines = identity matrix ) before using this function,
  *
+ * When UseFusedEigenAnalysis is on, the structure tensor and gradient
+ * magnitude filters are kept across iterations so their buffers are
+ * reused, and the eigen-decomposition and diffusion tensor construction
+ * are done together in one threaded pass.  Both modes use the same eigen
+ * solver, eigenvalue ordering and tensor construction.
+ * Combine with SetDiffusionTensorUpdateInterval() to refresh the tensor
+ * only every k iterations.
+ *
  * \sa AnisotropicDiffusionTensorImageFilter
  * \sa AnisotropicCoherenceEnhancingDiffusionImageFilter
  *
@@ -87,6 +96,9 @@ public:
   typedef StructureTensorRecursiveGaussianImageFilter < InputImageType >
                                                 StructureTensorFilterType;
 
+  typedef GradientMagnitudeRecursiveGaussianImageFilter< InputImageType >
+                                                GradientMagnitudeFilterType;
+
   /** Dimensionality of input and output data is assumed to be the same.
    * It is inherited from the superclass. */
   itkStaticConstMacro( ImageDimension, unsigned int,
@@ -143,6 +155,12 @@ public:
   itkGetMacro( Sigma, double );
   itkGetMacro( SigmaOuter, double );
 
+  /** Compute the diffusion tensor in one fused, threaded pass instead of
+   * with the eigen analysis image filters.  Default is off. */
+  itkSetMacro( UseFusedEigenAnalysis, bool );
+  itkGetConstMacro( UseFusedEigenAnalysis, bool );
+  itkBooleanMacro( UseFusedEigenAnalysis );
+
 protected:
   AnisotropicHybridDiffusionImageFilter( void );
  ~AnisotropicHybridDiffusionImageFilter( void ) {}
@@ -152,6 +170,9 @@ protected:
   /** Update diffusion tensor image */
   void virtual UpdateDiffusionTensorImage( void ) override;
 
+  /** Fused, threaded implementation of UpdateDiffusionTensorImage() */
+  void UpdateDiffusionTensorImageFused( void );
+
 private:
   //purposely not implemented
   AnisotropicHybridDiffusionImageFilter( const Self& );
@@ -165,6 +186,18 @@ private:
   double    m_SigmaOuter;
   double    m_Alpha;
 
+  /** Diffusion tensor of one voxel from the structure tensor eigenvalues,
+   * in ascending order, the matching eigenvectors, one per row, and the
+   * gradient magnitude.  Shared by both implementations. */
+  void ComputeDiffusionTensor( const EigenValueArrayType & eigenValue,
+    MatrixType eigenVectorMatrix, double gradientMagnitude,
+    typename DiffusionTensorImageType::PixelType & tensor ) const;
+
+  bool      m_UseFusedEigenAnalysis;
+
+  typename StructureTensorFilterType::Pointer   m_StructureTensorFilter;
+  typename GradientMagnitudeFilterType::Pointer m_GradientMagnitudeFilter;
+
 }; // End class AnisotropicHybridDiffusionImageFilter
 
 } // End namespace tube
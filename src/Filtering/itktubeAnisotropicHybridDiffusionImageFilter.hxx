@@ -25,14 +25,16 @@ limitations under the License.
 
 
 #include <itkFixedArray.h>
-#include <itkGradientMagnitudeRecursiveGaussianImageFilter.h>
 #include <itkImageFileWriter.h>
 #include <itkImageRegionConstIterator.h>
 #include <itkImageRegionIterator.h>
+#include <itkMultiThreaderBase.h>
 #include <itkNeighborhoodAlgorithm.h>
 #include <itkNumericTraits.h>
+#include <itkSymmetricEigenAnalysis.h>
 #include <itkVector.h>
 
+#include <algorithm>
 #include <list>
 
 namespace itk
@@ -55,6 +57,8 @@ AnisotropicHybridDiffusionImageFilter<TInputImage, TOutputImage>
   m_Sigma = 1.0;
   m_SigmaOuter = 1.0;
   m_Alpha = 0.001;
+
+  m_UseFusedEigenAnalysis = false;
 }
 
 template< class TInputImage, class TOutputImage >
@@ -64,6 +68,12 @@ AnisotropicHybridDiffusionImageFilter<TInputImage, TOutputImage>
 {
   itkDebugMacro( << "UpdateDiffusionTensorImage() called." );
 
+  if( m_UseFusedEigenAnalysis )
+    {
+    this->UpdateDiffusionTensorImageFused();
+    return;
+    }
+
   /* IN THIS METHOD, the following items will be implemented
    - Compute the structure tensor ( Multiscale version structure tensor )
    - Compute its eigenvectors
@@ -123,9 +133,6 @@ AnisotropicHybridDiffusionImageFilter<TInputImage, TOutputImage>
 
   /* Compute the gradient magnitude. This is required to set Lambda1 */
 
-  typedef itk::GradientMagnitudeRecursiveGaussianImageFilter<InputImageType>
-    GradientMagnitudeFilterType;
-
   typename GradientMagnitudeFilterType::Pointer gradientMagnitudeFilter
     = GradientMagnitudeFilterType::New();
   gradientMagnitudeFilter->SetInput( this->GetInput() );
@@ -180,204 +187,282 @@ AnisotropicHybridDiffusionImageFilter<TInputImage, TOutputImage>
   eigenValueImageIterator.GoToBegin();
   gradientMagnitudeImageIterator.GoToBegin();
 
-  MatrixType  eigenValueMatrix;
+  typename DiffusionTensorImageType::PixelType tensor;
   while( !it.IsAtEnd() )
     {
-    // Generate the diagonal matrix with the eigenvalues
-    eigenValueMatrix.SetIdentity();
+    this->ComputeDiffusionTensor( eigenValueImageIterator.Get(),
+      eigenVectorImageIterator.Get(), gradientMagnitudeImageIterator.Get(),
+      tensor );
+    it.Set( tensor );
+
+    ++it;
+    ++eigenValueImageIterator;
+    ++eigenVectorImageIterator;
+    ++gradientMagnitudeImageIterator;
+    }
+}
 
-    // Get the eigenvalue
-    EigenValueArrayType eigenValue;
-    eigenValue = eigenValueImageIterator.Get();
+template< class TInputImage, class TOutputImage >
+void
+AnisotropicHybridDiffusionImageFilter<TInputImage, TOutputImage>
+::ComputeDiffusionTensor( const EigenValueArrayType & eigenValue,
+  MatrixType eigenVectorMatrix, double gradientMagnitude,
+  typename DiffusionTensorImageType::PixelType & tensor ) const
+{
+  // Generate the diagonal matrix with the eigenvalues
+  MatrixType  eigenValueMatrix;
+  eigenValueMatrix.SetIdentity();
 
-    /* Assumption is that eigenvalue1 > eigenvalue2 > eigenvalue3 */
+  /* Assumption is that eigenvalue1 > eigenvalue2 > eigenvalue3 */
 
-    // Find the smallest eigenvalue
-    double smallest = std::fabs( eigenValue[0] );
-    unsigned int smallestEigenValueIndex=0;
+  // Find the smallest eigenvalue
+  double smallest = std::fabs( eigenValue[0] );
+  unsigned int smallestEigenValueIndex=0;
 
-    for( unsigned int i=1; i <=2; i++ )
+  for( unsigned int i=1; i <=2; i++ )
+    {
+    if( std::fabs( eigenValue[i] ) < smallest )
       {
-      if( std::fabs( eigenValue[i] ) < smallest )
-        {
-        smallest = std::fabs( eigenValue[i] );
-        smallestEigenValueIndex = i;
-        }
+      smallest = std::fabs( eigenValue[i] );
+      smallestEigenValueIndex = i;
       }
+    }
 
-    // Find the largest eigenvalue
-    double largest = std::fabs( eigenValue[0] );
-    unsigned int largestEigenValueIndex=0;
+  // Find the largest eigenvalue
+  double largest = std::fabs( eigenValue[0] );
+  unsigned int largestEigenValueIndex=0;
 
-    for( unsigned int i=1; i <=2; i++ )
+  for( unsigned int i=1; i <=2; i++ )
+    {
+    if( std::fabs( eigenValue[i] ) > largest )
       {
-      if( std::fabs( eigenValue[i] ) > largest )
-        {
-        largestEigenValueIndex = i;
-        }
+      largestEigenValueIndex = i;
       }
+    }
 
-    unsigned int middleEigenValueIndex=0;
+  unsigned int middleEigenValueIndex=0;
 
-    for( unsigned int i=0; i <=2; i++ )
+  for( unsigned int i=0; i <=2; i++ )
+    {
+    if( std::fabs( eigenValue[i] ) != smallest
+      && std::fabs( eigenValue[i] ) != largest )
       {
-      if( std::fabs( eigenValue[i] ) != smallest
-        && std::fabs( eigenValue[i] ) != largest )
-        {
-        middleEigenValueIndex = i;
-        break;
-        }
+      middleEigenValueIndex = i;
+      break;
       }
+    }
 
-    //Set the lambda's appropriately.
+  //Set the lambda's appropriately.
 
-    //Compute EED lambdas first
+  //Compute EED lambdas first
 
-    double LambdaEED1;
-    double LambdaEED2;
-    double LambdaEED3;
+  double LambdaEED1;
+  double LambdaEED2;
+  double LambdaEED3;
 
-    LambdaEED2 = 1.0;
-    LambdaEED3 = 1.0;
+  LambdaEED2 = 1.0;
+  LambdaEED3 = 1.0;
 
-    double zerovalueTolerance = 1e-15;
+  double zerovalueTolerance = 1e-15;
 
-    double gradientMagnitude = gradientMagnitudeImageIterator.Get();
+  if( gradientMagnitude < zerovalueTolerance )
+    {
+    LambdaEED1 = 1.0;
+    }
+  else
+    {
+    double gradientMagnitudeSquare = gradientMagnitude
+      * gradientMagnitude;
+    double ratio = ( gradientMagnitudeSquare )
+      / ( m_ContrastParameterLambdaEED*m_ContrastParameterLambdaEED );
+    double expVal = std::exp( ( -1.0 * m_ThresholdParameterC )
+      / ( std::pow( ratio, 4.0 ) ) );
+    LambdaEED1 = 1.0 - expVal;
+    }
 
-    if( gradientMagnitude < zerovalueTolerance )
-      {
-      LambdaEED1 = 1.0;
-      }
-    else
-      {
-      double gradientMagnitudeSquare = gradientMagnitude
-        * gradientMagnitude;
-      double ratio = ( gradientMagnitudeSquare )
-        / ( m_ContrastParameterLambdaEED*m_ContrastParameterLambdaEED );
-      double expVal = std::exp( ( -1.0 * m_ThresholdParameterC )
-        / ( std::pow( ratio, 4.0 ) ) );
-      LambdaEED1 = 1.0 - expVal;
-      }
+  /* std::cout << "LambdaEED1,LambdaEED2, LambdaEED3\t"
+       << LambdaEED1 << "\t" << LambdaEED2 << "\t" << LambdaEED3
+       << std::endl; */
 
-    /* std::cout << "LambdaEED1,LambdaEED2, LambdaEED3\t"
-         << LambdaEED1 << "\t" << LambdaEED2 << "\t" << LambdaEED3
-         << std::endl; */
+  /*Next compute Lambda's for CED */
 
-    /*Next compute Lambda's for CED */
+  double LambdaCED1;
+  double LambdaCED2;
+  double LambdaCED3;
 
-    double LambdaCED1;
-    double LambdaCED2;
-    double LambdaCED3;
+  LambdaCED1 = m_Alpha;
+  LambdaCED2 = m_Alpha;
 
-    LambdaCED1 = m_Alpha;
-    LambdaCED2 = m_Alpha;
+  double zeroValueTolerance = 1.0e-20;
 
-    double zeroValueTolerance = 1.0e-20;
+  if( ( std::fabs( eigenValue[middleEigenValueIndex] ) <
+      zeroValueTolerance )  ||
+    ( std::fabs( eigenValue[smallestEigenValueIndex] ) <
+      zeroValueTolerance ) )
+    {
+    LambdaCED3 = 1.0;
+    }
+  else
+    {
+    double kappa =
+     std::pow( ( ( float ) ( eigenValue[middleEigenValueIndex] ) /
+              ( m_Alpha + eigenValue[smallestEigenValueIndex] ) ),
+             4.0 );
 
-    if( ( std::fabs( eigenValue[middleEigenValueIndex] ) <
-        zeroValueTolerance )  ||
-      ( std::fabs( eigenValue[smallestEigenValueIndex] ) <
-        zeroValueTolerance ) )
-      {
-      LambdaCED3 = 1.0;
-      }
-    else
-      {
-      double kappa =
-       std::pow( ( ( float ) ( eigenValue[middleEigenValueIndex] ) /
-                ( m_Alpha + eigenValue[smallestEigenValueIndex] ) ),
-               4.0 );
+    double contrastParameterLambdaCEDSquare
+      = m_ContrastParameterLambdaCED * m_ContrastParameterLambdaCED;
 
-      double contrastParameterLambdaCEDSquare
-        = m_ContrastParameterLambdaCED * m_ContrastParameterLambdaCED;
+    double expVal = std::exp( ( -1.0 * ( std::log( 2.0 )
+      * contrastParameterLambdaCEDSquare )/kappa ) );
+    LambdaCED3 = m_Alpha + ( 1.0 - m_Alpha )*expVal;
+    }
 
-      double expVal = std::exp( ( -1.0 * ( std::log( 2.0 )
-        * contrastParameterLambdaCEDSquare )/kappa ) );
-      LambdaCED3 = m_Alpha + ( 1.0 - m_Alpha )*expVal;
-      }
+  /* Compute the lambda's for the continuous switch */
+  double Lambda1;
+  double Lambda2;
+  double Lambda3;
 
-    /* Compute the lambda's for the continuous switch */
-    double Lambda1;
-    double Lambda2;
-    double Lambda3;
+  double xi = ( eigenValue[largestEigenValueIndex]
+    /( m_Alpha + eigenValue[middleEigenValueIndex] ) ) -
+    ( eigenValue[middleEigenValueIndex]
+    /( m_Alpha + eigenValue[smallestEigenValueIndex] ) );
 
-    double xi = ( eigenValue[largestEigenValueIndex]
-      /( m_Alpha + eigenValue[middleEigenValueIndex] ) ) -
-      ( eigenValue[middleEigenValueIndex]
-      /( m_Alpha + eigenValue[smallestEigenValueIndex] ) );
+  double numerator = eigenValue[middleEigenValueIndex] *
+    ( ( m_ContrastParameterLambdaHybrid *
+        m_ContrastParameterLambdaHybrid )
+    * ( xi - std::fabs( xi ) ) - 2.0 *
+        eigenValue[smallestEigenValueIndex] );
 
-    double numerator = eigenValue[middleEigenValueIndex] *
-      ( ( m_ContrastParameterLambdaHybrid *
-          m_ContrastParameterLambdaHybrid )
-      * ( xi - std::fabs( xi ) ) - 2.0 *
-          eigenValue[smallestEigenValueIndex] );
 
+  double denominator = 2.0 * std::pow( m_ContrastParameterLambdaHybrid,
+    4.0 );
 
-    double denominator = 2.0 * std::pow( m_ContrastParameterLambdaHybrid,
-      4.0 );
+  double epsilon = std::exp( numerator/denominator );
 
-    double epsilon = std::exp( numerator/denominator );
+  Lambda1 = ( 1 - epsilon ) * LambdaCED1 + epsilon*LambdaEED1;
+  Lambda2 = ( 1 - epsilon ) * LambdaCED2 + epsilon*LambdaEED2;
+  Lambda3 = ( 1 - epsilon ) * LambdaCED3 + epsilon*LambdaEED3;
 
-    Lambda1 = ( 1 - epsilon ) * LambdaCED1 + epsilon*LambdaEED1;
-    Lambda2 = ( 1 - epsilon ) * LambdaCED2 + epsilon*LambdaEED2;
-    Lambda3 = ( 1 - epsilon ) * LambdaCED3 + epsilon*LambdaEED3;
+  eigenValueMatrix( 0, 0 ) = Lambda1;
+  eigenValueMatrix( 1, 1 ) = Lambda2;
+  eigenValueMatrix( 2, 2 ) = Lambda3;
 
-    eigenValueMatrix( 0, 0 ) = Lambda1;
-    eigenValueMatrix( 1, 1 ) = Lambda2;
-    eigenValueMatrix( 2, 2 ) = Lambda3;
+  unsigned int vectorLength = 3; // Eigenvector length
 
-    //Get the eigenVector matrix
-    EigenVectorMatrixType eigenVectorMatrix =
-      eigenVectorImageIterator.Get();
+  double firstEigenVector;
+  double secondEigenVector;
+  double thirdEigenVector;
 
-    unsigned int vectorLength = 3; // Eigenvector length
+  for( unsigned int i=0; i < vectorLength; i++ )
+    {
+    // Get eigenvectors belonging to eigenvalue order
+    firstEigenVector = eigenVectorMatrix[largestEigenValueIndex][i];
+    secondEigenVector = eigenVectorMatrix[middleEigenValueIndex][i];
+    thirdEigenVector = eigenVectorMatrix[smallestEigenValueIndex][i];
+
+    // Set eigenVectorMatrix in correct order
+    eigenVectorMatrix[0][i] = firstEigenVector;
+    eigenVectorMatrix[1][i] = secondEigenVector;
+    eigenVectorMatrix[2][i] = thirdEigenVector;
+    }
 
-    itk::VariableLengthVector<double> firstEigenVector( vectorLength );
-    itk::VariableLengthVector<double> secondEigenVector( vectorLength );
-    itk::VariableLengthVector<double> thirdEigenVector( vectorLength );
+  MatrixType  eigenVectorMatrixTranspose;
+  eigenVectorMatrixTranspose = eigenVectorMatrix.GetTranspose();
 
-    for( unsigned int i=0; i < vectorLength; i++ ) {
-    // Get eigenvectors belonging to eigenvalue order
-      firstEigenVector[i] = eigenVectorMatrix[largestEigenValueIndex][i];
-      secondEigenVector[i] = eigenVectorMatrix[middleEigenValueIndex][i];
-      thirdEigenVector[i] = eigenVectorMatrix[smallestEigenValueIndex][i];
-
-      // Set eigenVectorMatrix in correct order
-      eigenVectorMatrix[0][i] = firstEigenVector[i];
-      eigenVectorMatrix[1][i] = secondEigenVector[i];
-      eigenVectorMatrix[2][i] = thirdEigenVector[i];
-      }
+  // Generate the tensor matrix
+  MatrixType  productMatrix;
+  productMatrix = eigenVectorMatrix * eigenValueMatrix
+    * eigenVectorMatrixTranspose;
 
-    EigenVectorMatrixType  eigenVectorMatrixTranspose;
-    eigenVectorMatrixTranspose = eigenVectorMatrix.GetTranspose();
+  tensor( 0, 0 ) = productMatrix( 0, 0 );
+  tensor( 0, 1 ) = productMatrix( 0, 1 );
+  tensor( 0, 2 ) = productMatrix( 0, 2 );
 
-    // Generate the tensor matrix
-    EigenVectorMatrixType  productMatrix;
-    productMatrix = eigenVectorMatrix * eigenValueMatrix
-      * eigenVectorMatrixTranspose;
+  tensor( 1, 0 ) = productMatrix( 1, 0 );
+  tensor( 1, 1 ) = productMatrix( 1, 1 );
+  tensor( 1, 2 ) = productMatrix( 1, 2 );
 
-    //Copy the ITK::Matrix to the tensor...there should be a better way of
-    //doing this TODO
-    typename DiffusionTensorImageType::PixelType        tensor;
+  tensor( 2, 0 ) = productMatrix( 2, 0 );
+  tensor( 2, 1 ) = productMatrix( 2, 1 );
+  tensor( 2, 2 ) = productMatrix( 2, 2 );
+}
 
-    tensor( 0, 0 ) = productMatrix( 0, 0 );
-    tensor( 0, 1 ) = productMatrix( 0, 1 );
-    tensor( 0, 2 ) = productMatrix( 0, 2 );
+template< class TInputImage, class TOutputImage >
+void
+AnisotropicHybridDiffusionImageFilter<TInputImage, TOutputImage>
+::UpdateDiffusionTensorImageFused( void )
+{
+  if( m_StructureTensorFilter.IsNull() )
+    {
+    m_StructureTensorFilter = StructureTensorFilterType::New();
+    }
+  m_StructureTensorFilter->SetInput( this->GetOutput() );
+  m_StructureTensorFilter->SetSigma( m_Sigma );
+  m_StructureTensorFilter->SetSigmaOuter( m_SigmaOuter );
+  // The output is updated in place by each iteration
+  m_StructureTensorFilter->Modified();
+  m_StructureTensorFilter->Update();
+
+  // The input does not change, so this only executes on the first call
+  if( m_GradientMagnitudeFilter.IsNull() )
+    {
+    m_GradientMagnitudeFilter = GradientMagnitudeFilterType::New();
+    }
+  m_GradientMagnitudeFilter->SetInput( this->GetInput() );
+  m_GradientMagnitudeFilter->SetSigma( m_Sigma );
+  m_GradientMagnitudeFilter->Update();
 
-    tensor( 1, 0 ) = productMatrix( 1, 0 );
-    tensor( 1, 1 ) = productMatrix( 1, 1 );
-    tensor( 1, 2 ) = productMatrix( 1, 2 );
+  typedef typename StructureTensorFilterType::OutputImageType
+    StructureTensorImageType;
+  typedef typename GradientMagnitudeFilterType::OutputImageType
+    GradientMagnitudeImageType;
+
+  const StructureTensorImageType * structureTensorImage =
+    m_StructureTensorFilter->GetOutput();
+  const GradientMagnitudeImageType * gradientMagnitudeImage =
+    m_GradientMagnitudeFilter->GetOutput();
+  DiffusionTensorImageType * diffusionTensorImage =
+    this->GetDiffusionTensorImage();
+
+  typedef SymmetricEigenAnalysis< typename
+    StructureTensorImageType::PixelType, EigenValueArrayType, MatrixType >
+    EigenAnalysisType;
+
+  /* Same eigenvalue ordering and tensor construction as the eigen
+     analysis filter path, see ComputeDiffusionTensor() */
+  this->GetMultiThreader()->template ParallelizeImageRegion< 3 >(
+    diffusionTensorImage->GetLargestPossibleRegion(),
+    [&]( const typename DiffusionTensorImageType::RegionType & region )
+      {
+      ImageRegionConstIterator< StructureTensorImageType > tensorIt(
+        structureTensorImage, region );
+      ImageRegionConstIterator< GradientMagnitudeImageType > gradientIt(
+        gradientMagnitudeImage, region );
+      ImageRegionIterator< DiffusionTensorImageType > it(
+        diffusionTensorImage, region );
+
+      // Same calculator and ordering as the eigen analysis image filters
+      EigenAnalysisType eigenAnalysis;
+      eigenAnalysis.SetDimension( 3 );
+      eigenAnalysis.SetOrderEigenValues( true );
+
+      EigenValueArrayType eigenValue;
+      MatrixType eigenVectorMatrix;
+      typename DiffusionTensorImageType::PixelType tensor;
+      while( !it.IsAtEnd() )
+        {
+        eigenAnalysis.ComputeEigenValuesAndVectors( tensorIt.Get(),
+          eigenValue, eigenVectorMatrix );
 
-    tensor( 2, 0 ) = productMatrix( 2, 0 );
-    tensor( 2, 1 ) = productMatrix( 2, 1 );
-    tensor( 2, 2 ) = productMatrix( 2, 2 );
-    it.Set( tensor );
+        this->ComputeDiffusionTensor( eigenValue, eigenVectorMatrix,
+          gradientIt.Get(), tensor );
+        it.Set( tensor );
 
-    ++it;
-    ++eigenValueImageIterator;
-    ++eigenVectorImageIterator;
-    ++gradientMagnitudeImageIterator;
-    }
+        ++it;
+        ++tensorIt;
+        ++gradientIt;
+        }
+      }, nullptr );
 }
 
 template< class TInputImage, class TOutputImage >
@@ -398,6 +483,8 @@ AnisotropicHybridDiffusionImageFilter<TInputImage, TOutputImage>
   os << indent << "Alpha " << m_Alpha << std::endl;
   os << indent << "Sigma " << m_Sigma << std::endl;
   os << indent << "Sigma outer " << m_SigmaOuter << std::endl;
+  os << indent << "Use fused eigen analysis "
+    << m_UseFusedEigenAnalysis << std::endl;
 }
 
 } // End namespace tube
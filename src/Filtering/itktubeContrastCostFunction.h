@@ -25,6 +25,10 @@ limitations under the License.
 
 #include <itkSmoothingRecursiveGaussianImageFilter.h>
 #include <itkSingleValuedCostFunction.h>
+
+#include <list>
+#include <vector>
+
 namespace itk
 {
 
@@ -32,6 +36,13 @@ namespace tube
 {
 
 /** \class ContrastCostFunction
+ *
+ * The images blurred at the object and background scales are cached,
+ * keyed by the scale, so the repeated evaluations of an optimizer, and
+ * the finite differences of GetDerivative(), blur the input image only
+ * for scales not seen recently.  The statistics are computed only over the object and
+ * background voxels of the mask, listed once.  GetValue() does not
+ * write the output image; call ComputeOutputImage() for that.
  */
 
 template< class TPixel, unsigned int VDimension >
@@ -58,22 +69,44 @@ public:
 
   typedef itk::SmoothingRecursiveGaussianImageFilter< ImageType, ImageType >
                                                   BlurFilterType;
-  /** Set/Get input image */
-  itkSetConstObjectMacro( InputImage, ImageType );
+  /** Set/Get input image.  Setting it clears the cache of blurred
+   * images. */
+  void SetInputImage( const ImageType * image );
   itkGetConstObjectMacro( InputImage, ImageType );
 
   /** Set/Get input mask image */
-  itkSetObjectMacro( InputMask, ImageType );
+  void SetInputMask( ImageType * mask );
   itkGetModifiableObjectMacro( InputMask, ImageType );
 
   /** Set/Get Mask Object Value */
-  itkSetMacro( MaskObjectValue, int );
+  void SetMaskObjectValue( int value );
   itkGetMacro( MaskObjectValue, int );
 
   /** Set/Get Mask Background Value */
-  itkSetMacro( MaskBackgroundValue, int );
+  void SetMaskBackgroundValue( int value );
   itkGetMacro( MaskBackgroundValue, int );
 
+  /** Scales are rounded to a multiple of this value before blurring, so
+   * nearby scales share a cached image, at the cost of values that
+   * differ slightly from those of the exact scales.  Default is 0, no
+   * rounding. */
+  void SetSigmaQuantization( double quantization );
+  itkGetMacro( SigmaQuantization, double );
+
+  /** Maximum number of blurred images kept.  The least recently used
+   * image is discarded first.  Each is the size of the input image, so
+   * the cache can use up to this many times the memory of the input.
+   * GetDerivative() visits six scales, so fewer than six images make
+   * its evaluations blur again.  Zero disables the cache.  Default is
+   * 8. */
+  itkSetMacro( MaximumNumberOfCachedImages, unsigned int );
+  itkGetMacro( MaximumNumberOfCachedImages, unsigned int );
+
+  /** Number of blurs computed, and of blurs found in the cache, since
+   * the last call to Initialize() */
+  itkGetConstMacro( NumberOfBlurs, unsigned int );
+  itkGetConstMacro( NumberOfCacheHits, unsigned int );
+
   /** Set/Get output  image */
   itkSetObjectMacro( OutputImage, ImageType );
   itkGetModifiableObjectMacro( OutputImage, ImageType );
@@ -92,6 +125,11 @@ public:
   void GetDerivative( const ParametersType & parameters,
                              DerivativeType & derivative ) const override;
 
+  /** Write the contrast-enhanced image for the given parameters into
+   * the output image.  Scales that GetValue() rejects are clamped to the
+   * range it accepts. */
+  void ComputeOutputImage( const ParametersType & parameters ) const;
+
   void Initialize( void );
 protected:
 
@@ -102,6 +140,21 @@ private:
   ContrastCostFunction( const Self & );
   void operator=( const Self & );
 
+  struct BlurredImage
+    {
+    double                        Sigma;
+    typename ImageType::Pointer   Image;
+    double                        Mean;
+    };
+
+  /** Return the input image blurred at sigma, and its mean, from the
+   * cache if possible */
+  BlurredImage GetBlurredImage( double sigma ) const;
+
+  /** List the buffer offsets of the object and background voxels of the
+   * mask */
+  void UpdateMaskOffsets( void ) const;
+
   typename ImageType::ConstPointer    m_InputImage;
   typename ImageType::Pointer         m_InputMask;
   mutable typename ImageType::Pointer m_OutputImage;
@@ -112,6 +165,16 @@ private:
   ParametersType                      m_Scales;
   mutable unsigned int                m_CallsToGetValue;
 
+  double                              m_SigmaQuantization;
+  unsigned int                        m_MaximumNumberOfCachedImages;
+  mutable std::list< BlurredImage >   m_BlurredImageCache;
+  mutable unsigned int                m_NumberOfBlurs;
+  mutable unsigned int                m_NumberOfCacheHits;
+
+  mutable bool                        m_ValidMaskOffsets;
+  mutable std::vector< OffsetValueType > m_ObjectOffsets;
+  mutable std::vector< OffsetValueType > m_BackgroundOffsets;
+
 }; // End class ContrastCostFunction
 
 } // End namespace tube
@@ -23,6 +23,11 @@ limitations under the License.
 #ifndef __itktubeContrastCostFunction_hxx
 #define __itktubeContrastCostFunction_hxx
 
+#include <itkImageRegionConstIteratorWithIndex.h>
+#include <itkImageRegionIterator.h>
+
+#include <algorithm>
+#include <cmath>
 
 namespace itk
 {
@@ -41,6 +46,79 @@ ContrastCostFunction< TPixel, Dimension >
   m_MaskObjectValue = 0;
   m_MaskBackgroundValue = 0;
   m_CallsToGetValue = 0;
+
+  m_SigmaQuantization = 0;
+  m_MaximumNumberOfCachedImages = 8;
+  m_NumberOfBlurs = 0;
+  m_NumberOfCacheHits = 0;
+
+  m_ValidMaskOffsets = false;
+}
+
+template< class TPixel, unsigned int Dimension >
+void
+ContrastCostFunction< TPixel, Dimension >
+::SetInputImage( const ImageType * image )
+{
+  if( m_InputImage.GetPointer() != image )
+    {
+    m_InputImage = image;
+    m_BlurredImageCache.clear();
+    m_ValidMaskOffsets = false;
+    this->Modified();
+    }
+}
+
+template< class TPixel, unsigned int Dimension >
+void
+ContrastCostFunction< TPixel, Dimension >
+::SetInputMask( ImageType * mask )
+{
+  if( m_InputMask.GetPointer() != mask )
+    {
+    m_InputMask = mask;
+    m_ValidMaskOffsets = false;
+    this->Modified();
+    }
+}
+
+template< class TPixel, unsigned int Dimension >
+void
+ContrastCostFunction< TPixel, Dimension >
+::SetMaskObjectValue( int value )
+{
+  if( m_MaskObjectValue != value )
+    {
+    m_MaskObjectValue = value;
+    m_ValidMaskOffsets = false;
+    this->Modified();
+    }
+}
+
+template< class TPixel, unsigned int Dimension >
+void
+ContrastCostFunction< TPixel, Dimension >
+::SetMaskBackgroundValue( int value )
+{
+  if( m_MaskBackgroundValue != value )
+    {
+    m_MaskBackgroundValue = value;
+    m_ValidMaskOffsets = false;
+    this->Modified();
+    }
+}
+
+template< class TPixel, unsigned int Dimension >
+void
+ContrastCostFunction< TPixel, Dimension >
+::SetSigmaQuantization( double quantization )
+{
+  if( m_SigmaQuantization != quantization )
+    {
+    m_SigmaQuantization = quantization;
+    m_BlurredImageCache.clear();
+    this->Modified();
+    }
 }
 
 template< class TPixel, unsigned int Dimension >
@@ -60,38 +138,112 @@ ContrastCostFunction< TPixel, Dimension >
 }
 
 template< class TPixel, unsigned int Dimension >
-double
+typename ContrastCostFunction< TPixel, Dimension >::BlurredImage
 ContrastCostFunction< TPixel, Dimension >
-::GetValue( const ParametersType & params ) const
+::GetBlurredImage( double sigma ) const
 {
-  typename BlurFilterType::Pointer filterInputObj = BlurFilterType::New();
-  filterInputObj->SetInput( m_InputImage );
-  double sigmaObj = params[0];
-  if( sigmaObj > 0.3 && sigmaObj < 100 )
+  if( m_SigmaQuantization > 0 )
     {
-    filterInputObj->SetSigma( sigmaObj );
+    sigma = std::floor( sigma / m_SigmaQuantization + 0.5 )
+      * m_SigmaQuantization;
     }
-  else
+
+  typename std::list< BlurredImage >::iterator it =
+    m_BlurredImageCache.begin();
+  while( it != m_BlurredImageCache.end() )
     {
-    return 100;
+    if( it->Sigma == sigma )
+      {
+      ++m_NumberOfCacheHits;
+      m_BlurredImageCache.splice( m_BlurredImageCache.begin(),
+        m_BlurredImageCache, it );
+      return m_BlurredImageCache.front();
+      }
+    ++it;
     }
-  filterInputObj->Update();
-  typename ImageType::Pointer imgObj = filterInputObj->GetOutput();
 
-  typename BlurFilterType::Pointer filterInputBkg =
-    BlurFilterType::New();
-  filterInputBkg->SetInput( m_InputImage );
-  double sigmaBkg = params[1];
-  if( sigmaBkg > sigmaObj && sigmaBkg < 100 )
+  typename BlurFilterType::Pointer filter = BlurFilterType::New();
+  filter->SetInput( m_InputImage );
+  filter->SetSigma( sigma );
+  filter->Update();
+  ++m_NumberOfBlurs;
+
+  BlurredImage blurred;
+  blurred.Sigma = sigma;
+  blurred.Image = filter->GetOutput();
+  blurred.Mean = 0;
+  ImageRegionConstIterator< ImageType > iter( blurred.Image,
+    blurred.Image->GetLargestPossibleRegion() );
+  double count = 0;
+  while( !iter.IsAtEnd() )
+    {
+    blurred.Mean += iter.Get();
+    ++count;
+    ++iter;
+    }
+  blurred.Mean /= count;
+
+  m_BlurredImageCache.push_front( blurred );
+  while( m_BlurredImageCache.size() > m_MaximumNumberOfCachedImages )
+    {
+    m_BlurredImageCache.pop_back();
+    }
+
+  return blurred;
+}
+
+template< class TPixel, unsigned int Dimension >
+void
+ContrastCostFunction< TPixel, Dimension >
+::UpdateMaskOffsets( void ) const
+{
+  if( m_ValidMaskOffsets )
     {
-    filterInputBkg->SetSigma( sigmaBkg );
+    return;
     }
-  else
+
+  m_ObjectOffsets.clear();
+  m_BackgroundOffsets.clear();
+  ImageRegionConstIteratorWithIndex< ImageType > iterMask( m_InputMask,
+    m_InputMask->GetLargestPossibleRegion() );
+  while( !iterMask.IsAtEnd() )
+    {
+    if( iterMask.Get() == m_MaskObjectValue )
+      {
+      m_ObjectOffsets.push_back(
+        m_InputImage->ComputeOffset( iterMask.GetIndex() ) );
+      }
+    else if( iterMask.Get() == m_MaskBackgroundValue )
+      {
+      m_BackgroundOffsets.push_back(
+        m_InputImage->ComputeOffset( iterMask.GetIndex() ) );
+      }
+    ++iterMask;
+    }
+  m_ValidMaskOffsets = true;
+}
+
+template< class TPixel, unsigned int Dimension >
+double
+ContrastCostFunction< TPixel, Dimension >
+::GetValue( const ParametersType & params ) const
+{
+  double sigmaObj = params[0];
+  if( sigmaObj <= 0.3 || sigmaObj >= 100 )
+    {
+    return 100;
+    }
+  double sigmaBkg = params[1];
+  if( sigmaBkg <= sigmaObj || sigmaBkg >= 100 )
     {
     return 100;
     }
-  filterInputBkg->Update();
-  typename ImageType::Pointer imgBkg = filterInputBkg->GetOutput();
+
+  const BlurredImage blurObj = this->GetBlurredImage( sigmaObj );
+  const BlurredImage blurBkg = this->GetBlurredImage( sigmaBkg );
+  const TPixel * imgObj = blurObj.Image->GetBufferPointer();
+  const TPixel * imgBkg = blurBkg.Image->GetBufferPointer();
+  const double meanRawBkg = blurBkg.Mean;
 
   double alpha = params[2];
 
@@ -107,50 +259,24 @@ ContrastCostFunction< TPixel, Dimension >
   double sumBkg = 0;
   double sumsBkg = 0;
 
-  typedef ImageRegionIterator< ImageType >       ImageIteratorType;
-  typedef ImageRegionConstIterator< ImageType >  ConstImageIteratorType;
-
-  ConstImageIteratorType iterObj( imgObj,
-    imgObj->GetLargestPossibleRegion() );
-  ConstImageIteratorType iterBkg( imgBkg,
-    imgBkg->GetLargestPossibleRegion() );
-  ConstImageIteratorType iterMask( m_InputMask,
-    m_InputMask->GetLargestPossibleRegion() );
-  ImageIteratorType iterOut( m_OutputImage,
-    m_OutputImage->GetLargestPossibleRegion() );
+  this->UpdateMaskOffsets();
 
-  double meanRawBkg = 0;
-  double countRawBkg = 0;
-  while( !iterBkg.IsAtEnd() )
+  for( std::size_t i = 0; i < m_ObjectOffsets.size(); ++i )
     {
-    meanRawBkg += iterBkg.Get();
-    ++countRawBkg;
-    ++iterBkg;
+    const OffsetValueType o = m_ObjectOffsets[i];
+    double tf = imgObj[o] * ( 1 + alpha * ( imgBkg[o] - meanRawBkg ) );
+    sumObj += tf;
+    sumsObj += tf * tf;
     }
-  meanRawBkg /= countRawBkg;
-
-  iterBkg.GoToBegin();
-  while( !iterObj.IsAtEnd() )
+  countObj = m_ObjectOffsets.size();
+  for( std::size_t i = 0; i < m_BackgroundOffsets.size(); ++i )
     {
-    double tf = iterObj.Get() * ( 1 + alpha * ( iterBkg.Get() - meanRawBkg ) );
-    if( iterMask.Get() == m_MaskObjectValue )
-      {
-      sumObj += tf;
-      sumsObj += tf * tf;
-      ++countObj;
-      }
-    else if( iterMask.Get() == m_MaskBackgroundValue )
-      {
-      sumBkg += tf;
-      sumsBkg += tf * tf;
-      ++countBkg;
-      }
-    iterOut.Set( tf );
-    ++iterObj;
-    ++iterBkg;
-    ++iterMask;
-    ++iterOut;
+    const OffsetValueType o = m_BackgroundOffsets[i];
+    double tf = imgObj[o] * ( 1 + alpha * ( imgBkg[o] - meanRawBkg ) );
+    sumBkg += tf;
+    sumsBkg += tf * tf;
     }
+  countBkg = m_BackgroundOffsets.size();
 
   if( countObj > 0 )
     {
@@ -175,6 +301,40 @@ ContrastCostFunction< TPixel, Dimension >
   return dp;
 }
 
+template< class TPixel, unsigned int Dimension >
+void
+ContrastCostFunction< TPixel, Dimension >
+::ComputeOutputImage( const ParametersType & params ) const
+{
+  // Keep the scales within the range GetValue() accepts
+  const double sigmaObj = std::min( std::max( params[0], 0.3 ), 100.0 );
+  const double sigmaBkg = std::min( std::max( params[1], sigmaObj ),
+    100.0 );
+
+  const BlurredImage blurObj = this->GetBlurredImage( sigmaObj );
+  const BlurredImage blurBkg = this->GetBlurredImage( sigmaBkg );
+  const double meanRawBkg = blurBkg.Mean;
+  double alpha = params[2];
+
+  typedef ImageRegionIterator< ImageType >       ImageIteratorType;
+  typedef ImageRegionConstIterator< ImageType >  ConstImageIteratorType;
+
+  ConstImageIteratorType iterObj( blurObj.Image,
+    blurObj.Image->GetLargestPossibleRegion() );
+  ConstImageIteratorType iterBkg( blurBkg.Image,
+    blurBkg.Image->GetLargestPossibleRegion() );
+  ImageIteratorType iterOut( m_OutputImage,
+    m_OutputImage->GetLargestPossibleRegion() );
+  while( !iterObj.IsAtEnd() )
+    {
+    double tf = iterObj.Get() * ( 1 + alpha * ( iterBkg.Get() - meanRawBkg ) );
+    iterOut.Set( tf );
+    ++iterObj;
+    ++iterBkg;
+    ++iterOut;
+    }
+}
+
 template< class TPixel, unsigned int Dimension >
 void
 ContrastCostFunction< TPixel, Dimension >
@@ -200,6 +360,9 @@ ContrastCostFunction< TPixel, Dimension >
 ::Initialize( void )
 {
   m_CallsToGetValue = 0;
+  m_NumberOfBlurs = 0;
+  m_NumberOfCacheHits = 0;
+  this->UpdateMaskOffsets();
 }
 
 } // End namespace tube
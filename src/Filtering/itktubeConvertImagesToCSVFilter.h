@@ -26,11 +26,26 @@
 
 #include "tubeMessage.h"
 
+#include <string>
+#include <vector>
+
 namespace itk
 {
 namespace tube
 {
 /** \class ConvertImagesToCSV
+ *
+ * For each non-zero pixel of the mask, visited with the given stride,
+ * collects the values of the images and of the mask in one row.
+ *
+ * By default the rows are gathered in a matrix, which is the output.  If
+ * an output file name is set, the rows are instead written to that file
+ * as they are generated, ChunkSize rows at a time, and the output matrix
+ * is left empty.  The file is either CSV text, formatted independently of
+ * the global locale, or a NumPy .npy array of shape ( rows, columns )
+ * stored in column-major ( Fortran ) order, which numpy.load() reads
+ * without parsing.  The .npy file is written one column at a time, so
+ * each pass over the mask reads only one image.
  */
 
  template< class TInputImage, class TInputMask >
@@ -60,6 +75,8 @@ public:
   typedef vnl_matrix< InputPixelType >                VnlMatrixType;
   typedef SimpleDataObjectDecorator< VnlMatrixType >  OutputType;
 
+  typedef enum { CSV_FILE_FORMAT, NPY_FILE_FORMAT }   FileFormatEnum;
+
   /** Method for creation through the object factory. */
   itkNewMacro( Self );
 
@@ -86,6 +103,24 @@ public:
   itkSetMacro( NumberRows, unsigned int );
   itkGetMacro( NumberRows, unsigned int );
 
+  /** Stream the rows to this file instead of the output matrix.  Empty,
+   *  the default, disables streaming. */
+  itkSetStringMacro( OutputFileName );
+  itkGetStringMacro( OutputFileName );
+
+  /** Format of the output file.  Default is CSV_FILE_FORMAT. */
+  itkSetMacro( OutputFileFormat, FileFormatEnum );
+  itkGetMacro( OutputFileFormat, FileFormatEnum );
+
+  /** Number of rows buffered between writes to the output file */
+  itkSetClampMacro( ChunkSize, unsigned int, 1,
+    std::numeric_limits<unsigned int>::max() );
+  itkGetMacro( ChunkSize, unsigned int );
+
+  /** Header line of the CSV output file.  None is written if empty. */
+  void SetColumnHeaders( const std::vector< std::string > & headers );
+  const std::vector< std::string > & GetColumnHeaders( void ) const;
+
   /** Set the input image and reinitialize the list of images */
   void SetInput( const InputImageType * img );
   void SetInput( unsigned int id, const InputImageType * img );
@@ -110,6 +145,18 @@ private:
   void SetInput( const typename Superclass::DataObjectIdentifierType &,
     itk::DataObject * ) override {};
 
+  /** Gather the rows in the output matrix */
+  void GenerateMatrix( void );
+
+  /** Stream the rows to a CSV file */
+  void WriteCSVFile( void );
+
+  /** Stream the columns to a .npy file */
+  void WriteNPYFile( void );
+
+  /** Return the number of rows, without reading the images */
+  unsigned int CountRows( void ) const;
+
   typename InputMaskType::Pointer                       m_InputMask;
   VnlMatrixType                                         m_VnlOutput;
   std::vector< typename InputImageType::ConstPointer >  m_ImageList;
@@ -117,6 +164,11 @@ private:
   unsigned int                                          m_NumImages;
   unsigned int                                          m_NumberRows;
 
+  std::string                                           m_OutputFileName;
+  FileFormatEnum                                        m_OutputFileFormat;
+  unsigned int                                          m_ChunkSize;
+  std::vector< std::string >                            m_ColumnHeaders;
+
 }; // End class ConvertImagesToCSVFilter
 
 } // End namespace tube
@@ -19,6 +19,14 @@
 #ifndef __itktubeConvertImagesToCSVFilter_hxx
 #define __itktubeConvertImagesToCSVFilter_hxx
 
+#include <itkByteSwapper.h>
+#include <itkNumericTraits.h>
+
+#include <fstream>
+#include <limits>
+#include <locale>
+#include <sstream>
+
 
 namespace itk
 {
@@ -32,7 +40,12 @@ ConvertImagesToCSVFilter< TInputImage, TInputMask >
 ::ConvertImagesToCSVFilter( void )
 {
   m_InputMask = NULL;
+  m_Stride = 1;
+  m_NumImages = 0;
   m_NumberRows = 0;
+  m_OutputFileName = "";
+  m_OutputFileFormat = CSV_FILE_FORMAT;
+  m_ChunkSize = 65536;
   this->ProcessObject::SetNthOutput( 0, OutputType::New().GetPointer() );
 }
 
@@ -40,6 +53,32 @@ template< class TInputImage, class TInputMask >
 void
 ConvertImagesToCSVFilter< TInputImage, TInputMask >
 ::GenerateData( void )
+{
+  if( m_OutputFileName.empty() )
+    {
+    this->GenerateMatrix();
+    }
+  else
+    {
+    m_VnlOutput.set_size( 0, m_NumImages + 1 );
+    if( m_OutputFileFormat == NPY_FILE_FORMAT )
+      {
+      this->WriteNPYFile();
+      }
+    else
+      {
+      this->WriteCSVFile();
+      }
+    }
+
+  typename OutputType::Pointer outputPtr = this->GetOutput();
+  outputPtr->Set( m_VnlOutput );
+}
+
+template< class TInputImage, class TInputMask >
+void
+ConvertImagesToCSVFilter< TInputImage, TInputMask >
+::GenerateMatrix( void )
 {
   const unsigned int ARows =
     m_InputMask->GetLargestPossibleRegion().GetNumberOfPixels() / m_Stride;
@@ -78,8 +117,239 @@ ConvertImagesToCSVFilter< TInputImage, TInputMask >
     delete iterList[i];
     }
   iterList.clear();
-  typename OutputType::Pointer outputPtr = this->GetOutput();
-  outputPtr->Set( m_VnlOutput );
+}
+
+template< class TInputImage, class TInputMask >
+void
+ConvertImagesToCSVFilter< TInputImage, TInputMask >
+::WriteCSVFile( void )
+{
+  typedef typename NumericTraits< InputPixelType >::PrintType PrintType;
+
+  std::ofstream file( m_OutputFileName.c_str() );
+  if( !file.is_open() )
+    {
+    itkExceptionMacro( << "Cannot open " << m_OutputFileName );
+    }
+
+  // Rows are formatted in a buffer using the classic locale, whatever
+  // the global locale, and written ChunkSize rows at a time
+  std::ostringstream buffer;
+  buffer.imbue( std::locale::classic() );
+  buffer.precision( std::numeric_limits< InputPixelType >::max_digits10 );
+
+  for( unsigned int i = 0; i < m_ColumnHeaders.size(); ++i )
+    {
+    if( i > 0 )
+      {
+      buffer << ',';
+      }
+    buffer << m_ColumnHeaders[i];
+    }
+  if( !m_ColumnHeaders.empty() )
+    {
+    buffer << '\n';
+    }
+
+  std::vector< InputImageIteratorType > iterList;
+  for( unsigned int i = 0; i < m_NumImages; ++i )
+    {
+    iterList.push_back( InputImageIteratorType( m_ImageList[i],
+      m_ImageList[i]->GetLargestPossibleRegion() ) );
+    }
+  MaskIteratorType maskIter( m_InputMask,
+    m_InputMask->GetLargestPossibleRegion() );
+  m_NumberRows = 0;
+  unsigned int numberOfBufferedRows = 0;
+  while( !maskIter.IsAtEnd() )
+    {
+    if( maskIter.Get() != 0 )
+      {
+      for( unsigned int i = 0; i < m_NumImages; ++i )
+        {
+        buffer << static_cast< PrintType >( iterList[i].Get() ) << ',';
+        }
+      buffer << static_cast< PrintType >(
+        static_cast< InputPixelType >( maskIter.Get() ) ) << '\n';
+      ++m_NumberRows;
+      if( ++numberOfBufferedRows == m_ChunkSize )
+        {
+        file << buffer.str();
+        buffer.str( "" );
+        numberOfBufferedRows = 0;
+        }
+      }
+    for( unsigned int s = 0; s < m_Stride && !maskIter.IsAtEnd(); ++s )
+      {
+      for( unsigned int i = 0; i < m_NumImages; ++i )
+        {
+        ++iterList[i];
+        }
+      ++maskIter;
+      }
+    }
+  file << buffer.str();
+
+  if( !file.good() )
+    {
+    itkExceptionMacro( << "Error writing " << m_OutputFileName );
+    }
+}
+
+template< class TInputImage, class TInputMask >
+unsigned int
+ConvertImagesToCSVFilter< TInputImage, TInputMask >
+::CountRows( void ) const
+{
+  unsigned int numberOfRows = 0;
+  MaskIteratorType maskIter( m_InputMask,
+    m_InputMask->GetLargestPossibleRegion() );
+  while( !maskIter.IsAtEnd() )
+    {
+    if( maskIter.Get() != 0 )
+      {
+      ++numberOfRows;
+      }
+    for( unsigned int s = 0; s < m_Stride && !maskIter.IsAtEnd(); ++s )
+      {
+      ++maskIter;
+      }
+    }
+  return numberOfRows;
+}
+
+template< class TInputImage, class TInputMask >
+void
+ConvertImagesToCSVFilter< TInputImage, TInputMask >
+::WriteNPYFile( void )
+{
+  std::ofstream file( m_OutputFileName.c_str(),
+    std::ios::out | std::ios::binary );
+  if( !file.is_open() )
+    {
+    itkExceptionMacro( << "Cannot open " << m_OutputFileName );
+    }
+
+  const unsigned int numberOfRows = this->CountRows();
+  const unsigned int numberOfColumns = m_NumImages + 1;
+
+  // Format version 1.0: magic string, version, header length and a
+  // Python dict literal padded with spaces to a multiple of 64 bytes
+  std::string descr;
+  if( sizeof( InputPixelType ) == 1 )
+    {
+    descr = "|";
+    }
+  else if( ByteSwapper< InputPixelType >::SystemIsBigEndian() )
+    {
+    descr = ">";
+    }
+  else
+    {
+    descr = "<";
+    }
+  if( !std::numeric_limits< InputPixelType >::is_integer )
+    {
+    descr += "f";
+    }
+  else if( std::numeric_limits< InputPixelType >::is_signed )
+    {
+    descr += "i";
+    }
+  else
+    {
+    descr += "u";
+    }
+  descr += std::to_string( sizeof( InputPixelType ) );
+
+  std::string header = "{'descr': '" + descr
+    + "', 'fortran_order': True, 'shape': ("
+    + std::to_string( numberOfRows ) + ", "
+    + std::to_string( numberOfColumns ) + "), }";
+  const std::size_t preambleLength = 10;
+  while( ( preambleLength + header.size() + 1 ) % 64 != 0 )
+    {
+    header += ' ';
+    }
+  header += '\n';
+
+  file.write( "\x93NUMPY\x01\x00", 8 );
+  const char headerLength[2] = {
+    static_cast< char >( header.size() & 0xff ),
+    static_cast< char >( ( header.size() >> 8 ) & 0xff ) };
+  file.write( headerLength, 2 );
+  file.write( header.c_str(), header.size() );
+
+  // Column-major order: one pass over the mask per column, each reading
+  // a single image
+  std::vector< InputPixelType > buffer;
+  buffer.reserve( m_ChunkSize );
+  for( unsigned int c = 0; c < numberOfColumns; ++c )
+    {
+    const bool isMaskColumn = ( c == m_NumImages );
+    InputImageIteratorType imageIter;
+    if( !isMaskColumn )
+      {
+      imageIter = InputImageIteratorType( m_ImageList[c],
+        m_ImageList[c]->GetLargestPossibleRegion() );
+      }
+    MaskIteratorType maskIter( m_InputMask,
+      m_InputMask->GetLargestPossibleRegion() );
+    while( !maskIter.IsAtEnd() )
+      {
+      if( maskIter.Get() != 0 )
+        {
+        if( isMaskColumn )
+          {
+          buffer.push_back( static_cast< InputPixelType >( maskIter.Get() ) );
+          }
+        else
+          {
+          buffer.push_back( imageIter.Get() );
+          }
+        if( buffer.size() == m_ChunkSize )
+          {
+          file.write( reinterpret_cast< const char * >( buffer.data() ),
+            buffer.size() * sizeof( InputPixelType ) );
+          buffer.clear();
+          }
+        }
+      for( unsigned int s = 0; s < m_Stride && !maskIter.IsAtEnd(); ++s )
+        {
+        if( !isMaskColumn )
+          {
+          ++imageIter;
+          }
+        ++maskIter;
+        }
+      }
+    file.write( reinterpret_cast< const char * >( buffer.data() ),
+      buffer.size() * sizeof( InputPixelType ) );
+    buffer.clear();
+    }
+  m_NumberRows = numberOfRows;
+
+  if( !file.good() )
+    {
+    itkExceptionMacro( << "Error writing " << m_OutputFileName );
+    }
+}
+
+template< class TInputImage, class TInputMask >
+void
+ConvertImagesToCSVFilter< TInputImage, TInputMask >
+::SetColumnHeaders( const std::vector< std::string > & headers )
+{
+  m_ColumnHeaders = headers;
+  this->Modified();
+}
+
+template< class TInputImage, class TInputMask >
+const std::vector< std::string > &
+ConvertImagesToCSVFilter< TInputImage, TInputMask >
+::GetColumnHeaders( void ) const
+{
+  return m_ColumnHeaders;
 }
 
 template< class TInputImage, class TInputMask >
@@ -146,6 +416,11 @@ ConvertImagesToCSVFilter< TInputImage, TInputMask >
   os << indent << "Stride = " << m_Stride << std::endl;
   os << indent << "NumImages = " << m_NumImages << std::endl;
   os << indent << "NumberRows = " << m_NumberRows << std::endl;
+  os << indent << "OutputFileName = " << m_OutputFileName << std::endl;
+  os << indent << "OutputFileFormat = " << m_OutputFileFormat << std::endl;
+  os << indent << "ChunkSize = " << m_ChunkSize << std::endl;
+  os << indent << "ColumnHeaders size = " << m_ColumnHeaders.size()
+    << std::endl;
 }
 
 } // End namespace tube
@@ -157,6 +157,8 @@ EnhanceContrastUsingPriorImageFilter< TPixel, VDimension >
   result = costFunc->GetValue( params );
   std::cout << "Winning params = " << params
             << " Result = " << result << std::endl;
+
+  costFunc->ComputeOutputImage( params );
 }
 
 } // End namespace tube
@@ -24,8 +24,11 @@ limitations under the License.
 #ifndef __itktubeShrinkWithBlendingImageFilter_h
 #define __itktubeShrinkWithBlendingImageFilter_h
 
+#include "itkProgressReporter.h"
 #include "itkShrinkImageFilter.h"
 
+#include <vector>
+
 namespace itk {
 
 namespace tube {
@@ -52,7 +55,12 @@ namespace tube {
  * ProcessObject::GenerateOutputInformation().
  *
  * This filter is implemented as a multithreaded filter.  It provides a
- * ThreadedGenerateData() method for its implementation.
+ * ThreadedGenerateData() method for its implementation.  Mean and
+ * Gaussian blending are computed one dimension at a time, with 1-D weight
+ * tables, so their cost per output pixel grows with the sum rather than
+ * the product of the window sizes.  Each thread processes its output one
+ * slab, along the last dimension, at a time, so it only holds the input
+ * under that slab.
  *
  * \ingroup GeometricTransform Streamed
  * \ingroup ITKImageGrid
@@ -145,6 +153,11 @@ protected:
   void ThreadedGenerateData( const OutputImageRegionType &
     outputRegionForThread, ThreadIdType threadId ) override;
 
+  /** Mean or Gaussian blending of the pixels of outputRegionForThread,
+   *  one dimension at a time */
+  void GenerateBlendedData( const OutputImageRegionType &
+    outputRegionForThread, ProgressReporter & progress );
+
   void UpdateInternalShrinkFactors();
 
   void VerifyInputInformation() ITKv5_CONST override;
@@ -156,6 +169,18 @@ private:
   ShrinkWithBlendingImageFilter( const Self & ); //purposely not implemented
   void operator=( const Self & );            //purposely not implemented
 
+  /** Set sums to the weighted sums of buffer, of size bufferSize, along
+   *  dimension over the window of each output index, and update
+   *  bufferSize.  Windows start at windowStart, relative to the buffer,
+   *  and their weights are stored windowStride apart in weights, or are
+   *  all one if weights is empty. */
+  static void SumAlongDimension( const std::vector< double > & buffer,
+    InputSizeType & bufferSize, unsigned int dimension,
+    const std::vector< IndexValueType > & windowStart,
+    const std::vector< SizeValueType > & windowLength,
+    SizeValueType windowStride, const std::vector< double > & weights,
+    std::vector< double > & sums );
+
   typename PointImageType::Pointer       m_OutputMipPointImage;
 
   typename PointImageType::ConstPointer  m_InputMipPointImage;
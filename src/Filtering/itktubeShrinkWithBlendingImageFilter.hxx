@@ -25,8 +25,12 @@ limitations under the License.
 
 
 #include "itkConstNeighborhoodIterator.h"
+#include "itkImageRegionConstIterator.h"
 #include "itkImageRegionConstIteratorWithIndex.h"
 
+#include <algorithm>
+#include <cmath>
+
 namespace itk {
 
 namespace tube {
@@ -167,6 +171,12 @@ ShrinkWithBlendingImageFilter< TInputImage, TOutputImage >
   ProgressReporter progress( this, threadId,
     outputRegionForThread.GetNumberOfPixels() );
 
+  if( m_InputMipPointImage.IsNull() && !m_BlendWithMax )
+    {
+    this->GenerateBlendedData( outputRegionForThread, progress );
+    return;
+    }
+
   // Define/declare an iterator that will walk the output region for this
   // thread.
   typedef ImageRegionIteratorWithIndex< TOutputImage > OutputIteratorType;
@@ -238,129 +248,325 @@ ShrinkWithBlendingImageFilter< TInputImage, TOutputImage >
     inputRegion.Crop( this->GetInput()->GetLargestPossibleRegion() );
     InputIteratorType it( this->GetInput(), inputRegion );
 
-    // Walk the neighborhood
+    // Walk the neighborhood, keeping the location of the maximum
     typename TInputImage::PixelType value;
-    if( m_BlendWithMax )
+    typename TInputImage::PixelType maxValue = it.Get();
+    typename TInputImage::IndexType maxValueIndex = it.GetIndex();
+    ++it;
+    while( !it.IsAtEnd() )
       {
-      typename TInputImage::PixelType maxValue = it.Get();
-      typename TInputImage::IndexType maxValueIndex = it.GetIndex();
+      value = it.Get();
+      if( value > maxValue )
+        {
+        maxValue = value;
+        maxValueIndex = it.GetIndex();
+        }
       ++it;
-      while( !it.IsAtEnd() )
+      }
+
+    // Copy the input pixel to the output
+    outIt.Set( maxValue );
+    ++outIt;
+
+    typename TInputImage::PointType point;
+    this->GetInput()->TransformIndexToPhysicalPoint( maxValueIndex,
+      point );
+
+    typename PointImageType::PixelType pointVector;
+    for( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+      pointVector[i] = point[i];
+      }
+    outMipPointIt.Set( pointVector );
+    ++outMipPointIt;
+
+    progress.CompletedPixel();
+    }
+
+  if( inputMipPointItPtr != ITK_NULLPTR )
+    {
+    delete inputMipPointItPtr;
+    }
+}
+
+template< class TInputImage, class TOutputImage >
+void
+ShrinkWithBlendingImageFilter< TInputImage, TOutputImage >
+::GenerateBlendedData( const OutputImageRegionType & outputRegionForThread,
+  ProgressReporter & progress )
+{
+  InputImageConstPointer inputPtr = this->GetInput();
+  OutputImagePointer     outputPtr = this->GetOutput();
+
+  const typename TInputImage::RegionType & inputLargestRegion =
+    inputPtr->GetLargestPossibleRegion();
+  const bool useGaussian = m_BlendWithGaussianWeighting && !m_BlendWithMean;
+
+  // Input and output share their direction, so the input window of an
+  //   output pixel along a dimension only depends on its index along that
+  //   dimension: build, per dimension, the window of every output index
+  //   and, for Gaussian blending, its 1-D weights and their sum
+  std::vector< IndexValueType > windowStart[ ImageDimension ];
+  std::vector< SizeValueType >  windowLength[ ImageDimension ];
+  std::vector< double >         windowWeights[ ImageDimension ];
+  std::vector< double >         windowWeightSum[ ImageDimension ];
+  SizeValueType                 windowStride[ ImageDimension ];
+  typename TInputImage::RegionType bufferRegion;
+  for( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+    const IndexValueType factor = m_InternalShrinkFactors[ i ];
+    const SizeValueType outputLength = outputRegionForThread.GetSize()[ i ];
+    const IndexValueType inputMin = inputLargestRegion.GetIndex()[ i ];
+    const IndexValueType inputMax = inputMin
+      + inputLargestRegion.GetSize()[ i ];
+    const double normalization = 1.0
+      / ( factor * std::sqrt( 2 * vnl_math::pi ) );
+    windowStride[ i ] = factor + m_Overlap[ i ] * 2;
+    windowStart[ i ].resize( outputLength );
+    windowLength[ i ].resize( outputLength );
+    windowWeightSum[ i ].assign( outputLength, 0 );
+    if( useGaussian )
+      {
+      windowWeights[ i ].assign( outputLength * windowStride[ i ], 0 );
+      }
+
+    IndexValueType bufferMin = inputMax;
+    IndexValueType bufferMax = inputMin;
+    OutputIndexType outputIndex = outputRegionForThread.GetIndex();
+    for( SizeValueType k = 0; k < outputLength; ++k )
+      {
+      outputIndex[ i ] = outputRegionForThread.GetIndex()[ i ] + k;
+      typename TOutputImage::PointType tempPoint;
+      InputIndexType inputIndex;
+      outputPtr->TransformIndexToPhysicalPoint( outputIndex, tempPoint );
+      inputPtr->TransformPhysicalPointToIndex( tempPoint, inputIndex );
+
+      const IndexValueType center = inputIndex[ i ];
+      const IndexValueType windowMin = center - factor / 2 - m_Overlap[ i ];
+      const IndexValueType first = std::max( inputMin, windowMin );
+      const IndexValueType last = std::min( inputMax, static_cast<
+        IndexValueType >( windowMin + windowStride[ i ] ) );
+      windowStart[ i ][ k ] = first;
+      windowLength[ i ][ k ] = ( last > first ) ? last - first : 0;
+      if( windowLength[ i ][ k ] > 0 )
         {
-        value = it.Get();
-        if( value > maxValue )
+        bufferMin = std::min( bufferMin, first );
+        bufferMax = std::max( bufferMax, last );
+        }
+      if( useGaussian )
+        {
+        // The weights of the original per-pixel expression, which
+        //   divided the signed offset by the unsigned factor: offsets
+        //   before the center wrap to huge distances and get no weight,
+        //   and the others are divided as integers
+        for( SizeValueType t = 0; t < windowLength[ i ][ k ]; ++t )
           {
-          maxValue = value;
-          maxValueIndex = it.GetIndex();
+          const IndexValueType offset = first - center
+            + static_cast< IndexValueType >( t );
+          double weight = 0;
+          if( offset >= 0 )
+            {
+            const double dist = offset / factor;
+            weight = normalization * std::exp( -0.5 * dist * dist );
+            }
+          windowWeights[ i ][ k * windowStride[ i ] + t ] = weight;
+          windowWeightSum[ i ][ k ] += weight;
           }
-        ++it;
         }
+      }
+    if( bufferMax <= bufferMin )
+      {
+      bufferMin = inputMin;
+      bufferMax = inputMin;
+      }
+    bufferRegion.SetIndex( i, bufferMin );
+    bufferRegion.SetSize( i, bufferMax - bufferMin );
+    for( SizeValueType k = 0; k < outputLength; ++k )
+      {
+      windowStart[ i ][ k ] -= bufferMin;
+      }
+    }
 
-      // Copy the input pixel to the output
-      outIt.Set( maxValue );
-      ++outIt;
-
-      typename TInputImage::PointType point;
-      this->GetInput()->TransformIndexToPhysicalPoint( maxValueIndex,
-        point );
+  // The output is computed one slab, one index along the last dimension,
+  //   at a time, holding only the input under the windows of that slab.
+  //   The buffers are reused from slab to slab.
+  const unsigned int last = ImageDimension - 1;
+  const std::vector< double > noWeights;
+  const std::vector< IndexValueType > slabWindowStart( 1, 0 );
+  std::vector< SizeValueType > slabWindowLength( 1 );
+  std::vector< double > slabWeights;
+  std::vector< double > input;
+  std::vector< double > numerator;
+  std::vector< double > buffer;
+  std::vector< double > sums;
+  OutputImageRegionType slabRegion = outputRegionForThread;
+  slabRegion.SetSize( last, 1 );
+  typename TInputImage::RegionType inputSlabRegion = bufferRegion;
+  const unsigned int numberOfPasses = useGaussian ? ImageDimension : 1;
+  for( SizeValueType s = 0; s < outputRegionForThread.GetSize()[ last ];
+    ++s )
+    {
+    slabRegion.SetIndex( last,
+      outputRegionForThread.GetIndex()[ last ] + s );
+    inputSlabRegion.SetIndex( last,
+      bufferRegion.GetIndex()[ last ] + windowStart[ last ][ s ] );
+    inputSlabRegion.SetSize( last, windowLength[ last ][ s ] );
+    slabWindowLength[ 0 ] = windowLength[ last ][ s ];
+    if( useGaussian )
+      {
+      slabWeights.assign( windowWeights[ last ].begin()
+        + s * windowStride[ last ], windowWeights[ last ].begin()
+        + s * windowStride[ last ] + windowLength[ last ][ s ] );
+      }
 
-      typename PointImageType::PixelType pointVector;
-      for( unsigned int i = 0; i < ImageDimension; ++i )
+    // Input values, or their squares, under the windows of the slab
+    input.resize( inputSlabRegion.GetNumberOfPixels() );
+    if( !input.empty() )
+      {
+      ImageRegionConstIterator< TInputImage > it( inputPtr,
+        inputSlabRegion );
+      for( SizeValueType j = 0; !it.IsAtEnd(); ++it, ++j )
         {
-        pointVector[i] = point[i];
+        const double value = it.Get();
+        input[ j ] = m_UseLog ? value * value : value;
         }
-      outMipPointIt.Set( pointVector );
-      ++outMipPointIt;
       }
-    else if( m_BlendWithMean )
+
+    // Mean blending sums the window along every dimension.  The Gaussian
+    //   weight of a pixel is the sum of its 1-D weights along each
+    //   dimension, so Gaussian blending adds one pass per dimension in
+    //   which that dimension is weighted and the others are summed.
+    numerator.assign( slabRegion.GetNumberOfPixels(), 0 );
+    for( unsigned int pass = 0; pass < numberOfPasses && !input.empty();
+      ++pass )
       {
-      double averageValue = 0;
-      unsigned long int count = 0;
-      if( m_UseLog )
+      InputSizeType bufferSize = inputSlabRegion.GetSize();
+      for( unsigned int i = 0; i < ImageDimension; ++i )
         {
-        while( !it.IsAtEnd() )
+        const bool weighted = useGaussian && i == pass;
+        if( i == last )
           {
-          value = it.Get();
-          averageValue += value * value;
-          ++count;
-          ++it;
+          SumAlongDimension( ( i == 0 ) ? input : buffer, bufferSize, i,
+            slabWindowStart, slabWindowLength, windowStride[ i ],
+            weighted ? slabWeights : noWeights, sums );
           }
-        if( count > 0 )
+        else
           {
-          averageValue = std::sqrt( averageValue / count );
+          SumAlongDimension( ( i == 0 ) ? input : buffer, bufferSize, i,
+            windowStart[ i ], windowLength[ i ], windowStride[ i ],
+            weighted ? windowWeights[ i ] : noWeights, sums );
           }
+        buffer.swap( sums );
         }
-      else
+      for( SizeValueType j = 0; j < numerator.size(); ++j )
         {
-        while( !it.IsAtEnd() )
-          {
-          value = it.Get();
-          averageValue += value;
-          ++count;
-          ++it;
-          }
-        if( count > 0 )
-          {
-          averageValue = averageValue / count;
-          }
+        numerator[ j ] += buffer[ j ];
         }
-      outIt.Set( averageValue );
-      ++outIt;
       }
-    else if( m_BlendWithGaussianWeighting )
+
+    ImageRegionIteratorWithIndex< TOutputImage > outIt( outputPtr,
+      slabRegion );
+    for( SizeValueType j = 0; !outIt.IsAtEnd(); ++outIt, ++j )
       {
-      typename TInputImage::IndexType valueIndex;
-      double weight = 0;
-      double averageValue = 0;
-      double weightSum = 0;
-      while( !it.IsAtEnd() )
+      const OutputIndexType & outputIndex = outIt.GetIndex();
+      double denominator = 0;
+      if( useGaussian )
         {
-        value = it.Get();
-        valueIndex = it.GetIndex();
-        weight = 0;
-        for( unsigned int i = 0; i < ImageDimension; ++i )
+        for( unsigned int pass = 0; pass < ImageDimension; ++pass )
           {
-          double dist = ( valueIndex[i] - inputIndex[i] ) / factorSize[i];
-          weight += ( 1.0 / ( factorSize[i] * std::sqrt( 2 * vnl_math::pi ) ) )
-            * std::exp( -0.5 * dist * dist );
+          double weightSum = 1;
+          for( unsigned int i = 0; i < ImageDimension; ++i )
+            {
+            const SizeValueType k = outputIndex[ i ]
+              - outputRegionForThread.GetIndex()[ i ];
+            weightSum *= ( i == pass ) ? windowWeightSum[ i ][ k ]
+              : windowLength[ i ][ k ];
+            }
+          denominator += weightSum;
           }
-        if( m_UseLog )
+        }
+      else
+        {
+        denominator = 1;
+        for( unsigned int i = 0; i < ImageDimension; ++i )
           {
-          averageValue += weight * value * value;
+          denominator *= windowLength[ i ][ outputIndex[ i ]
+            - outputRegionForThread.GetIndex()[ i ] ];
           }
-        else
+        }
+
+      double value = 0;
+      if( denominator > 0 )
+        {
+        value = numerator[ j ] / denominator;
+        if( m_UseLog )
           {
-          averageValue += weight * value;
+          value = std::sqrt( value );
           }
-        weightSum += weight;
-        ++it;
         }
+      outIt.Set( value );
+      progress.CompletedPixel();
+      }
+    }
+}
+
+template< class TInputImage, class TOutputImage >
+void
+ShrinkWithBlendingImageFilter< TInputImage, TOutputImage >
+::SumAlongDimension( const std::vector< double > & buffer,
+  InputSizeType & bufferSize, unsigned int dimension,
+  const std::vector< IndexValueType > & windowStart,
+  const std::vector< SizeValueType > & windowLength,
+  SizeValueType windowStride, const std::vector< double > & weights,
+  std::vector< double > & sums )
+{
+  // Pixels along dimension are stride apart, and each line along it is
+  //   repeated for every index of the lower dimensions, which are summed
+  //   together as contiguous rows
+  SizeValueType stride = 1;
+  for( unsigned int i = 0; i < dimension; ++i )
+    {
+    stride *= bufferSize[ i ];
+    }
+  SizeValueType numberOfLines = 1;
+  for( unsigned int i = dimension + 1; i < ImageDimension; ++i )
+    {
+    numberOfLines *= bufferSize[ i ];
+    }
+  const SizeValueType inputLength = bufferSize[ dimension ];
+  const SizeValueType outputLength = windowStart.size();
 
-      if( weightSum > 0 )
+  sums.assign( numberOfLines * outputLength * stride, 0 );
+  for( SizeValueType line = 0; line < numberOfLines; ++line )
+    {
+    const double * lineIn = buffer.data() + line * inputLength * stride;
+    double * lineOut = sums.data() + line * outputLength * stride;
+    for( SizeValueType k = 0; k < outputLength; ++k )
+      {
+      double * rowOut = lineOut + k * stride;
+      for( SizeValueType t = 0; t < windowLength[ k ]; ++t )
         {
-        if( m_UseLog )
+        const double * rowIn = lineIn + ( windowStart[ k ] + t ) * stride;
+        if( weights.empty() )
           {
-          outIt.Set( std::sqrt( averageValue / weightSum ) );
+          for( SizeValueType j = 0; j < stride; ++j )
+            {
+            rowOut[ j ] += rowIn[ j ];
+            }
           }
         else
           {
-          outIt.Set( averageValue / weightSum );
+          const double weight = weights[ k * windowStride + t ];
+          for( SizeValueType j = 0; j < stride; ++j )
+            {
+            rowOut[ j ] += weight * rowIn[ j ];
+            }
           }
         }
-      else
-        {
-        outIt.Set( 0 );
-        }
-      ++outIt;
       }
-
-    progress.CompletedPixel();
     }
 
-  if( inputMipPointItPtr != ITK_NULLPTR )
-    {
-    delete inputMipPointItPtr;
-    }
+  bufferSize[ dimension ] = outputLength;
 }
 
 template< class TInputImage, class TOutputImage >
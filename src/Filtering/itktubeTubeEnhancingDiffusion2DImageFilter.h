@@ -24,7 +24,9 @@ limitations under the License.
 #ifndef __itktubeTubeEnhancingDiffusion2DImageFilter_h
 #define __itktubeTubeEnhancingDiffusion2DImageFilter_h
 
+#include <itkHessianRecursiveGaussianImageFilter.h>
 #include <itkImageToImageFilter.h>
+#include <itkSymmetricSecondRankTensor.h>
 
 #include <vector>
 
@@ -41,36 +43,30 @@ namespace tube
  * the input image image is converted to internal precision ( float ) for
  * calculation, and converted back when returning the results.
  *
- * Uses simple forward Euler scheme ( explicit ) with 3x3 stencil,
+ * Uses simple forward Euler scheme ( explicit ) with 3x3 ( 3x3x3 ) stencil,
  * see, e.g., PhD of Joachim Weickert for theory and implementation regarding
  * the construction of this discretization scheme. See 'Tube Enhancing
  * Diffusion', Manniesing, media 2006, for information regarding the
  * construction of the diffusion tensor.
  *
- * - Stores all elements of the Hessian of the complete image during
- *   diffusion. An alternative implementation is to only store the
- *   scale for which the vesselness has maximum response, and to
- *   recalculate the Hessian ( locally ) during diffusion. Also stores
- *   the current image, i.e., at iteration i + temp image, therefore the
- *   complete memory consumption approximately peaks at 8 times the input
- *   image ( input image in float )
- * - The Hessian is stored as six individual images, an alternative
- *   implementation is to use the itk symmetric second rank tensor
- *   as pixel type ( and e.g. using the class SymmetricEigenAnalysisImage
- *   Filter ). However, we are lazy, and using this since we rely
- *   on vnl data types and its eigensystem calculations
- * - note: most of computation time is spent at calculation of vesselness
- *   response
+ * - Despite the "2D" in its name, supports 2D and 3D images; the name
+ *   is kept for compatibility.  In 3D, the vesselness is that of
+ *   Frangi et al. and the diffusion tensor has eigenvalue
+ *   1 + ( Omega - 1 ) V^( 1 / Sensitivity ) along the vessel and
+ *   1 + ( Epsilon - 1 ) V^( 1 / Sensitivity ) across it.  In 2D, both
+ *   eigenvalues use Epsilon, as in the original implementation.
+ * - Stores the Hessian at the scale of maximum vessel response as a
+ *   symmetric tensor image, which is then overwritten by the diffusion
+ *   tensor.  The Hessian filter, the vesselness image, the tensor image
+ *   and a second intensity image are kept as a workspace and reused
+ *   across iterations and scales; successive iterations swap between
+ *   the two intensity images rather than copying.
+ * - The vesselness at each scale and the diffusion update are computed
+ *   in region-threaded passes over the image; the diffusion tensor is
+ *   computed in the same pass as the vesselness at the last scale.
  *
- * - PixelT         short, 2D
- *   Precision      float, 2D
- *
- * - todo
- *   - using parallelism/threading e.g., over scales
- *   - completely ITK-fying, e.g., eigenvalues calculation
- *   - possibly embedding within itk-diffusion framework
- *   - itk expert to have a look at use of iterators
- *     ( there must be a potential gain there )
+ * - PixelT         short, 2D or 3D
+ *   Precision      float
  *
  * email: r.manniesing@erasmusmc.nl
  */
@@ -94,7 +90,17 @@ public:
   itkNewMacro( Self );
   itkTypeMacro( TubeEnhancingDiffusion2DImageFilter, ImageToImageFilter );
 
-  /** Set/Get time step */
+  itkStaticConstMacro( ImageDimension, unsigned int, VDimension );
+
+  /** Symmetric tensor type used for the Hessian and diffusion tensor */
+  typedef SymmetricSecondRankTensor< Precision, VDimension > TensorType;
+  typedef Image< TensorType, VDimension >                   TensorImageType;
+
+  typedef HessianRecursiveGaussianImageFilter< PrecisionImageType >
+                                                          HessianFilterType;
+
+  /** Set/Get time step.  Zero, or a step larger than the largest stable
+   *  one, is replaced by the largest stable step when the filter runs. */
   itkSetMacro( TimeStep, Precision );
   itkGetMacro( TimeStep, Precision );
 
@@ -106,6 +112,10 @@ public:
   itkSetMacro( RecalculateTubeness, unsigned int );
   itkGetMacro( RecalculateTubeness, unsigned int );
 
+  /** Set/Get sensitive of the filter to plate-like structures ( 3D ) */
+  itkSetMacro( Alpha, Precision );
+  itkGetMacro( Alpha, Precision );
+
   /** Set/Get sensitive of the filter to blobness */
   itkSetMacro( Beta, Precision );
   itkGetMacro( Beta, Precision );
@@ -146,6 +156,7 @@ public:
     m_TimeStep                  = 0.05;
     m_Iterations                = 50;
     m_RecalculateTubeness       = 11;
+    m_Alpha                     = 0.5;
     m_Beta                      = 0.5;
     m_Gamma                     = 5.0;
     m_Epsilon                   = 0.01;
@@ -176,6 +187,7 @@ private:
   Precision                 m_TimeStep;
   unsigned int              m_Iterations;
   unsigned int              m_RecalculateTubeness;
+  Precision                 m_Alpha;
   Precision                 m_Beta;
   Precision                 m_Gamma;
   Precision                 m_Epsilon;
@@ -187,25 +199,43 @@ private:
 
   unsigned int              m_CurrentIteration;
 
-  // current Hessian for which we have maximum vessel response
-  typename PrecisionImageType::Pointer m_Dxx;
-  typename PrecisionImageType::Pointer m_Dxy;
-  typename PrecisionImageType::Pointer m_Dyy;
+  // workspace: current and next intensity images, the maximum vessel
+  // response, and the Hessian for which we have maximum vessel response
+  // ( replaced by the diffusion tensor once all scales are processed )
+  typename PrecisionImageType::Pointer m_Current;
+  typename PrecisionImageType::Pointer m_Next;
+  typename PrecisionImageType::Pointer m_Vesselness;
+  typename TensorImageType::Pointer    m_DiffusionTensor;
+  typename HessianFilterType::Pointer  m_HessianFilter;
+
+  // allocates the workspace to match m_Current, reusing existing buffers
+  void AllocateWorkspace( void );
 
-  void VED2DSingleIteration( typename PrecisionImageType::Pointer );
+  // one explicit diffusion step from m_Current into m_Next, after which
+  // the two are swapped
+  void VEDSingleIteration( void );
 
   // Calculates maximum vessel response of the range
-  // of scales and stores the Hessian of each voxel
-  // into the member images m_Dij.
-  void MaxTubeResponse( const typename PrecisionImageType::Pointer );
+  // of scales and, from the Hessian of each voxel at
+  // that response, the diffusion tensor m_DiffusionTensor.
+  void MaxTubeResponse( void );
 
-  // calculates diffusion tensor
-  // based on current values of Hessian ( for which we have
-  // maximum vessel response ).
-  void DiffusionTensor( void );
+  // vesselness of a Hessian given as the upper triangle of the matrix
+  Precision ComputeVesselness( const double * h ) const;
+
+  // diffusion tensor ( upper triangle ) for a voxel whose Hessian at
+  // maximum vessel response is h and whose vesselness is v; isotropic
+  // if isTube is false ( no positive response at any scale )
+  void ComputeDiffusionTensor( const double * h, Precision v, bool isTube,
+    Precision * d ) const;
 
   // Sorted increasing magnitude: l1, l2
-  inline Precision TubenessFunction2D ( const Precision, const Precision );
+  inline Precision TubenessFunction2D( const Precision,
+    const Precision ) const;
+
+  // Sorted increasing magnitude: l1, l2, l3
+  inline Precision TubenessFunction3D( const Precision, const Precision,
+    const Precision ) const;
 
 }; // End class TubeEnhancingDiffusion2DImageFilter
 
@@ -25,21 +25,18 @@ limitations under the License.
 #define __itktubeTubeEnhancingDiffusion2DImageFilter_hxx
 
 
+#include "tubeMatrixMath.h"
+
 #include <itkCastImageFilter.h>
-#include <itkConstShapedNeighborhoodIterator.h>
-#include <itkHessianRecursiveGaussianImageFilter.h>
 #include <itkImageRegionConstIterator.h>
+#include <itkImageRegionConstIteratorWithIndex.h>
 #include <itkImageRegionIterator.h>
 #include <itkMinimumMaximumImageFilter.h>
-#include <itkNeighborhoodAlgorithm.h>
+#include <itkMultiThreaderBase.h>
 #include <itkNumericTraits.h>
 #include <itkProgressAccumulator.h>
-#include <itkZeroFluxNeumannBoundaryCondition.h>
-
-#include <vnl/algo/vnl_symmetric_eigensystem.h>
-#include <vnl/vnl_matrix.h>
-#include <vnl/vnl_vector.h>
 
+#include <algorithm>
 #include <iostream>
 
 namespace itk
@@ -54,6 +51,7 @@ TubeEnhancingDiffusion2DImageFilter<TPixel, TDimension>
   : m_TimeStep( 0.2 ),
     m_Iterations( 200 ),
     m_RecalculateTubeness( 100 ),
+    m_Alpha( 0.5 ),
     m_Beta( 0.5 ),
     m_Gamma( 5.0 ),
     m_Epsilon( 0.001 ),
@@ -95,6 +93,7 @@ TubeEnhancingDiffusion2DImageFilter<TPixel, TDimension>
     << std::endl;
   os << indent << "DarkObjectLightBackground : "
     << m_DarkObjectLightBackground << std::endl;
+  os << indent << "Alpha                     : " << m_Alpha << std::endl;
   os << indent << "Beta                      : " << m_Beta << std::endl;
   os << indent << "Gamma                     : " << m_Gamma << std::endl;
   os << indent << "Verbose                   : " << m_Verbose << std::endl;
@@ -104,7 +103,44 @@ TubeEnhancingDiffusion2DImageFilter<TPixel, TDimension>
 template< class TPixel, unsigned int TDimension >
 void
 TubeEnhancingDiffusion2DImageFilter<TPixel, TDimension>
-::VED2DSingleIteration( typename PrecisionImageType::Pointer ci )
+::AllocateWorkspace( void )
+{
+  if( m_Next.IsNull() )
+    {
+    m_Next = PrecisionImageType::New();
+    }
+  m_Next->CopyInformation( m_Current );
+  m_Next->SetRegions( m_Current->GetLargestPossibleRegion() );
+  m_Next->Allocate();
+
+  if( m_Vesselness.IsNull() )
+    {
+    m_Vesselness = PrecisionImageType::New();
+    }
+  m_Vesselness->CopyInformation( m_Current );
+  m_Vesselness->SetRegions( m_Current->GetLargestPossibleRegion() );
+  m_Vesselness->Allocate();
+
+  if( m_DiffusionTensor.IsNull() )
+    {
+    m_DiffusionTensor = TensorImageType::New();
+    }
+  m_DiffusionTensor->CopyInformation( m_Current );
+  m_DiffusionTensor->SetRegions( m_Current->GetLargestPossibleRegion() );
+  m_DiffusionTensor->Allocate();
+
+  if( m_HessianFilter.IsNull() )
+    {
+    m_HessianFilter = HessianFilterType::New();
+    m_HessianFilter->SetNormalizeAcrossScale( true );
+    }
+}
+
+
+template< class TPixel, unsigned int TDimension >
+void
+TubeEnhancingDiffusion2DImageFilter<TPixel, TDimension>
+::VEDSingleIteration( void )
 {
   bool rec( false );
   if( ( m_CurrentIteration == 1 ) ||
@@ -117,8 +153,7 @@ TubeEnhancingDiffusion2DImageFilter<TPixel, TDimension>
       std::cout << "v ";
       std::cout.flush();
       }
-    MaxTubeResponse( ci );
-    DiffusionTensor();
+    MaxTubeResponse();
     }
   if( m_Verbose )
     {
@@ -129,279 +164,345 @@ TubeEnhancingDiffusion2DImageFilter<TPixel, TDimension>
       }
     }
 
-  // calculate d = nonlineardiffusion( ci )
-  // using 3x3x3 stencil, afterwards copy
-  // result from d back to ci
-  typename PrecisionImageType::Pointer d = PrecisionImageType::New();
-  d->SetOrigin( ci->GetOrigin() );
-  d->SetSpacing( ci->GetSpacing() );
-  d->SetDirection( ci->GetDirection() );
-  d->SetRegions( ci->GetLargestPossibleRegion() );
-  d->Allocate();
-  d->FillBuffer( NumericTraits<Precision>::Zero );
-
-  // shapedneighborhood iter, zeroflux boundary condition
-  // division into faces and inner region
-  typedef ZeroFluxNeumannBoundaryCondition<PrecisionImageType>     BT;
-  typedef ConstShapedNeighborhoodIterator<PrecisionImageType, BT>  NT;
-  typedef typename NeighborhoodAlgorithm::ImageBoundaryFacesCalculator<
-    PrecisionImageType>                                            FT;
-
-  BT                      b;
-  typename NT::RadiusType r;
-  r.Fill( 1 );
-
-  // offsets
-  const typename NT::OffsetType oxp = {{1, 0}};
-  const typename NT::OffsetType oxm = {{-1, 0}};
-  const typename NT::OffsetType oyp = {{0, 1}};
-  const typename NT::OffsetType oym = {{0, -1}};
-
-  const typename NT::OffsetType oxpyp = {{1, 1}};
-  const typename NT::OffsetType oxmym = {{-1, -1}};
-  const typename NT::OffsetType oxpym = {{1, -1}};
-  const typename NT::OffsetType oxmyp = {{-1, 1}};
+  typedef typename PrecisionImageType::RegionType RegionType;
+  typedef typename PrecisionImageType::IndexType  IndexType;
+  typedef typename PrecisionImageType::OffsetType OffsetType;
+
+  // stencil: for each axis i the offsets +/- e_i, and for each pair of
+  // axes i < j the offsets +/- ( e_i + e_j ) and +/- ( e_i - e_j )
+  const unsigned int numberOfPairs = TDimension * ( TDimension - 1 ) / 2;
+  const unsigned int numberOfOffsets = 2 * TDimension + 4 * numberOfPairs;
+  std::vector< OffsetType >      offsets( numberOfOffsets );
+  std::vector< OffsetValueType > linearOffsets( numberOfOffsets );
+  std::vector< unsigned int >    components( TDimension + numberOfPairs );
+  std::vector< Precision >       weights( TDimension + numberOfPairs );
 
   // fixed weights ( timers )
   const typename PrecisionImageType::SpacingType ispacing =
-    ci->GetSpacing();
-  const Precision rxx = m_TimeStep / ( 2.0 * ispacing[0] * ispacing[0] );
-  const Precision ryy = m_TimeStep / ( 2.0 * ispacing[1] * ispacing[1] );
-  const Precision rxy = m_TimeStep / ( 4.0 * ispacing[0] * ispacing[1] );
-
-  // faces
-  FT                        fc;
-  typename FT::FaceListType fci = fc( ci, d->GetLargestPossibleRegion(),
-    r );
-  typename FT::FaceListType fxx = fc( m_Dxx, d->GetLargestPossibleRegion(),
-    r );
-  typename FT::FaceListType fxy = fc( m_Dxy, d->GetLargestPossibleRegion(),
-    r );
-  typename FT::FaceListType fyy = fc( m_Dyy, d->GetLargestPossibleRegion(),
-    r );
-
-  typename FT::FaceListType::iterator fitci, fitxx, fitxy, fityy;
-
-  for( fitci = fci.begin(), fitxx = fxx.begin(), fitxy = fxy.begin(),
-    fityy = fyy.begin(); fitci != fci.end();
-    ++fitci, ++fitxx, ++fitxy, ++fityy )
+    m_Current->GetSpacing();
+  const OffsetValueType * offsetTable = m_Current->GetOffsetTable();
+
+  unsigned int o = 0;
+  unsigned int g = 0;
+  for( unsigned int i = 0; i < TDimension; ++i, ++g )
     {
-    // output iter
-    ImageRegionIterator<PrecisionImageType> dit( d, *fitci );
-
-    // input iters
-    NT itci( r, ci, *fitci );
-    NT itxx( r, m_Dxx, *fitxx );
-    NT itxy( r, m_Dxy, *fitxy );
-    NT ityy( r, m_Dyy, *fityy );
-
-    itci.OverrideBoundaryCondition( &b );
-    itxx.OverrideBoundaryCondition( &b );
-    itxy.OverrideBoundaryCondition( &b );
-    ityy.OverrideBoundaryCondition( &b );
-
-    // setting active offsets ( yeah there must
-    // be some smarter way of doing this )
-    itci.ClearActiveList();
-    itxx.ClearActiveList();
-    itxy.ClearActiveList();
-    ityy.ClearActiveList();
-
-    itci.ActivateOffset( oxp );
-    itxx.ActivateOffset( oxp );
-    itxy.ActivateOffset( oxp );
-    ityy.ActivateOffset( oxp );
-
-    itci.ActivateOffset( oxm );
-    itxx.ActivateOffset( oxm );
-    itxy.ActivateOffset( oxm );
-    ityy.ActivateOffset( oxm );
-
-    itci.ActivateOffset( oyp );
-    itxx.ActivateOffset( oyp );
-    itxy.ActivateOffset( oyp );
-    ityy.ActivateOffset( oyp );
-
-    itci.ActivateOffset( oym );
-    itxx.ActivateOffset( oym );
-    itxy.ActivateOffset( oym );
-    ityy.ActivateOffset( oym );
-
-    itci.ActivateOffset( oxpyp );
-    itxx.ActivateOffset( oxpyp );
-    itxy.ActivateOffset( oxpyp );
-    ityy.ActivateOffset( oxpyp );
-
-    itci.ActivateOffset( oxmym );
-    itxx.ActivateOffset( oxmym );
-    itxy.ActivateOffset( oxmym );
-    ityy.ActivateOffset( oxmym );
-
-    itci.ActivateOffset( oxpym );
-    itxx.ActivateOffset( oxpym );
-    itxy.ActivateOffset( oxpym );
-    ityy.ActivateOffset( oxpym );
-
-    itci.ActivateOffset( oxmyp );
-    itxx.ActivateOffset( oxmyp );
-    itxy.ActivateOffset( oxmyp );
-    ityy.ActivateOffset( oxmyp );
-
-    // run for each face diffusion
-    for( itci.GoToBegin(), dit.GoToBegin(), itxx.GoToBegin(),
-         itxy.GoToBegin(), ityy.GoToBegin();
-         !itci.IsAtEnd();
-         ++itci, ++dit, ++itxx, ++itxy, ++ityy )
+    offsets[o].Fill( 0 );
+    offsets[o][i] = 1;
+    offsets[o + 1].Fill( 0 );
+    offsets[o + 1][i] = -1;
+    o += 2;
+    components[g] = i * ( 2 * TDimension - i + 1 ) / 2;
+    weights[g] = m_TimeStep / ( 2.0 * ispacing[i] * ispacing[i] );
+    }
+  for( unsigned int i = 0; i < TDimension; ++i )
+    {
+    for( unsigned int j = i + 1; j < TDimension; ++j, ++g )
       {
-      // weights
-      const Precision xp = itxx.GetPixel( oxp ) + itxx.GetCenterPixel();
-      const Precision xm = itxx.GetPixel( oxm ) + itxx.GetCenterPixel();
-      const Precision yp = ityy.GetPixel( oyp ) + ityy.GetCenterPixel();
-      const Precision ym = ityy.GetPixel( oym ) + ityy.GetCenterPixel();
-
-      const Precision xpyp = itxy.GetPixel( oxpyp ) + itxy.GetCenterPixel();
-      const Precision xmym = itxy.GetPixel( oxmym ) + itxy.GetCenterPixel();
-      const Precision xpym = - itxy.GetPixel( oxpym )
-        - itxy.GetCenterPixel();
-      const Precision xmyp = - itxy.GetPixel( oxmyp )
-        - itxy.GetCenterPixel();
-
-      // evolution
-      const Precision cv = itci.GetCenterPixel();
-      dit.Value() = cv +
-            + rxx * ( xp * ( itci.GetPixel( oxp ) - cv )
-                    + xm * ( itci.GetPixel( oxm ) - cv ) )
-            + ryy * ( yp * ( itci.GetPixel( oyp ) - cv )
-                    + ym * ( itci.GetPixel( oym ) - cv ) )
-            + rxy * ( xpyp * ( itci.GetPixel( oxpyp ) - cv )
-                    + xmym * ( itci.GetPixel( oxmym ) - cv )
-                    + xpym * ( itci.GetPixel( oxpym ) - cv )
-                    + xmyp * ( itci.GetPixel( oxmyp ) - cv ) );
-
+      for( unsigned int k = 0; k < 4; ++k )
+        {
+        offsets[o + k].Fill( 0 );
+        }
+      offsets[o][i] = 1;
+      offsets[o][j] = 1;
+      offsets[o + 1][i] = -1;
+      offsets[o + 1][j] = -1;
+      offsets[o + 2][i] = 1;
+      offsets[o + 2][j] = -1;
+      offsets[o + 3][i] = -1;
+      offsets[o + 3][j] = 1;
+      o += 4;
+      components[g] = i * ( 2 * TDimension - i + 1 ) / 2 + ( j - i );
+      weights[g] = m_TimeStep / ( 4.0 * ispacing[i] * ispacing[j] );
       }
     }
-
-  // copying
-  ImageRegionConstIterator<PrecisionImageType>
-    iti ( d, d->GetLargestPossibleRegion() );
-  ImageRegionIterator<PrecisionImageType>
-    ito ( ci, ci->GetLargestPossibleRegion() );
-  for( iti.GoToBegin(), ito.GoToBegin(); !iti.IsAtEnd(); ++iti, ++ito )
+  for( o = 0; o < numberOfOffsets; ++o )
     {
-    ito.Value() = iti.Value();
+    linearOffsets[o] = 0;
+    for( unsigned int i = 0; i < TDimension; ++i )
+      {
+      linearOffsets[o] += offsets[o][i] * offsetTable[i];
+      }
     }
 
-  return;
+  const RegionType region = m_Current->GetLargestPossibleRegion();
+  const IndexType start = region.GetIndex();
+  const typename RegionType::SizeType size = region.GetSize();
+
+  const Precision * u = m_Current->GetBufferPointer();
+  const TensorType * dt = m_DiffusionTensor->GetBufferPointer();
+  Precision * out = m_Next->GetBufferPointer();
+  const PrecisionImageType * current = m_Current;
+
+  // calculate next = nonlineardiffusion( current ) using a 3x3( x3 )
+  // stencil with zero flux boundary conditions
+  this->GetMultiThreader()->template ParallelizeImageRegion< TDimension >(
+    region,
+    [&]( const RegionType & threadRegion )
+      {
+      ImageRegionConstIteratorWithIndex< PrecisionImageType > it( current,
+        threadRegion );
+      std::vector< OffsetValueType > q( numberOfOffsets );
+      IndexType n;
+      for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+        {
+        const IndexType idx = it.GetIndex();
+        const OffsetValueType p = current->ComputeOffset( idx );
+
+        bool interior = true;
+        for( unsigned int i = 0; i < TDimension; ++i )
+          {
+          if( idx[i] <= start[i] || idx[i] + 1 >=
+            start[i] + static_cast< IndexValueType >( size[i] ) )
+            {
+            interior = false;
+            break;
+            }
+          }
+        for( unsigned int k = 0; k < numberOfOffsets; ++k )
+          {
+          if( interior )
+            {
+            q[k] = p + linearOffsets[k];
+            }
+          else
+            {
+            for( unsigned int i = 0; i < TDimension; ++i )
+              {
+              n[i] = std::min( std::max( idx[i] + offsets[k][i],
+                start[i] ), start[i]
+                  + static_cast< IndexValueType >( size[i] ) - 1 );
+              }
+            q[k] = current->ComputeOffset( n );
+            }
+          }
+
+        // evolution
+        const Precision cv = u[p];
+        Precision value = cv;
+        unsigned int k = 0;
+        for( unsigned int c = 0; c < TDimension; ++c, k += 2 )
+          {
+          const unsigned int m = components[c];
+          const Precision center = dt[p][m];
+          value += weights[c]
+            * ( ( dt[q[k]][m] + center ) * ( u[q[k]] - cv )
+              + ( dt[q[k + 1]][m] + center ) * ( u[q[k + 1]] - cv ) );
+          }
+        for( unsigned int c = TDimension; c < TDimension + numberOfPairs;
+          ++c, k += 4 )
+          {
+          const unsigned int m = components[c];
+          const Precision center = dt[p][m];
+          value += weights[c]
+            * ( ( dt[q[k]][m] + center ) * ( u[q[k]] - cv )
+              + ( dt[q[k + 1]][m] + center ) * ( u[q[k + 1]] - cv )
+              - ( dt[q[k + 2]][m] + center ) * ( u[q[k + 2]] - cv )
+              - ( dt[q[k + 3]][m] + center ) * ( u[q[k + 3]] - cv ) );
+          }
+        out[p] = value;
+        }
+      }, nullptr );
+
+  std::swap( m_Current, m_Next );
 }
 
 
 template< class TPixel, unsigned int TDimension >
 void
 TubeEnhancingDiffusion2DImageFilter<TPixel, TDimension>
-::MaxTubeResponse( const typename PrecisionImageType::Pointer im )
+::MaxTubeResponse( void )
 {
+  typedef typename PrecisionImageType::RegionType           RegionType;
+  typedef typename HessianFilterType::OutputImageType       HessianImageType;
+  const unsigned int numberOfComponents =
+    TDimension * ( TDimension + 1 ) / 2;
+
+  // voxels without a positive response keep the identity Hessian
+  TensorType identity;
+  identity.SetIdentity();
+  double h[TDimension * ( TDimension + 1 ) / 2];
+  for( unsigned int k = 0; k < numberOfComponents; ++k )
+    {
+    h[k] = identity[k];
+    }
+  const Precision identityVesselness = ComputeVesselness( h );
 
-  // alloc memory for Hessian/tensor
-  m_Dxx = PrecisionImageType::New();
-  m_Dxx->SetOrigin( im->GetOrigin() );
-  m_Dxx->SetSpacing( im->GetSpacing() );
-  m_Dxx->SetDirection( im->GetDirection() );
-  m_Dxx->SetRegions( im->GetLargestPossibleRegion() );
-  m_Dxx->Allocate();
-  m_Dxx->FillBuffer( NumericTraits<Precision>::One );
-
-  m_Dxy = PrecisionImageType::New();
-  m_Dxy->SetOrigin( im->GetOrigin() );
-  m_Dxy->SetSpacing( im->GetSpacing() );
-  m_Dxy->SetDirection( im->GetDirection() );
-  m_Dxy->SetRegions( im->GetLargestPossibleRegion() );
-  m_Dxy->Allocate();
-  m_Dxy->FillBuffer( NumericTraits<Precision>::Zero );
-
-  m_Dyy = PrecisionImageType::New();
-  m_Dyy->SetOrigin( im->GetOrigin() );
-  m_Dyy->SetSpacing( im->GetSpacing() );
-  m_Dyy->SetDirection( im->GetDirection() );
-  m_Dyy->SetRegions( im->GetLargestPossibleRegion() );
-  m_Dyy->Allocate();
-  m_Dyy->FillBuffer( NumericTraits<Precision>::One );
-
-  // create temp vesselness image to store maxvessel
-  typename PrecisionImageType::Pointer vi = PrecisionImageType::New();
-
-  vi->SetOrigin( im->GetOrigin() );
-  vi->SetSpacing( im->GetSpacing() );
-  vi->SetDirection( im->GetDirection() );
-  vi->SetRegions( im->GetLargestPossibleRegion() );
-  vi->Allocate();
-  vi->FillBuffer( NumericTraits<Precision>::Zero );
-
-  for( unsigned int i = 0; i < m_Scales.size(); ++i )
+  const RegionType region = m_Current->GetLargestPossibleRegion();
+  const unsigned int numberOfScales =
+    static_cast< unsigned int >( m_Scales.size() );
+  const unsigned int numberOfPasses = std::max( numberOfScales, 1u );
+
+  for( unsigned int i = 0; i < numberOfPasses; ++i )
     {
-    typedef HessianRecursiveGaussianImageFilter<
-      PrecisionImageType > HessianType;
-    typename HessianType::Pointer hessian = HessianType::New();
-    hessian->SetInput( im );
-    hessian->SetNormalizeAcrossScale( true );
-    hessian->SetSigma( m_Scales[i] );
-    hessian->Update();
-
-    ImageRegionIterator<PrecisionImageType>
-      itxx ( m_Dxx, m_Dxx->GetLargestPossibleRegion() );
-    ImageRegionIterator<PrecisionImageType>
-      itxy ( m_Dxy, m_Dxy->GetLargestPossibleRegion() );
-    ImageRegionIterator<PrecisionImageType>
-      ityy ( m_Dyy, m_Dyy->GetLargestPossibleRegion() );
-    ImageRegionIterator<PrecisionImageType>
-      vit( vi, vi->GetLargestPossibleRegion() );
-
-    ImageRegionConstIterator<typename HessianType::OutputImageType> hit(
-      hessian->GetOutput(),
-      hessian->GetOutput()->GetLargestPossibleRegion() );
-
-    for( itxx.GoToBegin(), itxy.GoToBegin(), ityy.GoToBegin(),
-         vit.GoToBegin(), hit.GoToBegin();
-         !vit.IsAtEnd();
-         ++itxx, ++itxy, ++ityy, ++hit, ++vit )
+    const HessianImageType * hessianImage = nullptr;
+    if( i < numberOfScales )
       {
-      vnl_matrix<Precision> H( 2, 2 );
+      m_HessianFilter->SetInput( m_Current );
+      m_HessianFilter->SetSigma( m_Scales[i] );
+      // m_Current is updated in place between iterations
+      m_HessianFilter->Modified();
+      m_HessianFilter->Update();
+      hessianImage = m_HessianFilter->GetOutput();
+      }
+    const bool firstPass = ( i == 0 );
+    const bool lastPass = ( i + 1 == numberOfPasses );
 
-      H( 0, 0 ) = hit.Value()( 0, 0 );
-      H( 0, 1 ) = H( 1, 0 ) = hit.Value()( 0, 1 );
-      H( 1, 1 ) = hit.Value()( 1, 1 );
+    this->GetMultiThreader()->template ParallelizeImageRegion< TDimension >(
+      region,
+      [&]( const RegionType & threadRegion )
+        {
+        ImageRegionIterator< PrecisionImageType > vit( m_Vesselness,
+          threadRegion );
+        ImageRegionIterator< TensorImageType > tit( m_DiffusionTensor,
+          threadRegion );
+        ImageRegionConstIterator< HessianImageType > hit;
+        if( hessianImage != nullptr )
+          {
+          hit = ImageRegionConstIterator< HessianImageType >( hessianImage,
+            threadRegion );
+          }
+        double hv[TDimension * ( TDimension + 1 ) / 2];
+        Precision d[TDimension * ( TDimension + 1 ) / 2];
+        TensorType tensor;
+        for( ; !vit.IsAtEnd(); ++vit, ++tit )
+          {
+          if( firstPass )
+            {
+            vit.Set( NumericTraits<Precision>::Zero );
+            tit.Set( identity );
+            }
+          if( hessianImage != nullptr )
+            {
+            const typename HessianImageType::PixelType & hp = hit.Get();
+            for( unsigned int k = 0; k < numberOfComponents; ++k )
+              {
+              hv[k] = hp[k];
+              }
+            const Precision vesselness = ComputeVesselness( hv );
+            if( vesselness > 0 && vesselness > vit.Get() )
+              {
+              vit.Set( vesselness );
+              for( unsigned int k = 0; k < numberOfComponents; ++k )
+                {
+                tensor[k] = hp[k];
+                }
+              tit.Set( tensor );
+              }
+            ++hit;
+            }
+          if( lastPass )
+            {
+            // replace the Hessian by the diffusion tensor
+            const TensorType & ht = tit.Get();
+            for( unsigned int k = 0; k < numberOfComponents; ++k )
+              {
+              hv[k] = ht[k];
+              }
+            const bool isTube = ( vit.Get() > 0 );
+            const Precision vesselness = isTube ? vit.Get()
+              : identityVesselness;
+            ComputeDiffusionTensor( hv, vesselness, isTube, d );
+            for( unsigned int k = 0; k < numberOfComponents; ++k )
+              {
+              tensor[k] = d[k];
+              }
+            tit.Set( tensor );
+            }
+          }
+        }, nullptr );
+    }
+}
 
-      vnl_symmetric_eigensystem<Precision> ES( H );
-      vnl_vector<Precision> ev( 2 );
 
-      ev[0] = ES.get_eigenvalue( 0 );
-      ev[1] = ES.get_eigenvalue( 1 );
+template< class TPixel, unsigned int TDimension >
+typename TubeEnhancingDiffusion2DImageFilter<TPixel, TDimension>::Precision
+TubeEnhancingDiffusion2DImageFilter<TPixel, TDimension>
+::ComputeVesselness( const double * h ) const
+{
+  if( TDimension == 2 )
+    {
+    const double mean = ( h[0] + h[2] ) / 2;
+    const double radius = std::sqrt( ( h[0] - h[2] ) * ( h[0] - h[2] ) / 4
+      + h[1] * h[1] );
+    Precision l1 = mean - radius;
+    Precision l2 = mean + radius;
+    if( std::fabs( l1 ) > std::fabs( l2 ) )
+      {
+      std::swap( l1, l2 );
+      }
+    return TubenessFunction2D( l1, l2 );
+    }
 
-      if( std::fabs( ev[0] ) > std::fabs( ev[1] ) )
-        {
-        std::swap( ev[0], ev[1] );
-        }
+  double eVals[3];
+  double eVects[3][3];
+  ::tube::ComputeSymmetricEigen3x3( h, eVals, eVects );
+  std::sort( eVals, eVals + 3, []( double a, double b )
+    { return std::fabs( a ) < std::fabs( b ); } );
+  return TubenessFunction3D( eVals[0], eVals[1], eVals[2] );
+}
 
-      const Precision vesselness = TubenessFunction2D( ev[0], ev[1] );
 
-      if( vesselness > 0 && vesselness > vit.Value() )
-        {
-        vit.Value() = vesselness;
+template< class TPixel, unsigned int TDimension >
+void
+TubeEnhancingDiffusion2DImageFilter<TPixel, TDimension>
+::ComputeDiffusionTensor( const double * h, Precision v, bool isTube,
+  Precision * d ) const
+{
+  // adjusting eigenvalues
+  // static_cast required to prevent error with gcc 4.1.2
+  const Precision vs = std::pow( v,
+    static_cast<Precision>( 1.0/m_Sensitivity ) );
+  const Precision across = 1.0 + ( m_Epsilon - 1.0 ) * vs;
 
-        itxx.Value() = hit.Value()( 0, 0 );
-        itxy.Value() = hit.Value()( 0, 1 );
-        ityy.Value() = hit.Value()( 1, 1 );
+  if( TDimension == 2 || !isTube )
+    {
+    // In 2D both eigenvalues are equal, and voxels without a vessel
+    // response have no defined direction, so the tensor is isotropic
+    unsigned int k = 0;
+    for( unsigned int i = 0; i < TDimension; ++i )
+      {
+      for( unsigned int j = i; j < TDimension; ++j, ++k )
+        {
+        d[k] = ( i == j ) ? across : 0;
         }
       }
+    return;
     }
 
-  return;
+  // the vessel direction is the eigenvector of the eigenvalue of
+  // smallest magnitude: D = across I + ( along - across ) e e^T
+  const Precision along = 1.0 + ( m_Omega - 1.0 ) * vs;
+  double eVals[3];
+  double eVects[3][3];
+  ::tube::ComputeSymmetricEigen3x3( h, eVals, eVects );
+  unsigned int smallest = 0;
+  for( unsigned int i = 1; i < 3; ++i )
+    {
+    if( std::fabs( eVals[i] ) < std::fabs( eVals[smallest] ) )
+      {
+      smallest = i;
+      }
+    }
+  const double * e = eVects[smallest];
+  unsigned int k = 0;
+  for( unsigned int i = 0; i < 3; ++i )
+    {
+    for( unsigned int j = i; j < 3; ++j, ++k )
+      {
+      d[k] = ( along - across ) * e[i] * e[j];
+      if( i == j )
+        {
+        d[k] += across;
+        }
+      }
+    }
 }
 
 
 template< class TPixel, unsigned int TDimension >
 typename TubeEnhancingDiffusion2DImageFilter<TPixel, TDimension>::Precision
 TubeEnhancingDiffusion2DImageFilter<TPixel, TDimension>
-::TubenessFunction2D( const Precision l1, const Precision l2 )
+::TubenessFunction2D( const Precision l1, const Precision l2 ) const
 {
   if( l2 < 0 )
     {
@@ -427,63 +528,26 @@ TubeEnhancingDiffusion2DImageFilter<TPixel, TDimension>
 
 
 template< class TPixel, unsigned int TDimension >
-void
+typename TubeEnhancingDiffusion2DImageFilter<TPixel, TDimension>::Precision
 TubeEnhancingDiffusion2DImageFilter<TPixel, TDimension>
-::DiffusionTensor( void )
+::TubenessFunction3D( const Precision l1, const Precision l2,
+  const Precision l3 ) const
 {
-  ImageRegionIterator<PrecisionImageType>
-    itxx( m_Dxx, m_Dxx->GetLargestPossibleRegion() );
-  ImageRegionIterator<PrecisionImageType>
-    itxy( m_Dxy, m_Dxy->GetLargestPossibleRegion() );
-  ImageRegionIterator<PrecisionImageType>
-    ityy( m_Dyy, m_Dyy->GetLargestPossibleRegion() );
-
-  for( itxx.GoToBegin(), itxy.GoToBegin(), ityy.GoToBegin();
-       !itxx.IsAtEnd();
-       ++itxx, ++itxy, ++ityy )
+  if( l2 < 0 || l3 < 0 )
     {
-    vnl_matrix<Precision> H( 2, 2 );
-    H( 0, 0 ) = itxx.Value();
-    H( 0, 1 ) = H( 1, 0 ) = itxy.Value();
-    H( 1, 1 ) = ityy.Value();
-
-    vnl_symmetric_eigensystem<Precision> ES( H );
-
-    vnl_matrix<Precision> EV( 2, 2 );
-    EV.set_column( 0, ES.get_eigenvector( 0 ) );
-    EV.set_column( 1, ES.get_eigenvector( 1 ) );
-
-    vnl_vector<Precision> ev( 2 );
-    ev[0] = ES.get_eigenvalue( 0 );
-    ev[1] = ES.get_eigenvalue( 1 );
-
-    if( std::fabs( ev[0] ) > std::fabs( ev[1] ) )
-      {
-      std::swap( ev[0], ev[1] );
-      }
-
-    const Precision V = TubenessFunction2D( ev[0], ev[1] );
-    vnl_vector<Precision> evn( 2 );
-
-    // adjusting eigenvalues
-    // static_cast required to prevent error with gcc 4.1.2
-    evn[0]   = 1.0 + ( m_Epsilon - 1.0 ) *
-      std::pow( V, static_cast<Precision>( 1.0/m_Sensitivity ) );
-    evn[1]   = 1.0 + ( m_Epsilon - 1.0 ) *
-      std::pow( V, static_cast<Precision>( 1.0/m_Sensitivity ) );
+    return 0;
+    }
 
-    vnl_matrix<Precision> LAM( 2, 2 );
-    LAM.fill( 0 );
-    LAM( 0, 0 ) = evn[0];
-    LAM( 1, 1 ) = evn[1];
+  const Precision va2 = 2.0*m_Alpha*m_Alpha;
+  const Precision vb2 = 2.0*m_Beta*m_Beta;
+  const Precision vc2 = 2.0*m_Gamma*m_Gamma;
 
-    const vnl_matrix<Precision> HN = EV * LAM * EV.transpose();
+  const Precision Ra2 = ( l2 * l2 ) / ( l3 * l3 );
+  const Precision Rb2 = ( l1 * l1 ) / std::fabs( l2 * l3 );
+  const Precision S2 = ( l1 * l1 ) + ( l2 * l2 ) + ( l3 * l3 );
 
-    itxx.Value() = HN( 0, 0 );
-    itxy.Value() = HN( 0, 1 );
-    ityy.Value() = HN( 1, 1 );
-    }
-  return;
+  return ( 1.0 - std::exp( -Ra2/va2 ) ) * std::exp( -Rb2/vb2 )
+    * ( 1.0 - std::exp( -S2/vc2 ) );
 }
 
 
@@ -498,6 +562,11 @@ TubeEnhancingDiffusion2DImageFilter<TPixel, TDimension>
       "begin vesselenhancingdiffusion2Dimagefilter ... " << std::endl;
     }
 
+  if( TDimension != 2 && TDimension != 3 )
+    {
+    itkExceptionMacro( << "Only 2D and 3D images are supported." );
+    }
+
   ProgressReporter progress( this, 0, m_Iterations+4 );
 
   typedef MinimumMaximumImageFilter<ImageType> MinMaxType;
@@ -511,9 +580,20 @@ TubeEnhancingDiffusion2DImageFilter<TPixel, TDimension>
 
   const typename ImageType::SpacingType
     ispacing = this->GetInput()->GetSpacing();
-  const Precision htmax = 0.5 /
-     ( 1.0 / ( ispacing[0] * ispacing[0] )
-       + 1.0 / ( ispacing[1] * ispacing[1] ) );
+  double invSpacingSquaredSum = 0;
+  for( unsigned int i=0; i<TDimension; ++i )
+    {
+    invSpacingSquaredSum += 1.0 / ( ispacing[i] * ispacing[i] );
+    }
+  // The stable step also shrinks with the largest eigenvalue of the
+  // diffusion tensor: Omega along 3D vessels, Epsilon across them
+  Precision maxDiffusion = std::max( m_Epsilon,
+    NumericTraits<Precision>::One );
+  if( TDimension == 3 )
+    {
+    maxDiffusion = std::max( maxDiffusion, m_Omega );
+    }
+  const Precision htmax = 0.5 / ( invSpacingSquaredSum * maxDiffusion );
 
    if( m_TimeStep == NumericTraits<Precision>::Zero )
     {
@@ -522,9 +602,12 @@ TubeEnhancingDiffusion2DImageFilter<TPixel, TDimension>
 
   if( m_TimeStep> htmax )
     {
-    std::cerr << "the time step size is too large!" << std::endl;
-    this->AllocateOutputs();
-    return;
+    if( m_Verbose )
+      {
+      std::cout << "time step " << m_TimeStep
+                << " is too large, using " << htmax << std::endl;
+      }
+    m_TimeStep = htmax;
     }
 
   if( m_Verbose )
@@ -551,7 +634,10 @@ TubeEnhancingDiffusion2DImageFilter<TPixel, TDimension>
   cast->SetInput( this->GetInput() );
   cast->Update();
 
-  typename PrecisionImageType::Pointer ci = cast->GetOutput();
+  m_Current = cast->GetOutput();
+  m_Current->DisconnectPipeline();
+
+  AllocateWorkspace();
 
   progress.CompletedPixel();
 
@@ -564,13 +650,13 @@ TubeEnhancingDiffusion2DImageFilter<TPixel, TDimension>
        m_CurrentIteration<=m_Iterations;
        m_CurrentIteration++ )
     {
-    VED2DSingleIteration ( ci );
+    VEDSingleIteration();
     progress.CompletedPixel();
     }
 
   typedef MinimumMaximumImageFilter<PrecisionImageType> MMT;
   typename MMT::Pointer mm = MMT::New();
-  mm->SetInput( ci );
+  mm->SetInput( m_Current );
   mm->Update();
 
   progress.CompletedPixel();
@@ -588,7 +674,7 @@ TubeEnhancingDiffusion2DImageFilter<TPixel, TDimension>
   this->AllocateOutputs();
   typedef CastImageFilter<PrecisionImageType, ImageType> CTI;
   typename CTI::Pointer casti = CTI::New();
-  casti->SetInput( ci );
+  casti->SetInput( m_Current );
   casti->GraftOutput( this->GetOutput() );
   casti->Update();
   this->GraftOutput( casti->GetOutput() );
@@ -27,6 +27,8 @@ limitations under the License.
 
 #include <itkImageDuplicator.h>
 
+#include <vector>
+
 namespace tube
 {
 
@@ -49,18 +51,58 @@ public:
     dupFilter->SetInputImage( tmpImage );
     dupFilter->Update();
     m_Input = dupFilter->GetOutput();
+    m_DeferredOperations.clear();
     }
 
   ImageType * GetInput( void )
     {
+    this->EvaluateDeferredOperations();
     return m_Input;
     }
 
   ImageType * GetOutput( void )
     {
+    this->EvaluateDeferredOperations();
     return m_Input;
     }
 
+  /** When on, consecutive point-wise operations ( intensity windowing,
+   * multiplicative bias correction, add, multiply, fuse, threshold,
+   * absolute value, and both mask replacements ) are recorded instead of
+   * applied, and are then evaluated together in one threaded sweep over
+   * the image.  The sweep runs when any other operation is requested,
+   * when the output is requested, or when deferral is turned off.
+   * Operand images are referenced, not copied, until then.  Results are
+   * identical to immediate evaluation.  Default is off. */
+  void SetDeferPointwiseOperations( bool defer );
+
+  bool GetDeferPointwiseOperations( void ) const
+    {
+    return m_DeferPointwiseOperations;
+    }
+
+  unsigned int GetNumberOfDeferredOperations( void ) const
+    {
+    return static_cast< unsigned int >( m_DeferredOperations.size() );
+    }
+
+  /** When on ( the default ), point-wise operations that are not
+   * deferred are still evaluated by the threaded, branch-free kernels
+   * over the contiguous pixel buffer instead of by the scalar iterator
+   * loops.  Both produce bit-identical results. */
+  void SetUseThreadedPointwiseKernels( bool useThreaded )
+    {
+    m_UseThreadedPointwiseKernels = useThreaded;
+    }
+
+  bool GetUseThreadedPointwiseKernels( void ) const
+    {
+    return m_UseThreadedPointwiseKernels;
+    }
+
+  /** Apply all recorded point-wise operations to the image. */
+  void EvaluateDeferredOperations( void );
+
   /** Intensity window inVal range to outValRange. */
   void ApplyIntensityWindowing( float inValMin, float inValMax,
     float outMin, float outMax );
@@ -170,8 +212,54 @@ public:
 
 private:
 
+  typedef enum
+    {
+    IntensityWindowingOperation,
+    MultiplicativeBiasCorrectionOperation,
+    AddOperation,
+    MultiplyOperation,
+    FuseOperation,
+    ThresholdOperation,
+    AbsoluteOperation,
+    ReplaceValuesOutsideMaskOperation,
+    ReplaceValueWithinMaskOperation
+    } PointwiseOperationType;
+
+  struct PointwiseOperation
+    {
+    PointwiseOperationType      type;
+    float                       parameters[4];
+    double                      value;
+    typename ImageType::Pointer image;
+
+    PointwiseOperation( void )
+      : type( AbsoluteOperation ), value( 0 )
+      {
+      parameters[0] = parameters[1] = parameters[2] = parameters[3] = 0;
+      }
+    };
+
+  /** True if image can be used, pixel by pixel, with the current image */
+  bool IsPointwiseOperand( ImageType * image ) const;
+
+  bool UsePointwiseKernels( void ) const
+    {
+    return m_DeferPointwiseOperations || m_UseThreadedPointwiseKernels;
+    }
+
+  /** Record op, and evaluate it at once unless operations are deferred */
+  void SubmitPointwiseOperation( const PointwiseOperation & op );
+
+  static void ApplyPointwiseOperation( const PointwiseOperation & op,
+    PixelType * values, itk::SizeValueType first,
+    itk::SizeValueType count );
+
   typename ImageType::Pointer       m_Input;
 
+  bool                              m_DeferPointwiseOperations;
+  bool                              m_UseThreadedPointwiseKernels;
+  std::vector< PointwiseOperation > m_DeferredOperations;
+
   itk::VariableSizeMatrix< double > m_VoronoiTessellationAdjacencyMatrix;
 
 }; // End class ImageMathFilters
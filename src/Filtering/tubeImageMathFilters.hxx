@@ -40,10 +40,13 @@ limitations under the License.
 #include <itkResampleImageFilter.h>
 #include <itkConnectedThresholdImageFilter.h>
 #include <itkMedianImageFilter.h>
+#include <itkMultiThreaderBase.h>
 
 #include "itktubeCVTImageFilter.h"
 #include "itktubeNJetImageFunction.h"
 
+#include <algorithm>
+
 namespace tube
 {
 
@@ -52,6 +55,8 @@ ImageMathFilters<VDimension>::
 ImageMathFilters()
 {
   m_Input = nullptr;
+  m_DeferPointwiseOperations = false;
+  m_UseThreadedPointwiseKernels = true;
 }
 
 template< unsigned int VDimension >
@@ -61,6 +66,177 @@ ImageMathFilters<VDimension>::
   m_Input = nullptr;
 }
 
+//------------------------------------------------------------------------
+template< unsigned int VDimension >
+void
+ImageMathFilters<VDimension>::
+SetDeferPointwiseOperations( bool defer )
+{
+  if( !defer )
+    {
+    this->EvaluateDeferredOperations();
+    }
+  m_DeferPointwiseOperations = defer;
+}
+
+//------------------------------------------------------------------------
+template< unsigned int VDimension >
+bool
+ImageMathFilters<VDimension>::
+IsPointwiseOperand( ImageType * image ) const
+{
+  return image != nullptr && m_Input.IsNotNull()
+    && image->GetBufferedRegion().GetNumberOfPixels()
+      == m_Input->GetBufferedRegion().GetNumberOfPixels();
+}
+
+//------------------------------------------------------------------------
+template< unsigned int VDimension >
+void
+ImageMathFilters<VDimension>::
+EvaluateDeferredOperations( void )
+{
+  if( m_DeferredOperations.empty() )
+    {
+    return;
+    }
+
+  // Evaluate the whole expression block-by-block: every operation is
+  //   applied to a cache-resident block before the next block is read,
+  //   and blocks are processed concurrently.
+  const std::vector< PointwiseOperation > operations( m_DeferredOperations );
+  m_DeferredOperations.clear();
+
+  PixelType * buffer = m_Input->GetBufferPointer();
+  const itk::SizeValueType numberOfPixels =
+    m_Input->GetBufferedRegion().GetNumberOfPixels();
+  const itk::SizeValueType blockSize = 4096;
+  const itk::SizeValueType numberOfBlocks =
+    ( numberOfPixels + blockSize - 1 ) / blockSize;
+
+  itk::MultiThreaderBase::Pointer threader = itk::MultiThreaderBase::New();
+  threader->ParallelizeArray( 0, numberOfBlocks,
+    [&]( itk::SizeValueType block )
+      {
+      const itk::SizeValueType first = block * blockSize;
+      const itk::SizeValueType count = std::min( blockSize,
+        numberOfPixels - first );
+      for( unsigned int i = 0; i < operations.size(); ++i )
+        {
+        ApplyPointwiseOperation( operations[i], buffer + first, first,
+          count );
+        }
+      }, nullptr );
+}
+
+//------------------------------------------------------------------------
+template< unsigned int VDimension >
+void
+ImageMathFilters<VDimension>::
+SubmitPointwiseOperation( const PointwiseOperation & op )
+{
+  m_DeferredOperations.push_back( op );
+  if( !m_DeferPointwiseOperations )
+    {
+    this->EvaluateDeferredOperations();
+    }
+}
+
+//------------------------------------------------------------------------
+template< unsigned int VDimension >
+void
+ImageMathFilters<VDimension>::
+ApplyPointwiseOperation( const PointwiseOperation & op, PixelType * values,
+  itk::SizeValueType first, itk::SizeValueType count )
+{
+  // Each case reproduces the arithmetic of the corresponding scalar loop,
+  //   so results are bit-identical.  Conditionals are written as selects
+  //   and clamps as min/max ( which keep NaN like the scalar tests do ) so
+  //   that the loops vectorize.
+  const PixelType * operand = nullptr;
+  if( op.image.IsNotNull() )
+    {
+    operand = op.image->GetBufferPointer() + first;
+    }
+  const float p0 = op.parameters[0];
+  const float p1 = op.parameters[1];
+  const float p2 = op.parameters[2];
+  const float p3 = op.parameters[3];
+  switch( op.type )
+    {
+    case IntensityWindowingOperation:
+      for( itk::SizeValueType i = 0; i < count; ++i )
+        {
+        double tf = values[i];
+        tf = ( tf-p0 )/( p1-p0 );
+        tf = std::min( std::max( tf, 0.0 ), 1.0 );
+        tf = ( tf * ( p3-p2 ) ) + p2;
+        values[i] = ( PixelType )tf;
+        }
+      break;
+    case MultiplicativeBiasCorrectionOperation:
+      for( itk::SizeValueType i = 0; i < count; ++i )
+        {
+        double tf2 = operand[i];
+        double tf = values[i];
+        tf = tf * ( op.value / tf2 );
+        values[i] = ( tf2 != 0 ) ? ( PixelType )tf : values[i];
+        }
+      break;
+    case AddOperation:
+      for( itk::SizeValueType i = 0; i < count; ++i )
+        {
+        double tf1 = values[i];
+        double tf2 = operand[i];
+        values[i] = ( PixelType )( p0*tf1 + p1*tf2 );
+        }
+      break;
+    case MultiplyOperation:
+      for( itk::SizeValueType i = 0; i < count; ++i )
+        {
+        values[i] = values[i] * operand[i];
+        }
+      break;
+    case FuseOperation:
+      for( itk::SizeValueType i = 0; i < count; ++i )
+        {
+        double tf1 = values[i];
+        double tf2 = operand[i];
+        values[i] = ( tf2>tf1 ) ? ( PixelType )( p0 + tf2 ) : values[i];
+        }
+      break;
+    case ThresholdOperation:
+      for( itk::SizeValueType i = 0; i < count; ++i )
+        {
+        double tf1 = values[i];
+        values[i] = ( ( tf1 >= p0 ) & ( tf1 <= p1 ) ) ? ( PixelType )p2
+          : ( PixelType )p3;
+        }
+      break;
+    case AbsoluteOperation:
+      for( itk::SizeValueType i = 0; i < count; ++i )
+        {
+        values[i] = std::fabs( values[i] );
+        }
+      break;
+    case ReplaceValuesOutsideMaskOperation:
+      for( itk::SizeValueType i = 0; i < count; ++i )
+        {
+        double tf2 = operand[i];
+        values[i] = ( ( tf2 >= p0 ) & ( tf2 <= p1 ) ) ? values[i]
+          : ( PixelType )p2;
+        }
+      break;
+    case ReplaceValueWithinMaskOperation:
+      for( itk::SizeValueType i = 0; i < count; ++i )
+        {
+        values[i] = ( ( operand[i] >= p0 ) & ( operand[i] <= p1 )
+          & ( values[i] == p2 ) ) ? p3 : values[i];
+        }
+      break;
+    }
+}
+
 //------------------------------------------------------------------------
 template< unsigned int VDimension >
 void
@@ -68,6 +244,18 @@ ImageMathFilters<VDimension>::
 ApplyIntensityWindowing( 
   float valMin, float valMax, float outMin, float outMax )
 {
+  if( this->UsePointwiseKernels() )
+    {
+    PointwiseOperation op;
+    op.type = IntensityWindowingOperation;
+    op.parameters[0] = valMin;
+    op.parameters[1] = valMax;
+    op.parameters[2] = outMin;
+    op.parameters[3] = outMax;
+    this->SubmitPointwiseOperation( op );
+    return;
+    }
+
   itk::ImageRegionIterator< ImageType > it2( m_Input,
     m_Input->GetLargestPossibleRegion() );
   it2.GoToBegin();
@@ -112,6 +300,18 @@ ApplyIntensityMultiplicativeBiasCorrection(
     ++it2;
     }
   mean /= count;
+  if( this->UsePointwiseKernels()
+    && this->IsPointwiseOperand( inMeanFieldImage ) )
+    {
+    PointwiseOperation op;
+    op.type = MultiplicativeBiasCorrectionOperation;
+    op.value = mean;
+    op.image = inMeanFieldImage;
+    this->SubmitPointwiseOperation( op );
+    return;
+    }
+  this->EvaluateDeferredOperations();
+
   itk::ImageRegionIterator< ImageType > it3( m_Input,
     m_Input->GetLargestPossibleRegion() );
   it3.GoToBegin();
@@ -137,6 +337,8 @@ void
 ImageMathFilters<VDimension>::
 ResampleImage( ImageType * ref )
 {
+  this->EvaluateDeferredOperations();
+
   bool doResample = false;
   for( unsigned int i = 0; i < VDimension; i++ )
     {
@@ -175,6 +377,8 @@ ImageMathFilters<VDimension>::
 AddUniformNoise( float valMin, float valMax, float noiseMin,
   float noiseMax, int seed )
 {
+  this->EvaluateDeferredOperations();
+
   typedef itk::Statistics::MersenneTwisterRandomVariateGenerator UniformGenType;
   typename UniformGenType::Pointer uniformGen = UniformGenType::New();
   std::srand( seed );
@@ -202,6 +406,8 @@ ImageMathFilters<VDimension>::
 AddGaussianNoise( float valMin, float valMax, float noiseMean,
   float noiseStdDev, int seed )
 {
+  this->EvaluateDeferredOperations();
+
   typedef itk::Statistics::NormalVariateGenerator GaussGenType;
   typename GaussGenType::Pointer gaussGen = GaussGenType::New();
   std::srand( seed );
@@ -229,6 +435,18 @@ ImageMathFilters<VDimension>::
 AddImages( ImageType * input2,
   float weight1, float weight2 )
 {
+  if( this->UsePointwiseKernels() && this->IsPointwiseOperand( input2 ) )
+    {
+    PointwiseOperation op;
+    op.type = AddOperation;
+    op.parameters[0] = weight1;
+    op.parameters[1] = weight2;
+    op.image = input2;
+    this->SubmitPointwiseOperation( op );
+    return;
+    }
+  this->EvaluateDeferredOperations();
+
   itk::ImageRegionIterator< ImageType > it1( m_Input,
         m_Input->GetLargestPossibleRegion() );
   itk::ImageRegionIterator< ImageType > it2( input2,
@@ -252,6 +470,16 @@ void
 ImageMathFilters<VDimension>::
 MultiplyImages( ImageType * input2 )
 {
+  if( this->UsePointwiseKernels() && this->IsPointwiseOperand( input2 ) )
+    {
+    PointwiseOperation op;
+    op.type = MultiplyOperation;
+    op.image = input2;
+    this->SubmitPointwiseOperation( op );
+    return;
+    }
+  this->EvaluateDeferredOperations();
+
   itk::ImageRegionIterator< ImageType > it1( m_Input,
         m_Input->GetLargestPossibleRegion() );
   itk::ImageRegionIterator< ImageType > it2( input2,
@@ -272,6 +500,8 @@ void
 ImageMathFilters<VDimension>::
 MirrorAndPadImage( int numPadVoxels )
 {
+  this->EvaluateDeferredOperations();
+
   typedef itk::MirrorPadImageFilter< ImageType, ImageType > PadFilterType;
   typename PadFilterType::Pointer padFilter = PadFilterType::New();
   padFilter->SetInput( m_Input );
@@ -288,6 +518,8 @@ void
 ImageMathFilters<VDimension>::
 NormalizeImage( int normType )
 {
+  this->EvaluateDeferredOperations();
+
   if( normType == 0 )
     {
     typedef itk::NormalizeImageFilter< ImageType, ImageType >
@@ -444,6 +676,17 @@ void
 ImageMathFilters<VDimension>::
 FuseImages( ImageType * input2, float offset2 )
 {
+  if( this->UsePointwiseKernels() && this->IsPointwiseOperand( input2 ) )
+    {
+    PointwiseOperation op;
+    op.type = FuseOperation;
+    op.parameters[0] = offset2;
+    op.image = input2;
+    this->SubmitPointwiseOperation( op );
+    return;
+    }
+  this->EvaluateDeferredOperations();
+
   itk::ImageRegionIterator< ImageType > it1( m_Input,
         m_Input->GetLargestPossibleRegion() );
   itk::ImageRegionIterator< ImageType > it2( input2,
@@ -470,6 +713,8 @@ void
 ImageMathFilters<VDimension>::
 MedianImage( int filterSize )
 {
+  this->EvaluateDeferredOperations();
+
   typedef itk::MedianImageFilter< ImageType, ImageType >
     FilterType;
   typename ImageType::Pointer imTemp;
@@ -490,6 +735,18 @@ ImageMathFilters<VDimension>::
 ThresholdImage( float threshLow, float threshHigh, float valTrue,
   float valFalse )
 {
+  if( this->UsePointwiseKernels() )
+    {
+    PointwiseOperation op;
+    op.type = ThresholdOperation;
+    op.parameters[0] = threshLow;
+    op.parameters[1] = threshHigh;
+    op.parameters[2] = valTrue;
+    op.parameters[3] = valFalse;
+    this->SubmitPointwiseOperation( op );
+    return;
+    }
+
   itk::ImageRegionIterator< ImageType > it1( m_Input,
         m_Input->GetLargestPossibleRegion() );
   it1.GoToBegin();
@@ -516,6 +773,8 @@ ImageMathFilters<VDimension>
     ImageType * mask, float maskThreshLow, float maskThreshHigh,
     int mode )
 {
+  this->EvaluateDeferredOperations();
+
   itk::ImageRegionIterator< ImageType > it1( m_Input,
         m_Input->GetLargestPossibleRegion() );
   itk::ImageRegionIterator< ImageType > it2( mask,
@@ -555,6 +814,14 @@ void
 ImageMathFilters<VDimension>
 ::AbsoluteImage( void )
 {
+  if( this->UsePointwiseKernels() )
+    {
+    PointwiseOperation op;
+    op.type = AbsoluteOperation;
+    this->SubmitPointwiseOperation( op );
+    return;
+    }
+
   itk::ImageRegionIterator< ImageType > it1( m_Input,
         m_Input->GetLargestPossibleRegion() );
   it1.GoToBegin();
@@ -576,6 +843,19 @@ ImageMathFilters<VDimension>
   ImageMathFilters<VDimension> imf2 = ImageMathFilters<VDimension>();
   imf2.SetInput( mask );
   imf2.ResampleImage( m_Input );
+  if( this->UsePointwiseKernels() )
+    {
+    PointwiseOperation op;
+    op.type = ReplaceValuesOutsideMaskOperation;
+    op.parameters[0] = maskThreshLow;
+    op.parameters[1] = maskThreshHigh;
+    op.parameters[2] = valFalse;
+    op.image = imf2.GetOutput();
+    this->SubmitPointwiseOperation( op );
+    return;
+    }
+  this->EvaluateDeferredOperations();
+
   itk::ImageRegionIterator< ImageType > it1( m_Input,
         m_Input->GetLargestPossibleRegion() );
   itk::ImageRegionIterator< ImageType > it2( imf2.GetOutput(),
@@ -601,6 +881,8 @@ ImageMathFilters<VDimension>
 ::MorphImage( int mode, int radius, float foregroundValue,
   float backgroundValue )
 {
+  this->EvaluateDeferredOperations();
+
   typedef itk::BinaryBallStructuringElement<PixelType, VDimension>
     BallType;
   BallType ball;
@@ -650,6 +932,20 @@ ImageMathFilters<VDimension>
 ::ReplaceValueWithinMaskRange( ImageType * mask, float maskThreshLow,
   float maskThreshHigh, float imageVal, float newImageVal )
 {
+  if( this->UsePointwiseKernels() && this->IsPointwiseOperand( mask ) )
+    {
+    PointwiseOperation op;
+    op.type = ReplaceValueWithinMaskOperation;
+    op.parameters[0] = maskThreshLow;
+    op.parameters[1] = maskThreshHigh;
+    op.parameters[2] = imageVal;
+    op.parameters[3] = newImageVal;
+    op.image = mask;
+    this->SubmitPointwiseOperation( op );
+    return;
+    }
+  this->EvaluateDeferredOperations();
+
   itk::ImageRegionIterator< ImageType > itIm( m_Input,
         m_Input->GetLargestPossibleRegion() );
   itk::ImageRegionIterator< ImageType > itMask( mask,
@@ -672,6 +968,8 @@ void
 ImageMathFilters<VDimension>
 ::BlurImage( float sigma )
 {
+  this->EvaluateDeferredOperations();
+
   typename itk::RecursiveGaussianImageFilter< ImageType >::Pointer
     filter;
   typename ImageType::Pointer imTemp;
@@ -698,6 +996,8 @@ void
 ImageMathFilters<VDimension>
 ::BlurOrderImage( float sigma, int order, int direction )
 {
+  this->EvaluateDeferredOperations();
+
   typename itk::RecursiveGaussianImageFilter< ImageType >::Pointer
     filter;
   filter = itk::RecursiveGaussianImageFilter< ImageType >::New();
@@ -739,6 +1039,8 @@ std::vector<double>
 ImageMathFilters<VDimension>
 ::ComputeImageHistogram( unsigned int nBins, float & binMin, float & binSize )
 {
+  this->EvaluateDeferredOperations();
+
   itk::ImageRegionIteratorWithIndex< ImageType > it1( m_Input,
         m_Input->GetLargestPossibleRegion() );
   it1.GoToBegin();
@@ -790,6 +1092,8 @@ ImageMathFilters<VDimension>
 ::CorrectIntensitySliceBySliceUsingHistogramMatching(
     unsigned int numberOfBins, unsigned int numberOfMatchPoints )
 {
+  this->EvaluateDeferredOperations();
+
   typedef itk::Image<PixelType, 2> ImageType2D;
   typedef itk::HistogramMatchingImageFilter< ImageType2D, ImageType2D >
       HistogramMatchFilterType;
@@ -880,6 +1184,8 @@ ImageMathFilters<VDimension>
 ::CorrectIntensityUsingHistogramMatching( unsigned int numberOfBins,
   unsigned int numberOfMatchPoints, ImageType * ref )
 {
+  this->EvaluateDeferredOperations();
+
   typedef itk::HistogramMatchingImageFilter< ImageType, ImageType >
       HistogramMatchFilterType;
   typename HistogramMatchFilterType::Pointer matchFilter;
@@ -898,6 +1204,8 @@ void
 ImageMathFilters<VDimension>
 ::Resize( double factor )
 {
+  this->EvaluateDeferredOperations();
+
   typename ImageType::Pointer imSub2 = ImageType::New();
   imSub2->CopyInformation( m_Input );
   typename ImageType::SizeType size;
@@ -954,6 +1262,8 @@ void
 ImageMathFilters<VDimension>
 ::Resize( ImageType * ref )
 {
+  this->EvaluateDeferredOperations();
+
   this->ResampleImage( ref );
 }
 
@@ -963,6 +1273,8 @@ void
 ImageMathFilters<VDimension>
 ::ExtractSlice( unsigned int dimension, unsigned int slice )
 {
+  this->EvaluateDeferredOperations();
+
   typedef itk::ExtractImageFilter<ImageType, ImageType>
     ExtractSliceFilterType;
 
@@ -999,6 +1311,8 @@ void
 ImageMathFilters<VDimension>
 ::EnhanceVessels( double scaleMin, double scaleMax, double numScales )
 {
+  this->EvaluateDeferredOperations();
+
   double logScaleStep = ( std::log( scaleMax ) - std::log( scaleMin ) )
     / ( numScales-1 );
 
@@ -1077,6 +1391,8 @@ ImageMathFilters<VDimension>
 ::SegmentUsingConnectedThreshold( float threshLow, float threshHigh,
   float labelValue, float x, float y, float z )
 {
+  this->EvaluateDeferredOperations();
+
   typedef itk::ConnectedThresholdImageFilter<ImageType, ImageType>
              FilterType;
   typename FilterType::Pointer filter = FilterType::New();
@@ -1106,6 +1422,8 @@ ImageMathFilters<VDimension>
 ::ComputeVoronoiTessellation( unsigned int numberOfCentroids,
   unsigned int numberOfIterations, unsigned int numberOfSamples )
 {
+  this->EvaluateDeferredOperations();
+
   typedef itk::tube::CVTImageFilter<ImageType, ImageType> FilterType;
   typename FilterType::Pointer filter = FilterType::New();
   filter->SetInput( m_Input );
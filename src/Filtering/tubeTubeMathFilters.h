@@ -27,6 +27,8 @@ limitations under the License.
 #include "itkGroupSpatialObject.h"
 #include "itkTubeSpatialObject.h"
 
+#include <vector>
+
 namespace tube
 {
 template< unsigned int DimensionT, class ImagePixelT=float >
@@ -60,6 +62,15 @@ public:
   void SetCurrentTubeId( int currentTubeId );
   void SetUseAllTubes( void );
 
+  /** Number of work units over which SmoothTube, SubsampleTube,
+   *  SetPointValuesFromImage, SetPointValuesFromImageMean, and
+   *  FillGapToParent distribute the tubes.  Use 1 to process the tubes
+   *  serially, and 0 ( the default ) for the global default of
+   *  itk::MultiThreaderBase.  Results, tube order, and ids do not depend
+   *  on this setting. */
+  void SetNumberOfWorkUnits( unsigned int numberOfWorkUnits );
+  unsigned int GetNumberOfWorkUnits( void ) const;
+
   void SetPointValuesFromImage( typename ImageType::Pointer & inputImage,
     std::string propertyId, double blend=1 );
 
@@ -92,6 +103,17 @@ public:
 
 protected:
 
+  typedef std::vector< typename TubeType::Pointer > TubeVectorType;
+
+  /** Tubes selected by the current tube id, in GetChildren order */
+  void GetSelectedTubes( TubeVectorType & tubes ) const;
+
+  /** Call function( tube ) for every tube, distributing the tubes over
+   *  the work units.  Calls must only modify the tube they are given. */
+  template< class TFunction >
+  void ParallelizeTubes( const TubeVectorType & tubes,
+    TFunction function ) const;
+
   static void InterpolatePath(
     typename TubeType::TubePointType * parentNearestPoint,
     typename TubeType::TubePointType * childEndPoint,
@@ -104,6 +126,8 @@ private:
 
   int m_CurrentTubeId;
 
+  unsigned int m_NumberOfWorkUnits;
+
 
 }; // End class ImageFilters
 
@@ -22,8 +22,12 @@ limitations under the License.
 #ifndef __tubeTubeMathFilters_hxx
 #define __tubeTubeMathFilters_hxx
 
+#include "itkMultiThreaderBase.h"
 #include "itkNumericTraits.h"
 
+#include <algorithm>
+#include <map>
+
 namespace tube
 {
 
@@ -34,6 +38,7 @@ TubeMathFilters()
   m_InputTubeGroup = nullptr;
   m_InputTube = nullptr;
   m_CurrentTubeId = -1;
+  m_NumberOfWorkUnits = 0;
 }
 
 template< unsigned int DimensionT, class ImagePixelT >
@@ -93,6 +98,72 @@ SetUseAllTubes( )
   m_CurrentTubeId = -1;
 }
 
+template< unsigned int DimensionT, class ImagePixelT >
+void
+TubeMathFilters< DimensionT, ImagePixelT >::
+SetNumberOfWorkUnits( unsigned int numberOfWorkUnits )
+{
+  m_NumberOfWorkUnits = numberOfWorkUnits;
+}
+
+template< unsigned int DimensionT, class ImagePixelT >
+unsigned int
+TubeMathFilters< DimensionT, ImagePixelT >::
+GetNumberOfWorkUnits( void ) const
+{
+  return m_NumberOfWorkUnits;
+}
+
+template< unsigned int DimensionT, class ImagePixelT >
+void
+TubeMathFilters< DimensionT, ImagePixelT >::
+GetSelectedTubes( TubeVectorType & tubes ) const
+{
+  tubes.clear();
+
+  TubeListPointerType tubeList = m_InputTubeGroup->GetChildren(
+    m_InputTubeGroup->GetMaximumDepth(), "Tube" );
+  for( typename TubeGroupType::ChildrenListType::iterator itCurTube =
+    tubeList->begin(); itCurTube != tubeList->end(); ++itCurTube )
+    {
+    TubeType * curTube = dynamic_cast< TubeType * >(
+      itCurTube->GetPointer() );
+    if( m_CurrentTubeId == -1 || curTube->GetId() == m_CurrentTubeId )
+      {
+      tubes.push_back( curTube );
+      }
+    }
+  tubeList->clear();
+  delete tubeList;
+}
+
+template< unsigned int DimensionT, class ImagePixelT >
+template< class TFunction >
+void
+TubeMathFilters< DimensionT, ImagePixelT >::
+ParallelizeTubes( const TubeVectorType & tubes, TFunction function ) const
+{
+  if( m_NumberOfWorkUnits == 1 || tubes.size() <= 1 )
+    {
+    for( unsigned int i = 0; i < tubes.size(); ++i )
+      {
+      function( tubes[i].GetPointer() );
+      }
+    return;
+    }
+
+  itk::MultiThreaderBase::Pointer threader = itk::MultiThreaderBase::New();
+  if( m_NumberOfWorkUnits > 0 )
+    {
+    threader->SetNumberOfWorkUnits( m_NumberOfWorkUnits );
+    }
+  threader->ParallelizeArray( 0, tubes.size(),
+    [&]( itk::SizeValueType i )
+      {
+      function( tubes[i].GetPointer() );
+      }, nullptr );
+}
+
 template< unsigned int DimensionT, class ImagePixelT >
 void
 TubeMathFilters< DimensionT, ImagePixelT >::
@@ -100,20 +171,19 @@ SetPointValuesFromImage(
   typename itk::Image< ImagePixelT, DimensionT>::Pointer & inputImage,
   std::string propertyId, double blend )
 {
-  typename TubeType::ChildrenListType::iterator tubeIterator;
-  typename TubeType::ChildrenListPointer inputTubeList =
-    m_InputTubeGroup->GetChildren( m_InputTubeGroup->GetMaximumDepth(),
-    "Tube" );
-  for( tubeIterator = inputTubeList->begin(); tubeIterator !=
-    inputTubeList->end(); tubeIterator++ )
+  TubeVectorType tubes;
+  this->GetSelectedTubes( tubes );
+
+  // Object-to-world transforms depend on the parent tubes, so they are
+  //   updated serially before the tubes are sampled concurrently
+  for( unsigned int i = 0; i < tubes.size(); ++i )
     {
-    typename TubeType::Pointer inputTube = ( ( TubeType * )( tubeIterator->
-      GetPointer() ) );
+    tubes[i]->Update();
+    }
 
-    if( m_CurrentTubeId == -1 || inputTube->GetId() == m_CurrentTubeId )
+  this->ParallelizeTubes( tubes,
+    [&]( TubeType * inputTube )
       {
-      inputTube->Update();
-
       unsigned int pointListSize = inputTube->GetNumberOfPoints();
       for( unsigned int pointNum = 0; pointNum < pointListSize; ++pointNum )
         {
@@ -179,10 +249,7 @@ SetPointValuesFromImage(
           currentPoint->SetTagScalarValue( propertyId, val );
           }
         }
-      }
-    }
-  inputTubeList->clear();
-  delete inputTubeList;
+      } );
 }
 
 template< unsigned int DimensionT, class ImagePixelT >
@@ -192,21 +259,19 @@ SetPointValuesFromImageMean(
   typename itk::Image< ImagePixelT, DimensionT>::Pointer & inputImage,
   std::string propertyId )
 {
-  typename TubeType::ChildrenListType::iterator tubeIterator;
+  TubeVectorType tubes;
+  this->GetSelectedTubes( tubes );
 
-  typename TubeType::ChildrenListPointer inputTubeList =
-    m_InputTubeGroup->GetChildren( m_InputTubeGroup->GetMaximumDepth(),
-    "Tube" );
-  for( tubeIterator = inputTubeList->begin(); tubeIterator !=
-    inputTubeList->end(); tubeIterator++ )
+  // Object-to-world transforms depend on the parent tubes, so they are
+  //   updated serially before the tubes are sampled concurrently
+  for( unsigned int i = 0; i < tubes.size(); ++i )
     {
-    typename TubeType::Pointer inputTube = ( ( TubeType * )( tubeIterator->
-      GetPointer() ) );
+    tubes[i]->Update();
+    }
 
-    if( m_CurrentTubeId == -1 || inputTube->GetId() == m_CurrentTubeId )
+  this->ParallelizeTubes( tubes,
+    [&]( TubeType * inputTube )
       {
-      inputTube->Update();
-
       double valAvg = 0;
       unsigned int valCount = 0;
       unsigned int pointListSize = inputTube->GetNumberOfPoints();
@@ -262,10 +327,7 @@ SetPointValuesFromImageMean(
           currentPoint->SetTagScalarValue( propertyId, valAvg );
           }
         }
-      }
-    }
-  inputTubeList->clear();
-  delete inputTubeList;
+      } );
 }
 
 //------------------------------------------------------------------------
@@ -276,91 +338,145 @@ FillGapToParent( double stepSize )
 {
   TubeListPointerType tubeList = m_InputTubeGroup->GetChildren(
     m_InputTubeGroup->GetMaximumDepth(), "Tube" );
-
+  TubeVectorType allTubes;
   for( typename TubeGroupType::ChildrenListType::iterator itCurTube =
     tubeList->begin(); itCurTube != tubeList->end(); ++itCurTube )
     {
-    typename TubeType::Pointer curTube = dynamic_cast< TubeType * >(
-      itCurTube->GetPointer() );
-    if( m_CurrentTubeId == -1 || curTube->GetId() == m_CurrentTubeId )
+    allTubes.push_back( dynamic_cast< TubeType * >(
+      itCurTube->GetPointer() ) );
+    }
+  tubeList->clear();
+  delete tubeList;
+
+  // The parent of a tube is the first tube in the list with its parent id
+  std::map< TubeIdType, unsigned int > tubeIndex;
+  for( unsigned int i = 0; i < allTubes.size(); ++i )
+    {
+    tubeIndex.insert( std::make_pair( allTubes[i]->GetId(), i ) );
+    }
+
+  std::vector< bool > selected( allTubes.size(), false );
+  std::vector< int > parentIndex( allTubes.size(), -1 );
+  std::vector< std::vector< unsigned int > > children( allTubes.size() );
+  for( unsigned int i = 0; i < allTubes.size(); ++i )
+    {
+    TubeType * curTube = allTubes[i];
+    selected[i] = ( m_CurrentTubeId == -1
+      || curTube->GetId() == m_CurrentTubeId );
+    if( selected[i] && curTube->GetRoot() == false
+      && curTube->GetParentId() != curTube->GetId() )
       {
-      TubeIdType curParentTubeId = curTube->GetParentId();
-      TubePointType* parentNearestPoint = NULL;
-  
-      if( curTube->GetRoot() == false && curParentTubeId != curTube->GetId() )
+      typename std::map< TubeIdType, unsigned int >::const_iterator
+        itParent = tubeIndex.find( curTube->GetParentId() );
+      if( itParent != tubeIndex.end() )
         {
-        //find parent target tube
-        for( typename TubeGroupType::ChildrenListType::iterator itTubes =
-          tubeList->begin(); itTubes != tubeList->end(); ++itTubes )
-          {
-          typename TubeType::Pointer tube = dynamic_cast< TubeType * >(
-            itTubes->GetPointer() );
-          if( tube->GetId() == curParentTubeId )
-            {
-            double minDistance = itk::NumericTraits<double>::max();
-            int flag =-1;
-            for( unsigned int index = 0; index < tube->GetNumberOfPoints();
-              ++index )
-              {
-              TubePointType* tubePoint = dynamic_cast< TubePointType* >(
-                tube->GetPoint( index ) );
-              PositionType tubePointPosition =
-                tubePoint->GetPositionInObjectSpace();
-              double distance = tubePointPosition.EuclideanDistanceTo(
-                curTube->GetPoint( 0 )->GetPositionInObjectSpace() );
-              if( minDistance > distance )
-                {
-                minDistance = distance;
-                parentNearestPoint = tubePoint;
-                flag = 1;
-                }
-              distance = tubePointPosition.EuclideanDistanceTo(
-                curTube->GetPoint( curTube->GetNumberOfPoints() - 1 )
-                ->GetPositionInObjectSpace() );
-              if( minDistance > distance )
-                {
-                minDistance = distance;
-                parentNearestPoint = tubePoint;
-                flag = 2;
-                }
-              }
-  
-            TubePointListType newTubePoints;
-            if( flag == 1 )
-              {
-              TubePointType* childTubeStartPoint = dynamic_cast<
-                TubePointType* >( curTube->GetPoint( 0 ) );
-              InterpolatePath( parentNearestPoint,
-                childTubeStartPoint, stepSize, newTubePoints );
-              TubePointListType targetTubePoints = curTube->GetPoints();
-              curTube->Clear();
-              for( unsigned int index = 0; index < newTubePoints.size();
-                ++index )
-                {
-                curTube->GetPoints().push_back( newTubePoints[ index ] );
-                }
-              for( unsigned int i = 0; i < targetTubePoints.size(); ++i )
-                {
-                curTube->GetPoints().push_back( targetTubePoints[ i ] );
-                }
-              }
-            if( flag == 2 )
-              {
-              TubePointType* childTubeEndPoint =
-                dynamic_cast< TubePointType* >
-                ( curTube->GetPoint( curTube->GetNumberOfPoints() - 1 ) );
-              InterpolatePath( parentNearestPoint,
-                childTubeEndPoint, stepSize, newTubePoints );
-              for( int index = newTubePoints.size() - 1; index >= 0; index-- )
-                {
-                curTube->GetPoints().push_back( newTubePoints[ index ] );
-                }
-              }
-            break;
-            }
-          }
+        parentIndex[i] = itParent->second;
+        children[itParent->second].push_back( i );
+        }
+      }
+    }
+
+  // A tube reads the points of its parent and extends its own.  Of a
+  //   selected tube and its selected parent, the one later in the list
+  //   must see the other as the serial loop would have left it, so it is
+  //   processed in a later wave.  Tubes within a wave are independent.
+  std::vector< unsigned int > wave( allTubes.size(), 0 );
+  std::vector< TubeVectorType > waves;
+  for( unsigned int i = 0; i < allTubes.size(); ++i )
+    {
+    if( parentIndex[i] < 0 )
+      {
+      continue;
+      }
+    const unsigned int p = parentIndex[i];
+    if( p < i && selected[p] && parentIndex[p] >= 0 )
+      {
+      wave[i] = std::max( wave[i], wave[p] + 1 );
+      }
+    for( unsigned int c = 0; c < children[i].size(); ++c )
+      {
+      if( children[i][c] < i )
+        {
+        wave[i] = std::max( wave[i], wave[children[i][c]] + 1 );
+        }
+      }
+    if( wave[i] >= waves.size() )
+      {
+      waves.resize( wave[i] + 1 );
+      }
+    waves[wave[i]].push_back( allTubes[i] );
+    }
+
+  auto fillGap = [&]( TubeType * curTube )
+    {
+    TubeType * tube = allTubes[ tubeIndex.find(
+      curTube->GetParentId() )->second ];
+    TubePointType* parentNearestPoint = NULL;
+
+    double minDistance = itk::NumericTraits<double>::max();
+    int flag =-1;
+    for( unsigned int index = 0; index < tube->GetNumberOfPoints();
+      ++index )
+      {
+      TubePointType* tubePoint = dynamic_cast< TubePointType* >(
+        tube->GetPoint( index ) );
+      PositionType tubePointPosition =
+        tubePoint->GetPositionInObjectSpace();
+      double distance = tubePointPosition.EuclideanDistanceTo(
+        curTube->GetPoint( 0 )->GetPositionInObjectSpace() );
+      if( minDistance > distance )
+        {
+        minDistance = distance;
+        parentNearestPoint = tubePoint;
+        flag = 1;
+        }
+      distance = tubePointPosition.EuclideanDistanceTo(
+        curTube->GetPoint( curTube->GetNumberOfPoints() - 1 )
+        ->GetPositionInObjectSpace() );
+      if( minDistance > distance )
+        {
+        minDistance = distance;
+        parentNearestPoint = tubePoint;
+        flag = 2;
+        }
+      }
+
+    TubePointListType newTubePoints;
+    if( flag == 1 )
+      {
+      TubePointType* childTubeStartPoint = dynamic_cast<
+        TubePointType* >( curTube->GetPoint( 0 ) );
+      InterpolatePath( parentNearestPoint,
+        childTubeStartPoint, stepSize, newTubePoints );
+      TubePointListType targetTubePoints = curTube->GetPoints();
+      curTube->Clear();
+      for( unsigned int index = 0; index < newTubePoints.size();
+        ++index )
+        {
+        curTube->GetPoints().push_back( newTubePoints[ index ] );
+        }
+      for( unsigned int i = 0; i < targetTubePoints.size(); ++i )
+        {
+        curTube->GetPoints().push_back( targetTubePoints[ i ] );
         }
       }
+    if( flag == 2 )
+      {
+      TubePointType* childTubeEndPoint =
+        dynamic_cast< TubePointType* >
+        ( curTube->GetPoint( curTube->GetNumberOfPoints() - 1 ) );
+      InterpolatePath( parentNearestPoint,
+        childTubeEndPoint, stepSize, newTubePoints );
+      for( int index = newTubePoints.size() - 1; index >= 0; index-- )
+        {
+        curTube->GetPoints().push_back( newTubePoints[ index ] );
+        }
+      }
+    };
+
+  for( unsigned int w = 0; w < waves.size(); ++w )
+    {
+    this->ParallelizeTubes( waves[w], fillGap );
     }
 }
 
@@ -420,15 +536,11 @@ SmoothTube( double h, SmoothTubeFunctionEnum smoothFunction )
     return;
     }
 
-  TubeListPointerType tubeList = m_InputTubeGroup->GetChildren(
-    m_InputTubeGroup->GetMaximumDepth(), "Tube" );
+  TubeVectorType tubes;
+  this->GetSelectedTubes( tubes );
 
-  for( typename TubeGroupType::ChildrenListType::iterator itCurTube =
-    tubeList->begin(); itCurTube != tubeList->end(); ++itCurTube )
-    {
-    typename TubeType::Pointer curTube = dynamic_cast< TubeType * >(
-      itCurTube->GetPointer() );
-    if( m_CurrentTubeId == -1 || curTube->GetId() == m_CurrentTubeId )
+  this->ParallelizeTubes( tubes,
+    [&]( TubeType * curTube )
       {
       typename TubeType::PointType avgPos;
       std::vector< double > avgTagScalar;
@@ -568,10 +680,7 @@ SmoothTube( double h, SmoothTubeFunctionEnum smoothFunction )
     
       curTube->SetPoints( newPointList );
       curTube->ComputeTangentsAndNormals();
-      }
-    }
-  tubeList->clear();
-  delete tubeList;
+      } );
 }
 
 /**
@@ -587,15 +696,11 @@ SubsampleTube( int N )
     return;
     }
 
-  TubeListPointerType tubeList = m_InputTubeGroup->GetChildren(
-    m_InputTubeGroup->GetMaximumDepth(), "Tube" );
+  TubeVectorType tubes;
+  this->GetSelectedTubes( tubes );
 
-  for( typename TubeGroupType::ChildrenListType::iterator itCurTube =
-    tubeList->begin(); itCurTube != tubeList->end(); ++itCurTube )
-    {
-    typename TubeType::Pointer curTube = dynamic_cast< TubeType * >(
-      itCurTube->GetPointer() );
-    if( m_CurrentTubeId == -1 || curTube->GetId() == m_CurrentTubeId )
+  this->ParallelizeTubes( tubes,
+    [&]( TubeType * curTube )
       {
       typename TubeType::TubePointListType::iterator pointItr;
 
@@ -622,11 +727,7 @@ SubsampleTube( int N )
     
       curTube->SetPoints( newPointList );
       curTube->ComputeTangentsAndNormals();
-      }
-    }
-
-  tubeList->clear();
-  delete tubeList;
+      } );
 }
     
 /**
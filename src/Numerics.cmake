@@ -27,6 +27,7 @@ set( TubeTK_Numerics_H_Files
   Numerics/itktubeComputeImageStatistics.h
   Numerics/itktubeFeatureVectorGenerator.h
   Numerics/itktubeImageRegionMomentsCalculator.h
+  Numerics/itktubeImageRegionStatistics.h
   Numerics/itktubeJointHistogramImageFunction.h
   Numerics/itktubeNJetFeatureVectorGenerator.h
   Numerics/itktubeNJetImageFunction.h
@@ -51,6 +52,7 @@ set( TubeTK_Numerics_HXX_Files
   Numerics/itktubeComputeImageStatistics.hxx
   Numerics/itktubeFeatureVectorGenerator.hxx
   Numerics/itktubeImageRegionMomentsCalculator.hxx
+  Numerics/itktubeImageRegionStatistics.hxx
   Numerics/itktubeJointHistogramImageFunction.hxx
   Numerics/itktubeNJetFeatureVectorGenerator.hxx
   Numerics/itktubeNJetImageFunction.hxx
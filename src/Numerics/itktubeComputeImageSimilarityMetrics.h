@@ -25,9 +25,12 @@ limitations under the License.
 #define __itktubeComputeImageSimilarityMetrics_h
 
 // ITK includes
+#include <itkLinearInterpolateImageFunction.h>
 #include <itkObject.h>
 #include <itkObjectFactory.h>
 
+#include <vector>
+
 namespace itk
 {
 
@@ -37,6 +40,23 @@ namespace tube
 /** \class ComputeImageSimilarityMetrics
  * \brief Computes similarity between two images using correlation or
  * mutual information
+ *
+ * Input1 is the fixed image.  It is scored against Input2 and against
+ * every image added by AddMovingImage() in the same passes over the fixed
+ * voxels.  Sampling is stratified: the fixed voxels are split, in buffer
+ * order, into runs of 1 / SamplingRate voxels, and one voxel is drawn
+ * from each run, so samples cover the image evenly and are the same for
+ * every moving image and every number of threads.  Moving images are
+ * sampled at the physical point of each fixed voxel, directly when they
+ * share the fixed image's grid and by linear interpolation otherwise;
+ * samples outside of a moving image are ignored for that image.  Samples
+ * are not stored.
+ *
+ * Correlation is the Pearson correlation of the samples, whose centered
+ * sums are accumulated in a single pass.  Mutual information is computed
+ * from a joint histogram, of NumberOfHistogramBins bins per image
+ * spanning the range of each image's samples: a first pass finds the
+ * ranges, and a second one draws the samples again and bins them.
  */
 
 template< class TInputImage >
@@ -68,6 +88,10 @@ public:
   itkSetMacro( SamplingRate, double );
   itkGetMacro( SamplingRate, double );
 
+  /** Set/Get number of histogram bins per image for mutual information */
+  itkSetMacro( NumberOfHistogramBins, unsigned int );
+  itkGetMacro( NumberOfHistogramBins, unsigned int );
+
   /** Set/Get input image 1 */
   itkSetConstObjectMacro( Input1, ImageType );
   itkGetConstObjectMacro( Input1, ImageType );
@@ -76,12 +100,25 @@ public:
   itkSetConstObjectMacro( Input2, ImageType );
   itkGetConstObjectMacro( Input2, ImageType );
 
-  /** Compute image similarity */
+  /** Add an image to score against input image 1.  Return its index. */
+  unsigned int AddMovingImage( const ImageType * image );
+
+  /** Remove the images added by AddMovingImage() */
+  void ClearMovingImages( void );
+
+  /** Get number of images added by AddMovingImage() */
+  unsigned int GetNumberOfMovingImages( void ) const;
+
+  /** Compute the similarity of input image 1 to input image 2, if set,
+   *  and to every added moving image */
   void Update( void );
 
-  /** Get image similarity */
+  /** Get similarity of input image 1 to input image 2 */
   itkGetMacro( Output, double );
 
+  /** Get similarity of input image 1 to each added moving image */
+  itkGetMacro( Outputs, std::vector< double > );
+
 protected:
 
   ComputeImageSimilarityMetrics( void );
@@ -91,11 +128,49 @@ protected:
 
 private:
 
+  typedef LinearInterpolateImageFunction< ImageType, double >
+                                              InterpolatorType;
+
+  /** Means, centered sums and range of the samples valid for a moving
+   *  image */
+  struct SampleStatistics
+    {
+    double  Count;
+    double  FixedMean;
+    double  MovingMean;
+    double  FixedSumSq;
+    double  MovingSumSq;
+    double  CrossSum;
+    double  MovingMin;
+    double  MovingMax;
+    };
+
+  /** Buffer offset of the fixed voxel drawn for a sample */
+  static SizeValueType ComputeSampleOffset( SizeValueType sample,
+    SizeValueType stride, SizeValueType numberOfPixels );
+
+  /** Add the statistics of from to those of to */
+  static void MergeStatistics( const SampleStatistics & from,
+    SampleStatistics & to );
+
+  /** Call visit( fixedValue, movingValues ) for the samples first to
+   *  last - 1, where movingValues holds the value of each moving image,
+   *  or NaN outside of it.  Moving images without an interpolator share
+   *  the fixed image's grid. */
+  template< class TVisitor >
+  void VisitSamples( SizeValueType first, SizeValueType last,
+    SizeValueType stride, const std::vector< const ImageType * > & moving,
+    const std::vector< typename InterpolatorType::Pointer > & interpolators,
+    const TVisitor & visit ) const;
+
   typename ImageType::ConstPointer            m_Input1;
   typename ImageType::ConstPointer            m_Input2;
+  std::vector< typename ImageType::ConstPointer > m_MovingImages;
   bool                                        m_UseCorrelation;
   double                                      m_SamplingRate;
+  unsigned int                                m_NumberOfHistogramBins;
   double                                      m_Output;
+  std::vector< double >                       m_Outputs;
 
 }; // End class ComputeImageSimilarityMetrics
 
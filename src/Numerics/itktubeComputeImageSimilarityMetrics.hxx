@@ -24,12 +24,13 @@ limitations under the License.
 #define __itktubeComputeImageSimilarityMetrics_hxx
 
 // ITK includes
-#include <itkIdentityTransform.h>
-#include <itkMutualInformationImageToImageMetric.h>
-#include <itkNormalizedCorrelationImageToImageMetric.h>
-#include <itkNormalizeImageFilter.h>
+#include <itkMultiThreaderBase.h>
 
-// TubeTK includes
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <mutex>
 
 namespace itk
 {
@@ -48,6 +49,126 @@ ComputeImageSimilarityMetrics< TInputImage >
   m_Input2 = NULL;
   m_SamplingRate = 0.05;
   m_UseCorrelation = false;
+  m_NumberOfHistogramBins = 32;
+  m_Output = 0;
+}
+
+template< class TInputImage >
+unsigned int
+ComputeImageSimilarityMetrics< TInputImage >
+::AddMovingImage( const ImageType * image )
+{
+  m_MovingImages.push_back( image );
+  this->Modified();
+  return m_MovingImages.size() - 1;
+}
+
+template< class TInputImage >
+void
+ComputeImageSimilarityMetrics< TInputImage >
+::ClearMovingImages( void )
+{
+  m_MovingImages.clear();
+  m_Outputs.clear();
+  this->Modified();
+}
+
+template< class TInputImage >
+unsigned int
+ComputeImageSimilarityMetrics< TInputImage >
+::GetNumberOfMovingImages( void ) const
+{
+  return m_MovingImages.size();
+}
+
+template< class TInputImage >
+SizeValueType
+ComputeImageSimilarityMetrics< TInputImage >
+::ComputeSampleOffset( SizeValueType sample, SizeValueType stride,
+  SizeValueType numberOfPixels )
+{
+  const SizeValueType first = sample * stride;
+  const SizeValueType length = std::min( stride, numberOfPixels - first );
+
+  // Mix the sample number ( splitmix64 ) so that the draw within each run
+  //   does not depend on which thread takes it
+  std::uint64_t z = static_cast< std::uint64_t >( sample )
+    + 0x9E3779B97F4A7C15ULL;
+  z = ( z ^ ( z >> 30 ) ) * 0xBF58476D1CE4E5B9ULL;
+  z = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EBULL;
+  z = z ^ ( z >> 31 );
+
+  return first + static_cast< SizeValueType >( z % length );
+}
+
+template< class TInputImage >
+void
+ComputeImageSimilarityMetrics< TInputImage >
+::MergeStatistics( const SampleStatistics & from, SampleStatistics & to )
+{
+  if( from.Count == 0 )
+    {
+    return;
+    }
+  if( to.Count == 0 )
+    {
+    to = from;
+    return;
+    }
+  const double count = to.Count + from.Count;
+  const double weight = to.Count * from.Count / count;
+  const double fixedDelta = from.FixedMean - to.FixedMean;
+  const double movingDelta = from.MovingMean - to.MovingMean;
+  to.FixedSumSq += from.FixedSumSq + fixedDelta * fixedDelta * weight;
+  to.MovingSumSq += from.MovingSumSq + movingDelta * movingDelta * weight;
+  to.CrossSum += from.CrossSum + fixedDelta * movingDelta * weight;
+  to.FixedMean += fixedDelta * from.Count / count;
+  to.MovingMean += movingDelta * from.Count / count;
+  to.Count = count;
+  to.MovingMin = std::min( to.MovingMin, from.MovingMin );
+  to.MovingMax = std::max( to.MovingMax, from.MovingMax );
+}
+
+template< class TInputImage >
+template< class TVisitor >
+void
+ComputeImageSimilarityMetrics< TInputImage >
+::VisitSamples( SizeValueType first, SizeValueType last,
+  SizeValueType stride, const std::vector< const ImageType * > & moving,
+  const std::vector< typename InterpolatorType::Pointer > & interpolators,
+  const TVisitor & visit ) const
+{
+  const ImageType * fixed = m_Input1;
+  const SizeValueType numberOfPixels =
+    fixed->GetBufferedRegion().GetNumberOfPixels();
+  const unsigned int numberOfMoving = moving.size();
+  const double outside = std::numeric_limits< double >::quiet_NaN();
+  std::vector< double > movingValues( numberOfMoving );
+  for( SizeValueType sample = first; sample < last; ++sample )
+    {
+    const SizeValueType offset = ComputeSampleOffset( sample, stride,
+      numberOfPixels );
+    typename ImageType::PointType point;
+    bool isPointComputed = false;
+    for( unsigned int m = 0; m < numberOfMoving; ++m )
+      {
+      if( interpolators[m].IsNull() )
+        {
+        movingValues[m] = moving[m]->GetBufferPointer()[ offset ];
+        continue;
+        }
+      if( !isPointComputed )
+        {
+        fixed->TransformIndexToPhysicalPoint( fixed->ComputeIndex( offset ),
+          point );
+        isPointComputed = true;
+        }
+      movingValues[m] = interpolators[m]->IsInsideBuffer( point )
+        ? interpolators[m]->Evaluate( point ) : outside;
+      }
+    visit( static_cast< double >( fixed->GetBufferPointer()[ offset ] ),
+      movingValues.data() );
+    }
 }
 
 template< class TInputImage >
@@ -55,75 +176,286 @@ void
 ComputeImageSimilarityMetrics< TInputImage >
 ::Update( void )
 {
-  // check if both input images are set
+  // check if the images are set
   if( m_Input1.IsNull() )
     {
     itkExceptionMacro( "Input Image 1 is not set" );
     }
 
-  if( m_Input1.IsNull() )
+  if( m_Input2.IsNull() && m_MovingImages.empty() )
     {
     itkExceptionMacro( "Input Image 2 is not set" );
     }
 
-  // Normalize the images
-  typedef itk::NormalizeImageFilter< ImageType, ImageType > NormFilterType;
-
-  typename NormFilterType::Pointer norm1 = NormFilterType::New();
-  norm1->SetInput( m_Input1 );
-  norm1->Update();
-
-  typename NormFilterType::Pointer norm2 = NormFilterType::New();
-  norm2->SetInput( m_Input2 );
-  norm2->Update();
-
-  // Compute similarity
-  typedef itk::ImageToImageMetric< ImageType, ImageType > MetricType;
-  typename MetricType::Pointer metric;
+  if( m_SamplingRate <= 0 )
+    {
+    itkExceptionMacro( "Sampling rate must be positive" );
+    }
 
-  typedef itk::IdentityTransform< double,
-    TInputImage::ImageDimension > TransformType;
-  typename TransformType::Pointer transform = TransformType::New();
+  std::vector< const ImageType * > moving;
+  if( m_Input2.IsNotNull() )
+    {
+    moving.push_back( m_Input2 );
+    }
+  for( unsigned int i = 0; i < m_MovingImages.size(); ++i )
+    {
+    moving.push_back( m_MovingImages[i] );
+    }
+  const unsigned int numberOfMoving = moving.size();
 
-  typedef itk::LinearInterpolateImageFunction< ImageType, double >
-    InterpolatorType;
-  typename InterpolatorType::Pointer interpolator = InterpolatorType::New();
-  interpolator->SetInputImage( norm2->GetOutput() );
+  // Moving images on the fixed image's grid are read at the fixed voxel's
+  //   offset; the others are interpolated at its physical point
+  const ImageType * fixed = m_Input1;
+  const typename ImageType::RegionType region = fixed->GetBufferedRegion();
+  std::vector< typename InterpolatorType::Pointer > interpolators(
+    numberOfMoving );
+  for( unsigned int m = 0; m < numberOfMoving; ++m )
+    {
+    if( moving[m]->GetBufferedRegion() != region
+      || moving[m]->GetOrigin() != fixed->GetOrigin()
+      || moving[m]->GetSpacing() != fixed->GetSpacing()
+      || moving[m]->GetDirection() != fixed->GetDirection() )
+      {
+      interpolators[m] = InterpolatorType::New();
+      interpolators[m]->SetInputImage( moving[m] );
+      }
+    }
 
-  if( !m_UseCorrelation )
+  // One sample per run of stride voxels
+  const SizeValueType numberOfPixels = region.GetNumberOfPixels();
+  SizeValueType stride = 1;
+  if( m_SamplingRate < 1 )
     {
-    typedef itk::MutualInformationImageToImageMetric< ImageType,
-      ImageType >                                          MIMetricType;
-    metric = MIMetricType::New();
+    stride = static_cast< SizeValueType >( 1.0 / m_SamplingRate + 0.5 );
     }
-  else
+  const SizeValueType numberOfSamples = ( numberOfPixels + stride - 1 )
+    / stride;
+  if( numberOfSamples == 0 )
     {
-    typedef itk::NormalizedCorrelationImageToImageMetric< ImageType,
-      ImageType >                                          CorMetricType;
-    metric = CorMetricType::New();
+    itkExceptionMacro( "Input Image 1 is empty" );
     }
 
-  typename ImageType::SizeType size =
-    norm1->GetOutput()->GetLargestPossibleRegion().GetSize();
+  // First pass, by blocks of samples: the centered sums for correlation,
+  //   or the ranges for mutual information.  Each block keeps its own
+  //   statistics, which are merged in block order so the result does not
+  //   depend on the number of threads.
+  const SizeValueType blockSize = 4096;
+  const SizeValueType numberOfBlocks = ( numberOfSamples + blockSize - 1 )
+    / blockSize;
+  std::vector< double > blockFixedMin( numberOfBlocks, 0 );
+  std::vector< double > blockFixedMax( numberOfBlocks, 0 );
+  std::vector< SampleStatistics > blockStatistics( numberOfBlocks
+    * numberOfMoving );
 
-  metric->SetFixedImage( norm1->GetOutput() );
-  metric->SetMovingImage( norm2->GetOutput() );
-  metric->SetFixedImageRegion(
-    norm1->GetOutput()->GetLargestPossibleRegion() );
-  metric->SetTransform( transform );
-  metric->SetInterpolator( interpolator );
-  metric->SetNumberOfSpatialSamples( size[0] * size[1] * m_SamplingRate );
-  metric->Initialize();
-  metric->MultiThreadingInitialize();
+  MultiThreaderBase::Pointer threader = MultiThreaderBase::New();
+  threader->ParallelizeArray( 0, numberOfBlocks,
+    [&]( SizeValueType block )
+      {
+      const SizeValueType first = block * blockSize;
+      const SizeValueType last = std::min( first + blockSize,
+        numberOfSamples );
+      SampleStatistics * statistics = &( blockStatistics[ block
+        * numberOfMoving ] );
+      for( unsigned int m = 0; m < numberOfMoving; ++m )
+        {
+        statistics[m].Count = 0;
+        statistics[m].FixedMean = 0;
+        statistics[m].MovingMean = 0;
+        statistics[m].FixedSumSq = 0;
+        statistics[m].MovingSumSq = 0;
+        statistics[m].CrossSum = 0;
+        statistics[m].MovingMin = 0;
+        statistics[m].MovingMax = 0;
+        }
+      double & fixedMin = blockFixedMin[ block ];
+      double & fixedMax = blockFixedMax[ block ];
+      bool isFirst = true;
+      this->VisitSamples( first, last, stride, moving, interpolators,
+        [&]( double fixedV, const double * movingValues )
+          {
+          if( isFirst || fixedV < fixedMin )
+            {
+            fixedMin = fixedV;
+            }
+          if( isFirst || fixedV > fixedMax )
+            {
+            fixedMax = fixedV;
+            }
+          isFirst = false;
+          for( unsigned int m = 0; m < numberOfMoving; ++m )
+            {
+            const double movingV = movingValues[m];
+            if( std::isnan( movingV ) )
+              {
+              continue;
+              }
+            SampleStatistics & stats = statistics[m];
+            if( stats.Count == 0 || movingV < stats.MovingMin )
+              {
+              stats.MovingMin = movingV;
+              }
+            if( stats.Count == 0 || movingV > stats.MovingMax )
+              {
+              stats.MovingMax = movingV;
+              }
+            ++stats.Count;
+            if( m_UseCorrelation )
+              {
+              const double fixedD = fixedV - stats.FixedMean;
+              const double movingD = movingV - stats.MovingMean;
+              stats.FixedMean += fixedD / stats.Count;
+              stats.MovingMean += movingD / stats.Count;
+              stats.FixedSumSq += fixedD * ( fixedV - stats.FixedMean );
+              stats.MovingSumSq += movingD * ( movingV - stats.MovingMean );
+              stats.CrossSum += fixedD * ( movingV - stats.MovingMean );
+              }
+            }
+          } );
+      }, nullptr );
 
+  double fixedMin = 0;
+  double fixedMax = 0;
+  std::vector< SampleStatistics > statistics( numberOfMoving );
+  for( SizeValueType block = 0; block < numberOfBlocks; ++block )
+    {
+    if( block == 0 || blockFixedMin[ block ] < fixedMin )
+      {
+      fixedMin = blockFixedMin[ block ];
+      }
+    if( block == 0 || blockFixedMax[ block ] > fixedMax )
+      {
+      fixedMax = blockFixedMax[ block ];
+      }
+    for( unsigned int m = 0; m < numberOfMoving; ++m )
+      {
+      if( block == 0 )
+        {
+        statistics[m] = blockStatistics[m];
+        }
+      else
+        {
+        MergeStatistics( blockStatistics[ block * numberOfMoving + m ],
+          statistics[m] );
+        }
+      }
+    }
+
+  // Second pass, for mutual information: draw the samples again and add
+  //   them to joint histograms, per work unit
+  const unsigned int numBins = std::max( m_NumberOfHistogramBins, 1u );
+  const SizeValueType histogramSize = numBins * numBins;
+  std::vector< SizeValueType > histograms;
   if( !m_UseCorrelation )
     {
-    m_Output = metric->GetValue( transform->GetParameters() );
+    histograms.assign( numberOfMoving * histogramSize, 0 );
+    const unsigned int numberOfChunks = std::max( static_cast<
+      SizeValueType >( 1 ), std::min( static_cast< SizeValueType >(
+      threader->GetNumberOfWorkUnits() ), numberOfBlocks ) );
+    const double fixedScale = ( fixedMax > fixedMin )
+      ? numBins / ( fixedMax - fixedMin ) : 0;
+    std::vector< double > movingScale( numberOfMoving, 0 );
+    for( unsigned int m = 0; m < numberOfMoving; ++m )
+      {
+      if( statistics[m].MovingMax > statistics[m].MovingMin )
+        {
+        movingScale[m] = numBins / ( statistics[m].MovingMax
+          - statistics[m].MovingMin );
+        }
+      }
+    std::mutex histogramMutex;
+
+    threader->ParallelizeArray( 0, numberOfChunks,
+      [&]( SizeValueType chunk )
+        {
+        const SizeValueType first = chunk * numberOfSamples
+          / numberOfChunks;
+        const SizeValueType last = ( chunk + 1 ) * numberOfSamples
+          / numberOfChunks;
+        std::vector< SizeValueType > threadHistograms( histograms.size(),
+          0 );
+        this->VisitSamples( first, last, stride, moving, interpolators,
+          [&]( double fixedV, const double * movingValues )
+            {
+            const unsigned int fixedBin = std::min( static_cast<
+              unsigned int >( ( fixedV - fixedMin ) * fixedScale ),
+              numBins - 1 );
+            for( unsigned int m = 0; m < numberOfMoving; ++m )
+              {
+              const double movingV = movingValues[m];
+              if( std::isnan( movingV ) )
+                {
+                continue;
+                }
+              const unsigned int movingBin = std::min( static_cast<
+                unsigned int >( ( movingV - statistics[m].MovingMin )
+                * movingScale[m] ), numBins - 1 );
+              ++threadHistograms[ m * histogramSize + fixedBin * numBins
+                + movingBin ];
+              }
+            } );
+        std::lock_guard< std::mutex > lock( histogramMutex );
+        for( SizeValueType i = 0; i < histograms.size(); ++i )
+          {
+          histograms[i] += threadHistograms[i];
+          }
+        }, nullptr );
     }
-  else
+
+  std::vector< double > similarity( numberOfMoving, 0 );
+  for( unsigned int m = 0; m < numberOfMoving; ++m )
+    {
+    if( statistics[m].Count == 0 )
+      {
+      continue;
+      }
+    if( m_UseCorrelation )
+      {
+      const SampleStatistics & stats = statistics[m];
+      if( stats.FixedSumSq > 0 && stats.MovingSumSq > 0 )
+        {
+        similarity[m] = stats.CrossSum / std::sqrt( stats.FixedSumSq
+          * stats.MovingSumSq );
+        }
+      }
+    else
+      {
+      const SizeValueType * histogram = &( histograms[ m
+        * histogramSize ] );
+      std::vector< double > fixedMarginal( numBins, 0 );
+      std::vector< double > movingMarginal( numBins, 0 );
+      for( unsigned int i = 0; i < numBins; ++i )
+        {
+        for( unsigned int j = 0; j < numBins; ++j )
+          {
+          fixedMarginal[i] += histogram[ i * numBins + j ];
+          movingMarginal[j] += histogram[ i * numBins + j ];
+          }
+        }
+      const double count = statistics[m].Count;
+      double mutualInformation = 0;
+      for( unsigned int i = 0; i < numBins; ++i )
+        {
+        for( unsigned int j = 0; j < numBins; ++j )
+          {
+          const double joint = histogram[ i * numBins + j ];
+          if( joint > 0 )
+            {
+            mutualInformation += joint / count * std::log( joint * count
+              / ( fixedMarginal[i] * movingMarginal[j] ) );
+            }
+          }
+        }
+      similarity[m] = mutualInformation;
+      }
+    }
+
+  unsigned int m = 0;
+  m_Output = 0;
+  if( m_Input2.IsNotNull() )
     {
-    m_Output = -metric->GetValue( transform->GetParameters() );
+    m_Output = similarity[ m++ ];
     }
+  m_Outputs.assign( similarity.begin() + m, similarity.end() );
 }
 
 template< class TInputImage >
@@ -134,6 +466,9 @@ ComputeImageSimilarityMetrics< TInputImage >
   Superclass::PrintSelf( os, indent );
   os << "Use Correlation: " << m_UseCorrelation << std::endl;
   os << "Sampling Rate: " << m_SamplingRate << std::endl;
+  os << "Number Of Histogram Bins: " << m_NumberOfHistogramBins
+    << std::endl;
+  os << "Number Of Moving Images: " << m_MovingImages.size() << std::endl;
 }
 
 } // End namespace tube
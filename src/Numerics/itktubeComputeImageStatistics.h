@@ -28,6 +28,9 @@ limitations under the License.
 #include <itkImage.h>
 #include <itkImageToImageFilter.h>
 
+#include <map>
+#include <vector>
+
 namespace itk
 {
 
@@ -36,6 +39,14 @@ namespace tube
 
 /** \class ComputeImageStatistics
  * \brief Computes image statistics
+ *
+ * Computes the count, mean, standard deviation, range and quantiles of the
+ * input image within each label value of the mask, for every label at
+ * once.  The image is swept by several threads, each accumulating its own
+ * statistics and histograms, which are merged at the end of each sweep:
+ * one sweep for the moments and ranges, one for the histograms and the
+ * output image, and, when quantiles are requested, one that gathers the
+ * values of the histogram bins holding them so that they are exact.
  */
 
 template< class TPixel, unsigned int VDimension >
@@ -67,10 +78,20 @@ public:
   itkSetObjectMacro( InputMask, MaskType );
   itkGetModifiableObjectMacro( InputMask, MaskType );
 
-    /** Set/Get input mask */
+  /** Set/Get quantiles */
   virtual void SetQuantiles( std::vector<float> _arg );
   itkGetMacro( Quantiles, std::vector<float> );
 
+  /** Set/Get the mask values to compute statistics for, in the order of
+   *  the components.  If empty, every mask value is a component, in order
+   *  of first appearance. */
+  virtual void SetLabels( std::vector< TPixel > _arg );
+  itkGetMacro( Labels, std::vector< TPixel > );
+
+  /** Set/Get number of histogram bins used to locate the quantiles */
+  itkSetMacro( NumberOfHistogramBins, unsigned int );
+  itkGetMacro( NumberOfHistogramBins, unsigned int );
+
   /** Get Components */
   itkGetMacro( CompMean, std::vector< double > );
   itkGetMacro( CompMin, std::vector< double > );
@@ -80,6 +101,9 @@ public:
   itkGetMacro( CompValue, std::vector< TPixel > );
   itkGetMacro( NumberOfComponents, unsigned int );
 
+  /** Get quantile values, one row per component */
+  itkGetConstReferenceMacro( QuantileValue, vnl_matrix< double > );
+
   /** Write statistics to a CSV formatted file */
   void WriteCSVStatistics( std::string csvStatisticsFile ) const;
 
@@ -96,9 +120,38 @@ protected:
 
 private:
 
+  /** Moments and range of the values of a component */
+  struct ComponentStatistics
+    {
+    double           Count;
+    double           Mean;
+    double           SumOfSquaredDeviations;
+    double           Min;
+    double           Max;
+    OffsetValueType  FirstOffset;
+    };
+
+  typedef std::map< TPixel, ComponentStatistics >  StatisticsMapType;
+
+  /** Component id of each mask value */
+  typedef std::map< TPixel, unsigned int >         ComponentMapType;
+
+  /** Add the statistics of from to those of to */
+  static void MergeStatistics( const ComponentStatistics & from,
+    ComponentStatistics & to );
+
+  /** Call visit( value, id, outputValue ) for each voxel of region, where
+   *  id is the component of the voxel, or the number of components outside
+   *  of them */
+  template< class TVisitor >
+  void VisitComponentVoxels( const typename VolumeType::RegionType & region,
+    const ComponentMapType & componentMap, const TVisitor & visit );
+
   typename MaskType::Pointer   m_InputMask;
 
   std::vector<float>           m_Quantiles;
+  std::vector< TPixel >        m_Labels;
+  unsigned int                 m_NumberOfHistogramBins;
 
   std::vector< double >         m_CompMean;
   std::vector< double >         m_CompMin;
@@ -24,11 +24,16 @@ limitations under the License.
 #define __itktubeComputeImageStatistics_hxx
 
 //ITK includes
+#include "itkImageRegionConstIterator.h"
 #include "itkImageRegionIterator.h"
 
 // TubeTK includes
 
+#include <algorithm>
+#include <cmath>
 #include <fstream>
+#include <mutex>
+#include <set>
 
 namespace itk
 {
@@ -44,6 +49,7 @@ ComputeImageStatistics< TPixel, VDimension >
 {
   m_InputMask = NULL;
   m_NumberOfComponents = 0;
+  m_NumberOfHistogramBins = 2000;
 
 }
 
@@ -59,6 +65,77 @@ ComputeImageStatistics< TPixel, VDimension >
     }
 }
 
+template< class TPixel, unsigned int VDimension >
+void
+ComputeImageStatistics< TPixel, VDimension >
+::SetLabels( const std::vector< TPixel > _arg )
+{
+  if( this->m_Labels != _arg )
+    {
+    this->m_Labels = _arg;
+    this->Modified();
+    }
+}
+
+template< class TPixel, unsigned int VDimension >
+void
+ComputeImageStatistics< TPixel, VDimension >
+::MergeStatistics( const ComponentStatistics & from,
+  ComponentStatistics & to )
+{
+  if( from.Count == 0 )
+    {
+    return;
+    }
+  if( to.Count == 0 )
+    {
+    to = from;
+    return;
+    }
+  const double count = to.Count + from.Count;
+  const double delta = from.Mean - to.Mean;
+  to.Mean += delta * from.Count / count;
+  to.SumOfSquaredDeviations += from.SumOfSquaredDeviations
+    + delta * delta * to.Count * from.Count / count;
+  to.Count = count;
+  to.Min = std::min( to.Min, from.Min );
+  to.Max = std::max( to.Max, from.Max );
+  to.FirstOffset = std::min( to.FirstOffset, from.FirstOffset );
+}
+
+template< class TPixel, unsigned int VDimension >
+template< class TVisitor >
+void
+ComputeImageStatistics< TPixel, VDimension >
+::VisitComponentVoxels( const typename VolumeType::RegionType & region,
+  const ComponentMapType & componentMap, const TVisitor & visit )
+{
+  ImageRegionConstIterator< MaskType > maskIter( m_InputMask, region );
+  ImageRegionConstIterator< VolumeType > volumeIter( this->GetInput(),
+    region );
+  ImageRegionIterator< VolumeType > outputIter( this->GetOutput(), region );
+  unsigned int id = m_NumberOfComponents;
+  TPixel lastMaskV = 0;
+  bool isFirst = true;
+  while( !maskIter.IsAtEnd() )
+    {
+    const TPixel maskV = maskIter.Get();
+    if( isFirst || maskV != lastMaskV )
+      {
+      isFirst = false;
+      lastMaskV = maskV;
+      typename ComponentMapType::const_iterator mapIter =
+        componentMap.find( maskV );
+      id = ( mapIter != componentMap.end() ) ? mapIter->second
+        : m_NumberOfComponents;
+      }
+    visit( volumeIter.Get(), id, outputIter.Value() );
+    ++maskIter;
+    ++volumeIter;
+    ++outputIter;
+    }
+}
+
 template< class TPixel, unsigned int VDimension >
 void
 ComputeImageStatistics< TPixel, VDimension >
@@ -74,196 +151,309 @@ ComputeImageStatistics< TPixel, VDimension >
     itkExceptionMacro( "Input Mask is not set" );
     }
 
-  typename ConnCompType::Pointer curConnComp = ConnCompType::New();
-  curConnComp->CopyInformation( this->GetInput() );
-  curConnComp->SetRegions( this->GetInput()->GetLargestPossibleRegion() );
-  curConnComp->Allocate();
+  const VolumeType * input = this->GetInput();
+  const typename VolumeType::RegionType region =
+    input->GetLargestPossibleRegion();
 
-  this->GetOutput()->CopyInformation( this->GetInput() );
-  this->GetOutput()->SetRegions(
-    this->GetInput()->GetLargestPossibleRegion() );
+  this->GetOutput()->CopyInformation( input );
+  this->GetOutput()->SetRegions( region );
   this->GetOutput()->Allocate();
 
-  typedef std::map< TPixel, unsigned int > MapType;
-  MapType maskMap;
+  const bool useLabels = !m_Labels.empty();
+  const std::set< TPixel > labelSet( m_Labels.begin(), m_Labels.end() );
 
-  itk::ImageRegionIterator< MaskType > maskIter( m_InputMask,
-    m_InputMask->GetLargestPossibleRegion() );
-  itk::ImageRegionIterator< ConnCompType > connCompIter( curConnComp,
-    curConnComp->GetLargestPossibleRegion() );
+  std::mutex mergeMutex;
 
-  // Calculate number of components
-  typename MapType::iterator mapIter;
-  unsigned int id = 0;
-  TPixel lastMaskV = maskIter.Get() + 1;
-  TPixel maskV = 0;
-  while( !connCompIter.IsAtEnd() )
-    {
-    maskV = maskIter.Get();
-
-    if( maskV != lastMaskV )
+  // Moments and range of every label, accumulated by each thread over its
+  //   region with Welford's updates and merged pairwise
+  StatisticsMapType statisticsMap;
+  this->GetMultiThreader()->template ParallelizeImageRegion< VDimension >(
+    region,
+    [&]( const typename VolumeType::RegionType & threadRegion )
       {
-      lastMaskV = maskV;
-      mapIter = maskMap.find( maskV );
-      if( mapIter != maskMap.end() )
-        {
-        id = mapIter->second;
-        }
-      else
+      StatisticsMapType threadMap;
+      ImageRegionConstIterator< MaskType > maskIter( m_InputMask,
+        threadRegion );
+      ImageRegionConstIterator< VolumeType > volumeIter( input,
+        threadRegion );
+      ComponentStatistics * stats = nullptr;
+      TPixel lastMaskV = 0;
+      bool isFirst = true;
+      while( !maskIter.IsAtEnd() )
         {
-        id = m_NumberOfComponents;
-        maskMap[ maskV ] = id;
-        ++m_NumberOfComponents;
+        const TPixel maskV = maskIter.Get();
+        if( isFirst || maskV != lastMaskV )
+          {
+          isFirst = false;
+          lastMaskV = maskV;
+          stats = nullptr;
+          if( !useLabels || labelSet.count( maskV ) > 0 )
+            {
+            typename StatisticsMapType::iterator mapIter =
+              threadMap.find( maskV );
+            if( mapIter == threadMap.end() )
+              {
+              ComponentStatistics newStats;
+              newStats.Count = 0;
+              newStats.Mean = 0;
+              newStats.SumOfSquaredDeviations = 0;
+              newStats.Min = 0;
+              newStats.Max = 0;
+              newStats.FirstOffset = m_InputMask->ComputeOffset(
+                maskIter.GetIndex() );
+              mapIter = threadMap.insert( std::make_pair( maskV,
+                newStats ) ).first;
+              }
+            stats = &( mapIter->second );
+            }
+          }
+        if( stats != nullptr )
+          {
+          const double volumeV = volumeIter.Get();
+          if( stats->Count == 0 )
+            {
+            stats->Min = volumeV;
+            stats->Max = volumeV;
+            }
+          else if( volumeV < stats->Min )
+            {
+            stats->Min = volumeV;
+            }
+          else if( volumeV > stats->Max )
+            {
+            stats->Max = volumeV;
+            }
+          ++stats->Count;
+          const double delta = volumeV - stats->Mean;
+          stats->Mean += delta / stats->Count;
+          stats->SumOfSquaredDeviations += delta * ( volumeV - stats->Mean );
+          }
+        ++maskIter;
+        ++volumeIter;
         }
-      }
-    ++maskIter;
-    ++connCompIter;
-    }
-
-  //Compute connected components statistics
-  m_CompMean.resize( m_NumberOfComponents, 0 );
-  m_CompMin.resize( m_NumberOfComponents, 0 );
-  m_CompMax.resize( m_NumberOfComponents, 0 );
-  m_CompStdDev.resize( m_NumberOfComponents, 0 );
-  m_CompCount.resize( m_NumberOfComponents, 0 );
-  m_CompValue.resize( m_NumberOfComponents, 0 );
-
-  maskIter.GoToBegin();
-  connCompIter.GoToBegin();
-  itk::ImageRegionConstIterator< VolumeType > volumeIter( this->GetInput(),
-    this->GetInput()->GetLargestPossibleRegion() );
-  id = 0;
-  lastMaskV = maskIter.Get() + 1;
-  maskV = 0;
-  while( !connCompIter.IsAtEnd() )
-    {
-    maskV = maskIter.Get();
 
-    if( maskV != lastMaskV )
-      {
-      lastMaskV = maskV;
-      mapIter = maskMap.find( maskV );
-      if( mapIter != maskMap.end() )
-        {
-        id = mapIter->second;
-        }
-      else
+      std::lock_guard< std::mutex > lock( mergeMutex );
+      for( typename StatisticsMapType::const_iterator threadIter =
+        threadMap.begin(); threadIter != threadMap.end(); ++threadIter )
         {
-        id = m_NumberOfComponents;
-        maskMap[ maskV ] = id;
-        m_CompValue[ id ] = maskV;
-        ++m_NumberOfComponents;
+        typename StatisticsMapType::iterator mapIter = statisticsMap.find(
+          threadIter->first );
+        if( mapIter == statisticsMap.end() )
+          {
+          statisticsMap.insert( *threadIter );
+          }
+        else
+          {
+          MergeStatistics( threadIter->second, mapIter->second );
+          }
         }
-      }
+      }, nullptr );
 
-    double volumeV = volumeIter.Get();
-    m_CompMean[ id ] += volumeV;
-    m_CompStdDev[ id ] += volumeV * volumeV;
-    if( m_CompCount[ id ] == 0 )
+  // Components are the requested labels, or every label in order of
+  //   first appearance
+  std::vector< std::pair< OffsetValueType, TPixel > > componentOrder;
+  if( useLabels )
+    {
+    for( unsigned int i=0; i<m_Labels.size(); ++i )
       {
-      m_CompMin[ id ] = volumeV;
-      m_CompMax[ id ] = volumeV;
+      componentOrder.push_back( std::make_pair( i, m_Labels[ i ] ) );
       }
-    else
+    }
+  else
+    {
+    typename StatisticsMapType::const_iterator mapIter;
+    for( mapIter = statisticsMap.begin(); mapIter != statisticsMap.end();
+      ++mapIter )
       {
-      if( volumeV < m_CompMin[ id ] )
-        {
-        m_CompMin[ id ] = volumeV;
-        }
-      else
-        {
-        if( volumeV > m_CompMax[ id ] )
-          {
-          m_CompMax[ id ] = volumeV;
-          }
-        }
+      componentOrder.push_back( std::make_pair(
+        mapIter->second.FirstOffset, mapIter->first ) );
       }
-    ++m_CompCount[ id ];
-
-    connCompIter.Set( id );
-
-    ++maskIter;
-    ++volumeIter;
-    ++connCompIter;
+    std::sort( componentOrder.begin(), componentOrder.end() );
     }
 
-  for( unsigned int i=0; i<m_NumberOfComponents; ++i )
+  m_NumberOfComponents = componentOrder.size();
+  m_CompMean.assign( m_NumberOfComponents, 0 );
+  m_CompMin.assign( m_NumberOfComponents, 0 );
+  m_CompMax.assign( m_NumberOfComponents, 0 );
+  m_CompStdDev.assign( m_NumberOfComponents, 0 );
+  m_CompCount.assign( m_NumberOfComponents, 0 );
+  m_CompValue.assign( m_NumberOfComponents, 0 );
+
+  ComponentMapType maskMap;
+  for( unsigned int id=0; id<m_NumberOfComponents; ++id )
     {
-    if( m_CompCount[ i ] > 0 )
+    const TPixel maskV = componentOrder[ id ].second;
+    maskMap[ maskV ] = id;
+    m_CompValue[ id ] = maskV;
+    typename StatisticsMapType::const_iterator mapIter =
+      statisticsMap.find( maskV );
+    if( mapIter != statisticsMap.end() && mapIter->second.Count > 0 )
       {
-      m_CompStdDev[ i ] = std::sqrt( ( m_CompStdDev[ i ]
-        - ( ( m_CompMean[ i ] * m_CompMean[ i ] ) / m_CompCount[ i ] ) )
-        / ( m_CompCount[ i ] - 1 ) );
-      m_CompMean[ i ] /= m_CompCount[ i ];
+      const ComponentStatistics & stats = mapIter->second;
+      m_CompCount[ id ] = stats.Count;
+      m_CompMean[ id ] = stats.Mean;
+      m_CompMin[ id ] = stats.Min;
+      m_CompMax[ id ] = stats.Max;
+      if( stats.Count > 1 )
+        {
+        m_CompStdDev[ id ] = std::sqrt( stats.SumOfSquaredDeviations
+          / ( stats.Count - 1 ) );
+        }
       }
     }
 
-  //Compute components histogram
-  unsigned int maxNumBins = 2000;
-  vnl_matrix< unsigned int > compHisto( m_NumberOfComponents, maxNumBins );
-  compHisto.fill( 0 );
-
-  maskIter.GoToBegin();
-  volumeIter.GoToBegin();
-  while( !volumeIter.IsAtEnd() )
+  // Bin of a value within the range of its component, as used to locate
+  //   the quantiles
+  const unsigned int numberOfQuantiles = m_Quantiles.size();
+  const unsigned int numBins = std::max( m_NumberOfHistogramBins, 1u );
+  auto computeBin = [&]( double volumeV, unsigned int id ) -> unsigned int
     {
-    maskV = maskIter.Get();
-    mapIter = maskMap.find( maskV );
-    id = mapIter->second;
-    int bin = static_cast< int >( ( ( volumeIter.Get() -
-      m_CompMin[id] ) /
-      ( m_CompMax[id] - m_CompMin[id] ) ) * maxNumBins + 0.5 );
+    int bin = static_cast< int >( ( ( volumeV - m_CompMin[ id ] ) /
+      ( m_CompMax[ id ] - m_CompMin[ id ] ) ) * numBins + 0.5 );
     if( bin < 0 )
       {
       bin = 0;
       }
-    else if( bin >= static_cast< int >( maxNumBins ) )
+    else if( bin >= static_cast< int >( numBins ) )
       {
-      bin = maxNumBins - 1;
+      bin = numBins - 1;
       }
-    ++compHisto[id][bin];
-    ++maskIter;
-    ++volumeIter;
-    }
+    return bin;
+    };
 
-  //Compute quantile value
-  unsigned int numberOfQuantiles = m_Quantiles.size();
-  m_QuantileValue.set_size( m_NumberOfComponents,
-    numberOfQuantiles );
-  for( unsigned int quantileNumber=0; quantileNumber<numberOfQuantiles;
-    ++quantileNumber )
+  // Output image and, for the quantiles, per-thread histograms
+  std::vector< SizeValueType > compHisto;
+  if( numberOfQuantiles > 0 )
     {
-    double quant = m_Quantiles[ quantileNumber ];
-    for( unsigned int comp=0; comp<m_NumberOfComponents; ++comp )
+    compHisto.assign( m_NumberOfComponents * numBins, 0 );
+    }
+  this->GetMultiThreader()->template ParallelizeImageRegion< VDimension >(
+    region,
+    [&]( const typename VolumeType::RegionType & threadRegion )
       {
-      unsigned int targetCount = static_cast< unsigned int >( quant *
-        m_CompCount[ comp ] );
+      std::vector< SizeValueType > threadHisto( compHisto.size(), 0 );
+      this->VisitComponentVoxels( threadRegion, maskMap,
+        [&]( double volumeV, unsigned int id, float & outputV )
+          {
+          if( id == m_NumberOfComponents )
+            {
+            outputV = 0;
+            return;
+            }
+          outputV = m_CompMean[ id ];
+          if( !threadHisto.empty() && m_CompMax[ id ] > m_CompMin[ id ] )
+            {
+            ++threadHisto[ id * numBins + computeBin( volumeV, id ) ];
+            }
+          } );
+      if( !threadHisto.empty() )
+        {
+        std::lock_guard< std::mutex > lock( mergeMutex );
+        for( SizeValueType i=0; i<compHisto.size(); ++i )
+          {
+          compHisto[ i ] += threadHisto[ i ];
+          }
+        }
+      }, nullptr );
+
+  // Rank of each quantile, and the bin that holds it
+  m_QuantileValue.set_size( m_NumberOfComponents, numberOfQuantiles );
+  m_QuantileValue.fill( 0 );
+  std::vector< int > binSlot;
+  std::vector< std::vector< double > > slotValues;
+  std::vector< unsigned int > requestSlot( m_NumberOfComponents
+    * numberOfQuantiles, 0 );
+  std::vector< SizeValueType > requestRank( m_NumberOfComponents
+    * numberOfQuantiles, 0 );
+  if( numberOfQuantiles > 0 )
+    {
+    binSlot.assign( m_NumberOfComponents * numBins, -1 );
+    }
+  for( unsigned int comp=0; comp<m_NumberOfComponents; ++comp )
+    {
+    const SizeValueType count = static_cast< SizeValueType >(
+      m_CompCount[ comp ] );
+    for( unsigned int quantileNumber=0; quantileNumber<numberOfQuantiles;
+      ++quantileNumber )
+      {
+      if( count == 0 || m_CompMax[ comp ] <= m_CompMin[ comp ] )
+        {
+        m_QuantileValue[ comp ][ quantileNumber ] = m_CompMin[ comp ];
+        continue;
+        }
+      SizeValueType targetCount = static_cast< SizeValueType >( std::max(
+        0.0, m_Quantiles[ quantileNumber ] * m_CompCount[ comp ] ) );
+      targetCount = std::min( targetCount, count - 1 );
       unsigned int bin = 0;
-      unsigned int binCount = 0;
-      while( binCount + compHisto[ comp ][ bin ] < targetCount )
+      SizeValueType binCount = 0;
+      while( binCount + compHisto[ comp * numBins + bin ] <= targetCount )
         {
-        binCount += compHisto[ comp ][ bin ];
+        binCount += compHisto[ comp * numBins + bin ];
         ++bin;
         }
-      double binPortion = static_cast< double >( targetCount - binCount )
-        / compHisto[ comp ][ bin ];
-      double binSize = ( m_CompMax[ comp ] - m_CompMin[ comp ] ) / maxNumBins;
-      m_QuantileValue[ comp ][ quantileNumber ] = ( bin + binPortion )
-        * binSize + m_CompMin[ comp ];
+      int & slot = binSlot[ comp * numBins + bin ];
+      if( slot < 0 )
+        {
+        slot = slotValues.size();
+        slotValues.push_back( std::vector< double >() );
+        }
+      requestSlot[ comp * numberOfQuantiles + quantileNumber ] = slot;
+      requestRank[ comp * numberOfQuantiles + quantileNumber ] =
+        targetCount - binCount;
       }
     }
 
-  //Set output image
-  itk::ImageRegionIterator< VolumeType > outputVolumeIter( this->GetOutput(),
-    this->GetOutput()->GetLargestPossibleRegion() );
-  connCompIter.GoToBegin();
-  outputVolumeIter.GoToBegin();
-  while( !connCompIter.IsAtEnd() )
+  // Exact quantiles: gather the values of the bins that hold them, and
+  //   select their rank within the bin
+  if( !slotValues.empty() )
     {
-    id = connCompIter.Get();
-    outputVolumeIter.Set( m_CompMean[ id ] );
-    ++connCompIter;
-    ++outputVolumeIter;
+    this->GetMultiThreader()->template ParallelizeImageRegion< VDimension >(
+      region,
+      [&]( const typename VolumeType::RegionType & threadRegion )
+        {
+        std::vector< std::vector< double > > threadValues(
+          slotValues.size() );
+        this->VisitComponentVoxels( threadRegion, maskMap,
+          [&]( double volumeV, unsigned int id, float & )
+            {
+            if( id == m_NumberOfComponents
+              || m_CompMax[ id ] <= m_CompMin[ id ] )
+              {
+              return;
+              }
+            const int slot = binSlot[ id * numBins
+              + computeBin( volumeV, id ) ];
+            if( slot >= 0 )
+              {
+              threadValues[ slot ].push_back( volumeV );
+              }
+            } );
+        std::lock_guard< std::mutex > lock( mergeMutex );
+        for( unsigned int slot=0; slot<slotValues.size(); ++slot )
+          {
+          slotValues[ slot ].insert( slotValues[ slot ].end(),
+            threadValues[ slot ].begin(), threadValues[ slot ].end() );
+          }
+        }, nullptr );
+
+    for( unsigned int comp=0; comp<m_NumberOfComponents; ++comp )
+      {
+      if( m_CompCount[ comp ] == 0 || m_CompMax[ comp ] <= m_CompMin[ comp ] )
+        {
+        continue;
+        }
+      for( unsigned int quantileNumber=0; quantileNumber<numberOfQuantiles;
+        ++quantileNumber )
+        {
+        const unsigned int request = comp * numberOfQuantiles
+          + quantileNumber;
+        std::vector< double > & values = slotValues[ requestSlot[ request ] ];
+        typename std::vector< double >::iterator nth = values.begin()
+          + requestRank[ request ];
+        std::nth_element( values.begin(), nth, values.end() );
+        m_QuantileValue[ comp ][ quantileNumber ] = *nth;
+        }
+      }
     }
 }
 
@@ -347,6 +537,12 @@ ComputeImageStatistics< TPixel, VDimension >
 ::PrintSelf( std::ostream & os, Indent indent ) const
 {
   Superclass::PrintSelf( os, indent );
+
+  os << indent << "NumberOfLabels: " << m_Labels.size() << std::endl;
+  os << indent << "NumberOfHistogramBins: " << m_NumberOfHistogramBins
+    << std::endl;
+  os << indent << "NumberOfComponents: " << m_NumberOfComponents
+    << std::endl;
 }
 
 } // End namespace tube
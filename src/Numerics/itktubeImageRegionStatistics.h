@@ -0,0 +1,132 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright Kitware Inc.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#ifndef __itktubeImageRegionStatistics_h
+#define __itktubeImageRegionStatistics_h
+
+#include <itkImage.h>
+#include <itkObject.h>
+#include <itkObjectFactory.h>
+
+#include <atomic>
+#include <mutex>
+
+namespace itk
+{
+
+namespace tube
+{
+
+/** \class ImageRegionStatistics
+ * \brief Intensity range of an image, restricted to a region and computed
+ * only when first requested.
+ *
+ * One instance can be shared by the several objects that need the range
+ * of the same image, e.g., the ridge and radius extractors of a
+ * TubeExtractor and their image functions, so the image is scanned at
+ * most once per change of the region.  Setting the image or a different
+ * region invalidates the statistics and updates the modification time,
+ * which is how the objects sharing an instance notice the change.
+ *
+ * The statistics may be requested from several threads at once.
+ */
+template< class TImage >
+class ImageRegionStatistics : public Object
+{
+public:
+
+  typedef ImageRegionStatistics        Self;
+  typedef Object                       Superclass;
+  typedef SmartPointer< Self >         Pointer;
+  typedef SmartPointer< const Self >   ConstPointer;
+
+  itkNewMacro( Self );
+
+  itkTypeMacro( ImageRegionStatistics, Object );
+
+  itkStaticConstMacro( ImageDimension, unsigned int,
+    TImage::ImageDimension );
+
+  typedef TImage                              ImageType;
+  typedef typename ImageType::IndexType       IndexType;
+  typedef typename ImageType::RegionType      RegionType;
+
+  /** Set the image.  The region is reset to its largest possible region. */
+  void SetInputImage( const ImageType * image );
+  itkGetConstObjectMacro( InputImage, ImageType );
+
+  /** Restrict the statistics to a region.  The region is cropped to the
+   *  largest possible region of the image. */
+  void SetRegion( const RegionType & region );
+
+  /** Restrict the statistics to the region between two corners, both
+   *  included */
+  void SetRegion( const IndexType & minIndex, const IndexType & maxIndex );
+
+  itkGetConstReferenceMacro( Region, RegionType );
+
+  /** Compute the statistics, unless they are up to date */
+  void Compute( void ) const;
+
+  /** Return the minimum over the region, computing it if needed */
+  double GetMinimum( void ) const;
+
+  /** Return the maximum over the region, computing it if needed */
+  double GetMaximum( void ) const;
+
+  /** Number of times the region was scanned */
+  unsigned int GetNumberOfComputations( void ) const;
+
+protected:
+
+  ImageRegionStatistics( void );
+  virtual ~ImageRegionStatistics( void );
+
+  void PrintSelf( std::ostream & os, Indent indent ) const override;
+
+private:
+
+  ImageRegionStatistics( const Self & );
+  void operator=( const Self & );
+
+  void Invalidate( void );
+
+  typename ImageType::ConstPointer   m_InputImage;
+  RegionType                         m_Region;
+
+  mutable std::mutex                 m_Mutex;
+  mutable std::atomic< bool >        m_Valid;
+  mutable double                     m_Minimum;
+  mutable double                     m_Maximum;
+  mutable unsigned int               m_NumberOfComputations;
+
+}; // End class ImageRegionStatistics
+
+} // End namespace tube
+
+} // End namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itktubeImageRegionStatistics.hxx"
+#endif
+
+#endif // End !defined( __itktubeImageRegionStatistics_h )
@@ -0,0 +1,208 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright Kitware Inc.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#ifndef __itktubeImageRegionStatistics_hxx
+#define __itktubeImageRegionStatistics_hxx
+
+#include "itktubeImageRegionStatistics.h"
+
+#include <itkImageRegionConstIterator.h>
+
+namespace itk
+{
+
+namespace tube
+{
+
+template< class TImage >
+ImageRegionStatistics< TImage >
+::ImageRegionStatistics( void )
+{
+  m_InputImage = nullptr;
+  m_Valid = false;
+  m_Minimum = 0;
+  m_Maximum = 0;
+  m_NumberOfComputations = 0;
+}
+
+template< class TImage >
+ImageRegionStatistics< TImage >
+::~ImageRegionStatistics( void )
+{
+}
+
+template< class TImage >
+void
+ImageRegionStatistics< TImage >
+::Invalidate( void )
+{
+  std::lock_guard< std::mutex > lock( m_Mutex );
+  m_Valid = false;
+  this->Modified();
+}
+
+template< class TImage >
+void
+ImageRegionStatistics< TImage >
+::SetInputImage( const ImageType * image )
+{
+  m_InputImage = image;
+  if( m_InputImage )
+    {
+    m_Region = m_InputImage->GetLargestPossibleRegion();
+    }
+  else
+    {
+    m_Region = RegionType();
+    }
+  this->Invalidate();
+}
+
+template< class TImage >
+void
+ImageRegionStatistics< TImage >
+::SetRegion( const RegionType & region )
+{
+  RegionType cropped = region;
+  if( m_InputImage )
+    {
+    if( !cropped.Crop( m_InputImage->GetLargestPossibleRegion() ) )
+      {
+      cropped = RegionType();
+      }
+    }
+  if( cropped != m_Region )
+    {
+    m_Region = cropped;
+    this->Invalidate();
+    }
+}
+
+template< class TImage >
+void
+ImageRegionStatistics< TImage >
+::SetRegion( const IndexType & minIndex, const IndexType & maxIndex )
+{
+  RegionType region;
+  region.SetIndex( minIndex );
+  for( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+    if( maxIndex[i] < minIndex[i] )
+      {
+      this->SetRegion( RegionType() );
+      return;
+      }
+    region.SetSize( i, maxIndex[i] - minIndex[i] + 1 );
+    }
+  this->SetRegion( region );
+}
+
+template< class TImage >
+void
+ImageRegionStatistics< TImage >
+::Compute( void ) const
+{
+  if( m_Valid )
+    {
+    return;
+    }
+
+  std::lock_guard< std::mutex > lock( m_Mutex );
+  if( m_Valid )
+    {
+    return;
+    }
+
+  m_Minimum = 0;
+  m_Maximum = 0;
+  if( m_InputImage && m_Region.GetNumberOfPixels() > 0 )
+    {
+    ImageRegionConstIterator< ImageType > it( m_InputImage, m_Region );
+    m_Minimum = it.Get();
+    m_Maximum = it.Get();
+    ++it;
+    while( !it.IsAtEnd() )
+      {
+      const double val = it.Get();
+      if( val < m_Minimum )
+        {
+        m_Minimum = val;
+        }
+      else if( val > m_Maximum )
+        {
+        m_Maximum = val;
+        }
+      ++it;
+      }
+    }
+  ++m_NumberOfComputations;
+  m_Valid = true;
+}
+
+template< class TImage >
+double
+ImageRegionStatistics< TImage >
+::GetMinimum( void ) const
+{
+  this->Compute();
+  return m_Minimum;
+}
+
+template< class TImage >
+double
+ImageRegionStatistics< TImage >
+::GetMaximum( void ) const
+{
+  this->Compute();
+  return m_Maximum;
+}
+
+template< class TImage >
+unsigned int
+ImageRegionStatistics< TImage >
+::GetNumberOfComputations( void ) const
+{
+  std::lock_guard< std::mutex > lock( m_Mutex );
+  return m_NumberOfComputations;
+}
+
+template< class TImage >
+void
+ImageRegionStatistics< TImage >
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "InputImage = " << m_InputImage.GetPointer() << std::endl;
+  os << indent << "Region = " << m_Region << std::endl;
+  os << indent << "Valid = " << m_Valid << std::endl;
+  os << indent << "Minimum = " << m_Minimum << std::endl;
+  os << indent << "Maximum = " << m_Maximum << std::endl;
+  os << indent << "NumberOfComputations = " << m_NumberOfComputations
+    << std::endl;
+}
+
+} // End namespace tube
+
+} // End namespace itk
+
+#endif // End !defined( __itktubeImageRegionStatistics_hxx )
@@ -27,6 +27,8 @@ limitations under the License.
 #include <itkImage.h>
 #include <itkImageFunction.h>
 
+#include <vector>
+
 namespace itk
 {
 
@@ -41,6 +43,16 @@ namespace tube
  *  in a joint-histogram. That mean and standard deviation is used to compute
  *  the Z-Score at a point when Evaluate is called. The neighborhood used in
  *  the computation of the joint histogram is determined by the feature width.
+ *
+ *  PrecomputeAtIndices and EvaluateAtIndices process a list of indices
+ *  concurrently.  Each thread keeps the joint histogram of its current
+ *  neighborhood and, when the next index only moves that neighborhood
+ *  along the first dimension ( as consecutive indices of a scan line do ),
+ *  updates it by the slabs that leave and enter the neighborhood instead
+ *  of visiting the whole neighborhood again.  Precomputing threads
+ *  accumulate into their own sums, which are merged at the end.  When
+ *  UseSparseHistograms is set, those histograms and sums only store their
+ *  non-zero bins, which saves memory and time for large histogram sizes.
  */
 template< class TInputImage, class TCoordRep = float >
 class JointHistogramImageFunction
@@ -156,6 +168,10 @@ public:
   itkSetMacro( ForceDiagonalHistogram, bool );
   itkGetMacro( ForceDiagonalHistogram, bool );
 
+  /** Set/Get if PrecomputeAtIndices stores only the non-zero bins */
+  itkSetMacro( UseSparseHistograms, bool );
+  itkGetMacro( UseSparseHistograms, bool );
+
   // setmeanhistogram
   // setstandardeviationhistogram
 
@@ -165,6 +181,18 @@ public:
    */
   virtual void PrecomputeAtIndex( const IndexType & index );
 
+  /**
+   * Add histograms ( based on each index of a list ) to the internals used
+   * to calculate the mean and standard deviation histograms when needed.
+   * Indices are processed concurrently.
+   */
+  virtual void PrecomputeAtIndices( const std::vector< IndexType > &
+    indices );
+
+  /** Get the Z-score at each index of a list, computed concurrently. */
+  virtual void EvaluateAtIndices( const std::vector< IndexType > & indices,
+    std::vector< double > & zScores ) const;
+
   /**
    * Compute the mean and standard deviation histograms for use in Z-score
    * calculation.
@@ -188,6 +216,42 @@ protected:
   /** Get the Z-score at a given index. */
   double ComputeZScoreAtIndex( const IndexType & index ) const;
 
+  typedef typename InputImageType::RegionType           RegionType;
+
+  /** Allocate a histogram filled with zeros. */
+  typename HistogramType::Pointer CreateHistogram( void ) const;
+
+  /** Neighborhood of an index, cropped to the mask. */
+  RegionType ComputeNeighborhoodRegion( const IndexType & index ) const;
+
+  /** Offset, in a histogram's buffer, of the bin of a pair of values. */
+  SizeValueType ComputeBin( double imageValue, double maskValue ) const;
+
+  /** Call count( bin, weight ) for every voxel of a region. */
+  template< class TCountFunction >
+  void CountRegion( const RegionType & region, double weight,
+    TCountFunction count ) const;
+
+  /**
+   * Move a neighborhood to an index.  If the neighborhood only moves along
+   * the first dimension, count( bin, -1 ) and count( bin, 1 ) are called
+   * for the voxels that leave and enter it; otherwise clear() is called
+   * and the new neighborhood is counted.
+   */
+  template< class TCountFunction, class TClearFunction >
+  void MoveNeighborhood( const IndexType & index, RegionType & region,
+    bool & isRegionValid, TCountFunction count, TClearFunction clear ) const;
+
+  /** Blurred copy of a histogram. */
+  typename HistogramType::Pointer BlurHistogram( HistogramType * hist,
+    bool isThreaded ) const;
+
+  /** Shift each row of a histogram to center its maximum. */
+  void ForceDiagonal( HistogramType * hist ) const;
+
+  /** Get the Z-score of a blurred histogram. */
+  double ComputeZScore( const HistogramType * hist ) const;
+
   /** Data members **/
   typename InputImageType::Pointer         m_InputMask;
   mutable typename HistogramType::Pointer  m_Histogram;
@@ -208,6 +272,7 @@ protected:
   double                                   m_MaskStep;
 
   bool                                     m_ForceDiagonalHistogram;
+  bool                                     m_UseSparseHistograms;
 
 private:
   JointHistogramImageFunction( const Self & ); // Purposely not implemented
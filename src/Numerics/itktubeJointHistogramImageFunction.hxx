@@ -33,6 +33,11 @@ limitations under the License.
 #include <itkSqrtImageFilter.h>
 #include <itkSquareImageFilter.h>
 #include <itkSubtractImageFilter.h>
+#include <itkMultiThreaderBase.h>
+
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
 
 namespace itk
 {
@@ -64,6 +69,7 @@ JointHistogramImageFunction<TInputImage, TCoordRep>
   m_MaskMax = 0;
   m_MaskStep = 0;
   m_ForceDiagonalHistogram = false;
+  m_UseSparseHistograms = false;
   m_HistogramSize = 40;
 
   this->SetHistogramSize( m_HistogramSize );
@@ -198,6 +204,214 @@ JointHistogramImageFunction<TInputImage, TCoordRep>
   ++m_NumberOfSamples;
 }
 
+template< class TInputImage, class TCoordRep >
+void
+JointHistogramImageFunction<TInputImage, TCoordRep>
+::PrecomputeAtIndices( const std::vector< IndexType > & indices )
+{
+  if( indices.empty() )
+    {
+    return;
+    }
+
+  const SizeValueType numberOfBins = m_HistogramSize * m_HistogramSize;
+  float * sumBuffer = m_SumHistogram->GetBufferPointer();
+  float * sumOfSquaresBuffer = m_SumOfSquaresHistogram->GetBufferPointer();
+  std::mutex sumMutex;
+
+  MultiThreaderBase::Pointer threader = MultiThreaderBase::New();
+  const SizeValueType numberOfChunks = std::min( static_cast<
+    SizeValueType >( threader->GetNumberOfWorkUnits() ),
+    static_cast< SizeValueType >( indices.size() ) );
+  threader->ParallelizeArray( 0, numberOfChunks,
+    [&]( SizeValueType chunk )
+      {
+      const SizeValueType first = chunk * indices.size() / numberOfChunks;
+      const SizeValueType last = ( chunk + 1 ) * indices.size()
+        / numberOfChunks;
+
+      RegionType region;
+      bool isRegionValid = false;
+      typename HistogramType::Pointer hist;
+      float * histBuffer = nullptr;
+      if( m_ForceDiagonalHistogram )
+        {
+        hist = this->CreateHistogram();
+        histBuffer = hist->GetBufferPointer();
+        }
+
+      if( !m_UseSparseHistograms )
+        {
+        std::vector< double > counts( numberOfBins, 0 );
+        std::vector< double > sums( numberOfBins, 0 );
+        std::vector< double > sumsOfSquares( numberOfBins, 0 );
+        for( SizeValueType i = first; i < last; ++i )
+          {
+          this->MoveNeighborhood( indices[i], region, isRegionValid,
+            [&]( SizeValueType bin, double weight )
+              {
+              counts[bin] += weight;
+              },
+            [&]()
+              {
+              std::fill( counts.begin(), counts.end(), 0 );
+              } );
+          if( m_ForceDiagonalHistogram )
+            {
+            std::copy( counts.begin(), counts.end(), histBuffer );
+            this->ForceDiagonal( hist );
+            }
+          for( SizeValueType bin = 0; bin < numberOfBins; ++bin )
+            {
+            const double tf = ( histBuffer != nullptr ) ? histBuffer[bin]
+              : counts[bin];
+            sums[bin] += tf;
+            sumsOfSquares[bin] += tf * tf;
+            }
+          }
+
+        std::lock_guard< std::mutex > lock( sumMutex );
+        for( SizeValueType bin = 0; bin < numberOfBins; ++bin )
+          {
+          sumBuffer[bin] += sums[bin];
+          sumOfSquaresBuffer[bin] += sumsOfSquares[bin];
+          }
+        }
+      else
+        {
+        typedef std::unordered_map< SizeValueType, double > CountMapType;
+        typedef std::unordered_map< SizeValueType,
+          std::pair< double, double > >                      SumMapType;
+        CountMapType counts;
+        SumMapType sums;
+        for( SizeValueType i = first; i < last; ++i )
+          {
+          this->MoveNeighborhood( indices[i], region, isRegionValid,
+            [&]( SizeValueType bin, double weight )
+              {
+              double & count = counts[bin];
+              count += weight;
+              if( count == 0 )
+                {
+                counts.erase( bin );
+                }
+              },
+            [&]()
+              {
+              counts.clear();
+              } );
+          if( m_ForceDiagonalHistogram )
+            {
+            hist->FillBuffer( 0 );
+            for( typename CountMapType::const_iterator iter = counts.begin();
+              iter != counts.end(); ++iter )
+              {
+              histBuffer[ iter->first ] = iter->second;
+              }
+            this->ForceDiagonal( hist );
+            for( SizeValueType bin = 0; bin < numberOfBins; ++bin )
+              {
+              const double tf = histBuffer[bin];
+              if( tf != 0 )
+                {
+                std::pair< double, double > & sum = sums[bin];
+                sum.first += tf;
+                sum.second += tf * tf;
+                }
+              }
+            }
+          else
+            {
+            for( typename CountMapType::const_iterator iter = counts.begin();
+              iter != counts.end(); ++iter )
+              {
+              std::pair< double, double > & sum = sums[ iter->first ];
+              sum.first += iter->second;
+              sum.second += iter->second * iter->second;
+              }
+            }
+          }
+
+        std::lock_guard< std::mutex > lock( sumMutex );
+        for( typename SumMapType::const_iterator iter = sums.begin();
+          iter != sums.end(); ++iter )
+          {
+          sumBuffer[ iter->first ] += iter->second.first;
+          sumOfSquaresBuffer[ iter->first ] += iter->second.second;
+          }
+        }
+      }, nullptr );
+
+  m_NumberOfSamples += indices.size();
+}
+
+template< class TInputImage, class TCoordRep >
+void
+JointHistogramImageFunction<TInputImage, TCoordRep>
+::EvaluateAtIndices( const std::vector< IndexType > & indices,
+  std::vector< double > & zScores ) const
+{
+  zScores.assign( indices.size(), 0 );
+  if( indices.empty() )
+    {
+    return;
+    }
+
+  try
+    {
+    if( m_NumberOfComputedSamples < m_NumberOfSamples )
+      {
+      this->ComputeMeanAndStandardDeviation();
+      m_NumberOfComputedSamples = m_NumberOfSamples;
+      }
+
+    const SizeValueType numberOfBins = m_HistogramSize * m_HistogramSize;
+
+    MultiThreaderBase::Pointer threader = MultiThreaderBase::New();
+    const SizeValueType numberOfChunks = std::min( static_cast<
+      SizeValueType >( threader->GetNumberOfWorkUnits() ),
+      static_cast< SizeValueType >( indices.size() ) );
+    threader->ParallelizeArray( 0, numberOfChunks,
+      [&]( SizeValueType chunk )
+        {
+        const SizeValueType first = chunk * indices.size() / numberOfChunks;
+        const SizeValueType last = ( chunk + 1 ) * indices.size()
+          / numberOfChunks;
+
+        RegionType region;
+        bool isRegionValid = false;
+        std::vector< double > counts( numberOfBins, 0 );
+        typename HistogramType::Pointer hist = this->CreateHistogram();
+        for( SizeValueType i = first; i < last; ++i )
+          {
+          this->MoveNeighborhood( indices[i], region, isRegionValid,
+            [&]( SizeValueType bin, double weight )
+              {
+              counts[bin] += weight;
+              },
+            [&]()
+              {
+              std::fill( counts.begin(), counts.end(), 0 );
+              } );
+          std::copy( counts.begin(), counts.end(),
+            hist->GetBufferPointer() );
+          typename HistogramType::Pointer blurredHist =
+            this->BlurHistogram( hist, false );
+          if( m_ForceDiagonalHistogram )
+            {
+            this->ForceDiagonal( blurredHist );
+            }
+          zScores[i] = this->ComputeZScore( blurredHist );
+          }
+        }, nullptr );
+    }
+  catch( itk::ExceptionObject & e )
+    {
+    std::cerr << "Exception thrown: " << e << std::endl;
+    zScores.assign( indices.size(), 0 );
+    }
+}
+
 template< class TInputImage, class TCoordRep >
 void
 JointHistogramImageFunction<TInputImage, TCoordRep>
@@ -281,6 +495,8 @@ JointHistogramImageFunction<TInputImage, TCoordRep>
   os << indent << "m_MaskMax = " << m_MaskMax << std::endl;
   os << indent << "m_MaskStep = " << m_MaskStep << std::endl;
   os << indent << "m_ForceDiagonalHistogram = " << m_MaskStep << std::endl;
+  os << indent << "m_UseSparseHistograms = " << m_UseSparseHistograms
+     << std::endl;
 }
 
 template< class TInputImage, class TCoordRep >
@@ -291,6 +507,14 @@ JointHistogramImageFunction<TInputImage, TCoordRep>
   typename HistogramType::Pointer hist;
   hist = this->ComputeHistogramAtIndex( index, true );
 
+  return this->ComputeZScore( hist );
+}
+
+template< class TInputImage, class TCoordRep >
+double
+JointHistogramImageFunction<TInputImage, TCoordRep>
+::ComputeZScore( const HistogramType * hist ) const
+{
   typedef itk::ImageRegionConstIterator<HistogramType>  HistIteratorType;
   HistIteratorType histItr( hist, hist->GetLargestPossibleRegion() );
   HistIteratorType meanItr( m_MeanHistogram,
@@ -327,14 +551,22 @@ JointHistogramImageFunction<TInputImage, TCoordRep>
 }
 
 template< class TInputImage, class TCoordRep >
-itk::Image<float, 2>::Pointer &
+itk::Image<float, 2>::Pointer
 JointHistogramImageFunction<TInputImage, TCoordRep>
-::ComputeHistogramAtIndex( const IndexType & index, bool blur ) const
+::CreateHistogram( void ) const
 {
-  m_Histogram->FillBuffer( 0 );
-
-  typedef itk::ImageRegionConstIterator<InputImageType> ConstIteratorType;
+  typename HistogramType::Pointer hist = HistogramType::New();
+  hist->SetRegions( m_Histogram->GetLargestPossibleRegion() );
+  hist->Allocate();
+  hist->FillBuffer( 0 );
+  return hist;
+}
 
+template< class TInputImage, class TCoordRep >
+typename JointHistogramImageFunction<TInputImage, TCoordRep>::RegionType
+JointHistogramImageFunction<TInputImage, TCoordRep>
+::ComputeNeighborhoodRegion( const IndexType & index ) const
+{
   typename InputImageType::IndexType minIndex;
   typename InputImageType::IndexType maxIndex;
   minIndex = m_InputMask->GetLargestPossibleRegion().GetIndex();
@@ -344,7 +576,7 @@ JointHistogramImageFunction<TInputImage, TCoordRep>
     maxIndex[i] -= 1;
     }
 
-  typename InputImageType::RegionType region;
+  RegionType region;
   IndexType origin;
   typename InputImageType::SizeType size;
   for( unsigned int i = 0; i < ImageDimension; ++i )
@@ -369,114 +601,228 @@ JointHistogramImageFunction<TInputImage, TCoordRep>
   region.SetSize( size );
   region.SetIndex( origin );
 
+  return region;
+}
+
+template< class TInputImage, class TCoordRep >
+SizeValueType
+JointHistogramImageFunction<TInputImage, TCoordRep>
+::ComputeBin( double imageValue, double maskValue ) const
+{
+  typename HistogramType::IndexType cur;
+  cur[0] = ( ( imageValue - m_ImageMin ) / m_ImageStep );
+  cur[1] = ( ( maskValue - m_MaskMin ) / m_MaskStep );
+  if( cur[0] > ( int )( m_HistogramSize ) - 1 )
+    {
+    cur[0] = ( int )( m_HistogramSize ) - 1;
+    }
+  if( cur[1] > ( int )( m_HistogramSize ) - 1 )
+    {
+    cur[1] = ( int )( m_HistogramSize ) - 1;
+    }
+  if( cur[0] < 0 )
+    {
+    cur[0] = 0;
+    }
+  if( cur[1] < 0 )
+    {
+    cur[1] = 0;
+    }
+
+  return cur[1] * m_HistogramSize + cur[0];
+}
+
+template< class TInputImage, class TCoordRep >
+template< class TCountFunction >
+void
+JointHistogramImageFunction<TInputImage, TCoordRep>
+::CountRegion( const RegionType & region, double weight,
+  TCountFunction count ) const
+{
+  typedef itk::ImageRegionConstIterator<InputImageType> ConstIteratorType;
+
   ConstIteratorType inputItr( this->GetInputImage(), region );
   ConstIteratorType maskItr( m_InputMask, region );
   while( !inputItr.IsAtEnd() )
     {
-    typename HistogramType::IndexType cur;
-    cur[0] = ( ( inputItr.Get() - m_ImageMin ) / m_ImageStep );
-    cur[1] = ( ( maskItr.Get() - m_MaskMin ) / m_MaskStep );
-    if( cur[0] > ( int )( m_HistogramSize ) - 1 )
+    count( this->ComputeBin( inputItr.Get(), maskItr.Get() ), weight );
+    ++inputItr;
+    ++maskItr;
+    }
+}
+
+template< class TInputImage, class TCoordRep >
+template< class TCountFunction, class TClearFunction >
+void
+JointHistogramImageFunction<TInputImage, TCoordRep>
+::MoveNeighborhood( const IndexType & index, RegionType & region,
+  bool & isRegionValid, TCountFunction count, TClearFunction clear ) const
+{
+  const RegionType newRegion = this->ComputeNeighborhoodRegion( index );
+
+  // The neighborhoods must match but along the first dimension, and
+  //   overlap along it
+  const IndexValueType oldStart = region.GetIndex( 0 );
+  const IndexValueType oldEnd = oldStart + region.GetSize( 0 );
+  const IndexValueType newStart = newRegion.GetIndex( 0 );
+  const IndexValueType newEnd = newStart + newRegion.GetSize( 0 );
+  bool isSliding = isRegionValid && newStart < oldEnd && oldStart < newEnd;
+  for( unsigned int i = 1; i < ImageDimension && isSliding; ++i )
+    {
+    isSliding = ( newRegion.GetIndex( i ) == region.GetIndex( i )
+      && newRegion.GetSize( i ) == region.GetSize( i ) );
+    }
+
+  if( !isSliding )
+    {
+    clear();
+    this->CountRegion( newRegion, 1, count );
+    }
+  else
+    {
+    RegionType slab = newRegion;
+    if( oldStart < newStart )
       {
-      cur[0] = ( int )( m_HistogramSize ) - 1;
+      slab.SetIndex( 0, oldStart );
+      slab.SetSize( 0, newStart - oldStart );
+      this->CountRegion( slab, -1, count );
       }
-    if( cur[1] > ( int )( m_HistogramSize ) - 1 )
+    if( newEnd < oldEnd )
       {
-      cur[1] = ( int )( m_HistogramSize ) - 1;
+      slab.SetIndex( 0, newEnd );
+      slab.SetSize( 0, oldEnd - newEnd );
+      this->CountRegion( slab, -1, count );
       }
-    if( cur[0] < 0 )
+    if( newStart < oldStart )
       {
-      cur[0] = 0;
+      slab.SetIndex( 0, newStart );
+      slab.SetSize( 0, oldStart - newStart );
+      this->CountRegion( slab, 1, count );
       }
-    if( cur[1] < 0 )
+    if( oldEnd < newEnd )
       {
-      cur[1] = 0;
+      slab.SetIndex( 0, oldEnd );
+      slab.SetSize( 0, newEnd - oldEnd );
+      this->CountRegion( slab, 1, count );
       }
+    }
 
-    m_Histogram->SetPixel( cur, m_Histogram->GetPixel( cur ) + 1 );
+  region = newRegion;
+  isRegionValid = true;
+}
 
-    ++inputItr;
-    ++maskItr;
+template< class TInputImage, class TCoordRep >
+itk::Image<float, 2>::Pointer
+JointHistogramImageFunction<TInputImage, TCoordRep>
+::BlurHistogram( HistogramType * hist, bool isThreaded ) const
+{
+  typedef itk::DiscreteGaussianImageFilter< HistogramType,
+          HistogramType > SmootherType;
+  typename SmootherType::Pointer smoother = SmootherType::New();
+  smoother->SetInput( hist );
+  smoother->SetVariance( 2 );
+  smoother->SetUseImageSpacing( false );
+  if( !isThreaded )
+    {
+    smoother->SetNumberOfWorkUnits( 1 );
     }
+  smoother->Update();
+  return smoother->GetOutput();
+}
+
+template< class TInputImage, class TCoordRep >
+itk::Image<float, 2>::Pointer &
+JointHistogramImageFunction<TInputImage, TCoordRep>
+::ComputeHistogramAtIndex( const IndexType & index, bool blur ) const
+{
+  m_Histogram->FillBuffer( 0 );
+
+  float * histBuffer = m_Histogram->GetBufferPointer();
+  this->CountRegion( this->ComputeNeighborhoodRegion( index ), 1,
+    [&]( SizeValueType bin, double weight )
+      {
+      histBuffer[bin] += weight;
+      } );
 
   if( blur )
     {
-    typedef itk::DiscreteGaussianImageFilter< HistogramType,
-            HistogramType > SmootherType;
-    SmootherType::Pointer smoother = SmootherType::New();
-    smoother->SetInput( m_Histogram );
-    smoother->SetVariance( 2 );
-    smoother->SetUseImageSpacing( false );
-    smoother->Update();
-    m_Histogram = smoother->GetOutput();
+    m_Histogram = this->BlurHistogram( m_Histogram, true );
     }
 
   if( m_ForceDiagonalHistogram )
     {
-    typename HistogramType::IndexType cur;
-    for( unsigned int i=0; i<m_HistogramSize; i++ )
+    this->ForceDiagonal( m_Histogram );
+    }
+
+  return m_Histogram;
+}
+
+template< class TInputImage, class TCoordRep >
+void
+JointHistogramImageFunction<TInputImage, TCoordRep>
+::ForceDiagonal( HistogramType * hist ) const
+{
+  typename HistogramType::IndexType cur;
+  for( unsigned int i=0; i<m_HistogramSize; i++ )
+    {
+    cur[0] = i;
+    unsigned int maxJ = 0;
+    double maxJV = 0;
+    for( unsigned int j=0; j<m_HistogramSize; j++ )
       {
-      cur[0] = i;
-      unsigned int maxJ = 0;
-      double maxJV = 0;
-      for( unsigned int j=0; j<m_HistogramSize; j++ )
+      cur[1] = j;
+      if( hist->GetPixel( cur ) > maxJV )
         {
-        cur[1] = j;
-        if( m_Histogram->GetPixel( cur ) > maxJV )
-          {
-          maxJV = m_Histogram->GetPixel( cur );
-          maxJ = j;
-          }
+        maxJV = hist->GetPixel( cur );
+        maxJ = j;
         }
-      if( maxJV > 0 )
+      }
+    if( maxJV > 0 )
+      {
+      if( ( int )maxJ > ( int )m_HistogramSize/2 )
         {
-        if( ( int )maxJ > ( int )m_HistogramSize/2 )
+        typename HistogramType::IndexType src;
+        cur[1] = 0;
+        src[0] = cur[0];
+        src[1] = ( int )maxJ - ( int )m_HistogramSize/2;
+        src[1] = cur[1] + src[1];
+        while( cur[1] >= 0 && cur[1] < ( int )( m_HistogramSize ) )
           {
-          typename HistogramType::IndexType src;
-          cur[1] = 0;
-          src[0] = cur[0];
-          src[1] = ( int )maxJ - ( int )m_HistogramSize/2;
-          src[1] = cur[1] + src[1];
-          while( cur[1] >= 0 && cur[1] < ( int )( m_HistogramSize ) )
+          if( src[1] < 0 || src[1] >= ( int )( m_HistogramSize ) )
             {
-            if( src[1] < 0 || src[1] >= ( int )( m_HistogramSize ) )
-              {
-              m_Histogram->SetPixel( cur, 0 );
-              }
-            else
-              {
-              m_Histogram->SetPixel( cur, m_Histogram->GetPixel( src ) );
-              }
-            ++cur[1];
-            ++src[1];
+            hist->SetPixel( cur, 0 );
+            }
+          else
+            {
+            hist->SetPixel( cur, hist->GetPixel( src ) );
             }
+          ++cur[1];
+          ++src[1];
           }
-        else
+        }
+      else
+        {
+        typename HistogramType::IndexType src;
+        cur[1] = m_HistogramSize-1;
+        src[0] = cur[0];
+        src[1] = ( int )maxJ - ( int )m_HistogramSize/2;
+        src[1] = cur[1] + src[1];
+        while( cur[1] >= 0 && cur[1] < ( int )( m_HistogramSize ) )
           {
-          typename HistogramType::IndexType src;
-          cur[1] = m_HistogramSize-1;
-          src[0] = cur[0];
-          src[1] = ( int )maxJ - ( int )m_HistogramSize/2;
-          src[1] = cur[1] + src[1];
-          while( cur[1] >= 0 && cur[1] < ( int )( m_HistogramSize ) )
+          if( src[1] < 0 || src[1] >= ( int )( m_HistogramSize ) )
             {
-            if( src[1] < 0 || src[1] >= ( int )( m_HistogramSize ) )
-              {
-              m_Histogram->SetPixel( cur, 0 );
-              }
-            else
-              {
-              m_Histogram->SetPixel( cur, m_Histogram->GetPixel( src ) );
-              }
-            --cur[1];
-            --src[1];
+            hist->SetPixel( cur, 0 );
+            }
+          else
+            {
+            hist->SetPixel( cur, hist->GetPixel( src ) );
             }
+          --cur[1];
+          --src[1];
           }
         }
       }
     }
-
-  return m_Histogram;
 }
 
 } // End namespace tube
@@ -23,6 +23,8 @@ limitations under the License.
 #ifndef __itktubeNJetImageFunction_h
 #define __itktubeNJetImageFunction_h
 
+#include "itktubeImageRegionStatistics.h"
+
 #include <itkArray.h>
 #include <itkImageFunction.h>
 #include <itkMatrix.h>
@@ -95,6 +97,8 @@ public:
 
   typedef Array< VectorType >                              ArrayVectorType;
 
+  typedef ImageRegionStatistics< InputImageType >          ImageStatisticsType;
+
   /**
    * Set the input image.
    */
@@ -106,6 +110,13 @@ public:
   itkSetMacro( UseInputImageMask, bool );
   itkGetMacro( UseInputImageMask, bool );
 
+  /** Intensity range of the input image.  SetInputImage() creates one
+   * covering the whole image, unless the statistics already set are for
+   * the same image.  Set it to share the statistics of other functions
+   * or to restrict them to a region. */
+  void SetImageStatistics( ImageStatisticsType * statistics );
+  itkGetModifiableObjectMacro( ImageStatistics, ImageStatisticsType );
+
   void ComputeStatistics( void );
 
   /** Return the min over the ( possibly masked ) image.
@@ -306,6 +317,8 @@ protected:
 
   double                  m_CurvatureExpectedMax;
 
+  typename ImageStatisticsType::Pointer  m_ImageStatistics;
+
   bool                    m_ValidStats;
   double                  m_StatsMin;
   double                  m_StatsMax;
@@ -25,6 +25,7 @@ limitations under the License.
 #define __itktubeNJetImageFunction_hxx
 
 #include "tubeMatrixMath.h"
+#include "tubeProfiler.h"
 
 #include <itkImageRegionConstIterator.h>
 #include <itkImageRegionIteratorWithIndex.h>
@@ -51,6 +52,8 @@ NJetImageFunction( void )
 
   m_Extent = 5;
 
+  m_ImageStatistics = nullptr;
+
   m_ValidStats = false;
   m_StatsMin = 0;
   m_StatsMax = 0;
@@ -102,6 +105,17 @@ SetInputImage( const InputImageType * ptr )
       m_InputImageSpacingSquared[i] = m_InputImageSpacing[i]
         * m_InputImageSpacing[i];
       }
+
+    if( m_ImageStatistics.IsNull()
+      || m_ImageStatistics->GetInputImage() != ptr )
+      {
+      m_ImageStatistics = ImageStatisticsType::New();
+      m_ImageStatistics->SetInputImage( ptr );
+      }
+    }
+  else
+    {
+    m_ImageStatistics = nullptr;
     }
 
   m_UseInputImageMask = false;
@@ -142,6 +156,18 @@ SetInputImageMask( const InputImageType * ptr )
   m_ValidStats = false;
 }
 
+/**
+ * Set the statistics of the input image
+ */
+template< class TInputImage >
+void
+NJetImageFunction<TInputImage>::
+SetImageStatistics( ImageStatisticsType * statistics )
+{
+  m_ImageStatistics = statistics;
+  m_ValidStats = false;
+}
+
 /**
  * Print
  */
@@ -182,6 +208,8 @@ PrintSelf( std::ostream& os, Indent indent ) const
     os << indent << "m_InputImage = NULL" << std::endl;
     }
   os << indent << "m_Extent = " << m_Extent << std::endl;
+  os << indent << "m_ImageStatistics = " << m_ImageStatistics.GetPointer()
+    << std::endl;
   os << indent << "m_MostRecentIntensity = " << m_MostRecentIntensity
     << std::endl;
   os << indent << "m_MostRecentDerivative = " << m_MostRecentDerivative
@@ -245,22 +273,14 @@ ComputeStatistics( void )
       }
     else
       {
-      imageIt.GoToBegin();
-      m_StatsMin = imageIt.Get();
-      m_StatsMax = imageIt.Get();
-      ++imageIt;
-      while( !imageIt.IsAtEnd() )
+      // Shared with other functions and computed only once per region
+      if( m_ImageStatistics.IsNull() )
         {
-        if( imageIt.Get() < m_StatsMin )
-          {
-          m_StatsMin = imageIt.Get();
-          }
-        else if( imageIt.Get() > m_StatsMax )
-          {
-          m_StatsMax = imageIt.Get();
-          }
-        ++imageIt;
+        m_ImageStatistics = ImageStatisticsType::New();
+        m_ImageStatistics->SetInputImage( m_InputImage );
         }
+      m_StatsMin = m_ImageStatistics->GetMinimum();
+      m_StatsMax = m_ImageStatistics->GetMaximum();
       }
     }
 }
@@ -442,6 +462,8 @@ EvaluateAtContinuousIndex( const ContinuousIndexType & cIndex,
   double scale ) const
 {
   // EVALUATE
+  tubeProfileCountMacro( "NJetImageFunction::KernelEvaluations", 1 );
+
   double physGaussFactor = -0.5 / ( scale * scale );
   double physKernelRadiusSquared = ( scale * m_Extent )
     * ( scale * m_Extent );
@@ -817,6 +839,8 @@ DerivativeAtContinuousIndex( const ContinuousIndexType & cIndex,
   typename NJetImageFunction<TInputImage>::VectorType & d ) const
 {
   // VALUE AND DERIVATIVE
+  tubeProfileCountMacro( "NJetImageFunction::KernelEvaluations", 1 );
+
   double physGaussFactor = -0.5 / ( scale * scale );
   double physKernelRadiusSquared = ( scale * m_Extent )
     * ( scale * m_Extent );
@@ -1461,6 +1485,8 @@ JetAtContinuousIndex( const ContinuousIndexType & cIndex, VectorType & d,
   MatrixType & h, double scale ) const
 {
   // JET
+  tubeProfileCountMacro( "NJetImageFunction::KernelEvaluations", 1 );
+
   double physGaussFactor = -1.0 / ( 2 * scale * scale );
   double physKernelRadiusSquared = scale*m_Extent * scale*m_Extent;
 
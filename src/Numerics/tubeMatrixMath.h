@@ -114,6 +114,14 @@ void
 ComputeEigen( vnl_matrix<T> const & mat, vnl_matrix<T> &eVects,
   vnl_vector<T> &eVals, bool orderByAbs = false, bool minToMax = true );
 
+/** Closed-form eigenvalues and vectors of a symmetric 3x3 matrix, given
+ * by its upper triangle ( a00, a01, a02, a11, a12, a22 ).  Eigenvalues
+ * are returned in ascending order and eVects[i] is the unit eigenvector
+ * of eVals[i].  Does not allocate, so it is suited to per-voxel use. */
+template< class T >
+void
+ComputeSymmetricEigen3x3( const T a[6], T eVals[3], T eVects[3][3] );
+
 } // End namespace tube
 
 
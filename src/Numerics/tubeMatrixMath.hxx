@@ -29,6 +29,9 @@ limitations under the License.
 #include <vnl/algo/vnl_cholesky.h>
 #include <vnl/algo/vnl_matrix_inverse.h>
 
+#include <algorithm>
+#include <cmath>
+
 namespace tube
 {
 
@@ -721,6 +724,179 @@ ComputeEigen( vnl_matrix<T> const & mat,
     }
 }
 
+/**
+ * Unit eigenvector of the symmetric 3x3 matrix a for eigenvalue eVal,
+ * from the largest cross product of the rows of ( a - eVal I ).  Returns
+ * false if the eigenvalue is repeated ( all cross products vanish ). */
+template< class T >
+bool
+ComputeSymmetricEigenVector3x3( const T a[6], T eVal, T eVect[3] )
+{
+  const T r0[3] = { a[0] - eVal, a[1], a[2] };
+  const T r1[3] = { a[1], a[3] - eVal, a[4] };
+  const T r2[3] = { a[2], a[4], a[5] - eVal };
+
+  T c[3][3];
+  c[0][0] = r0[1] * r1[2] - r0[2] * r1[1];
+  c[0][1] = r0[2] * r1[0] - r0[0] * r1[2];
+  c[0][2] = r0[0] * r1[1] - r0[1] * r1[0];
+  c[1][0] = r0[1] * r2[2] - r0[2] * r2[1];
+  c[1][1] = r0[2] * r2[0] - r0[0] * r2[2];
+  c[1][2] = r0[0] * r2[1] - r0[1] * r2[0];
+  c[2][0] = r1[1] * r2[2] - r1[2] * r2[1];
+  c[2][1] = r1[2] * r2[0] - r1[0] * r2[2];
+  c[2][2] = r1[0] * r2[1] - r1[1] * r2[0];
+
+  unsigned int best = 0;
+  T bestNorm = 0;
+  for( unsigned int i=0; i<3; ++i )
+    {
+    T norm = c[i][0] * c[i][0] + c[i][1] * c[i][1] + c[i][2] * c[i][2];
+    if( norm > bestNorm )
+      {
+      bestNorm = norm;
+      best = i;
+      }
+    }
+
+  T scale = 0;
+  for( unsigned int i=0; i<6; ++i )
+    {
+    scale = std::max( scale, static_cast< T >( std::fabs( a[i] ) ) );
+    }
+  scale = std::max( scale, static_cast< T >( std::fabs( eVal ) ) );
+  if( bestNorm <= 1e-20 * scale * scale * scale * scale || bestNorm == 0 )
+    {
+    return false;
+    }
+
+  T norm = std::sqrt( bestNorm );
+  for( unsigned int i=0; i<3; ++i )
+    {
+    eVect[i] = c[best][i] / norm;
+    }
+  return true;
+}
+
+/**
+ * Closed-form eigen-decomposition of a symmetric 3x3 matrix */
+template< class T >
+void
+ComputeSymmetricEigen3x3( const T a[6], T eVals[3], T eVects[3][3] )
+{
+  const T p1 = a[1] * a[1] + a[2] * a[2] + a[4] * a[4];
+  const T q = ( a[0] + a[3] + a[5] ) / 3;
+  const T d0 = a[0] - q;
+  const T d1 = a[3] - q;
+  const T d2 = a[5] - q;
+  const T p2 = d0 * d0 + d1 * d1 + d2 * d2 + 2 * p1;
+
+  if( p1 <= 1e-30 * p2 || p2 == 0 )
+    {
+    // Diagonal matrix
+    unsigned int order[3] = { 0, 1, 2 };
+    const T diag[3] = { a[0], a[3], a[5] };
+    for( unsigned int i=0; i<2; ++i )
+      {
+      for( unsigned int j=i+1; j<3; ++j )
+        {
+        if( diag[order[j]] < diag[order[i]] )
+          {
+          std::swap( order[i], order[j] );
+          }
+        }
+      }
+    for( unsigned int i=0; i<3; ++i )
+      {
+      eVals[i] = diag[order[i]];
+      for( unsigned int j=0; j<3; ++j )
+        {
+        eVects[i][j] = ( j == order[i] ) ? 1 : 0;
+        }
+      }
+    return;
+    }
+
+  // Trigonometric solution of the characteristic polynomial
+  const T p = std::sqrt( p2 / 6 );
+  const T b0 = d0 / p;
+  const T b1 = d1 / p;
+  const T b2 = d2 / p;
+  const T b01 = a[1] / p;
+  const T b02 = a[2] / p;
+  const T b12 = a[4] / p;
+  T r = ( b0 * ( b1 * b2 - b12 * b12 )
+    - b01 * ( b01 * b2 - b12 * b02 )
+    + b02 * ( b01 * b12 - b1 * b02 ) ) / 2;
+  r = std::min( static_cast< T >( 1 ), std::max( static_cast< T >( -1 ),
+    r ) );
+  const T phi = std::acos( r ) / 3;
+
+  eVals[2] = q + 2 * p * std::cos( phi );
+  eVals[0] = q + 2 * p * std::cos( phi + ( 2 * vnl_math::pi / 3 ) );
+  eVals[1] = 3 * q - eVals[0] - eVals[2];
+
+  // Start from the eigenvalue that is best separated from the others
+  unsigned int first = 2;
+  unsigned int second = 0;
+  if( eVals[1] - eVals[0] > eVals[2] - eVals[1] )
+    {
+    first = 0;
+    second = 2;
+    }
+
+  if( !ComputeSymmetricEigenVector3x3( a, eVals[first], eVects[first] ) )
+    {
+    eVects[first][0] = 1;
+    eVects[first][1] = 0;
+    eVects[first][2] = 0;
+    }
+
+  T * u = eVects[first];
+  T * v = eVects[second];
+  bool valid = ComputeSymmetricEigenVector3x3( a, eVals[second], v );
+  if( valid )
+    {
+    T dot = u[0] * v[0] + u[1] * v[1] + u[2] * v[2];
+    for( unsigned int i=0; i<3; ++i )
+      {
+      v[i] -= dot * u[i];
+      }
+    T norm = std::sqrt( v[0] * v[0] + v[1] * v[1] + v[2] * v[2] );
+    valid = ( norm > 1e-6 );
+    if( valid )
+      {
+      for( unsigned int i=0; i<3; ++i )
+        {
+        v[i] /= norm;
+        }
+      }
+    }
+  if( !valid )
+    {
+    // Repeated eigenvalue: any unit vector orthogonal to u
+    if( std::fabs( u[0] ) > std::fabs( u[1] ) )
+      {
+      T norm = std::sqrt( u[0] * u[0] + u[2] * u[2] );
+      v[0] = -u[2] / norm;
+      v[1] = 0;
+      v[2] = u[0] / norm;
+      }
+    else
+      {
+      T norm = std::sqrt( u[1] * u[1] + u[2] * u[2] );
+      v[0] = 0;
+      v[1] = u[2] / norm;
+      v[2] = -u[1] / norm;
+      }
+    }
+
+  T * w = eVects[1];
+  w[0] = u[1] * v[2] - u[2] * v[1];
+  w[1] = u[2] * v[0] - u[0] * v[2];
+  w[2] = u[0] * v[1] - u[1] * v[0];
+}
+
 } // End namespace tube
 
 #endif // End !defined( __tubeMatrixMath_hxx )
@@ -31,6 +31,7 @@ set( TubeTK_Registration_H_Files
   Registration/itkImageToImageRegistrationMethod.h
   Registration/itkInitialImageToImageRegistrationMethod.h
   Registration/itkOptimizedImageToImageRegistrationMethod.h
+  Registration/itkPopulationEvolutionaryOptimizer.h
   Registration/itkRigidImageToImageRegistrationMethod.h
   Registration/itkScaleSkewAngle2DImageToImageRegistrationMethod.h
   Registration/itkScaleSkewAngle2DTransform.h
@@ -43,6 +44,7 @@ set( TubeTK_Registration_H_Files
   Registration/itktubeInitialSpatialObjectToImageRegistrationMethod.h
   Registration/itktubeMeanSquareRegistrationFunction.h
   Registration/itktubeMergeAdjacentImagesFilter.h
+  Registration/itktubeMosaicImagesFilter.h
   Registration/itktubeOptimizedSpatialObjectToImageRegistrationMethod.h
   Registration/itktubePointBasedSpatialObjectToImageMetric.h
   Registration/itktubePointBasedSpatialObjectTransformFilter.h
@@ -83,6 +85,7 @@ set( TubeTK_Registration_HXX_Files
   Registration/itktubeInitialSpatialObjectToImageRegistrationMethod.hxx
   Registration/itktubeMeanSquareRegistrationFunction.hxx
   Registration/itktubeMergeAdjacentImagesFilter.hxx
+  Registration/itktubeMosaicImagesFilter.hxx
   Registration/itktubeOptimizedSpatialObjectToImageRegistrationMethod.hxx
   Registration/itktubePointBasedSpatialObjectToImageMetric.hxx
   Registration/itktubePointBasedSpatialObjectTransformFilter.hxx
@@ -99,7 +102,9 @@ if( TubeTK_USE_VTK )
     Registration/itktubeAnisotropicDiffusiveRegistrationFilter.hxx )
 endif()
 
-set( TubeTK_Registration_CXX_Files )
+set( TubeTK_Registration_CXX_Files
+  Registration/itkPopulationEvolutionaryOptimizer.cxx
+  )
 
 list( APPEND TubeTK_SRCS
   ${TubeTK_Registration_H_Files}
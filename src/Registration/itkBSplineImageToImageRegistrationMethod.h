@@ -25,9 +25,12 @@ limitations under the License.
 
 #include "itkImage.h"
 #include "itkBSplineTransform.h"
+#include "itkRecursiveMultiResolutionPyramidImageFilter.h"
 
 #include "itkOptimizedImageToImageRegistrationMethod.h"
 
+#include <vector>
+
 namespace itk
 {
 
@@ -64,6 +67,12 @@ public:
 
   typedef typename BSplineTransformType::ParametersType ParametersType;
 
+  typedef RecursiveMultiResolutionPyramidImageFilter<ImageType, ImageType>
+    PyramidType;
+
+  /** Images of a pyramid, coarsest level first */
+  typedef std::vector< typename ImageType::ConstPointer > ImagePyramidType;
+
   //
   // Methods from Superclass
   //
@@ -89,9 +98,25 @@ public:
   itkSetClampMacro( NumberOfControlPoints, unsigned int, 3, 2000 );
   itkGetConstMacro( NumberOfControlPoints, unsigned int );
 
-  itkSetClampMacro( NumberOfLevels, unsigned int, 1, 5 );
+  itkSetClampMacro( NumberOfLevels, unsigned int, 1, 10 );
   itkGetConstMacro( NumberOfLevels, unsigned int );
 
+  /** If false, every level registers the full resolution images and only
+   * the control point grid is refined between levels.  The fixed image
+   * samples are then selected once and shared by all levels. */
+  itkSetMacro( UseImagePyramid, bool );
+  itkGetConstMacro( UseImagePyramid, bool );
+  itkBooleanMacro( UseImagePyramid );
+
+  /** Memory ( in MB ) that a metric may use to cache the BSpline weights
+   * of its samples and, for Mattes MI, the PDF derivatives.  The PDF
+   * derivative bound is per work unit, so the total is this value times
+   * RegistrationNumberOfWorkUnits.  Caches that would exceed it are
+   * computed on the fly instead, which is slower.
+   * Ignored ( nothing is cached ) if MinimizeMemory is on. */
+  itkSetMacro( MaximumMetricCacheSize, double );
+  itkGetConstMacro( MaximumMetricCacheSize, double );
+
   BSplineTransformPointer GetBSplineTransform( void ) const;
 
   void ComputeGridRegion( int numberOfControlPoints,
@@ -106,6 +131,17 @@ public:
   itkSetMacro( GradientOptimizeOnly, bool );
   itkGetMacro( GradientOptimizeOnly, bool );
 
+  /** Fixed image pyramid used by the multi-resolution optimization, so
+   * that one pyramid can be shared by registrations of many moving images
+   * against the same fixed image.  It is ignored unless its levels match
+   * the schedule implied by NumberOfControlPoints and NumberOfLevels. */
+  void ComputeFixedImagePyramid( void );
+  void SetFixedImagePyramid( const ImagePyramidType & levels );
+  void ClearFixedImagePyramid( void );
+
+  const ImagePyramidType & GetFixedImagePyramid( void ) const
+    { return m_FixedImagePyramid; }
+
 protected:
 
   BSplineImageToImageRegistrationMethod( void );
@@ -114,6 +150,9 @@ protected:
   typedef InterpolateImageFunction<TImage, double> InterpolatorType;
   typedef ImageToImageMetric<TImage, TImage>       MetricType;
 
+  /** Configures BSpline weight caching and metric threading */
+  virtual typename MetricType::Pointer CreateMetric( void ) override;
+
   virtual void Optimize( MetricType * metric, InterpolatorType * interpolator )
     override;
 
@@ -123,6 +162,22 @@ protected:
   virtual void MultiResolutionOptimize( MetricType * metric,
                                         InterpolatorType * interpolator );
 
+  /** Determine the number of levels, the number of control points at the
+   * coarsest level, and the pyramid schedule. */
+  void ComputePyramidSchedule( unsigned int & numberOfLevelsUsing,
+    unsigned int & coarsestNumberOfControlPoints,
+    typename PyramidType::ScheduleType & schedule ) const;
+
+  bool IsFixedImagePyramidValid( unsigned int numberOfLevelsUsing,
+    const typename PyramidType::ScheduleType & schedule ) const;
+
+  /** Compute the levels of an image pyramid, disconnected from the
+   * pipeline so that they can be shared between threads. */
+  void ComputeImagePyramid( const ImageType * image,
+    unsigned int numberOfLevelsUsing,
+    const typename PyramidType::ScheduleType & schedule,
+    ImagePyramidType & levels ) const;
+
   virtual void PrintSelf( std::ostream & os, Indent indent ) const override;
 
 private:
@@ -140,6 +195,12 @@ private:
 
   bool m_GradientOptimizeOnly;
 
+  bool m_UseImagePyramid;
+
+  double m_MaximumMetricCacheSize;
+
+  ImagePyramidType m_FixedImagePyramid;
+
 };
 
 } // end namespace itk
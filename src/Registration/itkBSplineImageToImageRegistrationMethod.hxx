@@ -36,8 +36,11 @@ limitations under the License.
 #include "itkGradientDescentOptimizer.h"
 
 #include "itkRealTimeClock.h"
+#include "itkMattesMutualInformationImageToImageMetric.h"
 #include "itkCommand.h"
 
+#include <cmath>
+
 namespace itk
 {
 
@@ -132,6 +135,8 @@ BSplineImageToImageRegistrationMethod<TImage>
   m_NumberOfLevels = 3;
   m_ExpectedDeformationMagnitude = 10;
   m_GradientOptimizeOnly = false;
+  m_UseImagePyramid = true;
+  m_MaximumMetricCacheSize = 1024;
   this->SetTransformMethodEnum( Superclass::BSPLINE_TRANSFORM );
 
   // Override superclass defaults:
@@ -205,6 +210,56 @@ BSplineImageToImageRegistrationMethod<TImage>
   this->Superclass::GenerateData();
 }
 
+template <class TImage>
+typename BSplineImageToImageRegistrationMethod<TImage>::MetricType::Pointer
+BSplineImageToImageRegistrationMethod<TImage>
+::CreateMetric( void )
+{
+  typename MetricType::Pointer metric = Superclass::CreateMetric();
+
+  metric->SetNumberOfWorkUnits( this->GetRegistrationNumberOfWorkUnits() );
+
+  if( this->GetMinimizeMemory() )
+    {
+    return metric;
+    }
+
+  const double megabyte = 1024.0 * 1024.0;
+
+  // Each sample caches the ( SplineOrder + 1 )^ImageDimension weights of
+  //   the BSpline transform and the indexes of their parameters.
+  const double weightsCacheSize = this->GetNumberOfSamples()
+    * std::pow( 4.0, (double)ImageDimension )
+    * ( sizeof( double ) + sizeof( IndexValueType ) ) / megabyte;
+  const bool cacheWeights = ( weightsCacheSize <= m_MaximumMetricCacheSize );
+  metric->SetUseCachingOfBSplineWeights( cacheWeights );
+
+  typedef MattesMutualInformationImageToImageMetric<TImage, TImage>
+    MattesMetricType;
+  MattesMetricType * mattesMetric =
+    dynamic_cast< MattesMetricType * >( metric.GetPointer() );
+  if( mattesMetric != nullptr )
+    {
+    // Explicit derivatives store a bins x bins PDF per parameter.  Each
+    //   work unit holds its own copy; the bound is per work unit so the
+    //   choice does not depend on the number of cores of the machine.
+    const double bins = mattesMetric->GetNumberOfHistogramBins();
+    const double pdfDerivativesSize = bins * bins
+      * this->GetTransform()->GetNumberOfParameters() * sizeof( double )
+      / megabyte;
+    mattesMetric->SetUseExplicitPDFDerivatives(
+      pdfDerivativesSize <= m_MaximumMetricCacheSize );
+    }
+
+  if( this->GetReportProgress() )
+    {
+    std::cout << "   Caching BSpline weights = " << cacheWeights
+      << " ( " << weightsCacheSize << " MB )" << std::endl;
+    }
+
+  return metric;
+}
+
 template <class TImage>
 void
 BSplineImageToImageRegistrationMethod<TImage>
@@ -435,98 +490,50 @@ BSplineImageToImageRegistrationMethod<TImage>
     std::cout << "BSpline MULTIRESOLUTION START" << std::endl;
     }
 
-  typedef RecursiveMultiResolutionPyramidImageFilter<ImageType,
-                                                     ImageType>
-  PyramidType;
-  typename PyramidType::Pointer fixedPyramid = PyramidType::New();
-  typename PyramidType::Pointer movingPyramid = PyramidType::New();
-
   /**/
   /* Determine the control points, samples, and scales to be used at
    * each level */
   /**/
   double       controlPointFactor = 2;
-  unsigned int levelNumberOfControlPoints =
-    this->GetNumberOfControlPoints();
-  double levelScale = 1;
-  unsigned int numberOfLevelsUsing = m_NumberOfLevels;
-  if( this->m_NumberOfLevels > 1 )
-    {
-    for( unsigned int level = 1; level < this->m_NumberOfLevels; level++ )
-      {
-      levelNumberOfControlPoints = (unsigned int)(
-        levelNumberOfControlPoints / controlPointFactor );
-      levelScale *= controlPointFactor;
-      if( levelNumberOfControlPoints < 3 )  // splineOrder
-        {
-        levelNumberOfControlPoints = 3;
-        numberOfLevelsUsing = level;
-        break;
-        }
-      }
-    }
+  unsigned int levelNumberOfControlPoints;
+  unsigned int numberOfLevelsUsing;
+  typename PyramidType::ScheduleType schedule;
+  this->ComputePyramidSchedule( numberOfLevelsUsing,
+    levelNumberOfControlPoints, schedule );
 
   /**/
-  /* Setup the multi-scale image pyramids */
+  /*   Apply pyramid to fixed image, unless a matching one was given */
   /**/
-  fixedPyramid->SetNumberOfLevels( numberOfLevelsUsing );
-  movingPyramid->SetNumberOfLevels( numberOfLevelsUsing );
-
-  typename ImageType::SpacingType fixedSpacing =
-    this->GetFixedImage()->GetSpacing();
-  typename ImageType::SpacingType movingSpacing =
-    this->GetFixedImage()->GetSpacing();
-
-  typename PyramidType::ScheduleType fixedSchedule =
-    fixedPyramid->GetSchedule();
-  typename PyramidType::ScheduleType movingSchedule =
-    movingPyramid->GetSchedule();
-
-  /**/
-  /*   First, determine the pyramid at level 0 */
-  /**/
-  unsigned int level = 0;
-  for( unsigned int i = 0; i < ImageDimension; i++ )
+  ImagePyramidType fixedPyramid;
+  ImagePyramidType movingPyramid;
+  if( !m_UseImagePyramid )
     {
-    fixedSchedule[0][i] = (unsigned int)(levelScale);
-    movingSchedule[0][i] = (unsigned int)(levelScale);
+    // Grid refinement only: every level uses the full resolution images
+    fixedPyramid.assign( numberOfLevelsUsing, this->GetFixedImage() );
+    movingPyramid.assign( numberOfLevelsUsing, this->GetMovingImage() );
     }
-
-  /**/
-  /*   Second, determine the pyramid at the remaining levels */
-  /**/
-  for( level = 1; level < numberOfLevelsUsing; level++ )
+  else if( this->IsFixedImagePyramidValid( numberOfLevelsUsing, schedule ) )
     {
-    for( unsigned int i = 0; i < ImageDimension; i++ )
+    if( this->GetReportProgress() )
       {
-      fixedSchedule[level][i] = (int)(fixedSchedule[level - 1][i]
-                                      / controlPointFactor);
-      if( fixedSchedule[level][i] < 1 )
-        {
-        fixedSchedule[level][i] = 1;
-        }
-      movingSchedule[level][i] = (int)(movingSchedule[level - 1][i]
-                                       / controlPointFactor);
-      if( movingSchedule[level][i] < 1 )
-        {
-        movingSchedule[level][i] = 1;
-        }
+      std::cout << "   Using precomputed fixed image pyramid" << std::endl;
       }
+    fixedPyramid = m_FixedImagePyramid;
+    }
+  else
+    {
+    this->ComputeImagePyramid( this->GetFixedImage(), numberOfLevelsUsing,
+      schedule, fixedPyramid );
     }
 
   /**/
-  /*   Third, apply pyramid to fixed image */
-  /**/
-  fixedPyramid->SetSchedule( fixedSchedule );
-  fixedPyramid->SetInput( this->GetFixedImage() );
-  fixedPyramid->Update();
-
-  /**/
-  /*   Fourth, apply pyramid to moving image */
+  /*   Apply pyramid to moving image */
   /**/
-  movingPyramid->SetSchedule( movingSchedule );
-  movingPyramid->SetInput( this->GetMovingImage() );
-  movingPyramid->Update();
+  if( m_UseImagePyramid )
+    {
+    this->ComputeImagePyramid( this->GetMovingImage(), numberOfLevelsUsing,
+      schedule, movingPyramid );
+    }
 
   /**/
   /* Assign initial transform parameters at coarse level based on
@@ -536,7 +543,7 @@ BSplineImageToImageRegistrationMethod<TImage>
   typename Superclass::TransformParametersType levelParameters;
   this->ResampleControlGrid( levelNumberOfControlPoints, levelParameters );
   /* Perform registration at each level */
-  for( level = 0; level < numberOfLevelsUsing; level++ )
+  for( unsigned int level = 0; level < numberOfLevelsUsing; level++ )
     {
     //if( this->GetReportProgress() )
       {
@@ -544,11 +551,11 @@ BSplineImageToImageRegistrationMethod<TImage>
       std::cout << "   Number of control points = "
         << levelNumberOfControlPoints << std::endl;
       std::cout << "   Fixed image = "
-        << fixedPyramid->GetOutput(level)
-          ->GetLargestPossibleRegion().GetSize() << std::endl;
+        << fixedPyramid[level]->GetLargestPossibleRegion().GetSize()
+        << std::endl;
       std::cout << "   Moving image = "
-        << movingPyramid->GetOutput(level)
-          ->GetLargestPossibleRegion().GetSize() << std::endl;
+        << movingPyramid[level]->GetLargestPossibleRegion().GetSize()
+        << std::endl;
       std::cout << "   Parameters.size = "
         << levelParameters.size()
         << std::endl;
@@ -557,10 +564,8 @@ BSplineImageToImageRegistrationMethod<TImage>
     /**/
     /* Get the fixed and moving images for this pyramid level */
     /**/
-    typename ImageType::ConstPointer fixedImage =
-      fixedPyramid->GetOutput(level);
-    typename ImageType::ConstPointer movingImage =
-      movingPyramid->GetOutput(level);
+    typename ImageType::ConstPointer fixedImage = fixedPyramid[level];
+    typename ImageType::ConstPointer movingImage = movingPyramid[level];
 
     /*
     typedef itk::ImageFileWriter< ImageType > FileWriterType;
@@ -592,8 +597,12 @@ BSplineImageToImageRegistrationMethod<TImage>
       this->GetExpectedDeformationMagnitude(); // * levelFactor;
     // should be physical units, so no need to re-scale per level
 
-    unsigned int levelNumberOfSamples = (unsigned int)(
-      this->GetNumberOfSamples() / levelFactor);
+    unsigned int levelNumberOfSamples = this->GetNumberOfSamples();
+    if( m_UseImagePyramid )
+      {
+      levelNumberOfSamples = (unsigned int)(
+        this->GetNumberOfSamples() / levelFactor);
+      }
     unsigned int fixedImageNumberOfSamples =
       fixedImage->GetLargestPossibleRegion().GetNumberOfPixels();
     if( levelNumberOfSamples > fixedImageNumberOfSamples )
@@ -635,6 +644,15 @@ BSplineImageToImageRegistrationMethod<TImage>
       * levelFactor) );
     reg->SetMetricMethodEnum( this->GetMetricMethodEnum() );
     reg->SetInterpolationMethodEnum( this->GetInterpolationMethodEnum() );
+    reg->SetMaximumMetricCacheSize( m_MaximumMetricCacheSize );
+    reg->SetRegistrationNumberOfWorkUnits(
+      this->GetRegistrationNumberOfWorkUnits() );
+    if( !m_UseImagePyramid && this->GetUseFixedImageIndexes()
+      && !this->GetSampleFromOverlap() )
+      {
+      // The levels share the fixed image, so they share its samples
+      reg->SetFixedImageIndexes( this->GetFixedImageIndexes() );
+      }
     std::cout << "pre levelParameters = " << levelParameters << std::endl;
     reg->SetInitialTransformParameters( levelParameters );
     // For the last two levels (the ones at the highest resolution, use
@@ -723,6 +741,163 @@ BSplineImageToImageRegistrationMethod<TImage>
     }
 }
 
+template <class TImage>
+void
+BSplineImageToImageRegistrationMethod<TImage>
+::ComputePyramidSchedule( unsigned int & numberOfLevelsUsing,
+  unsigned int & coarsestNumberOfControlPoints,
+  typename PyramidType::ScheduleType & schedule ) const
+{
+  double       controlPointFactor = 2;
+  double       levelScale = 1;
+
+  coarsestNumberOfControlPoints = this->GetNumberOfControlPoints();
+  numberOfLevelsUsing = m_NumberOfLevels;
+  if( this->m_NumberOfLevels > 1 )
+    {
+    for( unsigned int level = 1; level < this->m_NumberOfLevels; level++ )
+      {
+      coarsestNumberOfControlPoints = (unsigned int)(
+        coarsestNumberOfControlPoints / controlPointFactor );
+      levelScale *= controlPointFactor;
+      if( coarsestNumberOfControlPoints < 3 )  // splineOrder
+        {
+        coarsestNumberOfControlPoints = 3;
+        numberOfLevelsUsing = level;
+        break;
+        }
+      }
+    }
+
+  schedule.SetSize( numberOfLevelsUsing, ImageDimension );
+
+  /**/
+  /*   First, determine the pyramid at level 0 */
+  /**/
+  for( unsigned int i = 0; i < ImageDimension; i++ )
+    {
+    schedule[0][i] = (unsigned int)(levelScale);
+    }
+
+  /**/
+  /*   Second, determine the pyramid at the remaining levels */
+  /**/
+  for( unsigned int level = 1; level < numberOfLevelsUsing; level++ )
+    {
+    for( unsigned int i = 0; i < ImageDimension; i++ )
+      {
+      schedule[level][i] = (int)(schedule[level - 1][i]
+                                 / controlPointFactor);
+      if( schedule[level][i] < 1 )
+        {
+        schedule[level][i] = 1;
+        }
+      }
+    }
+}
+
+template <class TImage>
+void
+BSplineImageToImageRegistrationMethod<TImage>
+::ComputeImagePyramid( const ImageType * image,
+  unsigned int numberOfLevelsUsing,
+  const typename PyramidType::ScheduleType & schedule,
+  ImagePyramidType & levels ) const
+{
+  typename PyramidType::Pointer pyramid = PyramidType::New();
+  pyramid->SetNumberOfLevels( numberOfLevelsUsing );
+  pyramid->SetSchedule( schedule );
+  pyramid->SetInput( image );
+  pyramid->Update();
+
+  levels.resize( numberOfLevelsUsing );
+  for( unsigned int level = 0; level < numberOfLevelsUsing; level++ )
+    {
+    typename ImageType::Pointer levelImage = pyramid->GetOutput( level );
+    levelImage->DisconnectPipeline();
+    levels[level] = levelImage;
+    }
+}
+
+template <class TImage>
+bool
+BSplineImageToImageRegistrationMethod<TImage>
+::IsFixedImagePyramidValid( unsigned int numberOfLevelsUsing,
+  const typename PyramidType::ScheduleType & schedule ) const
+{
+  if( m_FixedImagePyramid.size() != numberOfLevelsUsing
+    || this->GetFixedImage() == nullptr )
+    {
+    return false;
+    }
+
+  const typename ImageType::SizeType fixedSize =
+    this->GetFixedImage()->GetLargestPossibleRegion().GetSize();
+  const typename ImageType::SpacingType fixedSpacing =
+    this->GetFixedImage()->GetSpacing();
+  for( unsigned int level = 0; level < numberOfLevelsUsing; level++ )
+    {
+    const ImageType * levelImage = m_FixedImagePyramid[level];
+    if( levelImage == nullptr )
+      {
+      return false;
+      }
+    const typename ImageType::SizeType levelSize =
+      levelImage->GetLargestPossibleRegion().GetSize();
+    for( unsigned int i = 0; i < ImageDimension; i++ )
+      {
+      unsigned int expectedSize = static_cast<unsigned int>(
+        std::floor( fixedSize[i] / (double)( schedule[level][i] ) ) );
+      if( expectedSize < 1 )
+        {
+        expectedSize = 1;
+        }
+      if( levelSize[i] != expectedSize
+        || std::fabs( levelImage->GetSpacing()[i]
+          - fixedSpacing[i] * schedule[level][i] )
+          > 1e-6 * fixedSpacing[i] * schedule[level][i] )
+        {
+        return false;
+        }
+      }
+    }
+  return true;
+}
+
+template <class TImage>
+void
+BSplineImageToImageRegistrationMethod<TImage>
+::ComputeFixedImagePyramid( void )
+{
+  unsigned int numberOfLevelsUsing;
+  unsigned int coarsestNumberOfControlPoints;
+  typename PyramidType::ScheduleType schedule;
+  this->ComputePyramidSchedule( numberOfLevelsUsing,
+    coarsestNumberOfControlPoints, schedule );
+
+  this->ComputeImagePyramid( this->GetFixedImage(), numberOfLevelsUsing,
+    schedule, m_FixedImagePyramid );
+  this->Modified();
+}
+
+template <class TImage>
+void
+BSplineImageToImageRegistrationMethod<TImage>
+::SetFixedImagePyramid( const ImagePyramidType & levels )
+{
+  m_FixedImagePyramid = levels;
+  this->Modified();
+}
+
+template <class TImage>
+void
+BSplineImageToImageRegistrationMethod<TImage>
+::ClearFixedImagePyramid( void )
+{
+  m_FixedImagePyramid.clear();
+  this->Modified();
+}
+
 template <class TImage>
 typename BSplineImageToImageRegistrationMethod<TImage>::TransformType
 * BSplineImageToImageRegistrationMethod<TImage>
@@ -943,6 +1118,13 @@ BSplineImageToImageRegistrationMethod<TImage>
 ::PrintSelf( std::ostream & os, Indent indent ) const
 {
   Superclass::PrintSelf(os, indent);
+
+  os << indent << "Number Of Control Points = " << m_NumberOfControlPoints
+    << std::endl;
+  os << indent << "Number Of Levels = " << m_NumberOfLevels << std::endl;
+  os << indent << "Use Image Pyramid = " << m_UseImagePyramid << std::endl;
+  os << indent << "Maximum Metric Cache Size = "
+    << m_MaximumMetricCacheSize << std::endl;
 }
 
 }
@@ -35,6 +35,8 @@ limitations under the License.
 #include "itkScaleSkewVersor3DImageToImageRegistrationMethod.h"
 #include "itkBSplineImageToImageRegistrationMethod.h"
 
+#include <vector>
+
 namespace itk
 {
 
@@ -231,6 +233,47 @@ public:
    * ProcessObject API, but it is not a ProcessObject.  */
   void Update( void );
 
+  // **************
+  // **************
+  //  Batch: register many moving images, or one moving image from many
+  //  initial transforms, against the fixed image.  The fixed image
+  //  intensity range, sample sets, and BSpline pyramid are computed once
+  //  and shared by all cases, which are then registered concurrently
+  //  using the settings of this helper.
+  // **************
+  // **************
+  void AddBatchMovingImage( const TImage * image );
+
+  // Initial transforms replace the initial registration stage.  If only
+  //   initial transforms are given, the MovingImage is used for all cases.
+  void AddBatchInitialTransform( const MatrixTransformType * tfm );
+
+  void ClearBatch( void );
+
+  // 0 = use the global default number of threads
+  itkSetMacro( BatchNumberOfConcurrentRegistrations, unsigned int );
+  itkGetConstMacro( BatchNumberOfConcurrentRegistrations, unsigned int );
+
+  // Work units of each registration and resampling.  0 = their default,
+  //   or, in a batch, the global default number of threads divided among
+  //   the concurrent registrations.
+  itkSetMacro( RegistrationNumberOfWorkUnits, unsigned int );
+  itkGetConstMacro( RegistrationNumberOfWorkUnits, unsigned int );
+
+  void UpdateBatch( void );
+
+  unsigned int GetNumberOfBatchResults( void ) const;
+
+  const MatrixTransformType * GetBatchMatrixTransform( unsigned int i ) const;
+
+  const BSplineTransformType * GetBatchBSplineTransform( unsigned int i )
+    const;
+
+  double GetBatchMetricValue( unsigned int i ) const;
+
+  // Case with the lowest final metric value
+  unsigned int GetBatchBestCase( void ) const;
+
   // **************
   // **************
   //  Resample
@@ -318,6 +361,10 @@ public:
   // **************
   itkSetMacro( UseEvolutionaryOptimization, bool );
   itkGetMacro( UseEvolutionaryOptimization, bool );
+  // Candidates per generation of the rigid and affine evolutionary
+  //   stages; values greater than one evaluate candidates concurrently
+  itkSetMacro( EvolutionaryPopulationSize, unsigned int );
+  itkGetMacro( EvolutionaryPopulationSize, unsigned int );
   // **************
   // Specify the expected magnitudes within the transform.  Used to
   //   guide the operating space of the optimizers
@@ -463,6 +510,14 @@ public:
   itkSetMacro( BSplineControlPointPixelSpacing, double );
   itkGetConstMacro( BSplineControlPointPixelSpacing, double );
 
+  // If false, the control point grid is refined at full image resolution
+  itkSetMacro( BSplineUseImagePyramid, bool );
+  itkGetConstMacro( BSplineUseImagePyramid, bool );
+
+  // Memory ( MB ) available for caching BSpline weights in the metric
+  itkSetMacro( BSplineMaximumMetricCacheSize, double );
+  itkGetConstMacro( BSplineMaximumMetricCacheSize, double );
+
   itkSetMacro( BSplineMetricMethodEnum, MetricMethodEnumType );
   itkGetConstMacro( BSplineMetricMethodEnum, MetricMethodEnumType );
 
@@ -494,8 +549,25 @@ private:
 
   void AffineRegND( Image< double, 3 > * t );
 
+  PixelType ComputeFixedImageSamplesIntensityThreshold( void );
+
+  void PrepareBatchFixedImageData( void );
+
+  void ClearBatchFixedImageData( void );
+
+  void UpdateBatchImage( const TImage * image ) const;
+
+  typename TImage::ConstPointer CreateBatchImageView( const TImage * image )
+    const;
+
+  void CopyConfigurationTo( Self * helper ) const;
+
   typedef typename InitialRegistrationMethodType::LandmarkPointType
   LandmarkPointType;
+  typedef typename OptimizedRegistrationMethodType::FixedImageIndexContainer
+  FixedImageIndexContainer;
+  typedef typename BSplineRegistrationMethodType::ImagePyramidType
+  ImagePyramidType;
   typedef typename InitialRegistrationMethodType::LandmarkPointContainer
   LandmarkPointContainer;
 
@@ -567,7 +639,8 @@ private:
   bool m_MinimizeMemory;
 
   //  Optimizer
-  bool m_UseEvolutionaryOptimization;
+  bool         m_UseEvolutionaryOptimization;
+  unsigned int m_EvolutionaryPopulationSize;
 
   //  Loaded Tansform
   typename MatrixTransformType::Pointer   m_LoadedMatrixTransform;
@@ -607,6 +680,8 @@ private:
   double       m_BSplineTargetError;
   unsigned int m_BSplineMaxIterations;
   double       m_BSplineControlPointPixelSpacing;
+  bool         m_BSplineUseImagePyramid;
+  double       m_BSplineMaximumMetricCacheSize;
 
   typename BSplineTransformType::Pointer  m_BSplineTransform;
   MetricMethodEnumType                    m_BSplineMetricMethodEnum;
@@ -614,6 +689,33 @@ private:
 
   double m_BSplineMetricValue;
 
+  //  Fixed image intensity range, cached for the intensity threshold
+  typename TImage::ConstPointer m_FixedImageIntensityRangeImage;
+  ModifiedTimeType              m_FixedImageIntensityRangeMTime;
+  PixelType                     m_FixedImageIntensityMinimum;
+  PixelType                     m_FixedImageIntensityMaximum;
+
+  //  Batch
+  unsigned int m_BatchNumberOfConcurrentRegistrations;
+  unsigned int m_RegistrationNumberOfWorkUnits;
+
+  std::vector< typename TImage::ConstPointer >
+    m_BatchMovingImages;
+  std::vector< typename MatrixTransformType::ConstPointer >
+    m_BatchInitialTransforms;
+
+  std::vector< typename MatrixTransformType::ConstPointer >
+    m_BatchMatrixTransforms;
+  std::vector< typename BSplineTransformType::ConstPointer >
+    m_BatchBSplineTransforms;
+  std::vector< double > m_BatchMetricValues;
+
+  //  Fixed image data shared by the cases of a batch
+  FixedImageIndexContainer m_BatchRigidFixedImageIndexes;
+  FixedImageIndexContainer m_BatchAffineFixedImageIndexes;
+  FixedImageIndexContainer m_BatchBSplineFixedImageIndexes;
+  ImagePyramidType         m_BatchBSplineFixedImagePyramid;
+
 };
 
 }
@@ -40,6 +40,12 @@ limitations under the License.
 #include "itkMinimumMaximumImageCalculator.h"
 #include "itkVector.h"
 #include "itkAffineTransform.h"
+#include "itkMultiThreaderBase.h"
+
+#include <algorithm>
+#include <atomic>
+#include <sstream>
+#include <thread>
 
 namespace itk
 {
@@ -113,6 +119,7 @@ ImageToImageRegistrationHelper<TImage>
   m_MinimizeMemory = false;
   // Optimizer
   m_UseEvolutionaryOptimization = true ;
+  m_EvolutionaryPopulationSize = 0;
   // Loaded
   m_LoadedMatrixTransform = NULL;
   m_LoadedBSplineTransform = NULL;
@@ -148,6 +155,8 @@ ImageToImageRegistrationHelper<TImage>
   m_BSplineTargetError = 0.0001;
   m_BSplineMaxIterations = 200;
   m_BSplineControlPointPixelSpacing = 40;
+  m_BSplineUseImagePyramid = true;
+  m_BSplineMaximumMetricCacheSize = 1024;
   m_BSplineTransform = NULL;
   m_BSplineMetricMethodEnum =
     OptimizedRegistrationMethodType::MATTES_MI_METRIC;
@@ -155,6 +164,16 @@ ImageToImageRegistrationHelper<TImage>
     OptimizedRegistrationMethodType::BSPLINE_INTERPOLATION;
   m_BSplineMetricValue = 0.0;
 
+  // Fixed image intensity range
+  m_FixedImageIntensityRangeImage = NULL;
+  m_FixedImageIntensityRangeMTime = 0;
+  m_FixedImageIntensityMinimum = 0;
+  m_FixedImageIntensityMaximum = 0;
+
+  // Batch
+  m_BatchNumberOfConcurrentRegistrations = 0;
+  m_RegistrationNumberOfWorkUnits = 0;
+
 }
 
 template <class TImage>
@@ -415,6 +434,11 @@ ImageToImageRegistrationHelper<TImage>
 
   typename Affine2DRegistrationMethodType::Pointer regAff
     = Affine2DRegistrationMethodType::New();
+  if( m_RegistrationNumberOfWorkUnits > 0 )
+    {
+    regAff->SetRegistrationNumberOfWorkUnits(
+      m_RegistrationNumberOfWorkUnits );
+    }
   regAff->SetRandomNumberSeed( m_RandomNumberSeed );
   regAff->SetReportProgress( m_ReportProgress );
   regAff->SetMovingImage( m_CurrentMovingImage );
@@ -434,6 +458,7 @@ ImageToImageRegistrationHelper<TImage>
     {
     regAff->SetUseEvolutionaryOptimization( false );
     }
+  regAff->SetEvolutionaryPopulationSize( m_EvolutionaryPopulationSize );
   regAff->SetTargetError( m_AffineTargetError );
   if( m_UseFixedImageMaskObject )
     {
@@ -451,19 +476,15 @@ ImageToImageRegistrationHelper<TImage>
     }
   if( m_SampleIntensityPortion > 0 )
     {
-    typedef MinimumMaximumImageCalculator<ImageType> MinMaxCalcType;
-    typename MinMaxCalcType::Pointer calc = MinMaxCalcType::New();
-    calc->SetImage( m_FixedImage );
-    calc->Compute();
-    PixelType fixedImageMax = calc->GetMaximum();
-    PixelType fixedImageMin = calc->GetMinimum();
-
     regAff->SetFixedImageSamplesIntensityThreshold(
-      static_cast<PixelType>( ( m_SampleIntensityPortion
-        * (fixedImageMax - fixedImageMin) ) + fixedImageMin ) );
+      this->ComputeFixedImageSamplesIntensityThreshold() );
     }
   regAff->SetMetricMethodEnum( m_AffineMetricMethodEnum );
   regAff->SetInterpolationMethodEnum( m_AffineInterpolationMethodEnum );
+  if( !m_BatchAffineFixedImageIndexes.empty() )
+    {
+    regAff->SetFixedImageIndexes( m_BatchAffineFixedImageIndexes );
+    }
   typename AffineTransformType::ParametersType scales;
   scales.set_size( 7 );
   unsigned int scaleNum = 0;
@@ -518,6 +539,11 @@ ImageToImageRegistrationHelper<TImage>
 
   typename Affine3DRegistrationMethodType::Pointer regAff =
     Affine3DRegistrationMethodType::New();
+  if( m_RegistrationNumberOfWorkUnits > 0 )
+    {
+    regAff->SetRegistrationNumberOfWorkUnits(
+      m_RegistrationNumberOfWorkUnits );
+    }
   regAff->SetRandomNumberSeed( m_RandomNumberSeed );
   regAff->SetReportProgress( m_ReportProgress );
   regAff->SetMovingImage( m_CurrentMovingImage );
@@ -537,6 +563,7 @@ ImageToImageRegistrationHelper<TImage>
     {
     regAff->SetUseEvolutionaryOptimization( false );
     }
+  regAff->SetEvolutionaryPopulationSize( m_EvolutionaryPopulationSize );
   regAff->SetTargetError( m_AffineTargetError );
   if( m_UseFixedImageMaskObject )
     {
@@ -554,19 +581,15 @@ ImageToImageRegistrationHelper<TImage>
     }
   if( m_SampleIntensityPortion > 0 )
     {
-    typedef MinimumMaximumImageCalculator<ImageType> MinMaxCalcType;
-    typename MinMaxCalcType::Pointer calc = MinMaxCalcType::New();
-    calc->SetImage( m_FixedImage );
-    calc->Compute();
-    PixelType fixedImageMax = calc->GetMaximum();
-    PixelType fixedImageMin = calc->GetMinimum();
-
     regAff->SetFixedImageSamplesIntensityThreshold(
-      static_cast<PixelType>( ( m_SampleIntensityPortion
-        * (fixedImageMax - fixedImageMin) ) + fixedImageMin ) );
+      this->ComputeFixedImageSamplesIntensityThreshold() );
     }
   regAff->SetMetricMethodEnum( m_AffineMetricMethodEnum );
   regAff->SetInterpolationMethodEnum( m_AffineInterpolationMethodEnum );
+  if( !m_BatchAffineFixedImageIndexes.empty() )
+    {
+    regAff->SetFixedImageIndexes( m_BatchAffineFixedImageIndexes );
+    }
   typename AffineTransformType::ParametersType scales;
 
   scales.set_size( 12 );
@@ -671,6 +694,11 @@ ImageToImageRegistrationHelper<TImage>
 
   typename InitialRegistrationMethodType::Pointer regInit =
     InitialRegistrationMethodType::New();
+  if( m_RegistrationNumberOfWorkUnits > 0 )
+    {
+    regInit->SetRegistrationNumberOfWorkUnits(
+      m_RegistrationNumberOfWorkUnits );
+    }
   regInit->SetReportProgress( m_ReportProgress );
   regInit->SetMovingImage( m_CurrentMovingImage );
   regInit->SetFixedImage( m_FixedImage );
@@ -752,11 +780,17 @@ ImageToImageRegistrationHelper<TImage>
 
     typename RigidRegistrationMethodType::Pointer regRigid;
     regRigid = RigidRegistrationMethodType::New();
+    if( m_RegistrationNumberOfWorkUnits > 0 )
+      {
+      regRigid->SetRegistrationNumberOfWorkUnits(
+        m_RegistrationNumberOfWorkUnits );
+      }
     regRigid->SetRandomNumberSeed( m_RandomNumberSeed );
     if( !m_UseEvolutionaryOptimization )
       {
       regRigid->SetUseEvolutionaryOptimization( false );
       }
+    regRigid->SetEvolutionaryPopulationSize( m_EvolutionaryPopulationSize );
     regRigid->SetReportProgress( m_ReportProgress );
     regRigid->SetMovingImage( m_CurrentMovingImage );
     regRigid->SetFixedImage( m_FixedImage );
@@ -782,16 +816,8 @@ ImageToImageRegistrationHelper<TImage>
       }
     if( m_SampleIntensityPortion > 0 )
       {
-      typedef MinimumMaximumImageCalculator<ImageType> MinMaxCalcType;
-      typename MinMaxCalcType::Pointer calc = MinMaxCalcType::New();
-      calc->SetImage( m_FixedImage );
-      calc->Compute();
-      PixelType fixedImageMax = calc->GetMaximum();
-      PixelType fixedImageMin = calc->GetMinimum();
-
       regRigid->SetFixedImageSamplesIntensityThreshold(
-        static_cast<PixelType>( ( m_SampleIntensityPortion *
-        (fixedImageMax - fixedImageMin) ) + fixedImageMin ) );
+        this->ComputeFixedImageSamplesIntensityThreshold() );
       }
     if( m_UseRegionOfInterest )
       {
@@ -801,6 +827,10 @@ ImageToImageRegistrationHelper<TImage>
     regRigid->SetSampleFromOverlap( m_SampleFromOverlap );
     regRigid->SetMetricMethodEnum( m_RigidMetricMethodEnum );
     regRigid->SetInterpolationMethodEnum( m_RigidInterpolationMethodEnum );
+    if( !m_BatchRigidFixedImageIndexes.empty() )
+      {
+      regRigid->SetFixedImageIndexes( m_BatchRigidFixedImageIndexes );
+      }
     typename RigidTransformType::ParametersType scales;
     if( ImageDimension == 2 )
       {
@@ -881,6 +911,11 @@ ImageToImageRegistrationHelper<TImage>
 
     typename BSplineRegistrationMethodType::Pointer regBspline =
       BSplineRegistrationMethodType::New();
+    if( m_RegistrationNumberOfWorkUnits > 0 )
+      {
+      regBspline->SetRegistrationNumberOfWorkUnits(
+        m_RegistrationNumberOfWorkUnits );
+      }
     if( m_EnableAffineRegistration || !m_UseEvolutionaryOptimization )
       {
       regBspline->SetUseEvolutionaryOptimization( false );
@@ -917,22 +952,24 @@ ImageToImageRegistrationHelper<TImage>
       }
     if( m_SampleIntensityPortion > 0 )
       {
-      typedef MinimumMaximumImageCalculator<ImageType> MinMaxCalcType;
-      typename MinMaxCalcType::Pointer calc = MinMaxCalcType::New();
-      calc->SetImage( m_FixedImage );
-      calc->Compute();
-      PixelType fixedImageMax = calc->GetMaximum();
-      PixelType fixedImageMin = calc->GetMinimum();
-
       regBspline->SetFixedImageSamplesIntensityThreshold(
-        static_cast<PixelType>( ( m_SampleIntensityPortion
-        * (fixedImageMax - fixedImageMin) ) + fixedImageMin ) );
+        this->ComputeFixedImageSamplesIntensityThreshold() );
       }
     regBspline->SetMetricMethodEnum( m_BSplineMetricMethodEnum );
     regBspline->SetInterpolationMethodEnum(
       m_BSplineInterpolationMethodEnum );
     regBspline->SetNumberOfControlPoints( (int)(fixedImageSize[0] /
       m_BSplineControlPointPixelSpacing) );
+    regBspline->SetUseImagePyramid( m_BSplineUseImagePyramid );
+    regBspline->SetMaximumMetricCacheSize( m_BSplineMaximumMetricCacheSize );
+    if( !m_BatchBSplineFixedImageIndexes.empty() )
+      {
+      regBspline->SetFixedImageIndexes( m_BatchBSplineFixedImageIndexes );
+      }
+    if( !m_BatchBSplineFixedImagePyramid.empty() )
+      {
+      regBspline->SetFixedImagePyramid( m_BatchBSplineFixedImagePyramid );
+      }
 
     regBspline->Update();
 
@@ -1083,6 +1120,10 @@ ImageToImageRegistrationHelper<TImage>
       // Register using LoadedMatrix
       typename ResampleImageFilterType::Pointer resampler =
         ResampleImageFilterType::New();
+      if( m_RegistrationNumberOfWorkUnits > 0 )
+        {
+        resampler->SetNumberOfWorkUnits( m_RegistrationNumberOfWorkUnits );
+        }
       resampler->SetInput( mImage );
       resampler->SetInterpolator( interpolator.GetPointer() );
       // We should not be casting away constness here, but
@@ -1114,6 +1155,10 @@ ImageToImageRegistrationHelper<TImage>
       // Register using LoadedMatrix
       typename ResampleImageFilterType::Pointer resampler =
         ResampleImageFilterType::New();
+      if( m_RegistrationNumberOfWorkUnits > 0 )
+        {
+        resampler->SetNumberOfWorkUnits( m_RegistrationNumberOfWorkUnits );
+        }
       resampler->SetInput( mImage );
       resampler->SetInterpolator( interpolator.GetPointer() );
       // We should not be casting away constness here, but
@@ -1146,6 +1191,10 @@ ImageToImageRegistrationHelper<TImage>
     // Register using Matrix
     typename ResampleImageFilterType::Pointer resampler =
       ResampleImageFilterType::New();
+    if( m_RegistrationNumberOfWorkUnits > 0 )
+      {
+      resampler->SetNumberOfWorkUnits( m_RegistrationNumberOfWorkUnits );
+      }
     resampler->SetInput( mImage );
     resampler->SetInterpolator( interpolator.GetPointer() );
     resampler->SetReferenceImage( m_FixedImage );
@@ -1191,6 +1240,10 @@ ImageToImageRegistrationHelper<TImage>
     // Register using BSpline
     typename ResampleImageFilterType::Pointer resampler =
       ResampleImageFilterType::New();
+    if( m_RegistrationNumberOfWorkUnits > 0 )
+      {
+      resampler->SetNumberOfWorkUnits( m_RegistrationNumberOfWorkUnits );
+      }
     resampler->SetInput( mImage );
     resampler->SetInterpolator( interpolator.GetPointer() );
     // We should not be casting away constness here, but
@@ -1248,6 +1301,10 @@ ImageToImageRegistrationHelper<TImage>
     interpolator->SetInputImage( mImage );
     typename ResampleImageFilterType::Pointer resampler =
       ResampleImageFilterType::New();
+    if( m_RegistrationNumberOfWorkUnits > 0 )
+      {
+      resampler->SetNumberOfWorkUnits( m_RegistrationNumberOfWorkUnits );
+      }
     resampler->SetInput( mImage );
     resampler->SetInterpolator( interpolator.GetPointer() );
     // We should not be casting away constness here, but
@@ -1595,6 +1652,461 @@ ImageToImageRegistrationHelper<TImage>
     }
 }
 
+template <class TImage>
+typename ImageToImageRegistrationHelper<TImage>::PixelType
+ImageToImageRegistrationHelper<TImage>
+::ComputeFixedImageSamplesIntensityThreshold( void )
+{
+  if( m_FixedImageIntensityRangeImage != m_FixedImage
+    || m_FixedImageIntensityRangeMTime != m_FixedImage->GetMTime() )
+    {
+    typedef MinimumMaximumImageCalculator<ImageType> MinMaxCalcType;
+    typename MinMaxCalcType::Pointer calc = MinMaxCalcType::New();
+    calc->SetImage( m_FixedImage );
+    calc->Compute();
+    m_FixedImageIntensityMaximum = calc->GetMaximum();
+    m_FixedImageIntensityMinimum = calc->GetMinimum();
+    m_FixedImageIntensityRangeImage = m_FixedImage;
+    m_FixedImageIntensityRangeMTime = m_FixedImage->GetMTime();
+    }
+
+  return static_cast<PixelType>( ( m_SampleIntensityPortion
+    * ( m_FixedImageIntensityMaximum - m_FixedImageIntensityMinimum ) )
+    + m_FixedImageIntensityMinimum );
+}
+
+template <class TImage>
+void
+ImageToImageRegistrationHelper<TImage>
+::AddBatchMovingImage( const TImage * image )
+{
+  m_BatchMovingImages.push_back( image );
+  this->Modified();
+}
+
+template <class TImage>
+void
+ImageToImageRegistrationHelper<TImage>
+::AddBatchInitialTransform( const MatrixTransformType * tfm )
+{
+  m_BatchInitialTransforms.push_back( tfm );
+  this->Modified();
+}
+
+template <class TImage>
+void
+ImageToImageRegistrationHelper<TImage>
+::ClearBatch( void )
+{
+  m_BatchMovingImages.clear();
+  m_BatchInitialTransforms.clear();
+  m_BatchMatrixTransforms.clear();
+  m_BatchBSplineTransforms.clear();
+  m_BatchMetricValues.clear();
+  this->Modified();
+}
+
+template <class TImage>
+void
+ImageToImageRegistrationHelper<TImage>
+::PrepareBatchFixedImageData( void )
+{
+  unsigned long fixedImageNumPixels = m_FixedImage->GetLargestPossibleRegion()
+    .GetNumberOfPixels();
+
+  // The sample set depends on the moving image if sampling from overlap,
+  //   so it can only be shared otherwise.
+  if( !m_SampleFromOverlap )
+    {
+    const bool enabled[3] = { m_EnableRigidRegistration,
+      m_EnableAffineRegistration, m_EnableBSplineRegistration };
+    const double ratio[3] = { m_RigidSamplingRatio, m_AffineSamplingRatio,
+      m_BSplineSamplingRatio };
+    FixedImageIndexContainer * indexes[3] = {
+      &m_BatchRigidFixedImageIndexes, &m_BatchAffineFixedImageIndexes,
+      &m_BatchBSplineFixedImageIndexes };
+    for( unsigned int stage = 0; stage < 3; stage++ )
+      {
+      indexes[stage]->clear();
+      if( !enabled[stage] )
+        {
+        continue;
+        }
+      typename OptimizedRegistrationMethodType::Pointer reg =
+        OptimizedRegistrationMethodType::New();
+      reg->SetReportProgress( m_ReportProgress );
+      reg->SetFixedImage( m_FixedImage );
+      reg->SetNumberOfSamples( (unsigned int)( ratio[stage]
+        * fixedImageNumPixels ) );
+      if( m_UseRegionOfInterest )
+        {
+        reg->SetRegionOfInterest( m_RegionOfInterestPoint1,
+          m_RegionOfInterestPoint2 );
+        }
+      if( m_UseFixedImageMaskObject && m_FixedImageMaskObject.IsNotNull() )
+        {
+        reg->SetFixedImageMaskObject( m_FixedImageMaskObject );
+        }
+      if( m_SampleIntensityPortion > 0 )
+        {
+        reg->SetFixedImageSamplesIntensityThreshold(
+          this->ComputeFixedImageSamplesIntensityThreshold() );
+        }
+      reg->ComputeFixedImageIndexes();
+      if( reg->GetUseFixedImageIndexes() )
+        {
+        *( indexes[stage] ) = reg->GetFixedImageIndexes();
+        }
+      }
+    }
+
+  m_BatchBSplineFixedImagePyramid.clear();
+  if( m_EnableBSplineRegistration && m_BSplineUseImagePyramid )
+    {
+    typename TImage::SizeType fixedImageSize =
+      m_FixedImage->GetLargestPossibleRegion().GetSize();
+    typename BSplineRegistrationMethodType::Pointer regBspline =
+      BSplineRegistrationMethodType::New();
+    regBspline->SetFixedImage( m_FixedImage );
+    regBspline->SetNumberOfControlPoints( (int)(fixedImageSize[0] /
+      m_BSplineControlPointPixelSpacing) );
+    regBspline->ComputeFixedImagePyramid();
+    m_BatchBSplineFixedImagePyramid = regBspline->GetFixedImagePyramid();
+    }
+}
+
+template <class TImage>
+void
+ImageToImageRegistrationHelper<TImage>
+::ClearBatchFixedImageData( void )
+{
+  m_BatchRigidFixedImageIndexes.clear();
+  m_BatchAffineFixedImageIndexes.clear();
+  m_BatchBSplineFixedImageIndexes.clear();
+  m_BatchBSplineFixedImagePyramid.clear();
+}
+
+template <class TImage>
+void
+ImageToImageRegistrationHelper<TImage>
+::CopyConfigurationTo( Self * helper ) const
+{
+  helper->m_FixedImage = m_FixedImage;
+  helper->m_MovingImage = m_MovingImage;
+
+  helper->m_SampleFromOverlap = m_SampleFromOverlap;
+  helper->m_SampleIntensityPortion = m_SampleIntensityPortion;
+
+  helper->m_UseFixedImageMaskObject = m_UseFixedImageMaskObject;
+  helper->m_FixedImageMaskObject = m_FixedImageMaskObject;
+  helper->m_UseMovingImageMaskObject = m_UseMovingImageMaskObject;
+  helper->m_MovingImageMaskObject = m_MovingImageMaskObject;
+
+  helper->m_UseRegionOfInterest = m_UseRegionOfInterest;
+  helper->m_RegionOfInterestPoint1 = m_RegionOfInterestPoint1;
+  helper->m_RegionOfInterestPoint2 = m_RegionOfInterestPoint2;
+
+  helper->m_RandomNumberSeed = m_RandomNumberSeed;
+  helper->m_RegistrationNumberOfWorkUnits = m_RegistrationNumberOfWorkUnits;
+
+  helper->m_EnableLoadedRegistration = m_EnableLoadedRegistration;
+  helper->m_EnableInitialRegistration = m_EnableInitialRegistration;
+  helper->m_EnableRigidRegistration = m_EnableRigidRegistration;
+  helper->m_EnableAffineRegistration = m_EnableAffineRegistration;
+  helper->m_EnableBSplineRegistration = m_EnableBSplineRegistration;
+
+  helper->m_ExpectedOffsetMagnitude = m_ExpectedOffsetMagnitude;
+  helper->m_ExpectedRotationMagnitude = m_ExpectedRotationMagnitude;
+  helper->m_ExpectedScaleMagnitude = m_ExpectedScaleMagnitude;
+  helper->m_ExpectedSkewMagnitude = m_ExpectedSkewMagnitude;
+  helper->m_ExpectedDeformationMagnitude = m_ExpectedDeformationMagnitude;
+
+  helper->m_ReportProgress = m_ReportProgress;
+  helper->m_MinimizeMemory = m_MinimizeMemory;
+
+  helper->m_UseEvolutionaryOptimization = m_UseEvolutionaryOptimization;
+  helper->m_EvolutionaryPopulationSize = m_EvolutionaryPopulationSize;
+
+  helper->m_LoadedMatrixTransform = m_LoadedMatrixTransform;
+  helper->m_LoadedBSplineTransform = m_LoadedBSplineTransform;
+
+  helper->m_InitialMethodEnum = m_InitialMethodEnum;
+  helper->m_FixedLandmarks = m_FixedLandmarks;
+  helper->m_MovingLandmarks = m_MovingLandmarks;
+
+  helper->m_RigidSamplingRatio = m_RigidSamplingRatio;
+  helper->m_RigidTargetError = m_RigidTargetError;
+  helper->m_RigidMaxIterations = m_RigidMaxIterations;
+  helper->m_RigidMetricMethodEnum = m_RigidMetricMethodEnum;
+  helper->m_RigidInterpolationMethodEnum = m_RigidInterpolationMethodEnum;
+
+  helper->m_AffineSamplingRatio = m_AffineSamplingRatio;
+  helper->m_AffineTargetError = m_AffineTargetError;
+  helper->m_AffineMaxIterations = m_AffineMaxIterations;
+  helper->m_AffineMetricMethodEnum = m_AffineMetricMethodEnum;
+  helper->m_AffineInterpolationMethodEnum = m_AffineInterpolationMethodEnum;
+
+  helper->m_BSplineSamplingRatio = m_BSplineSamplingRatio;
+  helper->m_BSplineTargetError = m_BSplineTargetError;
+  helper->m_BSplineMaxIterations = m_BSplineMaxIterations;
+  helper->m_BSplineControlPointPixelSpacing =
+    m_BSplineControlPointPixelSpacing;
+  helper->m_BSplineUseImagePyramid = m_BSplineUseImagePyramid;
+  helper->m_BSplineMaximumMetricCacheSize = m_BSplineMaximumMetricCacheSize;
+  helper->m_BSplineMetricMethodEnum = m_BSplineMetricMethodEnum;
+  helper->m_BSplineInterpolationMethodEnum =
+    m_BSplineInterpolationMethodEnum;
+
+  helper->m_FixedImageIntensityRangeImage = m_FixedImageIntensityRangeImage;
+  helper->m_FixedImageIntensityRangeMTime = m_FixedImageIntensityRangeMTime;
+  helper->m_FixedImageIntensityMinimum = m_FixedImageIntensityMinimum;
+  helper->m_FixedImageIntensityMaximum = m_FixedImageIntensityMaximum;
+
+  helper->m_BatchRigidFixedImageIndexes = m_BatchRigidFixedImageIndexes;
+  helper->m_BatchAffineFixedImageIndexes = m_BatchAffineFixedImageIndexes;
+  helper->m_BatchBSplineFixedImageIndexes = m_BatchBSplineFixedImageIndexes;
+  helper->m_BatchBSplineFixedImagePyramid = m_BatchBSplineFixedImagePyramid;
+}
+
+template <class TImage>
+void
+ImageToImageRegistrationHelper<TImage>
+::UpdateBatchImage( const TImage * image ) const
+{
+  if( image != nullptr && image->GetSource() )
+    {
+    image->GetSource()->Update();
+    }
+}
+
+template <class TImage>
+typename TImage::ConstPointer
+ImageToImageRegistrationHelper<TImage>
+::CreateBatchImageView( const TImage * image ) const
+{
+  if( image == nullptr )
+    {
+    return nullptr;
+    }
+  typename TImage::Pointer view = TImage::New();
+  view->Graft( image );
+  return view.GetPointer();
+}
+
+template <class TImage>
+void
+ImageToImageRegistrationHelper<TImage>
+::UpdateBatch( void )
+{
+  if( m_FixedImage.IsNull() )
+    {
+    itkExceptionMacro( << "Fixed image must be set before UpdateBatch()" );
+    }
+
+  // Cases are one moving image from many initial transforms, paired
+  //   moving images and initial transforms, or many moving images.
+  const unsigned int numberOfImages =
+    static_cast<unsigned int>( m_BatchMovingImages.size() );
+  const unsigned int numberOfTransforms =
+    static_cast<unsigned int>( m_BatchInitialTransforms.size() );
+  unsigned int numberOfCases = 0;
+  if( numberOfImages == 0 && numberOfTransforms > 0
+    && m_MovingImage.IsNotNull() )
+    {
+    numberOfCases = numberOfTransforms;
+    }
+  else if( numberOfImages == 1 || numberOfTransforms == 0
+    || numberOfTransforms == numberOfImages )
+    {
+    numberOfCases = std::max( numberOfImages, numberOfTransforms );
+    }
+  else
+    {
+    itkExceptionMacro( << "Batch has " << numberOfImages
+      << " moving images and " << numberOfTransforms
+      << " initial transforms; expected one moving image, no initial"
+      << " transforms, or as many initial transforms as moving images." );
+    }
+
+  m_BatchMatrixTransforms.assign( numberOfCases, nullptr );
+  m_BatchBSplineTransforms.assign( numberOfCases, nullptr );
+  m_BatchMetricValues.assign( numberOfCases, 0.0 );
+  if( numberOfCases == 0 )
+    {
+    return;
+    }
+
+  unsigned int numberOfThreads = m_BatchNumberOfConcurrentRegistrations;
+  const unsigned int numberOfWorkUnits =
+    MultiThreaderBase::GetGlobalDefaultNumberOfThreads();
+  if( numberOfThreads == 0 )
+    {
+    numberOfThreads = numberOfWorkUnits;
+    }
+  numberOfThreads = std::max( 1u, std::min( numberOfThreads,
+    numberOfCases ) );
+
+  // The images are brought up to date once, here.  Each case then gets
+  //   its own view of them, without a source, so that the concurrent
+  //   pipelines never update the shared images.
+  this->UpdateBatchImage( m_FixedImage );
+  this->UpdateBatchImage( m_MovingImage );
+  for( unsigned int i = 0; i < numberOfImages; i++ )
+    {
+    this->UpdateBatchImage( m_BatchMovingImages[i] );
+    }
+
+  this->PrepareBatchFixedImageData();
+
+  std::vector< typename Self::Pointer > helpers( numberOfCases );
+  for( unsigned int c = 0; c < numberOfCases; c++ )
+    {
+    helpers[c] = Self::New();
+    this->CopyConfigurationTo( helpers[c] );
+    helpers[c]->m_FixedImage = this->CreateBatchImageView( m_FixedImage );
+    helpers[c]->m_MovingImage = this->CreateBatchImageView( m_MovingImage );
+    if( numberOfImages > 0 )
+      {
+      helpers[c]->m_MovingImage = this->CreateBatchImageView(
+        m_BatchMovingImages[ numberOfImages == 1 ? 0 : c ] );
+      }
+    if( m_FixedImageIntensityRangeImage == m_FixedImage )
+      {
+      helpers[c]->m_FixedImageIntensityRangeImage =
+        helpers[c]->m_FixedImage;
+      helpers[c]->m_FixedImageIntensityRangeMTime =
+        helpers[c]->m_FixedImage->GetMTime();
+      }
+
+    // The concurrent cases share the threads
+    if( m_RegistrationNumberOfWorkUnits == 0 )
+      {
+      helpers[c]->m_RegistrationNumberOfWorkUnits = std::max( 1u,
+        numberOfWorkUnits / numberOfThreads );
+      }
+    if( helpers[c]->m_InitialMethodEnum == INIT_WITH_CURRENT_RESULTS )
+      {
+      helpers[c]->m_InitialMethodEnum = INIT_WITH_NONE;
+      }
+    if( numberOfTransforms > 0 )
+      {
+      helpers[c]->m_LoadedBSplineTransform = 0;
+      helpers[c]->SetLoadedMatrixTransform( *( m_BatchInitialTransforms[c] ) );
+      helpers[c]->SetEnableInitialRegistration( false );
+      }
+    }
+  this->ClearBatchFixedImageData();
+
+  std::atomic< unsigned int > nextCase( 0 );
+  std::vector< std::string > errors( numberOfCases );
+  auto worker = [&]()
+    {
+    for( unsigned int c = nextCase++; c < numberOfCases; c = nextCase++ )
+      {
+      try
+        {
+        helpers[c]->Update();
+        }
+      catch( ExceptionObject & err )
+        {
+        errors[c] = err.what();
+        }
+      catch( std::exception & err )
+        {
+        errors[c] = err.what();
+        }
+      }
+    };
+
+  std::vector< std::thread > threads;
+  for( unsigned int t = 1; t < numberOfThreads; t++ )
+    {
+    threads.push_back( std::thread( worker ) );
+    }
+  worker();
+  for( unsigned int t = 0; t < threads.size(); t++ )
+    {
+    threads[t].join();
+    }
+
+  std::ostringstream failures;
+  for( unsigned int c = 0; c < numberOfCases; c++ )
+    {
+    if( !errors[c].empty() )
+      {
+      failures << "Case " << c << ": " << errors[c] << std::endl;
+      continue;
+      }
+    m_BatchMatrixTransforms[c] = helpers[c]->m_CurrentMatrixTransform;
+    m_BatchBSplineTransforms[c] = helpers[c]->m_CurrentBSplineTransform;
+    m_BatchMetricValues[c] = helpers[c]->GetFinalMetricValue();
+    }
+  if( !failures.str().empty() )
+    {
+    itkExceptionMacro( << "Batch registration failed:" << std::endl
+      << failures.str() );
+    }
+}
+
+template <class TImage>
+unsigned int
+ImageToImageRegistrationHelper<TImage>
+::GetNumberOfBatchResults( void ) const
+{
+  return static_cast<unsigned int>( m_BatchMetricValues.size() );
+}
+
+template <class TImage>
+const typename ImageToImageRegistrationHelper<TImage>::MatrixTransformType *
+ImageToImageRegistrationHelper<TImage>
+::GetBatchMatrixTransform( unsigned int i ) const
+{
+  if( i >= m_BatchMatrixTransforms.size() )
+    {
+    itkExceptionMacro( << "Batch result " << i << " does not exist" );
+    }
+  return m_BatchMatrixTransforms[i];
+}
+
+template <class TImage>
+const typename ImageToImageRegistrationHelper<TImage>::BSplineTransformType *
+ImageToImageRegistrationHelper<TImage>
+::GetBatchBSplineTransform( unsigned int i ) const
+{
+  if( i >= m_BatchBSplineTransforms.size() )
+    {
+    itkExceptionMacro( << "Batch result " << i << " does not exist" );
+    }
+  return m_BatchBSplineTransforms[i];
+}
+
+template <class TImage>
+double
+ImageToImageRegistrationHelper<TImage>
+::GetBatchMetricValue( unsigned int i ) const
+{
+  if( i >= m_BatchMetricValues.size() )
+    {
+    itkExceptionMacro( << "Batch result " << i << " does not exist" );
+    }
+  return m_BatchMetricValues[i];
+}
+
+template <class TImage>
+unsigned int
+ImageToImageRegistrationHelper<TImage>
+::GetBatchBestCase( void ) const
+{
+  if( m_BatchMetricValues.empty() )
+    {
+    itkExceptionMacro( << "No batch results" );
+    }
+  // The registration methods minimize their metrics
+  return static_cast<unsigned int>( std::min_element(
+    m_BatchMetricValues.begin(), m_BatchMetricValues.end() )
+    - m_BatchMetricValues.begin() );
+}
+
 template <class TImage>
 void
 ImageToImageRegistrationHelper<TImage>
@@ -1703,6 +2215,11 @@ ImageToImageRegistrationHelper<TImage>
   os << indent << "Enable BSpline Registration = "
     << m_EnableBSplineRegistration << std::endl;
   os << indent << std::endl;
+  os << indent << "Use Evolutionary Optimization = "
+    << m_UseEvolutionaryOptimization << std::endl;
+  os << indent << "Evolutionary Population Size = "
+    << m_EvolutionaryPopulationSize << std::endl;
+  os << indent << std::endl;
   os << indent << "Expected Offset (in Pixels) Magnitude = "
     << m_ExpectedOffsetMagnitude << std::endl;
   os << indent << "Expected Rotation Magnitude = "
@@ -1892,6 +2409,10 @@ ImageToImageRegistrationHelper<TImage>
     << std::endl;
   os << indent << "BSpline Control Point Pixel Spacing = "
     << m_BSplineControlPointPixelSpacing << std::endl;
+  os << indent << "BSpline Use Image Pyramid = "
+    << m_BSplineUseImagePyramid << std::endl;
+  os << indent << "BSpline Maximum Metric Cache Size = "
+    << m_BSplineMaximumMetricCacheSize << std::endl;
   PrintSelfHelper( os, indent, "BSpline", m_BSplineMetricMethodEnum,
     m_BSplineInterpolationMethodEnum );
   os << indent << std::endl;
@@ -1905,6 +2426,16 @@ ImageToImageRegistrationHelper<TImage>
     os << indent << "BSpline Transform = NULL" << std::endl;
     }
   os << indent << std::endl;
+  os << indent << "Registration Number Of Work Units = "
+    << m_RegistrationNumberOfWorkUnits << std::endl;
+  os << indent << "Batch Number Of Concurrent Registrations = "
+    << m_BatchNumberOfConcurrentRegistrations << std::endl;
+  os << indent << "Batch Moving Images = " << m_BatchMovingImages.size()
+    << std::endl;
+  os << indent << "Batch Initial Transforms = "
+    << m_BatchInitialTransforms.size() << std::endl;
+  os << indent << "Batch Results = " << m_BatchMetricValues.size()
+    << std::endl;
 
 }
 
@@ -79,6 +79,9 @@ public:
                                      BSPLINE_INTERPOLATION,
                                      SINC_INTERPOLATION };
 
+  typedef typename ImageToImageMetric<TImage, TImage>::FixedImageIndexContainer
+    FixedImageIndexContainer;
+
   //
   // Methods from Superclass
   //
@@ -111,6 +114,14 @@ public:
   itkSetMacro( UseEvolutionaryOptimization, bool );
   itkGetConstMacro( UseEvolutionaryOptimization, bool );
 
+  /** When greater than one, the evolutionary stage uses a
+   * PopulationEvolutionaryOptimizer with this many candidates per
+   * generation.  Candidates are evaluated concurrently, each worker
+   * using its own metric, interpolator, and transform clone.  Otherwise
+   * the OnePlusOneEvolutionaryOptimizer is used. */
+  itkSetMacro( EvolutionaryPopulationSize, unsigned int );
+  itkGetConstMacro( EvolutionaryPopulationSize, unsigned int );
+
   itkSetMacro( NumberOfSamples, unsigned int );
   itkGetConstMacro( NumberOfSamples, unsigned int );
 
@@ -120,6 +131,21 @@ public:
 
   itkGetConstMacro( FixedImageSamplesIntensityThreshold, PixelType );
 
+  /** Compute the fixed image sample indexes implied by the region of
+   * interest, fixed image mask, intensity threshold, and sample-from-
+   * overlap settings.  No indexes are used if none of those are set. */
+  void ComputeFixedImageIndexes( void );
+
+  /** Use precomputed fixed image sample indexes.  GenerateData() then
+   * skips scanning the fixed image, so that one sample set can be shared
+   * by many registrations against the same fixed image. */
+  void SetFixedImageIndexes( const FixedImageIndexContainer & indexes );
+  void ClearFixedImageIndexes( void );
+
+  const FixedImageIndexContainer & GetFixedImageIndexes( void ) const
+    { return m_FixedImageIndexes; }
+  itkGetConstMacro( UseFixedImageIndexes, bool );
+
   itkSetMacro( TargetError, double );
   itkGetConstMacro( TargetError, double );
 
@@ -147,6 +173,13 @@ protected:
   typedef InterpolateImageFunction<TImage, double> InterpolatorType;
   typedef ImageToImageMetric<TImage, TImage>       MetricType;
 
+  /** Create a metric configured with the fixed and moving images, the
+   * fixed image samples, and the moving image mask of this method. */
+  virtual typename MetricType::Pointer CreateMetric( void );
+
+  /** Create an interpolator of the moving image. */
+  virtual typename InterpolatorType::Pointer CreateInterpolator( void );
+
   virtual void Optimize( MetricType * metric, InterpolatorType * interpolator );
 
   virtual void PrintSelf( std::ostream & os, Indent indent ) const override;
@@ -173,14 +206,21 @@ private:
 
   bool m_UseEvolutionaryOptimization;
 
+  unsigned int m_EvolutionaryPopulationSize;
+
   unsigned int m_NumberOfSamples;
 
+  bool                     m_UseFixedImageIndexes;
+  bool                     m_FixedImageIndexesArePreset;
+  FixedImageIndexContainer m_FixedImageIndexes;
+
   bool      m_UseFixedImageSamplesIntensityThreshold;
   PixelType m_FixedImageSamplesIntensityThreshold;
 
   double m_TargetError;
 
   int m_RandomNumberSeed;
+  int m_MetricRandomNumberSeed;
 
   TransformMethodEnumType m_TransformMethodEnum;
 
@@ -41,6 +41,8 @@ limitations under the License.
 #include "itkSingleValuedNonLinearOptimizer.h"
 #include "itkOnePlusOneEvolutionaryOptimizer.h"
 #include "itkNormalVariateGenerator.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkPopulationEvolutionaryOptimizer.h"
 
 #include "itkRegularStepGradientDescentOptimizer.h"
 #include "itkFRPROptimizer.h"
@@ -161,16 +163,21 @@ OptimizedImageToImageRegistrationMethod<TImage>
 
   m_UseEvolutionaryOptimization = true;
 
+  m_EvolutionaryPopulationSize = 0;
+
   // The following NumberOfSamples value is a good default for rigid
   //   registration.  Other derived registration methods should use
   //   their own default.
   m_NumberOfSamples = 100000;
+  m_UseFixedImageIndexes = false;
+  m_FixedImageIndexesArePreset = false;
   m_FixedImageSamplesIntensityThreshold = 0;
   m_UseFixedImageSamplesIntensityThreshold = false;
 
   m_TargetError = 0.00001;
 
   m_RandomNumberSeed = 0;
+  m_MetricRandomNumberSeed = 0;
 
   m_TransformMethodEnum = RIGID_TRANSFORM;
 
@@ -199,63 +206,20 @@ OptimizedImageToImageRegistrationMethod<TImage>
 template <class TImage>
 void
 OptimizedImageToImageRegistrationMethod<TImage>
-::GenerateData( void )
+::ComputeFixedImageIndexes( void )
 {
-  if( this->GetReportProgress() )
-    {
-    std::cout << "UPDATE START" << std::endl;
-    }
-
-  this->Initialize();
-
-  this->GetTransform()->SetParametersByValue(
-    this->GetInitialTransformParameters() );
-
-  typename MetricType::Pointer metric;
-
-  switch( this->GetMetricMethodEnum() )
-    {
-    case MATTES_MI_METRIC:
-        {
-        typedef MattesMutualInformationImageToImageMetric<TImage, TImage>
-          TypedMetricType;
-
-        typename TypedMetricType::Pointer typedMetric = TypedMetricType::New();
-
-        typedMetric->SetNumberOfHistogramBins( 100 );
-        // Shouldn't need to limit this call to cases of bspline transforms.
-        // if( m_MinimizeMemory && m_TransformMethodEnum == BSPLINE_TRANSFORM )
-        if( m_MinimizeMemory )
-          {
-          typedMetric->SetUseExplicitPDFDerivatives( false );
-          typedMetric->SetUseCachingOfBSplineWeights( false );
-          }
-        metric = typedMetric;
-        }
-      break;
-    case NORMALIZED_CORRELATION_METRIC:
-      metric = NormalizedCorrelationImageToImageMetric<TImage, TImage>::New();
-      break;
-    case MEAN_SQUARED_ERROR_METRIC:
-      metric = MeanSquaresImageToImageMetric<TImage, TImage>::New();
-      break;
-    }
-  if( m_RandomNumberSeed != 0 )
-    {
-    metric->ReinitializeSeed( m_RandomNumberSeed );
-    }
-  else
-    {
-    metric->ReinitializeSeed();
-    }
+  m_UseFixedImageIndexes = false;
+  m_FixedImageIndexes.clear();
 
   typename ImageType::ConstPointer fixedImage = this->GetFixedImage();
   typename ImageType::ConstPointer movingImage = this->GetMovingImage();
 
-  metric->SetFixedImage( fixedImage );
-  metric->SetMovingImage( movingImage );
-
-  metric->SetNumberOfSpatialSamples( m_NumberOfSamples );
+  if( this->GetSampleFromOverlap() &&
+      ( movingImage.IsNull() || this->GetTransform() == nullptr ) )
+    {
+    itkExceptionMacro( << "Sampling from overlap requires the moving image"
+      << " and the transform." );
+    }
 
   if( this->GetUseRegionOfInterest() ||
       this->GetSampleFromOverlap() ||
@@ -342,11 +306,9 @@ OptimizedImageToImageRegistrationMethod<TImage>
       itkWarningMacro(
          << "Adjusting the number of samples due to restrictive criteria.");
       this->SetNumberOfSamples( count );
-      metric->SetNumberOfSpatialSamples( m_NumberOfSamples );
       }
     double step = 0;
-    typename MetricType::FixedImageIndexContainer indexList;
-    indexList.clear();
+    FixedImageIndexContainer & indexList = m_FixedImageIndexes;
     for( iter.GoToBegin(); !iter.IsAtEnd(); ++iter )
       {
       index = iter.GetIndex();
@@ -398,9 +360,141 @@ OptimizedImageToImageRegistrationMethod<TImage>
       itkWarningMacro(<< "Full set of samples not collected. Collected "
                       << indexList.size() << " of " << m_NumberOfSamples );
       this->SetNumberOfSamples( indexList.size() );
-      metric->SetNumberOfSpatialSamples( m_NumberOfSamples );
       }
-    metric->SetFixedImageIndexes( indexList );
+    m_UseFixedImageIndexes = true;
+    }
+}
+
+template <class TImage>
+void
+OptimizedImageToImageRegistrationMethod<TImage>
+::SetFixedImageIndexes( const FixedImageIndexContainer & indexes )
+{
+  m_FixedImageIndexes = indexes;
+  m_UseFixedImageIndexes = true;
+  m_FixedImageIndexesArePreset = true;
+  this->Modified();
+}
+
+template <class TImage>
+void
+OptimizedImageToImageRegistrationMethod<TImage>
+::ClearFixedImageIndexes( void )
+{
+  m_FixedImageIndexes.clear();
+  m_UseFixedImageIndexes = false;
+  m_FixedImageIndexesArePreset = false;
+  this->Modified();
+}
+
+template <class TImage>
+void
+OptimizedImageToImageRegistrationMethod<TImage>
+::GenerateData( void )
+{
+  if( this->GetReportProgress() )
+    {
+    std::cout << "UPDATE START" << std::endl;
+    }
+
+  this->Initialize();
+
+  this->GetTransform()->SetParametersByValue(
+    this->GetInitialTransformParameters() );
+
+  // All metrics created by CreateMetric() share one seed, so that
+  //   candidate metrics used by the population optimizer sample the
+  //   same fixed image points as the main metric.
+  if( m_RandomNumberSeed != 0 )
+    {
+    m_MetricRandomNumberSeed = m_RandomNumberSeed;
+    }
+  else
+    {
+    typedef Statistics::MersenneTwisterRandomVariateGenerator
+      SeedGeneratorType;
+    SeedGeneratorType::Pointer seedGenerator = SeedGeneratorType::New();
+    seedGenerator->Initialize();
+    m_MetricRandomNumberSeed = static_cast<int>(
+      seedGenerator->GetIntegerVariate() & 0x7fffffff );
+    }
+
+  if( m_FixedImageIndexesArePreset )
+    {
+    if( m_FixedImageIndexes.size() != m_NumberOfSamples )
+      {
+      this->SetNumberOfSamples( m_FixedImageIndexes.size() );
+      }
+    }
+  else
+    {
+    this->ComputeFixedImageIndexes();
+    }
+
+  typename MetricType::Pointer metric = this->CreateMetric();
+
+  typename InterpolatorType::Pointer interpolator = this->CreateInterpolator();
+
+  try
+    {
+    this->Optimize(metric, interpolator);
+    }
+  catch( itk::ExceptionObject& exception )
+    {
+    std::cerr << "Optimization threw an exception." << std::endl;
+    std::cerr << exception << std::endl ;
+    }
+
+  if( this->GetReportProgress() )
+    {
+    std::cout << "UPDATE END" << std::endl;
+    }
+}
+
+template <class TImage>
+typename OptimizedImageToImageRegistrationMethod<TImage>::MetricType::Pointer
+OptimizedImageToImageRegistrationMethod<TImage>
+::CreateMetric( void )
+{
+  typename MetricType::Pointer metric;
+
+  switch( this->GetMetricMethodEnum() )
+    {
+    case MATTES_MI_METRIC:
+        {
+        typedef MattesMutualInformationImageToImageMetric<TImage, TImage>
+          TypedMetricType;
+
+        typename TypedMetricType::Pointer typedMetric = TypedMetricType::New();
+
+        typedMetric->SetNumberOfHistogramBins( 100 );
+        // Shouldn't need to limit this call to cases of bspline transforms.
+        // if( m_MinimizeMemory && m_TransformMethodEnum == BSPLINE_TRANSFORM )
+        if( m_MinimizeMemory )
+          {
+          typedMetric->SetUseExplicitPDFDerivatives( false );
+          typedMetric->SetUseCachingOfBSplineWeights( false );
+          }
+        metric = typedMetric;
+        }
+      break;
+    case NORMALIZED_CORRELATION_METRIC:
+      metric = NormalizedCorrelationImageToImageMetric<TImage, TImage>::New();
+      break;
+    case MEAN_SQUARED_ERROR_METRIC:
+      metric = MeanSquaresImageToImageMetric<TImage, TImage>::New();
+      break;
+    }
+  metric->ReinitializeSeed( m_MetricRandomNumberSeed );
+
+  metric->SetFixedImage( this->GetFixedImage() );
+  metric->SetMovingImage( this->GetMovingImage() );
+
+  metric->SetNumberOfSpatialSamples( m_NumberOfSamples );
+
+  if( m_UseFixedImageIndexes )
+    {
+    metric->SetFixedImageIndexes( m_FixedImageIndexes );
     }
 
   if( this->GetUseMovingImageMaskObject() )
@@ -412,6 +506,14 @@ OptimizedImageToImageRegistrationMethod<TImage>
       }
     }
 
+  return metric;
+}
+
+template <class TImage>
+typename OptimizedImageToImageRegistrationMethod<TImage>::InterpolatorType::Pointer
+OptimizedImageToImageRegistrationMethod<TImage>
+::CreateInterpolator( void )
+{
   typename InterpolatorType::Pointer interpolator;
 
   switch( this->GetInterpolationMethodEnum() )
@@ -434,20 +536,7 @@ OptimizedImageToImageRegistrationMethod<TImage>
     }
   interpolator->SetInputImage( this->GetMovingImage() );
 
-  try
-    {
-    this->Optimize(metric, interpolator);
-    }
-  catch( itk::ExceptionObject& exception )
-    {
-    std::cerr << "Optimization threw an exception." << std::endl;
-    std::cerr << exception << std::endl ;
-    }
-
-  if( this->GetReportProgress() )
-    {
-    std::cout << "UPDATE END" << std::endl;
-    }
+  return interpolator;
 }
 
 template <class TImage>
@@ -464,17 +553,88 @@ OptimizedImageToImageRegistrationMethod<TImage>
       std::cout << "EVOLUTIONARY START" << std::endl;
       }
 
-    typedef OnePlusOneEvolutionaryOptimizer EvoOptimizerType;
-    EvoOptimizerType::Pointer evoOpt = EvoOptimizerType::New();
+    SingleValuedNonLinearOptimizer::Pointer evoOpt;
+
+    // Candidate metrics, interpolators, and transforms must outlive the
+    //   registration update below.
+    std::vector< typename MetricType::Pointer >       candidateMetrics;
+    std::vector< typename InterpolatorType::Pointer > candidateInterpolators;
+    std::vector< typename TransformType::Pointer >    candidateTransforms;
 
-    evoOpt->SetNormalVariateGenerator( Statistics::NormalVariateGenerator
-                                       ::New() );
-    evoOpt->SetEpsilon( this->GetTargetError() );
-    evoOpt->Initialize( 0.1 );
-    evoOpt->SetCatchGetValueException( true );
-    evoOpt->SetMetricWorstPossibleValue( 100 );
-    evoOpt->SetScales( this->GetTransformParametersScales() );
-    evoOpt->SetMaximumIteration( this->GetMaxIterations() );
+    if( m_EvolutionaryPopulationSize > 1 )
+      {
+      typedef PopulationEvolutionaryOptimizer PopOptimizerType;
+      PopOptimizerType::Pointer popOpt = PopOptimizerType::New();
+
+      Statistics::NormalVariateGenerator::Pointer normalGenerator =
+        Statistics::NormalVariateGenerator::New();
+      if( m_RandomNumberSeed != 0 )
+        {
+        normalGenerator->Initialize( m_RandomNumberSeed );
+        }
+      popOpt->SetNormalVariateGenerator( normalGenerator );
+      popOpt->SetPopulationSize( m_EvolutionaryPopulationSize );
+      popOpt->SetEpsilon( this->GetTargetError() );
+      popOpt->SetInitialRadius( 0.1 );
+      popOpt->SetCatchGetValueException( true );
+      popOpt->SetMetricWorstPossibleValue( 100 );
+      popOpt->SetScales( this->GetTransformParametersScales() );
+      popOpt->SetMaximumIteration( this->GetMaxIterations() );
+
+      // One metric per worker; each is single-threaded since the
+      //   parallelism comes from evaluating candidates concurrently.
+      unsigned int numberOfWorkers = this->GetRegistrationNumberOfWorkUnits();
+      if( numberOfWorkers > m_EvolutionaryPopulationSize )
+        {
+        numberOfWorkers = m_EvolutionaryPopulationSize;
+        }
+      if( numberOfWorkers > 1 )
+        {
+        for( unsigned int w = 0; w < numberOfWorkers; ++w )
+          {
+          typename TransformType::Pointer candidateTransform =
+            this->GetTransform()->Clone();
+          typename InterpolatorType::Pointer candidateInterpolator =
+            this->CreateInterpolator();
+          typename MetricType::Pointer candidateMetric =
+            this->CreateMetric();
+          candidateMetric->SetNumberOfWorkUnits( 1 );
+          candidateMetric->SetTransform( candidateTransform );
+          candidateMetric->SetInterpolator( candidateInterpolator );
+          candidateMetric->SetFixedImageRegion( this->GetFixedImage()
+            ->GetLargestPossibleRegion() );
+          candidateMetric->Initialize();
+
+          candidateTransforms.push_back( candidateTransform );
+          candidateInterpolators.push_back( candidateInterpolator );
+          candidateMetrics.push_back( candidateMetric );
+          popOpt->AddCandidateCostFunction( candidateMetric );
+          }
+        }
+      if( this->GetReportProgress() )
+        {
+        std::cout << "   Population = " << m_EvolutionaryPopulationSize
+          << ", workers = " << candidateMetrics.size() << std::endl;
+        }
+
+      evoOpt = popOpt;
+      }
+    else
+      {
+      typedef OnePlusOneEvolutionaryOptimizer EvoOptimizerType;
+      EvoOptimizerType::Pointer onePlusOneOpt = EvoOptimizerType::New();
+
+      onePlusOneOpt->SetNormalVariateGenerator(
+        Statistics::NormalVariateGenerator::New() );
+      onePlusOneOpt->SetEpsilon( this->GetTargetError() );
+      onePlusOneOpt->Initialize( 0.1 );
+      onePlusOneOpt->SetCatchGetValueException( true );
+      onePlusOneOpt->SetMetricWorstPossibleValue( 100 );
+      onePlusOneOpt->SetScales( this->GetTransformParametersScales() );
+      onePlusOneOpt->SetMaximumIteration( this->GetMaxIterations() );
+
+      evoOpt = onePlusOneOpt;
+      }
 
     if( this->GetObserver() )
       {
@@ -675,6 +835,9 @@ OptimizedImageToImageRegistrationMethod<TImage>
   os << indent << "Use Evolutionary Optimization = " <<
     m_UseEvolutionaryOptimization << std::endl;
 
+  os << indent << "Evolutionary Population Size = " <<
+    m_EvolutionaryPopulationSize << std::endl;
+
   os << indent << "Sample From Overlap = " << m_SampleFromOverlap << std::endl;
 
   os << indent << "Minimize Memory = " << m_MinimizeMemory << std::endl;
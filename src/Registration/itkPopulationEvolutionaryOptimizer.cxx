@@ -0,0 +1,355 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright Kitware Inc.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#include "itkPopulationEvolutionaryOptimizer.h"
+
+#include "itkMultiThreaderBase.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace itk
+{
+
+PopulationEvolutionaryOptimizer
+::PopulationEvolutionaryOptimizer( void )
+{
+  m_Maximize = false;
+  m_PopulationSize = 12;
+  m_MaximumIteration = 100;
+  m_InitialRadius = 1.0;
+  m_Epsilon = 1e-6;
+
+  m_CatchGetValueException = false;
+  m_MetricWorstPossibleValue = 0;
+
+  m_RandomGenerator = NormalVariateGeneratorType::New();
+
+  m_Stop = false;
+  m_CurrentIteration = 0;
+  m_CurrentCost = 0;
+  m_StepSize = 0;
+
+  m_StopConditionDescription << this->GetNameOfClass() << ": ";
+}
+
+PopulationEvolutionaryOptimizer
+::~PopulationEvolutionaryOptimizer( void )
+{
+}
+
+void
+PopulationEvolutionaryOptimizer
+::SetNormalVariateGenerator( NormalVariateGeneratorType * generator )
+{
+  if( m_RandomGenerator != generator )
+    {
+    m_RandomGenerator = generator;
+    this->Modified();
+    }
+}
+
+void
+PopulationEvolutionaryOptimizer
+::AddCandidateCostFunction( CostFunctionType * costFunction )
+{
+  m_CandidateCostFunctions.push_back( costFunction );
+  this->Modified();
+}
+
+void
+PopulationEvolutionaryOptimizer
+::ClearCandidateCostFunctions( void )
+{
+  m_CandidateCostFunctions.clear();
+  this->Modified();
+}
+
+unsigned int
+PopulationEvolutionaryOptimizer
+::GetNumberOfCandidateCostFunctions( void ) const
+{
+  return static_cast< unsigned int >( m_CandidateCostFunctions.size() );
+}
+
+bool
+PopulationEvolutionaryOptimizer
+::IsBetter( MeasureType a, MeasureType b ) const
+{
+  return m_Maximize ? ( a > b ) : ( a < b );
+}
+
+void
+PopulationEvolutionaryOptimizer
+::EvaluatePopulation( const std::vector< ParametersType > & candidates,
+  std::vector< MeasureType > & values )
+{
+  const unsigned int numberOfCandidates =
+    static_cast< unsigned int >( candidates.size() );
+  values.resize( numberOfCandidates );
+
+  // Each slot owns one cost function ( and therefore one transform and
+  //   one interpolator ), so slots never share state.
+  std::vector< const CostFunctionType * > slots;
+  if( m_CandidateCostFunctions.empty() )
+    {
+    slots.push_back( this->GetCostFunction() );
+    }
+  else
+    {
+    for( unsigned int i = 0; i < m_CandidateCostFunctions.size(); ++i )
+      {
+      slots.push_back( m_CandidateCostFunctions[i].GetPointer() );
+      }
+    }
+  const unsigned int numberOfSlots =
+    std::min( static_cast< unsigned int >( slots.size() ),
+      numberOfCandidates );
+
+  std::vector< std::string > errors( numberOfSlots );
+
+  auto evaluateSlot = [&]( SizeValueType slot )
+    {
+    for( unsigned int k = static_cast< unsigned int >( slot );
+      k < numberOfCandidates; k += numberOfSlots )
+      {
+      try
+        {
+        values[k] = slots[slot]->GetValue( candidates[k] );
+        }
+      catch( ExceptionObject & err )
+        {
+        values[k] = m_MetricWorstPossibleValue;
+        if( !m_CatchGetValueException && errors[slot].empty() )
+          {
+          errors[slot] = err.what();
+          }
+        }
+      }
+    };
+
+  if( numberOfSlots == 1 )
+    {
+    evaluateSlot( 0 );
+    }
+  else
+    {
+    MultiThreaderBase::Pointer threader = MultiThreaderBase::New();
+    threader->SetNumberOfWorkUnits( numberOfSlots );
+    threader->ParallelizeArray( 0, numberOfSlots, evaluateSlot, nullptr );
+    }
+
+  for( unsigned int slot = 0; slot < numberOfSlots; ++slot )
+    {
+    if( !errors[slot].empty() )
+      {
+      itkExceptionMacro( << "Candidate evaluation failed: "
+        << errors[slot] );
+      }
+    }
+}
+
+void
+PopulationEvolutionaryOptimizer
+::StartOptimization( void )
+{
+  if( this->GetCostFunction() == nullptr )
+    {
+    itkExceptionMacro( << "Cost function must be set" );
+    }
+
+  const unsigned int spaceDimension =
+    this->GetCostFunction()->GetNumberOfParameters();
+
+  ScalesType scales( spaceDimension );
+  scales.Fill( 1.0 );
+  if( this->GetScales().size() == spaceDimension )
+    {
+    scales = this->GetScales();
+    }
+
+  // Recombination weights and step-size adaptation constants follow the
+  //   standard choices for a ( mu/mu_w, lambda )-ES with cumulative
+  //   step-size adaptation.
+  const unsigned int lambda = m_PopulationSize;
+  const unsigned int mu = std::max( lambda / 2, 1u );
+
+  std::vector< double > weights( mu );
+  for( unsigned int i = 0; i < mu; ++i )
+    {
+    weights[i] = std::log( mu + 0.5 ) - std::log( i + 1.0 );
+    }
+  const double weightSum = std::accumulate( weights.begin(),
+    weights.end(), 0.0 );
+  double weightSquaredSum = 0;
+  for( unsigned int i = 0; i < mu; ++i )
+    {
+    weights[i] /= weightSum;
+    weightSquaredSum += weights[i] * weights[i];
+    }
+  const double muEff = 1.0 / weightSquaredSum;
+
+  const double n = spaceDimension;
+  const double cSigma = ( muEff + 2 ) / ( n + muEff + 5 );
+  const double dSigma = 1 + cSigma + 2 * std::max( 0.0,
+    std::sqrt( ( muEff - 1 ) / ( n + 1 ) ) - 1 );
+  const double chiN = std::sqrt( n ) * ( 1 - 1 / ( 4 * n )
+    + 1 / ( 21 * n * n ) );
+  const double pathFactor = std::sqrt( cSigma * ( 2 - cSigma ) * muEff );
+
+  m_Stop = false;
+  m_CurrentIteration = 0;
+  m_StepSize = m_InitialRadius;
+  m_StopConditionDescription.str( "" );
+  m_StopConditionDescription << this->GetNameOfClass() << ": ";
+
+  ParametersType mean = this->GetInitialPosition();
+  this->SetCurrentPosition( mean );
+  try
+    {
+    m_CurrentCost = this->GetCostFunction()->GetValue( mean );
+    }
+  catch( ExceptionObject & )
+    {
+    if( !m_CatchGetValueException )
+      {
+      throw;
+      }
+    m_CurrentCost = m_MetricWorstPossibleValue;
+    }
+
+  std::vector< ParametersType > candidates( lambda,
+    ParametersType( spaceDimension ) );
+  std::vector< vnl_vector< double > > samples( lambda,
+    vnl_vector< double >( spaceDimension ) );
+  std::vector< MeasureType > values( lambda );
+  std::vector< unsigned int > order( lambda );
+  vnl_vector< double > evolutionPath( spaceDimension, 0.0 );
+  vnl_vector< double > sampleMean( spaceDimension );
+
+  this->InvokeEvent( StartEvent() );
+
+  while( !m_Stop )
+    {
+    if( m_CurrentIteration >= m_MaximumIteration )
+      {
+      m_StopConditionDescription << "Maximum number of iterations ("
+        << m_MaximumIteration << ") exceeded.";
+      break;
+      }
+
+    // Draw serially so that the sequence is reproducible
+    for( unsigned int k = 0; k < lambda; ++k )
+      {
+      for( unsigned int i = 0; i < spaceDimension; ++i )
+        {
+        samples[k][i] = m_RandomGenerator->GetVariate();
+        candidates[k][i] = mean[i] + m_StepSize * samples[k][i] / scales[i];
+        }
+      }
+
+    this->EvaluatePopulation( candidates, values );
+
+    std::iota( order.begin(), order.end(), 0u );
+    std::stable_sort( order.begin(), order.end(),
+      [&]( unsigned int a, unsigned int b )
+        { return this->IsBetter( values[a], values[b] ); } );
+
+    if( this->IsBetter( values[order[0]], m_CurrentCost ) )
+      {
+      m_CurrentCost = values[order[0]];
+      this->SetCurrentPosition( candidates[order[0]] );
+      }
+
+    sampleMean.fill( 0 );
+    for( unsigned int i = 0; i < mu; ++i )
+      {
+      sampleMean += weights[i] * samples[order[i]];
+      }
+    for( unsigned int i = 0; i < spaceDimension; ++i )
+      {
+      mean[i] += m_StepSize * sampleMean[i] / scales[i];
+      }
+
+    evolutionPath = ( 1 - cSigma ) * evolutionPath
+      + pathFactor * sampleMean;
+    m_StepSize *= std::exp( ( cSigma / dSigma )
+      * ( evolutionPath.magnitude() / chiN - 1 ) );
+
+    ++m_CurrentIteration;
+    this->InvokeEvent( IterationEvent() );
+
+    if( m_StepSize < m_Epsilon )
+      {
+      m_StopConditionDescription << "Step size (" << m_StepSize
+        << ") is less than epsilon (" << m_Epsilon << ") at iteration "
+        << m_CurrentIteration << ".";
+      break;
+      }
+    }
+
+  if( m_Stop )
+    {
+    m_StopConditionDescription << "StopOptimization() called.";
+    }
+
+  this->InvokeEvent( EndEvent() );
+}
+
+void
+PopulationEvolutionaryOptimizer
+::StopOptimization( void )
+{
+  m_Stop = true;
+}
+
+const std::string
+PopulationEvolutionaryOptimizer
+::GetStopConditionDescription( void ) const
+{
+  return m_StopConditionDescription.str();
+}
+
+void
+PopulationEvolutionaryOptimizer
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "Maximize = " << m_Maximize << std::endl;
+  os << indent << "Population Size = " << m_PopulationSize << std::endl;
+  os << indent << "Maximum Iteration = " << m_MaximumIteration << std::endl;
+  os << indent << "Initial Radius = " << m_InitialRadius << std::endl;
+  os << indent << "Epsilon = " << m_Epsilon << std::endl;
+  os << indent << "Catch GetValue Exception = "
+     << m_CatchGetValueException << std::endl;
+  os << indent << "Metric Worst Possible Value = "
+     << m_MetricWorstPossibleValue << std::endl;
+  os << indent << "Number of Candidate Cost Functions = "
+     << m_CandidateCostFunctions.size() << std::endl;
+  os << indent << "Current Iteration = " << m_CurrentIteration << std::endl;
+  os << indent << "Current Cost = " << m_CurrentCost << std::endl;
+  os << indent << "Step Size = " << m_StepSize << std::endl;
+}
+
+}
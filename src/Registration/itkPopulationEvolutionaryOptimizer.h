@@ -0,0 +1,169 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright Kitware Inc.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#ifndef __itkPopulationEvolutionaryOptimizer_h
+#define __itkPopulationEvolutionaryOptimizer_h
+
+#include "itkSingleValuedNonLinearOptimizer.h"
+#include "itkNormalVariateGenerator.h"
+
+#include <sstream>
+#include <vector>
+
+namespace itk
+{
+
+/** \class PopulationEvolutionaryOptimizer
+ * \brief ( mu/mu_w, lambda ) evolution strategy that evaluates each
+ * generation of candidate parameters concurrently.
+ *
+ * Every generation draws PopulationSize candidates around the current
+ * mean, evaluates them, and moves the mean to the weighted average of
+ * the best half.  The step size is adapted by cumulative step-size
+ * adaptation.  As with OnePlusOneEvolutionaryOptimizer, the search
+ * radius along parameter i is StepSize / Scales[i].
+ *
+ * Candidates are evaluated concurrently when independent cost functions
+ * are given via AddCandidateCostFunction(); each of those cost functions
+ * must own its transform and interpolator.  Without them, candidates are
+ * evaluated serially using the cost function set by SetCostFunction().
+ *
+ * The current position is the best candidate seen so far.
+ *
+ * \sa OnePlusOneEvolutionaryOptimizer
+ */
+class PopulationEvolutionaryOptimizer
+  : public SingleValuedNonLinearOptimizer
+{
+public:
+
+  typedef PopulationEvolutionaryOptimizer Self;
+  typedef SingleValuedNonLinearOptimizer  Superclass;
+  typedef SmartPointer<Self>              Pointer;
+  typedef SmartPointer<const Self>        ConstPointer;
+
+  itkNewMacro( Self );
+
+  itkTypeMacro( PopulationEvolutionaryOptimizer,
+                SingleValuedNonLinearOptimizer );
+
+  typedef Statistics::NormalVariateGenerator NormalVariateGeneratorType;
+
+  typedef std::vector< CostFunctionType::Pointer > CostFunctionListType;
+
+  itkSetMacro( Maximize, bool );
+  itkGetConstReferenceMacro( Maximize, bool );
+  itkBooleanMacro( Maximize );
+
+  /** Number of candidates ( lambda ) drawn per generation. */
+  itkSetClampMacro( PopulationSize, unsigned int, 2,
+    NumericTraits<unsigned int>::max() );
+  itkGetConstMacro( PopulationSize, unsigned int );
+
+  itkSetMacro( MaximumIteration, unsigned int );
+  itkGetConstReferenceMacro( MaximumIteration, unsigned int );
+
+  itkSetMacro( InitialRadius, double );
+  itkGetConstReferenceMacro( InitialRadius, double );
+
+  /** Optimization stops when the step size falls below Epsilon. */
+  itkSetMacro( Epsilon, double );
+  itkGetConstReferenceMacro( Epsilon, double );
+
+  itkSetMacro( CatchGetValueException, bool );
+  itkGetConstMacro( CatchGetValueException, bool );
+
+  itkSetMacro( MetricWorstPossibleValue, double );
+  itkGetConstMacro( MetricWorstPossibleValue, double );
+
+  void SetNormalVariateGenerator( NormalVariateGeneratorType * generator );
+
+  /** Cost functions used to evaluate candidates concurrently.  The
+   * candidates of a generation are distributed round-robin over them. */
+  void AddCandidateCostFunction( CostFunctionType * costFunction );
+
+  void ClearCandidateCostFunctions( void );
+
+  unsigned int GetNumberOfCandidateCostFunctions( void ) const;
+
+  itkGetConstReferenceMacro( CurrentIteration, unsigned int );
+
+  itkGetConstReferenceMacro( CurrentCost, MeasureType );
+
+  itkGetConstReferenceMacro( StepSize, double );
+
+  MeasureType GetValue( void ) const
+    { return this->GetCurrentCost(); }
+
+  using Superclass::GetValue;
+
+  void StartOptimization( void ) override;
+
+  void StopOptimization( void );
+
+  const std::string GetStopConditionDescription( void ) const override;
+
+protected:
+
+  PopulationEvolutionaryOptimizer( void );
+  virtual ~PopulationEvolutionaryOptimizer( void );
+
+  void PrintSelf( std::ostream & os, Indent indent ) const override;
+
+  /** Fill values[k] with the cost of candidates[k]. */
+  void EvaluatePopulation( const std::vector< ParametersType > & candidates,
+    std::vector< MeasureType > & values );
+
+private:
+
+  // Purposely not implemented
+  PopulationEvolutionaryOptimizer( const Self & );
+  // Purposely not implemented
+  void operator =( const Self & );
+
+  bool IsBetter( MeasureType a, MeasureType b ) const;
+
+  bool         m_Maximize;
+  unsigned int m_PopulationSize;
+  unsigned int m_MaximumIteration;
+  double       m_InitialRadius;
+  double       m_Epsilon;
+
+  bool   m_CatchGetValueException;
+  double m_MetricWorstPossibleValue;
+
+  NormalVariateGeneratorType::Pointer m_RandomGenerator;
+
+  CostFunctionListType m_CandidateCostFunctions;
+
+  bool         m_Stop;
+  unsigned int m_CurrentIteration;
+  MeasureType  m_CurrentCost;
+  double       m_StepSize;
+
+  std::ostringstream m_StopConditionDescription;
+
+};
+
+}
+
+#endif
@@ -62,6 +62,9 @@ public:
   itkStaticConstMacro( ImageDimension, unsigned int, TImage::ImageDimension );
 
   typedef AffineTransform< double, ImageDimension >          TransformType;
+  typedef Transform< double, ImageDimension, ImageDimension >
+                                                             TransformBaseType;
+  typedef typename ImageType::RegionType                     RegionType;
 
   /** Set input image 1 */
   virtual void SetInput1( const ImageType * image );
@@ -136,6 +139,22 @@ public:
   /** Get use of experimental method for fast blending */
   itkGetMacro( UseFastBlending, bool );
 
+  /** Set if registration and blending are restricted to the overlap of
+   *  the images, plus OverlapMargin voxels.  The images are then only
+   *  resampled where the second image lands, and copied elsewhere, so the
+   *  cost follows the seam rather than the whole output. */
+  itkSetMacro( RestrictToOverlap, bool );
+
+  /** Get if registration and blending are restricted to the overlap */
+  itkGetMacro( RestrictToOverlap, bool );
+
+  /** Set margin, in voxels, added around the overlap when restricted;
+   *  should exceed the expected misalignment */
+  itkSetMacro( OverlapMargin, unsigned int );
+
+  /** Get margin, in voxels, added around the overlap when restricted */
+  itkGetMacro( OverlapMargin, unsigned int );
+
   /** Set filename to load the transform from */
   void LoadTransform( const std::string & filename );
 
@@ -144,6 +163,17 @@ public:
   /** Get output image */
   itkGetModifiableObjectMacro( Output, ImageType );
 
+  /** Bounding box, in the index space of toImage, of region of fromImage
+   *  mapped by transform ( identity if null ) */
+  static RegionType MapRegion( const ImageType * fromImage,
+    const RegionType & region, const ImageType * toImage,
+    const TransformBaseType * transform );
+
+  /** Pad region by margin and crop it to bounds.  The region is empty if
+   *  it does not intersect bounds. */
+  static RegionType PadAndCropRegion( const RegionType & region,
+    unsigned int margin, const RegionType & bounds );
+
 protected:
   MergeAdjacentImagesFilter( void );
   virtual ~MergeAdjacentImagesFilter( void ) {}
@@ -155,6 +185,11 @@ private:
   MergeAdjacentImagesFilter( const Self & );
   void operator = ( const Self & );
 
+  /** Split the part of outer that is not in inner, which it contains,
+   *  into blocks */
+  static void SubtractRegion( const RegionType & outer,
+    const RegionType & inner, std::vector< RegionType > & blocks );
+
   typename TImage::PixelType             m_Background;
   bool                                   m_MaskZero;
   unsigned int                           m_MaxIterations;
@@ -164,6 +199,8 @@ private:
   double                                 m_SamplingRatio;
   bool                                   m_BlendUsingAverage;
   bool                                   m_UseFastBlending;
+  bool                                   m_RestrictToOverlap;
+  unsigned int                           m_OverlapMargin;
 
   typename TransformType::ConstPointer   m_InitialTransform;
   typename TransformType::ConstPointer   m_OutputTransform;
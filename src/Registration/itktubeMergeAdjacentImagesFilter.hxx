@@ -24,13 +24,21 @@ limitations under the License.
 
 // ITK includes
 #include <itkBinaryThresholdImageFilter.h>
+#include <itkContinuousIndex.h>
+#include <itkExtractImageFilter.h>
+#include <itkImageRegionConstIterator.h>
 #include <itkImageRegionConstIteratorWithIndex.h>
+#include <itkImageRegionIterator.h>
 #include <itkImageToImageRegistrationHelper.h>
 #include <itkSignedDanielssonDistanceMapImageFilter.h>
 #include <itkTimeProbesCollectorBase.h>
 
 // TubeTK includes
 #include "itkGeneralizedDistanceTransformImageFilter.h"
+#include "tubeMessage.h"
+
+#include <algorithm>
+#include <cmath>
 
 namespace itk
 {
@@ -50,6 +58,8 @@ MergeAdjacentImagesFilter< TImage >
   m_SamplingRatio = 0.01;
   m_BlendUsingAverage = false;
   m_UseFastBlending = false;
+  m_RestrictToOverlap = false;
+  m_OverlapMargin = 10;
 
   m_InitialTransform = nullptr;
   m_OutputTransform = nullptr;
@@ -104,6 +114,110 @@ MergeAdjacentImagesFilter< TImage >
   os << "SamplingRatio: " << m_SamplingRatio << std::endl;
   os << "BlendUsingAverage: " << m_BlendUsingAverage << std::endl;
   os << "UseFastBlending: " << m_UseFastBlending << std::endl;
+  os << "RestrictToOverlap: " << m_RestrictToOverlap << std::endl;
+  os << "OverlapMargin: " << m_OverlapMargin << std::endl;
+}
+
+template< class TImage >
+typename MergeAdjacentImagesFilter< TImage >::RegionType
+MergeAdjacentImagesFilter< TImage >
+::MapRegion( const ImageType * fromImage, const RegionType & region,
+  const ImageType * toImage, const TransformBaseType * transform )
+{
+  typename ImageType::IndexType minX;
+  typename ImageType::IndexType maxX;
+  minX.Fill( NumericTraits< IndexValueType >::max() );
+  maxX.Fill( NumericTraits< IndexValueType >::NonpositiveMin() );
+  for( unsigned int c = 0; c < ( 1u << ImageDimension ); c++ )
+    {
+    typename ImageType::IndexType corner = region.GetIndex();
+    for( unsigned int i = 0; i < ImageDimension; i++ )
+      {
+      if( ( c >> i ) & 1 )
+        {
+        corner[i] += region.GetSize()[i] - 1;
+        }
+      }
+    typename ImageType::PointType pointX;
+    fromImage->TransformIndexToPhysicalPoint( corner, pointX );
+    if( transform != nullptr )
+      {
+      pointX = transform->TransformPoint( pointX );
+      }
+    ContinuousIndex< double, ImageDimension > cIndx;
+    toImage->TransformPhysicalPointToContinuousIndex( pointX, cIndx );
+    for( unsigned int i = 0; i < ImageDimension; i++ )
+      {
+      minX[i] = std::min( minX[i],
+        static_cast< IndexValueType >( std::floor( cIndx[i] ) ) );
+      maxX[i] = std::max( maxX[i],
+        static_cast< IndexValueType >( std::ceil( cIndx[i] ) ) );
+      }
+    }
+
+  RegionType mapped;
+  mapped.SetIndex( minX );
+  for( unsigned int i = 0; i < ImageDimension; i++ )
+    {
+    mapped.SetSize( i, maxX[i] - minX[i] + 1 );
+    }
+  return mapped;
+}
+
+template< class TImage >
+typename MergeAdjacentImagesFilter< TImage >::RegionType
+MergeAdjacentImagesFilter< TImage >
+::PadAndCropRegion( const RegionType & region, unsigned int margin,
+  const RegionType & bounds )
+{
+  RegionType padded = region;
+  padded.PadByRadius( margin );
+  if( !padded.Crop( bounds ) )
+    {
+    padded = RegionType();
+    padded.SetIndex( bounds.GetIndex() );
+    }
+  return padded;
+}
+
+template< class TImage >
+void
+MergeAdjacentImagesFilter< TImage >
+::SubtractRegion( const RegionType & outer, const RegionType & inner,
+  std::vector< RegionType > & blocks )
+{
+  blocks.clear();
+  if( inner.GetNumberOfPixels() == 0 )
+    {
+    blocks.push_back( outer );
+    return;
+    }
+
+  // Slabs before and after inner along each axis, limited along the
+  //   previous axes to the extent of inner
+  RegionType remaining = outer;
+  for( unsigned int i = 0; i < ImageDimension; i++ )
+    {
+    const IndexValueType innerMin = inner.GetIndex()[i];
+    const IndexValueType innerMax = innerMin + inner.GetSize()[i];
+    const IndexValueType outerMin = remaining.GetIndex()[i];
+    const IndexValueType outerMax = outerMin + remaining.GetSize()[i];
+    if( innerMin > outerMin )
+      {
+      RegionType block = remaining;
+      block.SetSize( i, innerMin - outerMin );
+      blocks.push_back( block );
+      }
+    if( outerMax > innerMax )
+      {
+      RegionType block = remaining;
+      block.SetIndex( i, innerMax );
+      block.SetSize( i, outerMax - innerMax );
+      blocks.push_back( block );
+      }
+    remaining.SetIndex( i, innerMin );
+    remaining.SetSize( i, inner.GetSize()[i] );
+    }
 }
 
 template< class TImage >
@@ -288,17 +402,19 @@ MergeAdjacentImagesFilter< TImage >
   m_Output->Allocate();
   m_Output->FillBuffer( m_Background );
 
-  itk::ImageRegionConstIteratorWithIndex< ImageType > iter( m_Input1,
+  itk::ImageRegionConstIterator< ImageType > iter( m_Input1,
+    m_Input1->GetLargestPossibleRegion() );
+  itk::ImageRegionIterator< ImageType > iterOut1( m_Output,
     m_Input1->GetLargestPossibleRegion() );
   while( !iter.IsAtEnd() )
     {
-    typename ImageType::IndexType indexX = iter.GetIndex();
     double tf = iter.Get();
     if( !m_MaskZero || tf != 0 )
       {
-      m_Output->SetPixel( indexX, tf );
+      iterOut1.Set( tf );
       }
     ++iter;
+    ++iterOut1;
     }
 
   // timeCollector.Stop( "Allocate output image" );
@@ -307,8 +423,54 @@ MergeAdjacentImagesFilter< TImage >
   typedef typename itk::ImageToImageRegistrationHelper< ImageType >
     RegFilterType;
   typename RegFilterType::Pointer regOp = RegFilterType::New();
-  regOp->SetFixedImage( m_Input1 );
-  regOp->SetMovingImage( m_Input2 );
+
+  // When restricted, register only the parts of the images that overlap,
+  //   given the initial transform, plus a margin
+  typename ImageType::ConstPointer fixedImage = m_Input1;
+  typename ImageType::ConstPointer movingImage = m_Input2;
+  if( m_RestrictToOverlap && m_MaxIterations > 0 )
+    {
+    typename TransformBaseType::ConstPointer toInput1 = nullptr;
+    if( m_InitialTransform.IsNotNull() )
+      {
+      toInput1 = m_InitialTransform->GetInverseTransform().GetPointer();
+      }
+    RegionType overlap1 = PadAndCropRegion( MapRegion( m_Input2,
+      m_Input2->GetLargestPossibleRegion(), m_Input1, toInput1 ),
+      m_OverlapMargin, m_Input1->GetLargestPossibleRegion() );
+    RegionType overlap2;
+    if( overlap1.GetNumberOfPixels() > 0 )
+      {
+      overlap2 = PadAndCropRegion( MapRegion( m_Input1, overlap1,
+        m_Input2, m_InitialTransform ), m_OverlapMargin,
+        m_Input2->GetLargestPossibleRegion() );
+      }
+    if( overlap2.GetNumberOfPixels() > 0 )
+      {
+      typedef ExtractImageFilter< ImageType, ImageType > ExtractFilterType;
+      typename ExtractFilterType::Pointer extract1 =
+        ExtractFilterType::New();
+      extract1->SetInput( m_Input1 );
+      extract1->SetExtractionRegion( overlap1 );
+      extract1->Update();
+      fixedImage = extract1->GetOutput();
+
+      typename ExtractFilterType::Pointer extract2 =
+        ExtractFilterType::New();
+      extract2->SetInput( m_Input2 );
+      extract2->SetExtractionRegion( overlap2 );
+      extract2->Update();
+      movingImage = extract2->GetOutput();
+      }
+    else
+      {
+      ::tube::WarningMessage(
+        "Images do not overlap, registering whole images" );
+      }
+    }
+
+  regOp->SetFixedImage( fixedImage );
+  regOp->SetMovingImage( movingImage );
   regOp->SetSampleFromOverlap( true );
   regOp->SetEnableLoadedRegistration( false );
   regOp->SetEnableInitialRegistration( false );
@@ -344,7 +506,28 @@ MergeAdjacentImagesFilter< TImage >
 
   // timeCollector.Start( "Resample Image" );
 
-  regOp->SetFixedImage( m_Output );
+  // When restricted, resample only where the second image lands
+  RegionType regionTmp = regionOut;
+  if( m_RestrictToOverlap )
+    {
+    regionTmp = PadAndCropRegion( MapRegion( m_Input2,
+      m_Input2->GetLargestPossibleRegion(), m_Output,
+      m_OutputTransform->GetInverseTransform().GetPointer() ), 1,
+      regionOut );
+    if( regionTmp.GetNumberOfPixels() == 0 )
+      {
+      return;
+      }
+
+    typename ImageType::Pointer reference = ImageType::New();
+    reference->CopyInformation( m_Output );
+    reference->SetRegions( regionTmp );
+    regOp->SetFixedImage( reference );
+    }
+  else
+    {
+    regOp->SetFixedImage( m_Output );
+    }
 
   tmpImage = regOp->ResampleImage(
     RegFilterType::OptimizedRegistrationMethodType::LINEAR_INTERPOLATION,
@@ -356,10 +539,10 @@ MergeAdjacentImagesFilter< TImage >
   if( m_BlendUsingAverage )
     {
     itk::ImageRegionConstIteratorWithIndex< ImageType > iter2( tmpImage,
-      tmpImage->GetLargestPossibleRegion() );
+      regionTmp );
 
     itk::ImageRegionIteratorWithIndex< ImageType > iterOut( m_Output,
-      m_Output->GetLargestPossibleRegion() );
+      regionTmp );
 
     while( !iter2.IsAtEnd() )
       {
@@ -396,31 +579,77 @@ MergeAdjacentImagesFilter< TImage >
     }
   else
     {
+    // When restricted, blending weights are only computed over the overlap
+    //   of the images plus a margin; the rest of the second image is copied
+    //   where the first one is missing
+    RegionType regionBlend = regionTmp;
+    if( m_RestrictToOverlap )
+      {
+      RegionType overlap = regionTmp;
+      if( overlap.Crop( m_Input1->GetLargestPossibleRegion() ) )
+        {
+        regionBlend = PadAndCropRegion( overlap, m_OverlapMargin,
+          regionTmp );
+        }
+      else
+        {
+        regionBlend = RegionType();
+        regionBlend.SetIndex( regionTmp.GetIndex() );
+        }
+
+      std::vector< RegionType > blocks;
+      SubtractRegion( regionTmp, regionBlend, blocks );
+      for( unsigned int b = 0; b < blocks.size(); ++b )
+        {
+        itk::ImageRegionConstIterator< ImageType > iterTmp( tmpImage,
+          blocks[b] );
+        itk::ImageRegionIterator< ImageType > iterOut( m_Output,
+          blocks[b] );
+        while( !iterTmp.IsAtEnd() )
+          {
+          double iVal = iterTmp.Get();
+          double oVal = iterOut.Get();
+          if( ( oVal == m_Background || ( m_MaskZero && oVal == 0 ) )
+            && iVal != m_Background && ( !m_MaskZero || iVal != 0 ) )
+            {
+            iterOut.Set( iVal );
+            }
+          ++iterTmp;
+          ++iterOut;
+          }
+        }
+
+      if( regionBlend.GetNumberOfPixels() == 0 )
+        {
+        return;
+        }
+      }
+
     // timeCollector.Start( "Resample Image2" );
 
     typename ImageType::Pointer input2Reg = ImageType::New();
     input2Reg->CopyInformation( tmpImage );
-    input2Reg->SetRegions( tmpImage->GetLargestPossibleRegion() );
+    input2Reg->SetRegions( regionBlend );
     input2Reg->Allocate();
     input2Reg->FillBuffer( m_Background );
 
     typename FloatImageType::Pointer outputMap = FloatImageType::New();
     outputMap->CopyInformation( tmpImage );
-    outputMap->SetRegions( tmpImage->GetLargestPossibleRegion() );
+    outputMap->SetRegions( regionBlend );
     outputMap->Allocate();
     outputMap->FillBuffer( 3 );
 
     itk::ImageRegionConstIteratorWithIndex< ImageType > iterTmp( tmpImage,
-      tmpImage->GetLargestPossibleRegion() );
+      regionBlend );
 
     itk::ImageRegionIteratorWithIndex< ImageType > iter2( input2Reg,
-      input2Reg->GetLargestPossibleRegion() );
+      regionBlend );
 
     itk::ImageRegionIteratorWithIndex< ImageType > iterOut( m_Output,
-      m_Output->GetLargestPossibleRegion() );
+      regionBlend );
 
     itk::ImageRegionIteratorWithIndex< FloatImageType > iterOutMap( outputMap,
-      outputMap->GetLargestPossibleRegion() );
+      regionBlend );
 
     while( !iter2.IsAtEnd() )
       {
@@ -504,7 +733,7 @@ MergeAdjacentImagesFilter< TImage >
 
     typename FloatImageType::Pointer vorImageMap = FloatImageType::New();
     vorImageMap->CopyInformation( m_Output );
-    vorImageMap->SetRegions( m_Output->GetLargestPossibleRegion() );
+    vorImageMap->SetRegions( regionBlend );
     vorImageMap->Allocate();
     vorImageMap->FillBuffer( 1 );
     itk::ImageRegionConstIteratorWithIndex< FloatImageType > iterOutVor(
@@ -0,0 +1,231 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright Kitware Inc.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+#ifndef __itktubeMosaicImagesFilter_h
+#define __itktubeMosaicImagesFilter_h
+
+// standard includes
+#include <vector>
+
+// ITK includes
+#include <itkMacro.h>
+#include <itkObject.h>
+#include <itkAffineTransform.h>
+
+// TubeTK includes
+#include "itktubeMergeAdjacentImagesFilter.h"
+
+namespace itk
+{
+
+namespace tube
+{
+
+/** \class MosaicImagesFilter
+ * \brief Merge any number of overlapping tiles into one image.
+ *
+ * Each tile comes with an initial transform from the mosaic's physical
+ * space to the tile's physical space ( identity if none ).  Update()
+ *
+ *  - registers every pair of tiles whose footprints overlap, rigidly and
+ *    only over the overlap plus OverlapMargin voxels, as
+ *    MergeAdjacentImagesFilter does when RestrictToOverlap is set;
+ *  - adjusts the tile transforms globally, by the translations that best
+ *    agree, in the least squares sense, with the displacement each pair
+ *    registration finds at the center of its overlap.  The first tile is
+ *    held fixed;
+ *  - allocates the output once, on the grid of the first tile, over the
+ *    union of the adjusted footprints, and composites the tiles into it.
+ *
+ * A voxel covered by a single tile is its interpolated value.  Where
+ * tiles overlap, their values are blended with weights that fall off
+ * linearly toward each tile's border.  Each voxel is written by the first
+ * tile whose footprint contains it, so tiles are composited concurrently.
+ *
+ * Tiles can be added between updates: only the pairs that involve new
+ * tiles are registered again.
+ *
+ * \sa MergeAdjacentImagesFilter
+ */
+template< typename TImage >
+class MosaicImagesFilter :
+  public Object
+{
+public:
+
+  typedef MosaicImagesFilter                                 Self;
+  typedef Object                                             Superclass;
+  typedef SmartPointer< Self >                               Pointer;
+  typedef SmartPointer< const Self >                         ConstPointer;
+
+  typedef TImage                                             ImageType;
+  typedef typename TImage::PixelType                         PixelType;
+  typedef typename ImageType::RegionType                     RegionType;
+  typedef typename ImageType::PointType                      PointType;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information ( and related methods ). */
+  itkTypeMacro( MosaicImagesFilter, Object );
+
+  itkStaticConstMacro( ImageDimension, unsigned int, TImage::ImageDimension );
+
+  typedef AffineTransform< double, ImageDimension >          TransformType;
+  typedef typename TransformType::OutputVectorType           VectorType;
+
+  /** Add a tile and its transform from the mosaic's space ( identity if
+   *  null ).  Return the index of the tile. */
+  unsigned int AddTile( const ImageType * image,
+    const TransformType * transform = nullptr );
+
+  /** Remove every tile, along with their registrations */
+  void ClearTiles( void );
+
+  /** Get number of tiles */
+  unsigned int GetNumberOfTiles( void ) const;
+
+  /** Get a tile */
+  const ImageType * GetTile( unsigned int tile ) const;
+
+  /** Get the adjusted transform of a tile, from the mosaic's space to the
+   *  tile's, once updated */
+  const TransformType * GetTileTransform( unsigned int tile ) const;
+
+  /** Get number of overlapping pairs of tiles registered */
+  unsigned int GetNumberOfOverlaps( void ) const;
+
+  /** Set value used for output pixels that dont intersect with any tile */
+  itkSetMacro( Background, PixelType );
+
+  /** Get value used for output pixels that dont intersect with any tile */
+  itkGetMacro( Background, PixelType );
+
+  /** Set if zero-valued tile pixels should be ignored */
+  itkSetMacro( MaskZero, bool );
+
+  /** Get if zero-valued tile pixels should be ignored */
+  itkGetMacro( MaskZero, bool );
+
+  /** Set number of registration iterations per pair of tiles */
+  itkSetMacro( MaxIterations, unsigned int );
+
+  /** Get number of registration iterations per pair of tiles */
+  itkGetMacro( MaxIterations, unsigned int );
+
+  /** Set expected initial misalignment offset */
+  itkSetMacro( ExpectedOffset, double );
+
+  /** Get expected initial misalignment offset */
+  itkGetMacro( ExpectedOffset, double );
+
+  /** Set expected initial misalignment rotation */
+  itkSetMacro( ExpectedRotation, double );
+
+  /** Get expected initial misalignment rotation */
+  itkGetMacro( ExpectedRotation, double );
+
+  /** Set portion of pixels to use to compute similarity in registration */
+  itkSetMacro( SamplingRatio, double );
+
+  /** Get portion of pixels to use to compute similarity in registration */
+  itkGetMacro( SamplingRatio, double );
+
+  /** Set margin, in voxels, added around each overlap for registration;
+   *  should exceed the expected misalignment */
+  itkSetMacro( OverlapMargin, unsigned int );
+
+  /** Get margin, in voxels, added around each overlap for registration */
+  itkGetMacro( OverlapMargin, unsigned int );
+
+  /** Register the pairs of overlapping tiles not registered yet */
+  void RegisterTiles( void );
+
+  /** Adjust the tile transforms to agree with the pair registrations */
+  void AdjustTransforms( void );
+
+  /** Allocate the output and composite the tiles into it */
+  void CompositeTiles( void );
+
+  /** Register, adjust, and composite */
+  virtual void Update( void );
+
+  /** Get output image */
+  itkGetModifiableObjectMacro( Output, ImageType );
+
+protected:
+  MosaicImagesFilter( void );
+  virtual ~MosaicImagesFilter( void ) {}
+
+  void PrintSelf( std::ostream & os, Indent indent ) const override;
+
+private:
+  // Purposely not implemented
+  MosaicImagesFilter( const Self & );
+  void operator = ( const Self & );
+
+  typedef MergeAdjacentImagesFilter< ImageType >             MergeFilterType;
+
+  /** Registered pair of overlapping tiles.  Displacement is the
+   *  translation of Tile2 relative to Tile1, in the mosaic's space, that
+   *  the registration found at the center of their overlap. */
+  struct TileOverlap
+    {
+    unsigned int  Tile1;
+    unsigned int  Tile2;
+    VectorType    Displacement;
+    };
+
+  /** Bounding box of a tile, in the index space of the first tile, given
+   *  its transform */
+  RegionType ComputeFootprint( unsigned int tile,
+    const TransformType * transform ) const;
+
+  bool IsTileValue( double value ) const;
+
+  typename TImage::PixelType                         m_Background;
+  bool                                               m_MaskZero;
+  unsigned int                                       m_MaxIterations;
+  double                                             m_ExpectedOffset;
+  double                                             m_ExpectedRotation;
+  double                                             m_SamplingRatio;
+  unsigned int                                       m_OverlapMargin;
+
+  std::vector< typename ImageType::ConstPointer >    m_Tiles;
+  std::vector< typename TransformType::ConstPointer > m_InitialTransforms;
+  std::vector< typename TransformType::Pointer >     m_TileTransforms;
+
+  std::vector< TileOverlap >                         m_Overlaps;
+  unsigned int                                       m_NumberOfRegisteredTiles;
+
+  typename ImageType::Pointer                        m_Output;
+
+};  // End class MosaicImagesFilter
+
+} // End namespace tube
+
+} // End namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itktubeMosaicImagesFilter.hxx"
+#endif
+
+#endif
@@ -0,0 +1,530 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright Kitware Inc.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+#ifndef __itktubeMosaicImagesFilter_hxx
+#define __itktubeMosaicImagesFilter_hxx
+
+// ITK includes
+#include <itkContinuousIndex.h>
+#include <itkExtractImageFilter.h>
+#include <itkImageRegionIteratorWithIndex.h>
+#include <itkImageToImageRegistrationHelper.h>
+#include <itkLinearInterpolateImageFunction.h>
+#include <itkMultiThreaderBase.h>
+
+#include <vnl/algo/vnl_svd.h>
+
+#include <algorithm>
+
+namespace itk
+{
+
+namespace tube
+{
+
+template< class TImage >
+MosaicImagesFilter< TImage >
+::MosaicImagesFilter( void )
+{
+  m_Background = 0;
+  m_MaskZero = false;
+  m_MaxIterations = 300;
+  m_ExpectedOffset = 20;
+  m_ExpectedRotation = 0.001;
+  m_SamplingRatio = 0.01;
+  m_OverlapMargin = 10;
+
+  m_NumberOfRegisteredTiles = 0;
+
+  m_Output = ImageType::New();
+}
+
+template< class TImage >
+unsigned int
+MosaicImagesFilter< TImage >
+::AddTile( const ImageType * image, const TransformType * transform )
+{
+  m_Tiles.push_back( image );
+  if( transform != nullptr )
+    {
+    m_InitialTransforms.push_back( transform );
+    }
+  else
+    {
+    typename TransformType::Pointer identity = TransformType::New();
+    m_InitialTransforms.push_back( identity.GetPointer() );
+    }
+  m_TileTransforms.clear();
+  this->Modified();
+
+  return m_Tiles.size() - 1;
+}
+
+template< class TImage >
+void
+MosaicImagesFilter< TImage >
+::ClearTiles( void )
+{
+  m_Tiles.clear();
+  m_InitialTransforms.clear();
+  m_TileTransforms.clear();
+  m_Overlaps.clear();
+  m_NumberOfRegisteredTiles = 0;
+  this->Modified();
+}
+
+template< class TImage >
+unsigned int
+MosaicImagesFilter< TImage >
+::GetNumberOfTiles( void ) const
+{
+  return m_Tiles.size();
+}
+
+template< class TImage >
+const typename MosaicImagesFilter< TImage >::ImageType *
+MosaicImagesFilter< TImage >
+::GetTile( unsigned int tile ) const
+{
+  if( tile < m_Tiles.size() )
+    {
+    return m_Tiles[tile];
+    }
+  return nullptr;
+}
+
+template< class TImage >
+const typename MosaicImagesFilter< TImage >::TransformType *
+MosaicImagesFilter< TImage >
+::GetTileTransform( unsigned int tile ) const
+{
+  if( tile < m_TileTransforms.size() )
+    {
+    return m_TileTransforms[tile];
+    }
+  return nullptr;
+}
+
+template< class TImage >
+unsigned int
+MosaicImagesFilter< TImage >
+::GetNumberOfOverlaps( void ) const
+{
+  return m_Overlaps.size();
+}
+
+template< class TImage >
+void
+MosaicImagesFilter< TImage >
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "Background: " << m_Background << std::endl;
+  os << indent << "MaskZero: " << m_MaskZero << std::endl;
+  os << indent << "MaxIterations: " << m_MaxIterations << std::endl;
+  os << indent << "ExpectedOffset: " << m_ExpectedOffset << std::endl;
+  os << indent << "ExpectedRotation: " << m_ExpectedRotation << std::endl;
+  os << indent << "SamplingRatio: " << m_SamplingRatio << std::endl;
+  os << indent << "OverlapMargin: " << m_OverlapMargin << std::endl;
+  os << indent << "NumberOfTiles: " << m_Tiles.size() << std::endl;
+  os << indent << "NumberOfOverlaps: " << m_Overlaps.size() << std::endl;
+  os << indent << "NumberOfRegisteredTiles: " << m_NumberOfRegisteredTiles
+    << std::endl;
+}
+
+template< class TImage >
+typename MosaicImagesFilter< TImage >::RegionType
+MosaicImagesFilter< TImage >
+::ComputeFootprint( unsigned int tile, const TransformType * transform ) const
+{
+  return MergeFilterType::MapRegion( m_Tiles[tile],
+    m_Tiles[tile]->GetLargestPossibleRegion(), m_Tiles[0],
+    transform->GetInverseTransform().GetPointer() );
+}
+
+template< class TImage >
+bool
+MosaicImagesFilter< TImage >
+::IsTileValue( double value ) const
+{
+  return value != m_Background && ( !m_MaskZero || value != 0 );
+}
+
+template< class TImage >
+void
+MosaicImagesFilter< TImage >
+::RegisterTiles( void )
+{
+  const unsigned int numberOfTiles = m_Tiles.size();
+  if( m_NumberOfRegisteredTiles >= numberOfTiles )
+    {
+    return;
+    }
+
+  std::vector< RegionType > footprints( numberOfTiles );
+  for( unsigned int t = 0; t < numberOfTiles; ++t )
+    {
+    footprints[t] = this->ComputeFootprint( t, m_InitialTransforms[t] );
+    }
+
+  typedef typename itk::ImageToImageRegistrationHelper< ImageType >
+    RegFilterType;
+  typedef ExtractImageFilter< ImageType, ImageType > ExtractFilterType;
+
+  // Only the pairs that involve a tile added since the last registration
+  for( unsigned int t2 = std::max( m_NumberOfRegisteredTiles, 1u );
+    t2 < numberOfTiles; ++t2 )
+    {
+    for( unsigned int t1 = 0; t1 < t2; ++t1 )
+      {
+      RegionType overlap = footprints[t1];
+      if( !overlap.Crop( footprints[t2] ) )
+        {
+        continue;
+        }
+
+      // Transform from tile 1 to tile 2 implied by the initial transforms
+      typename TransformType::Pointer relative = TransformType::New();
+      m_InitialTransforms[t1]->GetInverse( relative );
+      relative->Compose( m_InitialTransforms[t2], false );
+
+      typename TransformType::ConstPointer registered =
+        relative.GetPointer();
+      if( m_MaxIterations > 0 )
+        {
+        RegionType region1 = MergeFilterType::PadAndCropRegion(
+          MergeFilterType::MapRegion( m_Tiles[0], overlap, m_Tiles[t1],
+            m_InitialTransforms[t1] ), m_OverlapMargin,
+          m_Tiles[t1]->GetLargestPossibleRegion() );
+        RegionType region2 = MergeFilterType::PadAndCropRegion(
+          MergeFilterType::MapRegion( m_Tiles[0], overlap, m_Tiles[t2],
+            m_InitialTransforms[t2] ), m_OverlapMargin,
+          m_Tiles[t2]->GetLargestPossibleRegion() );
+        if( region1.GetNumberOfPixels() > 0
+          && region2.GetNumberOfPixels() > 0 )
+          {
+          typename ExtractFilterType::Pointer extract1 =
+            ExtractFilterType::New();
+          extract1->SetInput( m_Tiles[t1] );
+          extract1->SetExtractionRegion( region1 );
+          extract1->Update();
+
+          typename ExtractFilterType::Pointer extract2 =
+            ExtractFilterType::New();
+          extract2->SetInput( m_Tiles[t2] );
+          extract2->SetExtractionRegion( region2 );
+          extract2->Update();
+
+          typename RegFilterType::Pointer regOp = RegFilterType::New();
+          regOp->SetFixedImage( extract1->GetOutput() );
+          regOp->SetMovingImage( extract2->GetOutput() );
+          regOp->SetSampleFromOverlap( true );
+          regOp->SetEnableLoadedRegistration( false );
+          regOp->SetEnableInitialRegistration( false );
+          regOp->SetEnableRigidRegistration( true );
+          regOp->SetRigidSamplingRatio( m_SamplingRatio );
+          regOp->SetRigidMaxIterations( m_MaxIterations );
+          regOp->SetEnableAffineRegistration( false );
+          regOp->SetEnableBSplineRegistration( false );
+          regOp->SetExpectedOffsetMagnitude( m_ExpectedOffset );
+          regOp->SetExpectedRotationMagnitude( m_ExpectedRotation );
+          regOp->SetLoadedMatrixTransform( *( relative.GetPointer() ) );
+          regOp->Initialize();
+          regOp->SetReportProgress( true );
+          regOp->Update();
+
+          registered = regOp->GetCurrentMatrixTransform();
+          }
+        }
+
+      // Where the point of tile 2 that registration matches with the
+      //   center of the overlap in tile 1 lands in the mosaic, relative to
+      //   that center
+      ContinuousIndex< double, ImageDimension > centerIndex;
+      for( unsigned int i = 0; i < ImageDimension; ++i )
+        {
+        centerIndex[i] = overlap.GetIndex()[i]
+          + ( overlap.GetSize()[i] - 1 ) / 2.0;
+        }
+      PointType center;
+      m_Tiles[0]->TransformContinuousIndexToPhysicalPoint( centerIndex,
+        center );
+      PointType matched = m_InitialTransforms[t2]->GetInverseTransform()
+        ->TransformPoint( registered->TransformPoint(
+          m_InitialTransforms[t1]->TransformPoint( center ) ) );
+
+      TileOverlap tileOverlap;
+      tileOverlap.Tile1 = t1;
+      tileOverlap.Tile2 = t2;
+      tileOverlap.Displacement = center - matched;
+      m_Overlaps.push_back( tileOverlap );
+      }
+    }
+
+  m_NumberOfRegisteredTiles = numberOfTiles;
+}
+
+template< class TImage >
+void
+MosaicImagesFilter< TImage >
+::AdjustTransforms( void )
+{
+  const unsigned int numberOfTiles = m_Tiles.size();
+
+  m_TileTransforms.resize( numberOfTiles );
+  for( unsigned int t = 0; t < numberOfTiles; ++t )
+    {
+    m_TileTransforms[t] = TransformType::New();
+    m_TileTransforms[t]->SetFixedParameters(
+      m_InitialTransforms[t]->GetFixedParameters() );
+    m_TileTransforms[t]->SetParameters(
+      m_InitialTransforms[t]->GetParameters() );
+    }
+  if( numberOfTiles < 2 || m_Overlaps.empty() )
+    {
+    return;
+    }
+
+  // Translations t of tiles 1..n-1, tile 0 being fixed, that minimize
+  //   sum over overlaps of | t2 - t1 - displacement |^2.  Tiles that are
+  //   not connected to the first one are held by the small diagonal term.
+  const unsigned int numberOfUnknowns = numberOfTiles - 1;
+  vnl_matrix< double > normal( numberOfUnknowns, numberOfUnknowns, 0.0 );
+  vnl_matrix< double > rhs( numberOfUnknowns, ImageDimension, 0.0 );
+  for( unsigned int o = 0; o < m_Overlaps.size(); ++o )
+    {
+    const unsigned int u2 = m_Overlaps[o].Tile2 - 1;
+    normal( u2, u2 ) += 1;
+    for( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+      rhs( u2, i ) += m_Overlaps[o].Displacement[i];
+      }
+    if( m_Overlaps[o].Tile1 > 0 )
+      {
+      const unsigned int u1 = m_Overlaps[o].Tile1 - 1;
+      normal( u1, u1 ) += 1;
+      normal( u1, u2 ) -= 1;
+      normal( u2, u1 ) -= 1;
+      for( unsigned int i = 0; i < ImageDimension; ++i )
+        {
+        rhs( u1, i ) -= m_Overlaps[o].Displacement[i];
+        }
+      }
+    }
+  for( unsigned int u = 0; u < numberOfUnknowns; ++u )
+    {
+    normal( u, u ) += 1e-6;
+    }
+  vnl_matrix< double > translations = vnl_svd< double >( normal ).solve(
+    rhs );
+
+  // A tile shifted by t in the mosaic maps x to its point at x - t
+  for( unsigned int u = 0; u < numberOfUnknowns; ++u )
+    {
+    VectorType shift;
+    for( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+      shift[i] = -translations( u, i );
+      }
+    m_TileTransforms[u + 1]->Translate( shift, true );
+    }
+}
+
+template< class TImage >
+void
+MosaicImagesFilter< TImage >
+::CompositeTiles( void )
+{
+  const unsigned int numberOfTiles = m_Tiles.size();
+  if( numberOfTiles == 0 )
+    {
+    m_Output = ImageType::New();
+    return;
+    }
+  if( m_TileTransforms.size() != numberOfTiles )
+    {
+    this->AdjustTransforms();
+    }
+
+  std::vector< RegionType > footprints( numberOfTiles );
+  typename ImageType::IndexType minXOut;
+  typename ImageType::IndexType maxXOut;
+  minXOut.Fill( NumericTraits< IndexValueType >::max() );
+  maxXOut.Fill( NumericTraits< IndexValueType >::NonpositiveMin() );
+  for( unsigned int t = 0; t < numberOfTiles; ++t )
+    {
+    footprints[t] = this->ComputeFootprint( t, m_TileTransforms[t] );
+    for( unsigned int i = 0; i < ImageDimension; ++i )
+      {
+      minXOut[i] = std::min( minXOut[i], footprints[t].GetIndex()[i] );
+      maxXOut[i] = std::max( maxXOut[i],
+        static_cast< IndexValueType >( footprints[t].GetIndex()[i]
+          + footprints[t].GetSize()[i] - 1 ) );
+      }
+    }
+  RegionType regionOut;
+  regionOut.SetIndex( minXOut );
+  for( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+    regionOut.SetSize( i, maxXOut[i] - minXOut[i] + 1 );
+    }
+
+  m_Output = ImageType::New();
+  m_Output->CopyInformation( m_Tiles[0] );
+  m_Output->SetRegions( regionOut );
+  m_Output->Allocate();
+  m_Output->FillBuffer( m_Background );
+
+  // Tiles whose footprints intersect each tile's, itself included
+  std::vector< std::vector< unsigned int > > coveringTiles( numberOfTiles );
+  for( unsigned int t1 = 0; t1 < numberOfTiles; ++t1 )
+    {
+    for( unsigned int t2 = 0; t2 < numberOfTiles; ++t2 )
+      {
+      RegionType overlap = footprints[t1];
+      if( overlap.Crop( footprints[t2] ) )
+        {
+        coveringTiles[t1].push_back( t2 );
+        }
+      }
+    }
+
+  typedef LinearInterpolateImageFunction< ImageType, double >
+    InterpolatorType;
+  std::vector< typename InterpolatorType::Pointer > interpolators(
+    numberOfTiles );
+  for( unsigned int t = 0; t < numberOfTiles; ++t )
+    {
+    interpolators[t] = InterpolatorType::New();
+    interpolators[t]->SetInputImage( m_Tiles[t] );
+    }
+
+  // Split each footprint into slabs along the last axis, so that a few
+  //   large tiles still keep every thread busy
+  MultiThreaderBase::Pointer threader = MultiThreaderBase::New();
+  const unsigned int numberOfSlabs = threader->GetNumberOfWorkUnits();
+  std::vector< unsigned int > workTiles;
+  std::vector< RegionType > workRegions;
+  for( unsigned int t = 0; t < numberOfTiles; ++t )
+    {
+    const unsigned int axis = ImageDimension - 1;
+    const SizeValueType length = footprints[t].GetSize()[axis];
+    const SizeValueType slabLength = ( length + numberOfSlabs - 1 )
+      / numberOfSlabs;
+    for( SizeValueType first = 0; first < length; first += slabLength )
+      {
+      RegionType slab = footprints[t];
+      slab.SetIndex( axis, footprints[t].GetIndex()[axis] + first );
+      slab.SetSize( axis, std::min( slabLength, length - first ) );
+      workTiles.push_back( t );
+      workRegions.push_back( slab );
+      }
+    }
+
+  // Each voxel is written only by the first tile whose footprint contains
+  //   it, which blends in the other tiles that cover it
+  threader->ParallelizeArray( 0, workRegions.size(),
+    [&]( SizeValueType work )
+      {
+      const unsigned int tile = workTiles[work];
+      const std::vector< unsigned int > & covering = coveringTiles[tile];
+      ImageRegionIteratorWithIndex< ImageType > iterOut( m_Output,
+        workRegions[work] );
+      while( !iterOut.IsAtEnd() )
+        {
+        const typename ImageType::IndexType & indx = iterOut.GetIndex();
+        bool owned = true;
+        for( unsigned int c = 0; c < covering.size()
+          && covering[c] < tile; ++c )
+          {
+          if( footprints[covering[c]].IsInside( indx ) )
+            {
+            owned = false;
+            break;
+            }
+          }
+        if( owned )
+          {
+          PointType pointX;
+          m_Output->TransformIndexToPhysicalPoint( indx, pointX );
+          double sum = 0;
+          double sumWeights = 0;
+          for( unsigned int c = 0; c < covering.size(); ++c )
+            {
+            const unsigned int t = covering[c];
+            if( t != tile && !footprints[t].IsInside( indx ) )
+              {
+              continue;
+              }
+            ContinuousIndex< double, ImageDimension > cIndx;
+            m_Tiles[t]->TransformPhysicalPointToContinuousIndex(
+              m_TileTransforms[t]->TransformPoint( pointX ), cIndx );
+            if( !interpolators[t]->IsInsideBuffer( cIndx ) )
+              {
+              continue;
+              }
+            const double val =
+              interpolators[t]->EvaluateAtContinuousIndex( cIndx );
+            if( !this->IsTileValue( val ) )
+              {
+              continue;
+              }
+            // Falls off linearly toward the border of the tile
+            const RegionType & tileRegion =
+              m_Tiles[t]->GetLargestPossibleRegion();
+            double weight = NumericTraits< double >::max();
+            for( unsigned int i = 0; i < ImageDimension; ++i )
+              {
+              const double lower = cIndx[i] - tileRegion.GetIndex()[i];
+              const double upper = tileRegion.GetIndex()[i]
+                + tileRegion.GetSize()[i] - 1 - cIndx[i];
+              weight = std::min( weight, std::min( lower, upper ) );
+              }
+            weight = std::max( weight, 0.0 ) + 1;
+            sum += weight * val;
+            sumWeights += weight;
+            }
+          if( sumWeights > 0 )
+            {
+            iterOut.Set( static_cast< PixelType >( sum / sumWeights ) );
+            }
+          }
+        ++iterOut;
+        }
+      }, nullptr );
+}
+
+template< class TImage >
+void
+MosaicImagesFilter< TImage >
+::Update( void )
+{
+  this->RegisterTiles();
+  this->AdjustTransforms();
+  this->CompositeTiles();
+}
+
+} // End namespace tube
+
+} // End namespace itk
+
+#endif
@@ -25,8 +25,10 @@ set( TubeTK_Segmentation_H_Files
   Segmentation/itktubePDFSegmenterParzen.h
   Segmentation/itktubeRadiusExtractor2.h
   Segmentation/itktubeRadiusExtractor3.h
+  Segmentation/itktubeRidgeExtractionEventLog.h
   Segmentation/itktubeRidgeExtractor.h
   Segmentation/itktubeSegmentTubeUsingMinimalPathFilter.h
+  Segmentation/itktubeSparseTubeMask.h
   Segmentation/itktubeTubeExtractor.h
   Segmentation/itktubeRidgeSeedFilter.h
   Segmentation/itktubeComputeTrainingMaskFilter.h)
@@ -38,11 +40,13 @@ set( TubeTK_Segmentation_HXX_Files
   Segmentation/itktubeRadiusExtractor3.hxx
   Segmentation/itktubeRidgeExtractor.hxx
   Segmentation/itktubeSegmentTubeUsingMinimalPathFilter.hxx
+  Segmentation/itktubeSparseTubeMask.hxx
   Segmentation/itktubeTubeExtractor.hxx
   Segmentation/itktubeRidgeSeedFilter.hxx
   Segmentation/itktubeComputeTrainingMaskFilter.hxx)
 
-set( TubeTK_Segmentation_CXX_Files )
+set( TubeTK_Segmentation_CXX_Files
+  Segmentation/itktubeRidgeExtractionEventLog.cxx )
 
 list( APPEND TubeTK_SRCS
   ${TubeTK_Segmentation_H_Files}
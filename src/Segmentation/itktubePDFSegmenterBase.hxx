@@ -25,6 +25,7 @@ limitations under the License.
 #define __itktubePDFSegmenterBase_hxx
 
 #include "itktubeVectorImageToListGenerator.h"
+#include "tubeProfiler.h"
 
 #include <itkBinaryBallStructuringElement.h>
 #include <itkBinaryDilateImageFilter.h>
@@ -385,6 +386,8 @@ void
 PDFSegmenterBase< TImage, TLabelMap >
 ::GeneratePDFs( void )
 {
+  tubeProfileScopeMacro( "PDFSegmenter::GeneratePDFs" );
+
   if( !m_SampleUpToDate )
     {
     this->GenerateSample();
@@ -401,6 +404,8 @@ void
 PDFSegmenterBase< TImage, TLabelMap >
 ::ApplyPDFs( void )
 {
+  tubeProfileScopeMacro( "PDFSegmenter::ApplyPDFs" );
+
   if( m_InputLabelMap.IsNotNull() && !m_SampleUpToDate )
     {
     this->GenerateSample();
@@ -486,6 +491,8 @@ PDFSegmenterBase< TImage, TLabelMap >
     {
     delete probIt[c];
     }
+  tubeProfileCountMacro( "PDFSegmenter::VoxelsClassified",
+    m_InputLabelMap->GetLargestPossibleRegion().GetNumberOfPixels() );
 
   if( m_ProbabilityImageSmoothingStandardDeviation > 0 )
     {
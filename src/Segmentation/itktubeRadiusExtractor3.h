@@ -30,6 +30,7 @@ limitations under the License.
 #define __itktubeRadiusExtractor3_h
 
 #include "itktubeBlurImageFunction.h"
+#include "itktubeImageRegionStatistics.h"
 
 #include <itkTubeSpatialObject.h>
 
@@ -82,6 +83,10 @@ public:
 
   typedef typename InputImageType::IndexType                 IndexType;
 
+  /**
+   * Type definition for the intensity range of the input image */
+  typedef ImageRegionStatistics< TInputImage >     ImageStatisticsType;
+
   /**
    * Type definition for the input image pixel type. */
   typedef typename TInputImage::PixelType                    PixelType;
@@ -100,13 +105,21 @@ public:
    * Get the input image */
   itkGetConstObjectMacro( InputImage, InputImageType );
 
+  /** Intensity range of the input image.  SetInputImage() creates one
+   * over the whole image, unless the statistics already set are for the
+   * same image; it is only scanned when the data minimum or maximum is
+   * first needed and was not set explicitly.  Set it to share the
+   * statistics of a RidgeExtractor. */
+  void SetImageStatistics( ImageStatisticsType * statistics );
+  itkGetModifiableObjectMacro( ImageStatistics, ImageStatisticsType );
+
   /** Set Data Minimum */
-  itkSetMacro( DataMin, double );
-  itkGetMacro( DataMin, double );
+  void SetDataMin( double dataMin );
+  double GetDataMin( void );
 
   /** Set Data Maximum */
-  itkSetMacro( DataMax, double );
-  itkGetMacro( DataMax, double );
+  void SetDataMax( double dataMax );
+  double GetDataMax( void );
 
   /** Set Minimum Radius */
   itkSetMacro( RadiusMinInIndexSpace, double );
@@ -175,6 +188,10 @@ protected:
 
   void GenerateKernelProfile( void );
 
+  /** Take the data range not set explicitly from the image statistics,
+   * if they changed since it was last taken */
+  void UpdateDataRange( void );
+
   void SetKernelTubePoints( const std::vector< TubePointType > & tubePoints );
   std::vector< TubePointType > & GetKernelTubePoints( void )
    { return m_KernelTube->GetPoints(); };
@@ -208,6 +225,10 @@ private:
   double                                  m_Spacing;
   double                                  m_DataMin;
   double                                  m_DataMax;
+  bool                                    m_DataMinIsSet;
+  bool                                    m_DataMaxIsSet;
+  typename ImageStatisticsType::Pointer   m_ImageStatistics;
+  ModifiedTimeType                        m_DataRangeMTime;
 
   double                                  m_RadiusStartInIndexSpace;
   double                                  m_RadiusMinInIndexSpace;
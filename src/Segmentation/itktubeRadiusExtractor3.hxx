@@ -34,12 +34,12 @@ limitations under the License.
 
 #include "tubeMessage.h"
 #include "tubeMatrixMath.h"
+#include "tubeProfiler.h"
 #include "tubeTubeMathFilters.h"
 
 #include "itkSingleValuedNonLinearOptimizer.h"
 #include "itkFRPROptimizer.h"
 
-#include "itkMinimumMaximumImageFilter.h"
 
 #include <vnl/vnl_math.h>
 
@@ -127,6 +127,10 @@ RadiusExtractor3<TInputImage>
   m_Spacing = 1;
   m_DataMin = 0;
   m_DataMax = -1;
+  m_DataMinIsSet = false;
+  m_DataMaxIsSet = false;
+  m_ImageStatistics = nullptr;
+  m_DataRangeMTime = 0;
 
   m_RadiusStartInIndexSpace = 0.75;  // All values are in index space.
   m_RadiusMinInIndexSpace = 0.708/2.0;
@@ -173,13 +177,16 @@ RadiusExtractor3<TInputImage>
 
   if( m_InputImage )
     {
-    typedef MinimumMaximumImageFilter<InputImageType> MinMaxFilterType;
-    typename MinMaxFilterType::Pointer minMaxFilter =
-      MinMaxFilterType::New();
-    minMaxFilter->SetInput( m_InputImage );
-    minMaxFilter->Update();
-    m_DataMin = minMaxFilter->GetMinimum();
-    m_DataMax = minMaxFilter->GetMaximum();
+    // The data range is computed when first needed
+    if( m_ImageStatistics.IsNull()
+      || m_ImageStatistics->GetInputImage() != m_InputImage )
+      {
+      m_ImageStatistics = ImageStatisticsType::New();
+      m_ImageStatistics->SetInputImage( m_InputImage );
+      }
+    m_DataMinIsSet = false;
+    m_DataMaxIsSet = false;
+    m_DataRangeMTime = 0;
     for( unsigned int d=1; d<ImageDimension; ++d )
       {
       if( m_InputImage->GetSpacing()[d] != m_InputImage->GetSpacing()[0] )
@@ -191,13 +198,87 @@ RadiusExtractor3<TInputImage>
         }
       }
     m_Spacing = m_InputImage->GetSpacing()[0];
-    if( this->GetDebug() )
-      {
-      ::tube::DebugMessage( "RadiusExtractor3: SetInputImage: Minimum = "
-        + std::to_string(m_DataMin) );
-      ::tube::DebugMessage( "RadiusExtractor3: SetInputImage: Maximum = "
-        + std::to_string(m_DataMax) );
-      }
+    }
+}
+
+/** Set the image statistics */
+template< class TInputImage >
+void
+RadiusExtractor3<TInputImage>
+::SetImageStatistics( ImageStatisticsType * statistics )
+{
+  m_ImageStatistics = statistics;
+  m_DataRangeMTime = 0;
+}
+
+/** Set the data minimum */
+template< class TInputImage >
+void
+RadiusExtractor3<TInputImage>
+::SetDataMin( double dataMin )
+{
+  m_DataMin = dataMin;
+  m_DataMinIsSet = true;
+}
+
+/** Get the data minimum */
+template< class TInputImage >
+double
+RadiusExtractor3<TInputImage>
+::GetDataMin( void )
+{
+  this->UpdateDataRange();
+  return m_DataMin;
+}
+
+/** Set the data maximum */
+template< class TInputImage >
+void
+RadiusExtractor3<TInputImage>
+::SetDataMax( double dataMax )
+{
+  m_DataMax = dataMax;
+  m_DataMaxIsSet = true;
+}
+
+/** Get the data maximum */
+template< class TInputImage >
+double
+RadiusExtractor3<TInputImage>
+::GetDataMax( void )
+{
+  this->UpdateDataRange();
+  return m_DataMax;
+}
+
+/** Update the data range from the image statistics */
+template< class TInputImage >
+void
+RadiusExtractor3<TInputImage>
+::UpdateDataRange( void )
+{
+  if( m_ImageStatistics.IsNull()
+    || m_ImageStatistics->GetMTime() == m_DataRangeMTime
+    || ( m_DataMinIsSet && m_DataMaxIsSet ) )
+    {
+    return;
+    }
+  m_DataRangeMTime = m_ImageStatistics->GetMTime();
+
+  if( !m_DataMinIsSet )
+    {
+    m_DataMin = m_ImageStatistics->GetMinimum();
+    }
+  if( !m_DataMaxIsSet )
+    {
+    m_DataMax = m_ImageStatistics->GetMaximum();
+    }
+  if( this->GetDebug() )
+    {
+    ::tube::DebugMessage( "RadiusExtractor3: UpdateDataRange: Minimum = "
+      + std::to_string(m_DataMin) );
+    ::tube::DebugMessage( "RadiusExtractor3: UpdateDataRange: Maximum = "
+      + std::to_string(m_DataMax) );
     }
 }
 
@@ -336,6 +417,8 @@ void
 RadiusExtractor3<TInputImage>
 ::GenerateKernelProfile( void )
 {
+  this->UpdateDataRange();
+
   IndexType minXIndex;
   IndexType maxXIndex;
 
@@ -686,6 +769,8 @@ bool
 RadiusExtractor3<TInputImage>
 ::ExtractRadii( TubeType * tube, bool verbose )
 {
+  tubeProfileScopeMacro( "RadiusExtractor3::ExtractRadii" );
+
   unsigned int tubeSize = tube->GetPoints().size();
   if( tubeSize < m_KernelNumberOfPoints * m_KernelPointStep )
     {
@@ -954,6 +1039,10 @@ RadiusExtractor3<TInputImage>
   os << indent << "Spacing = " << m_Spacing << std::endl;
   os << indent << "DataMin = " << m_DataMin << std::endl;
   os << indent << "DataMax = " << m_DataMax << std::endl;
+  os << indent << "DataMinIsSet = " << m_DataMinIsSet << std::endl;
+  os << indent << "DataMaxIsSet = " << m_DataMaxIsSet << std::endl;
+  os << indent << "ImageStatistics = " << m_ImageStatistics.GetPointer()
+    << std::endl;
 
   os << indent << "RadiusStartInIndexSpace = "
     << m_RadiusStartInIndexSpace << std::endl;
@@ -0,0 +1,400 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright Kitware Inc.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#include "itktubeRidgeExtractionEventLog.h"
+
+#include <algorithm>
+#include <atomic>
+#include <iomanip>
+#include <thread>
+
+namespace
+{
+
+// Identifies a log without relying on its address, which may be reused
+std::atomic< unsigned long > nextLogIdentifier( 1 );
+
+// The buffer the calling thread last used, and the log it belongs to
+thread_local unsigned long cachedLogIdentifier = 0;
+thread_local void * cachedThreadBuffer = nullptr;
+
+bool EventTimeLess(
+  const itk::tube::RidgeExtractionEventLog::Event & a,
+  const itk::tube::RidgeExtractionEventLog::Event & b )
+{
+  return a.TimeInMicroseconds < b.TimeInMicroseconds;
+}
+
+bool SeedStartLess(
+  const itk::tube::RidgeExtractionEventLog::SeedStatistics & a,
+  const itk::tube::RidgeExtractionEventLog::SeedStatistics & b )
+{
+  return a.StartInMicroseconds < b.StartInMicroseconds;
+}
+
+} // End namespace
+
+namespace itk
+{
+
+namespace tube
+{
+
+struct RidgeExtractionEventLog::ThreadBuffer
+{
+  std::thread::id         ThreadId;
+  unsigned int            Thread;
+
+  // Ring of events; Next is where the next event is written
+  EventListType           Events;
+  std::size_t             Next;
+  unsigned long long      NumberOfEvents;
+
+  bool                    InSeed;
+  SeedStatistics          Current;
+  SeedStatisticsListType  Seeds;
+};
+
+RidgeExtractionEventLog
+::RidgeExtractionEventLog( void )
+{
+  m_Identifier = nextLogIdentifier.fetch_add( 1 );
+  m_RingBufferCapacity = 4096;
+  m_Epoch = std::chrono::steady_clock::now();
+}
+
+RidgeExtractionEventLog
+::~RidgeExtractionEventLog( void )
+{
+}
+
+void
+RidgeExtractionEventLog
+::SetRingBufferCapacity( unsigned int capacity )
+{
+  std::lock_guard< std::mutex > lock( m_Mutex );
+  if( capacity == m_RingBufferCapacity )
+    {
+    return;
+    }
+  m_RingBufferCapacity = capacity;
+  for( unsigned int i = 0; i < m_ThreadBuffers.size(); ++i )
+    {
+    m_ThreadBuffers[i]->Events.assign( capacity, Event() );
+    m_ThreadBuffers[i]->Next = 0;
+    m_ThreadBuffers[i]->NumberOfEvents = 0;
+    }
+  this->Modified();
+}
+
+void
+RidgeExtractionEventLog
+::Reset( void )
+{
+  std::lock_guard< std::mutex > lock( m_Mutex );
+  // Buffers are emptied rather than freed, since threads cache them
+  for( unsigned int i = 0; i < m_ThreadBuffers.size(); ++i )
+    {
+    m_ThreadBuffers[i]->Next = 0;
+    m_ThreadBuffers[i]->NumberOfEvents = 0;
+    m_ThreadBuffers[i]->InSeed = false;
+    m_ThreadBuffers[i]->Seeds.clear();
+    }
+  m_Epoch = std::chrono::steady_clock::now();
+}
+
+double
+RidgeExtractionEventLog
+::GetElapsedMicroseconds( void ) const
+{
+  return std::chrono::duration< double, std::micro >(
+    std::chrono::steady_clock::now() - m_Epoch ).count();
+}
+
+RidgeExtractionEventLog::ThreadBuffer *
+RidgeExtractionEventLog
+::GetThreadBuffer( void )
+{
+  if( cachedLogIdentifier == m_Identifier )
+    {
+    return static_cast< ThreadBuffer * >( cachedThreadBuffer );
+    }
+
+  std::lock_guard< std::mutex > lock( m_Mutex );
+  const std::thread::id threadId = std::this_thread::get_id();
+  ThreadBuffer * buffer = nullptr;
+  for( unsigned int i = 0; i < m_ThreadBuffers.size(); ++i )
+    {
+    if( m_ThreadBuffers[i]->ThreadId == threadId )
+      {
+      buffer = m_ThreadBuffers[i].get();
+      break;
+      }
+    }
+  if( buffer == nullptr )
+    {
+    m_ThreadBuffers.push_back( std::unique_ptr< ThreadBuffer >(
+      new ThreadBuffer() ) );
+    buffer = m_ThreadBuffers.back().get();
+    buffer->ThreadId = threadId;
+    buffer->Thread = static_cast< unsigned int >(
+      m_ThreadBuffers.size() - 1 );
+    buffer->Events.assign( m_RingBufferCapacity, Event() );
+    buffer->Next = 0;
+    buffer->NumberOfEvents = 0;
+    buffer->InSeed = false;
+    }
+  cachedLogIdentifier = m_Identifier;
+  cachedThreadBuffer = buffer;
+  return buffer;
+}
+
+void
+RidgeExtractionEventLog
+::Record( ThreadBuffer * buffer, unsigned char type, int tubeId,
+  double value, unsigned int failureCode )
+{
+  if( buffer->Events.empty() )
+    {
+    return;
+    }
+  Event & event = buffer->Events[buffer->Next];
+  event.TimeInMicroseconds = this->GetElapsedMicroseconds();
+  event.Value = value;
+  event.TubeId = tubeId;
+  event.Type = type;
+  event.FailureCode = static_cast< unsigned char >( failureCode );
+  if( ++buffer->Next == buffer->Events.size() )
+    {
+    buffer->Next = 0;
+    }
+  ++buffer->NumberOfEvents;
+}
+
+void
+RidgeExtractionEventLog
+::BeginSeed( int tubeId, double scale )
+{
+  ThreadBuffer * buffer = this->GetThreadBuffer();
+  SeedStatistics & seed = buffer->Current;
+  seed.TubeId = tubeId;
+  seed.Thread = buffer->Thread;
+  seed.Extracted = false;
+  seed.NumberOfPoints = 0;
+  seed.NumberOfSteps = 0;
+  seed.NumberOfRecoveryAttempts = 0;
+  seed.NumberOfScaleChanges = 0;
+  seed.FinalFailureCode = 0;
+  seed.InitialScale = scale;
+  seed.FinalScale = scale;
+  seed.StartInMicroseconds = this->GetElapsedMicroseconds();
+  seed.DurationInMicroseconds = 0;
+  std::fill( seed.FailureCodeCount,
+    seed.FailureCodeCount + MaximumNumberOfFailureCodes, 0 );
+  buffer->InSeed = true;
+  this->Record( buffer, SEED_BEGIN, tubeId, scale, 0 );
+}
+
+void
+RidgeExtractionEventLog
+::EndSeed( bool extracted, unsigned int numberOfPoints,
+  unsigned int failureCode )
+{
+  ThreadBuffer * buffer = this->GetThreadBuffer();
+  if( !buffer->InSeed )
+    {
+    return;
+    }
+  SeedStatistics & seed = buffer->Current;
+  seed.Extracted = extracted;
+  seed.NumberOfPoints = numberOfPoints;
+  seed.FinalFailureCode = failureCode;
+  seed.DurationInMicroseconds = this->GetElapsedMicroseconds()
+    - seed.StartInMicroseconds;
+  buffer->InSeed = false;
+  this->Record( buffer, SEED_END, seed.TubeId, numberOfPoints,
+    failureCode );
+
+  std::lock_guard< std::mutex > lock( m_Mutex );
+  buffer->Seeds.push_back( seed );
+}
+
+void
+RidgeExtractionEventLog
+::Step( double stepSize )
+{
+  ThreadBuffer * buffer = this->GetThreadBuffer();
+  ++buffer->Current.NumberOfSteps;
+  this->Record( buffer, STEP, buffer->Current.TubeId, stepSize, 0 );
+}
+
+void
+RidgeExtractionEventLog
+::Recovery( int attempt )
+{
+  ThreadBuffer * buffer = this->GetThreadBuffer();
+  ++buffer->Current.NumberOfRecoveryAttempts;
+  this->Record( buffer, RECOVERY, buffer->Current.TubeId, attempt, 0 );
+}
+
+void
+RidgeExtractionEventLog
+::ScaleChange( double scale )
+{
+  ThreadBuffer * buffer = this->GetThreadBuffer();
+  ++buffer->Current.NumberOfScaleChanges;
+  buffer->Current.FinalScale = scale;
+  this->Record( buffer, SCALE_CHANGE, buffer->Current.TubeId, scale, 0 );
+}
+
+void
+RidgeExtractionEventLog
+::Failure( unsigned int failureCode )
+{
+  ThreadBuffer * buffer = this->GetThreadBuffer();
+  ++buffer->Current.FailureCodeCount[ std::min( failureCode,
+    MaximumNumberOfFailureCodes - 1 ) ];
+  this->Record( buffer, FAILURE, buffer->Current.TubeId, 0, failureCode );
+}
+
+RidgeExtractionEventLog::EventListType
+RidgeExtractionEventLog
+::GetEvents( void ) const
+{
+  std::lock_guard< std::mutex > lock( m_Mutex );
+  EventListType events;
+  for( unsigned int i = 0; i < m_ThreadBuffers.size(); ++i )
+    {
+    const ThreadBuffer * buffer = m_ThreadBuffers[i].get();
+    const std::size_t capacity = buffer->Events.size();
+    if( buffer->NumberOfEvents < capacity )
+      {
+      events.insert( events.end(), buffer->Events.begin(),
+        buffer->Events.begin() + buffer->Next );
+      }
+    else
+      {
+      events.insert( events.end(), buffer->Events.begin() + buffer->Next,
+        buffer->Events.end() );
+      events.insert( events.end(), buffer->Events.begin(),
+        buffer->Events.begin() + buffer->Next );
+      }
+    }
+  std::stable_sort( events.begin(), events.end(), EventTimeLess );
+  return events;
+}
+
+unsigned long long
+RidgeExtractionEventLog
+::GetNumberOfDroppedEvents( void ) const
+{
+  std::lock_guard< std::mutex > lock( m_Mutex );
+  unsigned long long dropped = 0;
+  for( unsigned int i = 0; i < m_ThreadBuffers.size(); ++i )
+    {
+    const ThreadBuffer * buffer = m_ThreadBuffers[i].get();
+    if( buffer->NumberOfEvents > buffer->Events.size() )
+      {
+      dropped += buffer->NumberOfEvents - buffer->Events.size();
+      }
+    }
+  return dropped;
+}
+
+RidgeExtractionEventLog::SeedStatisticsListType
+RidgeExtractionEventLog
+::GetSeedStatistics( void ) const
+{
+  std::lock_guard< std::mutex > lock( m_Mutex );
+  SeedStatisticsListType seeds;
+  for( unsigned int i = 0; i < m_ThreadBuffers.size(); ++i )
+    {
+    seeds.insert( seeds.end(), m_ThreadBuffers[i]->Seeds.begin(),
+      m_ThreadBuffers[i]->Seeds.end() );
+    }
+  std::stable_sort( seeds.begin(), seeds.end(), SeedStartLess );
+  return seeds;
+}
+
+void
+RidgeExtractionEventLog
+::WriteSeedStatistics( std::ostream & os,
+  const std::vector< std::string > & failureCodeNames ) const
+{
+  SeedStatisticsListType seeds = this->GetSeedStatistics();
+
+  os << "TubeId,Thread,Extracted,NumberOfPoints,NumberOfSteps,"
+    << "NumberOfRecoveryAttempts,NumberOfScaleChanges,FinalFailureCode,"
+    << "InitialScale,FinalScale,StartInMicroseconds,"
+    << "DurationInMicroseconds,MicrosecondsPerStep";
+  const unsigned int numberOfCodes = failureCodeNames.empty()
+    ? MaximumNumberOfFailureCodes : static_cast< unsigned int >(
+      std::min< std::size_t >( failureCodeNames.size(),
+        MaximumNumberOfFailureCodes ) );
+  for( unsigned int c = 0; c < numberOfCodes; ++c )
+    {
+    if( failureCodeNames.empty() )
+      {
+      os << ",FailureCode" << c;
+      }
+    else
+      {
+      os << "," << failureCodeNames[c];
+      }
+    }
+  os << std::endl;
+
+  os << std::setprecision( 12 );
+  for( unsigned int i = 0; i < seeds.size(); ++i )
+    {
+    const SeedStatistics & seed = seeds[i];
+    os << seed.TubeId << "," << seed.Thread << ","
+      << ( seed.Extracted ? 1 : 0 ) << "," << seed.NumberOfPoints << ","
+      << seed.NumberOfSteps << "," << seed.NumberOfRecoveryAttempts << ","
+      << seed.NumberOfScaleChanges << "," << seed.FinalFailureCode << ","
+      << seed.InitialScale << "," << seed.FinalScale << ","
+      << seed.StartInMicroseconds << "," << seed.DurationInMicroseconds
+      << "," << seed.GetMicrosecondsPerStep();
+    for( unsigned int c = 0; c < numberOfCodes; ++c )
+      {
+      os << "," << seed.FailureCodeCount[c];
+      }
+    os << std::endl;
+    }
+}
+
+void
+RidgeExtractionEventLog
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "RingBufferCapacity: " << m_RingBufferCapacity
+    << std::endl;
+  std::lock_guard< std::mutex > lock( m_Mutex );
+  os << indent << "NumberOfThreadBuffers: " << m_ThreadBuffers.size()
+    << std::endl;
+}
+
+} // End namespace tube
+
+} // End namespace itk
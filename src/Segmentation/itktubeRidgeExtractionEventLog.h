@@ -0,0 +1,221 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright Kitware Inc.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#ifndef __itktubeRidgeExtractionEventLog_h
+#define __itktubeRidgeExtractionEventLog_h
+
+#include "tubetkConfigure.h"
+
+#include <itkObject.h>
+#include <itkObjectFactory.h>
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace itk
+{
+
+namespace tube
+{
+
+/**
+ * Records what RidgeExtractor does while it traverses a ridge: the seeds
+ * it starts from, every step, recovery attempt, scale change and failure
+ * code, and the time at which each happened.
+ *
+ * Events are appended to a fixed-size ring buffer owned by the calling
+ * thread, so recording takes no lock and memory stays bounded; once a
+ * buffer is full its oldest events are overwritten.  Independently of
+ * the ring buffers, the events of each seed are folded into a
+ * SeedStatistics record when the seed ends, so the per-seed summary is
+ * complete no matter how many raw events were dropped.
+ *
+ * Recording is compiled out entirely when TubeTK is configured with
+ * TubeTK_USE_EXTRACTION_EVENT_LOG off; see
+ * itkTubeRidgeExtractionEventMacro.
+ *
+ * \sa RidgeExtractor TubeExtractor
+ */
+class RidgeExtractionEventLog : public Object
+{
+public:
+
+  typedef RidgeExtractionEventLog     Self;
+  typedef Object                      Superclass;
+  typedef SmartPointer< Self >        Pointer;
+  typedef SmartPointer< const Self >  ConstPointer;
+
+  itkNewMacro( Self );
+
+  itkTypeMacro( RidgeExtractionEventLog, Object );
+
+  /** Failure codes above this value are counted as the last one. */
+  static const unsigned int MaximumNumberOfFailureCodes = 16;
+
+  typedef enum { SEED_BEGIN, SEED_END, STEP, RECOVERY, SCALE_CHANGE,
+    FAILURE }                                   EventTypeEnum;
+
+  /** One raw event.  Value holds the step size for STEP, the attempt
+   * number for RECOVERY, the new scale for SCALE_CHANGE and the number
+   * of extracted points for SEED_END. */
+  struct Event
+    {
+    double         TimeInMicroseconds;
+    double         Value;
+    int            TubeId;
+    unsigned char  Type;
+    unsigned char  FailureCode;
+    };
+
+  /** Summary of the extraction started from one seed. */
+  struct SeedStatistics
+    {
+    int            TubeId;
+    unsigned int   Thread;
+    bool           Extracted;
+    unsigned int   NumberOfPoints;
+    unsigned int   NumberOfSteps;
+    unsigned int   NumberOfRecoveryAttempts;
+    unsigned int   NumberOfScaleChanges;
+    unsigned int   FinalFailureCode;
+    double         InitialScale;
+    double         FinalScale;
+    double         StartInMicroseconds;
+    double         DurationInMicroseconds;
+    unsigned int   FailureCodeCount[ MaximumNumberOfFailureCodes ];
+
+    /** Mean time per step, or the whole duration if no step was taken. */
+    double GetMicrosecondsPerStep( void ) const
+      {
+      return NumberOfSteps > 0 ? DurationInMicroseconds / NumberOfSteps
+        : DurationInMicroseconds;
+      }
+    };
+
+  typedef std::vector< Event >           EventListType;
+  typedef std::vector< SeedStatistics >  SeedStatisticsListType;
+
+  /** Number of events each thread's ring buffer holds.  Changing it
+   * discards the recorded events, but not the seed statistics. */
+  void SetRingBufferCapacity( unsigned int capacity );
+  itkGetConstMacro( RingBufferCapacity, unsigned int );
+
+  /** Discard all recorded events and seed statistics. */
+  void Reset( void );
+
+  /** Record the start of an extraction from a seed. */
+  void BeginSeed( int tubeId, double scale );
+
+  /** Record the end of the current seed of the calling thread. */
+  void EndSeed( bool extracted, unsigned int numberOfPoints,
+    unsigned int failureCode );
+
+  /** Record one ridge traversal step of the given size. */
+  void Step( double stepSize );
+
+  /** Record a recovery attempt. */
+  void Recovery( int attempt );
+
+  /** Record a change of the extraction scale. */
+  void ScaleChange( double scale );
+
+  /** Record a failure code. */
+  void Failure( unsigned int failureCode );
+
+  /** Return the events still held in the ring buffers of all threads,
+   * in time order.  The ring buffers are written without locking, so
+   * query them only while no extraction is running. */
+  EventListType GetEvents( void ) const;
+
+  /** Return the number of events overwritten in the ring buffers. */
+  unsigned long long GetNumberOfDroppedEvents( void ) const;
+
+  /** Return the statistics of every completed seed, in start order. */
+  SeedStatisticsListType GetSeedStatistics( void ) const;
+
+  /** Write the seed statistics as CSV, one row per seed.  The failure
+   * code counts are written as the final columns, using the given names
+   * as headers, if any. */
+  void WriteSeedStatistics( std::ostream & os,
+    const std::vector< std::string > & failureCodeNames =
+      std::vector< std::string >() ) const;
+
+protected:
+
+  RidgeExtractionEventLog( void );
+  ~RidgeExtractionEventLog( void ) override;
+
+  void PrintSelf( std::ostream & os, Indent indent ) const override;
+
+private:
+
+  RidgeExtractionEventLog( const Self & );
+  void operator=( const Self & );
+
+  struct ThreadBuffer;
+
+  /** Return the buffer of the calling thread, creating it if needed. */
+  ThreadBuffer * GetThreadBuffer( void );
+
+  void Record( ThreadBuffer * buffer, unsigned char type, int tubeId,
+    double value, unsigned int failureCode );
+
+  double GetElapsedMicroseconds( void ) const;
+
+  unsigned long                                m_Identifier;
+  unsigned int                                 m_RingBufferCapacity;
+
+  mutable std::mutex                           m_Mutex;
+  std::chrono::steady_clock::time_point        m_Epoch;
+  std::vector< std::unique_ptr< ThreadBuffer > > m_ThreadBuffers;
+
+}; // End class RidgeExtractionEventLog
+
+} // End namespace tube
+
+} // End namespace itk
+
+/** Call a recording method on an event log, if the log is set.  Expands
+ * to nothing when TubeTK_USE_EXTRACTION_EVENT_LOG is off. */
+#ifdef TubeTK_USE_EXTRACTION_EVENT_LOG
+#define itkTubeRidgeExtractionEventMacro( log, call ) \
+  do \
+    { \
+    if( log ) \
+      { \
+      log->call; \
+      } \
+    } \
+  while( 0 )
+#else
+#define itkTubeRidgeExtractionEventMacro( log, call ) \
+  do \
+    { \
+    } \
+  while( 0 )
+#endif
+
+#endif // End !defined( __itktubeRidgeExtractionEventLog_h )
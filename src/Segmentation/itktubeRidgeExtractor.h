@@ -30,7 +30,10 @@ limitations under the License.
 #define __itktubeRidgeExtractor_h
 
 #include "itktubeBlurImageFunction.h"
+#include "itktubeImageRegionStatistics.h"
 #include "itktubeRadiusExtractor3.h"
+#include "itktubeRidgeExtractionEventLog.h"
+#include "itktubeSparseTubeMask.h"
 #include "tubeBrentOptimizer1D.h"
 #include "tubeSplineApproximation1D.h"
 #include "tubeSplineND.h"
@@ -76,6 +79,11 @@ public:
 
   /** Type definition for the input image. */
   typedef Image< float, TInputImage::ImageDimension >     TubeMaskImageType;
+  typedef SparseTubeMask< float, TInputImage::ImageDimension >
+                                                          SparseTubeMaskType;
+
+  /** Type definition for the intensity range of the input image */
+  typedef ImageRegionStatistics< TInputImage >            ImageStatisticsType;
 
   /** Type definition for the input image pixel type. */
   typedef typename TInputImage::PixelType                 PixelType;
@@ -117,23 +125,45 @@ public:
   /** Get the input image */
   typename InputImageType::Pointer GetInputImage( void );
 
-  /** Get the mask image */
-  itkGetModifiableObjectMacro( TubeMaskImage, TubeMaskImageType );
+  /** Get the mask image.  If a sparse tube mask is used, this is an
+   *  explicit dense export: a new image the size of the input image is
+   *  built from the sparse mask on every call and is not kept by the
+   *  extractor, so changes made to it are not seen by the extractor. */
+  typename TubeMaskImageType::Pointer GetTubeMaskImage( void );
+
+  /** Set the mask image.  If a sparse tube mask is used, its non-zero
+   *  values are copied into it. */
+  void SetTubeMaskImage( TubeMaskImageType * mask );
+
+  /** Record extracted tubes in a sparse, brick-allocated mask instead of
+   *  an image the size of the input image.  Default is false. */
+  void SetUseSparseTubeMask( bool useSparseTubeMask );
+  itkGetMacro( UseSparseTubeMask, bool );
 
-  /** Set the mask image */
-  itkSetObjectMacro( TubeMaskImage, TubeMaskImageType );
+  /** Get the sparse tube mask, or nullptr if it is not used */
+  SparseTubeMaskType * GetSparseTubeMask( void );
+
+  /** Get the value of the tube mask at an index of the input image */
+  double GetTubeMaskValue( const IndexType & indx ) const;
+
+  /** Intensity range of the input image over the extraction bounds.
+   *  SetInputImage() creates it; it is only scanned when the data
+   *  minimum or maximum is first needed and was not set explicitly.
+   *  Set it to share one instance with a RadiusExtractor3. */
+  void SetImageStatistics( ImageStatisticsType * statistics );
+  itkGetModifiableObjectMacro( ImageStatistics, ImageStatisticsType );
 
   /** Set Data Minimum */
   void SetDataMin( double dataMin );
 
   /** Get Data Minimum */
-  itkGetMacro( DataMin, double );
+  double GetDataMin( void );
 
   /** Set Data Maximum */
   void SetDataMax( double dataMax );
 
   /** Get Data Maximum */
-  itkGetMacro( DataMax, double );
+  double GetDataMax( void );
 
   /** Set Traversal Step size */
   itkSetMacro( StepX, double );
@@ -202,14 +232,14 @@ public:
   itkGetMacro( MinLevelnessStart, double );
 
 
-  /** Set Extract Bound Minimum */
-  itkSetMacro( ExtractBoundMinInIndexSpace, IndexType );
+  /** Set Extract Bound Minimum.  Also bounds the image statistics. */
+  void SetExtractBoundMinInIndexSpace( const IndexType & boundMin );
 
   /** Get Extract Bound Minimum */
   itkGetMacro( ExtractBoundMinInIndexSpace, IndexType );
 
-  /** Set Extract Bound Maximum */
-  itkSetMacro( ExtractBoundMaxInIndexSpace, IndexType );
+  /** Set Extract Bound Maximum.  Also bounds the image statistics. */
+  void SetExtractBoundMaxInIndexSpace( const IndexType & boundMax );
 
   /** Get Extract Bound Maximum */
   itkGetMacro( ExtractBoundMaxInIndexSpace, IndexType );
@@ -337,6 +367,11 @@ public:
   unsigned int      GetFailureCodeCount( FailureCodeEnum code ) const;
   void              ResetFailureCodeCounts( void );
 
+  /** Log of the steps, recovery attempts, scale changes and failures of
+   * each extraction.  Nothing is recorded unless a log is set. */
+  itkSetObjectMacro( EventLog, RidgeExtractionEventLog );
+  itkGetModifiableObjectMacro( EventLog, RidgeExtractionEventLog );
+
   /** Set the idle callback */
   void   IdleCallBack( bool ( *idleCallBack )( void ) );
 
@@ -355,6 +390,22 @@ protected:
   bool  TraverseOneWay( PointType & newX, VectorType & newT,
     MatrixType & newN, int dir, bool verbose=false );
 
+  /** Count the current failure code, and log it */
+  void  RecordFailureCode( void );
+
+  /** Set the scale, and log the change */
+  void  ChangeScale( double scale );
+
+  /** Set the value of the tube mask at an index of the input image */
+  void  SetTubeMaskValue( const IndexType & indx, double value );
+
+  /** Draw ( or, with value 0, erase ) a tube in the sparse tube mask */
+  void  DrawTubeInSparseTubeMask( const TubeType * tube, bool erase );
+
+  /** Take the data range not set explicitly from the image statistics,
+   *  if they changed since it was last taken */
+  void  UpdateDataRange( void );
+
 private:
 
   RidgeExtractor( const Self& );
@@ -365,6 +416,8 @@ private:
   typename BlurImageFunction<InputImageType>::Pointer     m_DataFunc;
 
   typename TubeMaskImageType::Pointer                     m_TubeMaskImage;
+  bool                                                    m_UseSparseTubeMask;
+  typename SparseTubeMaskType::Pointer                    m_SparseTubeMask;
 
   bool                                               m_DynamicScale;
   double                                             m_DynamicScaleUsed;
@@ -377,6 +430,10 @@ private:
   double                                             m_DataMin;
   double                                             m_DataMax;
   double                                             m_DataRange;
+  bool                                               m_DataMinIsSet;
+  bool                                               m_DataMaxIsSet;
+  typename ImageStatisticsType::Pointer              m_ImageStatistics;
+  ModifiedTimeType                                   m_DataRangeMTime;
 
   double                                             m_StepX;
   double                                             m_MaxTangentChange;
@@ -393,6 +450,8 @@ private:
   FailureCodeEnum                                    m_CurrentFailureCode;
   IntVectorType                                      m_FailureCodeCount;
 
+  RidgeExtractionEventLog::Pointer                   m_EventLog;
+
   double                                             m_MinRidgeness;
   double                                             m_MinRidgenessStart;
   double                                             m_MinRoundness;
@@ -31,9 +31,9 @@ limitations under the License.
 
 #include "tubeMessage.h"
 #include "tubeMatrixMath.h"
+#include "tubeProfiler.h"
 
 #include <itkImageRegionIterator.h>
-#include <itkMinimumMaximumImageFilter.h>
 #include <itkNeighborhoodIterator.h>
 
 #include <list>
@@ -95,6 +95,10 @@ RidgeExtractor<TInputImage>
   m_DataMin = 0;
   m_DataMax = 1;
   m_DataRange = 1;
+  m_DataMinIsSet = false;
+  m_DataMaxIsSet = false;
+  m_ImageStatistics = nullptr;
+  m_DataRangeMTime = 0;
 
   m_StepX = 0.1;
   m_X.Fill( 0.0 );
@@ -154,8 +158,12 @@ RidgeExtractor<TInputImage>
   m_FailureCodeCount.set_size( this->GetNumberOfFailureCodes() );
   m_FailureCodeCount.fill( 0 );
 
+  m_EventLog = nullptr;
+
   m_Tube = nullptr;
   m_TubeMaskImage = nullptr;
+  m_UseSparseTubeMask = false;
+  m_SparseTubeMask = nullptr;
 }
 
 /**
@@ -208,22 +216,6 @@ RidgeExtractor<TInputImage>
     m_DataFunc->SetUseRelativeSpacing( true );
     m_DataFunc->SetInputImage( inputImage );
 
-    typedef MinimumMaximumImageFilter<InputImageType> MinMaxFilterType;
-    typename MinMaxFilterType::Pointer minMaxFilter =
-      MinMaxFilterType::New();
-    minMaxFilter->SetInput( m_InputImage );
-    minMaxFilter->Update();
-    m_DataMin = minMaxFilter->GetMinimum();
-    m_DataMax = minMaxFilter->GetMaximum();
-    m_DataRange = m_DataMax-m_DataMin;
-
-    if( this->GetDebug() )
-      {
-      std::cout << "  Data Minimum = " << m_DataMin << std::endl;
-      std::cout << "  Data Maximum = " << m_DataMax << std::endl;
-      std::cout << "  Data Range = " << m_DataRange << std::endl;
-      }
-
     typename InputImageType::RegionType region;
     region = m_InputImage->GetLargestPossibleRegion();
     vnl_vector<int> vMin( ImageDimension );
@@ -239,6 +231,18 @@ RidgeExtractor<TInputImage>
     m_DataSpline->SetXMin( vMin );
     m_DataSpline->SetXMax( vMax );
 
+    /** The data range is computed when first needed */
+    if( m_ImageStatistics.IsNull()
+      || m_ImageStatistics->GetInputImage() != m_InputImage )
+      {
+      m_ImageStatistics = ImageStatisticsType::New();
+      m_ImageStatistics->SetInputImage( m_InputImage );
+      }
+    m_ImageStatistics->SetRegion( region );
+    m_DataMinIsSet = false;
+    m_DataMaxIsSet = false;
+    m_DataRangeMTime = 0;
+
     if( this->GetDebug() )
       {
       std::cout << "  Origin = " << m_InputImage->GetOrigin() << std::endl;
@@ -248,12 +252,21 @@ RidgeExtractor<TInputImage>
         << std::endl;
       }
 
-    /** Allocate the mask image */
-    m_TubeMaskImage = TubeMaskImageType::New();
-    m_TubeMaskImage->SetRegions( region );
-    m_TubeMaskImage->CopyInformation( m_InputImage );
-    m_TubeMaskImage->Allocate();
-    m_TubeMaskImage->FillBuffer( 0 );
+    /** Allocate the mask */
+    if( m_UseSparseTubeMask )
+      {
+      m_TubeMaskImage = nullptr;
+      m_SparseTubeMask = SparseTubeMaskType::New();
+      m_SparseTubeMask->SetRegion( region );
+      }
+    else
+      {
+      m_TubeMaskImage = TubeMaskImageType::New();
+      m_TubeMaskImage->SetRegions( region );
+      m_TubeMaskImage->CopyInformation( m_InputImage );
+      m_TubeMaskImage->Allocate();
+      m_TubeMaskImage->FillBuffer( 0 );
+      }
 
     } // end Image == NULL
 }
@@ -276,9 +289,21 @@ RidgeExtractor<TInputImage>
 ::SetDataMin( double dataMin )
 {
   m_DataMin = dataMin;
+  m_DataMinIsSet = true;
   m_DataRange = m_DataMax-m_DataMin;
 }
 
+/**
+ * Get Data Min value */
+template< class TInputImage >
+double
+RidgeExtractor<TInputImage>
+::GetDataMin( void )
+{
+  this->UpdateDataRange();
+  return m_DataMin;
+}
+
 /**
  * Set Data Min value */
 template< class TInputImage >
@@ -287,7 +312,106 @@ RidgeExtractor<TInputImage>
 ::SetDataMax( double dataMax )
 {
   m_DataMax = dataMax;
+  m_DataMaxIsSet = true;
+  m_DataRange = m_DataMax-m_DataMin;
+}
+
+/**
+ * Get Data Max value */
+template< class TInputImage >
+double
+RidgeExtractor<TInputImage>
+::GetDataMax( void )
+{
+  this->UpdateDataRange();
+  return m_DataMax;
+}
+
+/**
+ * Set the image statistics */
+template< class TInputImage >
+void
+RidgeExtractor<TInputImage>
+::SetImageStatistics( ImageStatisticsType * statistics )
+{
+  m_ImageStatistics = statistics;
+  if( m_ImageStatistics.IsNotNull() )
+    {
+    m_ImageStatistics->SetRegion( m_ExtractBoundMinInIndexSpace,
+      m_ExtractBoundMaxInIndexSpace );
+    }
+  m_DataRangeMTime = 0;
+}
+
+/**
+ * Update the data range from the image statistics */
+template< class TInputImage >
+void
+RidgeExtractor<TInputImage>
+::UpdateDataRange( void )
+{
+  if( m_ImageStatistics.IsNull()
+    || m_ImageStatistics->GetMTime() == m_DataRangeMTime
+    || ( m_DataMinIsSet && m_DataMaxIsSet ) )
+    {
+    return;
+    }
+  m_DataRangeMTime = m_ImageStatistics->GetMTime();
+
+  if( !m_DataMinIsSet )
+    {
+    m_DataMin = m_ImageStatistics->GetMinimum();
+    }
+  if( !m_DataMaxIsSet )
+    {
+    m_DataMax = m_ImageStatistics->GetMaximum();
+    }
   m_DataRange = m_DataMax-m_DataMin;
+
+  if( this->GetDebug() )
+    {
+    std::cout << "  Data Minimum = " << m_DataMin << std::endl;
+    std::cout << "  Data Maximum = " << m_DataMax << std::endl;
+    std::cout << "  Data Range = " << m_DataRange << std::endl;
+    }
+}
+
+/**
+ * Set the extraction bound minimum */
+template< class TInputImage >
+void
+RidgeExtractor<TInputImage>
+::SetExtractBoundMinInIndexSpace( const IndexType & boundMin )
+{
+  if( m_ExtractBoundMinInIndexSpace != boundMin )
+    {
+    m_ExtractBoundMinInIndexSpace = boundMin;
+    if( m_ImageStatistics.IsNotNull() )
+      {
+      m_ImageStatistics->SetRegion( m_ExtractBoundMinInIndexSpace,
+        m_ExtractBoundMaxInIndexSpace );
+      }
+    this->Modified();
+    }
+}
+
+/**
+ * Set the extraction bound maximum */
+template< class TInputImage >
+void
+RidgeExtractor<TInputImage>
+::SetExtractBoundMaxInIndexSpace( const IndexType & boundMax )
+{
+  if( m_ExtractBoundMaxInIndexSpace != boundMax )
+    {
+    m_ExtractBoundMaxInIndexSpace = boundMax;
+    if( m_ImageStatistics.IsNotNull() )
+      {
+      m_ImageStatistics->SetRegion( m_ExtractBoundMinInIndexSpace,
+        m_ExtractBoundMaxInIndexSpace );
+      }
+    this->Modified();
+    }
 }
 
 /**
@@ -405,6 +529,8 @@ double
 RidgeExtractor<TInputImage>
 ::IntensityInIndexSpace( const IndexType & x )
 {
+  this->UpdateDataRange();
+
   double tf = ( m_DataFunc->EvaluateAtIndex( x )-m_DataMin ) / m_DataRange;
 
   if( tf<0 )
@@ -581,6 +707,15 @@ RidgeExtractor<TInputImage>
     {
     os << indent << "DataMask = NULL" << std::endl;
     }
+  os << indent << "UseSparseTubeMask = " << m_UseSparseTubeMask << std::endl;
+  if( m_SparseTubeMask.IsNotNull() )
+    {
+    os << indent << "SparseTubeMask = " << m_SparseTubeMask << std::endl;
+    }
+  else
+    {
+    os << indent << "SparseTubeMask = NULL" << std::endl;
+    }
   if( m_DataFunc.IsNotNull() )
     {
     os << indent << "DataFunc = " << m_DataFunc << std::endl;
@@ -615,6 +750,10 @@ RidgeExtractor<TInputImage>
   os << indent << "DataMax = " << m_DataMax << std::endl;
   os << indent << "Spacing = " << m_Spacing << std::endl;
   os << indent << "DataRange = " << m_DataRange << std::endl;
+  os << indent << "DataMinIsSet = " << m_DataMinIsSet << std::endl;
+  os << indent << "DataMaxIsSet = " << m_DataMaxIsSet << std::endl;
+  os << indent << "ImageStatistics = " << m_ImageStatistics.GetPointer()
+    << std::endl;
   os << indent << "StepX = " << m_StepX << std::endl;
   os << indent << "MaxTangentChange = " << m_MaxTangentChange << std::endl;
   os << indent << "MaxXChange = " << m_MaxXChange << std::endl;
@@ -664,6 +803,7 @@ RidgeExtractor<TInputImage>
 
   os << indent << "IdleCallBack = " << m_IdleCallBack << std::endl;
   os << indent << "StatusCallBack = " << m_StatusCallBack << std::endl;
+  os << indent << "EventLog = " << m_EventLog.GetPointer() << std::endl;
 }
 
 /**
@@ -734,7 +874,7 @@ RidgeExtractor<TInputImage>
         std::cout << "Ridge: TraverseOneWay: Exited boundary" << std::endl;
         }
       m_CurrentFailureCode = EXITED_IMAGE;
-      ++m_FailureCodeCount[ m_CurrentFailureCode ];
+      this->RecordFailureCode();
       return false;
       }
     }
@@ -749,7 +889,7 @@ RidgeExtractor<TInputImage>
   pnts.clear();
 
   typename TubeMaskImageType::PixelType value =
-    m_TubeMaskImage->GetPixel( indx );
+    this->GetTubeMaskValue( indx );
   if( value != 0 && ( int )value != tubeId )
     {
     if( verbose || this->GetDebug() )
@@ -758,12 +898,12 @@ RidgeExtractor<TInputImage>
         << std::endl;
       }
     m_CurrentFailureCode = REVISITED_VOXEL;
-    ++m_FailureCodeCount[ m_CurrentFailureCode ];
+    this->RecordFailureCode();
     return false;
     }
   else
     {
-    m_TubeMaskImage->SetPixel( indx, ( float )( tubeId
+    this->SetTubeMaskValue( indx, ( float )( tubeId
       + ( tubePointCount/10000.0 ) ) );
     if( dir == 1 )
       {
@@ -851,6 +991,7 @@ RidgeExtractor<TInputImage>
     {
     if( recovery > 0 )
       {
+      itkTubeRidgeExtractionEventMacro( m_EventLog, Recovery( recovery ) );
       if( verbose || this->GetDebug() )
         {
         std::cout << "   Attempting recovery : " << recovery << std::endl;;
@@ -869,7 +1010,7 @@ RidgeExtractor<TInputImage>
           break;
         case 3:
           stepFactor = 2.0 * stepFactor0;
-          SetScale( this->GetScale() * 1.25 );
+          this->ChangeScale( this->GetScale() * 1.25 );
           break;
         }
       if( verbose || this->GetDebug() )
@@ -891,7 +1032,7 @@ RidgeExtractor<TInputImage>
         }
       if( !m_DynamicScale && this->GetScale() != iScale0 )
         {
-        SetScale( iScale0 + 0.5 * ( this->GetScale() - iScale0 ) );
+        this->ChangeScale( iScale0 + 0.5 * ( this->GetScale() - iScale0 ) );
         }
 
       if( dot_product( lStepDir, pStepDir ) <
@@ -938,6 +1079,7 @@ RidgeExtractor<TInputImage>
       {
       currentStepX = 4.0 * m_StepX;
       }
+    itkTubeRidgeExtractionEventMacro( m_EventLog, Step( currentStepX ) );
     vnl_vector<double> v = ::tube::ComputeLineStep( lXIV, currentStepX,
       lStepDir );
     for( unsigned int i=0; i<ImageDimension; i++ )
@@ -972,7 +1114,7 @@ RidgeExtractor<TInputImage>
         }
       recovery++;
       m_CurrentFailureCode = OTHER_FAIL;
-      ++m_FailureCodeCount[ m_CurrentFailureCode ];
+      this->RecordFailureCode();
       continue;
       }
 
@@ -989,7 +1131,7 @@ RidgeExtractor<TInputImage>
             << std::endl;
           }
         m_CurrentFailureCode = EXITED_IMAGE;
-        ++m_FailureCodeCount[ m_CurrentFailureCode ];
+        this->RecordFailureCode();
         break;
         }
       }
@@ -1007,6 +1149,7 @@ RidgeExtractor<TInputImage>
     PointType tmpX;
     m_InputImage->TransformContinuousIndexToPhysicalPoint( cindxX, tmpX );
 
+    tubeProfileCountMacro( "RidgeExtractor::RidgeSteps", 1 );
     ridgeness = Ridgeness( tmpX, intensity, roundness, curvature,
       levelness, lStepDir );
 
@@ -1062,7 +1205,7 @@ RidgeExtractor<TInputImage>
         std::cout << "       Levelness = " << levelness << std::endl;
         }
       m_CurrentFailureCode = TANGENT_FAIL;
-      ++m_FailureCodeCount[ m_CurrentFailureCode ];
+      this->RecordFailureCode();
       recovery++;
       continue;
       }
@@ -1084,7 +1227,7 @@ RidgeExtractor<TInputImage>
           / m_Spacing) * stepFactor << std::endl;
         }
       m_CurrentFailureCode = DISTANCE_FAIL;
-      ++m_FailureCodeCount[ m_CurrentFailureCode ];
+      this->RecordFailureCode();
       recovery++;
       continue;
       }
@@ -1102,7 +1245,7 @@ RidgeExtractor<TInputImage>
         std::cout << "       Levelness = " << levelness << std::endl;
         }
       m_CurrentFailureCode = RIDGE_FAIL;
-      ++m_FailureCodeCount[ m_CurrentFailureCode ];
+      this->RecordFailureCode();
       if( ridgeness != 0 && curvature != 0 )
         {
         recovery++;
@@ -1127,7 +1270,7 @@ RidgeExtractor<TInputImage>
         std::cout << "       Levelness = " << levelness << std::endl;
         }
       m_CurrentFailureCode = CURVE_FAIL;
-      ++m_FailureCodeCount[ m_CurrentFailureCode ];
+      this->RecordFailureCode();
       recovery++;
       continue;
       }
@@ -1145,7 +1288,7 @@ RidgeExtractor<TInputImage>
         std::cout << "       Levelness = " << levelness << std::endl;
         }
       m_CurrentFailureCode = LEVEL_FAIL;
-      ++m_FailureCodeCount[ m_CurrentFailureCode ];
+      this->RecordFailureCode();
       recovery++;
       continue;
       }
@@ -1163,7 +1306,7 @@ RidgeExtractor<TInputImage>
         std::cout << "       Levelness = " << levelness << std::endl;
         }
       m_CurrentFailureCode = ROUND_FAIL;
-      ++m_FailureCodeCount[ m_CurrentFailureCode ];
+      this->RecordFailureCode();
       if(std::fabs( lNTEVal[0] ) )
         {
         recovery++;
@@ -1179,7 +1322,7 @@ RidgeExtractor<TInputImage>
       {
       indx[i] = ( int )( lXIV[i]+0.5 );
       }
-    double maskVal = m_TubeMaskImage->GetPixel( indx );
+    double maskVal = this->GetTubeMaskValue( indx );
 
     if( maskVal != 0 )
       {
@@ -1189,7 +1332,7 @@ RidgeExtractor<TInputImage>
         && ( tubePointCount - tubePointCountStart ) > ( 20 / m_StepX ) ) )
         {
         m_CurrentFailureCode = REVISITED_VOXEL;
-        ++m_FailureCodeCount[ m_CurrentFailureCode ];
+        this->RecordFailureCode();
         if( verbose || this->GetDebug() )
           {
           std::cout << "*** Ridge terminated: Revisited voxel" << std::endl;
@@ -1204,7 +1347,7 @@ RidgeExtractor<TInputImage>
       }
     else
       {
-      m_TubeMaskImage->SetPixel( indx, ( float )( tubeId
+      this->SetTubeMaskValue( indx, ( float )( tubeId
         + ( tubePointCount/10000.0 ) ) );
       }
 
@@ -1344,7 +1487,7 @@ RidgeExtractor<TInputImage>
           std::cout << "Dynamic Scale = " << m_DynamicScaleUsed
             << std::endl;
           }
-        SetScale( m_DynamicScaleUsed );
+        this->ChangeScale( m_DynamicScaleUsed );
         m_RadiusExtractor->SetRadiusStart( m_DynamicScaleUsed );
         }
       }
@@ -1465,6 +1608,25 @@ RidgeExtractor<TInputImage>
   m_FailureCodeCount.fill( 0 );
 }
 
+template< class TInputImage >
+void
+RidgeExtractor<TInputImage>
+::RecordFailureCode( void )
+{
+  ++m_FailureCodeCount[ m_CurrentFailureCode ];
+  itkTubeRidgeExtractionEventMacro( m_EventLog,
+    Failure( m_CurrentFailureCode ) );
+}
+
+template< class TInputImage >
+void
+RidgeExtractor<TInputImage>
+::ChangeScale( double scale )
+{
+  this->SetScale( scale );
+  itkTubeRidgeExtractionEventMacro( m_EventLog, ScaleChange( scale ) );
+}
+
 
 /**
  * Compute the local ridge
@@ -1572,7 +1734,7 @@ RidgeExtractor<TInputImage>
         }
       }
 
-    if( m_TubeMaskImage->GetPixel( indx ) != 0 )
+    if( this->GetTubeMaskValue( indx ) != 0 )
       {
       if( m_StatusCallBack )
         {
@@ -1581,7 +1743,7 @@ RidgeExtractor<TInputImage>
       if( verbose || this->GetDebug() )
         {
         std::cout << "RidgeExtractor::LocalRidge() : Revisited voxel 3"
-          << m_TubeMaskImage->GetPixel( indx ) << std::endl;
+          << this->GetTubeMaskValue( indx ) << std::endl;
         }
       return REVISITED_VOXEL;
       }
@@ -1707,7 +1869,11 @@ typename RidgeExtractor<TInputImage>::TubeType *
 RidgeExtractor<TInputImage>
 ::ExtractRidge( const PointType & newX, int tubeId, bool verbose )
 {
+  tubeProfileScopeMacro( "RidgeExtractor::ExtractRidge" );
+
   double scaleOriginal = this->GetScale();
+  itkTubeRidgeExtractionEventMacro( m_EventLog,
+    BeginSeed( tubeId, scaleOriginal ) );
   double scale0 = scaleOriginal;
   double radiusOriginal = scaleOriginal;
   if( m_RadiusExtractor )
@@ -1720,11 +1886,13 @@ RidgeExtractor<TInputImage>
   m_CurrentFailureCode = LocalRidge( lX, verbose );
   if( m_CurrentFailureCode != SUCCESS )
     {
-    ++m_FailureCodeCount[ m_CurrentFailureCode ];
+    this->RecordFailureCode();
     if( verbose || this->GetDebug() )
       {
       std::cout << "LocalRidge fails at " << lX << std::endl;
       }
+    itkTubeRidgeExtractionEventMacro( m_EventLog,
+      EndSeed( false, 0, m_CurrentFailureCode ) );
     return nullptr;
     }
 
@@ -1742,11 +1910,13 @@ RidgeExtractor<TInputImage>
     indx[i] = ( int )( lXI[i] + 0.5 );
     }
   typename TubeMaskImageType::PixelType value =
-    m_TubeMaskImage->GetPixel( indx );
+    this->GetTubeMaskValue( indx );
   if( value != 0 && ( int )value != tubeId )
     {
     m_CurrentFailureCode = REVISITED_VOXEL;
-    ++m_FailureCodeCount[ m_CurrentFailureCode ];
+    this->RecordFailureCode();
+    itkTubeRidgeExtractionEventMacro( m_EventLog,
+      EndSeed( false, 0, m_CurrentFailureCode ) );
     return nullptr;
     }
 
@@ -1806,7 +1976,7 @@ RidgeExtractor<TInputImage>
       m_DynamicScaleUsed = ( r0 + scale0 ) / 2;
       }
 
-    SetScale( m_DynamicScaleUsed );
+    this->ChangeScale( m_DynamicScaleUsed );
     m_RadiusExtractor->SetRadiusStart( m_DynamicScaleUsed );
     if( verbose || this->GetDebug() )
       {
@@ -1821,7 +1991,7 @@ RidgeExtractor<TInputImage>
     m_CurrentFailureCode = LocalRidge( lX, verbose );
     if( m_CurrentFailureCode != SUCCESS )
       {
-      ++m_FailureCodeCount[ m_CurrentFailureCode ];
+      this->RecordFailureCode();
       if( m_StatusCallBack )
         {
         m_StatusCallBack( "AS Failure", NULL, 0 );
@@ -1833,6 +2003,8 @@ RidgeExtractor<TInputImage>
       m_DynamicScaleUsed = scaleOriginal;
       this->SetScale( scaleOriginal );
       m_RadiusExtractor->SetRadiusStart( radiusOriginal );
+      itkTubeRidgeExtractionEventMacro( m_EventLog,
+        EndSeed( false, 0, m_CurrentFailureCode ) );
       return nullptr;
       }
     scale0 = m_DynamicScaleUsed;
@@ -1896,6 +2068,9 @@ RidgeExtractor<TInputImage>
       {
       m_StatusCallBack( "Extract: Ridge", "Too short", 0 );
       }
+    itkTubeRidgeExtractionEventMacro( m_EventLog, EndSeed( false,
+      static_cast< unsigned int >( m_Tube->GetPoints().size() ),
+      m_CurrentFailureCode ) );
     DeleteTube( m_Tube );
     m_Tube = NULL;
     return nullptr;
@@ -1927,6 +2102,10 @@ RidgeExtractor<TInputImage>
     m_StatusCallBack( "Extract: Ridge", s, 0 );
     }
 
+  itkTubeRidgeExtractionEventMacro( m_EventLog, EndSeed( true,
+    static_cast< unsigned int >( m_Tube->GetPoints().size() ),
+    m_CurrentFailureCode ) );
+
   return m_Tube.GetPointer();
 }
 
@@ -1946,6 +2125,11 @@ RidgeExtractor<TInputImage>
 
   if( drawMask == NULL )
     {
+    if( m_UseSparseTubeMask )
+      {
+      this->DrawTubeInSparseTubeMask( tube, true );
+      return true;
+      }
     drawMask = m_TubeMaskImage;
     }
 
@@ -1965,7 +2149,7 @@ RidgeExtractor<TInputImage>
       }
     x = ( *pnt ).GetPositionInObjectSpace();
 
-    m_TubeMaskImage->TransformPhysicalPointToContinuousIndex( x, xI );
+    m_InputImage->TransformPhysicalPointToContinuousIndex( x, xI );
     bool inside = true;
     for( unsigned int i=0; i<ImageDimension; ++i )
       {
@@ -2047,6 +2231,14 @@ bool
 RidgeExtractor<TInputImage>
 ::DeleteTube( const TubeType * tube )
 {
+  if( m_UseSparseTubeMask )
+    {
+    if( tube->GetPoints().size() > 0 )
+      {
+      this->DrawTubeInSparseTubeMask( tube, true );
+      }
+    return true;
+    }
   return this->DeleteTube< TubeMaskImageType >( tube, m_TubeMaskImage );
 }
 
@@ -2071,6 +2263,11 @@ RidgeExtractor<TInputImage>
 
   if( drawMask == NULL )
     {
+    if( m_UseSparseTubeMask )
+      {
+      this->DrawTubeInSparseTubeMask( tube, false );
+      return true;
+      }
     drawMask = m_TubeMaskImage;
     }
 
@@ -2090,7 +2287,7 @@ RidgeExtractor<TInputImage>
       std::cout << "Add pnt = " << pnt->GetPositionInObjectSpace() << std::endl;
       }
     x = ( *pnt ).GetPositionInObjectSpace();
-    m_TubeMaskImage->TransformPhysicalPointToContinuousIndex( x, xI );
+    m_InputImage->TransformPhysicalPointToContinuousIndex( x, xI );
     bool inside = true;
     for( unsigned int i=0; i<ImageDimension; ++i )
       {
@@ -2182,9 +2379,180 @@ bool
 RidgeExtractor<TInputImage>
 ::AddTube( const TubeType * tube )
 {
+  if( m_UseSparseTubeMask )
+    {
+    this->DrawTubeInSparseTubeMask( tube, false );
+    return true;
+    }
   return this->AddTube< TubeMaskImageType >( tube, m_TubeMaskImage );
 }
 
+/**
+ * Draw or erase a tube in the sparse tube mask.  Matches the voxels
+ * written by AddTube and DeleteTube into a mask image. */
+template< class TInputImage >
+void
+RidgeExtractor<TInputImage>
+::DrawTubeInSparseTubeMask( const TubeType * tube, bool erase )
+{
+  int tubeId = tube->GetId();
+  int tubePointCount = 0;
+
+  PointType x;
+  ContinuousIndexType xI;
+  IndexType indx;
+
+  typename std::vector< TubePointType >::const_iterator pnt;
+  for( pnt = tube->GetPoints().begin(); pnt != tube->GetPoints().end();
+    ++pnt )
+    {
+    x = pnt->GetPositionInObjectSpace();
+    m_InputImage->TransformPhysicalPointToContinuousIndex( x, xI );
+    bool inside = true;
+    for( unsigned int i=0; i<ImageDimension; ++i )
+      {
+      indx[i] = (int)(xI[i] + 0.5);
+      if( (int)(xI[i]) < m_ExtractBoundMinInIndexSpace[i]
+        || indx[i] > m_ExtractBoundMaxInIndexSpace[i] )
+        {
+        inside = false;
+        break;
+        }
+      }
+    if( inside )
+      {
+      float value = 0;
+      if( !erase )
+        {
+        value = ( PixelType )( tubeId + ( tubePointCount/10000.0 ) );
+        }
+      m_SparseTubeMask->SetPixel( indx, value );
+      double r = pnt->GetRadiusInObjectSpace() / m_Spacing;
+      int rI = (int)( r + 0.5 );
+      if( ( erase && rI >= 1 ) || ( !erase && r >= 1 ) )
+        {
+        m_SparseTubeMask->FillBall( indx, rI, value );
+        }
+      }
+    tubePointCount++;
+    }
+}
+
+/**
+ * Get the tube mask */
+template< class TInputImage >
+typename RidgeExtractor<TInputImage>::TubeMaskImageType::Pointer
+RidgeExtractor<TInputImage>
+::GetTubeMaskImage( void )
+{
+  if( m_UseSparseTubeMask && m_SparseTubeMask.IsNotNull() )
+    {
+    typename TubeMaskImageType::Pointer maskImage =
+      TubeMaskImageType::New();
+    maskImage->SetRegions( m_SparseTubeMask->GetRegion() );
+    if( m_InputImage.IsNotNull() )
+      {
+      maskImage->CopyInformation( m_InputImage );
+      }
+    maskImage->Allocate();
+    m_SparseTubeMask->CopyToImage( maskImage );
+    return maskImage;
+    }
+  return m_TubeMaskImage;
+}
+
+/**
+ * Set the tube mask */
+template< class TInputImage >
+void
+RidgeExtractor<TInputImage>
+::SetTubeMaskImage( TubeMaskImageType * mask )
+{
+  if( m_UseSparseTubeMask )
+    {
+    if( m_SparseTubeMask.IsNull() )
+      {
+      m_SparseTubeMask = SparseTubeMaskType::New();
+      }
+    m_SparseTubeMask->CopyFromImage( mask );
+    m_TubeMaskImage = nullptr;
+    }
+  else
+    {
+    m_TubeMaskImage = mask;
+    }
+  this->Modified();
+}
+
+/**
+ * Switch between a sparse tube mask and a tube mask image */
+template< class TInputImage >
+void
+RidgeExtractor<TInputImage>
+::SetUseSparseTubeMask( bool useSparseTubeMask )
+{
+  if( useSparseTubeMask == m_UseSparseTubeMask )
+    {
+    return;
+    }
+
+  if( useSparseTubeMask )
+    {
+    m_SparseTubeMask = SparseTubeMaskType::New();
+    if( m_TubeMaskImage.IsNotNull() )
+      {
+      m_SparseTubeMask->CopyFromImage( m_TubeMaskImage );
+      }
+    m_TubeMaskImage = nullptr;
+    }
+  else if( m_SparseTubeMask.IsNotNull() )
+    {
+    m_TubeMaskImage = nullptr;
+    if( m_InputImage.IsNotNull() )
+      {
+      m_TubeMaskImage = this->GetTubeMaskImage();
+      }
+    m_SparseTubeMask = nullptr;
+    }
+  m_UseSparseTubeMask = useSparseTubeMask;
+  this->Modified();
+}
+
+template< class TInputImage >
+typename RidgeExtractor<TInputImage>::SparseTubeMaskType *
+RidgeExtractor<TInputImage>
+::GetSparseTubeMask( void )
+{
+  return m_SparseTubeMask.GetPointer();
+}
+
+template< class TInputImage >
+double
+RidgeExtractor<TInputImage>
+::GetTubeMaskValue( const IndexType & indx ) const
+{
+  if( m_UseSparseTubeMask )
+    {
+    return m_SparseTubeMask->GetPixel( indx );
+    }
+  return m_TubeMaskImage->GetPixel( indx );
+}
+
+template< class TInputImage >
+void
+RidgeExtractor<TInputImage>
+::SetTubeMaskValue( const IndexType & indx, double value )
+{
+  if( m_UseSparseTubeMask )
+    {
+    m_SparseTubeMask->SetPixel( indx, value );
+    }
+  else
+    {
+    m_TubeMaskImage->SetPixel( indx, value );
+    }
+}
+
 /** Set the idle call back */
 template< class TInputImage >
 void
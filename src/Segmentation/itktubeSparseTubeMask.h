@@ -0,0 +1,157 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright Kitware Inc.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#ifndef __itktubeSparseTubeMask_h
+#define __itktubeSparseTubeMask_h
+
+#include <itkImage.h>
+#include <itkObject.h>
+
+#include <memory>
+#include <unordered_map>
+
+namespace itk
+{
+
+namespace tube
+{
+
+/**
+ * Sparse occupancy mask for extracted tubes, stored as a hashed map of
+ * 8^N voxel bricks.
+ *
+ * A brick is allocated the first time a non-zero value is written into
+ * it and released again once all of its voxels are back to zero, so the
+ * memory used follows the extracted tubes rather than the size of the
+ * image.  Reads of unallocated bricks return zero.  The last brick used
+ * is cached, so the point-by-point reads and writes of a ridge traversal
+ * cost a hash lookup only when they cross a brick boundary.
+ *
+ * The cache makes even GetPixel() unsafe to call from several threads at
+ * once.
+ *
+ * \sa RidgeExtractor
+ */
+template< class TPixel, unsigned int VDimension >
+class SparseTubeMask : public Object
+{
+public:
+
+  typedef SparseTubeMask                Self;
+  typedef Object                        Superclass;
+  typedef SmartPointer< Self >          Pointer;
+  typedef SmartPointer< const Self >    ConstPointer;
+
+  itkNewMacro( Self );
+
+  itkTypeMacro( SparseTubeMask, Object );
+
+  itkStaticConstMacro( ImageDimension, unsigned int, VDimension );
+
+  /** Bricks span 2^BrickSizeLog2 voxels along each axis */
+  itkStaticConstMacro( BrickSizeLog2, unsigned int, 3 );
+  itkStaticConstMacro( BrickSize, unsigned int, 1 << BrickSizeLog2 );
+  itkStaticConstMacro( NumberOfPixelsPerBrick, unsigned int,
+    1 << ( BrickSizeLog2 * VDimension ) );
+
+  typedef TPixel                                PixelType;
+  typedef Image< TPixel, VDimension >           ImageType;
+  typedef typename ImageType::IndexType         IndexType;
+  typedef typename ImageType::RegionType        RegionType;
+
+  /** Set the region covered by the mask.  Clears the mask. */
+  void SetRegion( const RegionType & region );
+  itkGetConstReferenceMacro( Region, RegionType );
+
+  /** Set every voxel to zero, releasing all bricks */
+  void Clear( void );
+
+  /** Return the value at index, or zero outside of the region */
+  PixelType GetPixel( const IndexType & index ) const;
+
+  /** Set the value at index.  Ignored outside of the region. */
+  void SetPixel( const IndexType & index, PixelType value );
+
+  /** Set every voxel of the region within radius voxels of center */
+  void FillBall( const IndexType & center, int radius, PixelType value );
+
+  SizeValueType GetNumberOfAllocatedBricks( void ) const;
+
+  /** Number of voxels with a non-zero value */
+  SizeValueType GetNumberOfNonZeroPixels( void ) const;
+
+  /** Approximate memory used by the allocated bricks */
+  SizeValueType GetMemorySizeInBytes( void ) const;
+
+  /** Set the region to that of image and copy its non-zero values */
+  void CopyFromImage( const ImageType * image );
+
+  /** Write the mask into image, whose buffered region must contain the
+   *  region of the mask */
+  void CopyToImage( ImageType * image ) const;
+
+protected:
+
+  SparseTubeMask( void );
+  virtual ~SparseTubeMask( void );
+
+  void PrintSelf( std::ostream & os, Indent indent ) const override;
+
+private:
+
+  SparseTubeMask( const Self & );
+  void operator=( const Self & );
+
+  struct Brick
+    {
+    std::unique_ptr< PixelType[] >  Pixels;
+    unsigned int                    NumberOfNonZeroPixels;
+    };
+
+  typedef std::unordered_map< unsigned long long, Brick >  BrickMapType;
+
+  /** Compute the brick key and the offset within the brick of index.
+   *  Return false if index is outside of the region. */
+  bool ComputeBrickLocation( const IndexType & index,
+    unsigned long long & key, unsigned int & offset ) const;
+
+  Brick * FindBrick( unsigned long long key ) const;
+
+  RegionType                          m_Region;
+  unsigned long long                  m_BrickKeyStride[ VDimension ];
+
+  mutable BrickMapType                m_Bricks;
+
+  mutable unsigned long long          m_CachedKey;
+  mutable Brick                     * m_CachedBrick;
+
+}; // End class SparseTubeMask
+
+} // End namespace tube
+
+} // End namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itktubeSparseTubeMask.hxx"
+#endif
+
+#endif // End !defined( __itktubeSparseTubeMask_h )
@@ -0,0 +1,317 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright Kitware Inc.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#ifndef __itktubeSparseTubeMask_hxx
+#define __itktubeSparseTubeMask_hxx
+
+#include "itktubeSparseTubeMask.h"
+
+#include <itkImageRegionConstIteratorWithIndex.h>
+#include <itkImageRegionIteratorWithIndex.h>
+
+#include <algorithm>
+
+namespace itk
+{
+
+namespace tube
+{
+
+template< class TPixel, unsigned int VDimension >
+SparseTubeMask< TPixel, VDimension >
+::SparseTubeMask( void )
+{
+  for( unsigned int i = 0; i < VDimension; ++i )
+    {
+    m_BrickKeyStride[i] = 0;
+    }
+  m_CachedKey = 0;
+  m_CachedBrick = nullptr;
+}
+
+template< class TPixel, unsigned int VDimension >
+SparseTubeMask< TPixel, VDimension >
+::~SparseTubeMask( void )
+{
+}
+
+template< class TPixel, unsigned int VDimension >
+void
+SparseTubeMask< TPixel, VDimension >
+::SetRegion( const RegionType & region )
+{
+  m_Region = region;
+  unsigned long long stride = 1;
+  for( unsigned int i = 0; i < VDimension; ++i )
+    {
+    m_BrickKeyStride[i] = stride;
+    stride *= ( region.GetSize()[i] + BrickSize - 1 ) >> BrickSizeLog2;
+    }
+  this->Clear();
+}
+
+template< class TPixel, unsigned int VDimension >
+void
+SparseTubeMask< TPixel, VDimension >
+::Clear( void )
+{
+  m_Bricks.clear();
+  m_CachedBrick = nullptr;
+  this->Modified();
+}
+
+template< class TPixel, unsigned int VDimension >
+bool
+SparseTubeMask< TPixel, VDimension >
+::ComputeBrickLocation( const IndexType & index, unsigned long long & key,
+  unsigned int & offset ) const
+{
+  key = 0;
+  offset = 0;
+  for( unsigned int i = 0; i < VDimension; ++i )
+    {
+    const OffsetValueType x = index[i] - m_Region.GetIndex()[i];
+    if( x < 0 || x >= static_cast< OffsetValueType >(
+      m_Region.GetSize()[i] ) )
+      {
+      return false;
+      }
+    key += ( x >> BrickSizeLog2 ) * m_BrickKeyStride[i];
+    offset |= static_cast< unsigned int >( x & ( BrickSize - 1 ) )
+      << ( BrickSizeLog2 * i );
+    }
+  return true;
+}
+
+template< class TPixel, unsigned int VDimension >
+typename SparseTubeMask< TPixel, VDimension >::Brick *
+SparseTubeMask< TPixel, VDimension >
+::FindBrick( unsigned long long key ) const
+{
+  if( m_CachedBrick != nullptr && m_CachedKey == key )
+    {
+    return m_CachedBrick;
+    }
+  typename BrickMapType::iterator it = m_Bricks.find( key );
+  if( it == m_Bricks.end() )
+    {
+    return nullptr;
+    }
+  // Map nodes do not move on rehash, so the pointer stays valid until
+  // the brick is erased
+  m_CachedKey = key;
+  m_CachedBrick = &( it->second );
+  return m_CachedBrick;
+}
+
+template< class TPixel, unsigned int VDimension >
+typename SparseTubeMask< TPixel, VDimension >::PixelType
+SparseTubeMask< TPixel, VDimension >
+::GetPixel( const IndexType & index ) const
+{
+  unsigned long long key;
+  unsigned int offset;
+  if( !this->ComputeBrickLocation( index, key, offset ) )
+    {
+    return 0;
+    }
+  const Brick * brick = this->FindBrick( key );
+  if( brick == nullptr )
+    {
+    return 0;
+    }
+  return brick->Pixels[offset];
+}
+
+template< class TPixel, unsigned int VDimension >
+void
+SparseTubeMask< TPixel, VDimension >
+::SetPixel( const IndexType & index, PixelType value )
+{
+  unsigned long long key;
+  unsigned int offset;
+  if( !this->ComputeBrickLocation( index, key, offset ) )
+    {
+    return;
+    }
+  Brick * brick = this->FindBrick( key );
+  if( brick == nullptr )
+    {
+    if( value == 0 )
+      {
+      return;
+      }
+    brick = &( m_Bricks[key] );
+    brick->Pixels.reset( new PixelType[NumberOfPixelsPerBrick] );
+    std::fill( brick->Pixels.get(),
+      brick->Pixels.get() + NumberOfPixelsPerBrick, PixelType( 0 ) );
+    brick->NumberOfNonZeroPixels = 0;
+    m_CachedKey = key;
+    m_CachedBrick = brick;
+    }
+
+  PixelType & pixel = brick->Pixels[offset];
+  if( pixel != 0 )
+    {
+    if( value == 0 && --brick->NumberOfNonZeroPixels == 0 )
+      {
+      m_Bricks.erase( key );
+      m_CachedBrick = nullptr;
+      return;
+      }
+    }
+  else if( value != 0 )
+    {
+    ++brick->NumberOfNonZeroPixels;
+    }
+  pixel = value;
+}
+
+template< class TPixel, unsigned int VDimension >
+void
+SparseTubeMask< TPixel, VDimension >
+::FillBall( const IndexType & center, int radius, PixelType value )
+{
+  IndexType start;
+  IndexType end;
+  for( unsigned int i = 0; i < VDimension; ++i )
+    {
+    start[i] = std::max( center[i] - radius, m_Region.GetIndex()[i] );
+    end[i] = std::min( center[i] + radius,
+      static_cast< OffsetValueType >( m_Region.GetIndex()[i]
+        + m_Region.GetSize()[i] ) - 1 );
+    if( start[i] > end[i] )
+      {
+      return;
+      }
+    }
+
+  const double rr = static_cast< double >( radius ) * radius;
+  IndexType index = start;
+  for( ;; )
+    {
+    double dist = 0;
+    for( unsigned int i = 0; i < VDimension; ++i )
+      {
+      const double tf = index[i] - center[i];
+      dist += tf * tf;
+      }
+    if( dist <= rr )
+      {
+      this->SetPixel( index, value );
+      }
+
+    unsigned int i = 0;
+    for( ; i < VDimension; ++i )
+      {
+      if( ++index[i] <= end[i] )
+        {
+        break;
+        }
+      index[i] = start[i];
+      }
+    if( i == VDimension )
+      {
+      break;
+      }
+    }
+}
+
+template< class TPixel, unsigned int VDimension >
+SizeValueType
+SparseTubeMask< TPixel, VDimension >
+::GetNumberOfAllocatedBricks( void ) const
+{
+  return static_cast< SizeValueType >( m_Bricks.size() );
+}
+
+template< class TPixel, unsigned int VDimension >
+SizeValueType
+SparseTubeMask< TPixel, VDimension >
+::GetNumberOfNonZeroPixels( void ) const
+{
+  SizeValueType count = 0;
+  for( typename BrickMapType::const_iterator it = m_Bricks.begin();
+    it != m_Bricks.end(); ++it )
+    {
+    count += it->second.NumberOfNonZeroPixels;
+    }
+  return count;
+}
+
+template< class TPixel, unsigned int VDimension >
+SizeValueType
+SparseTubeMask< TPixel, VDimension >
+::GetMemorySizeInBytes( void ) const
+{
+  return static_cast< SizeValueType >( m_Bricks.size() )
+    * ( NumberOfPixelsPerBrick * sizeof( PixelType )
+      + sizeof( Brick ) + sizeof( unsigned long long ) );
+}
+
+template< class TPixel, unsigned int VDimension >
+void
+SparseTubeMask< TPixel, VDimension >
+::CopyFromImage( const ImageType * image )
+{
+  this->SetRegion( image->GetLargestPossibleRegion() );
+  ImageRegionConstIteratorWithIndex< ImageType > it( image, m_Region );
+  while( !it.IsAtEnd() )
+    {
+    if( it.Get() != 0 )
+      {
+      this->SetPixel( it.GetIndex(), it.Get() );
+      }
+    ++it;
+    }
+}
+
+template< class TPixel, unsigned int VDimension >
+void
+SparseTubeMask< TPixel, VDimension >
+::CopyToImage( ImageType * image ) const
+{
+  ImageRegionIteratorWithIndex< ImageType > it( image, m_Region );
+  while( !it.IsAtEnd() )
+    {
+    it.Set( this->GetPixel( it.GetIndex() ) );
+    ++it;
+    }
+}
+
+template< class TPixel, unsigned int VDimension >
+void
+SparseTubeMask< TPixel, VDimension >
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "Region = " << m_Region << std::endl;
+  os << indent << "NumberOfAllocatedBricks = " << m_Bricks.size()
+    << std::endl;
+}
+
+} // End namespace tube
+
+} // End namespace itk
+
+#endif // End !defined( __itktubeSparseTubeMask_hxx )
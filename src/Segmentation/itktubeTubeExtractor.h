@@ -76,6 +76,9 @@ public:
   typedef typename RidgeExtractorType::TubeMaskImageType
                                                     TubeMaskImageType;
 
+  typedef RidgeExtractionEventLog                   EventLogType;
+  typedef EventLogType::SeedStatisticsListType      SeedStatisticsListType;
+
   /**
    * Standard for the number of dimension
    */
@@ -126,7 +129,7 @@ public:
   /**
    * Set the tube mask image */
   void SetTubeMaskImage( TubeMaskImageType * mask );
-  TubeMaskImageType * GetTubeMaskImage( void );
+  typename TubeMaskImageType::Pointer GetTubeMaskImage( void );
 
 
   /***********/
@@ -254,6 +257,22 @@ public:
   /** Process seed list or seed mask */
   void ProcessSeeds( bool verbose = false );
 
+  /** Record the steps, recovery attempts, scale changes, failures and
+   *   time taken by the ridge extraction from each seed.  Off by
+   *   default; a no-op if TubeTK_USE_EXTRACTION_EVENT_LOG is off. */
+  void SetUseEventLog( bool useEventLog );
+  bool GetUseEventLog( void ) const;
+
+  /** Get the event log, or nullptr if it is not in use */
+  EventLogType * GetEventLog( void );
+
+  /** Get the statistics of each seed extracted since the event log was
+   *   enabled or last reset */
+  SeedStatisticsListType GetSeedStatistics( void ) const;
+
+  /** Write the per-seed statistics as CSV, naming the failure codes */
+  void WriteSeedStatistics( std::ostream & os ) const;
+
 
   /***********/
   /***********/
@@ -31,6 +31,7 @@ limitations under the License.
 
 
 #include <itktubeLimitedMinimumMaximumImageFilter.h>
+#include "tubeProfiler.h"
 
 #include <itkImageRegionConstIterator.h>
 #include <itkImageRegionConstIteratorWithIndex.h>
@@ -103,6 +104,11 @@ TubeExtractor<TInputImage>
 
   //this->m_RadiusExtractor = RadiusExtractor3<ImageType>::New();
   this->m_RadiusExtractor->SetInputImage( inputImage );
+
+  // Both extractors see the same image, so they share one lazily computed
+  // data range, bounded by the extraction bounds
+  this->m_RadiusExtractor->SetImageStatistics(
+    this->m_RidgeExtractor->GetModifiableImageStatistics() );
 }
 
 template< class TInputImage >
@@ -146,7 +152,7 @@ TubeExtractor<TInputImage>
 }
 
 template< class TInputImage >
-typename TubeExtractor<TInputImage>::TubeMaskImageType *
+typename TubeExtractor<TInputImage>::TubeMaskImageType::Pointer
 TubeExtractor<TInputImage>
 ::GetTubeMaskImage( void )
 {
@@ -355,6 +361,87 @@ TubeExtractor<TInputImage>
   return this->m_RidgeExtractor.GetPointer();
 }
 
+/**
+ * Enable or disable the event log */
+template< class TInputImage >
+void
+TubeExtractor<TInputImage>
+::SetUseEventLog( bool useEventLog )
+{
+  if( useEventLog == this->GetUseEventLog() )
+    {
+    return;
+    }
+  if( useEventLog )
+    {
+    this->m_RidgeExtractor->SetEventLog( EventLogType::New() );
+    }
+  else
+    {
+    this->m_RidgeExtractor->SetEventLog( nullptr );
+    }
+  this->Modified();
+}
+
+template< class TInputImage >
+bool
+TubeExtractor<TInputImage>
+::GetUseEventLog( void ) const
+{
+  return this->m_RidgeExtractor->GetEventLog() != nullptr;
+}
+
+/**
+ * Get the event log */
+template< class TInputImage >
+RidgeExtractionEventLog *
+TubeExtractor<TInputImage>
+::GetEventLog( void )
+{
+  return this->m_RidgeExtractor->GetModifiableEventLog();
+}
+
+/**
+ * Get the per-seed statistics */
+template< class TInputImage >
+typename TubeExtractor<TInputImage>::SeedStatisticsListType
+TubeExtractor<TInputImage>
+::GetSeedStatistics( void ) const
+{
+  const EventLogType * eventLog = this->m_RidgeExtractor->GetEventLog();
+  if( eventLog == nullptr )
+    {
+    return SeedStatisticsListType();
+    }
+  return eventLog->GetSeedStatistics();
+}
+
+/**
+ * Write the per-seed statistics */
+template< class TInputImage >
+void
+TubeExtractor<TInputImage>
+::WriteSeedStatistics( std::ostream & os ) const
+{
+  std::vector< std::string > failureCodeNames;
+  for( unsigned int c = 0;
+    c < this->m_RidgeExtractor->GetNumberOfFailureCodes(); ++c )
+    {
+    failureCodeNames.push_back( this->m_RidgeExtractor->GetFailureCodeName(
+      static_cast< typename RidgeExtractorType::FailureCodeEnum >( c ) ) );
+    }
+
+  const EventLogType * eventLog = this->m_RidgeExtractor->GetEventLog();
+  if( eventLog == nullptr )
+    {
+    // Without a log, write just the header
+    EventLogType::Pointer emptyLog = EventLogType::New();
+    emptyLog->WriteSeedStatistics( os, failureCodeNames );
+    return;
+    }
+  eventLog->WriteSeedStatistics( os, failureCodeNames );
+}
+
 /**
  * Get the radius extractor */
 template< class TInputImage >
@@ -390,6 +477,8 @@ TubeExtractor<TInputImage>
 ::ExtractTubeInObjectSpace( const PointType & x, unsigned int tubeID,
   bool verbose )
 {
+  tubeProfileScopeMacro( "TubeExtractor::ExtractTube" );
+
   if( verbose )
     {
     std::cout << "TubeExtractor: ExtracTubeInObjectSpace: Start" << std::endl;
@@ -401,7 +490,7 @@ TubeExtractor<TInputImage>
     }
 
   IndexType xi;
-  if( !this->m_RidgeExtractor->GetTubeMaskImage()
+  if( !this->m_RidgeExtractor->GetInputImage()
         ->TransformPhysicalPointToIndex( x, xi ) )
     {
     if( verbose )
@@ -417,11 +506,11 @@ TubeExtractor<TInputImage>
     std::cout << "Physical point = " << x << std::endl;
     std::cout << "Index point = " << xi << std::endl;
     std::cout << "Mask value = "
-      << this->m_RidgeExtractor->GetTubeMaskImage()->GetPixel( xi )
+      << this->m_RidgeExtractor->GetTubeMaskValue( xi )
       << std::endl;
     }
 
-  if( this->m_RidgeExtractor->GetTubeMaskImage()->GetPixel( xi ) != 0 )
+  if( this->m_RidgeExtractor->GetTubeMaskValue( xi ) != 0 )
     {
     if( verbose || this->GetDebug() )
       {
@@ -571,6 +660,8 @@ void
 TubeExtractor<TInputImage>
 ::ProcessSeeds( bool verbose )
 {
+  tubeProfileScopeMacro( "TubeExtractor::ProcessSeeds" );
+
   this->GetRidgeExtractor()->ResetFailureCodeCounts();
   double defaultR = this->GetRadiusInObjectSpace();
 
@@ -931,6 +1022,7 @@ void TubeExtractor<TInputImage>
   os << indent << "SeedMask = " << this->m_SeedMask << std::endl;
   os << indent << "SeedRadiusMask = " << this->m_SeedRadiusMask << std::endl;
   os << indent << "SeedMaskStride = " << this->m_SeedMaskStride << std::endl;
+  os << indent << "UseEventLog = " << this->GetUseEventLog() << std::endl;
 
   os << indent << "TubeColor.r = " << this->m_TubeColor[0] << std::endl;
   os << indent << "TubeColor.g = " << this->m_TubeColor[1] << std::endl;
@@ -0,0 +1,411 @@
+/*=========================================================================
+
+Library:   TubeTKLib
+
+Copyright Kitware Inc.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#ifndef __tubeBenchmark_h
+#define __tubeBenchmark_h
+
+#include <itkGroupSpatialObject.h>
+#include <itkImage.h>
+#include <itkImageRegionIteratorWithIndex.h>
+#include <itkMath.h>
+#include <itkMersenneTwisterRandomVariateGenerator.h>
+#include <itkMultiThreaderBase.h>
+#include <itkTubeSpatialObject.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace tube
+{
+
+/**
+ * Times benchmark functions and writes the results in the JSON layout of
+ * Google Benchmark ( --benchmark_out_format=json ), so that the existing
+ * tools for tracking those results over time can read them.
+ *
+ * Each benchmark function performs one iteration and returns the number of
+ * items ( evaluations, steps, voxels, points ) it processed.  The function
+ * is repeated until the minimum time has elapsed.
+ */
+class BenchmarkReporter
+{
+public:
+
+  BenchmarkReporter( const std::string & suiteName,
+    double minimumTimeInSeconds = 0.5 )
+    : m_SuiteName( suiteName ),
+      m_MinimumTimeInSeconds( minimumTimeInSeconds )
+    {
+    }
+
+  template< class TFunction >
+  void Run( const std::string & name, TFunction function )
+    {
+    typedef std::chrono::steady_clock ClockType;
+
+    // One untimed iteration warms the caches and any lazy initialization
+    function();
+
+    unsigned long long iterations = 0;
+    double items = 0;
+    const std::clock_t cpuStart = std::clock();
+    const ClockType::time_point start = ClockType::now();
+    double elapsed = 0;
+    do
+      {
+      items += function();
+      ++iterations;
+      elapsed = std::chrono::duration< double >( ClockType::now()
+        - start ).count();
+      }
+    while( elapsed < m_MinimumTimeInSeconds );
+    const double cpuElapsed = static_cast< double >( std::clock()
+      - cpuStart ) / CLOCKS_PER_SEC;
+
+    Result result;
+    result.Name = m_SuiteName + "/" + name;
+    result.Iterations = iterations;
+    result.RealTimeInNanoseconds = 1e9 * elapsed / iterations;
+    result.CPUTimeInNanoseconds = 1e9 * cpuElapsed / iterations;
+    result.ItemsPerSecond = items / elapsed;
+    m_Results.push_back( result );
+
+    std::cout << std::left << std::setw( 56 ) << result.Name
+      << std::right << std::setw( 14 ) << std::setprecision( 4 )
+      << result.RealTimeInNanoseconds / 1e6 << " ms"
+      << std::setw( 14 ) << result.ItemsPerSecond << " items/s"
+      << std::setw( 8 ) << iterations << std::endl;
+    }
+
+  bool Write( const std::string & filename ) const
+    {
+    std::ofstream file( filename.c_str() );
+    if( !file )
+      {
+      std::cerr << "Cannot write " << filename << std::endl;
+      return false;
+      }
+
+    char date[64];
+    const std::time_t now = std::time( nullptr );
+    std::strftime( date, sizeof( date ), "%Y-%m-%dT%H:%M:%S",
+      std::localtime( &now ) );
+
+    file << std::setprecision( 12 );
+    file << "{" << std::endl;
+    file << "  \"context\": {" << std::endl;
+    file << "    \"date\": \"" << date << "\"," << std::endl;
+    file << "    \"executable\": \"" << m_SuiteName << "\"," << std::endl;
+    file << "    \"num_cpus\": "
+      << itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads() << ","
+      << std::endl;
+#ifdef NDEBUG
+    file << "    \"library_build_type\": \"release\"" << std::endl;
+#else
+    file << "    \"library_build_type\": \"debug\"" << std::endl;
+#endif
+    file << "  }," << std::endl;
+    file << "  \"benchmarks\": [";
+    for( unsigned int i = 0; i < m_Results.size(); ++i )
+      {
+      file << ( i > 0 ? "," : "" ) << std::endl;
+      file << "    {" << std::endl;
+      file << "      \"name\": \"" << m_Results[i].Name << "\","
+        << std::endl;
+      file << "      \"run_name\": \"" << m_Results[i].Name << "\","
+        << std::endl;
+      file << "      \"run_type\": \"iteration\"," << std::endl;
+      file << "      \"iterations\": " << m_Results[i].Iterations << ","
+        << std::endl;
+      file << "      \"real_time\": " << m_Results[i].RealTimeInNanoseconds
+        << "," << std::endl;
+      file << "      \"cpu_time\": " << m_Results[i].CPUTimeInNanoseconds
+        << "," << std::endl;
+      file << "      \"time_unit\": \"ns\"," << std::endl;
+      file << "      \"items_per_second\": " << m_Results[i].ItemsPerSecond
+        << std::endl;
+      file << "    }";
+      }
+    file << std::endl << "  ]" << std::endl;
+    file << "}" << std::endl;
+
+    return static_cast< bool >( file );
+    }
+
+private:
+
+  struct Result
+    {
+    std::string         Name;
+    unsigned long long  Iterations;
+    double              RealTimeInNanoseconds;
+    double              CPUTimeInNanoseconds;
+    double              ItemsPerSecond;
+    };
+
+  std::string           m_SuiteName;
+  double                m_MinimumTimeInSeconds;
+  std::vector< Result > m_Results;
+
+}; // End class BenchmarkReporter
+
+typedef itk::Image< float, 3 >              BenchmarkImageType;
+typedef itk::TubeSpatialObject< 3 >         BenchmarkTubeType;
+typedef itk::GroupSpatialObject< 3 >        BenchmarkTubeGroupType;
+
+/** Sum of Gaussian blobs with random centers, widths and heights, plus
+ * Gaussian noise.  The same seed always gives the same volume. */
+inline BenchmarkImageType::Pointer
+CreateGaussianBlobImage( unsigned int size, unsigned int numberOfBlobs,
+  int seed )
+{
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomType;
+  RandomType::Pointer rndGen = RandomType::New();
+  rndGen->Initialize( seed );
+
+  std::vector< double > center( 3 * numberOfBlobs );
+  std::vector< double > sigma( numberOfBlobs );
+  std::vector< double > height( numberOfBlobs );
+  for( unsigned int b = 0; b < numberOfBlobs; ++b )
+    {
+    for( unsigned int d = 0; d < 3; ++d )
+      {
+      center[3 * b + d] = rndGen->GetUniformVariate( 0, size - 1 );
+      }
+    sigma[b] = rndGen->GetUniformVariate( 1, size / 8.0 + 1 );
+    height[b] = rndGen->GetUniformVariate( 50, 200 );
+    }
+
+  BenchmarkImageType::SizeType imageSize;
+  imageSize.Fill( size );
+  BenchmarkImageType::Pointer image = BenchmarkImageType::New();
+  image->SetRegions( imageSize );
+  image->Allocate();
+
+  itk::ImageRegionIteratorWithIndex< BenchmarkImageType > it( image,
+    image->GetLargestPossibleRegion() );
+  while( !it.IsAtEnd() )
+    {
+    const BenchmarkImageType::IndexType & index = it.GetIndex();
+    double value = rndGen->GetNormalVariate( 0, 4 );
+    for( unsigned int b = 0; b < numberOfBlobs; ++b )
+      {
+      double distSquared = 0;
+      for( unsigned int d = 0; d < 3; ++d )
+        {
+        const double tf = index[d] - center[3 * b + d];
+        distSquared += tf * tf;
+        }
+      value += height[b] * std::exp( -0.5 * distSquared
+        / ( sigma[b] * sigma[b] ) );
+      }
+    it.Set( value );
+    ++it;
+    }
+
+  return image;
+}
+
+/** Smooth, sinusoidal tubes that each cross the volume along one axis,
+ * with radii between 1.5 and 3 voxels.  The same seed always gives the
+ * same tubes. */
+inline BenchmarkTubeGroupType::Pointer
+CreateTubePhantom( unsigned int size, unsigned int numberOfTubes, int seed )
+{
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomType;
+  RandomType::Pointer rndGen = RandomType::New();
+  rndGen->Initialize( seed );
+
+  BenchmarkTubeGroupType::Pointer group = BenchmarkTubeGroupType::New();
+  const double margin = 6;
+  for( unsigned int t = 0; t < numberOfTubes; ++t )
+    {
+    const unsigned int axis = t % 3;
+    const double radius = rndGen->GetUniformVariate( 1.5, 3 );
+    double base[3];
+    double amplitude[3];
+    double frequency[3];
+    double phase[3];
+    for( unsigned int d = 0; d < 3; ++d )
+      {
+      base[d] = rndGen->GetUniformVariate( size / 4.0, 3 * size / 4.0 );
+      amplitude[d] = rndGen->GetUniformVariate( 0, size / 8.0 );
+      frequency[d] = rndGen->GetUniformVariate( 0.5, 2 ) * 2 * itk::Math::pi
+        / size;
+      phase[d] = rndGen->GetUniformVariate( 0, 2 * itk::Math::pi );
+      }
+
+    BenchmarkTubeType::TubePointListType points;
+    BenchmarkTubeType::TubePointType point;
+    BenchmarkTubeType::PointType x;
+    for( double s = margin; s <= size - 1 - margin; s += 0.5 )
+      {
+      for( unsigned int d = 0; d < 3; ++d )
+        {
+        x[d] = ( d == axis ) ? s
+          : base[d] + amplitude[d] * std::sin( frequency[d] * s + phase[d] );
+        }
+      point.SetPositionInObjectSpace( x );
+      point.SetRadiusInObjectSpace( radius );
+      points.push_back( point );
+      }
+
+    BenchmarkTubeType::Pointer tube = BenchmarkTubeType::New();
+    tube->SetId( t );
+    tube->SetPoints( points );
+    tube->ComputeTangentsAndNormals();
+    group->AddChild( tube );
+    }
+  group->Update();
+
+  return group;
+}
+
+/** Render the tubes of CreateTubePhantom as bright Gaussian profiles over
+ * a dark, noisy background. */
+inline BenchmarkImageType::Pointer
+CreateTubePhantomImage( unsigned int size, BenchmarkTubeGroupType * group,
+  int seed )
+{
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomType;
+  RandomType::Pointer rndGen = RandomType::New();
+  rndGen->Initialize( seed );
+
+  BenchmarkImageType::SizeType imageSize;
+  imageSize.Fill( size );
+  BenchmarkImageType::Pointer image = BenchmarkImageType::New();
+  image->SetRegions( imageSize );
+  image->Allocate();
+  image->FillBuffer( 0 );
+
+  BenchmarkTubeGroupType::ChildrenListType * tubes =
+    group->GetChildren( group->GetMaximumDepth(), "Tube" );
+  for( BenchmarkTubeGroupType::ChildrenListType::iterator tubeIt =
+    tubes->begin(); tubeIt != tubes->end(); ++tubeIt )
+    {
+    BenchmarkTubeType * tube = static_cast< BenchmarkTubeType * >(
+      tubeIt->GetPointer() );
+    for( unsigned int p = 0; p < tube->GetNumberOfPoints(); ++p )
+      {
+      const BenchmarkTubeType::TubePointType * point = tube->GetPoint( p );
+      const BenchmarkTubeType::PointType x =
+        point->GetPositionInObjectSpace();
+      const double radius = point->GetRadiusInObjectSpace();
+      BenchmarkImageType::IndexType start;
+      BenchmarkImageType::SizeType extent;
+      for( unsigned int d = 0; d < 3; ++d )
+        {
+        start[d] = static_cast< itk::IndexValueType >( std::floor( x[d]
+          - 3 * radius ) );
+        extent[d] = static_cast< itk::SizeValueType >( 6 * radius + 2 );
+        }
+      BenchmarkImageType::RegionType region( start, extent );
+      if( !region.Crop( image->GetLargestPossibleRegion() ) )
+        {
+        continue;
+        }
+      itk::ImageRegionIteratorWithIndex< BenchmarkImageType > it( image,
+        region );
+      while( !it.IsAtEnd() )
+        {
+        double distSquared = 0;
+        for( unsigned int d = 0; d < 3; ++d )
+          {
+          const double tf = it.GetIndex()[d] - x[d];
+          distSquared += tf * tf;
+          }
+        const float value = static_cast< float >( 200 * std::exp( -0.5
+          * distSquared / ( radius * radius ) ) );
+        if( value > it.Get() )
+          {
+          it.Set( value );
+          }
+        ++it;
+        }
+      }
+    }
+  delete tubes;
+
+  itk::ImageRegionIteratorWithIndex< BenchmarkImageType > it( image,
+    image->GetLargestPossibleRegion() );
+  while( !it.IsAtEnd() )
+    {
+    it.Set( it.Get() + 20 + rndGen->GetNormalVariate( 0, 25 ) );
+    ++it;
+    }
+
+  return image;
+}
+
+/** Return the total number of tube points in a group. */
+inline unsigned int
+GetNumberOfTubePoints( BenchmarkTubeGroupType * group )
+{
+  unsigned int numberOfPoints = 0;
+  BenchmarkTubeGroupType::ChildrenListType * tubes =
+    group->GetChildren( group->GetMaximumDepth(), "Tube" );
+  for( BenchmarkTubeGroupType::ChildrenListType::iterator tubeIt =
+    tubes->begin(); tubeIt != tubes->end(); ++tubeIt )
+    {
+    numberOfPoints += static_cast< BenchmarkTubeType * >(
+      tubeIt->GetPointer() )->GetNumberOfPoints();
+    }
+  delete tubes;
+  return numberOfPoints;
+}
+
+/** Read the arguments shared by all benchmark drivers: the JSON results
+ * file, then optionally the volume size and the minimum time per
+ * benchmark in seconds. */
+inline bool
+ParseBenchmarkArguments( int argc, char * argv[], std::string & results,
+  unsigned int & size, double & minimumTime )
+{
+  if( argc < 2 || argc > 4 )
+    {
+    std::cerr << "Usage: " << argv[0]
+      << " results.json [volumeSize] [minimumSecondsPerBenchmark]"
+      << std::endl;
+    return false;
+    }
+  results = argv[1];
+  if( argc > 2 )
+    {
+    size = static_cast< unsigned int >( std::atoi( argv[2] ) );
+    }
+  if( argc > 3 )
+    {
+    minimumTime = std::atof( argv[3] );
+    }
+  return true;
+}
+
+} // End namespace tube
+
+#endif // End !defined( __tubeBenchmark_h )
@@ -0,0 +1,73 @@
+/*=========================================================================
+
+Library:   TubeTKLib
+
+Copyright Kitware Inc.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#include "tubeBenchmark.h"
+
+#include "itktubeTubeSpatialObjectToImageFilter.h"
+
+int tubeFilteringBenchmark( int argc, char * argv[] )
+{
+  std::string results;
+  unsigned int size = 64;
+  double minimumTime = 0.5;
+  if( !tube::ParseBenchmarkArguments( argc, argv, results, size,
+    minimumTime ) )
+    {
+    return EXIT_FAILURE;
+    }
+
+  tube::BenchmarkTubeGroupType::Pointer phantom =
+    tube::CreateTubePhantom( size, 20, 1 );
+  const unsigned int numberOfPoints = tube::GetNumberOfTubePoints( phantom );
+
+  typedef itk::tube::TubeSpatialObjectToImageFilter< 3,
+    tube::BenchmarkImageType > FilterType;
+  tube::BenchmarkImageType::SizeType imageSize;
+  imageSize.Fill( size );
+
+  tube::BenchmarkReporter reporter( "Filtering", minimumTime );
+
+  // Items are tube points rendered
+  reporter.Run( "TubeSpatialObjectToImageFilter/Centerline", [&]()
+    {
+    FilterType::Pointer filter = FilterType::New();
+    filter->SetInput( phantom );
+    filter->SetSize( imageSize );
+    filter->SetUseRadius( false );
+    filter->Update();
+    return numberOfPoints;
+    } );
+
+  reporter.Run( "TubeSpatialObjectToImageFilter/Radius", [&]()
+    {
+    FilterType::Pointer filter = FilterType::New();
+    filter->SetInput( phantom );
+    filter->SetSize( imageSize );
+    filter->SetUseRadius( true );
+    filter->SetBuildRadiusImage( true );
+    filter->SetBuildTangentImage( true );
+    filter->Update();
+    return numberOfPoints;
+    } );
+
+  return reporter.Write( results ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
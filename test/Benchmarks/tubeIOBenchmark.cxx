@@ -0,0 +1,76 @@
+/*=========================================================================
+
+Library:   TubeTKLib
+
+Copyright Kitware Inc.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#include "tubeBenchmark.h"
+
+#include "itktubeTubeXIO.h"
+
+int tubeIOBenchmark( int argc, char * argv[] )
+{
+  std::string results;
+  unsigned int size = 64;
+  double minimumTime = 0.5;
+  if( !tube::ParseBenchmarkArguments( argc, argv, results, size,
+    minimumTime ) )
+    {
+    return EXIT_FAILURE;
+    }
+
+  // The tubes are written next to the results
+  const std::string tubeFile = results + ".tre";
+
+  tube::BenchmarkTubeGroupType::Pointer phantom =
+    tube::CreateTubePhantom( size, 50, 1 );
+  const unsigned int numberOfPoints = tube::GetNumberOfTubePoints( phantom );
+
+  typedef itk::tube::TubeXIO< 3 > TubeXIOType;
+  TubeXIOType::SizeType dimensions;
+  dimensions.Fill( size );
+
+  tube::BenchmarkReporter reporter( "IO", minimumTime );
+  bool success = true;
+
+  // Items are tube points written or read
+  reporter.Run( "TubeXIO/Write", [&]()
+    {
+    TubeXIOType::Pointer writer = TubeXIOType::New();
+    writer->SetTubeGroup( phantom );
+    writer->SetDimensions( dimensions );
+    success &= writer->Write( tubeFile );
+    return numberOfPoints;
+    } );
+
+  reporter.Run( "TubeXIO/Read", [&]()
+    {
+    TubeXIOType::Pointer reader = TubeXIOType::New();
+    success &= reader->Read( tubeFile );
+    return numberOfPoints;
+    } );
+
+  if( !success )
+    {
+    std::cerr << "Cannot write or read " << tubeFile << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return reporter.Write( results ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
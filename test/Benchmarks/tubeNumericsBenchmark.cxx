@@ -0,0 +1,107 @@
+/*=========================================================================
+
+Library:   TubeTKLib
+
+Copyright Kitware Inc.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#include "tubeBenchmark.h"
+
+#include "itktubeNJetImageFunction.h"
+
+int tubeNumericsBenchmark( int argc, char * argv[] )
+{
+  std::string results;
+  unsigned int size = 64;
+  double minimumTime = 0.5;
+  if( !tube::ParseBenchmarkArguments( argc, argv, results, size,
+    minimumTime ) )
+    {
+    return EXIT_FAILURE;
+    }
+
+  tube::BenchmarkImageType::Pointer image =
+    tube::CreateGaussianBlobImage( size, 16, 1 );
+
+  typedef itk::tube::NJetImageFunction< tube::BenchmarkImageType >
+    FunctionType;
+  FunctionType::Pointer func = FunctionType::New();
+  func->SetInputImage( image );
+
+  // The same interior points, at least one kernel extent from the border,
+  //   are evaluated in every iteration
+  const double scale = 2;
+  const unsigned int numberOfPoints = 1000;
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomType;
+  RandomType::Pointer rndGen = RandomType::New();
+  rndGen->Initialize( 2 );
+  std::vector< FunctionType::PointType > points( numberOfPoints );
+  for( unsigned int i = 0; i < numberOfPoints; ++i )
+    {
+    for( unsigned int d = 0; d < 3; ++d )
+      {
+      points[i][d] = rndGen->GetUniformVariate( 3 * scale,
+        size - 1 - 3 * scale );
+      }
+    }
+
+  tube::BenchmarkReporter reporter( "Numerics", minimumTime );
+  double sink = 0;
+
+  reporter.Run( "NJetImageFunction/Evaluate", [&]()
+    {
+    for( unsigned int i = 0; i < numberOfPoints; ++i )
+      {
+      sink += func->Evaluate( points[i], scale );
+      }
+    return numberOfPoints;
+    } );
+
+  FunctionType::VectorType d;
+  reporter.Run( "NJetImageFunction/Derivative", [&]()
+    {
+    for( unsigned int i = 0; i < numberOfPoints; ++i )
+      {
+      sink += func->Derivative( points[i], scale, d );
+      }
+    return numberOfPoints;
+    } );
+
+  FunctionType::MatrixType h;
+  reporter.Run( "NJetImageFunction/Jet", [&]()
+    {
+    for( unsigned int i = 0; i < numberOfPoints; ++i )
+      {
+      sink += func->Jet( points[i], d, h, scale );
+      }
+    return numberOfPoints;
+    } );
+
+  reporter.Run( "NJetImageFunction/Ridgeness", [&]()
+    {
+    for( unsigned int i = 0; i < numberOfPoints; ++i )
+      {
+      sink += func->Ridgeness( points[i], scale );
+      }
+    return numberOfPoints;
+    } );
+
+  std::cout << "Checksum = " << sink << std::endl;
+
+  return reporter.Write( results ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,93 @@
+/*=========================================================================
+
+Library:   TubeTKLib
+
+Copyright Kitware Inc.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#include "tubeBenchmark.h"
+
+#include "itktubePointBasedSpatialObjectToImageMetric.h"
+
+#include <itkCastImageFilter.h>
+#include <itkComposeScaleSkewVersor3DTransform.h>
+
+int tubeRegistrationBenchmark( int argc, char * argv[] )
+{
+  std::string results;
+  unsigned int size = 64;
+  double minimumTime = 0.5;
+  if( !tube::ParseBenchmarkArguments( argc, argv, results, size,
+    minimumTime ) )
+    {
+    return EXIT_FAILURE;
+    }
+
+  typedef itk::Image< double, 3 > FixedImageType;
+
+  tube::BenchmarkTubeGroupType::Pointer phantom =
+    tube::CreateTubePhantom( size, 6, 1 );
+  typedef itk::CastImageFilter< tube::BenchmarkImageType, FixedImageType >
+    CastFilterType;
+  CastFilterType::Pointer castFilter = CastFilterType::New();
+  castFilter->SetInput( tube::CreateTubePhantomImage( size, phantom, 2 ) );
+  castFilter->Update();
+
+  typedef itk::tube::PointBasedSpatialObjectToImageMetric< 3,
+    FixedImageType > MetricType;
+  typedef itk::ComposeScaleSkewVersor3DTransform< double > TransformType;
+
+  TransformType::Pointer transform = TransformType::New();
+  MetricType::Pointer metric = MetricType::New();
+  metric->SetExtent( 3 );
+  metric->SetFixedImage( castFilter->GetOutput() );
+  metric->SetMovingSpatialObject( phantom );
+  metric->SetTransform( transform.GetPointer() );
+  metric->Initialize();
+
+  const unsigned int numberOfPoints = static_cast< unsigned int >(
+    metric->GetSubsampledTubePoints().size() );
+
+  // Evaluate at a small offset from the identity, as an optimizer would
+  MetricType::ParametersType parameters = transform->GetParameters();
+  parameters[3] += 0.5;
+
+  tube::BenchmarkReporter reporter( "Registration", minimumTime );
+  double sink = 0;
+
+  // Items are tube points visited per evaluation
+  reporter.Run( "PointBasedSpatialObjectToImageMetric/GetValue", [&]()
+    {
+    sink += metric->GetValue( parameters );
+    return numberOfPoints;
+    } );
+
+  MetricType::DerivativeType derivative;
+  reporter.Run( "PointBasedSpatialObjectToImageMetric/GetValueAndDerivative",
+    [&]()
+    {
+    MetricType::MeasureType value;
+    metric->GetValueAndDerivative( parameters, value, derivative );
+    sink += value;
+    return numberOfPoints;
+    } );
+
+  std::cout << "Checksum = " << sink << std::endl;
+
+  return reporter.Write( results ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
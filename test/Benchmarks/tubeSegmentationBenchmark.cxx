@@ -0,0 +1,163 @@
+/*=========================================================================
+
+Library:   TubeTKLib
+
+Copyright Kitware Inc.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#include "tubeBenchmark.h"
+
+#include "itktubeFeatureVectorGenerator.h"
+#include "itktubePDFSegmenterParzen.h"
+#include "itktubeRadiusExtractor3.h"
+#include "itktubeRidgeExtractor.h"
+
+int tubeSegmentationBenchmark( int argc, char * argv[] )
+{
+  std::string results;
+  unsigned int size = 64;
+  double minimumTime = 0.5;
+  if( !tube::ParseBenchmarkArguments( argc, argv, results, size,
+    minimumTime ) )
+    {
+    return EXIT_FAILURE;
+    }
+
+  typedef tube::BenchmarkImageType   ImageType;
+  typedef tube::BenchmarkTubeType    TubeType;
+
+  tube::BenchmarkTubeGroupType::Pointer phantom =
+    tube::CreateTubePhantom( size, 6, 1 );
+  ImageType::Pointer image = tube::CreateTubePhantomImage( size, phantom,
+    2 );
+
+  // Seed each ridge at the middle point of a phantom tube
+  std::vector< TubeType::Pointer > phantomTubes;
+  std::vector< TubeType::PointType > seeds;
+  std::vector< double > seedRadii;
+  tube::BenchmarkTubeGroupType::ChildrenListType * tubes =
+    phantom->GetChildren( phantom->GetMaximumDepth(), "Tube" );
+  for( tube::BenchmarkTubeGroupType::ChildrenListType::iterator tubeIt =
+    tubes->begin(); tubeIt != tubes->end(); ++tubeIt )
+    {
+    TubeType * tube = static_cast< TubeType * >( tubeIt->GetPointer() );
+    phantomTubes.push_back( tube );
+    const TubeType::TubePointType * seed = tube->GetPoint(
+      tube->GetNumberOfPoints() / 2 );
+    seeds.push_back( seed->GetPositionInObjectSpace() );
+    seedRadii.push_back( seed->GetRadiusInObjectSpace() );
+    }
+  delete tubes;
+
+  tube::BenchmarkReporter reporter( "Segmentation", minimumTime );
+
+  typedef itk::tube::RidgeExtractor< ImageType > RidgeExtractorType;
+  RidgeExtractorType::Pointer ridgeOp = RidgeExtractorType::New();
+  ridgeOp->SetInputImage( image );
+  ridgeOp->SetStepX( 0.75 );
+  ridgeOp->SetDynamicScale( false );
+  reporter.Run( "RidgeExtractor/ExtractRidge", [&]()
+    {
+    // Clear the visited voxels, so that every iteration traces the same
+    //   ridges.  Items are ridge points, i.e. successful steps.
+    ridgeOp->GetTubeMaskImage()->FillBuffer( 0 );
+    unsigned int numberOfSteps = 0;
+    for( unsigned int t = 0; t < seeds.size(); ++t )
+      {
+      ridgeOp->SetScale( 0.8 * seedRadii[t] );
+      TubeType::Pointer ridge = ridgeOp->ExtractRidge( seeds[t], t + 1 );
+      if( ridge.IsNotNull() )
+        {
+        numberOfSteps += ridge->GetNumberOfPoints();
+        }
+      }
+    return numberOfSteps;
+    } );
+
+  typedef itk::tube::RadiusExtractor3< ImageType > RadiusExtractorType;
+  RadiusExtractorType::Pointer radiusOp = RadiusExtractorType::New();
+  radiusOp->SetInputImage( image );
+  radiusOp->SetRadiusStartInIndexSpace( 2 );
+  radiusOp->SetRadiusMinInIndexSpace( 1 );
+  radiusOp->SetRadiusMaxInIndexSpace( 6 );
+  reporter.Run( "RadiusExtractor3/ExtractRadii", [&]()
+    {
+    unsigned int numberOfPoints = 0;
+    for( unsigned int t = 0; t < phantomTubes.size(); ++t )
+      {
+      TubeType::Pointer tube = phantomTubes[t]->Clone();
+      radiusOp->ExtractRadii( tube );
+      numberOfPoints += tube->GetNumberOfPoints();
+      }
+    return numberOfPoints;
+    } );
+
+  // Train on voxels near the tube centerlines ( 255 ) and on dark voxels
+  //   ( 127 ); the rest are unlabeled
+  ImageType::Pointer blobs = tube::CreateGaussianBlobImage( size, 16, 3 );
+  ImageType::Pointer labelMap = ImageType::New();
+  labelMap->SetRegions( image->GetLargestPossibleRegion() );
+  labelMap->Allocate();
+  itk::ImageRegionIteratorWithIndex< ImageType > labelIt( labelMap,
+    labelMap->GetLargestPossibleRegion() );
+  while( !labelIt.IsAtEnd() )
+    {
+    const float value = image->GetPixel( labelIt.GetIndex() );
+    labelIt.Set( value > 150 ? 255 : ( value < 20 ? 127 : 0 ) );
+    ++labelIt;
+    }
+  const unsigned int numberOfVoxels = static_cast< unsigned int >(
+    labelMap->GetLargestPossibleRegion().GetNumberOfPixels() );
+
+  typedef itk::tube::FeatureVectorGenerator< ImageType >
+    FeatureVectorGeneratorType;
+  FeatureVectorGeneratorType::Pointer fvGen =
+    FeatureVectorGeneratorType::New();
+  fvGen->SetInput( image );
+  fvGen->AddInput( blobs );
+
+  typedef itk::tube::PDFSegmenterParzen< ImageType, ImageType >
+    PDFSegmenterType;
+  PDFSegmenterType::Pointer pdfSegmenter;
+  auto newPDFSegmenter = [&]()
+    {
+    pdfSegmenter = PDFSegmenterType::New();
+    pdfSegmenter->SetFeatureVectorGenerator( fvGen );
+    pdfSegmenter->SetInputLabelMap( labelMap );
+    pdfSegmenter->SetObjectId( 255 );
+    pdfSegmenter->AddObjectId( 127 );
+    pdfSegmenter->SetVoidId( 0 );
+    pdfSegmenter->SetErodeDilateRadius( 0 );
+    pdfSegmenter->SetHoleFillIterations( 0 );
+    };
+
+  reporter.Run( "PDFSegmenterParzen/Train", [&]()
+    {
+    newPDFSegmenter();
+    pdfSegmenter->Update();
+    return numberOfVoxels;
+    } );
+
+  reporter.Run( "PDFSegmenterParzen/Apply", [&]()
+    {
+    pdfSegmenter->ClassifyImages();
+    return numberOfVoxels;
+    } );
+
+  return reporter.Write( results ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
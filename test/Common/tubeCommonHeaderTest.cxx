@@ -24,6 +24,7 @@ limitations under the License.
 #include "tubeMacro.h"
 #include "tubeMessage.h"
 #include "tubeObject.h"
+#include "tubeProfiler.h"
 #include "tubeStringUtilities.h"
 
 #include "itkMacro.h"
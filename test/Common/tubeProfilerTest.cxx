@@ -0,0 +1,115 @@
+/*=========================================================================
+
+Library:   TubeTKLib
+
+Copyright Kitware Inc.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#include "tubeProfiler.h"
+
+#include <cstdlib>
+#include <sstream>
+
+int tubeProfilerTest( int argc, char * argv[] )
+{
+  if( argc > 2 )
+    {
+    std::cerr << "Usage: " << std::endl;
+    std::cerr << argv[0] << " [profileOutput]" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  tube::Profiler & profiler = tube::Profiler::GetInstance();
+
+  // Nothing is recorded while the profiler is disabled
+  profiler.Reset();
+    {
+    tubeProfileScopeMacro( "Disabled" );
+    tubeProfileCountMacro( "Test::Count", 1 );
+    }
+  if( !profiler.GetScopes().empty() || !profiler.GetCounters().empty() )
+    {
+    std::cerr << "Profiler recorded while disabled" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  profiler.SetEnabled( true );
+    {
+    tubeProfileScopeMacro( "Outer" );
+    for( unsigned int i = 0; i < 10; ++i )
+      {
+      tubeProfileScopeMacro( "Inner" );
+      tubeProfileCountMacro( "Test::Count", 2 );
+      }
+    }
+  profiler.SetEnabled( false );
+
+  std::vector< tube::Profiler::ScopeRecord > scopes = profiler.GetScopes();
+  if( scopes.size() != 11 )
+    {
+    std::cerr << "Expected 11 scopes, found " << scopes.size() << std::endl;
+    return EXIT_FAILURE;
+    }
+  if( scopes[0].Path != "Outer/Inner" || scopes[0].Depth != 1
+    || scopes[10].Path != "Outer" || scopes[10].Depth != 0 )
+    {
+    std::cerr << "Scopes are not nested: " << scopes[0].Path << ", "
+      << scopes[10].Path << std::endl;
+    return EXIT_FAILURE;
+    }
+  if( scopes[10].DurationInMicroseconds < scopes[0].DurationInMicroseconds )
+    {
+    std::cerr << "Outer scope is shorter than an inner scope" << std::endl;
+    return EXIT_FAILURE;
+    }
+  if( profiler.GetCounters()["Test::Count"] != 20 )
+    {
+    std::cerr << "Expected a count of 20, found "
+      << profiler.GetCounters()["Test::Count"] << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  std::ostringstream json;
+  profiler.WriteJSON( json );
+  std::ostringstream trace;
+  profiler.WriteChromeTrace( trace );
+  if( json.str().find( "\"Outer/Inner\", \"calls\": 10" ) == std::string::npos
+    || trace.str().find( "\"traceEvents\"" ) == std::string::npos )
+    {
+    std::cerr << "Unexpected profile output:" << std::endl << json.str()
+      << trace.str() << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  if( argc > 1 && !profiler.WriteFile( argv[1] ) )
+    {
+    std::cerr << "Cannot write " << argv[1] << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Counters survive a reset, so cached call sites stay valid
+  profiler.Reset();
+  if( !profiler.GetScopes().empty()
+    || profiler.GetCounters()["Test::Count"] != 0 )
+    {
+    std::cerr << "Reset did not clear the profile" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,192 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright 2010 Kitware Inc. 28 Corporate Drive,
+Clifton Park, NY, 12065, USA.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#include "itktubeContrastCostFunction.h"
+
+#include <itkImageRegionIteratorWithIndex.h>
+#include <itkMersenneTwisterRandomVariateGenerator.h>
+
+#include <cmath>
+
+int itktubeContrastCostFunctionTest( int itkNotUsed( argc ),
+  char * itkNotUsed( argv )[] )
+{
+  enum { Dimension = 2 };
+
+  typedef float                                            PixelType;
+  typedef itk::Image< PixelType, Dimension >               ImageType;
+  typedef itk::tube::ContrastCostFunction< PixelType, Dimension >
+    CostFunctionType;
+
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator
+    RandomType;
+  RandomType::Pointer rnd = RandomType::New();
+  rnd->Initialize( 1 );
+
+  ImageType::RegionType region;
+  ImageType::SizeType size;
+  size.Fill( 32 );
+  region.SetSize( size );
+
+  // A bright disk on a noisy ramp; the mask marks the disk as object and
+  //   a ring around it as background
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions( region );
+  image->Allocate();
+  ImageType::Pointer mask = ImageType::New();
+  mask->SetRegions( region );
+  mask->Allocate();
+  itk::ImageRegionIteratorWithIndex< ImageType > it( image, region );
+  itk::ImageRegionIteratorWithIndex< ImageType > maskIt( mask, region );
+  while( !it.IsAtEnd() )
+    {
+    const double dx = it.GetIndex()[0] - 16.0;
+    const double dy = it.GetIndex()[1] - 16.0;
+    const double dist = std::sqrt( dx * dx + dy * dy );
+    it.Set( ( dist < 6 ? 100 : 20 ) + it.GetIndex()[0]
+      + rnd->GetNormalVariate( 0, 25 ) );
+    if( dist < 6 )
+      {
+      maskIt.Set( 255 );
+      }
+    else if( dist < 12 )
+      {
+      maskIt.Set( 128 );
+      }
+    else
+      {
+      maskIt.Set( 0 );
+      }
+    ++it;
+    ++maskIt;
+    }
+
+  CostFunctionType::ParametersType scales( 3 );
+  scales[0] = 4;
+  scales[1] = 2;
+  scales[2] = 100;
+
+  // Without a cache every evaluation blurs again; the cached values
+  //   must be identical
+  CostFunctionType::Pointer costFunc[2];
+  ImageType::Pointer output[2];
+  for( unsigned int c = 0; c < 2; ++c )
+    {
+    output[c] = ImageType::New();
+    output[c]->SetRegions( region );
+    output[c]->Allocate();
+    costFunc[c] = CostFunctionType::New();
+    costFunc[c]->SetInputImage( image );
+    costFunc[c]->SetInputMask( mask );
+    costFunc[c]->SetOutputImage( output[c] );
+    costFunc[c]->SetMaskObjectValue( 255 );
+    costFunc[c]->SetMaskBackgroundValue( 128 );
+    costFunc[c]->SetScales( scales );
+    if( c == 1 )
+      {
+      costFunc[c]->SetMaximumNumberOfCachedImages( 0 );
+      }
+    costFunc[c]->Initialize();
+    }
+
+  int returnStatus = EXIT_SUCCESS;
+
+  const double paramValues[5][3] = {
+    { 1, 3, 0.01 },
+    { 1.5, 4, -0.01 },
+    { 1, 3, 0.01 },
+    { 0.2, 3, 0 },
+    { 2, 1.5, 0 } };
+  CostFunctionType::ParametersType params( 3 );
+  for( unsigned int p = 0; p < 5; ++p )
+    {
+    for( unsigned int i = 0; i < 3; ++i )
+      {
+      params[i] = paramValues[p][i];
+      }
+    const double value0 = costFunc[0]->GetValue( params );
+    const double value1 = costFunc[1]->GetValue( params );
+    if( value0 != value1 )
+      {
+      std::cerr << "ERROR: Cached value " << value0
+        << " != uncached value " << value1 << " for " << params
+        << std::endl;
+      returnStatus = EXIT_FAILURE;
+      }
+    if( p >= 3 && value0 != 100 )
+      {
+      std::cerr << "ERROR: Invalid scales " << params << " gave "
+        << value0 << " instead of 100" << std::endl;
+      returnStatus = EXIT_FAILURE;
+      }
+
+    CostFunctionType::DerivativeType deriv0;
+    CostFunctionType::DerivativeType deriv1;
+    costFunc[0]->GetDerivative( params, deriv0 );
+    costFunc[1]->GetDerivative( params, deriv1 );
+    if( deriv0 != deriv1 )
+      {
+      std::cerr << "ERROR: Cached derivative " << deriv0
+        << " != uncached derivative " << deriv1 << " for " << params
+        << std::endl;
+      returnStatus = EXIT_FAILURE;
+      }
+    }
+
+  if( costFunc[0]->GetNumberOfCacheHits() == 0
+    || costFunc[1]->GetNumberOfCacheHits() != 0
+    || costFunc[0]->GetNumberOfBlurs() >= costFunc[1]->GetNumberOfBlurs() )
+    {
+    std::cerr << "ERROR: Cache used " << costFunc[0]->GetNumberOfBlurs()
+      << " blurs and " << costFunc[0]->GetNumberOfCacheHits()
+      << " hits; without a cache "
+      << costFunc[1]->GetNumberOfBlurs() << " blurs and "
+      << costFunc[1]->GetNumberOfCacheHits() << " hits" << std::endl;
+    returnStatus = EXIT_FAILURE;
+    }
+
+  // Scales GetValue() rejects are clamped to the range it accepts
+  params[0] = 0.1;
+  params[1] = 0.05;
+  params[2] = 0.01;
+  costFunc[0]->ComputeOutputImage( params );
+  params[0] = 0.3;
+  params[1] = 0.3;
+  costFunc[1]->ComputeOutputImage( params );
+  itk::ImageRegionIteratorWithIndex< ImageType > out0( output[0], region );
+  itk::ImageRegionIteratorWithIndex< ImageType > out1( output[1], region );
+  while( !out0.IsAtEnd() )
+    {
+    if( !std::isfinite( out0.Get() ) || out0.Get() != out1.Get() )
+      {
+      std::cerr << "ERROR: Output at " << out0.GetIndex() << " is "
+        << out0.Get() << ", expected " << out1.Get() << std::endl;
+      returnStatus = EXIT_FAILURE;
+      break;
+      }
+    ++out0;
+    ++out1;
+    }
+
+  return returnStatus;
+}
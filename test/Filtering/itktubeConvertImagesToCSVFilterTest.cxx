@@ -0,0 +1,205 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright 2010 Kitware Inc. 28 Corporate Drive,
+Clifton Park, NY, 12065, USA.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#include "itktubeConvertImagesToCSVFilter.h"
+
+#include <itkImageRegionIteratorWithIndex.h>
+
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+int itktubeConvertImagesToCSVFilterTest( int argc, char * argv[] )
+{
+  if( argc != 2 )
+    {
+    std::cout << "Missing arguments." << std::endl;
+    std::cout << "Usage: " << std::endl;
+    std::cout << argv[0] << " outputNPYFile" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  enum { Dimension = 2 };
+
+  typedef float                                      PixelType;
+  typedef itk::Image< PixelType, Dimension >         ImageType;
+  typedef unsigned char                              MaskPixelType;
+  typedef itk::Image< MaskPixelType, Dimension >     MaskType;
+
+  typedef itk::tube::ConvertImagesToCSVFilter< ImageType, MaskType >
+    FilterType;
+
+  ImageType::RegionType region;
+  ImageType::SizeType size;
+  size[0] = 7;
+  size[1] = 5;
+  region.SetSize( size );
+
+  const unsigned int numImages = 2;
+  ImageType::Pointer image[numImages];
+  for( unsigned int i = 0; i < numImages; ++i )
+    {
+    image[i] = ImageType::New();
+    image[i]->SetRegions( region );
+    image[i]->Allocate();
+    itk::ImageRegionIteratorWithIndex< ImageType > it( image[i], region );
+    while( !it.IsAtEnd() )
+      {
+      it.Set( ( i + 1 ) * 100 + it.GetIndex()[0]
+        + 0.5 * it.GetIndex()[1] );
+      ++it;
+      }
+    }
+
+  MaskType::Pointer mask = MaskType::New();
+  mask->SetRegions( region );
+  mask->Allocate();
+  itk::ImageRegionIteratorWithIndex< MaskType > maskIt( mask, region );
+  while( !maskIt.IsAtEnd() )
+    {
+    const MaskType::IndexType & indx = maskIt.GetIndex();
+    if( ( indx[0] + indx[1] ) % 3 == 0 )
+      {
+      maskIt.Set( 1 + indx[0] % 2 );
+      }
+    else
+      {
+      maskIt.Set( 0 );
+      }
+    ++maskIt;
+    }
+
+  // The in-memory matrix is the reference for the streamed .npy file
+  FilterType::Pointer matrixFilter = FilterType::New();
+  matrixFilter->SetInputMask( mask );
+  matrixFilter->SetInput( image[0] );
+  matrixFilter->AddImage( image[1] );
+  matrixFilter->SetNumImages( numImages );
+  matrixFilter->SetStride( 2 );
+  matrixFilter->Update();
+  const unsigned int numberOfRows = matrixFilter->GetNumberRows();
+  const FilterType::VnlMatrixType matrix = matrixFilter->GetOutput()->Get();
+
+  if( numberOfRows == 0 )
+    {
+    std::cerr << "ERROR: No rows were generated" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // A chunk size smaller than a column splits every column across writes
+  FilterType::Pointer npyFilter = FilterType::New();
+  npyFilter->SetInputMask( mask );
+  npyFilter->SetInput( image[0] );
+  npyFilter->AddImage( image[1] );
+  npyFilter->SetNumImages( numImages );
+  npyFilter->SetStride( 2 );
+  npyFilter->SetOutputFileName( argv[1] );
+  npyFilter->SetOutputFileFormat( FilterType::NPY_FILE_FORMAT );
+  npyFilter->SetChunkSize( 3 );
+  npyFilter->Update();
+
+  int returnStatus = EXIT_SUCCESS;
+
+  if( npyFilter->GetNumberRows() != numberOfRows )
+    {
+    std::cerr << "ERROR: Streamed " << npyFilter->GetNumberRows()
+      << " rows, expected " << numberOfRows << std::endl;
+    returnStatus = EXIT_FAILURE;
+    }
+  if( npyFilter->GetOutput()->Get().rows() != 0 )
+    {
+    std::cerr << "ERROR: Streaming filled the output matrix" << std::endl;
+    returnStatus = EXIT_FAILURE;
+    }
+
+  std::ifstream file( argv[1], std::ios::in | std::ios::binary );
+  if( !file.is_open() )
+    {
+    std::cerr << "ERROR: Cannot open " << argv[1] << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  char preamble[10];
+  file.read( preamble, 10 );
+  if( !file.good() || std::memcmp( preamble, "\x93NUMPY\x01\x00", 8 ) != 0 )
+    {
+    std::cerr << "ERROR: Missing .npy magic string or version 1.0"
+      << std::endl;
+    return EXIT_FAILURE;
+    }
+  const unsigned int headerLength =
+    static_cast< unsigned char >( preamble[8] )
+    + 256 * static_cast< unsigned char >( preamble[9] );
+  if( ( 10 + headerLength ) % 64 != 0 )
+    {
+    std::cerr << "ERROR: Header is not padded to 64 bytes" << std::endl;
+    returnStatus = EXIT_FAILURE;
+    }
+  std::string header( headerLength, ' ' );
+  file.read( &header[0], headerLength );
+  if( header[headerLength - 1] != '\n' )
+    {
+    std::cerr << "ERROR: Header does not end with a newline" << std::endl;
+    returnStatus = EXIT_FAILURE;
+    }
+
+  const std::string descr = "'descr': '<f4'";
+  const std::string order = "'fortran_order': True";
+  const std::string shape = "'shape': (" + std::to_string( numberOfRows )
+    + ", " + std::to_string( numImages + 1 ) + ")";
+  if( header.find( descr ) == std::string::npos
+    || header.find( order ) == std::string::npos
+    || header.find( shape ) == std::string::npos )
+    {
+    std::cerr << "ERROR: Unexpected header " << header << std::endl;
+    std::cerr << "   Expected " << descr << ", " << order << " and "
+      << shape << std::endl;
+    returnStatus = EXIT_FAILURE;
+    }
+
+  // Column-major data must match the matrix and end the file
+  std::vector< PixelType > data( numberOfRows * ( numImages + 1 ) );
+  file.read( reinterpret_cast< char * >( data.data() ),
+    data.size() * sizeof( PixelType ) );
+  if( !file.good() || file.peek() != std::ifstream::traits_type::eof() )
+    {
+    std::cerr << "ERROR: Data size does not match the shape" << std::endl;
+    return EXIT_FAILURE;
+    }
+  for( unsigned int c = 0; c < numImages + 1; ++c )
+    {
+    for( unsigned int r = 0; r < numberOfRows; ++r )
+      {
+      if( data[c * numberOfRows + r] != matrix( r, c ) )
+        {
+        std::cerr << "ERROR: Element ( " << r << ", " << c << " ) is "
+          << data[c * numberOfRows + r] << ", expected " << matrix( r, c )
+          << std::endl;
+        returnStatus = EXIT_FAILURE;
+        }
+      }
+    }
+
+  return returnStatus;
+}
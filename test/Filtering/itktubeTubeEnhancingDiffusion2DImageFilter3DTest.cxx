@@ -0,0 +1,190 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright Kitware Inc.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#include "itktubeTubeEnhancingDiffusion2DImageFilter.h"
+
+#include <itkImageRegionConstIterator.h>
+#include <itkImageRegionIteratorWithIndex.h>
+#include <itkMersenneTwisterRandomVariateGenerator.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+
+typedef float                                  Tube3DPixelType;
+typedef itk::Image< Tube3DPixelType, 3 >       Tube3DImageType;
+
+// Standard deviation and mean of the image along the line y = z = 12,
+//   away from the image boundary
+void LineStatistics( const Tube3DImageType * image, double & mean,
+  double & stdDev )
+{
+  double sum = 0;
+  double sumSquares = 0;
+  unsigned int count = 0;
+  Tube3DImageType::IndexType indx;
+  indx[1] = 12;
+  indx[2] = 12;
+  for( indx[0] = 4; indx[0] < 20; ++indx[0] )
+    {
+    const double value = image->GetPixel( indx );
+    sum += value;
+    sumSquares += value * value;
+    ++count;
+    }
+  mean = sum / count;
+  stdDev = std::sqrt( std::max( 0.0, sumSquares / count - mean * mean ) );
+}
+
+} // End namespace
+
+int itktubeTubeEnhancingDiffusion2DImageFilter3DTest( int itkNotUsed( argc ),
+  char * itkNotUsed( argv )[] )
+{
+  typedef itk::tube::TubeEnhancingDiffusion2DImageFilter< Tube3DPixelType,
+    3 > FilterType;
+
+  // Dark tube along x on a bright, noisy background
+  Tube3DImageType::RegionType region;
+  Tube3DImageType::SizeType size;
+  size.Fill( 24 );
+  region.SetSize( size );
+  Tube3DImageType::Pointer input = Tube3DImageType::New();
+  input->SetRegions( region );
+  input->Allocate();
+
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator
+    RandomType;
+  RandomType::Pointer random = RandomType::New();
+  random->Initialize( 1 );
+
+  itk::ImageRegionIteratorWithIndex< Tube3DImageType > it( input, region );
+  while( !it.IsAtEnd() )
+    {
+    const Tube3DImageType::IndexType & indx = it.GetIndex();
+    const double dy = indx[1] - 12.0;
+    const double dz = indx[2] - 12.0;
+    it.Set( 100 - 80 * std::exp( -( dy * dy + dz * dz ) / 8 )
+      + random->GetUniformVariate( -10, 10 ) );
+    ++it;
+    }
+
+  FilterType::Pointer filter = FilterType::New();
+  filter->SetInput( input );
+  filter->SetDefaultPars();
+  filter->SetVerbose( false );
+  // Largest stable step for Omega = 25
+  filter->SetTimeStep( 0 );
+  filter->SetIterations( 10 );
+  filter->SetRecalculateTubeness( 5 );
+  std::vector< float > scales( 1, 2.0f );
+  filter->SetScales( scales );
+  filter->Update();
+
+  int returnStatus = EXIT_SUCCESS;
+
+  const double expectedTimeStep = 0.5 / ( 3 * 25.0 );
+  if( std::fabs( filter->GetTimeStep() - expectedTimeStep ) > 1e-6 )
+    {
+    std::cerr << "Time step = " << filter->GetTimeStep() << " != "
+      << expectedTimeStep << std::endl;
+    returnStatus = EXIT_FAILURE;
+    }
+
+  Tube3DImageType::Pointer output = filter->GetOutput();
+
+  // The step of SetDefaultPars() is too large for Omega = 25, so it is
+  //   reduced to the largest stable step and gives the same output
+  FilterType::Pointer defaultStepFilter = FilterType::New();
+  defaultStepFilter->SetInput( input );
+  defaultStepFilter->SetDefaultPars();
+  defaultStepFilter->SetVerbose( false );
+  defaultStepFilter->SetIterations( 10 );
+  defaultStepFilter->SetRecalculateTubeness( 5 );
+  defaultStepFilter->SetScales( scales );
+  defaultStepFilter->Update();
+  if( std::fabs( defaultStepFilter->GetTimeStep() - expectedTimeStep )
+    > 1e-6 )
+    {
+    std::cerr << "Reduced time step = " << defaultStepFilter->GetTimeStep()
+      << " != " << expectedTimeStep << std::endl;
+    returnStatus = EXIT_FAILURE;
+    }
+  itk::ImageRegionConstIterator< Tube3DImageType > defaultIt(
+    defaultStepFilter->GetOutput(), region );
+  itk::ImageRegionConstIterator< Tube3DImageType > expectedIt( output,
+    region );
+  for( ; !defaultIt.IsAtEnd(); ++defaultIt, ++expectedIt )
+    {
+    if( defaultIt.Get() != expectedIt.Get() )
+      {
+      std::cerr << "Output with the reduced time step differs at "
+        << defaultIt.GetIndex() << std::endl;
+      returnStatus = EXIT_FAILURE;
+      break;
+      }
+    }
+
+  itk::ImageRegionConstIterator< Tube3DImageType > outIt( output, region );
+  while( !outIt.IsAtEnd() )
+    {
+    if( !std::isfinite( outIt.Get() ) )
+      {
+      std::cerr << "Output is not finite at " << outIt.GetIndex()
+        << std::endl;
+      return EXIT_FAILURE;
+      }
+    ++outIt;
+    }
+
+  // Diffusion along the tube removes most of the noise on its centerline
+  double inputMean;
+  double inputStdDev;
+  LineStatistics( input, inputMean, inputStdDev );
+  double outputMean;
+  double outputStdDev;
+  LineStatistics( output, outputMean, outputStdDev );
+  std::cout << "Centerline mean / std dev: input = " << inputMean << " / "
+    << inputStdDev << ", output = " << outputMean << " / " << outputStdDev
+    << std::endl;
+  if( !( outputStdDev < 0.8 * inputStdDev ) )
+    {
+    std::cerr << "Noise along the tube was not reduced" << std::endl;
+    returnStatus = EXIT_FAILURE;
+    }
+
+  // Little diffusion across the tube, so its contrast is kept
+  Tube3DImageType::IndexType backgroundIndex;
+  backgroundIndex.Fill( 12 );
+  backgroundIndex[1] = 3;
+  const double background = output->GetPixel( backgroundIndex );
+  if( !( background - outputMean > 50 ) )
+    {
+    std::cerr << "Tube contrast was lost: centerline = " << outputMean
+      << ", background = " << background << std::endl;
+    returnStatus = EXIT_FAILURE;
+    }
+
+  return returnStatus;
+}
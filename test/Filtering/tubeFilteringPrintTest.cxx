@@ -135,6 +135,12 @@ int tubeFilteringPrintTest( int itkNotUsed( argc ), char * itkNotUsed(
   std::cout << "-------------TubeEnhancingDiffusion2DImageFilter"
     << vesselEnahncingObj << std::endl;
 
+  itk::tube::TubeEnhancingDiffusion2DImageFilter< float, 3 >::Pointer
+    vesselEnahncing3DObj = itk::tube::TubeEnhancingDiffusion2DImageFilter<
+    float, 3 >::New();
+  std::cout << "-------------TubeEnhancingDiffusion2DImageFilter 3D"
+    << vesselEnahncing3DObj << std::endl;
+
   itk::tube::SheetnessMeasureImageFilter< float >::Pointer
     sheetnessMeasureImageFilterObj =
     itk::tube::SheetnessMeasureImageFilter< float >::New();
@@ -0,0 +1,328 @@
+/*=========================================================================
+
+Library:   TubeTKLib
+
+Copyright Kitware Inc.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkTimeProbe.h"
+
+#include "tubeImageMathFilters.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+typedef itk::Image< float, 3 > ImageMathTestImageType;
+
+const unsigned int ImageMathTestNumberOfSteps = 9;
+
+ImageMathTestImageType::Pointer
+CreateImageMathTestImage( unsigned int size, int seed, bool integral )
+{
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomType;
+  RandomType::Pointer rndGen = RandomType::New();
+  rndGen->Initialize( seed );
+
+  ImageMathTestImageType::SizeType imageSize;
+  imageSize.Fill( size );
+  ImageMathTestImageType::Pointer image = ImageMathTestImageType::New();
+  image->SetRegions( imageSize );
+  image->Allocate();
+
+  float * buffer = image->GetBufferPointer();
+  const itk::SizeValueType numberOfPixels =
+    image->GetBufferedRegion().GetNumberOfPixels();
+  for( itk::SizeValueType i = 0; i < numberOfPixels; ++i )
+    {
+    buffer[i] = rndGen->GetUniformVariate( -100, 100 );
+    if( integral )
+      {
+      buffer[i] = static_cast< float >( static_cast< int >( buffer[i] / 20 ) );
+      }
+    }
+  // Values that exercise the edge cases of the clamps and comparisons.
+  //   Integral images are masks, whose mean must stay finite.
+  if( !integral )
+    {
+    buffer[0] = std::numeric_limits< float >::quiet_NaN();
+    buffer[1] = std::numeric_limits< float >::infinity();
+    buffer[2] = -0.0f;
+    }
+  return image;
+}
+
+void
+RunImageMathTestStep( tube::ImageMathFilters< 3 > & filters,
+  unsigned int step, ImageMathTestImageType * operand,
+  ImageMathTestImageType * mask )
+{
+  switch( step )
+    {
+    case 0:
+      filters.ApplyIntensityWindowing( -50, 50, 0, 255 );
+      break;
+    case 1:
+      filters.AddImages( operand, 0.75, 0.25 );
+      break;
+    case 2:
+      filters.FuseImages( operand, 10 );
+      break;
+    case 3:
+      filters.ApplyIntensityMultiplicativeBiasCorrection( mask );
+      break;
+    case 4:
+      filters.MultiplyImages( operand );
+      break;
+    case 5:
+      filters.AbsoluteImage();
+      break;
+    case 6:
+      filters.ReplaceValuesOutsideMaskRange( mask, -2, 2, -1 );
+      break;
+    case 7:
+      filters.ReplaceValueWithinMaskRange( mask, -3, 3, -1, 7 );
+      break;
+    default:
+      filters.ThresholdImage( 0, 1000, 1, 0 );
+      break;
+    }
+}
+
+/** Applies a step to values, pixel by pixel, as documented by
+ * ImageMathFilters: arithmetic in double, stored as float, and NaN
+ * failing every comparison. */
+void
+ReferenceImageMathTestStep( std::vector< float > & values,
+  unsigned int step, const ImageMathTestImageType * operandImage,
+  const ImageMathTestImageType * maskImage )
+{
+  const float * operand = operandImage->GetBufferPointer();
+  const float * mask = maskImage->GetBufferPointer();
+  double maskMean = 0;
+  int maskCount = 0;
+  for( unsigned int i = 0; i < values.size(); ++i )
+    {
+    maskMean += mask[i];
+    if( mask[i] != 0 )
+      {
+      ++maskCount;
+      }
+    }
+  maskMean /= maskCount;
+
+  for( unsigned int i = 0; i < values.size(); ++i )
+    {
+    const double v = values[i];
+    const double o = operand[i];
+    const double m = mask[i];
+    switch( step )
+      {
+      case 0:
+        {
+        const float inMin = -50;
+        const float inMax = 50;
+        const float outMin = 0;
+        const float outMax = 255;
+        double tf = ( v - inMin ) / ( inMax - inMin );
+        if( tf < 0 )
+          {
+          tf = 0;
+          }
+        else if( tf > 1 )
+          {
+          tf = 1;
+          }
+        values[i] = static_cast< float >( tf * ( outMax - outMin )
+          + outMin );
+        break;
+        }
+      case 1:
+        values[i] = static_cast< float >( 0.75f * v + 0.25f * o );
+        break;
+      case 2:
+        if( o > v )
+          {
+          values[i] = static_cast< float >( 10.0f + o );
+          }
+        break;
+      case 3:
+        if( m != 0 )
+          {
+          values[i] = static_cast< float >( v * ( maskMean / m ) );
+          }
+        break;
+      case 4:
+        values[i] = values[i] * operand[i];
+        break;
+      case 5:
+        values[i] = std::fabs( values[i] );
+        break;
+      case 6:
+        if( !( m >= -2 && m <= 2 ) )
+          {
+          values[i] = -1;
+          }
+        break;
+      case 7:
+        if( m >= -3 && m <= 3 && values[i] == -1 )
+          {
+          values[i] = 7;
+          }
+        break;
+      default:
+        values[i] = ( v >= 0 && v <= 1000 ) ? 1 : 0;
+        break;
+      }
+    }
+}
+
+/** Counts the pixels of image that differ from expected, NaN being equal
+ * to NaN */
+unsigned int
+CompareImageMathTestValues( const char * name, unsigned int numberOfSteps,
+  const ImageMathTestImageType * image, const std::vector< float > & expected )
+{
+  const float * values = image->GetBufferPointer();
+  unsigned int numberOfErrors = 0;
+  for( unsigned int i = 0; i < expected.size(); ++i )
+    {
+    if( std::memcmp( &values[i], &expected[i], sizeof( float ) ) != 0
+      && !( std::isnan( values[i] ) && std::isnan( expected[i] ) ) )
+      {
+      if( numberOfErrors++ < 10 )
+        {
+        std::cerr << name << " after " << numberOfSteps << " steps differs"
+          << " at pixel " << i << ": " << values[i] << " != "
+          << expected[i] << std::endl;
+        }
+      }
+    }
+  return numberOfErrors;
+}
+
+/** Compares the scalar loops of ImageMathFilters, its threaded,
+ * vectorized kernels, and its deferred evaluation to a pixel by pixel
+ * reference after every operation of a pipeline.  Deferred operations
+ * are evaluated together, for every prefix of the pipeline.  The time
+ * taken by each mode for the whole pipeline is reported, so with a larger
+ * image size ( first argument ) and repeat count ( second argument ) this
+ * test doubles as a micro-benchmark of the point-wise operations. */
+int tubeImageMathFiltersTest( int argc, char * argv[] )
+{
+  unsigned int size = 32;
+  unsigned int repeats = 1;
+  if( argc > 1 )
+    {
+    size = std::atoi( argv[1] );
+    }
+  if( argc > 2 )
+    {
+    repeats = std::atoi( argv[2] );
+    }
+
+  ImageMathTestImageType::Pointer input =
+    CreateImageMathTestImage( size, 1, false );
+  ImageMathTestImageType::Pointer operand =
+    CreateImageMathTestImage( size, 2, false );
+  ImageMathTestImageType::Pointer mask =
+    CreateImageMathTestImage( size, 3, true );
+
+  const itk::SizeValueType numberOfPixels =
+    input->GetBufferedRegion().GetNumberOfPixels();
+  std::vector< std::vector< float > > expected( ImageMathTestNumberOfSteps
+    + 1 );
+  expected[0].assign( input->GetBufferPointer(), input->GetBufferPointer()
+    + numberOfPixels );
+  for( unsigned int step = 0; step < ImageMathTestNumberOfSteps; ++step )
+    {
+    expected[step + 1] = expected[step];
+    ReferenceImageMathTestStep( expected[step + 1], step, operand, mask );
+    }
+
+  int returnStatus = EXIT_SUCCESS;
+  const char * names[3] = { "Scalar", "Threaded", "Deferred" };
+
+  // Scalar and threaded operations, checked after each one
+  for( unsigned int mode = 0; mode < 2; ++mode )
+    {
+    tube::ImageMathFilters< 3 > filters;
+    filters.SetInput( input );
+    filters.SetUseThreadedPointwiseKernels( mode > 0 );
+    for( unsigned int step = 0; step < ImageMathTestNumberOfSteps; ++step )
+      {
+      RunImageMathTestStep( filters, step, operand, mask );
+      if( CompareImageMathTestValues( names[mode], step + 1,
+        filters.GetOutput(), expected[step + 1] ) > 0 )
+        {
+        returnStatus = EXIT_FAILURE;
+        }
+      }
+    }
+
+  // Deferred operations, evaluated together for each prefix
+  for( unsigned int numberOfSteps = 1;
+    numberOfSteps <= ImageMathTestNumberOfSteps; ++numberOfSteps )
+    {
+    tube::ImageMathFilters< 3 > filters;
+    filters.SetInput( input );
+    filters.SetDeferPointwiseOperations( true );
+    for( unsigned int step = 0; step < numberOfSteps; ++step )
+      {
+      RunImageMathTestStep( filters, step, operand, mask );
+      }
+    if( filters.GetNumberOfDeferredOperations() != numberOfSteps )
+      {
+      std::cerr << "Deferred " << filters.GetNumberOfDeferredOperations()
+        << " operations instead of " << numberOfSteps << std::endl;
+      returnStatus = EXIT_FAILURE;
+      }
+    if( CompareImageMathTestValues( names[2], numberOfSteps,
+      filters.GetOutput(), expected[numberOfSteps] ) > 0 )
+      {
+      returnStatus = EXIT_FAILURE;
+      }
+    }
+
+  for( unsigned int mode = 0; mode < 3; ++mode )
+    {
+    itk::TimeProbe probe;
+    for( unsigned int r = 0; r < repeats; ++r )
+      {
+      tube::ImageMathFilters< 3 > filters;
+      filters.SetInput( input );
+      filters.SetUseThreadedPointwiseKernels( mode > 0 );
+      filters.SetDeferPointwiseOperations( mode == 2 );
+      probe.Start();
+      for( unsigned int step = 0; step < ImageMathTestNumberOfSteps; ++step )
+        {
+        RunImageMathTestStep( filters, step, operand, mask );
+        }
+      filters.GetOutput();
+      probe.Stop();
+      }
+    std::cout << names[mode] << ": " << probe.GetMean() << " "
+      << probe.GetUnit() << std::endl;
+    }
+
+  return returnStatus;
+}
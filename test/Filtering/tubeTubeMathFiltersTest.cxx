@@ -21,6 +21,7 @@ limitations under the License.
 =========================================================================*/
 
 #include "itkTubeSpatialObject.h"
+#include "itkImageRegionIteratorWithIndex.h"
 #include "itkMersenneTwisterRandomVariateGenerator.h"
 
 #include "tubeMacro.h"
@@ -57,6 +58,69 @@ double tubeLength( itk::TubeSpatialObject<3> * tube )
 }
 
 
+// Root tube along x, six children along y, and one grandchild per child
+//   along x.  Each child and grandchild starts 3 units from its parent.
+itk::GroupSpatialObject<3>::Pointer buildTubeTree( void )
+{
+  typedef itk::TubeSpatialObject<3>   TubeType;
+  typedef itk::GroupSpatialObject<3>  GroupType;
+
+  GroupType::Pointer group = GroupType::New();
+
+  TubeType::TubePointType tubePoint;
+  TubeType::TubePointType::PointType pnt;
+  TubeType::TubePointListType pointList;
+
+  TubeType::Pointer root = TubeType::New();
+  root->SetId( 0 );
+  root->SetRoot( true );
+  for( unsigned int i = 0; i < 40; ++i )
+    {
+    pnt[0] = 5 + i;
+    pnt[1] = 10;
+    pnt[2] = 10;
+    tubePoint.SetPositionInObjectSpace( pnt );
+    pointList.push_back( tubePoint );
+    }
+  root->SetPoints( pointList );
+  group->AddChild( root );
+
+  for( unsigned int k = 0; k < 6; ++k )
+    {
+    TubeType::Pointer child = TubeType::New();
+    child->SetId( 1 + 2 * k );
+    pointList.clear();
+    for( unsigned int i = 0; i < 15; ++i )
+      {
+      pnt[0] = 8 + 6 * k;
+      pnt[1] = 13 + i;
+      pnt[2] = 10;
+      tubePoint.SetPositionInObjectSpace( pnt );
+      pointList.push_back( tubePoint );
+      }
+    child->SetPoints( pointList );
+    root->AddChild( child );
+
+    TubeType::Pointer grandchild = TubeType::New();
+    grandchild->SetId( 2 + 2 * k );
+    pointList.clear();
+    for( unsigned int i = 0; i < 5; ++i )
+      {
+      pnt[0] = 11 + 6 * k + i;
+      pnt[1] = 27;
+      pnt[2] = 10;
+      tubePoint.SetPositionInObjectSpace( pnt );
+      pointList.push_back( tubePoint );
+      }
+    grandchild->SetPoints( pointList );
+    child->AddChild( grandchild );
+    }
+  group->Update();
+
+  return group;
+}
+
+
 int tubeTubeMathFiltersTest( int tubeNotUsed( argc ),
   char * tubeNotUsed( argv )[] )
 {
@@ -185,5 +249,168 @@ int tubeTubeMathFiltersTest( int tubeNotUsed( argc ),
     tNumPoints = t3NumPoints;
     }
 
+  std::cout << std::endl << "*********** Group Tests *************"
+    << std::endl;
+  typedef itk::GroupSpatialObject<3> GroupType;
+  GroupType::Pointer group[2];
+  for( unsigned int g = 0; g < 2; ++g )
+    {
+    group[g] = GroupType::New();
+    for( unsigned int t = 0; t < 50; ++t )
+      {
+      TubeType::Pointer groupTube = tube0->Clone();
+      groupTube->SetId( t );
+      group[g]->AddChild( groupTube );
+      }
+    }
+
+  // Serial and concurrent processing of a group must agree exactly
+  for( unsigned int g = 0; g < 2; ++g )
+    {
+    ::tube::TubeMathFilters<3> groupFilter;
+    groupFilter.SetNumberOfWorkUnits( g == 0 ? 1 : 4 );
+    groupFilter.SetInputTubeGroup( group[g] );
+    groupFilter.SmoothTube( 4,
+      ::tube::TubeMathFilters<3>::SMOOTH_TUBE_USING_INDEX_GAUSSIAN );
+    groupFilter.SubsampleTube( 2 );
+    }
+
+  GroupType::ChildrenListType * groupTubes[2];
+  for( unsigned int g = 0; g < 2; ++g )
+    {
+    groupTubes[g] = group[g]->GetChildren( 0, "Tube" );
+    }
+  GroupType::ChildrenListType::iterator it0 = groupTubes[0]->begin();
+  GroupType::ChildrenListType::iterator it1 = groupTubes[1]->begin();
+  while( it0 != groupTubes[0]->end() )
+    {
+    TubeType * tube0Ptr = dynamic_cast< TubeType * >( it0->GetPointer() );
+    TubeType * tube1Ptr = dynamic_cast< TubeType * >( it1->GetPointer() );
+    if( tube0Ptr->GetId() != tube1Ptr->GetId()
+      || tube0Ptr->GetNumberOfPoints() != tube1Ptr->GetNumberOfPoints()
+      || tubeLength( tube0Ptr ) != tubeLength( tube1Ptr ) )
+      {
+      std::cerr << "ERROR: Serial and concurrent results differ for tube "
+        << tube0Ptr->GetId() << std::endl;
+      returnStatus = EXIT_FAILURE;
+      }
+    ++it0;
+    ++it1;
+    }
+  for( unsigned int g = 0; g < 2; ++g )
+    {
+    delete groupTubes[g];
+    }
+
+  std::cout << std::endl << "*********** Tube Tree Tests *************"
+    << std::endl;
+  typedef ::tube::TubeMathFilters<3>::ImageType ImageType;
+  ImageType::Pointer image = ImageType::New();
+  ImageType::RegionType region;
+  ImageType::SizeType size;
+  size.Fill( 64 );
+  region.SetSize( size );
+  image->SetRegions( region );
+  image->Allocate();
+  itk::ImageRegionIteratorWithIndex< ImageType > imageIt( image, region );
+  while( !imageIt.IsAtEnd() )
+    {
+    const ImageType::IndexType & indx = imageIt.GetIndex();
+    imageIt.Set( indx[0] + 64 * indx[1] + 4096 * indx[2] );
+    ++imageIt;
+    }
+
+  // Gap filling runs in waves ( grandchildren after their parents ), and
+  //   sampling reads the image concurrently; serial and concurrent
+  //   processing of the tree must agree exactly
+  GroupType::Pointer tree[2];
+  for( unsigned int g = 0; g < 2; ++g )
+    {
+    tree[g] = buildTubeTree();
+    ::tube::TubeMathFilters<3> treeFilter;
+    treeFilter.SetNumberOfWorkUnits( g == 0 ? 1 : 4 );
+    treeFilter.SetInputTubeGroup( tree[g] );
+    treeFilter.FillGapToParent( 0.5 );
+    treeFilter.SetPointValuesFromImage( image, "Ridgeness" );
+    treeFilter.SetPointValuesFromImage( image, "Intensity" );
+    treeFilter.SetPointValuesFromImage( image, "Intensity", 0.5 );
+    treeFilter.SetPointValuesFromImageMean( image, "Medialness" );
+    }
+
+  GroupType::ChildrenListType * treeTubes[2];
+  for( unsigned int g = 0; g < 2; ++g )
+    {
+    treeTubes[g] = tree[g]->GetChildren( tree[g]->GetMaximumDepth(),
+      "Tube" );
+    }
+  if( treeTubes[0]->size() != 13 || treeTubes[1]->size() != 13 )
+    {
+    std::cerr << "ERROR: Tube tree has " << treeTubes[0]->size()
+      << " and " << treeTubes[1]->size() << " tubes, expected 13"
+      << std::endl;
+    returnStatus = EXIT_FAILURE;
+    }
+  it0 = treeTubes[0]->begin();
+  it1 = treeTubes[1]->begin();
+  while( it0 != treeTubes[0]->end() && it1 != treeTubes[1]->end() )
+    {
+    TubeType * tube0Ptr = dynamic_cast< TubeType * >( it0->GetPointer() );
+    TubeType * tube1Ptr = dynamic_cast< TubeType * >( it1->GetPointer() );
+    const unsigned int expectedPoints = ( tube0Ptr->GetId() == 0 ) ? 40
+      : ( ( tube0Ptr->GetId() % 2 == 1 ) ? 15 : 5 );
+    if( tube0Ptr->GetNumberOfPoints() <= expectedPoints
+      && tube0Ptr->GetId() != 0 )
+      {
+      std::cerr << "ERROR: Gap to parent not filled for tube "
+        << tube0Ptr->GetId() << std::endl;
+      returnStatus = EXIT_FAILURE;
+      }
+    if( tube0Ptr->GetId() != tube1Ptr->GetId()
+      || tube0Ptr->GetNumberOfPoints() != tube1Ptr->GetNumberOfPoints() )
+      {
+      std::cerr << "ERROR: Serial and concurrent trees differ for tube "
+        << tube0Ptr->GetId() << std::endl;
+      returnStatus = EXIT_FAILURE;
+      ++it0;
+      ++it1;
+      continue;
+      }
+    for( unsigned int i = 0; i < tube0Ptr->GetNumberOfPoints(); ++i )
+      {
+      const TubeType::TubePointType * p0 = tube0Ptr->GetPoint( i );
+      const TubeType::TubePointType * p1 = tube1Ptr->GetPoint( i );
+      if( p0->GetPositionInObjectSpace() != p1->GetPositionInObjectSpace()
+        || p0->GetRidgeness() != p1->GetRidgeness()
+        || p0->GetMedialness() != p1->GetMedialness()
+        || p0->GetTagScalarValue( "Intensity" )
+          != p1->GetTagScalarValue( "Intensity" ) )
+        {
+        std::cerr << "ERROR: Serial and concurrent point " << i
+          << " of tube " << tube0Ptr->GetId() << " differ" << std::endl;
+        returnStatus = EXIT_FAILURE;
+        break;
+        }
+      // Points lie within the image, so the value is that of the voxel
+      ImageType::IndexType indx;
+      image->TransformPhysicalPointToIndex(
+        p0->GetPositionInWorldSpace(), indx );
+      if( p0->GetRidgeness() != image->GetPixel( indx )
+        || p0->GetTagScalarValue( "Intensity" ) != image->GetPixel( indx ) )
+        {
+        std::cerr << "ERROR: Point " << i << " of tube "
+          << tube0Ptr->GetId() << " has value " << p0->GetRidgeness()
+          << " != " << image->GetPixel( indx ) << std::endl;
+        returnStatus = EXIT_FAILURE;
+        break;
+        }
+      }
+    ++it0;
+    ++it1;
+    }
+  for( unsigned int g = 0; g < 2; ++g )
+    {
+    delete treeTubes[g];
+    }
+
   return returnStatus;
 }
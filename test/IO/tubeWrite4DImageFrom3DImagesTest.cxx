@@ -0,0 +1,268 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright 2010 Kitware Inc. 28 Corporate Drive,
+Clifton Park, NY, 12065, USA.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#include "tubeWrite4DImageFrom3DImages.h"
+
+#include <itkImageFileReader.h>
+#include <itkImageRegionConstIteratorWithIndex.h>
+#include <itkImageRegionIteratorWithIndex.h>
+#include <itkVector.h>
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+typedef itk::Image< float, 3 >    Image3DType;
+typedef itk::Image< float, 4 >    Image4DType;
+
+Image3DType::Pointer
+createFrame( unsigned int frame )
+{
+  Image3DType::SizeType size;
+  size[0] = 5;
+  size[1] = 4;
+  size[2] = 3;
+  Image3DType::SpacingType spacing;
+  spacing[0] = 0.5;
+  spacing[1] = 1.25;
+  spacing[2] = 2;
+  Image3DType::PointType origin;
+  origin[0] = -3.5;
+  origin[1] = 10;
+  origin[2] = 2.25;
+  Image3DType::DirectionType direction;
+  direction.Fill( 0 );
+  direction( 0, 1 ) = 1;
+  direction( 1, 0 ) = -1;
+  direction( 2, 2 ) = 1;
+
+  Image3DType::Pointer img = Image3DType::New();
+  img->SetRegions( size );
+  img->SetSpacing( spacing );
+  img->SetOrigin( origin );
+  img->SetDirection( direction );
+  img->Allocate();
+
+  itk::ImageRegionIteratorWithIndex< Image3DType > iter( img,
+    img->GetLargestPossibleRegion() );
+  while( !iter.IsAtEnd() )
+    {
+    const Image3DType::IndexType & idx = iter.GetIndex();
+    iter.Set( 1 + frame * 100 + idx[0] + idx[1] * 7 + idx[2] * 31 );
+    ++iter;
+    }
+  return img;
+}
+
+bool
+write( const std::string & fileName, bool streamFrames,
+  const std::vector< Image3DType::Pointer > & frames )
+{
+  typedef tube::Write4DImageFrom3DImages< Image3DType > WriterType;
+  WriterType::Pointer writer = WriterType::New();
+  writer->SetNumberOfInputImages( frames.size() );
+  writer->SetFileName( fileName );
+  writer->SetStreamFrames( streamFrames );
+  try
+    {
+    for( unsigned int i = 0; i < frames.size(); ++i )
+      {
+      if( frames[i].IsNotNull() )
+        {
+        writer->SetNthInputImage( i, frames[i] );
+        }
+      }
+    writer->Write();
+    }
+  catch( itk::ExceptionObject & err )
+    {
+    std::cerr << "Error writing " << fileName << ": " << err << std::endl;
+    return false;
+    }
+  return true;
+}
+
+bool
+check( const std::string & fileName,
+  const std::vector< Image3DType::Pointer > & frames )
+{
+  typedef itk::ImageFileReader< Image4DType > ReaderType;
+  ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName( fileName );
+  try
+    {
+    reader->Update();
+    }
+  catch( itk::ExceptionObject & err )
+    {
+    std::cerr << "Error reading " << fileName << ": " << err << std::endl;
+    return false;
+    }
+  Image4DType::Pointer img = reader->GetOutput();
+
+  const Image3DType * ref = frames[0];
+  const Image4DType::RegionType & region = img->GetLargestPossibleRegion();
+  bool passed = true;
+  for( unsigned int i = 0; i < 4; ++i )
+    {
+    const unsigned int expectedSize = ( i < 3 )
+      ? ref->GetLargestPossibleRegion().GetSize()[i] : frames.size();
+    if( region.GetSize()[i] != expectedSize || region.GetIndex()[i] != 0 )
+      {
+      std::cerr << fileName << ": region " << region << std::endl;
+      return false;
+      }
+    const double expectedSpacing = ( i < 3 ) ? ref->GetSpacing()[i] : 1;
+    const double expectedOrigin = ( i < 3 ) ? ref->GetOrigin()[i] : 0;
+    if( std::fabs( img->GetSpacing()[i] - expectedSpacing ) > 1e-6
+      || std::fabs( img->GetOrigin()[i] - expectedOrigin ) > 1e-6 )
+      {
+      std::cerr << fileName << ": spacing " << img->GetSpacing()
+        << " origin " << img->GetOrigin() << std::endl;
+      passed = false;
+      }
+    for( unsigned int j = 0; j < 4; ++j )
+      {
+      double expectedDirection = ( i == j ) ? 1 : 0;
+      if( i < 3 && j < 3 )
+        {
+        expectedDirection = ref->GetDirection()( i, j );
+        }
+      if( std::fabs( img->GetDirection()( i, j ) - expectedDirection )
+        > 1e-6 )
+        {
+        std::cerr << fileName << ": direction " << std::endl
+          << img->GetDirection() << std::endl;
+        passed = false;
+        }
+      }
+    }
+
+  // Frames that were not set must be written as zeros
+  itk::ImageRegionConstIteratorWithIndex< Image4DType > iter( img, region );
+  unsigned int numErrors = 0;
+  while( !iter.IsAtEnd() )
+    {
+    const Image4DType::IndexType & idx = iter.GetIndex();
+    Image3DType::IndexType frameIdx;
+    for( unsigned int i = 0; i < 3; ++i )
+      {
+      frameIdx[i] = idx[i];
+      }
+    const float expected = frames[idx[3]].IsNotNull()
+      ? frames[idx[3]]->GetPixel( frameIdx ) : 0;
+    if( iter.Get() != expected )
+      {
+      if( numErrors < 10 )
+        {
+        std::cerr << fileName << ": pixel " << idx << " is " << iter.Get()
+          << " instead of " << expected << std::endl;
+        }
+      ++numErrors;
+      }
+    ++iter;
+    }
+  if( numErrors > 0 )
+    {
+    passed = false;
+    }
+
+  return passed;
+}
+
+} // End namespace
+
+int tubeWrite4DImageFrom3DImagesTest( int argc, char * argv[] )
+{
+  if( argc != 4 )
+    {
+    std::cerr << "Missing arguments." << std::endl;
+    std::cerr << "Usage: " << std::endl;
+    std::cerr << argv[0] << " inMemory.mha streamed.mha streamed.mhd"
+      << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Frame 1 is not set
+  std::vector< Image3DType::Pointer > frames( 3 );
+  frames[0] = createFrame( 0 );
+  frames[2] = createFrame( 2 );
+
+  bool passed = true;
+  for( int i = 1; i < argc; ++i )
+    {
+    const bool streamFrames = ( i > 1 );
+    std::cout << "Writing " << argv[i] << ( streamFrames ? " streamed"
+      : " in memory" ) << std::endl;
+    if( !write( argv[i], streamFrames, frames )
+      || !check( argv[i], frames ) )
+      {
+      passed = false;
+      }
+    }
+
+  // Frames of vectors have no MetaImage element type to stream as
+  typedef itk::Image< itk::Vector< float, 2 >, 3 > VectorImage3DType;
+  VectorImage3DType::Pointer vectorFrame = VectorImage3DType::New();
+  vectorFrame->SetRegions( frames[0]->GetLargestPossibleRegion() );
+  vectorFrame->Allocate( true );
+  typedef tube::Write4DImageFrom3DImages< VectorImage3DType >
+    VectorWriterType;
+  VectorWriterType::Pointer vectorWriter = VectorWriterType::New();
+  vectorWriter->SetNumberOfInputImages( 1 );
+  vectorWriter->SetFileName( argv[2] );
+  vectorWriter->SetStreamFrames( true );
+  bool thrown = false;
+  try
+    {
+    vectorWriter->SetNthInputImage( 0, vectorFrame );
+    }
+  catch( itk::ExceptionObject & err )
+    {
+    std::cout << "Expected error: " << err.GetDescription() << std::endl;
+    thrown = true;
+    }
+  if( !thrown )
+    {
+    std::cerr << "Streaming frames of vectors did not throw." << std::endl;
+    passed = false;
+    }
+  else if( !check( argv[2], frames ) )
+    {
+    std::cerr << "Rejected frames of vectors overwrote " << argv[2]
+      << std::endl;
+    passed = false;
+    }
+
+  if( !passed )
+    {
+    std::cerr << "Test failed." << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  std::cout << "Test passed." << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,139 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright Kitware Inc.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+
+#include "itktubeComputeImageSimilarityMetrics.h"
+
+#include <itkImageRegionIteratorWithIndex.h>
+
+#include <cmath>
+
+int itktubeComputeImageSimilarityMetricsTest( int itkNotUsed( argc ),
+  char * itkNotUsed( argv )[] )
+{
+  typedef itk::Image< float, 2 >                                 ImageType;
+  typedef itk::tube::ComputeImageSimilarityMetrics< ImageType >  MetricsType;
+
+  int returnStatus = EXIT_SUCCESS;
+
+  // Fixed intensity = x + y, its negation, a copy on a shifted grid, and
+  //   an unrelated checkerboard
+  ImageType::RegionType region;
+  region.SetIndex( 0, 0 );
+  region.SetIndex( 1, 0 );
+  region.SetSize( 0, 64 );
+  region.SetSize( 1, 64 );
+  ImageType::Pointer fixed = ImageType::New();
+  ImageType::Pointer negated = ImageType::New();
+  ImageType::Pointer shifted = ImageType::New();
+  ImageType::Pointer checker = ImageType::New();
+  ImageType::Pointer images[4] = { fixed, negated, shifted, checker };
+  for( unsigned int i = 0; i < 4; ++i )
+    {
+    images[i]->SetRegions( region );
+    images[i]->Allocate();
+    }
+  ImageType::PointType origin;
+  origin[0] = -4;
+  origin[1] = -4;
+  shifted->SetOrigin( origin );
+
+  itk::ImageRegionIteratorWithIndex< ImageType > it( fixed, region );
+  while( !it.IsAtEnd() )
+    {
+    ImageType::IndexType indx = it.GetIndex();
+    it.Set( indx[0] + indx[1] );
+    negated->SetPixel( indx, -( indx[0] + indx[1] ) );
+    shifted->SetPixel( indx, indx[0] + indx[1] - 8 );
+    checker->SetPixel( indx, ( ( indx[0] / 2 + indx[1] / 2 ) % 2 ) * 100 );
+    ++it;
+    }
+
+  MetricsType::Pointer metrics = MetricsType::New();
+  metrics->SetInput1( fixed );
+  metrics->SetInput2( fixed );
+  metrics->AddMovingImage( negated );
+  metrics->AddMovingImage( shifted );
+  metrics->AddMovingImage( checker );
+  metrics->SetSamplingRate( 0.25 );
+
+  // Correlation, for all moving images in one pass
+  metrics->SetUseCorrelation( true );
+  metrics->Update();
+  std::vector< double > outputs = metrics->GetOutputs();
+  if( outputs.size() != 3 )
+    {
+    std::cerr << "Number of outputs = " << outputs.size() << " != 3"
+      << std::endl;
+    return EXIT_FAILURE;
+    }
+  if( std::fabs( metrics->GetOutput() - 1 ) > 1e-6
+    || std::fabs( outputs[0] + 1 ) > 1e-6
+    || std::fabs( outputs[1] - 1 ) > 1e-6
+    || std::fabs( outputs[2] ) > 0.2 )
+    {
+    std::cerr << "Correlations = " << metrics->GetOutput() << ", "
+      << outputs[0] << ", " << outputs[1] << ", " << outputs[2]
+      << " != 1, -1, 1, 0" << std::endl;
+    returnStatus = EXIT_FAILURE;
+    }
+
+  // Mutual information is high for images that determine each other
+  metrics->SetUseCorrelation( false );
+  metrics->Update();
+  outputs = metrics->GetOutputs();
+  if( outputs[0] < 0.5 * metrics->GetOutput()
+    || outputs[1] < 0.5 * metrics->GetOutput()
+    || outputs[2] > 0.5 * metrics->GetOutput() )
+    {
+    std::cerr << "Mutual information = " << metrics->GetOutput() << ", "
+      << outputs[0] << ", " << outputs[1] << ", " << outputs[2]
+      << std::endl;
+    returnStatus = EXIT_FAILURE;
+    }
+
+  // Without input image 2, only the moving images are scored
+  metrics->SetInput2( nullptr );
+  metrics->Update();
+  if( metrics->GetOutput() != 0 || metrics->GetOutputs() != outputs )
+    {
+    std::cerr << "Without input image 2, output = " << metrics->GetOutput()
+      << " != 0" << std::endl;
+    returnStatus = EXIT_FAILURE;
+    }
+
+  // Samples do not depend on the number of threads
+  itk::MultiThreaderBase::SetGlobalDefaultNumberOfThreads( 1 );
+  MetricsType::Pointer serialMetrics = MetricsType::New();
+  serialMetrics->SetInput1( fixed );
+  serialMetrics->SetInput2( checker );
+  serialMetrics->SetSamplingRate( 0.25 );
+  serialMetrics->Update();
+  if( serialMetrics->GetOutput() != outputs[2] )
+    {
+    std::cerr << "Single threaded mutual information = "
+      << serialMetrics->GetOutput() << " != " << outputs[2] << std::endl;
+    returnStatus = EXIT_FAILURE;
+    }
+
+  return returnStatus;
+}
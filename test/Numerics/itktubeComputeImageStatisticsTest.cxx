@@ -0,0 +1,265 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright Kitware Inc.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#include "itktubeComputeImageStatistics.h"
+
+#include <itkImageRegionIteratorWithIndex.h>
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+
+namespace
+{
+
+typedef itk::tube::ComputeImageStatistics< int, 2 >  StatisticsType;
+typedef StatisticsType::VolumeType                   VolumeType;
+typedef StatisticsType::MaskType                     MaskType;
+
+// Compare the statistics of each component with those of the sorted values
+//   of its label; quantiles are the values of rank floor( q * count )
+bool checkStatistics( StatisticsType * stats, const std::vector< int > &
+  expectedLabels, const std::map< int, std::vector< double > > & values,
+  const std::vector< float > & quantiles )
+{
+  bool passed = true;
+  if( stats->GetNumberOfComponents() != expectedLabels.size() )
+    {
+    std::cerr << "Number of components = "
+      << stats->GetNumberOfComponents() << " != " << expectedLabels.size()
+      << std::endl;
+    return false;
+    }
+  for( unsigned int id = 0; id < expectedLabels.size(); ++id )
+    {
+    const int label = expectedLabels[id];
+    if( stats->GetCompValue()[id] != label )
+      {
+      std::cerr << "Component " << id << " value = "
+        << stats->GetCompValue()[id] << " != " << label << std::endl;
+      passed = false;
+      continue;
+      }
+
+    std::vector< double > sorted;
+    std::map< int, std::vector< double > >::const_iterator valuesIter =
+      values.find( label );
+    if( valuesIter != values.end() )
+      {
+      sorted = valuesIter->second;
+      }
+    std::sort( sorted.begin(), sorted.end() );
+    const unsigned int count = sorted.size();
+
+    double mean = 0;
+    double stdDev = 0;
+    double minV = 0;
+    double maxV = 0;
+    std::vector< double > quantileV( quantiles.size(), 0 );
+    if( count > 0 )
+      {
+      for( unsigned int i = 0; i < count; ++i )
+        {
+        mean += sorted[i];
+        }
+      mean /= count;
+      if( count > 1 )
+        {
+        for( unsigned int i = 0; i < count; ++i )
+          {
+          stdDev += ( sorted[i] - mean ) * ( sorted[i] - mean );
+          }
+        stdDev = std::sqrt( stdDev / ( count - 1 ) );
+        }
+      minV = sorted.front();
+      maxV = sorted.back();
+      for( unsigned int q = 0; q < quantiles.size(); ++q )
+        {
+        unsigned int rank = static_cast< unsigned int >(
+          std::floor( quantiles[q] * count ) );
+        quantileV[q] = sorted[ std::min( rank, count - 1 ) ];
+        }
+      }
+
+    if( stats->GetCompCount()[id] != count
+      || std::fabs( stats->GetCompMean()[id] - mean ) > 1e-6
+      || std::fabs( stats->GetCompStdDev()[id] - stdDev ) > 1e-6
+      || stats->GetCompMin()[id] != minV
+      || stats->GetCompMax()[id] != maxV )
+      {
+      std::cerr << "Label " << label << ": count, mean, stddev, min, max = "
+        << stats->GetCompCount()[id] << ", " << stats->GetCompMean()[id]
+        << ", " << stats->GetCompStdDev()[id] << ", "
+        << stats->GetCompMin()[id] << ", " << stats->GetCompMax()[id]
+        << " != " << count << ", " << mean << ", " << stdDev << ", "
+        << minV << ", " << maxV << std::endl;
+      passed = false;
+      }
+    for( unsigned int q = 0; q < quantiles.size(); ++q )
+      {
+      if( stats->GetQuantileValue()[id][q] != quantileV[q] )
+        {
+        std::cerr << "Label " << label << ": quantile " << quantiles[q]
+          << " = " << stats->GetQuantileValue()[id][q] << " != "
+          << quantileV[q] << std::endl;
+        passed = false;
+        }
+      }
+    }
+
+  // Each voxel of a component is set to its mean, the others to zero
+  const VolumeType * output = stats->GetOutput();
+  itk::ImageRegionConstIteratorWithIndex< MaskType > maskIter(
+    stats->GetInputMask(), stats->GetInputMask()->GetLargestPossibleRegion() );
+  while( !maskIter.IsAtEnd() )
+    {
+    double expected = 0;
+    for( unsigned int id = 0; id < expectedLabels.size(); ++id )
+      {
+      if( expectedLabels[id] == maskIter.Get() )
+        {
+        expected = stats->GetCompMean()[id];
+        }
+      }
+    if( std::fabs( output->GetPixel( maskIter.GetIndex() ) - expected )
+      > 1e-4 )
+      {
+      std::cerr << "Output at " << maskIter.GetIndex() << " = "
+        << output->GetPixel( maskIter.GetIndex() ) << " != " << expected
+        << std::endl;
+      passed = false;
+      break;
+      }
+    ++maskIter;
+    }
+
+  return passed;
+}
+
+} // End namespace
+
+int itktubeComputeImageStatisticsTest( int itkNotUsed( argc ),
+  char * itkNotUsed( argv )[] )
+{
+  int returnStatus = EXIT_SUCCESS;
+
+  // Rows 0-1 are label 5, rows 2-4 label 2, rows 5-6 a constant label 7,
+  //   row 7 label 0 but for a single voxel of label 9.  Values of labels
+  //   5 and 2 repeat so that quantiles fall on ties.
+  MaskType::RegionType region;
+  region.SetIndex( 0, 0 );
+  region.SetIndex( 1, 0 );
+  region.SetSize( 0, 8 );
+  region.SetSize( 1, 8 );
+  VolumeType::Pointer volume = VolumeType::New();
+  volume->SetRegions( region );
+  volume->Allocate();
+  MaskType::Pointer mask = MaskType::New();
+  mask->SetRegions( region );
+  mask->Allocate();
+
+  std::map< int, std::vector< double > > values;
+  itk::ImageRegionIteratorWithIndex< VolumeType > it( volume, region );
+  while( !it.IsAtEnd() )
+    {
+    const VolumeType::IndexType indx = it.GetIndex();
+    int label = 0;
+    float value = indx[0] + 8 * indx[1];
+    if( indx[1] < 2 )
+      {
+      label = 5;
+      value = ( indx[0] * 3 ) % 5 - 2.5 * indx[1];
+      }
+    else if( indx[1] < 5 )
+      {
+      label = 2;
+      value = ( indx[0] + indx[1] ) % 4 * 10;
+      }
+    else if( indx[1] < 7 )
+      {
+      label = 7;
+      value = 4.5;
+      }
+    else if( indx[0] == 7 )
+      {
+      label = 9;
+      value = -1.25;
+      }
+    it.Set( value );
+    mask->SetPixel( indx, label );
+    values[label].push_back( value );
+    ++it;
+    }
+
+  std::vector< float > quantiles;
+  quantiles.push_back( 0 );
+  quantiles.push_back( 0.25 );
+  quantiles.push_back( 0.5 );
+  quantiles.push_back( 0.9 );
+  quantiles.push_back( 1 );
+
+  // Every label, in order of first appearance, with histograms that are
+  //   finer and coarser than the spread of the values
+  std::vector< int > allLabels;
+  allLabels.push_back( 5 );
+  allLabels.push_back( 2 );
+  allLabels.push_back( 7 );
+  allLabels.push_back( 0 );
+  allLabels.push_back( 9 );
+  const unsigned int numBins[2] = { 2000, 3 };
+  for( unsigned int i = 0; i < 2; ++i )
+    {
+    StatisticsType::Pointer stats = StatisticsType::New();
+    stats->SetInput( volume );
+    stats->SetInputMask( mask );
+    stats->SetQuantiles( quantiles );
+    stats->SetNumberOfHistogramBins( numBins[i] );
+    stats->Update();
+    if( !checkStatistics( stats, allLabels, values, quantiles ) )
+      {
+      std::cerr << "Failed for all labels with " << numBins[i] << " bins"
+        << std::endl;
+      returnStatus = EXIT_FAILURE;
+      }
+    }
+
+  // Requested labels are the components in the order given, and a label
+  //   that is absent has a count of zero and zero statistics
+  std::vector< int > labels;
+  labels.push_back( 9 );
+  labels.push_back( 3 );
+  labels.push_back( 2 );
+  labels.push_back( 7 );
+  StatisticsType::Pointer stats = StatisticsType::New();
+  stats->SetInput( volume );
+  stats->SetInputMask( mask );
+  stats->SetQuantiles( quantiles );
+  stats->SetLabels( labels );
+  stats->Update();
+  if( !checkStatistics( stats, labels, values, quantiles ) )
+    {
+    std::cerr << "Failed for the requested labels" << std::endl;
+    returnStatus = EXIT_FAILURE;
+    }
+
+  return returnStatus;
+}
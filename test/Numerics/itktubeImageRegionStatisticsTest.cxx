@@ -0,0 +1,129 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright Kitware Inc.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#include "itktubeImageRegionStatistics.h"
+#include "itktubeNJetImageFunction.h"
+
+#include <itkImageRegionIteratorWithIndex.h>
+
+int itktubeImageRegionStatisticsTest( int itkNotUsed( argc ),
+  char * itkNotUsed( argv )[] )
+{
+  typedef itk::Image< float, 3 >                         ImageType;
+  typedef itk::tube::ImageRegionStatistics< ImageType >  StatisticsType;
+
+  int returnStatus = EXIT_SUCCESS;
+
+  // Intensity = x + 10 y + 100 z
+  ImageType::RegionType region;
+  region.SetIndex( 0, 0 );
+  region.SetIndex( 1, 0 );
+  region.SetIndex( 2, 0 );
+  region.SetSize( 0, 10 );
+  region.SetSize( 1, 10 );
+  region.SetSize( 2, 10 );
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions( region );
+  image->Allocate();
+  itk::ImageRegionIteratorWithIndex< ImageType > it( image, region );
+  while( !it.IsAtEnd() )
+    {
+    ImageType::IndexType indx = it.GetIndex();
+    it.Set( indx[0] + 10 * indx[1] + 100 * indx[2] );
+    ++it;
+    }
+
+  StatisticsType::Pointer stats = StatisticsType::New();
+  stats->SetInputImage( image );
+  if( stats->GetNumberOfComputations() != 0 )
+    {
+    std::cerr << "Statistics computed before being requested" << std::endl;
+    returnStatus = EXIT_FAILURE;
+    }
+  if( stats->GetMinimum() != 0 || stats->GetMaximum() != 999 )
+    {
+    std::cerr << "Whole image range = " << stats->GetMinimum() << " : "
+      << stats->GetMaximum() << " != 0 : 999" << std::endl;
+    returnStatus = EXIT_FAILURE;
+    }
+
+  // Functions sharing the statistics do not scan the image again
+  typedef itk::tube::NJetImageFunction< ImageType > NJetFunctionType;
+  NJetFunctionType::Pointer func = NJetFunctionType::New();
+  func->SetInputImage( image );
+  func->SetImageStatistics( stats );
+  func->ComputeStatistics();
+  if( func->GetMin() != 0 || func->GetMax() != 999
+    || stats->GetNumberOfComputations() != 1 )
+    {
+    std::cerr << "Shared statistics recomputed: "
+      << stats->GetNumberOfComputations() << " computations" << std::endl;
+    returnStatus = EXIT_FAILURE;
+    }
+
+  // Restricting the region invalidates the statistics
+  ImageType::IndexType minIndx;
+  ImageType::IndexType maxIndx;
+  minIndx[0] = 2;
+  minIndx[1] = 3;
+  minIndx[2] = 4;
+  maxIndx[0] = 5;
+  maxIndx[1] = 6;
+  maxIndx[2] = 7;
+  itk::ModifiedTimeType mTime = stats->GetMTime();
+  stats->SetRegion( minIndx, maxIndx );
+  if( stats->GetMTime() == mTime )
+    {
+    std::cerr << "Changing the region did not modify the statistics"
+      << std::endl;
+    returnStatus = EXIT_FAILURE;
+    }
+  if( stats->GetMinimum() != 432 || stats->GetMaximum() != 765
+    || stats->GetNumberOfComputations() != 2 )
+    {
+    std::cerr << "Region range = " << stats->GetMinimum() << " : "
+      << stats->GetMaximum() << " != 432 : 765" << std::endl;
+    returnStatus = EXIT_FAILURE;
+    }
+
+  // Setting the same region again keeps them
+  stats->SetRegion( minIndx, maxIndx );
+  stats->GetMaximum();
+  if( stats->GetNumberOfComputations() != 2 )
+    {
+    std::cerr << "Unchanged region recomputed" << std::endl;
+    returnStatus = EXIT_FAILURE;
+    }
+
+  // Regions are cropped to the image
+  minIndx.Fill( -5 );
+  maxIndx.Fill( 1 );
+  stats->SetRegion( minIndx, maxIndx );
+  if( stats->GetMinimum() != 0 || stats->GetMaximum() != 111 )
+    {
+    std::cerr << "Cropped region range = " << stats->GetMinimum() << " : "
+      << stats->GetMaximum() << " != 0 : 111" << std::endl;
+    returnStatus = EXIT_FAILURE;
+    }
+
+  return returnStatus;
+}
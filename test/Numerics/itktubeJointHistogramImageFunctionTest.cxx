@@ -26,6 +26,8 @@ limitations under the License.
 #include <itkImageFileReader.h>
 #include <itkImageFileWriter.h>
 
+#include <cmath>
+
 int itktubeJointHistogramImageFunctionTest( int argc, char * argv[] )
 {
   if( argc < 4 )
@@ -120,11 +122,13 @@ int itktubeJointHistogramImageFunctionTest( int argc, char * argv[] )
     maskImage->GetLargestPossibleRegion() );
 
   // Precompute
+  std::vector< ImageType::IndexType > indices;
   while( !outIter.IsAtEnd() )
     {
     if( maskIter.Get() != 0 )
       {
       func->PrecomputeAtIndex( outIter.GetIndex() );
+      indices.push_back( outIter.GetIndex() );
       }
     ++maskIter;
     ++outIter;
@@ -132,6 +136,47 @@ int itktubeJointHistogramImageFunctionTest( int argc, char * argv[] )
 
   func->ComputeMeanAndStandardDeviation();
 
+  // Batched precomputation, with dense and with sparse histograms, gives
+  //   the same mean and standard deviation histograms
+  for( unsigned int sparse = 0; sparse < 2; ++sparse )
+    {
+    FunctionType::Pointer batchFunc = FunctionType::New();
+    batchFunc->SetInputImage( inputImage1 );
+    batchFunc->SetInputMask( inputImage2 );
+    batchFunc->SetForceDiagonalHistogram(
+      func->GetForceDiagonalHistogram() );
+    batchFunc->SetUseSparseHistograms( sparse != 0 );
+    batchFunc->PrecomputeAtIndices( indices );
+    batchFunc->ComputeMeanAndStandardDeviation();
+
+    const FunctionType::HistogramType * histograms[2][2] = {
+      { func->GetMeanHistogram(), batchFunc->GetMeanHistogram() },
+      { func->GetStandardDeviationHistogram(),
+        batchFunc->GetStandardDeviationHistogram() } };
+    for( unsigned int h = 0; h < 2; ++h )
+      {
+      itk::ImageRegionConstIterator< FunctionType::HistogramType > iter(
+        histograms[h][0], histograms[h][0]->GetLargestPossibleRegion() );
+      itk::ImageRegionConstIterator< FunctionType::HistogramType >
+        batchIter( histograms[h][1],
+        histograms[h][1]->GetLargestPossibleRegion() );
+      while( !iter.IsAtEnd() )
+        {
+        if( std::fabs( iter.Get() - batchIter.Get() )
+          > 0.001 * ( 1 + std::fabs( iter.Get() ) ) )
+          {
+          std::cerr << "Batched " << ( sparse ? "sparse" : "dense" )
+            << ( h == 0 ? " mean" : " standard deviation" )
+            << " histogram = " << batchIter.Get() << " != "
+            << iter.Get() << std::endl;
+          return EXIT_FAILURE;
+          }
+        ++iter;
+        ++batchIter;
+        }
+      }
+    }
+
   if( argc > 4 )
     {
     HistoWriterType::Pointer writerMean = HistoWriterType::New();
@@ -189,6 +234,20 @@ int itktubeJointHistogramImageFunctionTest( int argc, char * argv[] )
     ++outIter;
     }
 
+  // Batched evaluation gives the same Z-scores
+  std::vector< double > zScores;
+  batchFunc->EvaluateAtIndices( indices, zScores );
+  for( unsigned int i = 0; i < indices.size(); ++i )
+    {
+    const double tf = outputImage->GetPixel( indices[i] );
+    if( std::fabs( zScores[i] - tf ) > 0.001 * ( 1 + std::fabs( tf ) ) )
+      {
+      std::cerr << "Batched Z-score at " << indices[i] << " = "
+        << zScores[i] << " != " << tf << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
   WriterType::Pointer writer = WriterType::New();
   writer->SetFileName( argv[5] );
   writer->SetUseCompression( true );
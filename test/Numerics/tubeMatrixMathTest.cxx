@@ -114,6 +114,38 @@ int Test( void )
         returnStatus = EXIT_FAILURE;
         }
       }
+
+    if( VDimension == 3 )
+      {
+      double a[6] = { m1( 0, 0 ), m1( 0, 1 ), m1( 0, 2 ),
+        m1( 1, 1 ), m1( 1, 2 ), m1( 2, 2 ) };
+      double eVals3[3];
+      double eVects3[3][3];
+      tube::ComputeSymmetricEigen3x3( a, eVals3, eVects3 );
+      for( unsigned int d=0; d<3; d++ )
+        {
+        for( unsigned int r=0; r<3; r++ )
+          {
+          double mv = m1( r, 0 ) * eVects3[d][0] + m1( r, 1 ) * eVects3[d][1]
+            + m1( r, 2 ) * eVects3[d][2];
+          if( std::fabs( mv - eVals3[d] * eVects3[d][r] ) > 0.0001 )
+            {
+            std::cout << count << " : ";
+            std::cout << "FAILURE: ComputeSymmetricEigen3x3 : "
+              << " M1 * v" << d << "[" << r << "] = " << mv
+              << " != " << eVals3[d] * eVects3[d][r] << std::endl;
+            returnStatus = EXIT_FAILURE;
+            }
+          }
+        if( d > 0 && eVals3[d] < eVals3[d-1] )
+          {
+          std::cout << count << " : ";
+          std::cout << "FAILURE: ComputeSymmetricEigen3x3 : "
+            << "eigenvalues not ascending" << std::endl;
+          returnStatus = EXIT_FAILURE;
+          }
+        }
+      }
     }
 
   return returnStatus;
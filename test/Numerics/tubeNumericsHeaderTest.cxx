@@ -25,6 +25,7 @@ limitations under the License.
 #include "itktubeComputeImageSimilarityMetrics.h"
 #include "itktubeFeatureVectorGenerator.h"
 #include "itktubeImageRegionMomentsCalculator.h"
+#include "itktubeImageRegionStatistics.h"
 #include "itktubeJointHistogramImageFunction.h"
 #include "itktubeNJetFeatureVectorGenerator.h"
 #include "itktubeNJetImageFunction.h"
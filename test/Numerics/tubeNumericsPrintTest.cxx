@@ -24,6 +24,7 @@ limitations under the License.
 #include "itktubeBlurImageFunction.h"
 #include "itktubeComputeImageSimilarityMetrics.h"
 #include "itktubeImageRegionMomentsCalculator.h"
+#include "itktubeImageRegionStatistics.h"
 #include "itktubeJointHistogramImageFunction.h"
 #include "itktubeNJetFeatureVectorGenerator.h"
 #include "itktubeNJetImageFunction.h"
@@ -45,6 +46,13 @@ int tubeNumericsPrintTest( int itkNotUsed( argc ), char * itkNotUsed( argv )[] )
     << regionMomentsObject
     << std::endl;
 
+  itk::tube::ImageRegionStatistics< ImageType >::Pointer
+    regionStatisticsObject =
+    itk::tube::ImageRegionStatistics< ImageType >::New();
+  std::cout << "-------------itktubeImageRegionStatistics"
+    << regionStatisticsObject
+    << std::endl;
+
   itk::tube::JointHistogramImageFunction< ImageType >::Pointer
     jointHistoObject =
     itk::tube::JointHistogramImageFunction< ImageType >::New();
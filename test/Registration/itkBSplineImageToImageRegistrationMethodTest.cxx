@@ -0,0 +1,141 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright Kitware Inc.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+
+#include "itkBSplineImageToImageRegistrationMethod.h"
+
+#include <itkImageRegionConstIterator.h>
+#include <itkImageRegionIteratorWithIndex.h>
+#include <itkResampleImageFilter.h>
+
+#include <cmath>
+
+namespace
+{
+
+typedef itk::Image< float, 2 > BSplineTestImageType;
+
+// Gaussian blob whose width differs along each axis
+BSplineTestImageType::Pointer CreateBlobImage( double centerX,
+  double centerY, double sigmaX, double sigmaY )
+{
+  BSplineTestImageType::RegionType region;
+  region.SetIndex( 0, 0 );
+  region.SetIndex( 1, 0 );
+  region.SetSize( 0, 64 );
+  region.SetSize( 1, 64 );
+  BSplineTestImageType::Pointer image = BSplineTestImageType::New();
+  image->SetRegions( region );
+  image->Allocate();
+  itk::ImageRegionIteratorWithIndex< BSplineTestImageType > it( image,
+    region );
+  while( !it.IsAtEnd() )
+    {
+    BSplineTestImageType::IndexType indx = it.GetIndex();
+    const double dx = ( indx[0] - centerX ) / sigmaX;
+    const double dy = ( indx[1] - centerY ) / sigmaY;
+    it.Set( 100 * std::exp( -( dx * dx + dy * dy ) / 2 ) );
+    ++it;
+    }
+  return image;
+}
+
+double MeanSquaredDifference( const BSplineTestImageType * image1,
+  const BSplineTestImageType * image2 )
+{
+  itk::ImageRegionConstIterator< BSplineTestImageType > it1( image1,
+    image1->GetLargestPossibleRegion() );
+  itk::ImageRegionConstIterator< BSplineTestImageType > it2( image2,
+    image2->GetLargestPossibleRegion() );
+  double sum = 0;
+  unsigned int count = 0;
+  while( !it1.IsAtEnd() )
+    {
+    const double diff = it1.Get() - it2.Get();
+    sum += diff * diff;
+    ++count;
+    ++it1;
+    ++it2;
+    }
+  return sum / count;
+}
+
+} // End namespace
+
+int itkBSplineImageToImageRegistrationMethodTest( int itkNotUsed( argc ),
+  char * itkNotUsed( argv )[] )
+{
+  typedef itk::BSplineImageToImageRegistrationMethod< BSplineTestImageType >
+    RegistrationMethodType;
+  typedef itk::ResampleImageFilter< BSplineTestImageType,
+    BSplineTestImageType > ResampleFilterType;
+
+  int returnStatus = EXIT_SUCCESS;
+
+  BSplineTestImageType::Pointer fixed = CreateBlobImage( 32, 32, 8, 6 );
+  BSplineTestImageType::Pointer moving = CreateBlobImage( 34, 31, 10, 5 );
+
+  const double initialDifference = MeanSquaredDifference( fixed, moving );
+
+  // Image pyramid ( the default ) and grid refinement only
+  const bool usePyramidSettings[2] = { true, false };
+  for( unsigned int i = 0; i < 2; ++i )
+    {
+    const bool usePyramid = usePyramidSettings[i];
+    RegistrationMethodType::Pointer reg = RegistrationMethodType::New();
+    reg->SetFixedImage( fixed );
+    reg->SetMovingImage( moving );
+    reg->SetReportProgress( false );
+    reg->SetRandomNumberSeed( 1 );
+    reg->SetUseEvolutionaryOptimization( false );
+    reg->SetMetricMethodEnum(
+      RegistrationMethodType::MEAN_SQUARED_ERROR_METRIC );
+    reg->SetNumberOfSamples( 64 * 64 );
+    reg->SetNumberOfControlPoints( 8 );
+    reg->SetNumberOfLevels( 2 );
+    reg->SetExpectedDeformationMagnitude( 2 );
+    reg->SetMaxIterations( 50 );
+    reg->SetUseImagePyramid( usePyramid );
+    reg->Update();
+
+    ResampleFilterType::Pointer resample = ResampleFilterType::New();
+    resample->SetInput( moving );
+    resample->SetTransform( reg->GetBSplineTransform() );
+    resample->SetReferenceImage( fixed );
+    resample->SetUseReferenceImage( true );
+    resample->Update();
+
+    const double finalDifference = MeanSquaredDifference( fixed,
+      resample->GetOutput() );
+    std::cout << "UseImagePyramid = " << usePyramid
+      << " : mean squared difference " << initialDifference << " -> "
+      << finalDifference << std::endl;
+    if( !( finalDifference < 0.5 * initialDifference ) )
+      {
+      std::cerr << "Registration with UseImagePyramid = " << usePyramid
+        << " did not reduce the image difference enough" << std::endl;
+      returnStatus = EXIT_FAILURE;
+      }
+    }
+
+  return returnStatus;
+}
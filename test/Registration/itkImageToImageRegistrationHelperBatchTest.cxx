@@ -0,0 +1,144 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright Kitware Inc.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+
+#include "itkImageToImageRegistrationHelper.h"
+
+#include <itkImageRegionIteratorWithIndex.h>
+
+#include <cmath>
+
+namespace
+{
+
+typedef itk::Image< float, 2 > BatchImageType;
+
+// Gaussian blob centered at center
+BatchImageType::Pointer CreateBlobImage( double centerX, double centerY )
+{
+  BatchImageType::RegionType region;
+  region.SetIndex( 0, 0 );
+  region.SetIndex( 1, 0 );
+  region.SetSize( 0, 64 );
+  region.SetSize( 1, 64 );
+  BatchImageType::Pointer image = BatchImageType::New();
+  image->SetRegions( region );
+  image->Allocate();
+  itk::ImageRegionIteratorWithIndex< BatchImageType > it( image, region );
+  while( !it.IsAtEnd() )
+    {
+    BatchImageType::IndexType indx = it.GetIndex();
+    const double dx = indx[0] - centerX;
+    const double dy = ( indx[1] - centerY ) * 1.5;
+    it.Set( 100 * std::exp( -( dx * dx + dy * dy ) / 200 ) );
+    ++it;
+    }
+  return image;
+}
+
+} // End namespace
+
+int itkImageToImageRegistrationHelperBatchTest( int itkNotUsed( argc ),
+  char * itkNotUsed( argv )[] )
+{
+  typedef itk::ImageToImageRegistrationHelper< BatchImageType >  HelperType;
+
+  int returnStatus = EXIT_SUCCESS;
+
+  BatchImageType::Pointer fixed = CreateBlobImage( 32, 32 );
+  std::vector< BatchImageType::Pointer > moving;
+  moving.push_back( CreateBlobImage( 35, 30 ) );
+  moving.push_back( CreateBlobImage( 28, 34 ) );
+  moving.push_back( CreateBlobImage( 33, 36 ) );
+
+  HelperType::Pointer batch = HelperType::New();
+  batch->SetFixedImage( fixed );
+  batch->SetReportProgress( false );
+  batch->SetRandomNumberSeed( 1 );
+  batch->SetInitialMethodEnum( HelperType::INIT_WITH_CENTERS_OF_MASS );
+  batch->SetEnableRigidRegistration( true );
+  batch->SetEnableAffineRegistration( false );
+  batch->SetEnableBSplineRegistration( false );
+  batch->SetUseEvolutionaryOptimization( false );
+  batch->SetRigidSamplingRatio( 1.0 );
+  batch->SetRigidMaxIterations( 50 );
+  batch->SetBatchNumberOfConcurrentRegistrations( 2 );
+  for( unsigned int i = 0; i < moving.size(); ++i )
+    {
+    batch->AddBatchMovingImage( moving[i] );
+    }
+  batch->UpdateBatch();
+
+  if( batch->GetNumberOfBatchResults() != moving.size() )
+    {
+    std::cerr << "Number of batch results = "
+      << batch->GetNumberOfBatchResults() << " != " << moving.size()
+      << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Each case matches a sequential registration with the same settings
+  for( unsigned int i = 0; i < moving.size(); ++i )
+    {
+    HelperType::Pointer sequential = HelperType::New();
+    sequential->SetFixedImage( fixed );
+    sequential->SetMovingImage( moving[i] );
+    sequential->SetReportProgress( false );
+    sequential->SetRandomNumberSeed( 1 );
+    sequential->SetInitialMethodEnum( HelperType::INIT_WITH_CENTERS_OF_MASS );
+    sequential->SetEnableRigidRegistration( true );
+    sequential->SetEnableAffineRegistration( false );
+    sequential->SetEnableBSplineRegistration( false );
+    sequential->SetUseEvolutionaryOptimization( false );
+    sequential->SetRigidSamplingRatio( 1.0 );
+    sequential->SetRigidMaxIterations( 50 );
+    sequential->Update();
+
+    const HelperType::MatrixTransformType * batchTfm =
+      batch->GetBatchMatrixTransform( i );
+    const HelperType::MatrixTransformType * sequentialTfm =
+      sequential->GetCurrentMatrixTransform();
+    for( unsigned int d = 0; d < 2; ++d )
+      {
+      if( std::fabs( batchTfm->GetOffset()[d]
+        - sequentialTfm->GetOffset()[d] ) > 0.05 )
+        {
+        std::cerr << "Case " << i << ": batch offset "
+          << batchTfm->GetOffset() << " != sequential offset "
+          << sequentialTfm->GetOffset() << std::endl;
+        returnStatus = EXIT_FAILURE;
+        break;
+        }
+      }
+    if( std::fabs( batch->GetBatchMetricValue( i )
+      - sequential->GetFinalMetricValue() ) > 0.001
+      * ( 1 + std::fabs( sequential->GetFinalMetricValue() ) ) )
+      {
+      std::cerr << "Case " << i << ": batch metric "
+        << batch->GetBatchMetricValue( i ) << " != sequential metric "
+        << sequential->GetFinalMetricValue() << std::endl;
+      returnStatus = EXIT_FAILURE;
+      }
+    }
+
+  return returnStatus;
+}
@@ -0,0 +1,247 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright Kitware Inc.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+
+#include "itkImageToImageRegistrationHelper.h"
+#include "itkPopulationEvolutionaryOptimizer.h"
+
+#include <itkImageRegionIteratorWithIndex.h>
+
+#include <cmath>
+
+namespace
+{
+
+// Weighted quadratic with its minimum at ( 3, -2, 0.5 ), or its negation
+class PopulationQuadraticCostFunction
+  : public itk::SingleValuedCostFunction
+{
+public:
+  typedef PopulationQuadraticCostFunction  Self;
+  typedef itk::SingleValuedCostFunction    Superclass;
+  typedef itk::SmartPointer< Self >        Pointer;
+  typedef itk::SmartPointer< const Self >  ConstPointer;
+
+  itkNewMacro( Self );
+  itkTypeMacro( PopulationQuadraticCostFunction, SingleValuedCostFunction );
+
+  itkSetMacro( Negate, bool );
+
+  MeasureType GetValue( const ParametersType & p ) const override
+    {
+    const double center[3] = { 3, -2, 0.5 };
+    const double weight[3] = { 1, 2, 0.5 };
+    double value = 0;
+    for( unsigned int i = 0; i < 3; ++i )
+      {
+      value += weight[i] * ( p[i] - center[i] ) * ( p[i] - center[i] );
+      }
+    return m_Negate ? -value : value;
+    }
+
+  void GetDerivative( const ParametersType &,
+    DerivativeType & ) const override
+    {
+    itkExceptionMacro( << "Not implemented" );
+    }
+
+  unsigned int GetNumberOfParameters( void ) const override
+    {
+    return 3;
+    }
+
+protected:
+  PopulationQuadraticCostFunction( void ) : m_Negate( false ) {}
+  ~PopulationQuadraticCostFunction( void ) {}
+
+private:
+  bool m_Negate;
+};
+
+typedef itk::PopulationEvolutionaryOptimizer  PopulationOptimizerType;
+
+// Optimize from the origin, evaluating candidates on numberOfCandidateCost
+//   independent cost functions, or serially if zero
+PopulationOptimizerType::Pointer RunQuadraticOptimization(
+  unsigned int numberOfCandidateCost, bool maximize )
+{
+  PopulationQuadraticCostFunction::Pointer cost =
+    PopulationQuadraticCostFunction::New();
+  cost->SetNegate( maximize );
+
+  itk::Statistics::NormalVariateGenerator::Pointer generator =
+    itk::Statistics::NormalVariateGenerator::New();
+  generator->Initialize( 7 );
+
+  PopulationOptimizerType::Pointer optimizer = PopulationOptimizerType::New();
+  optimizer->SetCostFunction( cost );
+  optimizer->SetNormalVariateGenerator( generator );
+  optimizer->SetMaximize( maximize );
+  optimizer->SetPopulationSize( 10 );
+  optimizer->SetMaximumIteration( 1000 );
+  optimizer->SetInitialRadius( 1.0 );
+  optimizer->SetEpsilon( 1e-6 );
+  for( unsigned int i = 0; i < numberOfCandidateCost; ++i )
+    {
+    PopulationQuadraticCostFunction::Pointer candidateCost =
+      PopulationQuadraticCostFunction::New();
+    candidateCost->SetNegate( maximize );
+    optimizer->AddCandidateCostFunction( candidateCost );
+    }
+  PopulationOptimizerType::ParametersType initial( 3 );
+  initial.Fill( 0 );
+  optimizer->SetInitialPosition( initial );
+  optimizer->StartOptimization();
+  return optimizer;
+}
+
+bool CheckQuadraticMinimum( const char * name,
+  const PopulationOptimizerType * optimizer )
+{
+  const double center[3] = { 3, -2, 0.5 };
+  const PopulationOptimizerType::ParametersType & position =
+    optimizer->GetCurrentPosition();
+  std::cout << name << ": " << position << " after "
+    << optimizer->GetCurrentIteration() << " iterations, "
+    << optimizer->GetStopConditionDescription() << std::endl;
+  for( unsigned int i = 0; i < 3; ++i )
+    {
+    if( std::fabs( position[i] - center[i] ) > 1e-3 )
+      {
+      std::cerr << name << ": position " << position
+        << " is not the optimum ( 3, -2, 0.5 )" << std::endl;
+      return false;
+      }
+    }
+  if( optimizer->GetCurrentIteration() >= 1000 )
+    {
+    std::cerr << name << ": step size did not converge" << std::endl;
+    return false;
+    }
+  return true;
+}
+
+typedef itk::Image< float, 2 > PopulationImageType;
+
+// Anisotropic Gaussian blob centered at center
+PopulationImageType::Pointer CreatePopulationBlobImage( double centerX,
+  double centerY )
+{
+  PopulationImageType::RegionType region;
+  region.SetIndex( 0, 0 );
+  region.SetIndex( 1, 0 );
+  region.SetSize( 0, 64 );
+  region.SetSize( 1, 64 );
+  PopulationImageType::Pointer image = PopulationImageType::New();
+  image->SetRegions( region );
+  image->Allocate();
+  itk::ImageRegionIteratorWithIndex< PopulationImageType > it( image,
+    region );
+  while( !it.IsAtEnd() )
+    {
+    PopulationImageType::IndexType indx = it.GetIndex();
+    const double dx = indx[0] - centerX;
+    const double dy = ( indx[1] - centerY ) * 1.5;
+    it.Set( 100 * std::exp( -( dx * dx + dy * dy ) / 200 ) );
+    ++it;
+    }
+  return image;
+}
+
+} // End namespace
+
+int itkPopulationEvolutionaryOptimizerTest( int itkNotUsed( argc ),
+  char * itkNotUsed( argv )[] )
+{
+  int returnStatus = EXIT_SUCCESS;
+
+  // Serial and concurrent evaluation reach the minimum, along the same
+  //   path since candidates are drawn serially
+  PopulationOptimizerType::Pointer serial = RunQuadraticOptimization( 0,
+    false );
+  PopulationOptimizerType::Pointer concurrent = RunQuadraticOptimization( 4,
+    false );
+  if( !CheckQuadraticMinimum( "Serial", serial )
+    || !CheckQuadraticMinimum( "Concurrent", concurrent ) )
+    {
+    returnStatus = EXIT_FAILURE;
+    }
+  if( serial->GetCurrentPosition() != concurrent->GetCurrentPosition()
+    || serial->GetCurrentIteration() != concurrent->GetCurrentIteration()
+    || serial->GetCurrentCost() != concurrent->GetCurrentCost() )
+    {
+    std::cerr << "Concurrent result " << concurrent->GetCurrentPosition()
+      << " differs from serial result " << serial->GetCurrentPosition()
+      << std::endl;
+    returnStatus = EXIT_FAILURE;
+    }
+
+  // Maximizing the negated quadratic reaches the same point
+  PopulationOptimizerType::Pointer maximizer = RunQuadraticOptimization( 3,
+    true );
+  if( !CheckQuadraticMinimum( "Maximize", maximizer ) )
+    {
+    returnStatus = EXIT_FAILURE;
+    }
+
+  // Rigid registration with a population recovers a known offset, with
+  //   serial and concurrent candidate evaluation
+  typedef itk::ImageToImageRegistrationHelper< PopulationImageType >
+    HelperType;
+  PopulationImageType::Pointer fixed = CreatePopulationBlobImage( 32, 32 );
+  PopulationImageType::Pointer moving = CreatePopulationBlobImage( 35, 30 );
+  const unsigned int numberOfWorkUnits[2] = { 1, 4 };
+  for( unsigned int i = 0; i < 2; ++i )
+    {
+    HelperType::Pointer helper = HelperType::New();
+    helper->SetFixedImage( fixed );
+    helper->SetMovingImage( moving );
+    helper->SetReportProgress( false );
+    helper->SetRandomNumberSeed( 1 );
+    helper->SetRegistrationNumberOfWorkUnits( numberOfWorkUnits[i] );
+    helper->SetInitialMethodEnum( HelperType::INIT_WITH_NONE );
+    helper->SetEnableRigidRegistration( true );
+    helper->SetEnableAffineRegistration( false );
+    helper->SetEnableBSplineRegistration( false );
+    helper->SetUseEvolutionaryOptimization( true );
+    helper->SetEvolutionaryPopulationSize( 8 );
+    helper->SetRigidSamplingRatio( 1.0 );
+    helper->SetRigidMaxIterations( 100 );
+    helper->Update();
+
+    const HelperType::MatrixTransformType * tfm =
+      helper->GetCurrentMatrixTransform();
+    std::cout << numberOfWorkUnits[i] << " work units: offset = "
+      << tfm->GetOffset() << std::endl;
+    if( std::fabs( tfm->GetOffset()[0] - 3 ) > 0.25
+      || std::fabs( tfm->GetOffset()[1] + 2 ) > 0.25
+      || std::fabs( tfm->GetMatrix()( 0, 1 ) ) > 0.02 )
+      {
+      std::cerr << numberOfWorkUnits[i] << " work units: offset "
+        << tfm->GetOffset() << " and matrix " << tfm->GetMatrix()
+        << " are not a translation by ( 3, -2 )" << std::endl;
+      returnStatus = EXIT_FAILURE;
+      }
+    }
+
+  return returnStatus;
+}
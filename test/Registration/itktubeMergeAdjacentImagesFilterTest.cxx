@@ -0,0 +1,135 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright Kitware Inc.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+
+#include "itktubeMergeAdjacentImagesFilter.h"
+
+#include <itkExtractImageFilter.h>
+#include <itkImageRegionConstIteratorWithIndex.h>
+#include <itkImageRegionIteratorWithIndex.h>
+
+#include <cmath>
+
+int itktubeMergeAdjacentImagesFilterTest( int itkNotUsed( argc ),
+  char * itkNotUsed( argv )[] )
+{
+  typedef itk::Image< float, 2 >                          ImageType;
+  typedef itk::tube::MergeAdjacentImagesFilter< ImageType > FilterType;
+
+  int returnStatus = EXIT_SUCCESS;
+
+  // Intensity = 1 + x + 100 y, which blending of aligned images
+  //   reproduces
+  ImageType::RegionType region;
+  region.SetIndex( 0, 0 );
+  region.SetIndex( 1, 0 );
+  region.SetSize( 0, 80 );
+  region.SetSize( 1, 40 );
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions( region );
+  image->Allocate();
+  itk::ImageRegionIteratorWithIndex< ImageType > it( image, region );
+  while( !it.IsAtEnd() )
+    {
+    ImageType::IndexType indx = it.GetIndex();
+    it.Set( 1 + indx[0] + 100 * indx[1] );
+    ++it;
+    }
+
+  // Two images along x, overlapping over x = 30 to 49
+  ImageType::Pointer input[2];
+  for( unsigned int i = 0; i < 2; ++i )
+    {
+    ImageType::RegionType inputRegion = region;
+    inputRegion.SetIndex( 0, 30 * i );
+    inputRegion.SetSize( 0, 50 );
+    typedef itk::ExtractImageFilter< ImageType, ImageType > ExtractType;
+    ExtractType::Pointer extract = ExtractType::New();
+    extract->SetInput( image );
+    extract->SetExtractionRegion( inputRegion );
+    extract->Update();
+    input[i] = extract->GetOutput();
+    input[i]->DisconnectPipeline();
+    }
+
+  // Merge the whole images, then only the overlap plus a margin
+  const unsigned int margin = 3;
+  ImageType::Pointer output[2];
+  for( unsigned int r = 0; r < 2; ++r )
+    {
+    FilterType::Pointer filter = FilterType::New();
+    filter->SetInput1( input[0] );
+    filter->SetInput2( input[1] );
+    filter->SetBackground( 0 );
+    filter->SetMaxIterations( 0 );
+    filter->SetRestrictToOverlap( r == 1 );
+    filter->SetOverlapMargin( margin );
+    filter->Update();
+    output[r] = filter->GetOutput();
+    }
+
+  if( output[0]->GetLargestPossibleRegion()
+    != output[1]->GetLargestPossibleRegion()
+    || output[0]->GetLargestPossibleRegion() != region )
+    {
+    std::cerr << "ERROR: Output regions differ: "
+      << output[0]->GetLargestPossibleRegion() << " and "
+      << output[1]->GetLargestPossibleRegion() << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Outside the overlap plus the margin, where the restricted filter
+  //   copies rather than blends, the outputs must be identical; every
+  //   voxel must reproduce the intensity
+  itk::ImageRegionConstIteratorWithIndex< ImageType > iter0( output[0],
+    region );
+  itk::ImageRegionConstIteratorWithIndex< ImageType > iter1( output[1],
+    region );
+  while( !iter0.IsAtEnd() )
+    {
+    ImageType::IndexType indx = iter0.GetIndex();
+    const bool nearOverlap = indx[0] >= 30 - static_cast< int >( margin )
+      && indx[0] <= 49 + static_cast< int >( margin );
+    if( !nearOverlap && iter0.Get() != iter1.Get() )
+      {
+      std::cerr << "ERROR: Outside the overlap, restricted output at "
+        << indx << " is " << iter1.Get() << ", unrestricted is "
+        << iter0.Get() << std::endl;
+      returnStatus = EXIT_FAILURE;
+      break;
+      }
+    const double expected = 1 + indx[0] + 100 * indx[1];
+    if( std::fabs( iter0.Get() - expected ) > 0.01
+      || std::fabs( iter1.Get() - expected ) > 0.01 )
+      {
+      std::cerr << "ERROR: Output at " << indx << " is " << iter0.Get()
+        << " and " << iter1.Get() << " when restricted, expected "
+        << expected << std::endl;
+      returnStatus = EXIT_FAILURE;
+      break;
+      }
+    ++iter0;
+    ++iter1;
+    }
+
+  return returnStatus;
+}
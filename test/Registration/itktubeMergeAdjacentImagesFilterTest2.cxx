@@ -0,0 +1,190 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright Kitware Inc.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+
+
+#include "itktubeMergeAdjacentImagesFilter.h"
+
+#include <itkExtractImageFilter.h>
+#include <itkImageRegionConstIteratorWithIndex.h>
+#include <itkImageRegionIteratorWithIndex.h>
+
+#include <cmath>
+
+namespace
+{
+
+// Gaussian blobs on a constant background, two of them in the overlap of
+//   the images, so that a misplaced image cannot blend into the truth
+double MergeTestIntensity( double x, double y )
+{
+  const double centers[6][2] = { { 10, 10 }, { 22, 28 }, { 36, 12 },
+    { 44, 27 }, { 60, 16 }, { 70, 30 } };
+  double value = 10;
+  for( unsigned int b = 0; b < 6; ++b )
+    {
+    const double dx = x - centers[b][0];
+    const double dy = y - centers[b][1];
+    value += 100 * std::exp( -( dx * dx + dy * dy ) / ( 2 * 4.0 * 4.0 ) );
+    }
+  return value;
+}
+
+} // End namespace
+
+// Merge two images whose second one is misplaced by a known offset, with
+//   registration on, and check that the offset is recovered and that the
+//   merged image reproduces the intensity
+int itktubeMergeAdjacentImagesFilterTest2( int itkNotUsed( argc ),
+  char * itkNotUsed( argv )[] )
+{
+  typedef itk::Image< float, 2 >                          ImageType;
+  typedef itk::tube::MergeAdjacentImagesFilter< ImageType > FilterType;
+
+  int returnStatus = EXIT_SUCCESS;
+
+  ImageType::RegionType region;
+  region.SetIndex( 0, 0 );
+  region.SetIndex( 1, 0 );
+  region.SetSize( 0, 80 );
+  region.SetSize( 1, 40 );
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions( region );
+  image->Allocate();
+  itk::ImageRegionIteratorWithIndex< ImageType > it( image, region );
+  while( !it.IsAtEnd() )
+    {
+    ImageType::IndexType indx = it.GetIndex();
+    it.Set( MergeTestIntensity( indx[0], indx[1] ) );
+    ++it;
+    }
+
+  // Two images along x, overlapping over x = 30 to 49.  The origin of the
+  //   second one is moved by offset, so it is misplaced by that much.
+  ImageType::PointType offset;
+  offset[0] = 2.0;
+  offset[1] = -1.5;
+  ImageType::Pointer input[2];
+  for( unsigned int i = 0; i < 2; ++i )
+    {
+    ImageType::RegionType inputRegion = region;
+    inputRegion.SetIndex( 0, 30 * i );
+    inputRegion.SetSize( 0, 50 );
+    typedef itk::ExtractImageFilter< ImageType, ImageType > ExtractType;
+    ExtractType::Pointer extract = ExtractType::New();
+    extract->SetInput( image );
+    extract->SetExtractionRegion( inputRegion );
+    extract->Update();
+    input[i] = extract->GetOutput();
+    input[i]->DisconnectPipeline();
+    }
+  input[1]->SetOrigin( offset );
+
+  // Mean absolute error, over the interior of the truth, without and with
+  //   registration, and then with registration restricted to the overlap
+  const unsigned int numberOfRuns = 3;
+  const bool registerRun[numberOfRuns] = { false, true, true };
+  const bool restrictRun[numberOfRuns] = { false, false, true };
+  double meanError[numberOfRuns];
+  for( unsigned int r = 0; r < numberOfRuns; ++r )
+    {
+    FilterType::Pointer filter = FilterType::New();
+    filter->SetInput1( input[0] );
+    filter->SetInput2( input[1] );
+    filter->SetBackground( 0 );
+    filter->SetMaxIterations( registerRun[r] ? 300 : 0 );
+    filter->SetExpectedOffset( 5 );
+    filter->SetSamplingRatio( 1.0 );
+    filter->SetRestrictToOverlap( restrictRun[r] );
+    filter->Update();
+    ImageType::Pointer output = filter->GetOutput();
+
+    if( registerRun[r] )
+      {
+      // The transform maps the first image onto the second
+      ImageType::PointType center;
+      center[0] = 40;
+      center[1] = 20;
+      ImageType::PointType mapped =
+        filter->GetOutputTransform()->TransformPoint( center );
+      double offsetError = 0;
+      for( unsigned int d = 0; d < 2; ++d )
+        {
+        offsetError += ( mapped[d] - center[d] - offset[d] )
+          * ( mapped[d] - center[d] - offset[d] );
+        }
+      offsetError = std::sqrt( offsetError );
+      std::cout << "Run " << r << ": recovered offset = "
+        << mapped - center << ", error = " << offsetError << std::endl;
+      if( offsetError > 0.25 )
+        {
+        std::cerr << "ERROR: Run " << r << " recovered offset "
+          << mapped - center << ", expected " << offset << std::endl;
+        returnStatus = EXIT_FAILURE;
+        }
+      }
+
+    ImageType::RegionType interior = region;
+    interior.ShrinkByRadius( 3 );
+    if( !interior.Crop( output->GetLargestPossibleRegion() ) )
+      {
+      std::cerr << "ERROR: Run " << r << " output region "
+        << output->GetLargestPossibleRegion()
+        << " does not cover the images" << std::endl;
+      return EXIT_FAILURE;
+      }
+    itk::ImageRegionConstIteratorWithIndex< ImageType > iter( output,
+      interior );
+    double sumError = 0;
+    while( !iter.IsAtEnd() )
+      {
+      ImageType::IndexType indx = iter.GetIndex();
+      sumError += std::fabs( iter.Get()
+        - MergeTestIntensity( indx[0], indx[1] ) );
+      ++iter;
+      }
+    meanError[r] = sumError / interior.GetNumberOfPixels();
+    std::cout << "Run " << r << ": mean absolute error = " << meanError[r]
+      << std::endl;
+    }
+
+  // The misplaced merge must be visibly wrong, and registration must fix
+  //   most of it
+  if( meanError[0] < 1.0 )
+    {
+    std::cerr << "ERROR: Merging without registration is too close to the"
+      << " truth to test registration: " << meanError[0] << std::endl;
+    returnStatus = EXIT_FAILURE;
+    }
+  for( unsigned int r = 1; r < numberOfRuns; ++r )
+    {
+    if( meanError[r] > 0.2 * meanError[0] || meanError[r] > 1.0 )
+      {
+      std::cerr << "ERROR: Run " << r << " mean absolute error "
+        << meanError[r] << " is too large; without registration it is "
+        << meanError[0] << std::endl;
+      returnStatus = EXIT_FAILURE;
+      }
+    }
+
+  return returnStatus;
+}
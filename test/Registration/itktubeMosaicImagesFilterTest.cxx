@@ -0,0 +1,275 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright Kitware Inc.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#include "itktubeMosaicImagesFilter.h"
+
+#include <itkExtractImageFilter.h>
+#include <itkImageRegionConstIteratorWithIndex.h>
+#include <itkImageRegionIteratorWithIndex.h>
+
+#include <cmath>
+
+namespace
+{
+
+// Checkerboard of 4 voxel squares whose bright squares also vary with
+//   position, so a tile misplaced or blended with wrong weights changes
+//   the intensity, while aligned tiles reproduce it exactly
+float MosaicTestIntensity( itk::IndexValueType x, itk::IndexValueType y )
+{
+  if( ( ( x / 4 ) + ( y / 4 ) ) % 2 == 0 )
+    {
+    return 10;
+    }
+  return 100 + x + 3 * y;
+}
+
+} // End namespace
+
+int itktubeMosaicImagesFilterTest( int itkNotUsed( argc ),
+  char * itkNotUsed( argv )[] )
+{
+  typedef itk::Image< float, 2 >                      ImageType;
+  typedef itk::tube::MosaicImagesFilter< ImageType >  MosaicFilterType;
+  typedef MosaicFilterType::TransformType             TransformType;
+
+  int returnStatus = EXIT_SUCCESS;
+
+  ImageType::RegionType region;
+  region.SetIndex( 0, 0 );
+  region.SetIndex( 1, 0 );
+  region.SetSize( 0, 60 );
+  region.SetSize( 1, 40 );
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions( region );
+  image->Allocate();
+  itk::ImageRegionIteratorWithIndex< ImageType > it( image, region );
+  while( !it.IsAtEnd() )
+    {
+    ImageType::IndexType indx = it.GetIndex();
+    it.Set( MosaicTestIntensity( indx[0], indx[1] ) );
+    ++it;
+    }
+
+  // Three tiles along x, overlapping by five voxels
+  std::vector< ImageType::Pointer > tiles;
+  for( unsigned int t = 0; t < 3; ++t )
+    {
+    ImageType::RegionType tileRegion = region;
+    tileRegion.SetIndex( 0, 20 * t );
+    tileRegion.SetSize( 0, 25 );
+    tileRegion.Crop( region );
+    typedef itk::ExtractImageFilter< ImageType, ImageType > ExtractType;
+    ExtractType::Pointer extract = ExtractType::New();
+    extract->SetInput( image );
+    extract->SetExtractionRegion( tileRegion );
+    extract->Update();
+    tiles.push_back( extract->GetOutput() );
+    tiles.back()->DisconnectPipeline();
+    }
+
+  // The last tile is stored shifted, which its transform undoes
+  ImageType::PointType origin = tiles[2]->GetOrigin();
+  origin[0] += 5;
+  tiles[2]->SetOrigin( origin );
+  TransformType::Pointer shift = TransformType::New();
+  TransformType::OutputVectorType offset;
+  offset[0] = 5;
+  offset[1] = 0;
+  shift->Translate( offset );
+
+  MosaicFilterType::Pointer mosaic = MosaicFilterType::New();
+  mosaic->SetMaxIterations( 0 );
+  mosaic->SetBackground( -1 );
+  mosaic->AddTile( tiles[0] );
+  mosaic->AddTile( tiles[1] );
+  mosaic->Update();
+  if( mosaic->GetNumberOfOverlaps() != 1 )
+    {
+    std::cerr << "Two tiles: " << mosaic->GetNumberOfOverlaps()
+      << " overlaps != 1" << std::endl;
+    returnStatus = EXIT_FAILURE;
+    }
+
+  // Adding a tile registers only its pairs
+  mosaic->AddTile( tiles[2], shift );
+  mosaic->Update();
+  if( mosaic->GetNumberOfOverlaps() != 2 )
+    {
+    std::cerr << "Three tiles: " << mosaic->GetNumberOfOverlaps()
+      << " overlaps != 2" << std::endl;
+    returnStatus = EXIT_FAILURE;
+    }
+
+  // Registration is off, so the adjustment keeps the initial transforms
+  const TransformType * tileTransform = mosaic->GetTileTransform( 2 );
+  if( std::fabs( tileTransform->GetOffset()[0] - 5 ) > 0.001
+    || std::fabs( tileTransform->GetOffset()[1] ) > 0.001 )
+    {
+    std::cerr << "Tile transform offset = " << tileTransform->GetOffset()
+      << " != [5, 0]" << std::endl;
+    returnStatus = EXIT_FAILURE;
+    }
+
+  ImageType::Pointer output = mosaic->GetOutput();
+  ImageType::RegionType outputRegion = output->GetLargestPossibleRegion();
+  if( !outputRegion.IsInside( region ) )
+    {
+    std::cerr << "Output region " << outputRegion
+      << " does not contain " << region << std::endl;
+    returnStatus = EXIT_FAILURE;
+    }
+  else
+    {
+    unsigned int numberOfErrors = 0;
+    itk::ImageRegionConstIteratorWithIndex< ImageType > iter( image,
+      region );
+    while( !iter.IsAtEnd() )
+      {
+      const float val = output->GetPixel( iter.GetIndex() );
+      if( std::fabs( val - iter.Get() ) > 0.01 )
+        {
+        if( numberOfErrors++ < 10 )
+          {
+          std::cerr << "Mismatch at " << iter.GetIndex() << ": " << val
+            << " != " << iter.Get() << std::endl;
+          }
+        }
+      ++iter;
+      }
+    if( numberOfErrors > 0 )
+      {
+      returnStatus = EXIT_FAILURE;
+      }
+    }
+
+  // With registration on, an unknown shift of a tile is recovered.  The
+  //   checkerboard above is periodic, so register smooth blobs instead
+  ImageType::RegionType blobRegion;
+  blobRegion.SetIndex( 0, 0 );
+  blobRegion.SetIndex( 1, 0 );
+  blobRegion.SetSize( 0, 80 );
+  blobRegion.SetSize( 1, 60 );
+  ImageType::Pointer blobImage = ImageType::New();
+  blobImage->SetRegions( blobRegion );
+  blobImage->Allocate();
+  const double blobs[6][3] = {
+    { 15, 15, 60 }, { 30, 40, 100 }, { 40, 20, 80 },
+    { 45, 50, 50 }, { 55, 30, 90 }, { 65, 45, 70 } };
+  itk::ImageRegionIteratorWithIndex< ImageType > blobIt( blobImage,
+    blobRegion );
+  while( !blobIt.IsAtEnd() )
+    {
+    ImageType::IndexType indx = blobIt.GetIndex();
+    double val = 10;
+    for( unsigned int b = 0; b < 6; ++b )
+      {
+      const double dx = indx[0] - blobs[b][0];
+      const double dy = indx[1] - blobs[b][1];
+      val += blobs[b][2] * std::exp( -( dx * dx + dy * dy ) / 50 );
+      }
+    blobIt.Set( val );
+    ++blobIt;
+    }
+
+  // Two tiles overlapping by 30 voxels; the second is stored shifted by
+  //   ( 3, -2 ) and added without a transform
+  std::vector< ImageType::Pointer > blobTiles;
+  for( unsigned int t = 0; t < 2; ++t )
+    {
+    ImageType::RegionType tileRegion = blobRegion;
+    tileRegion.SetIndex( 0, 25 * t );
+    tileRegion.SetSize( 0, 55 );
+    typedef itk::ExtractImageFilter< ImageType, ImageType > ExtractType;
+    ExtractType::Pointer extract = ExtractType::New();
+    extract->SetInput( blobImage );
+    extract->SetExtractionRegion( tileRegion );
+    extract->Update();
+    blobTiles.push_back( extract->GetOutput() );
+    blobTiles.back()->DisconnectPipeline();
+    }
+  ImageType::PointType blobOrigin = blobTiles[1]->GetOrigin();
+  blobOrigin[0] += 3;
+  blobOrigin[1] -= 2;
+  blobTiles[1]->SetOrigin( blobOrigin );
+
+  MosaicFilterType::Pointer regMosaic = MosaicFilterType::New();
+  regMosaic->SetMaxIterations( 200 );
+  regMosaic->SetExpectedOffset( 5 );
+  regMosaic->SetExpectedRotation( 0.01 );
+  regMosaic->SetSamplingRatio( 1 );
+  regMosaic->SetOverlapMargin( 10 );
+  regMosaic->SetBackground( -1 );
+  regMosaic->AddTile( blobTiles[0] );
+  regMosaic->AddTile( blobTiles[1] );
+  regMosaic->Update();
+
+  const TransformType * regTransform = regMosaic->GetTileTransform( 1 );
+  if( std::fabs( regTransform->GetOffset()[0] - 3 ) > 0.5
+    || std::fabs( regTransform->GetOffset()[1] + 2 ) > 0.5 )
+    {
+    std::cerr << "Registered tile transform offset = "
+      << regTransform->GetOffset() << " != [3, -2]" << std::endl;
+    returnStatus = EXIT_FAILURE;
+    }
+  if( regMosaic->GetTileTransform( 0 )->GetOffset().GetNorm() > 0.001 )
+    {
+    std::cerr << "First tile moved: offset = "
+      << regMosaic->GetTileTransform( 0 )->GetOffset() << std::endl;
+    returnStatus = EXIT_FAILURE;
+    }
+
+  // The registered mosaic places the blobs where they are in the truth
+  ImageType::Pointer regOutput = regMosaic->GetOutput();
+  ImageType::RegionType interior = blobRegion;
+  interior.ShrinkByRadius( 5 );
+  if( !interior.Crop( regOutput->GetLargestPossibleRegion() ) )
+    {
+    std::cerr << "Registered output region "
+      << regOutput->GetLargestPossibleRegion() << " misses " << blobRegion
+      << std::endl;
+    returnStatus = EXIT_FAILURE;
+    }
+  else
+    {
+    double sumError = 0;
+    itk::ImageRegionConstIteratorWithIndex< ImageType > iter( blobImage,
+      interior );
+    while( !iter.IsAtEnd() )
+      {
+      sumError += std::fabs( regOutput->GetPixel( iter.GetIndex() )
+        - iter.Get() );
+      ++iter;
+      }
+    const double meanError = sumError / interior.GetNumberOfPixels();
+    std::cout << "Registered mosaic mean absolute error = " << meanError
+      << std::endl;
+    if( meanError > 2.0 )
+      {
+      std::cerr << "Registered mosaic mean absolute error = " << meanError
+        << " > 2" << std::endl;
+      returnStatus = EXIT_FAILURE;
+      }
+    }
+
+  return returnStatus;
+}
@@ -33,6 +33,7 @@ limitations under the License.
 #include "itkImageToImageRegistrationMethod.h"
 #include "itkInitialImageToImageRegistrationMethod.h"
 #include "itkOptimizedImageToImageRegistrationMethod.h"
+#include "itkPopulationEvolutionaryOptimizer.h"
 #include "itkRigidImageToImageRegistrationMethod.h"
 #include "itkScaleSkewAngle2DImageToImageRegistrationMethod.h"
 #include "itkScaleSkewAngle2DTransform.h"
@@ -46,6 +47,7 @@ limitations under the License.
 #include "itktubeInitialSpatialObjectToImageRegistrationMethod.h"
 #include "itktubeMeanSquareRegistrationFunction.h"
 #include "itktubeMergeAdjacentImagesFilter.h"
+#include "itktubeMosaicImagesFilter.h"
 #include "itktubeOptimizedSpatialObjectToImageRegistrationMethod.h"
 #include "itktubePointBasedSpatialObjectToImageMetric.h"
 #include "itktubePointBasedSpatialObjectTransformFilter.h"
@@ -0,0 +1,187 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright Kitware Inc.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+#include "itktubeSparseTubeMask.h"
+
+#include <itkImageRegionConstIteratorWithIndex.h>
+#include <itkMersenneTwisterRandomVariateGenerator.h>
+#include <itkNeighborhoodIterator.h>
+
+typedef itk::tube::SparseTubeMask< float, 3 >  SparseMaskTestType;
+typedef SparseMaskTestType::ImageType          SparseMaskTestImageType;
+
+// Paint a ball the way RidgeExtractor::AddTube does
+void
+FillBallInImage( SparseMaskTestImageType * image,
+  const SparseMaskTestImageType::IndexType & center, int radius,
+  float value )
+{
+  typedef itk::NeighborhoodIterator< SparseMaskTestImageType >
+    NeighborhoodIteratorType;
+  NeighborhoodIteratorType::RadiusType rad;
+  rad.Fill( radius );
+  NeighborhoodIteratorType it( rad, image,
+    image->GetLargestPossibleRegion() );
+  it.SetLocation( center );
+  double rr = radius * radius;
+  bool inside;
+  for( unsigned int i = 0; i < it.Size(); ++i )
+    {
+    double dist = 0;
+    for( unsigned int j = 0; j < 3; ++j )
+      {
+      double tf = it.GetOffset( i )[j];
+      dist += tf * tf;
+      }
+    if( dist <= rr )
+      {
+      it.SetPixel( i, value, inside );
+      }
+    }
+}
+
+unsigned int
+CompareSparseMaskToImage( SparseMaskTestType * mask,
+  SparseMaskTestImageType * image )
+{
+  unsigned int numberOfErrors = 0;
+  itk::ImageRegionConstIteratorWithIndex< SparseMaskTestImageType > it(
+    image, image->GetLargestPossibleRegion() );
+  while( !it.IsAtEnd() )
+    {
+    if( mask->GetPixel( it.GetIndex() ) != it.Get() )
+      {
+      if( numberOfErrors++ < 10 )
+        {
+        std::cerr << "Mismatch at " << it.GetIndex() << ": "
+          << mask->GetPixel( it.GetIndex() ) << " != " << it.Get()
+          << std::endl;
+        }
+      }
+    ++it;
+    }
+  return numberOfErrors;
+}
+
+int itktubeSparseTubeMaskTest( int itkNotUsed( argc ),
+  char * itkNotUsed( argv )[] )
+{
+  int returnStatus = EXIT_SUCCESS;
+
+  // A region that is not a multiple of the brick size and does not start
+  // at the origin
+  SparseMaskTestImageType::RegionType region;
+  region.SetIndex( 0, -5 );
+  region.SetIndex( 1, 3 );
+  region.SetIndex( 2, 0 );
+  region.SetSize( 0, 61 );
+  region.SetSize( 1, 37 );
+  region.SetSize( 2, 29 );
+
+  SparseMaskTestImageType::Pointer image = SparseMaskTestImageType::New();
+  image->SetRegions( region );
+  image->Allocate();
+  image->FillBuffer( 0 );
+
+  SparseMaskTestType::Pointer mask = SparseMaskTestType::New();
+  mask->SetRegion( region );
+
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomType;
+  RandomType::Pointer rndGen = RandomType::New();
+  rndGen->Initialize( 1 );
+
+  // Balls that straddle bricks and the region's boundary; as in AddTube,
+  // their centers are inside the region
+  std::vector< SparseMaskTestImageType::IndexType > centers;
+  std::vector< int > radii;
+  for( unsigned int b = 0; b < 40; ++b )
+    {
+    SparseMaskTestImageType::IndexType center;
+    for( unsigned int d = 0; d < 3; ++d )
+      {
+      center[d] = region.GetIndex()[d] + static_cast< int >(
+        rndGen->GetUniformVariate( 0, region.GetSize()[d] - 1 ) );
+      }
+    int radius = static_cast< int >( rndGen->GetUniformVariate( 0, 6 ) );
+    centers.push_back( center );
+    radii.push_back( radius );
+    FillBallInImage( image, center, radius, b + 1 + b / 100.0f );
+    mask->FillBall( center, radius, b + 1 + b / 100.0f );
+    }
+
+  std::cout << "Allocated bricks = " << mask->GetNumberOfAllocatedBricks()
+    << " ( " << mask->GetMemorySizeInBytes() << " bytes )" << std::endl;
+  if( CompareSparseMaskToImage( mask, image ) > 0 )
+    {
+    std::cerr << "Painted sparse mask differs from image" << std::endl;
+    returnStatus = EXIT_FAILURE;
+    }
+
+  // Round trip through an image
+  SparseMaskTestImageType::Pointer copy = SparseMaskTestImageType::New();
+  copy->SetRegions( region );
+  copy->Allocate();
+  copy->FillBuffer( -1 );
+  mask->CopyToImage( copy );
+  SparseMaskTestType::Pointer mask2 = SparseMaskTestType::New();
+  mask2->CopyFromImage( copy );
+  if( CompareSparseMaskToImage( mask2, image ) > 0
+    || mask2->GetNumberOfNonZeroPixels() != mask->GetNumberOfNonZeroPixels() )
+    {
+    std::cerr << "Image round trip differs" << std::endl;
+    returnStatus = EXIT_FAILURE;
+    }
+
+  // Erasing everything must release every brick
+  for( unsigned int b = 0; b < centers.size(); ++b )
+    {
+    FillBallInImage( image, centers[b], radii[b], 0 );
+    mask->FillBall( centers[b], radii[b], 0 );
+    }
+  if( CompareSparseMaskToImage( mask, image ) > 0 )
+    {
+    std::cerr << "Erased sparse mask differs from image" << std::endl;
+    returnStatus = EXIT_FAILURE;
+    }
+  if( mask->GetNumberOfAllocatedBricks() != 0
+    || mask->GetNumberOfNonZeroPixels() != 0 )
+    {
+    std::cerr << "Bricks remain after erasing: "
+      << mask->GetNumberOfAllocatedBricks() << std::endl;
+    returnStatus = EXIT_FAILURE;
+    }
+
+  // Outside of the region, reads are zero and writes are ignored
+  SparseMaskTestImageType::IndexType outside;
+  outside[0] = -6;
+  outside[1] = 3;
+  outside[2] = 0;
+  mask->SetPixel( outside, 1 );
+  if( mask->GetPixel( outside ) != 0
+    || mask->GetNumberOfAllocatedBricks() != 0 )
+    {
+    std::cerr << "Write outside of the region was not ignored" << std::endl;
+    returnStatus = EXIT_FAILURE;
+    }
+
+  return returnStatus;
+}
@@ -20,6 +20,8 @@ limitations under the License.
 
 =========================================================================*/
 
+#include "tubetkConfigure.h"
+
 #include "itktubeTubeExtractor.h"
 
 #include "tubeTubeMathFilters.h"
@@ -51,6 +53,7 @@ int itktubeTubeExtractorTest( int argc, char * argv[] )
 
   tubeOp->SetInputImage( im );
   tubeOp->SetRadiusInObjectSpace( 2.0 );
+  tubeOp->SetUseEventLog( true );
 
   typedef itk::SpatialObjectReader<>                   ReaderType;
   typedef itk::SpatialObject<>::ChildrenListType       ObjectListType;
@@ -292,6 +295,32 @@ int itktubeTubeExtractorTest( int argc, char * argv[] )
     }
   delete tubeList;
 
+#ifdef TubeTK_USE_EXTRACTION_EVENT_LOG
+  std::cout << "***** Verifying seed statistics *****" << std::endl;
+  tubeOp->WriteSeedStatistics( std::cout );
+  TubeOpType::SeedStatisticsListType seedStatistics =
+    tubeOp->GetSeedStatistics();
+  unsigned int numberOfExtractedSeeds = 0;
+  for( unsigned int i = 0; i < seedStatistics.size(); ++i )
+    {
+    if( seedStatistics[i].Extracted )
+      {
+      ++numberOfExtractedSeeds;
+      if( seedStatistics[i].NumberOfSteps == 0
+        || seedStatistics[i].NumberOfPoints == 0 )
+        {
+        std::cout << "Extracted seed without steps or points." << std::endl;
+        ++failures;
+        }
+      }
+    }
+  if( numberOfExtractedSeeds == 0 )
+    {
+    std::cout << "No extracted seed was logged." << std::endl;
+    ++failures;
+    }
+#endif
+
   std::cout << "***** Verifying empty mask *****" << std::endl;
   TubeOpType::TubeMaskImageType::Pointer mask = tubeOp->GetTubeMaskImage();
   itk::ImageRegionIterator< TubeOpType::TubeMaskImageType > maskIt( mask,
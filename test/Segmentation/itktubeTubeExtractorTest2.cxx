@@ -0,0 +1,302 @@
+/*=========================================================================
+
+Library:   TubeTK
+
+Copyright Kitware Inc.
+
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 ( the "License" );
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+=========================================================================*/
+
+
+#include "itktubeTubeExtractor.h"
+
+#include <itkImageFileReader.h>
+#include <itkImageRegionConstIterator.h>
+#include <itkSpatialObjectReader.h>
+
+typedef itk::Image< float, 3 >                        TubeTestImageType;
+typedef itk::tube::TubeExtractor< TubeTestImageType > TubeTestOpType;
+typedef TubeTestOpType::TubeType                      TubeTestTubeType;
+typedef TubeTestOpType::TubeMaskImageType             TubeTestMaskType;
+
+// Count the tube points that differ between two extractions
+unsigned int
+CompareExtractedTubes( TubeTestTubeType * denseTube,
+  TubeTestTubeType * sparseTube )
+{
+  if( denseTube == nullptr || sparseTube == nullptr )
+    {
+    return ( denseTube == nullptr && sparseTube == nullptr ) ? 0 : 1;
+    }
+  if( denseTube->GetPoints().size() != sparseTube->GetPoints().size() )
+    {
+    std::cout << "  Dense points = " << denseTube->GetPoints().size()
+      << ", sparse points = " << sparseTube->GetPoints().size()
+      << std::endl;
+    return 1;
+    }
+
+  unsigned int numberOfDifferences = 0;
+  for( unsigned int i = 0; i < denseTube->GetPoints().size(); ++i )
+    {
+    const TubeTestTubeType::TubePointType & denseP =
+      denseTube->GetPoints()[i];
+    const TubeTestTubeType::TubePointType & sparseP =
+      sparseTube->GetPoints()[i];
+    if( denseP.GetPositionInObjectSpace().EuclideanDistanceTo(
+        sparseP.GetPositionInObjectSpace() ) > 1e-6
+      || std::fabs( denseP.GetRadiusInObjectSpace()
+        - sparseP.GetRadiusInObjectSpace() ) > 1e-6 )
+      {
+      ++numberOfDifferences;
+      }
+    }
+  return numberOfDifferences;
+}
+
+// Count the voxels that differ between two tube masks
+unsigned int
+CompareTubeMasks( TubeTestMaskType * denseMask,
+  TubeTestMaskType * sparseMask, unsigned int & numberOfMarked )
+{
+  numberOfMarked = 0;
+  if( denseMask->GetLargestPossibleRegion()
+    != sparseMask->GetLargestPossibleRegion() )
+    {
+    std::cout << "  Mask regions differ." << std::endl;
+    return 1;
+    }
+
+  itk::ImageRegionConstIterator< TubeTestMaskType > denseIt( denseMask,
+    denseMask->GetLargestPossibleRegion() );
+  itk::ImageRegionConstIterator< TubeTestMaskType > sparseIt( sparseMask,
+    sparseMask->GetLargestPossibleRegion() );
+  unsigned int numberOfDifferences = 0;
+  while( !denseIt.IsAtEnd() )
+    {
+    if( denseIt.Get() != sparseIt.Get() )
+      {
+      ++numberOfDifferences;
+      }
+    if( denseIt.Get() != 0 )
+      {
+      ++numberOfMarked;
+      }
+    ++denseIt;
+    ++sparseIt;
+    }
+  return numberOfDifferences;
+}
+
+// Extracting the same seeds with a dense and with a sparse tube mask must
+//   give the same tubes and the same mask.
+int itktubeTubeExtractorTest2( int argc, char * argv[] )
+{
+  if( argc != 3 )
+    {
+    std::cout << "itktubeTubeExtractorTest2 <inputImage> <vessel.tre>"
+      << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  typedef itk::ImageFileReader< TubeTestImageType > ImageReaderType;
+  ImageReaderType::Pointer imReader = ImageReaderType::New();
+  imReader->SetFileName( argv[1] );
+  imReader->Update();
+  TubeTestImageType::Pointer im = imReader->GetOutput();
+
+  TubeTestOpType::Pointer denseOp = TubeTestOpType::New();
+  denseOp->SetInputImage( im );
+  denseOp->SetRadiusInObjectSpace( 2.0 );
+
+  // The sparse mask is allocated when the input image is set
+  TubeTestOpType::Pointer sparseOp = TubeTestOpType::New();
+  sparseOp->GetRidgeExtractor()->SetUseSparseTubeMask( true );
+  sparseOp->SetInputImage( im );
+  sparseOp->SetRadiusInObjectSpace( 2.0 );
+
+  int failures = 0;
+  if( sparseOp->GetRidgeExtractor()->GetSparseTubeMask() == nullptr
+    || denseOp->GetRidgeExtractor()->GetSparseTubeMask() != nullptr )
+    {
+    std::cout << "Sparse tube mask setting not applied." << std::endl;
+    ++failures;
+    }
+
+  typedef itk::SpatialObjectReader<>               ReaderType;
+  typedef itk::SpatialObject<>::ChildrenListType   ObjectListType;
+  typedef itk::TubeSpatialObject<>                 TubeType;
+
+  ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName( argv[2] );
+  reader->Update();
+
+  char tubeName[17];
+  std::strcpy( tubeName, "Tube" );
+  ObjectListType * tubeList = reader->GetGroup()->GetChildren( -1,
+    tubeName );
+
+  // Seed at the middle point of the first truth tubes that lie well
+  //   inside the image
+  TubeTestImageType::IndexType imMinX =
+    denseOp->GetExtractBoundMinInIndexSpace();
+  TubeTestImageType::IndexType imMaxX =
+    denseOp->GetExtractBoundMaxInIndexSpace();
+  const int margin = 10;
+  const unsigned int maxNumberOfSeeds = 3;
+
+  std::vector< TubeTestTubeType::Pointer > denseTubes;
+  std::vector< TubeTestTubeType::Pointer > sparseTubes;
+  for( ObjectListType::iterator tubeIter = tubeList->begin();
+    tubeIter != tubeList->end() && denseTubes.size() < maxNumberOfSeeds;
+    ++tubeIter )
+    {
+    TubeType * tube = static_cast< TubeType * >( tubeIter->GetPointer() );
+    tube->Update();
+    if( tube->GetPoints().empty() )
+      {
+      continue;
+      }
+    TubeTestImageType::PointType pntX = tube->GetPoints()[
+      tube->GetPoints().size() / 2 ].GetPositionInWorldSpace();
+
+    TubeTestOpType::ContinuousIndexType x0;
+    bool inMargin = im->TransformPhysicalPointToContinuousIndex( pntX, x0 );
+    for( unsigned int i = 0; inMargin && i < 3; ++i )
+      {
+      if( x0[i] < imMinX[i] + margin || x0[i] > imMaxX[i] - margin )
+        {
+        inMargin = false;
+        }
+      }
+    if( !inMargin )
+      {
+      continue;
+      }
+    std::cout << "Seed index = " << x0 << std::endl;
+
+    TubeTestImageType::PointType densePnt = pntX;
+    TubeTestImageType::PointType sparsePnt = pntX;
+    bool denseFound = denseOp->FindLocalTubeInObjectSpace( densePnt );
+    bool sparseFound = sparseOp->FindLocalTubeInObjectSpace( sparsePnt );
+    if( denseFound != sparseFound
+      || densePnt.EuclideanDistanceTo( sparsePnt ) > 1e-6 )
+      {
+      std::cout << "Local tube differs: dense = " << densePnt
+        << ", sparse = " << sparsePnt << std::endl;
+      ++failures;
+      continue;
+      }
+    if( !denseFound )
+      {
+      continue;
+      }
+
+    const unsigned int tubeId =
+      static_cast< unsigned int >( denseTubes.size() ) + 1;
+    TubeTestTubeType::Pointer denseTube =
+      denseOp->ExtractTubeInObjectSpace( densePnt, tubeId );
+    TubeTestTubeType::Pointer sparseTube =
+      sparseOp->ExtractTubeInObjectSpace( sparsePnt, tubeId );
+    if( CompareExtractedTubes( denseTube, sparseTube ) > 0 )
+      {
+      std::cout << "Extracted tube " << tubeId << " differs." << std::endl;
+      ++failures;
+      continue;
+      }
+    if( denseTube.IsNull() )
+      {
+      continue;
+      }
+    std::cout << "  Extracted tube " << tubeId << " with "
+      << denseTube->GetPoints().size() << " points" << std::endl;
+    denseTubes.push_back( denseTube );
+    sparseTubes.push_back( sparseTube );
+    }
+  delete tubeList;
+
+  if( denseTubes.empty() )
+    {
+    std::cout << "No tube extracted." << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  unsigned int numberOfMarked = 0;
+  unsigned int numberOfDifferences = CompareTubeMasks(
+    denseOp->GetTubeMaskImage(), sparseOp->GetTubeMaskImage(),
+    numberOfMarked );
+  std::cout << "Marked voxels = " << numberOfMarked << std::endl;
+  if( numberOfDifferences > 0 || numberOfMarked == 0 )
+    {
+    std::cout << "Tube masks differ after extraction: "
+      << numberOfDifferences << " voxels." << std::endl;
+    ++failures;
+    }
+
+  // The dense export of a sparse mask is built on every call, not kept
+  TubeTestMaskType::Pointer export1 = sparseOp->GetTubeMaskImage();
+  TubeTestMaskType::Pointer export2 = sparseOp->GetTubeMaskImage();
+  if( export1 == export2 )
+    {
+    std::cout << "Dense export of the sparse mask was cached." << std::endl;
+    ++failures;
+    }
+
+  // Deleting a tube must clear the same voxels in both masks
+  if( !denseOp->DeleteTube( denseTubes[0] )
+    || !sparseOp->DeleteTube( sparseTubes[0] ) )
+    {
+    std::cout << "Delete tube failed." << std::endl;
+    ++failures;
+    }
+  numberOfDifferences = CompareTubeMasks( denseOp->GetTubeMaskImage(),
+    sparseOp->GetTubeMaskImage(), numberOfMarked );
+  if( numberOfDifferences > 0 )
+    {
+    std::cout << "Tube masks differ after delete: "
+      << numberOfDifferences << " voxels." << std::endl;
+    ++failures;
+    }
+
+  // Switching to a dense mask keeps the recorded tubes
+  sparseOp->GetRidgeExtractor()->SetUseSparseTubeMask( false );
+  if( sparseOp->GetRidgeExtractor()->GetSparseTubeMask() != nullptr
+    || sparseOp->GetTubeMaskImage().IsNull() )
+    {
+    std::cout << "Switch to a dense tube mask failed." << std::endl;
+    ++failures;
+    }
+  else
+    {
+    numberOfDifferences = CompareTubeMasks( denseOp->GetTubeMaskImage(),
+      sparseOp->GetTubeMaskImage(), numberOfMarked );
+    if( numberOfDifferences > 0 )
+      {
+      std::cout << "Tube masks differ after switch: "
+        << numberOfDifferences << " voxels." << std::endl;
+      ++failures;
+      }
+    }
+
+  std::cout << "Number of failures = " << failures << std::endl;
+  if( failures > 0 )
+    {
+    return EXIT_FAILURE;
+    }
+
+  std::cout << "SUCCESS" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -25,8 +25,10 @@ limitations under the License.
 #include "itktubePDFSegmenterBase.h"
 #include "itktubePDFSegmenterParzen.h"
 #include "itktubeRadiusExtractor2.h"
+#include "itktubeRidgeExtractionEventLog.h"
 #include "itktubeRidgeExtractor.h"
 #include "itktubeRidgeSeedFilter.h"
+#include "itktubeSparseTubeMask.h"
 #include "itktubeTubeExtractor.h"
 
 #include <iostream>
@@ -24,8 +24,10 @@ limitations under the License.
 
 #include "itktubePDFSegmenterParzen.h"
 #include "itktubeRadiusExtractor2.h"
+#include "itktubeRidgeExtractionEventLog.h"
 #include "itktubeRidgeExtractor.h"
 #include "itktubeRidgeSeedFilter.h"
+#include "itktubeSparseTubeMask.h"
 #include "itktubeTubeExtractor.h"
 
 #include <itkImage.h>
@@ -47,6 +49,11 @@ int tubeSegmentationPrintTest( int itkNotUsed( argc ),
   std::cout << "-------------itktubeRadiusExtractor2" << radius2Object
     << std::endl;
 
+  itk::tube::RidgeExtractionEventLog::Pointer eventLog =
+    itk::tube::RidgeExtractionEventLog::New();
+  std::cout << "-------------itktubeRidgeExtractionEventLog" << eventLog
+    << std::endl;
+
   itk::tube::RidgeExtractor< ImageType >::Pointer
     ridgeObject = itk::tube::RidgeExtractor< ImageType >::New();
   std::cout << "-------------itktubeRidgeExtractor" << ridgeObject
@@ -58,6 +65,11 @@ int tubeSegmentationPrintTest( int itkNotUsed( argc ),
   std::cout << "-------------itktubeRidgeSeedFilter" << seedObject
     << std::endl;
 
+  itk::tube::SparseTubeMask< float, 2 >::Pointer sparseMaskObject =
+    itk::tube::SparseTubeMask< float, 2 >::New();
+  std::cout << "-------------itktubeSparseTubeMask" << sparseMaskObject
+    << std::endl;
+
   itk::tube::TubeExtractor< ImageType >::Pointer tubeObject =
     itk::tube::TubeExtractor< ImageType >::New();
   std::cout << "-------------itktubeTubeExtractor" << tubeObject <<